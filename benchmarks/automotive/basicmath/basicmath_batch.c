@@ -0,0 +1,190 @@
+#include "snipmath.h"
+#include <math.h>
+#include <stdio.h>
+#include <sys/time.h>
+
+#undef rad2deg                /* call the functions in rad2deg.c */
+#undef deg2rad
+
+/*
+** Batch kernel benchmark
+**
+** Runs SolveCubic, usqrt, deg2rad and rad2deg over <count> inputs
+** one call at a time and through the array versions in mathvec.c,
+** prints both times, and checks every batch result against the
+** scalar one. Cubic roots must agree to CUBIC_TOL relative to
+** max(1, |root|); the other kernels must agree exactly. The cubic
+** inputs cycle through the coefficient grid of basicmath_large.
+*/
+
+#define CUBIC_TOL 1e-9
+
+static double now(void)
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void report(const char *name, double ts, double tb, long bad)
+{
+  printf("%-16s scalar %8.4f s   batch %8.4f s   %6.2fx   %s\n",
+         name, ts, tb, tb > 0 ? ts / tb : 0.0, bad ? "MISMATCH" : "ok");
+}
+
+static long check_cubic(size_t n)
+{
+  double *a = malloc(n * sizeof(double)), *b = malloc(n * sizeof(double));
+  double *c = malloc(n * sizeof(double)), *d = malloc(n * sizeof(double));
+  double *xs = malloc(3 * n * sizeof(double));
+  double *x0 = malloc(n * sizeof(double)), *x1 = malloc(n * sizeof(double));
+  double *x2 = malloc(n * sizeof(double));
+  int *ns = malloc(n * sizeof(int)), *nb = malloc(n * sizeof(int));
+  double a1 = 1, b1 = 10, c1 = 5, d1 = -1, t0, ts, tb, err, maxerr = 0;
+  size_t i;
+  long bad = 0;
+  int k;
+
+  if (!a || !b || !c || !d || !xs || !x0 || !x1 || !x2 || !ns || !nb) {
+    fprintf(stderr, "Can't allocate %lu equations\n", (unsigned long)n);
+    exit(1);
+  }
+  for (i = 0; i < n; i++) {
+    a[i] = a1; b[i] = b1; c[i] = c1; d[i] = d1;
+    if ((d1 -= .451) <= -5) {
+      d1 = -1;
+      if ((c1 += 0.61) >= 15) {
+        c1 = 5;
+        if ((b1 -= .25) <= 0) {
+          b1 = 10;
+          if ((a1 += 1) >= 10)
+            a1 = 1;
+        }
+      }
+    }
+  }
+
+  t0 = now();
+  for (i = 0; i < n; i++)
+    SolveCubic(a[i], b[i], c[i], d[i], &ns[i], &xs[3 * i]);
+  ts = now() - t0;
+  t0 = now();
+  SolveCubicBatch(n, a, b, c, d, nb, x0, x1, x2);
+  tb = now() - t0;
+
+  for (i = 0; i < n; i++) {
+    double *x = &xs[3 * i], y[3];
+
+    y[0] = x0[i]; y[1] = x1[i]; y[2] = x2[i];
+    if (ns[i] != nb[i]) {
+      bad++;
+      continue;
+    }
+    for (k = 0; k < ns[i]; k++) {
+      err = fabs(y[k] - x[k]) / (fabs(x[k]) > 1 ? fabs(x[k]) : 1);
+      if (err > maxerr)
+        maxerr = err;
+      if (!(err <= CUBIC_TOL))
+        bad++;
+    }
+  }
+  report("SolveCubic", ts, tb, bad);
+  printf("%-16s max relative root error %.3g\n", "", maxerr);
+
+  free(a); free(b); free(c); free(d); free(xs);
+  free(x0); free(x1); free(x2); free(ns); free(nb);
+  return bad;
+}
+
+static long check_usqrt(size_t n)
+{
+  unsigned long *x = malloc(n * sizeof(unsigned long));
+  struct int_sqrt *qs = malloc(n * sizeof(struct int_sqrt));
+  struct int_sqrt *qb = malloc(n * sizeof(struct int_sqrt));
+  double t0, ts, tb;
+  size_t i;
+  long bad = 0;
+
+  if (!x || !qs || !qb) {
+    fprintf(stderr, "Can't allocate %lu values\n", (unsigned long)n);
+    exit(1);
+  }
+  for (i = 0; i < n; i++)         /* small values, then the full range */
+    x[i] = i < n / 2 ? i : (unsigned long)(i * 2654435761UL) & 0xFFFFFFFFUL;
+  x[0] = 0xFFFFFFFFUL;
+
+  t0 = now();
+  for (i = 0; i < n; i++)
+    usqrt(x[i], &qs[i]);
+  ts = now() - t0;
+  t0 = now();
+  usqrt_batch(n, x, qb);
+  tb = now() - t0;
+
+  /* only .sqrt is compared: usqrt() fills .frac by copying a long */
+
+  for (i = 0; i < n; i++)
+    bad += qs[i].sqrt != qb[i].sqrt;
+  report("usqrt", ts, tb, bad);
+
+  free(x); free(qs); free(qb);
+  return bad;
+}
+
+static long check_angles(size_t n)
+{
+  double *in = malloc(n * sizeof(double)), *outs = malloc(n * sizeof(double));
+  double *outb = malloc(n * sizeof(double));
+  double t0, ts, tb;
+  size_t i;
+  long bad = 0;
+
+  if (!in || !outs || !outb) {
+    fprintf(stderr, "Can't allocate %lu values\n", (unsigned long)n);
+    exit(1);
+  }
+  for (i = 0; i < n; i++)
+    in[i] = i * (360.0 / n);
+
+  t0 = now();
+  for (i = 0; i < n; i++)
+    outs[i] = deg2rad(in[i]);
+  ts = now() - t0;
+  t0 = now();
+  deg2rad_batch(n, in, outb);
+  tb = now() - t0;
+  for (i = 0; i < n; i++)
+    bad += outs[i] != outb[i];
+  report("deg2rad", ts, tb, bad);
+
+  t0 = now();
+  for (i = 0; i < n; i++)
+    in[i] = rad2deg(outs[i]);
+  ts = now() - t0;
+  t0 = now();
+  rad2deg_batch(n, outs, outb);
+  tb = now() - t0;
+  for (i = 0; i < n; i++)
+    bad += in[i] != outb[i];
+  report("rad2deg", ts, tb, bad);
+
+  free(in); free(outs); free(outb);
+  return bad;
+}
+
+int main(int argc, char *argv[])
+{
+  long n = argc > 1 ? atol(argv[1]) : 1000000L;
+  long bad;
+
+  if (n < 1) {
+    fprintf(stderr, "Usage: basicmath_batch [<count>]\n");
+    return 1;
+  }
+  printf("********* BATCH KERNELS (%ld inputs) ***********\n", n);
+  bad  = check_cubic((size_t)n);
+  bad += check_usqrt((size_t)n);
+  bad += check_angles((size_t)n);
+  return bad != 0;
+}
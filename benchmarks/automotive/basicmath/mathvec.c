@@ -0,0 +1,262 @@
+/* +++Date last modified: 18-Oct-2026 */
+
+/*
+**  MATHVEC.C - Array versions of SolveCubic(), usqrt(), deg2rad() and
+**              rad2deg()
+**
+**  The originals take one value per call. These take n values at a
+**  time as structure-of-arrays: one array per coefficient or result.
+**
+**  SolveCubicBatch() works on chunks of CUBIC_CHUNK equations in
+**  three passes:
+**
+**    1. Normalise the coefficients and compute Q, R and the
+**       discriminant R^2 - Q^3. This pass is SIMD, two equations per
+**       SSE2 vector.
+**    2. Sort the equation indices into "three real roots" and "one
+**       real root" lists without branching.
+**    3. Run each list through a straight-line loop that takes no
+**       data-dependent branches.
+**
+**  Intermediates are double rather than long double, and the
+**  three-root case uses one sin/cos pair instead of three cos() calls,
+**  so roots agree with SolveCubic() to rounding, not bit for bit.
+**
+**  usqrt_batch() replaces the 32-step shift-and-subtract loop with a
+**  hardware square root, corrected to the exact integer result. The
+**  angle conversions compute exactly what the scalar functions do.
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "snipmath.h"
+
+#ifdef __SSE2__
+ #include <emmintrin.h>
+#endif
+
+#undef rad2deg                /* These are macros defined in PI.H */
+#undef deg2rad
+
+#define CUBIC_CHUNK 256                   /* equations per pass 1-3   */
+
+#define SQRT3_2 0.86602540378443864676    /* sqrt(3) / 2              */
+
+/*
+**  Pass 1 results for one chunk
+*/
+
+struct cubic_work {
+      double off[CUBIC_CHUNK];            /* a1 / 3                   */
+      double q[CUBIC_CHUNK];              /* Q                        */
+      double t[CUBIC_CHUNK];              /* R / sqrt(Q^3), [-1, 1]   */
+      double u[CUBIC_CHUNK];              /* sqrt(R^2 - Q^3) + |R|    */
+      double sgn[CUBIC_CHUNK];            /* R < 0 ? 1 : -1           */
+      int    three[CUBIC_CHUNK];          /* R^2 - Q^3 <= 0           */
+};
+
+static void cubic_setup(double a, double b, double c, double d,
+                        struct cubic_work *w, int i)
+{
+      double a1 = b/a, a2 = c/a, a3 = d/a;
+      double Q = (a1*a1 - 3.0*a2)/9.0;
+      double R = (2.0*a1*a1*a1 - 9.0*a1*a2 + 27.0*a3)/54.0;
+      double D = R*R - Q*Q*Q;
+      double t = R/sqrt(Q*Q*Q);
+
+      w->off[i]   = a1/3.0;
+      w->q[i]     = Q;
+      w->t[i]     = t > 1.0 ? 1.0 : t < -1.0 ? -1.0 : t;
+      w->u[i]     = sqrt(D) + fabs(R);
+      w->sgn[i]   = R < 0.0 ? 1.0 : -1.0;
+      w->three[i] = D <= 0;
+}
+
+#ifdef __SSE2__
+
+static void cubic_setup2(const double *a, const double *b, const double *c,
+                         const double *d, struct cubic_work *w, int i)
+{
+      const __m128d one = _mm_set1_pd(1.0), mone = _mm_set1_pd(-1.0);
+      const __m128d sign = _mm_set1_pd(-0.0);
+      __m128d va = _mm_loadu_pd(a);
+      __m128d a1 = _mm_div_pd(_mm_loadu_pd(b), va);
+      __m128d a2 = _mm_div_pd(_mm_loadu_pd(c), va);
+      __m128d a3 = _mm_div_pd(_mm_loadu_pd(d), va);
+      __m128d a11 = _mm_mul_pd(a1, a1);
+      __m128d Q = _mm_div_pd(_mm_sub_pd(a11,
+                        _mm_mul_pd(_mm_set1_pd(3.0), a2)), _mm_set1_pd(9.0));
+      __m128d R = _mm_div_pd(_mm_add_pd(_mm_sub_pd(
+                        _mm_mul_pd(_mm_mul_pd(_mm_set1_pd(2.0), a11), a1),
+                        _mm_mul_pd(_mm_mul_pd(_mm_set1_pd(9.0), a1), a2)),
+                        _mm_mul_pd(_mm_set1_pd(27.0), a3)),
+                        _mm_set1_pd(54.0));
+      __m128d Q3 = _mm_mul_pd(_mm_mul_pd(Q, Q), Q);
+      __m128d D = _mm_sub_pd(_mm_mul_pd(R, R), Q3);
+      __m128d t = _mm_div_pd(R, _mm_sqrt_pd(Q3));
+      __m128d neg = _mm_cmplt_pd(R, _mm_setzero_pd());
+
+      _mm_storeu_pd(w->off + i, _mm_div_pd(a1, _mm_set1_pd(3.0)));
+      _mm_storeu_pd(w->q + i, Q);
+      _mm_storeu_pd(w->t + i, _mm_max_pd(_mm_min_pd(t, one), mone));
+      _mm_storeu_pd(w->u + i, _mm_add_pd(_mm_sqrt_pd(D),
+                                         _mm_andnot_pd(sign, R)));
+      _mm_storeu_pd(w->sgn + i, _mm_or_pd(_mm_and_pd(neg, one),
+                                          _mm_andnot_pd(neg, mone)));
+      {
+            int m = _mm_movemask_pd(_mm_cmple_pd(D, _mm_setzero_pd()));
+
+            w->three[i]     = m & 1;
+            w->three[i + 1] = m >> 1;
+      }
+}
+
+#endif /* __SSE2__ */
+
+/*
+**  Solve a[i]x^3 + b[i]x^2 + c[i]x + d[i] = 0 for i = 0..n-1. The
+**  number of real roots goes to solutions[i] and the roots to x0[i],
+**  x1[i] and x2[i]. As with SolveCubic(), x1[i] and x2[i] are left
+**  alone when there is only one real root.
+*/
+
+void SolveCubicBatch(size_t       n,
+                     const double *a,
+                     const double *b,
+                     const double *c,
+                     const double *d,
+                     int          *solutions,
+                     double       *x0,
+                     double       *x1,
+                     double       *x2)
+{
+      struct cubic_work w;
+      int    idx3[CUBIC_CHUNK], idx1[CUBIC_CHUNK];
+      size_t base;
+
+      for (base = 0; base < n; base += CUBIC_CHUNK)
+      {
+            int m = n - base < CUBIC_CHUNK ? (int)(n - base) : CUBIC_CHUNK;
+            int i = 0, k, n3 = 0, n1 = 0;
+
+#ifdef __SSE2__
+            for (; i + 2 <= m; i += 2)
+                  cubic_setup2(a + base + i, b + base + i, c + base + i,
+                               d + base + i, &w, i);
+#endif
+            for (; i < m; i++)
+                  cubic_setup(a[base + i], b[base + i], c[base + i],
+                              d[base + i], &w, i);
+
+            for (i = 0; i < m; i++)
+            {
+                  idx3[n3] = i;
+                  idx1[n1] = i;
+                  n3 += w.three[i];
+                  n1 += !w.three[i];
+            }
+
+            for (k = 0; k < n3; k++)
+            {
+                  size_t j = base + (i = idx3[k]);
+                  double phi = acos(w.t[i]) / 3.0;
+                  double m2 = -2.0 * sqrt(w.q[i]);
+                  double cs = cos(phi), sn = sin(phi);
+
+                  solutions[j] = 3;
+                  x0[j] = m2 * cs - w.off[i];
+                  x1[j] = m2 * (-0.5 * cs - SQRT3_2 * sn) - w.off[i];
+                  x2[j] = m2 * (-0.5 * cs + SQRT3_2 * sn) - w.off[i];
+            }
+
+            for (k = 0; k < n1; k++)
+            {
+                  size_t j = base + (i = idx1[k]);
+                  double y = pow(w.u[i], 1/3.0);
+
+                  solutions[j] = 1;
+                  x0[j] = w.sgn[i] * (y + w.q[i] / y) - w.off[i];
+            }
+      }
+}
+
+/*
+**  usqrt() for n values. usqrt() looks at the low BITSPERLONG (32)
+**  bits of x and returns floor(sqrt(x) * 65536) = isqrt(x << 32).
+**  Since (double)(x << 32) = x * 2^32 exactly, sqrt(x) * 65536 in
+**  double is within one of the answer, and one step each way fixes it.
+*/
+
+static unsigned long isqrt_fix(unsigned long x, double s)
+{
+      uint64_t v = (uint64_t)(x & 0xFFFFFFFFUL) << 32;
+      uint64_t r = s >= 4294967295.0 ? 0xFFFFFFFFULL : (uint64_t)s;
+
+      r -= r * r > v;
+      r += v - r * r > 2 * r;
+      return (unsigned long)r;
+}
+
+void usqrt_batch(size_t n, const unsigned long *x, struct int_sqrt *q)
+{
+      size_t i = 0;
+
+#ifdef __SSE2__
+      const __m128d scale = _mm_set1_pd(65536.0);
+
+      for (; i + 2 <= n; i += 2)
+      {
+            double s[2];
+
+            _mm_storeu_pd(s, _mm_mul_pd(_mm_sqrt_pd(_mm_set_pd(
+                  (double)(x[i + 1] & 0xFFFFFFFFUL),
+                  (double)(x[i]     & 0xFFFFFFFFUL))), scale));
+            q[i].sqrt     = (unsigned)isqrt_fix(x[i],     s[0]);
+            q[i].frac     = 0;
+            q[i + 1].sqrt = (unsigned)isqrt_fix(x[i + 1], s[1]);
+            q[i + 1].frac = 0;
+      }
+#endif
+      for (; i < n; i++)
+      {
+            q[i].sqrt = (unsigned)isqrt_fix(x[i],
+                  sqrt((double)(x[i] & 0xFFFFFFFFUL)) * 65536.0);
+            q[i].frac = 0;
+      }
+}
+
+/*
+**  deg2rad() / rad2deg() for n values. The arithmetic is the same as
+**  in RAD2DEG.C, so results are identical.
+*/
+
+void deg2rad_batch(size_t n, const double *deg, double *rad)
+{
+      size_t i = 0;
+
+#ifdef __SSE2__
+      const __m128d pi = _mm_set1_pd(PI), k = _mm_set1_pd(180.0);
+
+      for (; i + 2 <= n; i += 2)
+            _mm_storeu_pd(rad + i,
+                          _mm_div_pd(_mm_mul_pd(pi, _mm_loadu_pd(deg + i)), k));
+#endif
+      for (; i < n; i++)
+            rad[i] = PI * deg[i] / 180.0;
+}
+
+void rad2deg_batch(size_t n, const double *rad, double *deg)
+{
+      size_t i = 0;
+
+#ifdef __SSE2__
+      const __m128d pi = _mm_set1_pd(PI), k = _mm_set1_pd(180.0);
+
+      for (; i + 2 <= n; i += 2)
+            _mm_storeu_pd(deg + i,
+                          _mm_div_pd(_mm_mul_pd(k, _mm_loadu_pd(rad + i)), pi));
+#endif
+      for (; i < n; i++)
+            deg[i] = 180.0 * rad[i] / (PI);
+}
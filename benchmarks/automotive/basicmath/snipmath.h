@@ -71,5 +71,20 @@ struct int_sqrt {
 
 void usqrt(unsigned long x, struct int_sqrt *q);
 
+/*
+**  File: MATHVEC.C
+*/
+
+void    SolveCubicBatch(size_t n, const double *a,    /* Mathvec.C      */
+                        const double *b, const double *c,
+                        const double *d, int *solutions,
+                        double *x0, double *x1, double *x2);
+void    usqrt_batch(size_t n, const unsigned long *x, /* Mathvec.C      */
+                    struct int_sqrt *q);
+void    deg2rad_batch(size_t n, const double *deg,    /* Mathvec.C      */
+                      double *rad);
+void    rad2deg_batch(size_t n, const double *rad,    /* Mathvec.C      */
+                      double *deg);
+
 
 #endif /* SNIPMATH__H */
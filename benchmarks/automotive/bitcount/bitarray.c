@@ -4,6 +4,7 @@
 **  Functions to maintain an arbitrary length array of bits
 */
 
+#include <string.h>
 #include "bitops.h"
 
 char *alloc_bit_array(size_t bits)
@@ -32,3 +33,145 @@ void flipbit(char *set, int number)
         set += number / CHAR_BIT;
         *set ^= 1 << (number % CHAR_BIT);                   /* flip bit */
 }
+
+/*
+**  Word-at-a-time bulk operations on bit ranges. Bits are numbered as
+**  in getbit(), so a partial byte at either end of the range is
+**  masked and whole bytes in between are handled as longs.
+*/
+
+static unsigned char lo_mask(size_t bit)        /* bits [bit, CHAR_BIT) */
+{
+        return (unsigned char)(0xFF << bit);
+}
+
+static unsigned char hi_mask(size_t bit)        /* bits [0, bit)        */
+{
+        return (unsigned char)((1 << bit) - 1);
+}
+
+size_t count_bits(const char *set, size_t first, size_t nbits)
+{
+        const unsigned char *p = (const unsigned char *)set + first / CHAR_BIT;
+        size_t lo = first % CHAR_BIT, n;
+        unsigned char b;
+
+        if (0 == nbits)
+                return 0;
+        if (lo + nbits <= CHAR_BIT)
+        {
+                b = *p & lo_mask(lo) & (unsigned char)(0xFF >> (CHAR_BIT - lo - nbits));
+                return bulk_bitcount(&b, 1);
+        }
+        n = 0;
+        if (lo)
+        {
+                b = *p++ & lo_mask(lo);
+                n += bulk_bitcount(&b, 1);
+                nbits -= CHAR_BIT - lo;
+        }
+        n += bulk_bitcount(p, nbits / CHAR_BIT);
+        p += nbits / CHAR_BIT;
+        if (nbits % CHAR_BIT)
+        {
+                b = *p & hi_mask(nbits % CHAR_BIT);
+                n += bulk_bitcount(&b, 1);
+        }
+        return n;
+}
+
+/*
+**  Apply op (0 = clear, 1 = set, 2 = flip) to bits [first, first+nbits)
+*/
+
+static void apply_bits(char *set, size_t first, size_t nbits, int op)
+{
+        unsigned char *p = (unsigned char *)set + first / CHAR_BIT, m;
+        size_t lo = first % CHAR_BIT, whole;
+        unsigned long w;
+
+        if (0 == nbits)
+                return;
+
+        if (lo)                                     /* leading partial byte */
+        {
+                m = lo_mask(lo);
+                if (lo + nbits < CHAR_BIT)
+                        m &= hi_mask(lo + nbits);
+                switch (op)
+                {
+                case 0: *p &= ~m; break;
+                case 1: *p |=  m; break;
+                default: *p ^= m; break;
+                }
+                if (lo + nbits <= CHAR_BIT)
+                        return;
+                nbits -= CHAR_BIT - lo;
+                p++;
+        }
+
+        whole = nbits / CHAR_BIT;
+        if (op < 2)
+                memset(p, op ? 0xFF : 0, whole);
+        else
+        {
+                size_t i = 0;
+
+                for (; i + sizeof(w) <= whole; i += sizeof(w))
+                {
+                        memcpy(&w, p + i, sizeof(w));
+                        w = ~w;
+                        memcpy(p + i, &w, sizeof(w));
+                }
+                for (; i < whole; i++)
+                        p[i] = ~p[i];
+        }
+        p += whole;
+
+        if (nbits % CHAR_BIT)                       /* trailing partial byte */
+        {
+                m = hi_mask(nbits % CHAR_BIT);
+                switch (op)
+                {
+                case 0: *p &= ~m; break;
+                case 1: *p |=  m; break;
+                default: *p ^= m; break;
+                }
+        }
+}
+
+void setbits(char *set, size_t first, size_t nbits, int value)
+{
+        apply_bits(set, first, nbits, value ? 1 : 0);
+}
+
+void flipbits(char *set, size_t first, size_t nbits)
+{
+        apply_bits(set, first, nbits, 2);
+}
+
+/*
+**  dst = dst OP src over whole arrays of the given size in bits.
+**  Bits past the end in the last byte are combined too.
+*/
+
+#define BIT_ARRAY_OP(name, OP)                                          \
+void name(char *dst, const char *src, size_t bits)                      \
+{                                                                       \
+        size_t bytes = (bits + CHAR_BIT - 1) / CHAR_BIT, i = 0;         \
+        unsigned long a, b;                                             \
+                                                                        \
+        for (; i + sizeof(a) <= bytes; i += sizeof(a))                  \
+        {                                                               \
+                memcpy(&a, dst + i, sizeof(a));                         \
+                memcpy(&b, src + i, sizeof(b));                         \
+                a = a OP b;                                             \
+                memcpy(dst + i, &a, sizeof(a));                         \
+        }                                                               \
+        for (; i < bytes; i++)                                          \
+                dst[i] = dst[i] OP src[i];                              \
+}
+
+BIT_ARRAY_OP(and_bit_array, &)
+BIT_ARRAY_OP(or_bit_array,  |)
+BIT_ARRAY_OP(xor_bit_array, ^)
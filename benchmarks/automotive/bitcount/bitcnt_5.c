@@ -0,0 +1,266 @@
+/* +++Date last modified: 18-Oct-2026 */
+
+/*
+**  BITCNT_5.C - Bulk bit counting over arrays and bitmaps
+**
+**  Unlike the other counters, which take one long at a time, these
+**  count every set bit in a buffer of arbitrary length and alignment.
+**
+**    bulk_bitcount_swar()    Portable 64-bit SWAR (any compiler)
+**    bulk_bitcount_popcnt()  Hardware POPCNT, 4 words per step
+**    bulk_bitcount_avx2()    AVX2 nybble table lookup (W. Mula)
+**    bulk_bitcount_hs()      AVX2 Harley-Seal carry-save adder tree
+**
+**  bulk_bitcount() picks the fastest kernel the CPU supports the
+**  first time it is called. The x86 kernels are only built with GNU C
+**  compatible compilers (target attributes and __builtin_cpu_supports)
+**  and otherwise fall back to the SWAR kernel.
+*/
+
+#include <string.h>
+#include <stdint.h>
+#include "bitops.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+ #define BULK_X86 1
+ #include <immintrin.h>
+#endif
+
+static uint64_t load64(const unsigned char *p)
+{
+      uint64_t w;
+
+      memcpy(&w, p, sizeof(w));                 /* may be unaligned  */
+      return w;
+}
+
+/*
+**  Count bits in the bytes left over by a wide kernel
+*/
+
+static size_t tail_bitcount(const unsigned char *p, size_t bytes)
+{
+      size_t n = 0;
+
+      while (bytes--)
+      {
+            unsigned x = *p++;
+
+            x = x - ((x >> 1) & 0x55);
+            x = (x & 0x33) + ((x >> 2) & 0x33);
+            n += (x + (x >> 4)) & 0x0F;
+      }
+      return n;
+}
+
+/*
+**  Portable SWAR: sum nybble counts of 8 bytes in parallel, then
+**  fold with one multiply.
+*/
+
+static uint64_t swar64(uint64_t x)
+{
+      x = x - ((x >> 1) & 0x5555555555555555ULL);
+      x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+      x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+      return (x * 0x0101010101010101ULL) >> 56;
+}
+
+size_t CDECL bulk_bitcount_swar(const void *buf, size_t bytes)
+{
+      const unsigned char *p = buf;
+      size_t n = 0;
+
+      for (; bytes >= 32; bytes -= 32, p += 32)
+            n += swar64(load64(p))      + swar64(load64(p + 8))
+               + swar64(load64(p + 16)) + swar64(load64(p + 24));
+      for (; bytes >= 8; bytes -= 8, p += 8)
+            n += swar64(load64(p));
+      return n + tail_bitcount(p, bytes);
+}
+
+#ifdef BULK_X86
+
+/*
+**  Hardware POPCNT. Four independent accumulators keep the popcnt
+**  unit busy instead of serialising on one add chain.
+*/
+
+__attribute__((target("popcnt")))
+size_t CDECL bulk_bitcount_popcnt(const void *buf, size_t bytes)
+{
+      const unsigned char *p = buf;
+      uint64_t n0 = 0, n1 = 0, n2 = 0, n3 = 0;
+
+      for (; bytes >= 32; bytes -= 32, p += 32)
+      {
+            n0 += __builtin_popcountll(load64(p));
+            n1 += __builtin_popcountll(load64(p + 8));
+            n2 += __builtin_popcountll(load64(p + 16));
+            n3 += __builtin_popcountll(load64(p + 24));
+      }
+      for (; bytes >= 8; bytes -= 8, p += 8)
+            n0 += __builtin_popcountll(load64(p));
+      return (size_t)(n0 + n1 + n2 + n3) + tail_bitcount(p, bytes);
+}
+
+/*
+**  Per-byte counts of a 256-bit vector via two PSHUFB lookups into a
+**  16-entry nybble table.
+*/
+
+__attribute__((target("avx2")))
+static __m256i popcount_bytes256(__m256i v)
+{
+      const __m256i table = _mm256_setr_epi8(
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+      const __m256i low = _mm256_set1_epi8(0x0F);
+      __m256i lo = _mm256_and_si256(v, low);
+      __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+
+      return _mm256_add_epi8(_mm256_shuffle_epi8(table, lo),
+                             _mm256_shuffle_epi8(table, hi));
+}
+
+__attribute__((target("avx2")))
+static size_t hsum256(__m256i acc)
+{
+      return (size_t)(_mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1)
+                    + _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3));
+}
+
+/*
+**  AVX2 nybble lookup (Mula). Byte counts are accumulated for up to
+**  31 vectors (31 * 8 < 256) before being widened with PSADBW.
+*/
+
+__attribute__((target("avx2")))
+size_t CDECL bulk_bitcount_avx2(const void *buf, size_t bytes)
+{
+      const unsigned char *p = buf;
+      __m256i acc = _mm256_setzero_si256();
+
+      while (bytes >= 32)
+      {
+            __m256i local = _mm256_setzero_si256();
+            int i;
+
+            for (i = 0; i < 31 && bytes >= 32; i++, bytes -= 32, p += 32)
+                  local = _mm256_add_epi8(local, popcount_bytes256(
+                        _mm256_loadu_si256((const __m256i *)p)));
+            acc = _mm256_add_epi64(acc,
+                  _mm256_sad_epu8(local, _mm256_setzero_si256()));
+      }
+      return hsum256(acc) + bulk_bitcount_swar(p, bytes);
+}
+
+/*
+**  Carry-save adder: h:l = a + b + c, bitwise
+*/
+
+#define CSA(h, l, a, b, c)                                           \
+      do {                                                            \
+            __m256i u_ = _mm256_xor_si256(a, b);                      \
+            h = _mm256_or_si256(_mm256_and_si256(a, b),               \
+                                _mm256_and_si256(u_, c));             \
+            l = _mm256_xor_si256(u_, c);                              \
+      } while (0)
+
+__attribute__((target("avx2")))
+static __m256i popcount256(__m256i v)
+{
+      return _mm256_sad_epu8(popcount_bytes256(v), _mm256_setzero_si256());
+}
+
+/*
+**  AVX2 Harley-Seal (Mula, Kurz & Lemire). 16 vectors are reduced
+**  through a CSA tree so only one vector popcount is needed per 512
+**  bytes; the ones/twos/fours/eights residues are counted at the end.
+*/
+
+__attribute__((target("avx2")))
+size_t CDECL bulk_bitcount_hs(const void *buf, size_t bytes)
+{
+      const __m256i *v = buf;
+      size_t blocks = bytes / 32, i = 0;
+      __m256i total = _mm256_setzero_si256();
+      __m256i ones = _mm256_setzero_si256(), twos = ones,
+              fours = ones, eights = ones, sixteens;
+      __m256i twosA, twosB, foursA, foursB, eightsA, eightsB;
+
+#define LD(k) _mm256_loadu_si256(v + i + (k))
+
+      for (; i + 16 <= blocks; i += 16)
+      {
+            CSA(twosA, ones, ones, LD(0), LD(1));
+            CSA(twosB, ones, ones, LD(2), LD(3));
+            CSA(foursA, twos, twos, twosA, twosB);
+            CSA(twosA, ones, ones, LD(4), LD(5));
+            CSA(twosB, ones, ones, LD(6), LD(7));
+            CSA(foursB, twos, twos, twosA, twosB);
+            CSA(eightsA, fours, fours, foursA, foursB);
+            CSA(twosA, ones, ones, LD(8), LD(9));
+            CSA(twosB, ones, ones, LD(10), LD(11));
+            CSA(foursA, twos, twos, twosA, twosB);
+            CSA(twosA, ones, ones, LD(12), LD(13));
+            CSA(twosB, ones, ones, LD(14), LD(15));
+            CSA(foursB, twos, twos, twosA, twosB);
+            CSA(eightsB, fours, fours, foursA, foursB);
+            CSA(sixteens, eights, eights, eightsA, eightsB);
+            total = _mm256_add_epi64(total, popcount256(sixteens));
+      }
+
+#undef LD
+
+      total = _mm256_slli_epi64(total, 4);
+      total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(eights), 3));
+      total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(fours), 2));
+      total = _mm256_add_epi64(total, _mm256_slli_epi64(popcount256(twos), 1));
+      total = _mm256_add_epi64(total, popcount256(ones));
+
+      return hsum256(total) + bulk_bitcount_avx2((const unsigned char *)buf + i * 32,
+                                                 bytes - i * 32);
+}
+
+#endif /* BULK_X86 */
+
+/*
+**  Kernel table and runtime dispatch
+*/
+
+bulk_bitcount_fn bulk_bitcount_kernel(int kind)
+{
+      switch (kind)
+      {
+      case BULK_SWAR:
+            return bulk_bitcount_swar;
+#ifdef BULK_X86
+      case BULK_POPCNT:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("popcnt") ? bulk_bitcount_popcnt : NULL;
+      case BULK_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? bulk_bitcount_avx2 : NULL;
+      case BULK_HARLEY_SEAL:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? bulk_bitcount_hs : NULL;
+#endif
+      default:
+            return NULL;
+      }
+}
+
+static bulk_bitcount_fn best_kernel = NULL;
+
+size_t CDECL bulk_bitcount(const void *buf, size_t bytes)
+{
+      if (NULL == best_kernel)
+      {
+            int kind;
+
+            for (kind = BULK_KERNELS - 1; NULL == best_kernel; kind--)
+                  best_kernel = bulk_bitcount_kernel(kind);
+      }
+      return best_kernel(buf, bytes);
+}
@@ -52,6 +52,12 @@ char *alloc_bit_array(size_t bits);
 int   getbit(char *set, int number);
 void  setbit(char *set, int number, int value);
 void  flipbit(char *set, int number);
+size_t count_bits(const char *set, size_t first, size_t nbits);
+void  setbits(char *set, size_t first, size_t nbits, int value);
+void  flipbits(char *set, size_t first, size_t nbits);
+void  and_bit_array(char *dst, const char *src, size_t bits);
+void  or_bit_array(char *dst, const char *src, size_t bits);
+void  xor_bit_array(char *dst, const char *src, size_t bits);
 
 /*
 **  BITFILES.C
@@ -109,4 +115,23 @@ int CDECL AR_btbl_bitcount(long int x);
 int CDECL ntbl_bitcnt(long x);
 int CDECL btbl_bitcnt(long x);
 
+/*
+**  BITCNT_5.C
+*/
+
+#define BULK_SWAR         0                     /* Portable SWAR        */
+#define BULK_POPCNT       1                     /* Hardware POPCNT      */
+#define BULK_AVX2         2                     /* AVX2 nybble LUT      */
+#define BULK_HARLEY_SEAL  3                     /* AVX2 Harley-Seal     */
+#define BULK_KERNELS      4
+
+typedef size_t (CDECL *bulk_bitcount_fn)(const void *buf, size_t bytes);
+
+size_t CDECL bulk_bitcount(const void *buf, size_t bytes);
+size_t CDECL bulk_bitcount_swar(const void *buf, size_t bytes);
+size_t CDECL bulk_bitcount_popcnt(const void *buf, size_t bytes);
+size_t CDECL bulk_bitcount_avx2(const void *buf, size_t bytes);
+size_t CDECL bulk_bitcount_hs(const void *buf, size_t bytes);
+bulk_bitcount_fn bulk_bitcount_kernel(int kind);   /* NULL if unsupported */
+
 #endif /*  BITOPS__H */
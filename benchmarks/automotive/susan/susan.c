@@ -303,6 +303,10 @@ typedef float      TOTAL_TYPE; /* for my PowerPC accelerator only */
 #include <math.h>
 #include <sys/file.h>    /* may want to remove this line */
 #include <malloc.h>      /* may want to remove this line */
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 #define  exit_error(IFB,IFC) { fprintf(stderr,IFB,IFC); exit(0); }
 #define  FTOI(a) ( (a) < 0 ? ((int)(a-0.5)) : ((int)(a+0.5)) )
 typedef  unsigned char uchar;
@@ -327,6 +331,8 @@ usage()
   printf("-q : Use faster (and usually stabler) corner mode; edge-like corner suppression not carried out; corners mode\n");
   printf("-b : Mark corners/edges with single black points instead of black with white border; corners or edges mode\n");
   printf("-p : Output initial enhancement image only; corners or edges mode (default is edges mode)\n");
+  printf("-v : Video stream mode; <in> and <out> are \"-\" (stdin/stdout), a file of concatenated\n");
+  printf("     PGM/PPM frames or a directory of frames; reports sustained frames/s\n");
 
   printf("\nSUSAN Version 2l (C) 1995-1997 Stephen Smith, DRA UK. steve@fmrib.ox.ac.uk\n");
 
@@ -667,31 +673,79 @@ int   i, j;
   *in=tmp_image;      /* repoint in */
 }
 
+/* }}} */
+/* {{{ setup_distance_lut(dp,dt,mask_size) */
+
+/* fills the (2*mask_size+1)^2 Gaussian distance mask used by smoothing */
+
+void setup_distance_lut(dp,dt,mask_size)
+  uchar *dp;
+  float dt;
+  int   mask_size;
+{
+float temp;
+int   i, j, x;
+
+  temp = -(dt*dt);
+
+  for(i=-mask_size; i<=mask_size; i++)
+    for(j=-mask_size; j<=mask_size; j++)
+    {
+      x = (int) (100.0 * exp( ((float)((i*i)+(j*j))) / temp ));
+      *dp++ = (unsigned char)x;
+    }
+}
+
+/* }}} */
+/* {{{ int smoothing_mask_size(three_by_three,dt) */
+
+int smoothing_mask_size(three_by_three,dt)
+  int   three_by_three;
+  float dt;
+{
+  if (three_by_three==0)
+    return ((int)(1.5 * dt)) + 1;
+  else
+    return 1;
+}
+
 /* }}} */
 /* {{{ void susan_smoothing(three_by_three,in,dt,x_size,y_size,bp) */
 
+void susan_smoothing_buf();
+
 void susan_smoothing(three_by_three,in,dt,x_size,y_size,bp)
   int   three_by_three, x_size, y_size;
   uchar *in, *bp;
   float dt;
+{
+  susan_smoothing_buf(three_by_three,in,dt,x_size,y_size,bp,NULL,NULL);
+}
+
+/* }}} */
+/* {{{ void susan_smoothing_buf(three_by_three,in,dt,x_size,y_size,bp,tmp_image,dp) */
+
+/* tmp_image and dp may be supplied by the caller (dp already filled
+   by setup_distance_lut) so that they can be reused between frames;
+   if NULL they are malloced here */
+
+void susan_smoothing_buf(three_by_three,in,dt,x_size,y_size,bp,tmp_image,dp)
+  int   three_by_three, x_size, y_size;
+  uchar *in, *bp, *tmp_image, *dp;
+  float dt;
 {
 /* {{{ vars */
 
-float temp;
 int   n_max, increment, mask_size,
       i,j,x,y,area,brightness,tmp,centre;
-uchar *ip, *dp, *dpt, *cp, *out=in,
-      *tmp_image;
+uchar *ip, *dpt, *cp, *out=in;
 TOTAL_TYPE total;
 
 /* }}} */
 
   /* {{{ setup larger image and border sizes */
 
-  if (three_by_three==0)
-    mask_size = ((int)(1.5 * dt)) + 1;
-  else
-    mask_size = 1;
+  mask_size = smoothing_mask_size(three_by_three,dt);
 
   total=0.1; /* test for total's type */
   if ( (dt>15) && (total==0) )
@@ -708,7 +762,8 @@ TOTAL_TYPE total;
     exit(0);
   }
 
-  tmp_image = (uchar *) malloc( (x_size+mask_size*2) * (y_size+mask_size*2) );
+  if (tmp_image==NULL)
+    tmp_image = (uchar *) malloc( (x_size+mask_size*2) * (y_size+mask_size*2) );
   enlarge(&in,tmp_image,&x_size,&y_size,mask_size);
 
 /* }}} */
@@ -721,16 +776,11 @@ TOTAL_TYPE total;
 
   increment = x_size - n_max;
 
-  dp     = (unsigned char *)malloc(n_max*n_max);
-  dpt    = dp;
-  temp   = -(dt*dt);
-
-  for(i=-mask_size; i<=mask_size; i++)
-    for(j=-mask_size; j<=mask_size; j++)
-    {
-      x = (int) (100.0 * exp( ((float)((i*i)+(j*j))) / temp ));
-      *dpt++ = (unsigned char)x;
-    }
+  if (dp==NULL)
+  {
+    dp = (unsigned char *)malloc(n_max*n_max);
+    setup_distance_lut(dp,dt,mask_size);
+  }
 
 /* }}} */
     /* {{{ main section */
@@ -1461,21 +1511,42 @@ int   n=0;
 /* }}} */
 /* {{{ susan(in,r,sf,max_no,corner_list) */
 
+susan_corners_buf();
+
 susan_corners(in,r,bp,max_no,corner_list,x_size,y_size)
   uchar       *in, *bp;
   int         *r, max_no, x_size, y_size;
   CORNER_LIST corner_list;
 {
+int   *cgx,*cgy;
+
+  cgx=(int *)malloc(x_size*y_size*sizeof(int));
+  cgy=(int *)malloc(x_size*y_size*sizeof(int));
+
+  susan_corners_buf(in,r,bp,max_no,corner_list,x_size,y_size,cgx,cgy);
+
+  free(cgx);
+  free(cgy);
+}
+
+/* }}} */
+/* {{{ susan_buf(in,r,sf,max_no,corner_list,cgx,cgy) */
+
+/* as susan_corners, but with the centre of gravity images cgx and cgy
+   (each x_size*y_size ints) supplied by the caller */
+
+susan_corners_buf(in,r,bp,max_no,corner_list,x_size,y_size,cgx,cgy)
+  uchar       *in, *bp;
+  int         *r, max_no, x_size, y_size, *cgx, *cgy;
+  CORNER_LIST corner_list;
+{
 int   n,x,y,sq,xx,yy,
-      i,j,*cgx,*cgy;
+      i,j;
 float divide;
 uchar c,*p,*cp;
 
   memset (r,0,x_size * y_size * sizeof(int));
 
-  cgx=(int *)malloc(x_size*y_size*sizeof(int));
-  cgy=(int *)malloc(x_size*y_size*sizeof(int));
-
   for (i=5;i<y_size-5;i++)
     for (j=5;j<x_size-5;j++) {
         n=100;
@@ -1735,10 +1806,6 @@ if(n==MAX_CORNERS){
       exit(1);
          }}}}
 corner_list[n].info=7;
-
-free(cgx);
-free(cgy);
-
 }
 
 /* }}} */
@@ -1956,6 +2023,481 @@ corner_list[n].info=7;
 
 /* }}} */
 
+/* }}} */
+/* {{{ streaming frames */
+
+/**********************************************************************\
+
+  STREAMING (VIDEO) MODE: -v
+
+  <in> is either "-" (stdin), a file holding concatenated binary
+  PGM (P5) or PPM (P6) frames, or a directory of such files (read in
+  name order). <out> is either "-" (stdout), a file which receives
+  the concatenated PGM output frames, or a directory which receives
+  one frameNNNNNN.pgm per frame. PPM frames are converted to grey
+  on input.
+
+  Reading, SUSAN processing and writing run on three threads which
+  hand frames over through a ring of STREAM_SLOTS slots. The
+  brightness LUT, distance LUT and all working images (r, mid,
+  tmp_image, cgx, cgy, corner list) are allocated once and only
+  grown when a larger frame arrives.
+
+\**********************************************************************/
+
+#define STREAM_SLOTS 4
+
+typedef struct {
+  int   mode, principle, thin_post_proc, three_by_three,
+        drawing_mode, susan_quick, max_no_corners, max_no_edges, bt;
+  float dt;
+} SUSAN_PARAMS;
+
+typedef struct {
+  uchar *in, *rgb;
+  int   in_alloc, rgb_alloc, x_size, y_size;
+} FRAME_SLOT;
+
+typedef struct {
+  int   *r, *cgx, *cgy, size;
+  uchar *mid, *tmp_image, *dp, *bp;
+  int   tmp_size, mask_size;
+  CORNER_LIST *corner_list;
+} SUSAN_WORK;
+
+typedef struct {
+  FRAME_SLOT      slot[STREAM_SLOTS];
+  int             n_read, n_done, n_written, eof;
+  pthread_mutex_t lock;
+  pthread_cond_t  cond;
+  FILE            *ifp, *ofp;
+  char            *idir, *odir, **names;
+  int             n_names;
+} FRAME_STREAM;
+
+/* {{{ int cmp_names(a,b) */
+
+int cmp_names(a,b)
+  const void *a, *b;
+{
+  return strcmp(*(char **)a,*(char **)b);
+}
+
+/* }}} */
+/* {{{ list_frame_dir(fs) */
+
+list_frame_dir(fs)
+  FRAME_STREAM *fs;
+{
+DIR           *dir;
+struct dirent *de;
+char          *ext;
+int           max_names=64;
+
+  if ((dir=opendir(fs->idir)) == NULL)
+    exit_error("Can't open frame directory %s.\n",fs->idir);
+
+  fs->names = (char **) malloc(max_names * sizeof(char *));
+  fs->n_names = 0;
+
+  while ((de=readdir(dir)) != NULL)
+  {
+    ext = strrchr(de->d_name,'.');
+    if ( (ext==NULL) || ((strcmp(ext,".pgm")!=0) && (strcmp(ext,".ppm")!=0)) )
+      continue;
+    if (fs->n_names == max_names)
+    {
+      max_names *= 2;
+      fs->names = (char **) realloc(fs->names, max_names * sizeof(char *));
+    }
+    fs->names[fs->n_names] = (char *) malloc(strlen(fs->idir)+strlen(de->d_name)+2);
+    sprintf(fs->names[fs->n_names],"%s/%s",fs->idir,de->d_name);
+    fs->n_names++;
+  }
+  closedir(dir);
+
+  qsort(fs->names,fs->n_names,sizeof(char *),cmp_names);
+}
+
+/* }}} */
+/* {{{ int read_frame(fd,slot,first) */
+
+/* reads the next P5/P6 frame from fd into slot, growing its buffers
+   only when needed; returns 0 at a clean end of stream. Anything
+   which is not a frame header after the first frame of a file is
+   taken as trailing junk and ends that file (input_small.pgm has
+   some) */
+
+int read_frame(fd,slot,first)
+  FILE       *fd;
+  FRAME_SLOT *slot;
+  int        first;
+{
+int   c, kind, size, i;
+uchar *p, *q;
+
+  do
+    c = getc(fd);
+  while ( (c==' ') || (c=='\t') || (c=='\n') || (c=='\r') );
+
+  if (c==EOF)
+    return 0;
+
+  kind = getc(fd);
+  if ( (!first) && ((c!='P') || ((kind!='5') && (kind!='6'))) )
+  {
+    fprintf(stderr,"Ignoring trailing data after frame.\n");
+    return 0;
+  }
+  if ( (c!='P') || ((kind!='5') && (kind!='6')) )
+    exit_error("Frame %s does not have binary PGM/PPM header.\n","in stream");
+
+  slot->x_size = getint(fd);
+  slot->y_size = getint(fd);
+  getint(fd);
+  size = slot->x_size * slot->y_size;
+
+  if (size > slot->in_alloc)
+  {
+    free(slot->in);
+    slot->in = (uchar *) malloc(size);
+    slot->in_alloc = size;
+  }
+
+  if (kind=='5')
+  {
+    if (fread(slot->in,1,size,fd) != size)
+      exit_error("Frame %s is wrong size.\n","in stream");
+  }
+  else
+  {
+    if (3*size > slot->rgb_alloc)
+    {
+      free(slot->rgb);
+      slot->rgb = (uchar *) malloc(3*size);
+      slot->rgb_alloc = 3*size;
+    }
+    if (fread(slot->rgb,1,3*size,fd) != 3*size)
+      exit_error("Frame %s is wrong size.\n","in stream");
+    p = slot->rgb;
+    q = slot->in;
+    for (i=0; i<size; i++, p+=3)
+      *q++ = (uchar)((77*p[0] + 150*p[1] + 29*p[2]) >> 8);
+  }
+
+  return 1;
+}
+
+/* }}} */
+/* {{{ void *stream_reader(arg) */
+
+void *stream_reader(arg)
+  void *arg;
+{
+FRAME_STREAM *fs = (FRAME_STREAM *) arg;
+FRAME_SLOT   *slot;
+FILE         *fd = fs->ifp;
+int          file_no = 0, got, first = 1;
+
+  while (1)
+  {
+    pthread_mutex_lock(&fs->lock);
+    while (fs->n_read - fs->n_written >= STREAM_SLOTS)
+      pthread_cond_wait(&fs->cond,&fs->lock);
+    slot = &fs->slot[fs->n_read % STREAM_SLOTS];
+    pthread_mutex_unlock(&fs->lock);
+
+    got = 0;
+    while (!got)
+    {
+      if (fd==NULL)
+      {
+        if (file_no == fs->n_names)
+          break;
+        if ((fd=fopen(fs->names[file_no++],"rb")) == NULL)
+          exit_error("Can't input image %s.\n",fs->names[file_no-1]);
+        first = 1;
+      }
+      got = read_frame(fd,slot,first);
+      first = 0;
+      if ( (!got) && (fs->idir!=NULL) )
+      {
+        fclose(fd);
+        fd = NULL;
+      }
+      else if (!got)
+        break;
+    }
+
+    pthread_mutex_lock(&fs->lock);
+    if (got)
+      fs->n_read++;
+    else
+      fs->eof = 1;
+    pthread_cond_broadcast(&fs->cond);
+    pthread_mutex_unlock(&fs->lock);
+
+    if (!got)
+      return NULL;
+  }
+}
+
+/* }}} */
+/* {{{ void *stream_writer(arg) */
+
+void *stream_writer(arg)
+  void *arg;
+{
+FRAME_STREAM *fs = (FRAME_STREAM *) arg;
+FRAME_SLOT   *slot;
+FILE         *fd;
+char         filename [4096];
+
+  while (1)
+  {
+    pthread_mutex_lock(&fs->lock);
+    while ( (fs->n_written == fs->n_done) && !(fs->eof && fs->n_done == fs->n_read) )
+      pthread_cond_wait(&fs->cond,&fs->lock);
+    if (fs->n_written == fs->n_done)
+    {
+      pthread_mutex_unlock(&fs->lock);
+      return NULL;
+    }
+    slot = &fs->slot[fs->n_written % STREAM_SLOTS];
+    pthread_mutex_unlock(&fs->lock);
+
+    if (fs->odir != NULL)
+    {
+      sprintf(filename,"%s/frame%06d.pgm",fs->odir,fs->n_written);
+      if ((fd=fopen(filename,"wb")) == NULL)
+        exit_error("Can't output image %s.\n",filename);
+    }
+    else
+      fd = fs->ofp;
+
+    fprintf(fd,"P5\n%d %d\n255\n",slot->x_size,slot->y_size);
+    if (fwrite(slot->in,slot->x_size*slot->y_size,1,fd) != 1)
+      exit_error("Can't write image %s.\n","to stream");
+
+    if (fs->odir != NULL)
+      fclose(fd);
+
+    pthread_mutex_lock(&fs->lock);
+    fs->n_written++;
+    pthread_cond_broadcast(&fs->cond);
+    pthread_mutex_unlock(&fs->lock);
+  }
+}
+
+/* }}} */
+/* {{{ work_reserve(w,p,x_size,y_size) */
+
+/* makes sure the working images are big enough for an x_size*y_size frame */
+
+work_reserve(w,p,x_size,y_size)
+  SUSAN_WORK   *w;
+  SUSAN_PARAMS *p;
+  int          x_size, y_size;
+{
+int size = x_size * y_size,
+    tmp_size;
+
+  if (size > w->size)
+  {
+    free(w->r); free(w->cgx); free(w->cgy); free(w->mid);
+    w->r   = (int *) malloc(size * sizeof(int));
+    w->mid = (uchar *) malloc(size);
+    if ( (p->mode==2) && !p->principle && !p->susan_quick )
+    {
+      w->cgx = (int *) malloc(size * sizeof(int));
+      w->cgy = (int *) malloc(size * sizeof(int));
+    }
+    else
+      w->cgx = w->cgy = NULL;
+    w->size = size;
+  }
+
+  if (p->mode==0)
+  {
+    tmp_size = (x_size+w->mask_size*2) * (y_size+w->mask_size*2);
+    if (tmp_size > w->tmp_size)
+    {
+      free(w->tmp_image);
+      w->tmp_image = (uchar *) malloc(tmp_size);
+      w->tmp_size = tmp_size;
+    }
+  }
+}
+
+/* }}} */
+/* {{{ process_frame(p,w,in,x_size,y_size) */
+
+/* the body of main()'s processing switch, on preallocated buffers */
+
+process_frame(p,w,in,x_size,y_size)
+  SUSAN_PARAMS *p;
+  SUSAN_WORK   *w;
+  uchar        *in;
+  int          x_size, y_size;
+{
+  work_reserve(w,p,x_size,y_size);
+
+  switch (p->mode)
+  {
+    case 0:
+      susan_smoothing_buf(p->three_by_three,in,p->dt,x_size,y_size,w->bp,w->tmp_image,w->dp);
+      break;
+    case 1:
+      if (p->principle)
+      {
+        if (p->three_by_three)
+          susan_principle_small(in,w->r,w->bp,p->max_no_edges,x_size,y_size);
+        else
+          susan_principle(in,w->r,w->bp,p->max_no_edges,x_size,y_size);
+        int_to_uchar(w->r,in,x_size*y_size);
+      }
+      else
+      {
+        memset (w->mid,100,x_size * y_size); /* note not set to zero */
+
+        if (p->three_by_three)
+          susan_edges_small(in,w->r,w->mid,w->bp,p->max_no_edges,x_size,y_size);
+        else
+          susan_edges(in,w->r,w->mid,w->bp,p->max_no_edges,x_size,y_size);
+        if(p->thin_post_proc)
+          susan_thin(w->r,w->mid,x_size,y_size);
+        edge_draw(in,w->mid,x_size,y_size,p->drawing_mode);
+      }
+      break;
+    case 2:
+      if (p->principle)
+      {
+        susan_principle(in,w->r,w->bp,p->max_no_corners,x_size,y_size);
+        int_to_uchar(w->r,in,x_size*y_size);
+      }
+      else
+      {
+        if(p->susan_quick)
+          susan_corners_quick(in,w->r,w->bp,p->max_no_corners,*w->corner_list,x_size,y_size);
+        else
+          susan_corners_buf(in,w->r,w->bp,p->max_no_corners,*w->corner_list,x_size,y_size,w->cgx,w->cgy);
+        corner_draw(in,*w->corner_list,x_size,p->drawing_mode);
+      }
+      break;
+  }
+}
+
+/* }}} */
+/* {{{ susan_stream(p,in_name,out_name) */
+
+susan_stream(p,in_name,out_name)
+  SUSAN_PARAMS *p;
+  char         *in_name, *out_name;
+{
+FRAME_STREAM   fs;
+SUSAN_WORK     w;
+FRAME_SLOT     *slot;
+pthread_t      reader, writer;
+struct stat    st;
+struct timeval t0, t1;
+double         secs;
+int            n_max;
+
+  memset(&fs,0,sizeof(fs));
+  memset(&w,0,sizeof(w));
+  pthread_mutex_init(&fs.lock,NULL);
+  pthread_cond_init(&fs.cond,NULL);
+
+  /* {{{ open input and output */
+
+  if (strcmp(in_name,"-")==0)
+    fs.ifp = stdin;
+  else if ( (stat(in_name,&st)==0) && S_ISDIR(st.st_mode) )
+  {
+    fs.idir = in_name;
+    list_frame_dir(&fs);
+  }
+  else if ((fs.ifp=fopen(in_name,"rb")) == NULL)
+    exit_error("Can't input image %s.\n",in_name);
+
+  if (strcmp(out_name,"-")==0)
+    fs.ofp = stdout;
+  else if ( (stat(out_name,&st)==0) && S_ISDIR(st.st_mode) )
+    fs.odir = out_name;
+  else if ((fs.ofp=fopen(out_name,"wb")) == NULL)
+    exit_error("Can't output image %s.\n",out_name);
+
+/* }}} */
+  /* {{{ per-stream LUTs and buffers */
+
+  if (p->mode==0)
+  {
+    setup_brightness_lut(&w.bp,p->bt,2);
+    w.mask_size = smoothing_mask_size(p->three_by_three,p->dt);
+    if (p->three_by_three==0)
+    {
+      n_max = (w.mask_size*2) + 1;
+      w.dp = (uchar *) malloc(n_max*n_max);
+      setup_distance_lut(w.dp,p->dt,w.mask_size);
+    }
+  }
+  else
+    setup_brightness_lut(&w.bp,p->bt,6);
+
+  w.corner_list = (CORNER_LIST *) malloc(sizeof(CORNER_LIST));
+
+/* }}} */
+
+  gettimeofday(&t0,NULL);
+
+  pthread_create(&reader,NULL,stream_reader,&fs);
+  pthread_create(&writer,NULL,stream_writer,&fs);
+
+  /* {{{ compute stage */
+
+  while (1)
+  {
+    pthread_mutex_lock(&fs.lock);
+    while ( (fs.n_done == fs.n_read) && !fs.eof )
+      pthread_cond_wait(&fs.cond,&fs.lock);
+    if (fs.n_done == fs.n_read)
+    {
+      pthread_cond_broadcast(&fs.cond);
+      pthread_mutex_unlock(&fs.lock);
+      break;
+    }
+    slot = &fs.slot[fs.n_done % STREAM_SLOTS];
+    pthread_mutex_unlock(&fs.lock);
+
+    process_frame(p,&w,slot->in,slot->x_size,slot->y_size);
+
+    pthread_mutex_lock(&fs.lock);
+    fs.n_done++;
+    pthread_cond_broadcast(&fs.cond);
+    pthread_mutex_unlock(&fs.lock);
+  }
+
+/* }}} */
+
+  pthread_join(reader,NULL);
+  pthread_join(writer,NULL);
+
+  if (fs.ofp != NULL)
+    fflush(fs.ofp);
+
+  gettimeofday(&t1,NULL);
+  secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_usec - t0.tv_usec) / 1e6;
+  fprintf(stderr,"%d frames in %.3f s (%.1f frames/s)\n",
+          fs.n_written, secs, (secs > 0) ? fs.n_written / secs : 0.0);
+
+  if ( (fs.ifp != NULL) && (fs.ifp != stdin) )
+    fclose(fs.ifp);
+  if ( (fs.ofp != NULL) && (fs.ofp != stdout) )
+    fclose(fs.ofp);
+}
+
+/* }}} */
+
 /* }}} */
 /* {{{ main(argc, argv) */
 
@@ -1980,17 +2522,17 @@ int    *r,
        susan_quick=0,
        max_no_corners=1850,
        max_no_edges=2650,
+       stream=0,
        mode = 0, i,
        x_size, y_size;
 CORNER_LIST corner_list;
+SUSAN_PARAMS params;
 
 /* }}} */
 
   if (argc<3)
     usage();
 
-  get_image(argv[1],&in,&x_size,&y_size);
-
   /* {{{ look at options */
 
   while (argindex < argc)
@@ -2023,6 +2565,9 @@ CORNER_LIST corner_list;
         case 'q': /* quick susan mask */
           susan_quick=1;
 	  break;
+        case 'v': /* video stream of frames */
+          stream=1;
+	  break;
 	case 'd': /* distance threshold */
           if (++argindex >= argc){
 	    printf ("No argument following -d\n");
@@ -2046,6 +2591,20 @@ CORNER_LIST corner_list;
     mode=1;
 
 /* }}} */
+
+  if (stream)
+  {
+    params.mode=mode; params.principle=principle;
+    params.thin_post_proc=thin_post_proc; params.three_by_three=three_by_three;
+    params.drawing_mode=drawing_mode; params.susan_quick=susan_quick;
+    params.max_no_corners=max_no_corners; params.max_no_edges=max_no_edges;
+    params.bt=bt; params.dt=dt;
+    susan_stream(&params,argv[1],argv[2]);
+    exit(0);
+  }
+
+  get_image(argv[1],&in,&x_size,&y_size);
+
   /* {{{ main processing */
 
   switch (mode)
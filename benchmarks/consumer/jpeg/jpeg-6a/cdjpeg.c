@@ -19,6 +19,14 @@
 /* If you have setmode() but not <io.h>, just delete this line: */
 #include <io.h>			/* to declare setmode() */
 #endif
+#ifdef HAVE_OPENDIR
+#include <dirent.h>		/* to declare opendir(), readdir() */
+#endif
+#ifndef HAVE_STDLIB_H		/* <stdlib.h> should declare malloc(),qsort() */
+extern void * malloc JPP((size_t size));
+extern void * realloc JPP((void * ptr, size_t size));
+extern void free JPP((void *ptr));
+#endif
 
 
 /*
@@ -177,3 +185,219 @@ write_stdout (void)
 #endif
   return output_file;
 }
+
+
+/*
+ * Batch mode support for cjpeg/djpeg (the -outdir switch).
+ * These build the list of input files to convert and the name of the
+ * output file to write for each of them.  Failure to get memory for a
+ * name is fatal, as in read_stdin().
+ */
+
+LOCAL(void *)
+batch_alloc (void * ptr, size_t size)
+{
+  if ((ptr = (ptr == NULL ? malloc(size) : realloc(ptr, size))) == NULL) {
+    fprintf(stderr, "Insufficient memory for batch file list\n");
+    exit(EXIT_FAILURE);
+  }
+  return ptr;
+}
+
+
+LOCAL(void)
+add_file_name (char *** list, int * count, int * maxcount, const char * name)
+{
+  if (*count >= *maxcount) {
+    *maxcount = (*maxcount == 0) ? 64 : *maxcount * 2;
+    *list = (char **) batch_alloc((void *) *list,
+				  (size_t) (*maxcount + 1) * SIZEOF(char *));
+  }
+  (*list)[*count] = (char *) batch_alloc((void *) NULL, strlen(name) + 1);
+  strcpy((*list)[*count], name);
+  (*count)++;
+}
+
+
+#ifdef HAVE_OPENDIR
+
+LOCAL(int)
+compare_file_names (const void * a, const void * b)
+{
+  return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+
+LOCAL(boolean)
+add_directory (char *** list, int * count, int * maxcount, const char * dirname)
+/* If dirname names a directory, add the files in it and return TRUE.
+ * Hidden files and subdirectories are skipped; the files are added in
+ * alphabetical order so that the output does not depend on the filesystem.
+ */
+{
+  DIR * dir;
+  DIR * subdir;
+  struct dirent * entry;
+  char * path;
+  int first = *count;
+
+  if ((dir = opendir(dirname)) == NULL)
+    return FALSE;
+  while ((entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] == '.')
+      continue;
+    path = (char *) batch_alloc((void *) NULL,
+				strlen(dirname) + strlen(entry->d_name) + 2);
+    sprintf(path, "%s/%s", dirname, entry->d_name);
+    if ((subdir = opendir(path)) != NULL)
+      closedir(subdir);
+    else
+      add_file_name(list, count, maxcount, path);
+    free(path);
+  }
+  closedir(dir);
+  if (*count > first)
+    qsort((void *) (*list + first), (size_t) (*count - first),
+	  SIZEOF(char *), compare_file_names);
+  return TRUE;
+}
+
+#endif /* HAVE_OPENDIR */
+
+
+GLOBAL(char **)
+batch_file_list (char ** names, int numnames)
+/* Expand the input file names given on the command line into a
+ * NULL-terminated list of files to convert.  A directory name stands
+ * for the files in it (if HAVE_OPENDIR); other names are kept as is.
+ * The list is never freed; it lasts until the program exits.
+ */
+{
+  char ** list = NULL;
+  int count = 0, maxcount = 0;
+  int i;
+
+  for (i = 0; i < numnames; i++) {
+#ifdef HAVE_OPENDIR
+    if (add_directory(&list, &count, &maxcount, names[i]))
+      continue;
+#endif
+    add_file_name(&list, &count, &maxcount, names[i]);
+  }
+  if (list == NULL)
+    list = (char **) batch_alloc((void *) NULL, SIZEOF(char *));
+  list[count] = NULL;
+  return list;
+}
+
+
+GLOBAL(char *)
+batch_output_name (const char * outdir, const char * inname,
+		   const char * extension)
+/* Construct the output file name for inname: its last path component,
+ * with the extension (if any) replaced, placed in directory outdir.
+ * The caller should free() the result when done with it.
+ */
+{
+  const char * base = inname;
+  const char * ptr;
+  const char * dot = NULL;
+  size_t baselen;
+  char * result;
+
+  for (ptr = inname; *ptr; ptr++) {
+    if (*ptr == '/' || *ptr == '\\' || *ptr == ':')
+      base = ptr + 1;
+  }
+  for (ptr = base; *ptr; ptr++) {
+    if (*ptr == '.' && ptr != base)
+      dot = ptr;
+  }
+  baselen = (dot != NULL) ? (size_t) (dot - base) : strlen(base);
+  result = (char *) batch_alloc((void *) NULL, strlen(outdir) + baselen +
+				strlen(extension) + 2);
+  sprintf(result, "%s/%.*s%s", outdir, (int) baselen, base, extension);
+  return result;
+}
+
+
+LOCAL(int)
+compare_output_names (const void * a, const void * b)
+{
+  return strcmp(((char * const *) a)[0], ((char * const *) b)[0]);
+}
+
+
+GLOBAL(void)
+batch_check_names (const char * outdir, char ** list)
+/* Make sure no two files in list (from batch_file_list) would be written
+ * to the same output file, which happens when they have the same base name.
+ * The extension is left out of the comparison, since djpeg only knows it
+ * once it has read each header.  A clash is fatal, before anything is
+ * written.
+ */
+{
+  char ** pairs;		/* output name, input name for each file */
+  int count, i;
+
+  for (count = 0; list[count] != NULL; count++)
+    ;
+  if (count < 2)
+    return;
+  pairs = (char **) batch_alloc((void *) NULL,
+				(size_t) count * 2 * SIZEOF(char *));
+  for (i = 0; i < count; i++) {
+    pairs[2*i] = batch_output_name(outdir, list[i], "");
+    pairs[2*i+1] = list[i];
+  }
+  qsort((void *) pairs, (size_t) count, 2 * SIZEOF(char *),
+	compare_output_names);
+  for (i = 1; i < count; i++) {
+    if (strcmp(pairs[2*i-2], pairs[2*i]) == 0) {
+      fprintf(stderr, "%s and %s would both be written to %s\n",
+	      pairs[2*i-1], pairs[2*i+1], pairs[2*i]);
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (i = 0; i < count; i++)
+    free(pairs[2*i]);
+  free(pairs);
+}
+
+
+/*
+ * While a batch output file is being written, a fatal error removes it,
+ * so that a failed conversion does not leave a partial file behind.
+ */
+
+static const char * batch_output;	/* file being written, or NULL */
+static JMETHOD(void, batch_saved_error_exit, (j_common_ptr cinfo));
+
+METHODDEF(void)
+batch_error_exit (j_common_ptr cinfo)
+{
+  if (batch_output != NULL)
+    (void) remove(batch_output);
+  (*batch_saved_error_exit) (cinfo);
+}
+
+
+GLOBAL(void)
+batch_output_begin (j_common_ptr cinfo, const char * outname)
+/* Call after opening outname.  The name must stay valid until
+ * batch_output_end() is called, after the file is closed.
+ */
+{
+  if (cinfo->err->error_exit != batch_error_exit) {
+    batch_saved_error_exit = cinfo->err->error_exit;
+    cinfo->err->error_exit = batch_error_exit;
+  }
+  batch_output = outname;
+}
+
+
+GLOBAL(void)
+batch_output_end (void)
+{
+  batch_output = NULL;
+}
@@ -106,12 +106,18 @@ typedef struct cdjpeg_progress_mgr * cd_progress_ptr;
 #define read_scan_script	RdScnScript
 #define set_quant_slots		SetQSlots
 #define set_sample_factors	SetSFacts
+#define set_restart_segments	SetRstSeg
 #define read_color_map		RdCMap
 #define enable_signal_catcher	EnSigCatcher
 #define start_progress_monitor	StProgMon
 #define end_progress_monitor	EnProgMon
 #define read_stdin		RdStdin
 #define write_stdout		WrStdout
+#define batch_file_list		BatFList
+#define batch_output_name	BatOName
+#define batch_check_names	BatCkNames
+#define batch_output_begin	BatOBegin
+#define batch_output_end	BatOEnd
 #endif /* NEED_SHORT_EXTERNAL_NAMES */
 
 /* Module selection routines for I/O modules. */
@@ -135,6 +141,7 @@ EXTERN(boolean) read_quant_tables JPP((j_compress_ptr cinfo, char * filename,
 EXTERN(boolean) read_scan_script JPP((j_compress_ptr cinfo, char * filename));
 EXTERN(boolean) set_quant_slots JPP((j_compress_ptr cinfo, char *arg));
 EXTERN(boolean) set_sample_factors JPP((j_compress_ptr cinfo, char *arg));
+EXTERN(void) set_restart_segments JPP((j_compress_ptr cinfo, int nsegments));
 
 /* djpeg support routines (in rdcolmap.c) */
 
@@ -149,15 +156,25 @@ EXTERN(void) end_progress_monitor JPP((j_common_ptr cinfo));
 EXTERN(boolean) keymatch JPP((char * arg, const char * keyword, int minchars));
 EXTERN(FILE *) read_stdin JPP((void));
 EXTERN(FILE *) write_stdout JPP((void));
+EXTERN(char **) batch_file_list JPP((char ** names, int numnames));
+EXTERN(char *) batch_output_name JPP((const char * outdir,
+				      const char * inname,
+				      const char * extension));
+EXTERN(void) batch_check_names JPP((const char * outdir, char ** list));
+EXTERN(void) batch_output_begin JPP((j_common_ptr cinfo,
+				     const char * outname));
+EXTERN(void) batch_output_end JPP((void));
 
 /* miscellaneous useful macros */
 
 #ifdef DONT_USE_B_MODE		/* define mode parameters for fopen() */
 #define READ_BINARY	"r"
 #define WRITE_BINARY	"w"
+#define UPDATE_BINARY	"w+"	/* write, but readable too so we can mmap it */
 #else
 #define READ_BINARY	"rb"
 #define WRITE_BINARY	"wb"
+#define UPDATE_BINARY	"w+b"	/* write, but readable too so we can mmap it */
 #endif
 
 #ifndef EXIT_FAILURE		/* define exit() codes if not provided */
@@ -135,6 +135,7 @@ select_file_type (j_compress_ptr cinfo, FILE * infile)
 
 static const char * progname;	/* program name for error messages */
 static char * outfilename;	/* for -outfile switch */
+static char * outdirname;	/* for -outdir switch (batch mode) */
 
 
 LOCAL(void)
@@ -147,6 +148,7 @@ usage (void)
 #else
   fprintf(stderr, "[inputfile]\n");
 #endif
+  fprintf(stderr, "   or: %s [switches] -outdir dir inputfile ...\n", progname);
 
   fprintf(stderr, "Switches (names may be abbreviated):\n");
   fprintf(stderr, "  -quality N     Compression quality (0..100; 5-95 is useful range)\n");
@@ -174,11 +176,16 @@ usage (void)
 	  (JDCT_DEFAULT == JDCT_FLOAT ? " (default)" : ""));
 #endif
   fprintf(stderr, "  -restart N     Set restart interval in rows, or in blocks with B\n");
+  fprintf(stderr, "  -segments N    Set restart interval for N parallel-decodable parts\n");
 #ifdef INPUT_SMOOTHING_SUPPORTED
   fprintf(stderr, "  -smooth N      Smooth dithered input (N=1..100 is strength)\n");
 #endif
   fprintf(stderr, "  -maxmemory N   Maximum memory to use (in kbytes)\n");
   fprintf(stderr, "  -outfile name  Specify name for output file\n");
+  fprintf(stderr, "  -outdir dir    Convert each input file (or directory) into dir\n");
+#ifdef C_PARALLEL_HUFF_SUPPORTED
+  fprintf(stderr, "  -threads N     Encode progressive scans on up to N threads\n");
+#endif
   fprintf(stderr, "  -verbose  or  -debug   Emit debug output\n");
   fprintf(stderr, "Switches for wizards:\n");
 #ifdef C_ARITH_CODING_SUPPORTED
@@ -217,6 +224,7 @@ parse_switches (j_compress_ptr cinfo, int argc, char **argv,
   char * qslotsarg = NULL;	/* saves -qslots parm if any */
   char * samplearg = NULL;	/* saves -sample parm if any */
   char * scansarg = NULL;	/* saves -scans parm if any */
+  int segments = 0;		/* -segments parameter, 0 if none */
 
   /* Set up default JPEG parameters. */
   /* Note that default -quality level need not, and does not,
@@ -228,6 +236,7 @@ parse_switches (j_compress_ptr cinfo, int argc, char **argv,
   simple_progressive = FALSE;
   is_targa = FALSE;
   outfilename = NULL;
+  outdirname = NULL;
   cinfo->err->trace_level = 0;
 
   /* Scan command line options, adjust parameters */
@@ -310,6 +319,12 @@ parse_switches (j_compress_ptr cinfo, int argc, char **argv,
       exit(EXIT_FAILURE);
 #endif
 
+    } else if (keymatch(arg, "outdir", 4)) {
+      /* Set output directory for batch mode. */
+      if (++argn >= argc)	/* advance to next argument */
+	usage();
+      outdirname = argv[argn];	/* save it away for later use */
+
     } else if (keymatch(arg, "outfile", 4)) {
       /* Set output file name. */
       if (++argn >= argc)	/* advance to next argument */
@@ -372,6 +387,15 @@ parse_switches (j_compress_ptr cinfo, int argc, char **argv,
 	/* restart_interval will be computed during startup */
       }
 
+    } else if (keymatch(arg, "segments", 2)) {
+      /* Restart interval chosen to split the image into N parts. */
+      if (++argn >= argc)	/* advance to next argument */
+	usage();
+      if (sscanf(argv[argn], "%d", &segments) != 1)
+	usage();
+      if (segments < 0)
+	usage();
+
     } else if (keymatch(arg, "sample", 2)) {
       /* Set sampling factors. */
       if (++argn >= argc)	/* advance to next argument */
@@ -411,6 +435,15 @@ parse_switches (j_compress_ptr cinfo, int argc, char **argv,
       /* Input file is Targa format. */
       is_targa = TRUE;
 
+    } else if (keymatch(arg, "threads", 2)) {
+      /* Encode the scans of a progressive file in parallel. */
+      if (++argn >= argc)	/* advance to next argument */
+	usage();
+      if (sscanf(argv[argn], "%d", &cinfo->num_threads) != 1)
+	usage();
+      if (cinfo->num_threads < 1)
+	usage();
+
     } else {
       usage();			/* bogus switch */
     }
@@ -437,6 +470,9 @@ parse_switches (j_compress_ptr cinfo, int argc, char **argv,
       if (! set_sample_factors(cinfo, samplearg))
 	usage();
 
+    if (segments > 0)		/* process -segments; overrides -restart */
+      set_restart_segments(cinfo, segments);
+
 #ifdef C_PROGRESSIVE_SUPPORTED
     if (simple_progressive)	/* process -progressive; -scans can override */
       jpeg_simple_progression(cinfo);
@@ -453,6 +489,49 @@ parse_switches (j_compress_ptr cinfo, int argc, char **argv,
 }
 
 
+/*
+ * Compress one file.  Both files are open; the compression parameters
+ * must have been set to their defaults already.
+ */
+
+LOCAL(void)
+compress_file (j_compress_ptr cinfo, int argc, char **argv,
+	       FILE * input_file, FILE * output_file)
+{
+  cjpeg_source_ptr src_mgr;
+  JDIMENSION num_scanlines;
+
+  /* Figure out the input file format, and set up to read it. */
+  src_mgr = select_file_type(cinfo, input_file);
+  src_mgr->input_file = input_file;
+
+  /* Read the input file header to obtain file size & colorspace. */
+  (*src_mgr->start_input) (cinfo, src_mgr);
+
+  /* Now that we know input colorspace, fix colorspace-dependent defaults */
+  jpeg_default_colorspace(cinfo);
+
+  /* Adjust default compression parameters by re-parsing the options */
+  (void) parse_switches(cinfo, argc, argv, 0, TRUE);
+
+  /* Specify data destination for compression (mapped if possible) */
+  jpeg_mmap_dest(cinfo, output_file);
+
+  /* Start compressor */
+  jpeg_start_compress(cinfo, TRUE);
+
+  /* Process data */
+  while (cinfo->next_scanline < cinfo->image_height) {
+    num_scanlines = (*src_mgr->get_pixel_rows) (cinfo, src_mgr);
+    (void) jpeg_write_scanlines(cinfo, src_mgr->buffer, num_scanlines);
+  }
+
+  /* Finish compression and release image memory */
+  (*src_mgr->finish_input) (cinfo, src_mgr);
+  jpeg_finish_compress(cinfo);
+}
+
+
 /*
  * The main program.
  */
@@ -466,10 +545,11 @@ main (int argc, char **argv)
   struct cdjpeg_progress_mgr progress;
 #endif
   int file_index;
-  cjpeg_source_ptr src_mgr;
+  boolean warnings = FALSE;
+  char ** names;
+  char * batchname;
   FILE * input_file;
   FILE * output_file;
-  JDIMENSION num_scanlines;
 
   /* On Mac, fetch a command line. */
 #ifdef USE_CCOMMAND
@@ -510,97 +590,116 @@ main (int argc, char **argv)
 
   file_index = parse_switches(&cinfo, argc, argv, 0, FALSE);
 
-#ifdef TWO_FILE_COMMANDLINE
-  /* Must have either -outfile switch or explicit output file name */
-  if (outfilename == NULL) {
-    if (file_index != argc-2) {
-      fprintf(stderr, "%s: must name one input and one output file\n",
+  if (outdirname != NULL) {
+    /* Batch mode: each input file is converted into a .jpg file of the same
+     * base name in outdirname.  The same compression object is used for all
+     * of them, keeping its image memory and tables from one to the next.
+     */
+    if (outfilename != NULL || file_index >= argc) {
+      fprintf(stderr, "%s: -outdir needs input file names and no -outfile\n",
 	      progname);
       usage();
     }
-    outfilename = argv[file_index+1];
+    cinfo.mem->reuse_image_pools = TRUE;
+
+#ifdef PROGRESS_REPORT
+    start_progress_monitor((j_common_ptr) &cinfo, &progress);
+#endif
+
+    names = batch_file_list(argv + file_index, argc - file_index);
+    batch_check_names(outdirname, names);
+    for (; *names != NULL; names++) {
+      if ((input_file = fopen(*names, READ_BINARY)) == NULL) {
+	fprintf(stderr, "%s: can't open %s\n", progname, *names);
+	exit(EXIT_FAILURE);
+      }
+      batchname = batch_output_name(outdirname, *names, ".jpg");
+      if ((output_file = fopen(batchname, UPDATE_BINARY)) == NULL) {
+	fprintf(stderr, "%s: can't open %s\n", progname, batchname);
+	exit(EXIT_FAILURE);
+      }
+      batch_output_begin((j_common_ptr) &cinfo, batchname);
+      /* Each file starts from the defaults, as if converted on its own. */
+      cinfo.in_color_space = JCS_RGB; /* arbitrary guess */
+      jpeg_set_defaults(&cinfo);
+      compress_file(&cinfo, argc, argv, input_file, output_file);
+      fclose(input_file);
+      fclose(output_file);
+      batch_output_end();
+      free(batchname);
+      if (jerr.num_warnings)
+	warnings = TRUE;
+    }
+
   } else {
-    if (file_index != argc-1) {
-      fprintf(stderr, "%s: must name one input and one output file\n",
-	      progname);
-      usage();
+
+#ifdef TWO_FILE_COMMANDLINE
+    /* Must have either -outfile switch or explicit output file name */
+    if (outfilename == NULL) {
+      if (file_index != argc-2) {
+	fprintf(stderr, "%s: must name one input and one output file\n",
+		progname);
+	usage();
+      }
+      outfilename = argv[file_index+1];
+    } else {
+      if (file_index != argc-1) {
+	fprintf(stderr, "%s: must name one input and one output file\n",
+		progname);
+	usage();
+      }
     }
-  }
 #else
-  /* Unix style: expect zero or one file name */
-  if (file_index < argc-1) {
-    fprintf(stderr, "%s: only one input file\n", progname);
-    usage();
-  }
+    /* Unix style: expect zero or one file name */
+    if (file_index < argc-1) {
+      fprintf(stderr, "%s: only one input file\n", progname);
+      usage();
+    }
 #endif /* TWO_FILE_COMMANDLINE */
 
-  /* Open the input file. */
-  if (file_index < argc) {
-    if ((input_file = fopen(argv[file_index], READ_BINARY)) == NULL) {
-      fprintf(stderr, "%s: can't open %s\n", progname, argv[file_index]);
-      exit(EXIT_FAILURE);
+    /* Open the input file. */
+    if (file_index < argc) {
+      if ((input_file = fopen(argv[file_index], READ_BINARY)) == NULL) {
+	fprintf(stderr, "%s: can't open %s\n", progname, argv[file_index]);
+	exit(EXIT_FAILURE);
+      }
+    } else {
+      /* default input file is stdin */
+      input_file = read_stdin();
     }
-  } else {
-    /* default input file is stdin */
-    input_file = read_stdin();
-  }
 
-  /* Open the output file. */
-  if (outfilename != NULL) {
-    if ((output_file = fopen(outfilename, WRITE_BINARY)) == NULL) {
-      fprintf(stderr, "%s: can't open %s\n", progname, outfilename);
-      exit(EXIT_FAILURE);
+    /* Open the output file. */
+    if (outfilename != NULL) {
+      if ((output_file = fopen(outfilename, UPDATE_BINARY)) == NULL) {
+	fprintf(stderr, "%s: can't open %s\n", progname, outfilename);
+	exit(EXIT_FAILURE);
+      }
+    } else {
+      /* default output file is stdout */
+      output_file = write_stdout();
     }
-  } else {
-    /* default output file is stdout */
-    output_file = write_stdout();
-  }
 
 #ifdef PROGRESS_REPORT
-  start_progress_monitor((j_common_ptr) &cinfo, &progress);
+    start_progress_monitor((j_common_ptr) &cinfo, &progress);
 #endif
 
-  /* Figure out the input file format, and set up to read it. */
-  src_mgr = select_file_type(&cinfo, input_file);
-  src_mgr->input_file = input_file;
-
-  /* Read the input file header to obtain file size & colorspace. */
-  (*src_mgr->start_input) (&cinfo, src_mgr);
-
-  /* Now that we know input colorspace, fix colorspace-dependent defaults */
-  jpeg_default_colorspace(&cinfo);
-
-  /* Adjust default compression parameters by re-parsing the options */
-  file_index = parse_switches(&cinfo, argc, argv, 0, TRUE);
+    compress_file(&cinfo, argc, argv, input_file, output_file);
+    warnings = (jerr.num_warnings != 0);
 
-  /* Specify data destination for compression */
-  jpeg_stdio_dest(&cinfo, output_file);
-
-  /* Start compressor */
-  jpeg_start_compress(&cinfo, TRUE);
-
-  /* Process data */
-  while (cinfo.next_scanline < cinfo.image_height) {
-    num_scanlines = (*src_mgr->get_pixel_rows) (&cinfo, src_mgr);
-    (void) jpeg_write_scanlines(&cinfo, src_mgr->buffer, num_scanlines);
+    /* Close files, if we opened them */
+    if (input_file != stdin)
+      fclose(input_file);
+    if (output_file != stdout)
+      fclose(output_file);
   }
 
-  /* Finish compression and release memory */
-  (*src_mgr->finish_input) (&cinfo, src_mgr);
-  jpeg_finish_compress(&cinfo);
   jpeg_destroy_compress(&cinfo);
 
-  /* Close files, if we opened them */
-  if (input_file != stdin)
-    fclose(input_file);
-  if (output_file != stdout)
-    fclose(output_file);
-
 #ifdef PROGRESS_REPORT
   end_progress_monitor((j_common_ptr) &cinfo);
 #endif
 
   /* All done. */
-  exit(jerr.num_warnings ? EXIT_WARNING : EXIT_SUCCESS);
+  exit(warnings ? EXIT_WARNING : EXIT_SUCCESS);
   return 0;			/* suppress no-return-value warnings */
 }
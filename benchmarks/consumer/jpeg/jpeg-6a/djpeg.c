@@ -84,6 +84,7 @@ static IMAGE_FORMATS requested_fmt;
 
 static const char * progname;	/* program name for error messages */
 static char * outfilename;	/* for -outfile switch */
+static char * outdirname;	/* for -outdir switch (batch mode) */
 
 
 LOCAL(void)
@@ -96,6 +97,7 @@ usage (void)
 #else
   fprintf(stderr, "[inputfile]\n");
 #endif
+  fprintf(stderr, "   or: %s [switches] -outdir dir inputfile ...\n", progname);
 
   fprintf(stderr, "Switches (names may be abbreviated):\n");
   fprintf(stderr, "  -colors N      Reduce image to no more than N colors\n");
@@ -103,6 +105,7 @@ usage (void)
   fprintf(stderr, "  -grayscale     Force grayscale output\n");
 #ifdef IDCT_SCALING_SUPPORTED
   fprintf(stderr, "  -scale M/N     Scale output image by fraction M/N, eg, 1/8\n");
+  fprintf(stderr, "  -thumbnail WxH Fast reduced-size output of at least WxH\n");
 #endif
 #ifdef BMP_SUPPORTED
   fprintf(stderr, "  -bmp           Select BMP output format (Windows style)%s\n",
@@ -153,6 +156,10 @@ usage (void)
 #endif
   fprintf(stderr, "  -maxmemory N   Maximum memory to use (in kbytes)\n");
   fprintf(stderr, "  -outfile name  Specify name for output file\n");
+  fprintf(stderr, "  -outdir dir    Convert each input file (or directory) into dir\n");
+#ifdef D_PARALLEL_HUFF_SUPPORTED
+  fprintf(stderr, "  -threads N     Decode restart intervals on up to N threads\n");
+#endif
   fprintf(stderr, "  -verbose  or  -debug   Emit debug output\n");
   exit(EXIT_FAILURE);
 }
@@ -176,6 +183,7 @@ parse_switches (j_decompress_ptr cinfo, int argc, char **argv,
   /* Set up default JPEG parameters. */
   requested_fmt = DEFAULT_FMT;	/* set default output file format */
   outfilename = NULL;
+  outdirname = NULL;
   cinfo->err->trace_level = 0;
 
   /* Scan command line options, adjust parameters */
@@ -308,6 +316,12 @@ parse_switches (j_decompress_ptr cinfo, int argc, char **argv,
       /* BMP output format (OS/2 flavor). */
       requested_fmt = FMT_OS2;
 
+    } else if (keymatch(arg, "outdir", 4)) {
+      /* Set output directory for batch mode. */
+      if (++argn >= argc)	/* advance to next argument */
+	usage();
+      outdirname = argv[argn];	/* save it away for later use */
+
     } else if (keymatch(arg, "outfile", 4)) {
       /* Set output file name. */
       if (++argn >= argc)	/* advance to next argument */
@@ -334,6 +348,26 @@ parse_switches (j_decompress_ptr cinfo, int argc, char **argv,
       /* Targa output format. */
       requested_fmt = FMT_TARGA;
 
+    } else if (keymatch(arg, "threads", 2)) {
+      /* Decode restart intervals in parallel. */
+      if (++argn >= argc)	/* advance to next argument */
+	usage();
+      if (sscanf(argv[argn], "%d", &cinfo->num_threads) != 1)
+	usage();
+      if (cinfo->num_threads < 1)
+	usage();
+
+    } else if (keymatch(arg, "thumbnail", 3)) {
+      /* Quick reduced-size output of at least WxH pixels. */
+      unsigned int width, height;
+
+      if (++argn >= argc)	/* advance to next argument */
+	usage();
+      if (sscanf(argv[argn], "%ux%u", &width, &height) != 2)
+	usage();
+      if (for_real)		/* needs the image size from the header */
+	jpeg_set_thumbnail_size(cinfo, (JDIMENSION) width, (JDIMENSION) height);
+
     } else {
       usage();			/* bogus switch */
     }
@@ -411,6 +445,120 @@ COM_handler (j_decompress_ptr cinfo)
 }
 
 
+/*
+ * Decompress one file.  input_file is open and positioned at the JPEG data.
+ * If output_file is NULL we are in batch mode: the output file is created
+ * in outdirname, named after inname, once the output format is known.
+ */
+
+LOCAL(void)
+decompress_file (j_decompress_ptr cinfo, int argc, char **argv,
+		 FILE * input_file, FILE * output_file, const char * inname)
+{
+  djpeg_dest_ptr dest_mgr = NULL;
+  const char * extension = "";
+  char * batchname = NULL;
+  JDIMENSION num_scanlines;
+
+  /* Specify data source for decompression (mapped if possible) */
+  jpeg_mmap_src(cinfo, input_file);
+
+  /* Read file header, set default decompression parameters */
+  (void) jpeg_read_header(cinfo, TRUE);
+
+  /* Adjust default decompression parameters by re-parsing the options */
+  (void) parse_switches(cinfo, argc, argv, 0, TRUE);
+
+  /* Initialize the output module now to let it override any crucial
+   * option settings (for instance, GIF wants to force color quantization).
+   */
+  switch (requested_fmt) {
+#ifdef BMP_SUPPORTED
+  case FMT_BMP:
+    dest_mgr = jinit_write_bmp(cinfo, FALSE);
+    extension = ".bmp";
+    break;
+  case FMT_OS2:
+    dest_mgr = jinit_write_bmp(cinfo, TRUE);
+    extension = ".bmp";
+    break;
+#endif
+#ifdef GIF_SUPPORTED
+  case FMT_GIF:
+    dest_mgr = jinit_write_gif(cinfo);
+    extension = ".gif";
+    break;
+#endif
+#ifdef PPM_SUPPORTED
+  case FMT_PPM:
+    dest_mgr = jinit_write_ppm(cinfo);
+    extension = (cinfo->out_color_space == JCS_GRAYSCALE) ? ".pgm" : ".ppm";
+    break;
+#endif
+#ifdef RLE_SUPPORTED
+  case FMT_RLE:
+    dest_mgr = jinit_write_rle(cinfo);
+    extension = ".rle";
+    break;
+#endif
+#ifdef TARGA_SUPPORTED
+  case FMT_TARGA:
+    dest_mgr = jinit_write_targa(cinfo);
+    extension = ".tga";
+    break;
+#endif
+  default:
+    ERREXIT(cinfo, JERR_UNSUPPORTED_FORMAT);
+    break;
+  }
+
+  /* In batch mode, open the output file now that we know its extension. */
+  if (output_file == NULL) {
+    batchname = batch_output_name(outdirname, inname, extension);
+    if ((output_file = fopen(batchname, WRITE_BINARY)) == NULL) {
+      fprintf(stderr, "%s: can't open %s\n", progname, batchname);
+      exit(EXIT_FAILURE);
+    }
+    batch_output_begin((j_common_ptr) cinfo, batchname);
+  }
+  dest_mgr->output_file = output_file;
+
+  /* Start decompressor */
+  (void) jpeg_start_decompress(cinfo);
+
+  /* Write output file header */
+  (*dest_mgr->start_output) (cinfo, dest_mgr);
+
+  /* Process data */
+  while (cinfo->output_scanline < cinfo->output_height) {
+    num_scanlines = jpeg_read_scanlines(cinfo, dest_mgr->buffer,
+					dest_mgr->buffer_height);
+    (*dest_mgr->put_pixel_rows) (cinfo, dest_mgr, num_scanlines);
+  }
+
+#ifdef PROGRESS_REPORT
+  /* Hack: count final pass as done in case finish_output does an extra pass.
+   * The library won't have updated completed_passes.
+   */
+  cinfo->progress->completed_passes = cinfo->progress->total_passes;
+#endif
+
+  /* Finish decompression and release image memory.
+   * I must do it in this order because output module has allocated memory
+   * of lifespan JPOOL_IMAGE; it needs to finish before releasing memory.
+   */
+  (*dest_mgr->finish_output) (cinfo, dest_mgr);
+  (void) jpeg_finish_decompress(cinfo);
+
+  /* Close the output file, if we opened it here */
+  if (batchname != NULL) {
+    fclose(output_file);
+    batch_output_end();
+    free(batchname);
+  }
+}
+
+
 /*
  * The main program.
  */
@@ -424,10 +572,10 @@ main (int argc, char **argv)
   struct cdjpeg_progress_mgr progress;
 #endif
   int file_index;
-  djpeg_dest_ptr dest_mgr = NULL;
+  boolean warnings = FALSE;
+  char ** names;
   FILE * input_file;
   FILE * output_file;
-  JDIMENSION num_scanlines;
 
   /* On Mac, fetch a command line. */
 #ifdef USE_CCOMMAND
@@ -463,142 +611,105 @@ main (int argc, char **argv)
 
   file_index = parse_switches(&cinfo, argc, argv, 0, FALSE);
 
-#ifdef TWO_FILE_COMMANDLINE
-  /* Must have either -outfile switch or explicit output file name */
-  if (outfilename == NULL) {
-    if (file_index != argc-2) {
-      fprintf(stderr, "%s: must name one input and one output file\n",
+  if (outdirname != NULL) {
+    /* Batch mode: each input file is converted into a file of the same
+     * base name in outdirname.  The same decompression object is used for
+     * all of them, keeping its image memory and tables from one to the next.
+     */
+    if (outfilename != NULL || file_index >= argc) {
+      fprintf(stderr, "%s: -outdir needs input file names and no -outfile\n",
 	      progname);
       usage();
     }
-    outfilename = argv[file_index+1];
+    cinfo.mem->reuse_image_pools = TRUE;
+
+#ifdef PROGRESS_REPORT
+    start_progress_monitor((j_common_ptr) &cinfo, &progress);
+#endif
+
+    names = batch_file_list(argv + file_index, argc - file_index);
+    batch_check_names(outdirname, names);
+    for (; *names != NULL; names++) {
+      if ((input_file = fopen(*names, READ_BINARY)) == NULL) {
+	fprintf(stderr, "%s: can't open %s\n", progname, *names);
+	exit(EXIT_FAILURE);
+      }
+      decompress_file(&cinfo, argc, argv, input_file, (FILE *) NULL, *names);
+      fclose(input_file);
+      if (jerr.num_warnings)
+	warnings = TRUE;
+    }
+
   } else {
-    if (file_index != argc-1) {
-      fprintf(stderr, "%s: must name one input and one output file\n",
-	      progname);
-      usage();
+
+#ifdef TWO_FILE_COMMANDLINE
+    /* Must have either -outfile switch or explicit output file name */
+    if (outfilename == NULL) {
+      if (file_index != argc-2) {
+	fprintf(stderr, "%s: must name one input and one output file\n",
+		progname);
+	usage();
+      }
+      outfilename = argv[file_index+1];
+    } else {
+      if (file_index != argc-1) {
+	fprintf(stderr, "%s: must name one input and one output file\n",
+		progname);
+	usage();
+      }
     }
-  }
 #else
-  /* Unix style: expect zero or one file name */
-  if (file_index < argc-1) {
-    fprintf(stderr, "%s: only one input file\n", progname);
-    usage();
-  }
+    /* Unix style: expect zero or one file name */
+    if (file_index < argc-1) {
+      fprintf(stderr, "%s: only one input file\n", progname);
+      usage();
+    }
 #endif /* TWO_FILE_COMMANDLINE */
 
-  /* Open the input file. */
-  if (file_index < argc) {
-    if ((input_file = fopen(argv[file_index], READ_BINARY)) == NULL) {
-      fprintf(stderr, "%s: can't open %s\n", progname, argv[file_index]);
-      exit(EXIT_FAILURE);
+    /* Open the input file. */
+    if (file_index < argc) {
+      if ((input_file = fopen(argv[file_index], READ_BINARY)) == NULL) {
+	fprintf(stderr, "%s: can't open %s\n", progname, argv[file_index]);
+	exit(EXIT_FAILURE);
+      }
+    } else {
+      /* default input file is stdin */
+      input_file = read_stdin();
     }
-  } else {
-    /* default input file is stdin */
-    input_file = read_stdin();
-  }
 
-  /* Open the output file. */
-  if (outfilename != NULL) {
-    if ((output_file = fopen(outfilename, WRITE_BINARY)) == NULL) {
-      fprintf(stderr, "%s: can't open %s\n", progname, outfilename);
-      exit(EXIT_FAILURE);
+    /* Open the output file. */
+    if (outfilename != NULL) {
+      if ((output_file = fopen(outfilename, WRITE_BINARY)) == NULL) {
+	fprintf(stderr, "%s: can't open %s\n", progname, outfilename);
+	exit(EXIT_FAILURE);
+      }
+    } else {
+      /* default output file is stdout */
+      output_file = write_stdout();
     }
-  } else {
-    /* default output file is stdout */
-    output_file = write_stdout();
-  }
 
 #ifdef PROGRESS_REPORT
-  start_progress_monitor((j_common_ptr) &cinfo, &progress);
+    start_progress_monitor((j_common_ptr) &cinfo, &progress);
 #endif
 
-  /* Specify data source for decompression */
-  jpeg_stdio_src(&cinfo, input_file);
+    decompress_file(&cinfo, argc, argv, input_file, output_file,
+		    (const char *) NULL);
+    warnings = (jerr.num_warnings != 0);
 
-  /* Read file header, set default decompression parameters */
-  (void) jpeg_read_header(&cinfo, TRUE);
-
-  /* Adjust default decompression parameters by re-parsing the options */
-  file_index = parse_switches(&cinfo, argc, argv, 0, TRUE);
-
-  /* Initialize the output module now to let it override any crucial
-   * option settings (for instance, GIF wants to force color quantization).
-   */
-  switch (requested_fmt) {
-#ifdef BMP_SUPPORTED
-  case FMT_BMP:
-    dest_mgr = jinit_write_bmp(&cinfo, FALSE);
-    break;
-  case FMT_OS2:
-    dest_mgr = jinit_write_bmp(&cinfo, TRUE);
-    break;
-#endif
-#ifdef GIF_SUPPORTED
-  case FMT_GIF:
-    dest_mgr = jinit_write_gif(&cinfo);
-    break;
-#endif
-#ifdef PPM_SUPPORTED
-  case FMT_PPM:
-    dest_mgr = jinit_write_ppm(&cinfo);
-    break;
-#endif
-#ifdef RLE_SUPPORTED
-  case FMT_RLE:
-    dest_mgr = jinit_write_rle(&cinfo);
-    break;
-#endif
-#ifdef TARGA_SUPPORTED
-  case FMT_TARGA:
-    dest_mgr = jinit_write_targa(&cinfo);
-    break;
-#endif
-  default:
-    ERREXIT(&cinfo, JERR_UNSUPPORTED_FORMAT);
-    break;
+    /* Close files, if we opened them */
+    if (input_file != stdin)
+      fclose(input_file);
+    if (output_file != stdout)
+      fclose(output_file);
   }
-  dest_mgr->output_file = output_file;
-
-  /* Start decompressor */
-  (void) jpeg_start_decompress(&cinfo);
-
-  /* Write output file header */
-  (*dest_mgr->start_output) (&cinfo, dest_mgr);
 
-  /* Process data */
-  while (cinfo.output_scanline < cinfo.output_height) {
-    num_scanlines = jpeg_read_scanlines(&cinfo, dest_mgr->buffer,
-					dest_mgr->buffer_height);
-    (*dest_mgr->put_pixel_rows) (&cinfo, dest_mgr, num_scanlines);
-  }
-
-#ifdef PROGRESS_REPORT
-  /* Hack: count final pass as done in case finish_output does an extra pass.
-   * The library won't have updated completed_passes.
-   */
-  progress.pub.completed_passes = progress.pub.total_passes;
-#endif
-
-  /* Finish decompression and release memory.
-   * I must do it in this order because output module has allocated memory
-   * of lifespan JPOOL_IMAGE; it needs to finish before releasing memory.
-   */
-  (*dest_mgr->finish_output) (&cinfo, dest_mgr);
-  (void) jpeg_finish_decompress(&cinfo);
   jpeg_destroy_decompress(&cinfo);
 
-  /* Close files, if we opened them */
-  if (input_file != stdin)
-    fclose(input_file);
-  if (output_file != stdout)
-    fclose(output_file);
-
 #ifdef PROGRESS_REPORT
   end_progress_monitor((j_common_ptr) &cinfo);
 #endif
 
   /* All done. */
-  exit(jerr.num_warnings ? EXIT_WARNING : EXIT_SUCCESS);
+  exit(warnings ? EXIT_WARNING : EXIT_SUCCESS);
   return 0;			/* suppress no-return-value warnings */
 }
@@ -28,6 +28,11 @@
 #endif
 #endif
 
+/* Parallel scan encoding is done by the progressive Huffman encoder, so: */
+#ifndef C_PROGRESSIVE_SUPPORTED
+#undef C_PARALLEL_HUFF_SUPPORTED
+#endif
+
 
 /* Private buffer controller object */
 
@@ -52,6 +57,11 @@ typedef struct {
 
   /* In multi-pass modes, we need a virtual block array for each component. */
   jvirt_barray_ptr whole_image[MAX_COMPONENTS];
+
+  /* TRUE if the first pass gathers statistics for all scans, rather than
+   * feeding the first scan to the entropy encoder.
+   */
+  boolean gather_all;
 } my_coef_controller;
 
 typedef my_coef_controller * my_coef_ptr;
@@ -103,6 +113,7 @@ start_pass_coef (j_compress_ptr cinfo, J_BUF_MODE pass_mode)
 
   coef->iMCU_row_num = 0;
   start_iMCU_row(cinfo);
+  coef->gather_all = FALSE;
 
   switch (pass_mode) {
   case JBUF_PASS_THRU:
@@ -116,6 +127,14 @@ start_pass_coef (j_compress_ptr cinfo, J_BUF_MODE pass_mode)
       ERREXIT(cinfo, JERR_BAD_BUFFER_MODE);
     coef->pub.compress_data = compress_first_pass;
     break;
+  case JBUF_SAVE_AND_GATHER:
+    if (coef->whole_image[0] == NULL ||
+	cinfo->entropy->start_gather_all == NULL)
+      ERREXIT(cinfo, JERR_BAD_BUFFER_MODE);
+    (*cinfo->entropy->start_gather_all) (cinfo, coef->whole_image);
+    coef->gather_all = TRUE;
+    coef->pub.compress_data = compress_first_pass;
+    break;
   case JBUF_CRANK_DEST:
     if (coef->whole_image[0] == NULL)
       ERREXIT(cinfo, JERR_BAD_BUFFER_MODE);
@@ -250,6 +269,7 @@ compress_first_pass (j_compress_ptr cinfo, JSAMPIMAGE input_buf)
   JCOEF lastDC;
   jpeg_component_info *compptr;
   JBLOCKARRAY buffer;
+  JBLOCKARRAY comp_buffer[MAX_COMPONENTS];
   JBLOCKROW thisblockrow, lastblockrow;
 
   for (ci = 0, compptr = cinfo->comp_info; ci < cinfo->num_components;
@@ -259,6 +279,7 @@ compress_first_pass (j_compress_ptr cinfo, JSAMPIMAGE input_buf)
       ((j_common_ptr) cinfo, coef->whole_image[ci],
        coef->iMCU_row_num * compptr->v_samp_factor,
        (JDIMENSION) compptr->v_samp_factor, TRUE);
+    comp_buffer[ci] = buffer;
     /* Count non-dummy DCT block rows in this iMCU row. */
     if (coef->iMCU_row_num < last_iMCU_row)
       block_rows = compptr->v_samp_factor;
@@ -321,6 +342,17 @@ compress_first_pass (j_compress_ptr cinfo, JSAMPIMAGE input_buf)
    * A suspension return will result in redoing all the work above next time.
    */
 
+  if (coef->gather_all) {
+    /* Count symbols for every scan while this iMCU row is at hand;
+     * there is no output, so no suspension, in this pass.
+     */
+    (*cinfo->entropy->gather_iMCU_row) (cinfo, coef->iMCU_row_num,
+					comp_buffer);
+    coef->iMCU_row_num++;
+    start_iMCU_row(cinfo);
+    return TRUE;
+  }
+
   /* Emit data to the entropy encoder, sharing code with subsequent passes */
   return compress_output(cinfo, input_buf);
 }
@@ -416,18 +448,25 @@ jinit_c_coef_controller (j_compress_ptr cinfo, boolean need_full_buffer)
 #ifdef FULL_COEF_BUFFER_SUPPORTED
     /* Allocate a full-image virtual array for each component, */
     /* padded to a multiple of samp_factor DCT blocks in each direction. */
-    int ci;
+    int ci, access_rows;
     jpeg_component_info *compptr;
 
     for (ci = 0, compptr = cinfo->comp_info; ci < cinfo->num_components;
 	 ci++, compptr++) {
+      access_rows = compptr->v_samp_factor;
+#ifdef C_PARALLEL_HUFF_SUPPORTED
+      /* Parallel scan encoding reads the whole image at once */
+      if (cinfo->num_threads > 1 && cinfo->progressive_mode)
+	access_rows = (int) jround_up((long) compptr->height_in_blocks,
+				      (long) compptr->v_samp_factor);
+#endif
       coef->whole_image[ci] = (*cinfo->mem->request_virt_barray)
 	((j_common_ptr) cinfo, JPOOL_IMAGE, FALSE,
 	 (JDIMENSION) jround_up((long) compptr->width_in_blocks,
 				(long) compptr->h_samp_factor),
 	 (JDIMENSION) jround_up((long) compptr->height_in_blocks,
 				(long) compptr->v_samp_factor),
-	 (JDIMENSION) compptr->v_samp_factor);
+	 (JDIMENSION) access_rows);
     }
 #else
     ERREXIT(cinfo, JERR_BAD_BUFFER_MODE);
@@ -15,6 +15,7 @@
 #include "jinclude.h"
 #include "jpeglib.h"
 #include "jdct.h"		/* Private declarations for DCT subsystem */
+#include "jsimd.h"
 
 
 /* Private subobject for this module */
@@ -41,6 +42,29 @@ typedef struct {
 typedef my_fdct_controller * my_fdct_ptr;
 
 
+/*
+ * Find space for the divisor table for quant table qtblno.
+ * *valid is set TRUE if the table already holds the right values,
+ * which can happen only in reuse mode.
+ */
+
+LOCAL(void *)
+divisor_table (j_compress_ptr cinfo, int qtblno, void * table, size_t size,
+	       boolean * valid)
+{
+  *valid = FALSE;
+  if (cinfo->mem->reuse_image_pools) {
+    *valid = jreuse_quant_table((j_common_ptr) cinfo, qtblno,
+				(int) cinfo->dct_method,
+				cinfo->quant_tbl_ptrs[qtblno], size, &table);
+  } else if (table == NULL) {
+    table = (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
+					size);
+  }
+  return table;
+}
+
+
 /*
  * Initialize for a processing pass.
  * Verify that all referenced Q-tables are present, and set up
@@ -58,6 +82,7 @@ start_pass_fdctmgr (j_compress_ptr cinfo)
   jpeg_component_info *compptr;
   JQUANT_TBL * qtbl;
   DCTELEM * dtbl;
+  boolean valid;
 
   for (ci = 0, compptr = cinfo->comp_info; ci < cinfo->num_components;
        ci++, compptr++) {
@@ -75,12 +100,11 @@ start_pass_fdctmgr (j_compress_ptr cinfo)
       /* For LL&M IDCT method, divisors are equal to raw quantization
        * coefficients multiplied by 8 (to counteract scaling).
        */
-      if (fdct->divisors[qtblno] == NULL) {
-	fdct->divisors[qtblno] = (DCTELEM *)
-	  (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
-				      DCTSIZE2 * SIZEOF(DCTELEM));
-      }
-      dtbl = fdct->divisors[qtblno];
+      dtbl = fdct->divisors[qtblno] = (DCTELEM *)
+	divisor_table(cinfo, qtblno, (void *) fdct->divisors[qtblno],
+		      DCTSIZE2 * SIZEOF(DCTELEM), &valid);
+      if (valid)
+	break;
       for (i = 0; i < DCTSIZE2; i++) {
 	dtbl[i] = ((DCTELEM) qtbl->quantval[i]) << 3;
       }
@@ -109,12 +133,11 @@ start_pass_fdctmgr (j_compress_ptr cinfo)
 	};
 	SHIFT_TEMPS
 
-	if (fdct->divisors[qtblno] == NULL) {
-	  fdct->divisors[qtblno] = (DCTELEM *)
-	    (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
-					DCTSIZE2 * SIZEOF(DCTELEM));
-	}
-	dtbl = fdct->divisors[qtblno];
+	dtbl = fdct->divisors[qtblno] = (DCTELEM *)
+	  divisor_table(cinfo, qtblno, (void *) fdct->divisors[qtblno],
+			DCTSIZE2 * SIZEOF(DCTELEM), &valid);
+	if (valid)
+	  break;
 	for (i = 0; i < DCTSIZE2; i++) {
 	  dtbl[i] = (DCTELEM)
 	    DESCALE(MULTIPLY16V16((INT32) qtbl->quantval[i],
@@ -142,12 +165,11 @@ start_pass_fdctmgr (j_compress_ptr cinfo)
 	  1.0, 0.785694958, 0.541196100, 0.275899379
 	};
 
-	if (fdct->float_divisors[qtblno] == NULL) {
-	  fdct->float_divisors[qtblno] = (FAST_FLOAT *)
-	    (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
-					DCTSIZE2 * SIZEOF(FAST_FLOAT));
-	}
-	fdtbl = fdct->float_divisors[qtblno];
+	fdtbl = fdct->float_divisors[qtblno] = (FAST_FLOAT *)
+	  divisor_table(cinfo, qtblno, (void *) fdct->float_divisors[qtblno],
+			DCTSIZE2 * SIZEOF(FAST_FLOAT), &valid);
+	if (valid)
+	  break;
 	i = 0;
 	for (row = 0; row < DCTSIZE; row++) {
 	  for (col = 0; col < DCTSIZE; col++) {
@@ -358,6 +380,10 @@ jinit_forward_dct (j_compress_ptr cinfo)
   case JDCT_ISLOW:
     fdct->pub.forward_DCT = forward_DCT;
     fdct->do_dct = jpeg_fdct_islow;
+#ifdef SIMD_SUPPORTED
+    if (jsimd_can_fdct_islow())
+      fdct->do_dct = jsimd_fdct_islow;
+#endif
     break;
 #endif
 #ifdef DCT_IFAST_SUPPORTED
@@ -151,9 +151,9 @@ start_pass_huff (j_compress_ptr cinfo, boolean gather_statistics)
     } else {
       /* Compute derived values for Huffman tables */
       /* We may do this more than once for a table, but it's not expensive */
-      jpeg_make_c_derived_tbl(cinfo, cinfo->dc_huff_tbl_ptrs[dctbl],
+      jpeg_make_c_derived_tbl(cinfo, TRUE, dctbl,
 			      & entropy->dc_derived_tbls[dctbl]);
-      jpeg_make_c_derived_tbl(cinfo, cinfo->ac_huff_tbl_ptrs[actbl],
+      jpeg_make_c_derived_tbl(cinfo, FALSE, actbl,
 			      & entropy->ac_derived_tbls[actbl]);
     }
     /* Initialize DC predictions to 0 */
@@ -176,20 +176,34 @@ start_pass_huff (j_compress_ptr cinfo, boolean gather_statistics)
  */
 
 GLOBAL(void)
-jpeg_make_c_derived_tbl (j_compress_ptr cinfo, JHUFF_TBL * htbl,
+jpeg_make_c_derived_tbl (j_compress_ptr cinfo, boolean isDC, int tblno,
 			 c_derived_tbl ** pdtbl)
 {
+  JHUFF_TBL *htbl;
   c_derived_tbl *dtbl;
   int p, i, l, lastp, si;
   char huffsize[257];
   unsigned int huffcode[257];
   unsigned int code;
 
-  /* Allocate a workspace if we haven't already done so. */
-  if (*pdtbl == NULL)
+  htbl = isDC ? cinfo->dc_huff_tbl_ptrs[tblno]
+	      : cinfo->ac_huff_tbl_ptrs[tblno];
+
+  if (cinfo->mem->reuse_image_pools) {
+    /* Use the kept table; it needn't be rebuilt if htbl is unchanged. */
+    void * kept;
+    boolean valid = jreuse_huff_table((j_common_ptr) cinfo, isDC, tblno, htbl,
+				      SIZEOF(c_derived_tbl), &kept);
+
+    *pdtbl = (c_derived_tbl *) kept;
+    if (valid)
+      return;
+  } else if (*pdtbl == NULL) {
+    /* Allocate a workspace if we haven't already done so. */
     *pdtbl = (c_derived_tbl *)
       (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
 				  SIZEOF(c_derived_tbl));
+  }
   dtbl = *pdtbl;
   
   /* Figure C.1: make table of Huffman code length for each symbol */
@@ -835,6 +849,8 @@ jinit_huff_encoder (j_compress_ptr cinfo)
 				SIZEOF(huff_entropy_encoder));
   cinfo->entropy = (struct jpeg_entropy_encoder *) entropy;
   entropy->pub.start_pass = start_pass_huff;
+  entropy->pub.start_gather_all = NULL; /* only for progressive mode */
+  entropy->pub.gather_iMCU_row = NULL;
 
   /* Mark tables unallocated */
   for (i = 0; i < NUM_HUFF_TBLS; i++) {
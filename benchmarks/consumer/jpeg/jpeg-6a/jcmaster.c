@@ -33,6 +33,11 @@ typedef struct {
   int total_passes;		/* total # of passes needed */
 
   int scan_number;		/* current index in scan_info[] */
+
+  /* TRUE if the main pass gathers the statistics for all scans, so that
+   * no Huffman optimization passes are needed after it.
+   */
+  boolean gather_all;
 } my_comp_master;
 
 typedef my_comp_master * my_master_ptr;
@@ -403,10 +408,15 @@ prepare_for_pass (j_compress_ptr cinfo)
       (*cinfo->prep->start_pass) (cinfo, JBUF_PASS_THRU);
     }
     (*cinfo->fdct->start_pass) (cinfo);
-    (*cinfo->entropy->start_pass) (cinfo, cinfo->optimize_coding);
-    (*cinfo->coef->start_pass) (cinfo,
-				(master->total_passes > 1 ?
-				 JBUF_SAVE_AND_PASS : JBUF_PASS_THRU));
+    if (master->gather_all) {
+      /* The coefficient controller starts the entropy encoder for this */
+      (*cinfo->coef->start_pass) (cinfo, JBUF_SAVE_AND_GATHER);
+    } else {
+      (*cinfo->entropy->start_pass) (cinfo, cinfo->optimize_coding);
+      (*cinfo->coef->start_pass) (cinfo,
+				  (master->total_passes > 1 ?
+				   JBUF_SAVE_AND_PASS : JBUF_PASS_THRU));
+    }
     (*cinfo->main->start_pass) (cinfo, JBUF_PASS_THRU);
     if (cinfo->optimize_coding) {
       /* No immediate data output; postpone writing frame/scan headers */
@@ -437,7 +447,7 @@ prepare_for_pass (j_compress_ptr cinfo)
   case output_pass:
     /* Do a data-output pass. */
     /* We need not repeat per-scan setup if prior optimization pass did it. */
-    if (! cinfo->optimize_coding) {
+    if (! cinfo->optimize_coding || master->gather_all) {
       select_scan_parameters(cinfo);
       per_scan_setup(cinfo);
     }
@@ -513,7 +523,7 @@ finish_pass_master (j_compress_ptr cinfo)
     break;
   case output_pass:
     /* next pass is either optimization or output of next scan */
-    if (cinfo->optimize_coding)
+    if (cinfo->optimize_coding && ! master->gather_all)
       master->pass_type = huff_opt_pass;
     master->scan_number++;
     break;
@@ -571,7 +581,15 @@ jinit_c_master_control (j_compress_ptr cinfo, boolean transcode_only)
   }
   master->scan_number = 0;
   master->pass_number = 0;
-  if (cinfo->optimize_coding)
+  /* A progressive encoder can gather statistics for all of its scans
+   * while the main pass produces the coefficients; then only the output
+   * passes remain.  (jcphuff.c provides this; jchuff.c does not.)
+   */
+  master->gather_all = (cinfo->progressive_mode && cinfo->optimize_coding &&
+			! transcode_only);
+  if (master->gather_all)
+    master->total_passes = cinfo->num_scans + 1;
+  else if (cinfo->optimize_coding)
     master->total_passes = cinfo->num_scans * 2;
   else
     master->total_passes = cinfo->num_scans;
@@ -16,6 +16,8 @@
 #undef NEED_SHORT_EXTERNAL_NAMES
 /* Define this if you get warnings about undefined structures. */
 #undef INCOMPLETE_TYPES_BROKEN
+/* Define this if mmap() is available (jdatamap.c). */
+#define HAVE_MMAP 
 
 #ifdef JPEG_INTERNALS
 
@@ -42,4 +44,7 @@
 /* Define this if you want percent-done progress reports from cjpeg/djpeg. */
 #undef PROGRESS_REPORT
 
+/* Define this if opendir() is available (batch mode in cjpeg/djpeg). */
+#define HAVE_OPENDIR
+
 #endif /* JPEG_CJPEG_DJPEG */
@@ -307,6 +307,9 @@ jpeg_set_defaults (j_compress_ptr cinfo)
   /* DCT algorithm preference */
   cinfo->dct_method = JDCT_DEFAULT;
 
+  /* No parallel entropy encoding unless asked */
+  cinfo->num_threads = 1;
+
   /* No restart markers */
   cinfo->restart_interval = 0;
   cinfo->restart_in_rows = 0;
@@ -19,6 +19,12 @@
 
 #ifdef C_PROGRESSIVE_SUPPORTED
 
+#ifdef C_PARALLEL_HUFF_SUPPORTED
+#include <pthread.h>
+#endif
+
+struct phuff_scan_struct;	/* see below */
+
 /* Expanded entropy encoder object for progressive Huffman encoding. */
 
 typedef struct {
@@ -26,6 +32,7 @@ typedef struct {
 
   /* Mode flag: TRUE for optimization, FALSE for actual data output */
   boolean gather_statistics;
+  long extra_bits;		/* # of non-Huffman-code bits seen in gather */
 
   /* Bit-level coding status.
    * next_output_byte/free_in_buffer are local copies of cinfo->dest fields.
@@ -57,10 +64,46 @@ typedef struct {
 
   /* Statistics tables for optimization; again, one set is enough */
   long * count_ptrs[NUM_HUFF_TBLS];
+
+  /* When the statistics for all scans are gathered in the first pass,
+   * each scan has its own state, and output passes take them in order.
+   */
+  boolean gather_all;		/* TRUE if start_gather_all was used */
+  struct phuff_scan_struct * scans; /* per-scan state, num_scans entries */
+  int next_scan;		/* index of scan for next output pass */
+  jvirt_barray_ptr * coef_arrays; /* the full-image coefficient arrays */
+  struct phuff_scan_struct * cur_scan; /* scan being copied out, if any */
 } phuff_entropy_encoder;
 
 typedef phuff_entropy_encoder * phuff_entropy_ptr;
 
+/* Per-scan state for gathering all statistics in one pass.  The private
+ * copy of the compress object holds the scan's parameters (as
+ * select_scan_parameters and per_scan_setup would set them in the real
+ * one) and links to the scan's own entropy encoder and destination, so
+ * the ordinary encode_mcu routines work on it unchanged.
+ */
+
+typedef struct phuff_scan_struct {
+  struct jpeg_compress_struct cinfo; /* private copy; must be first */
+  phuff_entropy_encoder entropy; /* its entropy encoder state */
+  struct jpeg_destination_mgr dest; /* its destination */
+  JHUFF_TBL * htbls[NUM_HUFF_TBLS]; /* optimal tables, NULL if unused */
+  long total_bits;		/* size of the scan's coded data, in bits */
+#ifdef C_PARALLEL_HUFF_SUPPORTED
+  /* Data of a scan encoded ahead of its output pass by a worker thread */
+  c_derived_tbl derived_tbls[NUM_HUFF_TBLS]; /* private to this scan */
+  JOCTET * buffer;		/* coded data */
+  size_t buffer_size;		/* allocated size of buffer */
+  size_t data_len;		/* # of bytes of coded data in buffer */
+  boolean overflow;		/* TRUE if the buffer proved too small */
+  boolean encoded;		/* TRUE if buffer holds the whole scan */
+  JOCTET spill[64];		/* dumping ground after an overflow */
+#endif
+} phuff_scan;
+
+typedef phuff_scan * phuff_scan_ptr;
+
 /* MAX_CORR_BITS is the number of bits the AC refinement correction-bit
  * buffer can hold.  Larger sizes may slightly improve compression, but
  * 1000 is already well into the realm of overkill.
@@ -96,6 +139,14 @@ METHODDEF(boolean) encode_mcu_AC_refine JPP((j_compress_ptr cinfo,
 					     JBLOCKROW *MCU_data));
 METHODDEF(void) finish_pass_phuff JPP((j_compress_ptr cinfo));
 METHODDEF(void) finish_pass_gather_phuff JPP((j_compress_ptr cinfo));
+METHODDEF(void) finish_pass_gather_all JPP((j_compress_ptr cinfo));
+LOCAL(void) install_scan_tables JPP((j_compress_ptr cinfo));
+#ifdef C_PARALLEL_HUFF_SUPPORTED
+LOCAL(void) encode_scans_parallel JPP((j_compress_ptr cinfo));
+METHODDEF(boolean) encode_mcu_copied JPP((j_compress_ptr cinfo,
+					  JBLOCKROW *MCU_data));
+METHODDEF(void) finish_pass_copy JPP((j_compress_ptr cinfo));
+#endif
 
 
 /*
@@ -112,6 +163,10 @@ start_pass_phuff (j_compress_ptr cinfo, boolean gather_statistics)
 
   entropy->cinfo = cinfo;
   entropy->gather_statistics = gather_statistics;
+  entropy->extra_bits = 0;
+
+  if (entropy->gather_all && ! gather_statistics)
+    install_scan_tables(cinfo);
 
   is_DC_band = (cinfo->Ss == 0);
 
@@ -173,12 +228,8 @@ start_pass_phuff (j_compress_ptr cinfo, boolean gather_statistics)
     } else {
       /* Compute derived values for Huffman tables */
       /* We may do this more than once for a table, but it's not expensive */
-      if (is_DC_band)
-        jpeg_make_c_derived_tbl(cinfo, cinfo->dc_huff_tbl_ptrs[tbl],
-				& entropy->derived_tbls[tbl]);
-      else
-        jpeg_make_c_derived_tbl(cinfo, cinfo->ac_huff_tbl_ptrs[tbl],
-				& entropy->derived_tbls[tbl]);
+      jpeg_make_c_derived_tbl(cinfo, is_DC_band, tbl,
+			      & entropy->derived_tbls[tbl]);
     }
   }
 
@@ -193,6 +244,14 @@ start_pass_phuff (j_compress_ptr cinfo, boolean gather_statistics)
   /* Initialize restart stuff */
   entropy->restarts_to_go = cinfo->restart_interval;
   entropy->next_restart_num = 0;
+
+#ifdef C_PARALLEL_HUFF_SUPPORTED
+  /* A scan already encoded by a worker thread need only be copied out */
+  if (entropy->cur_scan != NULL) {
+    entropy->pub.encode_mcu = encode_mcu_copied;
+    entropy->pub.finish_pass = finish_pass_copy;
+  }
+#endif
 }
 
 
@@ -243,8 +302,10 @@ emit_bits (phuff_entropy_ptr entropy, unsigned int code, int size)
   if (size == 0)
     ERREXIT(entropy->cinfo, JERR_HUFF_MISSING_CODE);
 
-  if (entropy->gather_statistics)
-    return;			/* do nothing if we're only getting stats */
+  if (entropy->gather_statistics) {
+    entropy->extra_bits += size; /* only count them if getting stats */
+    return;
+  }
 
   put_buffer &= (((INT32) 1)<<size) - 1; /* mask off any extra bits in code */
   
@@ -304,8 +365,10 @@ LOCAL(void)
 emit_buffered_bits (phuff_entropy_ptr entropy, char * bufstart,
 		    unsigned int nbits)
 {
-  if (entropy->gather_statistics)
-    return;			/* no real work */
+  if (entropy->gather_statistics) {
+    entropy->extra_bits += nbits; /* no real work */
+    return;
+  }
 
   while (nbits > 0) {
     emit_bits(entropy, (unsigned int) (*bufstart), 1);
@@ -802,6 +865,505 @@ finish_pass_gather_phuff (j_compress_ptr cinfo)
 }
 
 
+/*
+ * Gathering the statistics for all scans in one pass.
+ *
+ * In the usual scheme, each scan of an optimized progressive file takes
+ * a statistics pass and an output pass over the whole coefficient buffer.
+ * Instead, the coefficient controller can hand us each iMCU row as soon
+ * as it has been transformed, and we count the symbols of every scan in
+ * it while it is still in cache.  Then only the output passes remain,
+ * each of which begins by installing the tables worked out for its scan.
+ */
+
+/* Set up a private copy of the compress object for one scan */
+
+LOCAL(void)
+setup_scan_copy (j_compress_ptr cinfo, phuff_scan_ptr scan,
+		 const jpeg_scan_info * scanptr)
+{
+  j_compress_ptr sinfo = &scan->cinfo;
+  int ci, mcublks;
+  jpeg_component_info *compptr;
+
+  MEMCOPY(sinfo, cinfo, SIZEOF(struct jpeg_compress_struct));
+
+  /* As select_scan_parameters does */
+  sinfo->comps_in_scan = scanptr->comps_in_scan;
+  for (ci = 0; ci < scanptr->comps_in_scan; ci++) {
+    sinfo->cur_comp_info[ci] =
+      &cinfo->comp_info[scanptr->component_index[ci]];
+  }
+  sinfo->Ss = scanptr->Ss;
+  sinfo->Se = scanptr->Se;
+  sinfo->Ah = scanptr->Ah;
+  sinfo->Al = scanptr->Al;
+
+  /* As per_scan_setup does, except that the MCU dimensions in the shared
+   * component info are left alone (see encode_MCU_rows).
+   */
+  if (sinfo->comps_in_scan == 1) {
+    compptr = sinfo->cur_comp_info[0];
+    sinfo->MCUs_per_row = compptr->width_in_blocks;
+    sinfo->MCU_rows_in_scan = compptr->height_in_blocks;
+    sinfo->blocks_in_MCU = 1;
+    sinfo->MCU_membership[0] = 0;
+  } else {
+    if (sinfo->comps_in_scan <= 0 || sinfo->comps_in_scan > MAX_COMPS_IN_SCAN)
+      ERREXIT2(cinfo, JERR_COMPONENT_COUNT, sinfo->comps_in_scan,
+	       MAX_COMPS_IN_SCAN);
+    sinfo->MCUs_per_row = (JDIMENSION)
+      jdiv_round_up((long) cinfo->image_width,
+		    (long) (cinfo->max_h_samp_factor*DCTSIZE));
+    sinfo->MCU_rows_in_scan = (JDIMENSION)
+      jdiv_round_up((long) cinfo->image_height,
+		    (long) (cinfo->max_v_samp_factor*DCTSIZE));
+    sinfo->blocks_in_MCU = 0;
+    for (ci = 0; ci < sinfo->comps_in_scan; ci++) {
+      compptr = sinfo->cur_comp_info[ci];
+      mcublks = compptr->h_samp_factor * compptr->v_samp_factor;
+      if (sinfo->blocks_in_MCU + mcublks > C_MAX_BLOCKS_IN_MCU)
+	ERREXIT(cinfo, JERR_BAD_MCU_SIZE);
+      while (mcublks-- > 0) {
+	sinfo->MCU_membership[sinfo->blocks_in_MCU++] = ci;
+      }
+    }
+  }
+  if (sinfo->restart_in_rows > 0) {
+    long nominal = (long) sinfo->restart_in_rows * (long) sinfo->MCUs_per_row;
+    sinfo->restart_interval = (unsigned int) MIN(nominal, 65535L);
+  }
+
+  /* Link in the scan's own entropy encoder and destination */
+  MEMZERO(&scan->entropy, SIZEOF(phuff_entropy_encoder));
+  scan->entropy.pub.start_pass = start_pass_phuff;
+  sinfo->entropy = (struct jpeg_entropy_encoder *) &scan->entropy;
+  MEMZERO(&scan->dest, SIZEOF(struct jpeg_destination_mgr));
+  sinfo->dest = &scan->dest;
+  for (ci = 0; ci < NUM_HUFF_TBLS; ci++)
+    scan->htbls[ci] = NULL;
+  scan->total_bits = 0;
+#ifdef C_PARALLEL_HUFF_SUPPORTED
+  scan->encoded = FALSE;
+#endif
+}
+
+
+/*
+ * Feed MCU_rows rows of MCUs to the scan's encode_mcu routine.
+ * buffer[ci] holds the block rows of the scan's ci'th component.
+ * A noninterleaved scan has one block per MCU; an interleaved one has
+ * h_samp_factor by v_samp_factor blocks of each component.
+ */
+
+LOCAL(void)
+encode_MCU_rows (j_compress_ptr sinfo, JBLOCKARRAY * buffer,
+		 JDIMENSION MCU_rows)
+{
+  JBLOCKROW MCU_buffer[C_MAX_BLOCKS_IN_MCU];
+  JDIMENSION MCU_row, MCU_col_num, start_col;
+  int blkn, ci, xindex, yindex, MCU_width, MCU_height;
+  JBLOCKROW buffer_ptr;
+  jpeg_component_info *compptr;
+
+  for (MCU_row = 0; MCU_row < MCU_rows; MCU_row++) {
+    for (MCU_col_num = 0; MCU_col_num < sinfo->MCUs_per_row; MCU_col_num++) {
+      /* Construct list of pointers to DCT blocks belonging to this MCU */
+      blkn = 0;
+      for (ci = 0; ci < sinfo->comps_in_scan; ci++) {
+	compptr = sinfo->cur_comp_info[ci];
+	if (sinfo->comps_in_scan == 1) {
+	  MCU_width = MCU_height = 1;
+	} else {
+	  MCU_width = compptr->h_samp_factor;
+	  MCU_height = compptr->v_samp_factor;
+	}
+	start_col = MCU_col_num * MCU_width;
+	for (yindex = 0; yindex < MCU_height; yindex++) {
+	  buffer_ptr = buffer[ci][MCU_row * MCU_height + yindex] + start_col;
+	  for (xindex = 0; xindex < MCU_width; xindex++) {
+	    MCU_buffer[blkn++] = buffer_ptr++;
+	  }
+	}
+      }
+      (void) (*sinfo->entropy->encode_mcu) (sinfo, MCU_buffer);
+    }
+  }
+}
+
+
+/*
+ * Initialize for gathering the statistics of all scans.
+ */
+
+METHODDEF(void)
+start_gather_all_phuff (j_compress_ptr cinfo, jvirt_barray_ptr * coef_arrays)
+{
+  phuff_entropy_ptr entropy = (phuff_entropy_ptr) cinfo->entropy;
+  phuff_scan_ptr scan;
+  int scanno;
+
+  entropy->gather_all = TRUE;
+  entropy->coef_arrays = coef_arrays;
+  entropy->next_scan = 0;
+  entropy->cur_scan = NULL;
+  entropy->scans = (phuff_scan_ptr)
+    (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
+				(size_t) cinfo->num_scans * SIZEOF(phuff_scan));
+
+  for (scanno = 0; scanno < cinfo->num_scans; scanno++) {
+    scan = &entropy->scans[scanno];
+    setup_scan_copy(cinfo, scan, &cinfo->scan_info[scanno]);
+    start_pass_phuff(&scan->cinfo, TRUE);
+  }
+
+  entropy->pub.finish_pass = finish_pass_gather_all;
+}
+
+
+/*
+ * Count the symbols of all scans in one iMCU row.
+ * buffer[ci] holds the row's blocks for component index ci.
+ */
+
+METHODDEF(void)
+gather_iMCU_row_phuff (j_compress_ptr cinfo, JDIMENSION iMCU_row_num,
+		       JBLOCKARRAY * buffer)
+{
+  phuff_entropy_ptr entropy = (phuff_entropy_ptr) cinfo->entropy;
+  JBLOCKARRAY scan_buffer[MAX_COMPS_IN_SCAN];
+  JDIMENSION MCU_rows;
+  int scanno, ci;
+  j_compress_ptr sinfo;
+  jpeg_component_info *compptr;
+
+  for (scanno = 0; scanno < cinfo->num_scans; scanno++) {
+    sinfo = &entropy->scans[scanno].cinfo;
+    if (sinfo->Ss == 0 && sinfo->Ah != 0)
+      continue;			/* DC refinement needs no table */
+    for (ci = 0; ci < sinfo->comps_in_scan; ci++)
+      scan_buffer[ci] = buffer[sinfo->cur_comp_info[ci]->component_index];
+    if (sinfo->comps_in_scan > 1)
+      MCU_rows = 1;
+    else {
+      /* Count the non-dummy block rows of the component */
+      compptr = sinfo->cur_comp_info[0];
+      if (iMCU_row_num < cinfo->total_iMCU_rows - 1)
+	MCU_rows = compptr->v_samp_factor;
+      else {
+	MCU_rows = compptr->height_in_blocks % compptr->v_samp_factor;
+	if (MCU_rows == 0) MCU_rows = compptr->v_samp_factor;
+      }
+    }
+    encode_MCU_rows(sinfo, scan_buffer, MCU_rows);
+  }
+}
+
+
+/*
+ * Finish the pass that gathered all statistics: create the Huffman tables
+ * for every scan, and keep the coded size of each scan for later.
+ */
+
+METHODDEF(void)
+finish_pass_gather_all (j_compress_ptr cinfo)
+{
+  phuff_entropy_ptr entropy = (phuff_entropy_ptr) cinfo->entropy;
+  phuff_scan_ptr scan;
+  phuff_entropy_ptr sentropy;
+  j_compress_ptr sinfo;
+  boolean is_DC_band;
+  int scanno, ci, tbl, l, i, p;
+  JHUFF_TBL * htbl;
+  long freq[257];
+
+  for (scanno = 0; scanno < cinfo->num_scans; scanno++) {
+    scan = &entropy->scans[scanno];
+    sinfo = &scan->cinfo;
+    sentropy = &scan->entropy;
+    is_DC_band = (sinfo->Ss == 0);
+    if (is_DC_band && sinfo->Ah != 0) {
+      /* DC refinement: one bit per block */
+      scan->total_bits = (long) sinfo->MCUs_per_row *
+	(long) sinfo->MCU_rows_in_scan * (long) sinfo->blocks_in_MCU;
+      continue;
+    }
+    /* Flush out buffered data (all we care about is counting the EOB symbol) */
+    emit_eobrun(sentropy);
+    scan->total_bits = sentropy->extra_bits;
+
+    for (ci = 0; ci < sinfo->comps_in_scan; ci++) {
+      tbl = is_DC_band ? sinfo->cur_comp_info[ci]->dc_tbl_no
+		       : sinfo->cur_comp_info[ci]->ac_tbl_no;
+      if (scan->htbls[tbl] != NULL)
+	continue;		/* already done for this scan */
+      htbl = (JHUFF_TBL *)
+	(*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
+				    SIZEOF(JHUFF_TBL));
+      /* jpeg_gen_optimal_table clobbers the counts, so give it a copy */
+      MEMCOPY(freq, sentropy->count_ptrs[tbl], SIZEOF(freq));
+      jpeg_gen_optimal_table(cinfo, htbl, freq);
+      scan->htbls[tbl] = htbl;
+      if (is_DC_band)
+	sinfo->dc_huff_tbl_ptrs[tbl] = htbl;
+      else
+	sinfo->ac_huff_tbl_ptrs[tbl] = htbl;
+      /* Add up the size of the codes; symbols are in code-length order */
+      p = 0;
+      for (l = 1; l <= 16; l++) {
+	for (i = 0; i < (int) htbl->bits[l]; i++)
+	  scan->total_bits += sentropy->count_ptrs[tbl][htbl->huffval[p++]] * l;
+      }
+    }
+  }
+
+#ifdef C_PARALLEL_HUFF_SUPPORTED
+  if (cinfo->num_threads > 1)
+    encode_scans_parallel(cinfo);
+#endif
+}
+
+
+/*
+ * At the start of an output pass, put the next scan's tables in the
+ * compress object, where the marker writer and start_pass look for them.
+ */
+
+LOCAL(void)
+install_scan_tables (j_compress_ptr cinfo)
+{
+  phuff_entropy_ptr entropy = (phuff_entropy_ptr) cinfo->entropy;
+  phuff_scan_ptr scan;
+  JHUFF_TBL **htblptr;
+  int tbl;
+
+  if (entropy->next_scan >= cinfo->num_scans)
+    ERREXIT(cinfo, JERR_BAD_STATE);
+  scan = &entropy->scans[entropy->next_scan++];
+
+  for (tbl = 0; tbl < NUM_HUFF_TBLS; tbl++) {
+    if (scan->htbls[tbl] == NULL)
+      continue;
+    if (scan->cinfo.Ss == 0)
+      htblptr = & cinfo->dc_huff_tbl_ptrs[tbl];
+    else
+      htblptr = & cinfo->ac_huff_tbl_ptrs[tbl];
+    if (*htblptr == NULL)
+      *htblptr = jpeg_alloc_huff_table((j_common_ptr) cinfo);
+    MEMCOPY(*htblptr, scan->htbls[tbl], SIZEOF(JHUFF_TBL));
+  }
+
+  entropy->cur_scan = NULL;
+#ifdef C_PARALLEL_HUFF_SUPPORTED
+  if (scan->encoded)
+    entropy->cur_scan = scan;
+#endif
+}
+
+
+#ifdef C_PARALLEL_HUFF_SUPPORTED
+
+/*
+ * Encoding the scans in parallel.
+ *
+ * Once all tables are known, the scans are independent of one another,
+ * so each can be encoded into a memory buffer of its own by a separate
+ * thread.  Each output pass then just copies its scan's data out.
+ * The buffers are sized from the gathered statistics, with some slack
+ * for stuffed zero bytes; a scan that still does not fit is marked
+ * and left to be encoded in its output pass as usual.
+ */
+
+METHODDEF(boolean)
+spill_output_buffer (j_compress_ptr cinfo)
+{
+  phuff_scan_ptr scan = (phuff_scan_ptr) cinfo;
+
+  scan->overflow = TRUE;
+  scan->dest.next_output_byte = scan->spill;
+  scan->dest.free_in_buffer = SIZEOF(scan->spill);
+  return TRUE;
+}
+
+
+typedef struct {
+  phuff_scan_ptr scans;
+  int * order;			/* scan indexes, largest scan first */
+  int num_scans;
+  JBLOCKARRAY buffer[MAX_COMPONENTS]; /* whole coefficient arrays */
+  pthread_mutex_t lock;		/* protects next_scan */
+  int next_scan;		/* next entry of order[] to be handed out */
+} encode_job;
+
+
+LOCAL(void)
+encode_scans (encode_job * job)
+{
+  JBLOCKARRAY scan_buffer[MAX_COMPS_IN_SCAN];
+  phuff_scan_ptr scan;
+  j_compress_ptr sinfo;
+  int n, ci;
+
+  for (;;) {
+    pthread_mutex_lock(&job->lock);
+    n = job->next_scan++;
+    pthread_mutex_unlock(&job->lock);
+    if (n >= job->num_scans)
+      break;
+    scan = &job->scans[job->order[n]];
+    sinfo = &scan->cinfo;
+    for (ci = 0; ci < sinfo->comps_in_scan; ci++)
+      scan_buffer[ci] = job->buffer[sinfo->cur_comp_info[ci]->component_index];
+    /* With tables made from this very data, no code can be missing,
+     * so the encoder has no occasion to report an error here.
+     */
+    encode_MCU_rows(sinfo, scan_buffer, sinfo->MCU_rows_in_scan);
+    (*sinfo->entropy->finish_pass) (sinfo);
+    scan->data_len = scan->buffer_size - scan->dest.free_in_buffer;
+    scan->encoded = ! scan->overflow;
+  }
+}
+
+
+static void *
+encode_thread (void * arg)
+{
+  encode_scans((encode_job *) arg);
+  return NULL;
+}
+
+
+LOCAL(void)
+encode_scans_parallel (j_compress_ptr cinfo)
+{
+  phuff_entropy_ptr entropy = (phuff_entropy_ptr) cinfo->entropy;
+  phuff_scan_ptr scan;
+  j_compress_ptr sinfo;
+  encode_job job;
+  pthread_t * threads;
+  c_derived_tbl * dtbl;
+  long nbytes, nrestarts;
+  int scanno, ci, i, j, tbl, nthreads, started;
+  jpeg_component_info *compptr;
+
+  job.scans = entropy->scans;
+  job.num_scans = cinfo->num_scans;
+  job.next_scan = 0;
+  job.order = (int *)
+    (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
+				(size_t) cinfo->num_scans * SIZEOF(int));
+
+  for (scanno = 0; scanno < cinfo->num_scans; scanno++) {
+    scan = &entropy->scans[scanno];
+    sinfo = &scan->cinfo;
+    /* Set up the scan's encoder for output, with tables of its own.
+     * (In reuse mode jpeg_make_c_derived_tbl hands back a kept table
+     * that the next scan would overwrite, so we copy that.)
+     */
+    for (tbl = 0; tbl < NUM_HUFF_TBLS; tbl++)
+      scan->entropy.derived_tbls[tbl] = &scan->derived_tbls[tbl];
+    start_pass_phuff(sinfo, FALSE);
+    for (tbl = 0; tbl < NUM_HUFF_TBLS; tbl++) {
+      dtbl = scan->entropy.derived_tbls[tbl];
+      if (dtbl != &scan->derived_tbls[tbl]) {
+	MEMCOPY(&scan->derived_tbls[tbl], dtbl, SIZEOF(c_derived_tbl));
+	scan->entropy.derived_tbls[tbl] = &scan->derived_tbls[tbl];
+      }
+    }
+    /* Room for the data, one stuffed byte in 16, and the restart markers */
+    nbytes = scan->total_bits / 8L;
+    nbytes += nbytes / 16L + 64L;
+    if (sinfo->restart_interval) {
+      nrestarts = (long) sinfo->MCUs_per_row * (long) sinfo->MCU_rows_in_scan
+		  / (long) sinfo->restart_interval;
+      nbytes += nrestarts * 3L;
+    }
+    scan->buffer_size = (size_t) nbytes;
+    scan->buffer = (JOCTET *)
+      (*cinfo->mem->alloc_large) ((j_common_ptr) cinfo, JPOOL_IMAGE,
+				  scan->buffer_size * SIZEOF(JOCTET));
+    scan->overflow = FALSE;
+    scan->dest.next_output_byte = scan->buffer;
+    scan->dest.free_in_buffer = scan->buffer_size;
+    scan->dest.empty_output_buffer = spill_output_buffer;
+    /* Keep the order sorted by decreasing size */
+    for (i = scanno; i > 0; i--) {
+      j = job.order[i-1];
+      if (entropy->scans[j].total_bits >= scan->total_bits)
+	break;
+      job.order[i] = j;
+    }
+    job.order[i] = scanno;
+  }
+
+  /* The whole image must be accessible at once; jccoefct.c allowed for it */
+  for (ci = 0, compptr = cinfo->comp_info; ci < cinfo->num_components;
+       ci++, compptr++) {
+    job.buffer[ci] = (*cinfo->mem->access_virt_barray)
+      ((j_common_ptr) cinfo, entropy->coef_arrays[ci], (JDIMENSION) 0,
+       (JDIMENSION) jround_up((long) compptr->height_in_blocks,
+			      (long) compptr->v_samp_factor), FALSE);
+  }
+
+  /* The calling thread encodes too */
+  nthreads = MIN(cinfo->num_threads, cinfo->num_scans);
+  threads = (pthread_t *)
+    (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
+				(size_t) nthreads * SIZEOF(pthread_t));
+  pthread_mutex_init(&job.lock, NULL);
+  for (started = 1; started < nthreads; started++) {
+    if (pthread_create(&threads[started], NULL, encode_thread,
+		       (void *) &job) != 0)
+      break;
+  }
+  encode_scans(&job);
+  for (i = 1; i < started; i++)
+    pthread_join(threads[i], NULL);
+  pthread_mutex_destroy(&job.lock);
+}
+
+
+/*
+ * Output pass of a scan encoded in parallel: nothing to do per MCU,
+ * and the data is copied to the destination at the end.
+ */
+
+METHODDEF(boolean)
+encode_mcu_copied (j_compress_ptr cinfo, JBLOCKROW *MCU_data)
+{
+  return TRUE;
+}
+
+
+METHODDEF(void)
+finish_pass_copy (j_compress_ptr cinfo)
+{
+  phuff_entropy_ptr entropy = (phuff_entropy_ptr) cinfo->entropy;
+  struct jpeg_destination_mgr * dest = cinfo->dest;
+  phuff_scan_ptr scan = entropy->cur_scan;
+  const JOCTET * data = scan->buffer;
+  size_t len = scan->data_len;
+  size_t n;
+
+  while (len > 0) {
+    if (dest->free_in_buffer == 0) {
+      if (! (*dest->empty_output_buffer) (cinfo))
+	ERREXIT(cinfo, JERR_CANT_SUSPEND);
+      continue;
+    }
+    n = MIN(len, dest->free_in_buffer);
+    MEMCOPY(dest->next_output_byte, data, n * SIZEOF(JOCTET));
+    dest->next_output_byte += n;
+    dest->free_in_buffer -= n;
+    data += n;
+    len -= n;
+  }
+  entropy->cur_scan = NULL;
+}
+
+#endif /* C_PARALLEL_HUFF_SUPPORTED */
+
+
 /*
  * Module initialization routine for progressive Huffman entropy encoding.
  */
@@ -824,6 +1386,10 @@ jinit_phuff_encoder (j_compress_ptr cinfo)
     entropy->count_ptrs[i] = NULL;
   }
   entropy->bit_buffer = NULL;	/* needed only in AC refinement scan */
+  entropy->pub.start_gather_all = start_gather_all_phuff;
+  entropy->pub.gather_iMCU_row = gather_iMCU_row_phuff;
+  entropy->gather_all = FALSE;
+  entropy->cur_scan = NULL;
 }
 
 #endif /* C_PROGRESSIVE_SUPPORTED */
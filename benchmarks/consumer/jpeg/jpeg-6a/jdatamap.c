@@ -0,0 +1,417 @@
+/*
+ * jdatamap.c
+ *
+ * This file is part of the Independent JPEG Group's software.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains a data source and a data destination manager that
+ * access a file through mmap() rather than stdio.  The library then reads
+ * the compressed data straight out of the mapped file, or writes it
+ * straight into it, with no intermediate buffer and no per-buffer
+ * read()/write() calls.
+ *
+ * Only a regular file can be mapped (and, for output, only one open for
+ * both reading and writing).  For anything else --- a pipe, a terminal,
+ * a write-only file --- or on systems without mmap() (HAVE_MMAP not
+ * defined), these managers fall back to ordinary buffered stdio, exactly
+ * as in jdatasrc.c and jdatadst.c, so callers need not care which they get.
+ * IMPORTANT: as in those files, we assume that fread() and fwrite()
+ * transcribe JOCTETs to and from 8-bit bytes on external storage.
+ */
+
+/* this is not a core library module, so it doesn't define JPEG_INTERNALS */
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jerror.h"
+
+#ifdef HAVE_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifndef MAP_FAILED
+#define MAP_FAILED  ((void *) -1)
+#endif
+#endif /* HAVE_MMAP */
+
+#ifndef SEEK_SET		/* pre-ANSI systems may not define this; */
+#define SEEK_SET  0		/* if not, assume 0 is correct */
+#endif
+
+#define INPUT_BUF_SIZE  4096	/* stdio buffer sizes, as in jdatasrc.c */
+#define OUTPUT_BUF_SIZE  4096	/* and jdatadst.c */
+#define OUTPUT_MAP_SIZE  65536L	/* initial size of output mapping */
+
+
+/* Expanded data source object for mapped input */
+
+typedef struct {
+  struct jpeg_source_mgr pub;	/* public fields */
+
+  FILE * infile;		/* source stream */
+  JOCTET * map;			/* whole file, mapped; NULL if using stdio */
+  size_t map_len;		/* length of mapping */
+  JOCTET * buffer;		/* stdio input buffer, allocated if needed */
+  boolean start_of_file;	/* stdio: have we gotten any data yet? */
+} map_source_mgr;
+
+typedef map_source_mgr * map_src_ptr;
+
+
+METHODDEF(void)
+init_map_source (j_decompress_ptr cinfo)
+{
+  map_src_ptr src = (map_src_ptr) cinfo->src;
+
+  if (src->map == NULL)
+    src->start_of_file = TRUE;
+}
+
+
+/*
+ * Reaching the end of the mapping is premature EOF, since the file holds
+ * nothing more; insert a fake EOI marker.  Without a mapping, read the
+ * next bufferload just as the stdio source manager does.
+ */
+
+METHODDEF(boolean)
+fill_map_input_buffer (j_decompress_ptr cinfo)
+{
+  map_src_ptr src = (map_src_ptr) cinfo->src;
+  static const JOCTET fake_eoi[2] = { (JOCTET) 0xFF, (JOCTET) JPEG_EOI };
+  size_t nbytes;
+
+  if (src->map == NULL) {
+    nbytes = JFREAD(src->infile, src->buffer, INPUT_BUF_SIZE);
+    if (nbytes > 0) {
+      src->pub.next_input_byte = src->buffer;
+      src->pub.bytes_in_buffer = nbytes;
+      src->start_of_file = FALSE;
+      return TRUE;
+    }
+    if (src->start_of_file)	/* Treat empty input file as fatal error */
+      ERREXIT(cinfo, JERR_INPUT_EMPTY);
+  }
+
+  WARNMS(cinfo, JWRN_JPEG_EOF);
+  src->pub.next_input_byte = fake_eoi;
+  src->pub.bytes_in_buffer = 2;
+
+  return TRUE;
+}
+
+
+METHODDEF(void)
+skip_map_input_data (j_decompress_ptr cinfo, long num_bytes)
+{
+  map_src_ptr src = (map_src_ptr) cinfo->src;
+
+  if (num_bytes > 0) {
+    while (num_bytes > (long) src->pub.bytes_in_buffer) {
+      num_bytes -= (long) src->pub.bytes_in_buffer;
+      src->pub.next_input_byte += src->pub.bytes_in_buffer;
+      src->pub.bytes_in_buffer = 0;
+      if (src->map != NULL)
+	return;			/* next read will find the fake EOI */
+      (void) fill_map_input_buffer(cinfo);
+    }
+    src->pub.next_input_byte += (size_t) num_bytes;
+    src->pub.bytes_in_buffer -= (size_t) num_bytes;
+  }
+}
+
+
+/*
+ * Terminate source: unmap the file, leaving the stdio stream positioned
+ * just after the data consumed, so that an image following this one in
+ * the same file can be read next.
+ */
+
+#ifdef HAVE_MMAP
+
+LOCAL(void)
+release_map (map_src_ptr src)
+{
+  const JOCTET * next = src->pub.next_input_byte;
+  size_t consumed;
+
+  if (next >= src->map && next <= src->map + src->map_len)
+    consumed = (size_t) (next - src->map);
+  else				/* we were feeding the fake EOI */
+    consumed = src->map_len;
+  fseek(src->infile, (long) consumed, SEEK_SET);
+  munmap((void *) src->map, src->map_len);
+  src->map = NULL;
+  src->pub.next_input_byte = NULL;
+  src->pub.bytes_in_buffer = 0;
+}
+
+#endif /* HAVE_MMAP */
+
+
+METHODDEF(void)
+term_map_source (j_decompress_ptr cinfo)
+{
+#ifdef HAVE_MMAP
+  map_src_ptr src = (map_src_ptr) cinfo->src;
+
+  if (src->map != NULL)
+    release_map(src);
+#endif
+}
+
+
+/*
+ * Prepare for input from a stdio stream, mapping the file if possible.
+ * The data is taken to run from the current stream position to the end
+ * of the file.  The caller must have already opened the stream, and is
+ * responsible for closing it after finishing decompression.
+ *
+ * As with jpeg_stdio_src, the source object is permanent, so a series of
+ * images can be read by calling this before each one; and it is unsafe to
+ * use this manager and a different source manager serially with the same
+ * JPEG object.  A mapping left behind by an aborted decompression is
+ * released by the next call here.
+ */
+
+GLOBAL(void)
+jpeg_mmap_src (j_decompress_ptr cinfo, FILE * infile)
+{
+  map_src_ptr src;
+#ifdef HAVE_MMAP
+  struct stat st;
+  long pos;
+  void * map;
+#endif
+
+  if (cinfo->src == NULL) {	/* first time for this JPEG object? */
+    cinfo->src = (struct jpeg_source_mgr *)
+      (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+				  SIZEOF(map_source_mgr));
+    src = (map_src_ptr) cinfo->src;
+    src->map = NULL;
+    src->buffer = NULL;
+  }
+
+  src = (map_src_ptr) cinfo->src;
+#ifdef HAVE_MMAP
+  if (src->map != NULL)		/* left over from an aborted image */
+    release_map(src);
+#endif
+  src->pub.init_source = init_map_source;
+  src->pub.fill_input_buffer = fill_map_input_buffer;
+  src->pub.skip_input_data = skip_map_input_data;
+  src->pub.resync_to_restart = jpeg_resync_to_restart; /* use default method */
+  src->pub.term_source = term_map_source;
+  src->infile = infile;
+  src->pub.bytes_in_buffer = 0; /* forces fill_input_buffer on first read */
+  src->pub.next_input_byte = NULL; /* until buffer loaded */
+
+#ifdef HAVE_MMAP
+  if (fstat(fileno(infile), &st) == 0 && S_ISREG(st.st_mode) &&
+      (pos = ftell(infile)) >= 0 && (off_t) pos < st.st_size &&
+      (map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED,
+		  fileno(infile), (off_t) 0)) != MAP_FAILED) {
+    src->map = (JOCTET *) map;
+    src->map_len = (size_t) st.st_size;
+    src->pub.next_input_byte = src->map + pos;
+    src->pub.bytes_in_buffer = src->map_len - (size_t) pos;
+    return;
+  }
+#endif
+
+  /* Can't map it: read it through stdio instead. */
+  if (src->buffer == NULL)
+    src->buffer = (JOCTET *)
+      (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+				  INPUT_BUF_SIZE * SIZEOF(JOCTET));
+}
+
+
+/* Expanded data destination object for mapped output */
+
+typedef struct {
+  struct jpeg_destination_mgr pub; /* public fields */
+
+  FILE * outfile;		/* target stream */
+  boolean use_map;		/* map the file, or use stdio? */
+  JOCTET * map;			/* file contents from offset 0, mapped */
+  size_t map_len;		/* file length = length of mapping */
+  JOCTET * buffer;		/* stdio output buffer */
+} map_destination_mgr;
+
+typedef map_destination_mgr * map_dest_ptr;
+
+
+#ifdef HAVE_MMAP
+
+/* Make the file, and the mapping, new_len bytes long */
+
+LOCAL(void)
+remap_output (j_compress_ptr cinfo, size_t new_len)
+{
+  map_dest_ptr dest = (map_dest_ptr) cinfo->dest;
+  int fd = fileno(dest->outfile);
+  void * map;
+
+  if (dest->map != NULL)
+    munmap((void *) dest->map, dest->map_len);
+  dest->map = NULL;
+  if (ftruncate(fd, (off_t) new_len) != 0)
+    ERREXIT(cinfo, JERR_FILE_WRITE);
+  map = mmap(NULL, new_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t) 0);
+  if (map == MAP_FAILED)
+    ERREXIT(cinfo, JERR_FILE_WRITE);
+  dest->map = (JOCTET *) map;
+  dest->map_len = new_len;
+}
+
+#endif /* HAVE_MMAP */
+
+
+/*
+ * Initialize destination.  Anything already written through stdio is
+ * flushed, and our output starts at the current file position.
+ */
+
+METHODDEF(void)
+init_map_destination (j_compress_ptr cinfo)
+{
+  map_dest_ptr dest = (map_dest_ptr) cinfo->dest;
+#ifdef HAVE_MMAP
+  long start;
+
+  if (dest->use_map) {
+    fflush(dest->outfile);
+    if ((start = ftell(dest->outfile)) < 0)
+      ERREXIT(cinfo, JERR_FILE_WRITE);
+    remap_output(cinfo, (size_t) start + OUTPUT_MAP_SIZE);
+    dest->pub.next_output_byte = dest->map + start;
+    dest->pub.free_in_buffer = OUTPUT_MAP_SIZE;
+    return;
+  }
+#endif
+
+  /* Allocate the output buffer --- it will be released when done with image */
+  dest->buffer = (JOCTET *)
+      (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
+				  OUTPUT_BUF_SIZE * SIZEOF(JOCTET));
+  dest->pub.next_output_byte = dest->buffer;
+  dest->pub.free_in_buffer = OUTPUT_BUF_SIZE;
+}
+
+
+/*
+ * The mapping is full: double the file size and map it again.
+ * Or, without a mapping, write out the buffer.
+ */
+
+METHODDEF(boolean)
+empty_map_output_buffer (j_compress_ptr cinfo)
+{
+  map_dest_ptr dest = (map_dest_ptr) cinfo->dest;
+#ifdef HAVE_MMAP
+  size_t used;
+
+  if (dest->use_map) {
+    used = dest->map_len;
+    remap_output(cinfo, used * 2);
+    dest->pub.next_output_byte = dest->map + used;
+    dest->pub.free_in_buffer = dest->map_len - used;
+    return TRUE;
+  }
+#endif
+
+  if (JFWRITE(dest->outfile, dest->buffer, OUTPUT_BUF_SIZE) !=
+      (size_t) OUTPUT_BUF_SIZE)
+    ERREXIT(cinfo, JERR_FILE_WRITE);
+
+  dest->pub.next_output_byte = dest->buffer;
+  dest->pub.free_in_buffer = OUTPUT_BUF_SIZE;
+
+  return TRUE;
+}
+
+
+/*
+ * Terminate destination: cut the file back to the end of the data and
+ * leave the stdio stream positioned there.  Or flush the stdio buffer.
+ */
+
+METHODDEF(void)
+term_map_destination (j_compress_ptr cinfo)
+{
+  map_dest_ptr dest = (map_dest_ptr) cinfo->dest;
+  size_t datacount;
+
+#ifdef HAVE_MMAP
+  if (dest->use_map) {
+    datacount = dest->map_len - dest->pub.free_in_buffer; /* end of data */
+    munmap((void *) dest->map, dest->map_len);
+    dest->map = NULL;
+    if (ftruncate(fileno(dest->outfile), (off_t) datacount) != 0 ||
+	fseek(dest->outfile, (long) datacount, SEEK_SET) != 0)
+      ERREXIT(cinfo, JERR_FILE_WRITE);
+    return;
+  }
+#endif
+
+  datacount = OUTPUT_BUF_SIZE - dest->pub.free_in_buffer;
+  /* Write any data remaining in the buffer */
+  if (datacount > 0) {
+    if (JFWRITE(dest->outfile, dest->buffer, datacount) != datacount)
+      ERREXIT(cinfo, JERR_FILE_WRITE);
+  }
+  fflush(dest->outfile);
+  /* Make sure we wrote the output file OK */
+  if (ferror(dest->outfile))
+    ERREXIT(cinfo, JERR_FILE_WRITE);
+}
+
+
+/*
+ * Prepare for output to a stdio stream, mapping the file if possible.
+ * Output starts at the stream position current when compression starts,
+ * and the file is truncated at the end of the data.  To allow mapping, the
+ * stream must be open for update (mode "w+b", say).  The caller must have
+ * already opened the stream, and is responsible for closing it after
+ * finishing compression.  The same caveat as for jpeg_stdio_dest applies.
+ */
+
+GLOBAL(void)
+jpeg_mmap_dest (j_compress_ptr cinfo, FILE * outfile)
+{
+  map_dest_ptr dest;
+#ifdef HAVE_MMAP
+  struct stat st;
+  int flags;
+#endif
+
+  if (cinfo->dest == NULL) {	/* first time for this JPEG object? */
+    cinfo->dest = (struct jpeg_destination_mgr *)
+      (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+				  SIZEOF(map_destination_mgr));
+    ((map_dest_ptr) cinfo->dest)->map = NULL;
+  }
+
+  dest = (map_dest_ptr) cinfo->dest;
+#ifdef HAVE_MMAP
+  if (dest->map != NULL)	/* left over from an aborted image */
+    munmap((void *) dest->map, dest->map_len);
+#endif
+  dest->pub.init_destination = init_map_destination;
+  dest->pub.empty_output_buffer = empty_map_output_buffer;
+  dest->pub.term_destination = term_map_destination;
+  dest->outfile = outfile;
+  dest->use_map = FALSE;
+  dest->map = NULL;
+
+#ifdef HAVE_MMAP
+  flags = fcntl(fileno(outfile), F_GETFL);
+  if (fstat(fileno(outfile), &st) == 0 && S_ISREG(st.st_mode) &&
+      flags != -1 && (flags & O_ACCMODE) == O_RDWR && ! (flags & O_APPEND))
+    dest->use_map = TRUE;
+#endif
+}
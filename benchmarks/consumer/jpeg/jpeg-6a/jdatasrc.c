@@ -6,9 +6,10 @@
  * For conditions of distribution and use, see the accompanying README file.
  *
  * This file contains decompression data source routines for the case of
- * reading JPEG data from a file (or any stdio stream).  While these routines
- * are sufficient for most applications, some will want to use a different
- * source manager.
+ * reading JPEG data from a file (or any stdio stream), or from a buffer
+ * already in memory.  While these routines are sufficient for most
+ * applications, some will want to use a different source manager.
+ * (jdatamap.c provides one that reads a file through mmap().)
  * IMPORTANT: we assume that fread() will correctly transcribe an array of
  * JOCTETs from 8-bit-wide elements on external storage.  If char is wider
  * than 8 bits on your machine, you may need to do some tweaking.
@@ -210,3 +211,88 @@ jpeg_stdio_src (j_decompress_ptr cinfo, FILE * infile)
   src->pub.bytes_in_buffer = 0; /* forces fill_input_buffer on first read */
   src->pub.next_input_byte = NULL; /* until buffer loaded */
 }
+
+
+/*
+ * Memory source: the whole JPEG datastream is already in a buffer.
+ * No copying is needed; the library reads the caller's buffer directly.
+ * The public source fields hold all the state, so there is no expanded
+ * object.
+ */
+
+METHODDEF(void)
+init_mem_source (j_decompress_ptr cinfo)
+{
+  /* no work necessary here */
+}
+
+
+/*
+ * Running off the end of the buffer means the datastream is truncated.
+ * Treat it like premature EOF in a file: warn, then supply an EOI marker
+ * as often as it is asked for.
+ */
+
+METHODDEF(boolean)
+fill_mem_input_buffer (j_decompress_ptr cinfo)
+{
+  static const JOCTET fake_eoi[2] = { (JOCTET) 0xFF, (JOCTET) JPEG_EOI };
+
+  WARNMS(cinfo, JWRN_JPEG_EOF);
+  cinfo->src->next_input_byte = fake_eoi;
+  cinfo->src->bytes_in_buffer = 2;
+
+  return TRUE;
+}
+
+
+METHODDEF(void)
+skip_mem_input_data (j_decompress_ptr cinfo, long num_bytes)
+{
+  struct jpeg_source_mgr * src = cinfo->src;
+
+  if (num_bytes > 0) {
+    if (num_bytes > (long) src->bytes_in_buffer) {
+      /* Skipping past the end; the next read will find the fake EOI. */
+      src->next_input_byte += src->bytes_in_buffer;
+      src->bytes_in_buffer = 0;
+    } else {
+      src->next_input_byte += (size_t) num_bytes;
+      src->bytes_in_buffer -= (size_t) num_bytes;
+    }
+  }
+}
+
+
+/*
+ * Prepare for input from a memory buffer.
+ * The buffer must hold the entire datastream, and must stay valid (and
+ * unchanged) until decompression is finished or aborted.
+ * The same caveat as for jpeg_stdio_src applies: don't switch between
+ * this and a different source manager on the same JPEG object.
+ */
+
+GLOBAL(void)
+jpeg_mem_src (j_decompress_ptr cinfo,
+	      const unsigned char * inbuffer, unsigned long insize)
+{
+  struct jpeg_source_mgr * src;
+
+  if (inbuffer == NULL || insize == 0)	/* Treat empty input as fatal error */
+    ERREXIT(cinfo, JERR_INPUT_EMPTY);
+
+  if (cinfo->src == NULL) {	/* first time for this JPEG object? */
+    cinfo->src = (struct jpeg_source_mgr *)
+      (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+				  SIZEOF(struct jpeg_source_mgr));
+  }
+
+  src = cinfo->src;
+  src->init_source = init_mem_source;
+  src->fill_input_buffer = fill_mem_input_buffer;
+  src->skip_input_data = skip_mem_input_data;
+  src->resync_to_restart = jpeg_resync_to_restart; /* use default method */
+  src->term_source = term_source;
+  src->bytes_in_buffer = (size_t) insize;
+  src->next_input_byte = (const JOCTET *) inbuffer;
+}
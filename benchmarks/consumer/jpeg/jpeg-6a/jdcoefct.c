@@ -23,6 +23,26 @@
 #undef BLOCK_SMOOTHING_SUPPORTED
 #endif
 
+/* Parallel decoding needs the full-image coefficient buffer, so: */
+#ifndef D_MULTISCAN_FILES_SUPPORTED
+#undef D_PARALLEL_HUFF_SUPPORTED
+#endif
+
+#ifdef D_PARALLEL_HUFF_SUPPORTED
+#include <pthread.h>
+
+/* The first warning raised while decoding a restart interval in parallel */
+
+struct interval_warning {
+  int msg_code;			/* message code, or 0 if none */
+  union {			/* its parameters, as in jpeg_error_mgr */
+    int i[8];
+    char s[JMSG_STR_PARM_MAX];
+  } msg_parm;
+  long more_warnings;		/* # of further warnings */
+};
+#endif
+
 /* Private buffer controller object */
 
 typedef struct {
@@ -57,6 +77,35 @@ typedef struct {
   int * coef_bits_latch;
 #define SAVED_COEFS  6		/* we save coef_bits[0..5] */
 #endif
+
+#ifdef D_PROGRESSIVE_SUPPORTED
+  /* A progressive AC scan whose coefficients no IDCT will look at (as at
+   * 1/8 scale) is skipped over without being decoded.
+   */
+  boolean skip_pending_ff;	/* last byte skipped was an 0xFF */
+  boolean skip_hit_marker;	/* already warned of a bad marker */
+  JDIMENSION skip_restarts;	/* # of RSTn markers still expected */
+  int skip_next_restart_num;	/* next restart number expected (0-7) */
+#endif
+
+#ifdef D_PARALLEL_HUFF_SUPPORTED
+  /* For parallel decoding, the scan's entropy-coded data is first
+   * collected here, then split at the RSTn markers into restart intervals
+   * which are decoded independently.  seg_start[i] is the offset of
+   * interval i; each interval ends with the marker that follows it.
+   * A scan whose markers are not all in order is decoded serially from
+   * the collected data instead.
+   */
+  JOCTET * scan_data;		/* collected data */
+  size_t scan_len;		/* # of bytes collected so far */
+  size_t scan_size;		/* allocated size of scan_data */
+  boolean pending_ff;		/* last byte collected was an 0xFF */
+  size_t * seg_start;		/* start offset of each interval */
+  JDIMENSION num_intervals;	/* # of restart intervals in the scan */
+  JDIMENSION num_segments;	/* # of intervals found so far */
+  boolean malformed;		/* saw a marker out of place */
+  struct interval_warning * warnings; /* warnings raised by each interval */
+#endif
 } my_coef_controller;
 
 typedef my_coef_controller * my_coef_ptr;
@@ -111,6 +160,48 @@ start_input_pass (j_decompress_ptr cinfo)
 }
 
 
+#ifdef D_PARALLEL_HUFF_SUPPORTED
+
+/*
+ * Initialize for a scan that will be decoded in parallel.
+ */
+
+METHODDEF(void)
+start_input_pass_parallel (j_decompress_ptr cinfo)
+{
+  my_coef_ptr coef = (my_coef_ptr) cinfo->coef;
+  long total_MCUs = (long) cinfo->MCUs_per_row * (long) cinfo->MCU_rows_in_scan;
+
+  start_input_pass(cinfo);
+
+  coef->num_intervals = (JDIMENSION)
+    jdiv_round_up(total_MCUs, (long) cinfo->restart_interval);
+  coef->seg_start = (size_t *)
+    (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
+				(size_t) (coef->num_intervals + 1) *
+				SIZEOF(size_t));
+  coef->seg_start[0] = 0;
+  coef->warnings = (struct interval_warning *)
+    (*cinfo->mem->alloc_large) ((j_common_ptr) cinfo, JPOOL_IMAGE,
+				(size_t) coef->num_intervals *
+				SIZEOF(struct interval_warning));
+  MEMZERO(coef->warnings, (size_t) coef->num_intervals *
+	  SIZEOF(struct interval_warning));
+  coef->num_segments = 0;
+  coef->malformed = FALSE;
+  coef->pending_ff = FALSE;
+  coef->scan_len = 0;
+  /* A first guess at the compressed size; append_scan_data grows it. */
+  coef->scan_size = (size_t) MAX(total_MCUs * cinfo->blocks_in_MCU * 16L,
+				 65536L);
+  coef->scan_data = (JOCTET *)
+    (*cinfo->mem->alloc_large) ((j_common_ptr) cinfo, JPOOL_IMAGE,
+				coef->scan_size * SIZEOF(JOCTET));
+}
+
+#endif /* D_PARALLEL_HUFF_SUPPORTED */
+
+
 /*
  * Initialize for an output processing pass.
  */
@@ -302,6 +393,559 @@ consume_data (j_decompress_ptr cinfo)
 }
 
 
+#ifdef D_PROGRESSIVE_SUPPORTED
+
+/*
+ * Consume input data for a scan that need not be decoded: skip the
+ * entropy-coded data up to the marker that ends it, which is left in
+ * cinfo->unread_marker for the marker reader, as the entropy decoder
+ * would.  Stuffed zero bytes and RSTn markers are skipped along with
+ * the data.  We count the RSTn markers so that a marker in corrupt data
+ * is treated as decoding would treat it: jpeg_resync_to_restart discards
+ * an invalid marker code (below SOF0) while an RSTn is still to come,
+ * and otherwise it ends the scan and the marker reader rejects it.
+ * Return value is JPEG_SCAN_COMPLETED or JPEG_SUSPENDED.
+ */
+
+METHODDEF(int)
+skip_scan_data (j_decompress_ptr cinfo)
+{
+  my_coef_ptr coef = (my_coef_ptr) cinfo->coef;
+  struct jpeg_source_mgr * src = cinfo->src;
+  const JOCTET * ff;
+  size_t n;
+  int c;
+
+  for (;;) {
+    if (src->bytes_in_buffer == 0) {
+      if (! (*src->fill_input_buffer) (cinfo))
+	return JPEG_SUSPENDED;
+      continue;
+    }
+    if (! coef->skip_pending_ff) {
+      /* Skip everything up to and including the next 0xFF */
+      ff = (const JOCTET *) memchr(src->next_input_byte, 0xFF,
+				   src->bytes_in_buffer);
+      n = ff ? (size_t) (ff - src->next_input_byte) + 1 : src->bytes_in_buffer;
+      src->next_input_byte += n;
+      src->bytes_in_buffer -= n;
+      coef->skip_pending_ff = (ff != NULL);
+      continue;
+    }
+    /* The byte after an 0xFF: stuffed zero, fill byte, or marker */
+    c = GETJOCTET(*src->next_input_byte);
+    src->next_input_byte++;
+    src->bytes_in_buffer--;
+    if (c == 0xFF)
+      continue;
+    coef->skip_pending_ff = FALSE;
+    if (c == 0)
+      continue;
+    if (coef->skip_restarts == 0) {
+      /* In the last restart interval any marker but an invalid one ends
+       * the scan; the marker reader makes what it can of a stray RSTn.
+       */
+      if (c >= 0xC0) {
+	cinfo->unread_marker = c;
+	break;
+      }
+    } else if (c == JPEG_RST0 + coef->skip_next_restart_num) {
+      coef->skip_restarts--;
+      coef->skip_next_restart_num = (coef->skip_next_restart_num + 1) & 7;
+      continue;
+    }
+    /* Corrupt data: the entropy decoder would stop short at this marker */
+    if (! coef->skip_hit_marker) {
+      WARNMS(cinfo, JWRN_HIT_MARKER);
+      coef->skip_hit_marker = TRUE;
+    }
+    if (coef->skip_restarts == 0) {
+      cinfo->unread_marker = c;	/* invalid; the marker reader rejects it */
+      break;
+    }
+    WARNMS2(cinfo, JWRN_MUST_RESYNC, c, coef->skip_next_restart_num);
+    if (c >= JPEG_RST0 && c <= JPEG_RST0+7) {
+      /* Resynchronize on the restart marker we found */
+      coef->skip_restarts--;
+      coef->skip_next_restart_num = (c - JPEG_RST0 + 1) & 7;
+    } else if (c >= 0xC0) {
+      cinfo->unread_marker = c;	/* a real marker ends the scan early */
+      break;
+    }
+    /* else jpeg_resync_to_restart discards the invalid marker */
+  }
+
+  /* Completed the scan */
+  cinfo->input_iMCU_row = cinfo->total_iMCU_rows;
+  (*cinfo->inputctl->finish_input_pass) (cinfo);
+  return JPEG_SCAN_COMPLETED;
+}
+
+
+/*
+ * Initialize for an input processing pass of a progressive file.
+ * DC scans are always decoded; an AC scan only if some component in it
+ * is wanted at more than 1/8 scale, since a 1x1 IDCT uses only the DC
+ * coefficient.
+ */
+
+METHODDEF(void)
+start_input_pass_progressive (j_decompress_ptr cinfo)
+{
+  my_coef_ptr coef = (my_coef_ptr) cinfo->coef;
+  boolean needed = (cinfo->Ss == 0);
+  int ci;
+  jpeg_component_info *compptr;
+
+  start_input_pass(cinfo);
+
+  for (ci = 0; ci < cinfo->comps_in_scan; ci++) {
+    compptr = cinfo->cur_comp_info[ci];
+    if (compptr->component_needed && compptr->DCT_scaled_size > 1)
+      needed = TRUE;
+  }
+  coef->pub.consume_data = needed ? consume_data : skip_scan_data;
+  coef->skip_pending_ff = FALSE;
+  coef->skip_hit_marker = FALSE;
+  coef->skip_restarts = 0;
+  if (cinfo->restart_interval)
+    coef->skip_restarts = (JDIMENSION)
+      jdiv_round_up((long) cinfo->MCUs_per_row *
+		    (long) cinfo->MCU_rows_in_scan,
+		    (long) cinfo->restart_interval) - 1;
+  coef->skip_next_restart_num = 0;
+}
+
+#endif /* D_PROGRESSIVE_SUPPORTED */
+
+
+#ifdef D_PARALLEL_HUFF_SUPPORTED
+
+/*
+ * Append n bytes to the collected scan data, enlarging the buffer by
+ * doubling.  Superseded buffers stay in the image pool until it is freed.
+ */
+
+LOCAL(void)
+append_scan_data (j_decompress_ptr cinfo, const JOCTET * data, size_t n)
+{
+  my_coef_ptr coef = (my_coef_ptr) cinfo->coef;
+
+  if (coef->scan_len + n > coef->scan_size) {
+    size_t newsize = coef->scan_size * 2;
+    JOCTET * newdata;
+
+    while (newsize < coef->scan_len + n)
+      newsize *= 2;
+    newdata = (JOCTET *)
+      (*cinfo->mem->alloc_large) ((j_common_ptr) cinfo, JPOOL_IMAGE,
+				  newsize * SIZEOF(JOCTET));
+    MEMCOPY(newdata, coef->scan_data, coef->scan_len * SIZEOF(JOCTET));
+    coef->scan_data = newdata;
+    coef->scan_size = newsize;
+  }
+  MEMCOPY(coef->scan_data + coef->scan_len, data, n * SIZEOF(JOCTET));
+  coef->scan_len += n;
+}
+
+
+/*
+ * Note the end of a restart interval, just after its terminating marker.
+ * An RSTn marker that is out of sequence, or a count of intervals that
+ * does not match the image size, means the data is corrupt; the serial
+ * decoder's resynchronization then decides which data go where.
+ */
+
+LOCAL(void)
+end_segment (j_decompress_ptr cinfo, int marker)
+{
+  my_coef_ptr coef = (my_coef_ptr) cinfo->coef;
+  JDIMENSION n = coef->num_segments; /* the interval just ended */
+
+  if (n + 1 < coef->num_intervals) {
+    if (marker != JPEG_RST0 + (int) (n & 7))
+      coef->malformed = TRUE;
+  } else if (marker >= JPEG_RST0 && marker <= JPEG_RST0+7)
+    coef->malformed = TRUE;
+  if (n < coef->num_intervals) {
+    coef->seg_start[n + 1] = coef->scan_len;
+    coef->num_segments = n + 1;
+  }
+}
+
+
+/*
+ * Collect the rest of the scan's entropy-coded data from the source.
+ * Stuffed zero bytes and RSTn markers are kept, so each interval can be
+ * read by the ordinary bit reader.  An invalid marker code (below SOF0)
+ * in corrupt data is kept too, but marks the scan as malformed.
+ * The first valid non-RSTn marker ends the scan; it is left in
+ * cinfo->unread_marker for the marker reader, as the entropy decoder
+ * would.  Returns FALSE if the source suspended, in which case we resume
+ * where we left off on the next call.
+ */
+
+LOCAL(boolean)
+collect_scan_data (j_decompress_ptr cinfo)
+{
+  my_coef_ptr coef = (my_coef_ptr) cinfo->coef;
+  struct jpeg_source_mgr * src = cinfo->src;
+  const JOCTET * ff;
+  size_t n;
+  int c;
+
+  for (;;) {
+    if (src->bytes_in_buffer == 0) {
+      if (! (*src->fill_input_buffer) (cinfo))
+	return FALSE;
+      continue;
+    }
+    if (! coef->pending_ff) {
+      /* Copy everything up to and including the next 0xFF */
+      ff = (const JOCTET *) memchr(src->next_input_byte, 0xFF,
+				   src->bytes_in_buffer);
+      n = ff ? (size_t) (ff - src->next_input_byte) + 1 : src->bytes_in_buffer;
+      append_scan_data(cinfo, src->next_input_byte, n);
+      src->next_input_byte += n;
+      src->bytes_in_buffer -= n;
+      coef->pending_ff = (ff != NULL);
+      continue;
+    }
+    /* The byte after an 0xFF: stuffed zero, fill byte, or marker */
+    c = GETJOCTET(*src->next_input_byte);
+    append_scan_data(cinfo, src->next_input_byte, 1);
+    src->next_input_byte++;
+    src->bytes_in_buffer--;
+    if (c == 0xFF)
+      continue;
+    coef->pending_ff = FALSE;
+    if (c == 0)
+      continue;
+    if (c < 0xC0) {
+      coef->malformed = TRUE;
+      continue;
+    }
+    end_segment(cinfo, c);
+    if (c < JPEG_RST0 || c > JPEG_RST0+7) {
+      cinfo->unread_marker = c;
+      return TRUE;
+    }
+  }
+}
+
+
+/*
+ * Per-thread state for decoding restart intervals.  Each thread gets a
+ * private copy of the decompress object, so that the entropy decoder
+ * has somewhere harmless to report warnings.  The first warning of each
+ * interval is kept with its parameters (struct interval_warning) and
+ * reissued on the real object, in interval order, once all threads have
+ * finished; any later ones in the same interval are only counted.
+ */
+
+typedef struct {
+  struct jpeg_decompress_struct cinfo; /* private copy; must be first */
+  struct jpeg_error_mgr err;	/* its error manager */
+  struct interval_warning * warning; /* record for the current interval */
+  struct parallel_job * job;	/* work shared by all threads */
+  pthread_t thread;
+} decode_worker;
+
+typedef struct parallel_job {
+  my_coef_ptr coef;
+  JBLOCKARRAY buffer[MAX_COMPS_IN_SCAN]; /* whole coefficient arrays */
+  pthread_mutex_t lock;		/* protects next_interval */
+  JDIMENSION next_interval;	/* next interval to be handed out */
+} parallel_job;
+
+
+METHODDEF(void)
+note_worker_warning (j_common_ptr cinfo, int msg_level)
+{
+  decode_worker * worker = (decode_worker *) cinfo;
+  struct interval_warning * warning = worker->warning;
+
+  if (msg_level >= 0)
+    return;
+  if (warning->msg_code == 0) {
+    warning->msg_code = cinfo->err->msg_code;
+    MEMCOPY(&warning->msg_parm, &cinfo->err->msg_parm,
+	    SIZEOF(warning->msg_parm));
+  } else
+    warning->more_warnings++;
+}
+
+
+/*
+ * Read forward through collected data the entropy decoder did not use to
+ * the next marker, as next_marker() in jdmarker.c would, adding the bytes
+ * skipped to *discarded.  The data end with a marker, so one is found.
+ */
+
+LOCAL(int)
+skip_to_marker (const JOCTET ** next_input_byte, size_t * bytes_in_buffer,
+		long * discarded)
+{
+  int c = 0;
+
+  while (*bytes_in_buffer > 0) {
+    (*bytes_in_buffer)--;
+    c = GETJOCTET(*(*next_input_byte)++);
+    if (c != 0xFF) {
+      (*discarded)++;
+      continue;
+    }
+    /* Swallow duplicate FF bytes, then see what follows */
+    do {
+      if (*bytes_in_buffer == 0)
+	return 0;
+      (*bytes_in_buffer)--;
+      c = GETJOCTET(*(*next_input_byte)++);
+    } while (c == 0xFF);
+    if (c != 0)
+      break;
+    *discarded += 2;		/* a stuffed-zero data sequence */
+  }
+  return c;
+}
+
+
+/*
+ * Decode restart interval number ival into the coefficient arrays.
+ */
+
+LOCAL(void)
+decode_interval (decode_worker * worker, JDIMENSION ival)
+{
+  j_decompress_ptr cinfo = &worker->cinfo;
+  parallel_job * job = worker->job;
+  my_coef_ptr coef = job->coef;
+  JBLOCKROW MCU_buffer[D_MAX_BLOCKS_IN_MCU];
+  jpeg_entropy_segment seg;
+  long MCU_num, last_MCU;
+  JDIMENSION MCU_row, MCU_col, start_col;
+  int blkn, ci, xindex, yindex;
+  JBLOCKROW buffer_ptr;
+  jpeg_component_info *compptr;
+  int marker;
+  long discarded;
+
+  worker->warning = &coef->warnings[ival];
+  seg.next_input_byte = coef->scan_data + coef->seg_start[ival];
+  seg.bytes_in_buffer = coef->seg_start[ival + 1] - coef->seg_start[ival];
+  seg.unread_marker = 0;
+  seg.get_buffer = 0;
+  seg.bits_left = 0;
+  seg.printed_eod = FALSE;
+  for (ci = 0; ci < cinfo->comps_in_scan; ci++)
+    seg.last_dc_val[ci] = 0;
+
+  MCU_num = (long) ival * (long) cinfo->restart_interval;
+  last_MCU = MIN(MCU_num + (long) cinfo->restart_interval,
+		 (long) cinfo->MCUs_per_row * (long) cinfo->MCU_rows_in_scan);
+  for (; MCU_num < last_MCU; MCU_num++) {
+    MCU_row = (JDIMENSION) (MCU_num / (long) cinfo->MCUs_per_row);
+    MCU_col = (JDIMENSION) (MCU_num % (long) cinfo->MCUs_per_row);
+    /* Construct list of pointers to DCT blocks belonging to this MCU */
+    blkn = 0;
+    for (ci = 0; ci < cinfo->comps_in_scan; ci++) {
+      compptr = cinfo->cur_comp_info[ci];
+      start_col = MCU_col * compptr->MCU_width;
+      for (yindex = 0; yindex < compptr->MCU_height; yindex++) {
+	buffer_ptr = job->buffer[ci][MCU_row * compptr->MCU_height + yindex]
+		     + start_col;
+	for (xindex = 0; xindex < compptr->MCU_width; xindex++) {
+	  MCU_buffer[blkn++] = buffer_ptr++;
+	}
+      }
+    }
+    (*cinfo->entropy->decode_mcu_segment) (cinfo, &seg, MCU_buffer);
+  }
+
+  /* If the MCUs did not use all the data, the serial decoder skips the
+   * rest on its way to the marker with a warning, counting any whole
+   * bytes left in the bit buffer as process_restart does.
+   */
+  if (seg.unread_marker == 0) {
+    discarded = 0;
+    if (ival + 1 < coef->num_intervals)
+      discarded = seg.bits_left / 8;
+    marker = skip_to_marker(&seg.next_input_byte, &seg.bytes_in_buffer,
+			    &discarded);
+    if (discarded != 0)
+      WARNMS2(cinfo, JWRN_EXTRANEOUS_DATA, (int) discarded, marker);
+  }
+}
+
+
+LOCAL(void)
+decode_intervals (decode_worker * worker)
+{
+  parallel_job * job = worker->job;
+  JDIMENSION ival;
+
+  for (;;) {
+    pthread_mutex_lock(&job->lock);
+    ival = job->next_interval++;
+    pthread_mutex_unlock(&job->lock);
+    if (ival >= job->coef->num_intervals)
+      break;
+    decode_interval(worker, ival);
+  }
+}
+
+
+static void *
+decode_thread (void * arg)
+{
+  decode_intervals((decode_worker *) arg);
+  return NULL;
+}
+
+
+/*
+ * Source manager routine for decode_scan_serially.  The collected data
+ * end with the marker that ended the scan, which the decoder never reads
+ * past, so this should not be reached; treat it as the end of the file.
+ */
+
+METHODDEF(boolean)
+fill_from_scan_data (j_decompress_ptr cinfo)
+{
+  static const JOCTET fake_eoi[2] = { (JOCTET) 0xFF, (JOCTET) JPEG_EOI };
+
+  WARNMS(cinfo, JWRN_JPEG_EOF);
+  cinfo->src->next_input_byte = fake_eoi;
+  cinfo->src->bytes_in_buffer = 2;
+  return TRUE;
+}
+
+
+/*
+ * Decode a malformed scan with consume_data, reading the collected data
+ * through a temporary source manager, so that corrupt data get exactly
+ * the serial decoder's treatment.  Afterwards we find the marker that
+ * the marker reader would go on to, as it cannot see the collected data.
+ */
+
+LOCAL(void)
+decode_scan_serially (j_decompress_ptr cinfo)
+{
+  my_coef_ptr coef = (my_coef_ptr) cinfo->coef;
+  struct jpeg_source_mgr * src = cinfo->src;
+  struct jpeg_source_mgr scan_src;
+  int marker;
+  long discarded;
+
+  MEMCOPY(&scan_src, src, SIZEOF(struct jpeg_source_mgr));
+  scan_src.next_input_byte = coef->scan_data;
+  scan_src.bytes_in_buffer = coef->scan_len;
+  scan_src.fill_input_buffer = fill_from_scan_data;
+  cinfo->src = &scan_src;
+  cinfo->unread_marker = 0;
+
+  /* consume_data cannot suspend, as the data are all in memory */
+  while (consume_data(cinfo) != JPEG_SCAN_COMPLETED)
+    ;
+
+  /* A stray RSTn or TEM marker is skipped by the marker reader too */
+  marker = cinfo->unread_marker;
+  while (scan_src.bytes_in_buffer > 0 &&
+	 (marker == 0 || marker == 0x01 ||
+	  (marker >= JPEG_RST0 && marker <= JPEG_RST0+7))) {
+    discarded = (long) cinfo->marker->discarded_bytes;
+    cinfo->marker->discarded_bytes = 0;
+    marker = skip_to_marker(&scan_src.next_input_byte,
+			    &scan_src.bytes_in_buffer, &discarded);
+    if (discarded != 0)
+      WARNMS2(cinfo, JWRN_EXTRANEOUS_DATA, (int) discarded, marker);
+  }
+  cinfo->unread_marker = marker;
+  cinfo->src = src;
+}
+
+
+/*
+ * Consume input data for a scan decoded in parallel.  The whole scan is
+ * collected and then decoded in one call, which therefore completes the
+ * scan rather than one iMCU row.  The calling thread decodes too; if
+ * fewer helper threads can be started than asked for, the work is simply
+ * shared among those that did start.
+ * Return value is JPEG_SCAN_COMPLETED or JPEG_SUSPENDED.
+ */
+
+METHODDEF(int)
+consume_data_parallel (j_decompress_ptr cinfo)
+{
+  my_coef_ptr coef = (my_coef_ptr) cinfo->coef;
+  parallel_job job;
+  decode_worker * workers;
+  struct interval_warning * warning;
+  int ci, i, nthreads, started;
+  JDIMENSION ival;
+  jpeg_component_info *compptr;
+
+  if (! collect_scan_data(cinfo))
+    return JPEG_SUSPENDED;
+  if (coef->malformed) {
+    decode_scan_serially(cinfo);
+    return JPEG_SCAN_COMPLETED;
+  }
+
+  job.coef = coef;
+  job.next_interval = 0;
+  for (ci = 0; ci < cinfo->comps_in_scan; ci++) {
+    compptr = cinfo->cur_comp_info[ci];
+    job.buffer[ci] = (*cinfo->mem->access_virt_barray)
+      ((j_common_ptr) cinfo, coef->whole_image[compptr->component_index],
+       (JDIMENSION) 0,
+       (JDIMENSION) jround_up((long) compptr->height_in_blocks,
+			      (long) compptr->v_samp_factor), TRUE);
+  }
+
+  nthreads = (int) MIN((long) cinfo->num_threads, (long) coef->num_intervals);
+  if (nthreads < 1)
+    nthreads = 1;
+  workers = (decode_worker *)
+    (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
+				(size_t) nthreads * SIZEOF(decode_worker));
+  pthread_mutex_init(&job.lock, NULL);
+  for (i = 0; i < nthreads; i++) {
+    MEMCOPY(&workers[i].cinfo, cinfo, SIZEOF(struct jpeg_decompress_struct));
+    MEMCOPY(&workers[i].err, cinfo->err, SIZEOF(struct jpeg_error_mgr));
+    workers[i].err.emit_message = note_worker_warning;
+    workers[i].cinfo.err = &workers[i].err;
+    workers[i].job = &job;
+  }
+  for (started = 1; started < nthreads; started++) {
+    if (pthread_create(&workers[started].thread, NULL, decode_thread,
+		       (void *) &workers[started]) != 0)
+      break;
+  }
+  decode_intervals(&workers[0]);
+  for (i = 1; i < started; i++)
+    pthread_join(workers[i].thread, NULL);
+  pthread_mutex_destroy(&job.lock);
+
+  for (ival = 0; ival < coef->num_intervals; ival++) {
+    warning = &coef->warnings[ival];
+    if (warning->msg_code != 0) {
+      MEMCOPY(&cinfo->err->msg_parm, &warning->msg_parm,
+	      SIZEOF(warning->msg_parm));
+      WARNMS(cinfo, warning->msg_code);
+      cinfo->err->num_warnings += warning->more_warnings;
+    }
+  }
+
+  /* Completed the scan */
+  cinfo->input_iMCU_row = cinfo->total_iMCU_rows;
+  (*cinfo->inputctl->finish_input_pass) (cinfo);
+  return JPEG_SCAN_COMPLETED;
+}
+
+#endif /* D_PARALLEL_HUFF_SUPPORTED */
+
+
 /*
  * Decompress and return some data in the multi-pass case.
  * Always attempts to emit one fully interleaved MCU row ("iMCU" row).
@@ -675,6 +1319,9 @@ GLOBAL(void)
 jinit_d_coef_controller (j_decompress_ptr cinfo, boolean need_full_buffer)
 {
   my_coef_ptr coef;
+#ifdef D_PARALLEL_HUFF_SUPPORTED
+  boolean parallel;
+#endif
 
   coef = (my_coef_ptr)
     (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
@@ -686,6 +1333,17 @@ jinit_d_coef_controller (j_decompress_ptr cinfo, boolean need_full_buffer)
   coef->coef_bits_latch = NULL;
 #endif
 
+#ifdef D_PARALLEL_HUFF_SUPPORTED
+  /* A single-scan image with restart markers can have its intervals
+   * decoded in parallel, given a full-image buffer to decode them into.
+   */
+  parallel = (cinfo->num_threads > 1 && cinfo->restart_interval > 0 &&
+	      ! cinfo->inputctl->has_multiple_scans &&
+	      cinfo->entropy->decode_mcu_segment != NULL);
+  if (parallel)
+    need_full_buffer = TRUE;
+#endif
+
   /* Create the coefficient buffer. */
   if (need_full_buffer) {
 #ifdef D_MULTISCAN_FILES_SUPPORTED
@@ -702,6 +1360,12 @@ jinit_d_coef_controller (j_decompress_ptr cinfo, boolean need_full_buffer)
       /* If block smoothing could be used, need a bigger window */
       if (cinfo->progressive_mode)
 	access_rows *= 3;
+#endif
+#ifdef D_PARALLEL_HUFF_SUPPORTED
+      /* Parallel decoding writes anywhere in the image at once */
+      if (parallel)
+	access_rows = (int) jround_up((long) compptr->height_in_blocks,
+				      (long) compptr->v_samp_factor);
 #endif
       coef->whole_image[ci] = (*cinfo->mem->request_virt_barray)
 	((j_common_ptr) cinfo, JPOOL_IMAGE, TRUE,
@@ -714,6 +1378,16 @@ jinit_d_coef_controller (j_decompress_ptr cinfo, boolean need_full_buffer)
     coef->pub.consume_data = consume_data;
     coef->pub.decompress_data = decompress_data;
     coef->pub.coef_arrays = coef->whole_image; /* link to virtual arrays */
+#ifdef D_PROGRESSIVE_SUPPORTED
+    if (cinfo->progressive_mode)
+      coef->pub.start_input_pass = start_input_pass_progressive;
+#endif
+#ifdef D_PARALLEL_HUFF_SUPPORTED
+    if (parallel) {
+      coef->pub.start_input_pass = start_input_pass_parallel;
+      coef->pub.consume_data = consume_data_parallel;
+    }
+#endif
 #else
     ERREXIT(cinfo, JERR_NOT_COMPILED);
 #endif
@@ -19,6 +19,7 @@
 #include "jinclude.h"
 #include "jpeglib.h"
 #include "jdct.h"		/* Private declarations for DCT subsystem */
+#include "jsimd.h"
 
 
 /*
@@ -118,12 +119,20 @@ start_pass (j_decompress_ptr cinfo)
 #ifdef DCT_ISLOW_SUPPORTED
       case JDCT_ISLOW:
 	method_ptr = jpeg_idct_islow;
+#ifdef SIMD_SUPPORTED
+	if (jsimd_can_idct_islow())
+	  method_ptr = jsimd_idct_islow;
+#endif
 	method = JDCT_ISLOW;
 	break;
 #endif
 #ifdef DCT_IFAST_SUPPORTED
       case JDCT_IFAST:
 	method_ptr = jpeg_idct_ifast;
+#ifdef SIMD_SUPPORTED
+	if (jsimd_can_idct_ifast())
+	  method_ptr = jsimd_idct_ifast;
+#endif
 	method = JDCT_IFAST;
 	break;
 #endif
@@ -156,6 +165,13 @@ start_pass (j_decompress_ptr cinfo)
     if (qtbl == NULL)		/* happens if no data yet for component */
       continue;
     idct->cur_method[ci] = method;
+    /* In reuse mode, use the kept table for this component; it needn't be
+     * rebuilt if the quant table is unchanged since the last image.
+     */
+    if (cinfo->mem->reuse_image_pools &&
+	jreuse_quant_table((j_common_ptr) cinfo, ci, method, qtbl,
+			   SIZEOF(multiplier_table), & compptr->dct_table))
+      continue;
     switch (method) {
 #ifdef PROVIDE_ISLOW_TABLES
     case JDCT_ISLOW:
@@ -101,9 +101,9 @@ start_pass_huff_decoder (j_decompress_ptr cinfo)
       ERREXIT1(cinfo, JERR_NO_HUFF_TABLE, actbl);
     /* Compute derived values for Huffman tables */
     /* We may do this more than once for a table, but it's not expensive */
-    jpeg_make_d_derived_tbl(cinfo, cinfo->dc_huff_tbl_ptrs[dctbl],
+    jpeg_make_d_derived_tbl(cinfo, TRUE, dctbl,
 			    & entropy->dc_derived_tbls[dctbl]);
-    jpeg_make_d_derived_tbl(cinfo, cinfo->ac_huff_tbl_ptrs[actbl],
+    jpeg_make_d_derived_tbl(cinfo, FALSE, actbl,
 			    & entropy->ac_derived_tbls[actbl]);
     /* Initialize DC predictions to 0 */
     entropy->saved.last_dc_val[ci] = 0;
@@ -125,9 +125,10 @@ start_pass_huff_decoder (j_decompress_ptr cinfo)
  */
 
 GLOBAL(void)
-jpeg_make_d_derived_tbl (j_decompress_ptr cinfo, JHUFF_TBL * htbl,
+jpeg_make_d_derived_tbl (j_decompress_ptr cinfo, boolean isDC, int tblno,
 			 d_derived_tbl ** pdtbl)
 {
+  JHUFF_TBL *htbl;
   d_derived_tbl *dtbl;
   int p, i, l, si;
   int lookbits, ctr;
@@ -135,11 +136,26 @@ jpeg_make_d_derived_tbl (j_decompress_ptr cinfo, JHUFF_TBL * htbl,
   unsigned int huffcode[257];
   unsigned int code;
 
-  /* Allocate a workspace if we haven't already done so. */
-  if (*pdtbl == NULL)
+  htbl = isDC ? cinfo->dc_huff_tbl_ptrs[tblno]
+	      : cinfo->ac_huff_tbl_ptrs[tblno];
+
+  if (cinfo->mem->reuse_image_pools) {
+    /* Use the kept table; it needn't be rebuilt if htbl is unchanged. */
+    void * kept;
+    boolean valid = jreuse_huff_table((j_common_ptr) cinfo, isDC, tblno, htbl,
+				      SIZEOF(d_derived_tbl), &kept);
+
+    *pdtbl = (d_derived_tbl *) kept;
+    if (valid) {
+      (*pdtbl)->pub = htbl;	/* but htbl itself may have moved */
+      return;
+    }
+  } else if (*pdtbl == NULL) {
+    /* Allocate a workspace if we haven't already done so. */
     *pdtbl = (d_derived_tbl *)
       (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_IMAGE,
 				  SIZEOF(d_derived_tbl));
+  }
   dtbl = *pdtbl;
   dtbl->pub = htbl;		/* fill in back link */
   
@@ -164,6 +180,12 @@ jpeg_make_d_derived_tbl (j_decompress_ptr cinfo, JHUFF_TBL * htbl,
       huffcode[p++] = code;
       code++;
     }
+    /* code is now 1 more than the last code of length si.  If the codes
+     * of this length did not fit in si bits, the counts are bogus, and the
+     * lookahead tables below would be filled out of bounds.
+     */
+    if (((INT32) code) >= (((INT32) 1) << si))
+      ERREXIT(cinfo, JERR_DHT_COUNTS);
     code <<= 1;
     si++;
   }
@@ -244,6 +266,41 @@ jpeg_fill_bit_buffer (bitread_working_state * state,
   /* Attempt to load at least MIN_GET_BITS bits into get_buffer. */
   /* (It is assumed that no request will be for more than that many bits.) */
 
+#if BIT_BUF_SIZE == 64
+  /* Fast path: if the source buffer holds at least a whole word and none of
+   * the bytes we want to take from it is 0xFF, there can be neither a stuffed
+   * zero nor a marker among them, so they go into get_buffer all at once.
+   * Otherwise we drop into the byte-at-a-time loop below.
+   */
+  if (bits_left < MIN_GET_BITS && bytes_in_buffer >= 8 &&
+      state->unread_marker == 0) {
+    register bit_buf_type word;
+    register int nbytes = (BIT_BUF_SIZE - bits_left) >> 3;
+
+    if (nbytes > 7)
+      nbytes = 7;		/* keep the shift below less than 64 */
+    word = ((bit_buf_type) GETJOCTET(next_input_byte[0]) << 56) |
+	   ((bit_buf_type) GETJOCTET(next_input_byte[1]) << 48) |
+	   ((bit_buf_type) GETJOCTET(next_input_byte[2]) << 40) |
+	   ((bit_buf_type) GETJOCTET(next_input_byte[3]) << 32) |
+	   ((bit_buf_type) GETJOCTET(next_input_byte[4]) << 24) |
+	   ((bit_buf_type) GETJOCTET(next_input_byte[5]) << 16) |
+	   ((bit_buf_type) GETJOCTET(next_input_byte[6]) << 8) |
+	   ((bit_buf_type) GETJOCTET(next_input_byte[7]));
+    /* High bit of each byte of ~word that is zero, i.e. of each 0xFF byte
+     * of word; borrows can only add false hits above a true one.
+     */
+    if (((~word - 0x0101010101010101UL) & word & 0x8080808080808080UL &
+	 ~(~(bit_buf_type) 0 >> (nbytes << 3))) == 0) {
+      get_buffer = (get_buffer << (nbytes << 3)) |
+		   (word >> (BIT_BUF_SIZE - (nbytes << 3)));
+      bits_left += nbytes << 3;
+      next_input_byte += nbytes;
+      bytes_in_buffer -= nbytes;
+    }
+  }
+#endif
+
   while (bits_left < MIN_GET_BITS) {
     /* Attempt to read a byte */
     if (state->unread_marker != 0)
@@ -419,44 +476,28 @@ process_restart (j_decompress_ptr cinfo)
 
 
 /*
- * Decode and return one MCU's worth of Huffman-compressed coefficients.
- * The coefficients are reordered from zigzag order into natural array order,
- * but are not dequantized.
+ * Decode the blocks of one MCU, starting from the working bit-reader state
+ * in *br and the DC predictions in *state; both are updated in place.
+ * This is the common body of decode_mcu and decode_mcu_segment.
  *
- * The i'th block of the MCU is stored into the block pointed to by
- * MCU_data[i].  WE ASSUME THIS AREA HAS BEEN ZEROED BY THE CALLER.
- * (Wholesale zeroing is usually a little faster than retail...)
- *
- * Returns FALSE if data source requested suspension.  In that case no
- * changes have been made to permanent state.  (Exception: some output
- * coefficients may already have been assigned.  This is harmless for
- * this module, since we'll just re-assign them on the next call.)
+ * Returns FALSE if data source requested suspension.  In that case the
+ * caller must discard *br and *state.
  */
 
-METHODDEF(boolean)
-decode_mcu (j_decompress_ptr cinfo, JBLOCKROW *MCU_data)
+LOCAL(boolean)
+decode_mcu_blocks (j_decompress_ptr cinfo, bitread_working_state * br,
+		   savable_state * state, JBLOCKROW *MCU_data)
 {
   huff_entropy_ptr entropy = (huff_entropy_ptr) cinfo->entropy;
   register int s, k, r;
+  register bit_buf_type get_buffer = br->get_buffer;
+  register int bits_left = br->bits_left;
   int blkn, ci;
   JBLOCKROW block;
-  BITREAD_STATE_VARS;
-  savable_state state;
   d_derived_tbl * dctbl;
   d_derived_tbl * actbl;
   jpeg_component_info * compptr;
 
-  /* Process restart marker if needed; may have to suspend */
-  if (cinfo->restart_interval) {
-    if (entropy->restarts_to_go == 0)
-      if (! process_restart(cinfo))
-	return FALSE;
-  }
-
-  /* Load up working state */
-  BITREAD_LOAD_STATE(cinfo,entropy->bitstate);
-  ASSIGN_STATE(state, entropy->saved);
-
   /* Outer loop handles each block in the MCU */
 
   for (blkn = 0; blkn < cinfo->blocks_in_MCU; blkn++) {
@@ -469,9 +510,9 @@ decode_mcu (j_decompress_ptr cinfo, JBLOCKROW *MCU_data)
     /* Decode a single block's worth of coefficients */
 
     /* Section F.2.2.1: decode the DC coefficient difference */
-    HUFF_DECODE(s, br_state, dctbl, return FALSE, label1);
+    HUFF_DECODE(s, (*br), dctbl, return FALSE, label1);
     if (s) {
-      CHECK_BIT_BUFFER(br_state, s, return FALSE);
+      CHECK_BIT_BUFFER((*br), s, return FALSE);
       r = GET_BITS(s);
       s = HUFF_EXTEND(r, s);
     }
@@ -481,8 +522,8 @@ decode_mcu (j_decompress_ptr cinfo, JBLOCKROW *MCU_data)
       goto skip_ACs;
 
     /* Convert DC difference to actual value, update last_dc_val */
-    s += state.last_dc_val[ci];
-    state.last_dc_val[ci] = s;
+    s += state->last_dc_val[ci];
+    state->last_dc_val[ci] = s;
     /* Output the DC coefficient (assumes jpeg_natural_order[0] = 0) */
     (*block)[0] = (JCOEF) s;
 
@@ -492,14 +533,14 @@ decode_mcu (j_decompress_ptr cinfo, JBLOCKROW *MCU_data)
       /* Section F.2.2.2: decode the AC coefficients */
       /* Since zeroes are skipped, output area must be cleared beforehand */
       for (k = 1; k < DCTSIZE2; k++) {
-	HUFF_DECODE(s, br_state, actbl, return FALSE, label2);
+	HUFF_DECODE(s, (*br), actbl, return FALSE, label2);
       
 	r = s >> 4;
 	s &= 15;
       
 	if (s) {
 	  k += r;
-	  CHECK_BIT_BUFFER(br_state, s, return FALSE);
+	  CHECK_BIT_BUFFER((*br), s, return FALSE);
 	  r = GET_BITS(s);
 	  s = HUFF_EXTEND(r, s);
 	  /* Output coefficient in natural (dezigzagged) order.
@@ -520,14 +561,14 @@ skip_ACs:
       /* Section F.2.2.2: decode the AC coefficients */
       /* In this path we just discard the values */
       for (k = 1; k < DCTSIZE2; k++) {
-	HUFF_DECODE(s, br_state, actbl, return FALSE, label3);
+	HUFF_DECODE(s, (*br), actbl, return FALSE, label3);
       
 	r = s >> 4;
 	s &= 15;
       
 	if (s) {
 	  k += r;
-	  CHECK_BIT_BUFFER(br_state, s, return FALSE);
+	  CHECK_BIT_BUFFER((*br), s, return FALSE);
 	  DROP_BITS(s);
 	} else {
 	  if (r != 15)
@@ -539,6 +580,52 @@ skip_ACs:
     }
   }
 
+  br->get_buffer = get_buffer;
+  br->bits_left = bits_left;
+  return TRUE;
+}
+
+
+/*
+ * Decode and return one MCU's worth of Huffman-compressed coefficients.
+ * The coefficients are reordered from zigzag order into natural array order,
+ * but are not dequantized.
+ *
+ * The i'th block of the MCU is stored into the block pointed to by
+ * MCU_data[i].  WE ASSUME THIS AREA HAS BEEN ZEROED BY THE CALLER.
+ * (Wholesale zeroing is usually a little faster than retail...)
+ *
+ * Returns FALSE if data source requested suspension.  In that case no
+ * changes have been made to permanent state.  (Exception: some output
+ * coefficients may already have been assigned.  This is harmless for
+ * this module, since we'll just re-assign them on the next call.)
+ */
+
+METHODDEF(boolean)
+decode_mcu (j_decompress_ptr cinfo, JBLOCKROW *MCU_data)
+{
+  huff_entropy_ptr entropy = (huff_entropy_ptr) cinfo->entropy;
+  BITREAD_STATE_VARS;
+  savable_state state;
+
+  /* Process restart marker if needed; may have to suspend */
+  if (cinfo->restart_interval) {
+    if (entropy->restarts_to_go == 0)
+      if (! process_restart(cinfo))
+	return FALSE;
+  }
+
+  /* Load up working state */
+  BITREAD_LOAD_STATE(cinfo,entropy->bitstate);
+  ASSIGN_STATE(state, entropy->saved);
+
+  br_state.get_buffer = get_buffer;
+  br_state.bits_left = bits_left;
+  if (! decode_mcu_blocks(cinfo, &br_state, &state, MCU_data))
+    return FALSE;
+  get_buffer = br_state.get_buffer;
+  bits_left = br_state.bits_left;
+
   /* Completed MCU, so update state */
   BITREAD_SAVE_STATE(cinfo,entropy->bitstate);
   ASSIGN_STATE(entropy->saved, state);
@@ -550,6 +637,46 @@ skip_ACs:
 }
 
 
+/*
+ * Decode one MCU from a restart interval held in memory (see jpegint.h).
+ * The segment ends with a marker, so jpeg_fill_bit_buffer always finds it
+ * before running out of bytes and never calls the data source; if the
+ * data are short, zeroes are substituted exactly as in decode_mcu.
+ * The only other state touched is the read-only Huffman tables, so this
+ * may run in several threads at once.  Each thread passes its own copy of
+ * the decompress object, which is where any warnings are reported.
+ */
+
+METHODDEF(void)
+decode_mcu_segment (j_decompress_ptr cinfo, jpeg_entropy_segment * seg,
+		    JBLOCKROW *MCU_data)
+{
+  bitread_working_state br_state;
+  savable_state state;
+  int ci;
+
+  br_state.cinfo = cinfo;
+  br_state.next_input_byte = seg->next_input_byte;
+  br_state.bytes_in_buffer = seg->bytes_in_buffer;
+  br_state.unread_marker = seg->unread_marker;
+  br_state.get_buffer = (bit_buf_type) seg->get_buffer;
+  br_state.bits_left = seg->bits_left;
+  br_state.printed_eod_ptr = & seg->printed_eod;
+  for (ci = 0; ci < cinfo->comps_in_scan; ci++)
+    state.last_dc_val[ci] = seg->last_dc_val[ci];
+
+  (void) decode_mcu_blocks(cinfo, &br_state, &state, MCU_data);
+
+  seg->next_input_byte = br_state.next_input_byte;
+  seg->bytes_in_buffer = br_state.bytes_in_buffer;
+  seg->unread_marker = br_state.unread_marker;
+  seg->get_buffer = (unsigned long) br_state.get_buffer;
+  seg->bits_left = br_state.bits_left;
+  for (ci = 0; ci < cinfo->comps_in_scan; ci++)
+    seg->last_dc_val[ci] = state.last_dc_val[ci];
+}
+
+
 /*
  * Module initialization routine for Huffman entropy decoding.
  */
@@ -566,6 +693,7 @@ jinit_huff_decoder (j_decompress_ptr cinfo)
   cinfo->entropy = (struct jpeg_entropy_decoder *) entropy;
   entropy->pub.start_pass = start_pass_huff_decoder;
   entropy->pub.decode_mcu = decode_mcu;
+  entropy->pub.decode_mcu_segment = decode_mcu_segment;
 
   /* Mark tables unallocated */
   for (i = 0; i < NUM_HUFF_TBLS; i++) {
@@ -44,7 +44,8 @@ typedef struct {
 
 /* Expand a Huffman table definition into the derived format */
 EXTERN(void) jpeg_make_d_derived_tbl JPP((j_decompress_ptr cinfo,
-				JHUFF_TBL * htbl, d_derived_tbl ** pdtbl));
+				boolean isDC, int tblno,
+				d_derived_tbl ** pdtbl));
 
 
 /*
@@ -65,14 +66,23 @@ EXTERN(void) jpeg_make_d_derived_tbl JPP((j_decompress_ptr cinfo,
  * necessary.
  */
 
+#if defined(__LP64__) || defined(_LP64)
+typedef unsigned long bit_buf_type; /* type of bit-extraction buffer */
+#define BIT_BUF_SIZE  64	/* size of buffer in bits */
+#else
 typedef INT32 bit_buf_type;	/* type of bit-extraction buffer */
 #define BIT_BUF_SIZE  32	/* size of buffer in bits */
+#endif
 
 /* If long is > 32 bits on your machine, and shifting/masking longs is
  * reasonably fast, making bit_buf_type be long and setting BIT_BUF_SIZE
  * appropriately should be a win.  Unfortunately we can't do this with
  * something like  #define BIT_BUF_SIZE (sizeof(bit_buf_type)*8)
- * because not all machines measure sizeof in 8-bit bytes.
+ * because not all machines measure sizeof in 8-bit bytes; so we do it only
+ * for the LP64 model, where long is known to be 64 bits.  The buffer is
+ * unsigned there so that bits shifted off the top are simply discarded.
+ * A 64-bit buffer also lets jpeg_fill_bit_buffer take in up to 7 bytes at
+ * a time when none of them is 0xFF.
  */
 
 typedef struct {		/* Bitreading state saved across MCUs */
@@ -125,11 +125,14 @@ jpeg_calc_output_dimensions (j_decompress_ptr cinfo)
    * scale up the chroma components via IDCT scaling rather than upsampling.
    * This saves time if the upsampler gets to use 1:1 scaling.
    * Note this code assumes that the supported DCT scalings are powers of 2.
+   * With thumbnail_scaling, all components get the same scaling instead:
+   * then the merged upsampler can do the upsampling and color conversion
+   * in one step, and at 1/8 scale no AC coefficients are needed at all.
    */
   for (ci = 0, compptr = cinfo->comp_info; ci < cinfo->num_components;
        ci++, compptr++) {
     int ssize = cinfo->min_DCT_scaled_size;
-    while (ssize < DCTSIZE &&
+    while (! cinfo->thumbnail_scaling && ssize < DCTSIZE &&
 	   (compptr->h_samp_factor * ssize * 2 <=
 	    cinfo->max_h_samp_factor * cinfo->min_DCT_scaled_size) &&
 	   (compptr->v_samp_factor * ssize * 2 <=
@@ -199,6 +202,37 @@ jpeg_calc_output_dimensions (j_decompress_ptr cinfo)
 }
 
 
+/*
+ * Set up for a quick reduced-size decode, such as a thumbnail or preview:
+ * select the smallest IDCT scaling (1/8, 1/4, 1/2, else 1/1) whose output
+ * is at least width by height pixels, with thumbnail_scaling and plain
+ * upsampling so that the cheapest processing path applies.
+ * NOTE: this is exported for use by applications; call it after
+ * jpeg_read_header.  Any of these parameters may be changed again after.
+ */
+
+GLOBAL(void)
+jpeg_set_thumbnail_size (j_decompress_ptr cinfo,
+			 JDIMENSION width, JDIMENSION height)
+{
+  long denom;
+
+  /* Prevent application from calling me at wrong times */
+  if (cinfo->global_state != DSTATE_READY)
+    ERREXIT1(cinfo, JERR_BAD_STATE, cinfo->global_state);
+
+  for (denom = 8L; denom > 1L; denom >>= 1) {
+    if (jdiv_round_up((long) cinfo->image_width, denom) >= (long) width &&
+	jdiv_round_up((long) cinfo->image_height, denom) >= (long) height)
+      break;
+  }
+  cinfo->scale_num = 1;
+  cinfo->scale_denom = (unsigned int) denom;
+  cinfo->thumbnail_scaling = TRUE;
+  cinfo->do_fancy_upsampling = FALSE;
+}
+
+
 /*
  * Several decompression processes need to range-limit values to the range
  * 0..MAXJSAMPLE; the input value may fall somewhat outside this range
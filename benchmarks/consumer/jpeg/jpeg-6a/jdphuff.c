@@ -163,7 +163,7 @@ start_pass_phuff_decoder (j_decompress_ptr cinfo)
 	if (tbl < 0 || tbl >= NUM_HUFF_TBLS ||
 	    cinfo->dc_huff_tbl_ptrs[tbl] == NULL)
 	  ERREXIT1(cinfo, JERR_NO_HUFF_TABLE, tbl);
-	jpeg_make_d_derived_tbl(cinfo, cinfo->dc_huff_tbl_ptrs[tbl],
+	jpeg_make_d_derived_tbl(cinfo, TRUE, tbl,
 				& entropy->derived_tbls[tbl]);
       }
     } else {
@@ -171,7 +171,7 @@ start_pass_phuff_decoder (j_decompress_ptr cinfo)
       if (tbl < 0 || tbl >= NUM_HUFF_TBLS ||
           cinfo->ac_huff_tbl_ptrs[tbl] == NULL)
         ERREXIT1(cinfo, JERR_NO_HUFF_TABLE, tbl);
-      jpeg_make_d_derived_tbl(cinfo, cinfo->ac_huff_tbl_ptrs[tbl],
+      jpeg_make_d_derived_tbl(cinfo, FALSE, tbl,
 			      & entropy->derived_tbls[tbl]);
       /* remember the single active table */
       entropy->ac_derived_tbl = entropy->derived_tbls[tbl];
@@ -623,6 +623,7 @@ jinit_phuff_decoder (j_decompress_ptr cinfo)
 				SIZEOF(phuff_entropy_decoder));
   cinfo->entropy = (struct jpeg_entropy_decoder *) entropy;
   entropy->pub.start_pass = start_pass_phuff_decoder;
+  entropy->pub.decode_mcu_segment = NULL; /* no parallel decoding */
 
   /* Mark derived tables unallocated */
   for (i = 0; i < NUM_HUFF_TBLS; i++) {
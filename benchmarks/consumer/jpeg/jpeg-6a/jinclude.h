@@ -53,6 +53,7 @@
  *
  * NOTE: we assume the size parameters to these functions are of type size_t.
  * Change the casts in these macros if not!
+ * MEMCMP is only ever used to test for equality, so bcmp() will do for it.
  */
 
 #ifdef NEED_BSD_STRINGS
@@ -60,12 +61,14 @@
 #include <strings.h>
 #define MEMZERO(target,size)	bzero((void *)(target), (size_t)(size))
 #define MEMCOPY(dest,src,size)	bcopy((const void *)(src), (void *)(dest), (size_t)(size))
+#define MEMCMP(a,b,size)	bcmp((const void *)(a), (const void *)(b), (size_t)(size))
 
 #else /* not BSD, assume ANSI/SysV string lib */
 
 #include <string.h>
 #define MEMZERO(target,size)	memset((void *)(target), 0, (size_t)(size))
 #define MEMCOPY(dest,src,size)	memcpy((void *)(dest), (const void *)(src), (size_t)(size))
+#define MEMCMP(a,b,size)	memcmp((const void *)(a), (const void *)(b), (size_t)(size))
 
 #endif
 
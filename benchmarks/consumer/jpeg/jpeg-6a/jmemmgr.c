@@ -10,6 +10,7 @@
  * of the system dependencies have been isolated in a separate file.
  * The major functions provided here are:
  *   * pool-based allocation and freeing of memory;
+ *   * in reuse mode, recycling of one image's pools for the next image;
  *   * policy decisions about how to divide available memory among the
  *     virtual arrays;
  *   * control logic for swapping virtual arrays between main memory and
@@ -131,6 +132,13 @@ typedef struct {
   /* This counts total space obtained from jpeg_get_small/large */
   long total_space_allocated;
 
+  /* In reuse mode, the large pools of the last image wait here to be
+   * handed out again by alloc_large; spare_space is the space they hold
+   * (and is included in total_space_allocated).
+   */
+  large_pool_ptr large_spare;
+  long spare_space;
+
   /* alloc_sarray and alloc_barray set this value for use by virtual
    * array routines.
    */
@@ -355,23 +363,53 @@ alloc_large (j_common_ptr cinfo, int pool_id, size_t sizeofobject)
   if (odd_bytes > 0)
     sizeofobject += SIZEOF(ALIGN_TYPE) - odd_bytes;
 
-  /* Always make a new pool */
   if (pool_id < 0 || pool_id >= JPOOL_NUMPOOLS)
     ERREXIT1(cinfo, JERR_BAD_POOL_ID, pool_id);	/* safety check */
 
-  hdr_ptr = (large_pool_ptr) jpeg_get_large(cinfo, sizeofobject +
-					    SIZEOF(large_pool_hdr));
-  if (hdr_ptr == NULL)
-    out_of_memory(cinfo, 4);	/* jpeg_get_large failed */
-  mem->total_space_allocated += sizeofobject + SIZEOF(large_pool_hdr);
+  /* Use the smallest spare pool that is big enough, if there is one.
+   * (Spare pools exist only in reuse mode; when the image has the same
+   * geometry as the last one, the fit will be exact.)
+   */
+  hdr_ptr = NULL;
+  if (mem->large_spare != NULL) {
+    large_pool_ptr prev_ptr, cur_ptr, best_prev_ptr = NULL;
+
+    prev_ptr = NULL;
+    for (cur_ptr = mem->large_spare; cur_ptr != NULL;
+	 prev_ptr = cur_ptr, cur_ptr = cur_ptr->hdr.next) {
+      if (cur_ptr->hdr.bytes_left >= sizeofobject &&
+	  (hdr_ptr == NULL ||
+	   cur_ptr->hdr.bytes_left < hdr_ptr->hdr.bytes_left)) {
+	hdr_ptr = cur_ptr;
+	best_prev_ptr = prev_ptr;
+      }
+    }
+    if (hdr_ptr != NULL) {
+      if (best_prev_ptr == NULL)
+	mem->large_spare = hdr_ptr->hdr.next;
+      else
+	best_prev_ptr->hdr.next = hdr_ptr->hdr.next;
+      mem->spare_space -= hdr_ptr->hdr.bytes_left + SIZEOF(large_pool_hdr);
+      hdr_ptr->hdr.bytes_left -= sizeofobject;
+    }
+  }
+
+  /* Otherwise make a new pool */
+  if (hdr_ptr == NULL) {
+    hdr_ptr = (large_pool_ptr) jpeg_get_large(cinfo, sizeofobject +
+					      SIZEOF(large_pool_hdr));
+    if (hdr_ptr == NULL)
+      out_of_memory(cinfo, 4);	/* jpeg_get_large failed */
+    mem->total_space_allocated += sizeofobject + SIZEOF(large_pool_hdr);
+    hdr_ptr->hdr.bytes_left = 0;
+  }
 
-  /* Success, initialize the new pool header and add to list */
+  /* Success, initialize the pool header and add to list */
   hdr_ptr->hdr.next = mem->large_list[pool_id];
   /* We maintain space counts in each pool header for statistical purposes,
    * even though they are not needed for allocation.
    */
   hdr_ptr->hdr.bytes_used = sizeofobject;
-  hdr_ptr->hdr.bytes_left = 0;
   mem->large_list[pool_id] = hdr_ptr;
 
   return (void FAR *) (hdr_ptr + 1); /* point to first data byte in pool */
@@ -616,8 +654,9 @@ realize_virt_arrays (j_common_ptr cinfo)
     return;			/* no unrealized arrays, no work */
 
   /* Determine amount of memory to actually use; this is system-dependent. */
+  /* (Spare pools don't count as in use, since they are about to be.) */
   avail_mem = jpeg_mem_available(cinfo, space_per_minheight, maximum_space,
-				 mem->total_space_allocated);
+				 mem->total_space_allocated - mem->spare_space);
 
   /* If the maximum space needed is available, make all the buffers full
    * height; otherwise parcel it out with the same number of minheights
@@ -922,6 +961,89 @@ access_virt_barray (j_common_ptr cinfo, jvirt_barray_ptr ptr,
 }
 
 
+/*
+ * Give the spare large pools back to the system.
+ */
+
+LOCAL(void)
+release_spare_pools (j_common_ptr cinfo)
+{
+  my_mem_ptr mem = (my_mem_ptr) cinfo->mem;
+  large_pool_ptr lhdr_ptr;
+  size_t space_freed;
+
+  lhdr_ptr = mem->large_spare;
+  mem->large_spare = NULL;
+
+  while (lhdr_ptr != NULL) {
+    large_pool_ptr next_lhdr_ptr = lhdr_ptr->hdr.next;
+    space_freed = lhdr_ptr->hdr.bytes_used +
+		  lhdr_ptr->hdr.bytes_left +
+		  SIZEOF(large_pool_hdr);
+    jpeg_free_large(cinfo, (void FAR *) lhdr_ptr, space_freed);
+    mem->total_space_allocated -= space_freed;
+    lhdr_ptr = next_lhdr_ptr;
+  }
+  mem->spare_space = 0;
+}
+
+
+/*
+ * Release the IMAGE pool in reuse mode: rather than freeing the pools,
+ * empty them so that the next image can use them again.  Small pools stay
+ * on the pool list, where alloc_small will find them; large pools become
+ * spares for alloc_large.  Pools left over from an earlier image that this
+ * one had no use for are freed, so we never keep more than one image's
+ * worth of memory.
+ */
+
+LOCAL(void)
+recycle_image_pool (j_common_ptr cinfo)
+{
+  my_mem_ptr mem = (my_mem_ptr) cinfo->mem;
+  small_pool_ptr shdr_ptr, prev_shdr_ptr;
+  large_pool_ptr lhdr_ptr;
+  size_t space_freed;
+
+  release_spare_pools(cinfo);
+
+  lhdr_ptr = mem->large_list[JPOOL_IMAGE];
+  mem->large_list[JPOOL_IMAGE] = NULL;
+
+  while (lhdr_ptr != NULL) {
+    large_pool_ptr next_lhdr_ptr = lhdr_ptr->hdr.next;
+    lhdr_ptr->hdr.bytes_left += lhdr_ptr->hdr.bytes_used;
+    lhdr_ptr->hdr.bytes_used = 0;
+    lhdr_ptr->hdr.next = mem->large_spare;
+    mem->large_spare = lhdr_ptr;
+    mem->spare_space += lhdr_ptr->hdr.bytes_left + SIZEOF(large_pool_hdr);
+    lhdr_ptr = next_lhdr_ptr;
+  }
+
+  prev_shdr_ptr = NULL;
+  shdr_ptr = mem->small_list[JPOOL_IMAGE];
+
+  while (shdr_ptr != NULL) {
+    small_pool_ptr next_shdr_ptr = shdr_ptr->hdr.next;
+    if (shdr_ptr->hdr.bytes_used == 0) {
+      /* not used by this image: free it */
+      space_freed = shdr_ptr->hdr.bytes_left + SIZEOF(small_pool_hdr);
+      jpeg_free_small(cinfo, (void *) shdr_ptr, space_freed);
+      mem->total_space_allocated -= space_freed;
+      if (prev_shdr_ptr == NULL)
+	mem->small_list[JPOOL_IMAGE] = next_shdr_ptr;
+      else
+	prev_shdr_ptr->hdr.next = next_shdr_ptr;
+    } else {
+      shdr_ptr->hdr.bytes_left += shdr_ptr->hdr.bytes_used;
+      shdr_ptr->hdr.bytes_used = 0;
+      prev_shdr_ptr = shdr_ptr;
+    }
+    shdr_ptr = next_shdr_ptr;
+  }
+}
+
+
 /*
  * Release all objects belonging to a specified pool.
  */
@@ -961,8 +1083,17 @@ free_pool (j_common_ptr cinfo, int pool_id)
       }
     }
     mem->virt_barray_list = NULL;
+
+    /* In reuse mode, keep the memory for the next image */
+    if (mem->pub.reuse_image_pools) {
+      recycle_image_pool(cinfo);
+      return;
+    }
   }
 
+  /* Spare pools are of no further use once reuse mode is off */
+  release_spare_pools(cinfo);
+
   /* Release large objects */
   lhdr_ptr = mem->large_list[pool_id];
   mem->large_list[pool_id] = NULL;
@@ -1003,6 +1134,9 @@ self_destruct (j_common_ptr cinfo)
 {
   int pool;
 
+  /* Leave reuse mode, so that free_pool really frees the IMAGE pool. */
+  cinfo->mem->reuse_image_pools = FALSE;
+
   /* Close all backing store, release all memory.
    * Releasing pools in reverse order might help avoid fragmentation
    * with some (brain-damaged) malloc libraries.
@@ -1078,6 +1212,7 @@ jinit_memory_mgr (j_common_ptr cinfo)
 
   /* Initialize working state */
   mem->pub.max_memory_to_use = max_to_use;
+  mem->pub.reuse_image_pools = FALSE;
 
   for (pool = JPOOL_NUMPOOLS-1; pool >= JPOOL_PERMANENT; pool--) {
     mem->small_list[pool] = NULL;
@@ -1085,6 +1220,8 @@ jinit_memory_mgr (j_common_ptr cinfo)
   }
   mem->virt_sarray_list = NULL;
   mem->virt_barray_list = NULL;
+  mem->large_spare = NULL;
+  mem->spare_space = 0;
 
   mem->total_space_allocated = SIZEOF(my_memory_mgr);
 
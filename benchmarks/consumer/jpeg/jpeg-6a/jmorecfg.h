@@ -263,6 +263,8 @@ typedef int boolean;
 #define DCT_ISLOW_SUPPORTED	/* slow but accurate integer algorithm */
 #define DCT_IFAST_SUPPORTED	/* faster, less accurate integer method */
 #define DCT_FLOAT_SUPPORTED	/* floating-point: accurate, fast on fast HW */
+#define SIMD_SUPPORTED		/* SSE2/AVX2 DCT, upsampling, color convert?
+				 * (GNU C on x86 only; see jsimd.h) */
 
 /* Encoder capability options: */
 
@@ -270,6 +272,8 @@ typedef int boolean;
 #define C_MULTISCAN_FILES_SUPPORTED /* Multiple-scan JPEG files? */
 #define C_PROGRESSIVE_SUPPORTED	    /* Progressive JPEG? (Requires MULTISCAN)*/
 #define ENTROPY_OPT_SUPPORTED	    /* Optimization of entropy coding parms? */
+#define C_PARALLEL_HUFF_SUPPORTED   /* Threaded progressive scan encoding?
+				     * (Requires PROGRESSIVE and POSIX threads) */
 /* Note: if you selected 12-bit data precision, it is dangerous to turn off
  * ENTROPY_OPT_SUPPORTED.  The standard Huffman tables are only good for 8-bit
  * precision, so jchuff.c normally uses entropy optimization to compute
@@ -286,6 +290,8 @@ typedef int boolean;
 #define D_MULTISCAN_FILES_SUPPORTED /* Multiple-scan JPEG files? */
 #define D_PROGRESSIVE_SUPPORTED	    /* Progressive JPEG? (Requires MULTISCAN)*/
 #define BLOCK_SMOOTHING_SUPPORTED   /* Block smoothing? (Progressive only) */
+#define D_PARALLEL_HUFF_SUPPORTED   /* Threaded restart-interval decoding?
+				     * (Requires MULTISCAN and POSIX threads) */
 #define IDCT_SCALING_SUPPORTED	    /* Output rescaling via IDCT? */
 #undef  UPSAMPLE_SCALING_SUPPORTED  /* Output rescaling at upsample stage? */
 #define UPSAMPLE_MERGING_SUPPORTED  /* Fast path for sloppy upsampling? */
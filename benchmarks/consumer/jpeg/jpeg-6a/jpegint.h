@@ -18,7 +18,9 @@ typedef enum {			/* Operating modes for buffer controllers */
 	/* Remaining modes require a full-image buffer to have been created */
 	JBUF_SAVE_SOURCE,	/* Run source subobject only, save output */
 	JBUF_CRANK_DEST,	/* Run dest subobject only, using saved data */
-	JBUF_SAVE_AND_PASS	/* Run both subobjects, save output */
+	JBUF_SAVE_AND_PASS,	/* Run both subobjects, save output */
+	JBUF_SAVE_AND_GATHER	/* Run source subobject, save output, and
+				 * gather statistics for all scans at once */
 } J_BUF_MODE;
 
 /* Values of global_state field (jdapi.c has some dependencies on ordering!) */
@@ -114,6 +116,18 @@ struct jpeg_entropy_encoder {
   JMETHOD(void, start_pass, (j_compress_ptr cinfo, boolean gather_statistics));
   JMETHOD(boolean, encode_mcu, (j_compress_ptr cinfo, JBLOCKROW *MCU_data));
   JMETHOD(void, finish_pass, (j_compress_ptr cinfo));
+  /* Statistics for every scan of a multi-scan script in the first pass;
+   * NULL if not supported.  start_gather_all replaces start_pass for that
+   * pass and is given the full-image coefficient arrays.  gather_iMCU_row
+   * then counts the symbols of all scans in one iMCU row, whose blocks for
+   * component ci are in buffer[ci].  Each later start_pass (for output)
+   * sets up the tables for the next scan in the script.
+   */
+  JMETHOD(void, start_gather_all, (j_compress_ptr cinfo,
+				   jvirt_barray_ptr * coef_arrays));
+  JMETHOD(void, gather_iMCU_row, (j_compress_ptr cinfo,
+				  JDIMENSION iMCU_row_num,
+				  JBLOCKARRAY * buffer));
 };
 
 /* Marker writing */
@@ -208,10 +222,32 @@ struct jpeg_marker_reader {
 };
 
 /* Entropy decoding */
+
+/* Caller-held decoder state for one restart interval that is already in
+ * memory, so that several intervals can be decoded at once (jdcoefct.c).
+ * The data must end with the marker that terminates the interval.
+ */
+typedef struct {
+  const JOCTET * next_input_byte; /* => next byte of the interval */
+  size_t bytes_in_buffer;	/* # of bytes left, including the marker */
+  int unread_marker;		/* nonzero once the marker has been hit */
+  unsigned long get_buffer;	/* bit buffer (bit_buf_type in jdhuff.h) */
+  int bits_left;		/* # of unused bits in it */
+  boolean printed_eod;		/* flag to suppress multiple warning msgs */
+  int last_dc_val[MAX_COMPS_IN_SCAN]; /* last DC coef for each component */
+} jpeg_entropy_segment;
+
 struct jpeg_entropy_decoder {
   JMETHOD(void, start_pass, (j_decompress_ptr cinfo));
   JMETHOD(boolean, decode_mcu, (j_decompress_ptr cinfo,
 				JBLOCKROW *MCU_data));
+  /* Decode one MCU of an in-memory restart interval; NULL if the
+   * current scan cannot be decoded that way.  May be called from several
+   * threads at once, each with its own segment state and cinfo copy.
+   */
+  JMETHOD(void, decode_mcu_segment, (j_decompress_ptr cinfo,
+				     jpeg_entropy_segment * seg,
+				     JBLOCKROW *MCU_data));
 };
 
 /* Inverse DCT (also performs dequantization) */
@@ -259,6 +295,33 @@ struct jpeg_color_quantizer {
 };
 
 
+/* Tables kept across images in reuse mode (see reuse_image_pools in
+ * jpeglib.h).  Each entry holds a table derived from a Huffman or
+ * quantization table, allocated in the permanent pool, plus a copy of the
+ * table it was derived from; jreuse_huff_table and jreuse_quant_table use
+ * the copy to tell whether the derived table is still good.
+ */
+typedef struct {
+  void * derived;		/* derived table, or NULL if none yet */
+  JHUFF_TBL source;		/* table it was derived from */
+} jpeg_reused_huff_tbl;
+
+typedef struct {
+  void * derived;		/* derived table, or NULL if none yet */
+  JQUANT_TBL source;		/* table it was derived from */
+} jpeg_reused_quant_tbl;
+
+struct jpeg_table_cache {
+  /* Entropy coding tables, by table class and number */
+  jpeg_reused_huff_tbl dc_huff[NUM_HUFF_TBLS];
+  jpeg_reused_huff_tbl ac_huff[NUM_HUFF_TBLS];
+  /* Forward DCT divisors (by quantization table number) or IDCT multipliers
+   * (by component index), for each DCT method
+   */
+  jpeg_reused_quant_tbl quant[MAX_COMPONENTS][JDCT_FLOAT+1];
+};
+
+
 /* Miscellaneous useful macros */
 
 #undef MAX
@@ -323,6 +386,8 @@ struct jpeg_color_quantizer {
 #define jcopy_sample_rows	jCopySamples
 #define jcopy_block_row		jCopyBlocks
 #define jzero_far		jZeroFar
+#define jreuse_huff_table	jReuseHTbl
+#define jreuse_quant_table	jReuseQTbl
 #define jpeg_zigzag_order	jZIGTable
 #define jpeg_natural_order	jZAGTable
 #endif /* NEED_SHORT_EXTERNAL_NAMES */
@@ -374,6 +439,12 @@ EXTERN(void) jcopy_sample_rows JPP((JSAMPARRAY input_array, int source_row,
 EXTERN(void) jcopy_block_row JPP((JBLOCKROW input_row, JBLOCKROW output_row,
 				  JDIMENSION num_blocks));
 EXTERN(void) jzero_far JPP((void FAR * target, size_t bytestozero));
+EXTERN(boolean) jreuse_huff_table JPP((j_common_ptr cinfo, boolean isDC,
+				       int tblno, JHUFF_TBL * htbl,
+				       size_t derivedsize, void ** pderived));
+EXTERN(boolean) jreuse_quant_table JPP((j_common_ptr cinfo, int which,
+					int method, JQUANT_TBL * qtbl,
+					size_t derivedsize, void ** pderived));
 /* Constant tables in jutils.c */
 extern const int jpeg_zigzag_order[]; /* natural coef order to zigzag order */
 extern const int jpeg_natural_order[]; /* zigzag coef order to natural order */
@@ -310,6 +310,7 @@ struct jpeg_compress_struct {
   boolean CCIR601_sampling;	/* TRUE=first samples are cosited */
   int smoothing_factor;		/* 1..100, or 0 for no input smoothing */
   J_DCT_METHOD dct_method;	/* DCT algorithm selector */
+  int num_threads;		/* max threads for entropy encoding */
 
   /* The restart interval can be specified in absolute MCUs by setting
    * restart_interval, or in MCU rows by setting restart_in_rows
@@ -386,6 +387,7 @@ struct jpeg_compress_struct {
   struct jpeg_downsampler * downsample;
   struct jpeg_forward_dct * fdct;
   struct jpeg_entropy_encoder * entropy;
+  struct jpeg_table_cache * tblcache;
 };
 
 
@@ -413,6 +415,7 @@ struct jpeg_decompress_struct {
   J_COLOR_SPACE out_color_space; /* colorspace for output */
 
   unsigned int scale_num, scale_denom; /* fraction by which to scale image */
+  boolean thumbnail_scaling;	/* TRUE=scale all components alike, for speed */
 
   double output_gamma;		/* image gamma wanted in output */
 
@@ -422,6 +425,7 @@ struct jpeg_decompress_struct {
   J_DCT_METHOD dct_method;	/* IDCT algorithm selector */
   boolean do_fancy_upsampling;	/* TRUE=apply fancy upsampling */
   boolean do_block_smoothing;	/* TRUE=apply interblock smoothing */
+  int num_threads;		/* max threads for entropy decoding */
 
   boolean quantize_colors;	/* TRUE=colormapped output wanted */
   /* the following are ignored if not quantize_colors: */
@@ -602,6 +606,7 @@ struct jpeg_decompress_struct {
   struct jpeg_upsampler * upsample;
   struct jpeg_color_deconverter * cconvert;
   struct jpeg_color_quantizer * cquantize;
+  struct jpeg_table_cache * tblcache;
 };
 
 
@@ -772,6 +777,17 @@ struct jpeg_memory_mgr {
    * after creating the JPEG object.
    */
   long max_memory_to_use;
+
+  /* Reuse mode.  If TRUE, the memory used for an image is not given back
+   * to the system when the image is finished, but is kept to be handed out
+   * again for the next image, and tables derived from the Huffman and
+   * quantization tables are kept in the permanent pool and rebuilt only
+   * when those tables change.  This saves much of the per-image setup cost
+   * when one JPEG object processes many images of the same size and type.
+   * Only what the most recent image used is kept.  May be changed by outer
+   * application between images.
+   */
+  boolean reuse_image_pools;
 };
 
 
@@ -808,6 +824,10 @@ typedef JMETHOD(boolean, jpeg_marker_parser_method, (j_decompress_ptr cinfo));
 #define jpeg_destroy_decompress	jDestDecompress
 #define jpeg_stdio_dest		jStdDest
 #define jpeg_stdio_src		jStdSrc
+#define jpeg_mem_dest		jMemDest
+#define jpeg_mem_src		jMemSrc
+#define jpeg_mmap_dest		jMmapDest
+#define jpeg_mmap_src		jMmapSrc
 #define jpeg_set_defaults	jSetDefaults
 #define jpeg_set_colorspace	jSetColorspace
 #define jpeg_default_colorspace	jDefColorspace
@@ -837,6 +857,7 @@ typedef JMETHOD(boolean, jpeg_marker_parser_method, (j_decompress_ptr cinfo));
 #define jpeg_new_colormap	jNewCMap
 #define jpeg_consume_input	jConsumeInput
 #define jpeg_calc_output_dimensions	jCalcDimensions
+#define jpeg_set_thumbnail_size	jSetThumbSize
 #define jpeg_set_marker_processor	jSetMarker
 #define jpeg_read_coefficients	jReadCoefs
 #define jpeg_write_coefficients	jWrtCoefs
@@ -879,6 +900,21 @@ EXTERN(void) jpeg_destroy_decompress JPP((j_decompress_ptr cinfo));
 EXTERN(void) jpeg_stdio_dest JPP((j_compress_ptr cinfo, FILE * outfile));
 EXTERN(void) jpeg_stdio_src JPP((j_decompress_ptr cinfo, FILE * infile));
 
+/* Data source and destination managers: memory buffers. */
+/* The destination buffer is enlarged with malloc() as needed; the caller */
+/* must free() the final buffer, and also its own initial one if different. */
+EXTERN(void) jpeg_mem_dest JPP((j_compress_ptr cinfo,
+				unsigned char ** outbuffer,
+				unsigned long * outsize));
+EXTERN(void) jpeg_mem_src JPP((j_decompress_ptr cinfo,
+			       const unsigned char * inbuffer,
+			       unsigned long insize));
+
+/* Data source and destination managers: stdio streams accessed through */
+/* mmap() where possible, otherwise the same as the stdio managers. */
+EXTERN(void) jpeg_mmap_dest JPP((j_compress_ptr cinfo, FILE * outfile));
+EXTERN(void) jpeg_mmap_src JPP((j_decompress_ptr cinfo, FILE * infile));
+
 /* Default parameter setup for compression */
 EXTERN(void) jpeg_set_defaults JPP((j_compress_ptr cinfo));
 /* Compression parameter setup aids */
@@ -964,6 +1000,10 @@ EXTERN(int) jpeg_consume_input JPP((j_decompress_ptr cinfo));
 
 /* Precalculate output dimensions for current decompression parameters. */
 EXTERN(void) jpeg_calc_output_dimensions JPP((j_decompress_ptr cinfo));
+/* Choose the fastest scaling that gives at least the requested size. */
+EXTERN(void) jpeg_set_thumbnail_size JPP((j_decompress_ptr cinfo,
+					  JDIMENSION width,
+					  JDIMENSION height));
 
 /* Install a special processing method for COM or APPn markers. */
 EXTERN(void) jpeg_set_marker_processor
@@ -1036,6 +1076,7 @@ struct jpeg_inverse_dct { long dummy; };
 struct jpeg_upsampler { long dummy; };
 struct jpeg_color_deconverter { long dummy; };
 struct jpeg_color_quantizer { long dummy; };
+struct jpeg_table_cache { long dummy; };
 #endif /* JPEG_INTERNALS */
 #endif /* INCOMPLETE_TYPES_BROKEN */
 
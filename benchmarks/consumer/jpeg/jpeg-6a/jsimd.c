@@ -0,0 +1,139 @@
+/*
+ * jsimd.c
+ *
+ * This file is part of the Independent JPEG Group's software.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains the run-time tests that decide whether the SIMD
+ * routines in jsimddct.c and jsimdcol.c may be used.  The method-selection
+ * code in the DCT managers, the upsampler and the color converters calls
+ * jsimd_can_xxx() and installs jsimd_xxx() in place of the C routine if
+ * it returns TRUE.
+ *
+ * Setting the environment variable JSIMD_FORCENONE to 1 makes every test
+ * fail, so that the C routines are used; this is useful for timing them or
+ * for checking that both give the same results.
+ */
+
+#define JPEG_INTERNALS
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jdct.h"		/* Private declarations for DCT subsystem */
+#include "jsimd.h"
+
+#ifdef SIMD_SUPPORTED
+
+#ifndef NO_GETENV
+#ifndef HAVE_STDLIB_H		/* <stdlib.h> should declare getenv() */
+extern char * getenv JPP((const char * name));
+#endif
+#endif
+
+
+#define JSIMD_SSE2	0x01	/* SSE2 instructions are available */
+#define JSIMD_AVX2	0x02	/* AVX2 instructions are available */
+
+static int simd_support = -1;	/* JSIMD_xxx flags, or -1 if not yet known */
+
+
+/*
+ * Find out what the CPU supports.  The answer never changes, so it does
+ * no harm if two threads happen to do this at once.
+ */
+
+LOCAL(int)
+init_simd (void)
+{
+  int support = 0;
+#ifndef NO_GETENV
+  char * env;
+#endif
+
+  if (simd_support >= 0)
+    return simd_support;
+
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2"))
+    support |= JSIMD_SSE2;
+  if (__builtin_cpu_supports("avx2"))
+    support |= JSIMD_AVX2;
+#ifndef NO_GETENV
+  if ((env = getenv("JSIMD_FORCENONE")) != NULL && env[0] == '1')
+    support = 0;
+#endif
+  simd_support = support;
+  return support;
+}
+
+
+/* The DCTs assume 16-bit coefficients, 32-bit DCTELEMs,
+ * and 16- or 32-bit multiplier tables.
+ */
+
+GLOBAL(boolean)
+jsimd_can_idct_islow (void)
+{
+  if (SIZEOF(JCOEF) != 2 ||
+      (SIZEOF(ISLOW_MULT_TYPE) != 2 && SIZEOF(ISLOW_MULT_TYPE) != 4))
+    return FALSE;
+  return (init_simd() & JSIMD_SSE2) != 0;
+}
+
+
+GLOBAL(boolean)
+jsimd_can_idct_ifast (void)
+{
+  if (SIZEOF(JCOEF) != 2 || SIZEOF(DCTELEM) != 4 ||
+      (SIZEOF(IFAST_MULT_TYPE) != 2 && SIZEOF(IFAST_MULT_TYPE) != 4))
+    return FALSE;
+  return (init_simd() & JSIMD_AVX2) != 0;
+}
+
+
+GLOBAL(boolean)
+jsimd_can_fdct_islow (void)
+{
+  if (SIZEOF(DCTELEM) != 4)
+    return FALSE;
+  return (init_simd() & JSIMD_SSE2) != 0;
+}
+
+
+GLOBAL(boolean)
+jsimd_can_h2v1_fancy_upsample (void)
+{
+  return (init_simd() & JSIMD_SSE2) != 0;
+}
+
+
+GLOBAL(boolean)
+jsimd_can_h2v2_fancy_upsample (void)
+{
+  return (init_simd() & JSIMD_SSE2) != 0;
+}
+
+
+/* The color converters assume the default R,G,B pixel layout. */
+
+GLOBAL(boolean)
+jsimd_can_ycc_rgb (void)
+{
+#if RGB_RED == 0 && RGB_GREEN == 1 && RGB_BLUE == 2 && RGB_PIXELSIZE == 3
+  return (init_simd() & JSIMD_SSE2) != 0;
+#else
+  return FALSE;
+#endif
+}
+
+
+GLOBAL(boolean)
+jsimd_can_rgb_ycc (void)
+{
+#if RGB_RED == 0 && RGB_GREEN == 1 && RGB_BLUE == 2 && RGB_PIXELSIZE == 3
+  return (init_simd() & JSIMD_SSE2) != 0;
+#else
+  return FALSE;
+#endif
+}
+
+#endif /* SIMD_SUPPORTED */
@@ -0,0 +1,84 @@
+/*
+ * jsimd.h
+ *
+ * This file is part of the Independent JPEG Group's software.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This include file declares the SIMD (SSE2/AVX2) versions of the integer
+ * DCTs, fancy upsampling and YCbCr<->RGB color conversion.  They live in
+ * jsimddct.c and jsimdcol.c; jsimd.c decides at run time whether the CPU
+ * can execute them.  Each one produces exactly the same output as the C
+ * routine it stands in for, so a module may switch freely between the two.
+ * These declarations are private to the modules that select methods.
+ */
+
+/* The SIMD code is written with GNU C vector intrinsics and target
+ * attributes, and assumes the standard 8-bit sample configuration.
+ */
+
+#if !defined(__GNUC__) || !(defined(__i386__) || defined(__x86_64__))
+#undef SIMD_SUPPORTED
+#endif
+#if BITS_IN_JSAMPLE != 8 || DCTSIZE != 8
+#undef SIMD_SUPPORTED
+#endif
+
+#ifdef SIMD_SUPPORTED
+
+/* Short forms of external names for systems with brain-damaged linkers. */
+
+#ifdef NEED_SHORT_EXTERNAL_NAMES
+#define jsimd_can_idct_islow	jSCIdIslow
+#define jsimd_can_idct_ifast	jSCIdIfast
+#define jsimd_can_fdct_islow	jSCFdIslow
+#define jsimd_can_h2v1_fancy_upsample	jSCh2v1Fancy
+#define jsimd_can_h2v2_fancy_upsample	jSCh2v2Fancy
+#define jsimd_can_ycc_rgb	jSCYccRgb
+#define jsimd_can_rgb_ycc	jSCRgbYcc
+#define jsimd_idct_islow	jSIdIslow
+#define jsimd_idct_ifast	jSIdIfast
+#define jsimd_fdct_islow	jSFdIslow
+#define jsimd_h2v1_fancy_upsample	jSh2v1Fancy
+#define jsimd_h2v2_fancy_upsample	jSh2v2Fancy
+#define jsimd_ycc_rgb_convert	jSYccRgb
+#define jsimd_rgb_ycc_convert	jSRgbYcc
+#endif /* NEED_SHORT_EXTERNAL_NAMES */
+
+/* Run-time tests (jsimd.c) */
+
+EXTERN(boolean) jsimd_can_idct_islow JPP((void));
+EXTERN(boolean) jsimd_can_idct_ifast JPP((void));
+EXTERN(boolean) jsimd_can_fdct_islow JPP((void));
+EXTERN(boolean) jsimd_can_h2v1_fancy_upsample JPP((void));
+EXTERN(boolean) jsimd_can_h2v2_fancy_upsample JPP((void));
+EXTERN(boolean) jsimd_can_ycc_rgb JPP((void));
+EXTERN(boolean) jsimd_can_rgb_ycc JPP((void));
+
+/* DCT routines (jsimddct.c); visible only where jdct.h is included */
+
+#ifdef IDCT_range_limit
+EXTERN(void) jsimd_idct_islow
+    JPP((j_decompress_ptr cinfo, jpeg_component_info * compptr,
+	 JCOEFPTR coef_block, JSAMPARRAY output_buf, JDIMENSION output_col));
+EXTERN(void) jsimd_idct_ifast
+    JPP((j_decompress_ptr cinfo, jpeg_component_info * compptr,
+	 JCOEFPTR coef_block, JSAMPARRAY output_buf, JDIMENSION output_col));
+EXTERN(void) jsimd_fdct_islow JPP((DCTELEM * data));
+#endif
+
+/* Upsampling and color conversion (jsimdcol.c) */
+
+EXTERN(void) jsimd_h2v1_fancy_upsample
+    JPP((j_decompress_ptr cinfo, jpeg_component_info * compptr,
+	 JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr));
+EXTERN(void) jsimd_h2v2_fancy_upsample
+    JPP((j_decompress_ptr cinfo, jpeg_component_info * compptr,
+	 JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr));
+EXTERN(void) jsimd_ycc_rgb_convert
+    JPP((j_decompress_ptr cinfo, JSAMPIMAGE input_buf, JDIMENSION input_row,
+	 JSAMPARRAY output_buf, int num_rows));
+EXTERN(void) jsimd_rgb_ycc_convert
+    JPP((j_compress_ptr cinfo, JSAMPARRAY input_buf, JSAMPIMAGE output_buf,
+	 JDIMENSION output_row, int num_rows));
+
+#endif /* SIMD_SUPPORTED */
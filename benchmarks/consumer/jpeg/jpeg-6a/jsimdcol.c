@@ -0,0 +1,504 @@
+/*
+ * jsimdcol.c
+ *
+ * This file is part of the Independent JPEG Group's software.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains SSE2 versions of the fancy upsampling routines of
+ * jdsample.c and of the YCbCr<->RGB color converters of jdcolor.c and
+ * jccolor.c.  Each gives exactly the same results as the C routine.  See
+ * jsimd.c for how they are selected.
+ *
+ * The C color converters look their products up in tables of fixed-point
+ * values.  We form the same products with PMADDWD instead; a constant too
+ * big for 16 bits is split between the two halves of a multiplier pair, or
+ * its whole multiple of 65536 is taken out and added after the shift.
+ * Either way the sums, and hence the results, are unchanged.
+ *
+ * Each routine does 16 pixels at a time and finishes a row in C.  None of
+ * them reads or writes outside the samples the C routine would touch.
+ */
+
+#define JPEG_INTERNALS
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jsimd.h"
+
+#ifdef SIMD_SUPPORTED
+
+#include <emmintrin.h>
+
+#define TARGET_SSE2  __attribute__((target("sse2")))
+
+#define SCALEBITS	16	/* as in jdcolor.c and jccolor.c */
+#define ONE_HALF	((INT32) 1 << (SCALEBITS-1))
+#define ONE		((INT32) 1 << SCALEBITS)
+#define CBCR_OFFSET	((INT32) CENTERJSAMPLE << SCALEBITS)
+#define FIX(x)		((INT32) ((x) * (1L<<SCALEBITS) + 0.5))
+
+/* PMADDWD multiplier for interleaved (a,b) pairs: yields a*ka + b*kb */
+
+#define PAIR(ka,kb)  _mm_set_epi16((short) (kb), (short) (ka), \
+				   (short) (kb), (short) (ka), \
+				   (short) (kb), (short) (ka), \
+				   (short) (kb), (short) (ka))
+
+#define LOADU(p)	_mm_loadu_si128((const __m128i *) (p))
+#define STOREU(p,v)	_mm_storeu_si128((__m128i *) (p), (v))
+
+
+/*
+ * Fancy upsampling, 2h1v.  For input columns 1 .. downsampled_width-2 the
+ * outputs are (3*this + last + 1) >> 2 and (3*this + next + 2) >> 2.
+ */
+
+/* Interleave eight even and eight odd 16-bit outputs into 16 samples */
+
+TARGET_SSE2 static INLINE __m128i
+interleave_outputs (__m128i even, __m128i odd)
+{
+  return _mm_packus_epi16(_mm_unpacklo_epi16(even, odd),
+			  _mm_unpackhi_epi16(even, odd));
+}
+
+TARGET_SSE2 LOCAL(JDIMENSION)
+h2v1_fancy_row (JSAMPROW inptr, JSAMPROW outptr, JDIMENSION width)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i one = _mm_set1_epi16(1), two = _mm_set1_epi16(2);
+  JDIMENSION col;
+
+  /* Columns col-1 .. col+16 must all exist */
+  for (col = 1; col + 16 < width; col += 16) {
+    __m128i last = LOADU(inptr + col - 1);
+    __m128i this = LOADU(inptr + col);
+    __m128i next = LOADU(inptr + col + 1);
+    __m128i t, l, n, t3;
+
+    t = _mm_unpacklo_epi8(this, zero);
+    l = _mm_unpacklo_epi8(last, zero);
+    n = _mm_unpacklo_epi8(next, zero);
+    t3 = _mm_add_epi16(_mm_add_epi16(t, t), t);
+    STOREU(outptr + 2*col,
+	   interleave_outputs(
+	     _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t3, l), one), 2),
+	     _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t3, n), two), 2)));
+
+    t = _mm_unpackhi_epi8(this, zero);
+    l = _mm_unpackhi_epi8(last, zero);
+    n = _mm_unpackhi_epi8(next, zero);
+    t3 = _mm_add_epi16(_mm_add_epi16(t, t), t);
+    STOREU(outptr + 2*col + 16,
+	   interleave_outputs(
+	     _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t3, l), one), 2),
+	     _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t3, n), two), 2)));
+  }
+  return col;
+}
+
+
+GLOBAL(void)
+jsimd_h2v1_fancy_upsample (j_decompress_ptr cinfo,
+			   jpeg_component_info * compptr,
+			   JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr)
+{
+  JSAMPARRAY output_data = *output_data_ptr;
+  register JSAMPROW inptr, outptr;
+  register int invalue;
+  JDIMENSION width = compptr->downsampled_width;
+  JDIMENSION col;
+  int inrow;
+
+  for (inrow = 0; inrow < cinfo->max_v_samp_factor; inrow++) {
+    inptr = input_data[inrow];
+    outptr = output_data[inrow];
+    /* Special case for first column */
+    invalue = GETJSAMPLE(inptr[0]);
+    outptr[0] = (JSAMPLE) invalue;
+    outptr[1] = (JSAMPLE) ((invalue * 3 + GETJSAMPLE(inptr[1]) + 2) >> 2);
+
+    for (col = h2v1_fancy_row(inptr, outptr, width); col < width-1; col++) {
+      invalue = GETJSAMPLE(inptr[col]) * 3;
+      outptr[2*col] = (JSAMPLE) ((invalue + GETJSAMPLE(inptr[col-1]) + 1) >> 2);
+      outptr[2*col+1] = (JSAMPLE) ((invalue + GETJSAMPLE(inptr[col+1]) + 2) >> 2);
+    }
+
+    /* Special case for last column */
+    invalue = GETJSAMPLE(inptr[col]);
+    outptr[2*col] = (JSAMPLE) ((invalue * 3 + GETJSAMPLE(inptr[col-1]) + 1) >> 2);
+    outptr[2*col+1] = (JSAMPLE) invalue;
+  }
+}
+
+
+/*
+ * Fancy upsampling, 2h2v.  With colsum = 3*nearer row + further row, the
+ * outputs for input columns 1 .. downsampled_width-2 are
+ * (3*thiscolsum + lastcolsum + 8) >> 4 and (3*thiscolsum + nextcolsum + 7) >> 4.
+ */
+
+TARGET_SSE2 static INLINE __m128i
+colsum8 (__m128i near8, __m128i far8)
+{
+  return _mm_add_epi16(_mm_add_epi16(near8, _mm_add_epi16(near8, near8)), far8);
+}
+
+TARGET_SSE2 LOCAL(JDIMENSION)
+h2v2_fancy_row (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW outptr,
+		JDIMENSION width)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i seven = _mm_set1_epi16(7), eight = _mm_set1_epi16(8);
+  JDIMENSION col;
+
+  /* Columns col-1 .. col+16 must all exist */
+  for (col = 1; col + 16 < width; col += 16) {
+    __m128i last0 = LOADU(inptr0 + col - 1), last1 = LOADU(inptr1 + col - 1);
+    __m128i this0 = LOADU(inptr0 + col), this1 = LOADU(inptr1 + col);
+    __m128i next0 = LOADU(inptr0 + col + 1), next1 = LOADU(inptr1 + col + 1);
+    __m128i thissum, lastsum, nextsum, this3;
+
+    thissum = colsum8(_mm_unpacklo_epi8(this0, zero),
+		      _mm_unpacklo_epi8(this1, zero));
+    lastsum = colsum8(_mm_unpacklo_epi8(last0, zero),
+		      _mm_unpacklo_epi8(last1, zero));
+    nextsum = colsum8(_mm_unpacklo_epi8(next0, zero),
+		      _mm_unpacklo_epi8(next1, zero));
+    this3 = _mm_add_epi16(_mm_add_epi16(thissum, thissum), thissum);
+    STOREU(outptr + 2*col,
+	   interleave_outputs(
+	     _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(this3, lastsum), eight), 4),
+	     _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(this3, nextsum), seven), 4)));
+
+    thissum = colsum8(_mm_unpackhi_epi8(this0, zero),
+		      _mm_unpackhi_epi8(this1, zero));
+    lastsum = colsum8(_mm_unpackhi_epi8(last0, zero),
+		      _mm_unpackhi_epi8(last1, zero));
+    nextsum = colsum8(_mm_unpackhi_epi8(next0, zero),
+		      _mm_unpackhi_epi8(next1, zero));
+    this3 = _mm_add_epi16(_mm_add_epi16(thissum, thissum), thissum);
+    STOREU(outptr + 2*col + 16,
+	   interleave_outputs(
+	     _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(this3, lastsum), eight), 4),
+	     _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(this3, nextsum), seven), 4)));
+  }
+  return col;
+}
+
+
+GLOBAL(void)
+jsimd_h2v2_fancy_upsample (j_decompress_ptr cinfo,
+			   jpeg_component_info * compptr,
+			   JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr)
+{
+  JSAMPARRAY output_data = *output_data_ptr;
+  register JSAMPROW inptr0, inptr1, outptr;
+  register int thiscolsum, lastcolsum, nextcolsum;
+  JDIMENSION width = compptr->downsampled_width;
+  JDIMENSION col;
+  int inrow, outrow, v;
+
+#define COLSUM(c)  (GETJSAMPLE(inptr0[c]) * 3 + GETJSAMPLE(inptr1[c]))
+
+  inrow = outrow = 0;
+  while (outrow < cinfo->max_v_samp_factor) {
+    for (v = 0; v < 2; v++) {
+      /* inptr0 points to nearest input row, inptr1 points to next nearest */
+      inptr0 = input_data[inrow];
+      if (v == 0)		/* next nearest is row above */
+	inptr1 = input_data[inrow-1];
+      else			/* next nearest is row below */
+	inptr1 = input_data[inrow+1];
+      outptr = output_data[outrow++];
+
+      /* Special case for first column */
+      thiscolsum = COLSUM(0);
+      outptr[0] = (JSAMPLE) ((thiscolsum * 4 + 8) >> 4);
+      outptr[1] = (JSAMPLE) ((thiscolsum * 3 + COLSUM(1) + 7) >> 4);
+
+      for (col = h2v2_fancy_row(inptr0, inptr1, outptr, width);
+	   col < width-1; col++) {
+	thiscolsum = COLSUM(col) * 3;
+	lastcolsum = COLSUM(col-1);
+	nextcolsum = COLSUM(col+1);
+	outptr[2*col] = (JSAMPLE) ((thiscolsum + lastcolsum + 8) >> 4);
+	outptr[2*col+1] = (JSAMPLE) ((thiscolsum + nextcolsum + 7) >> 4);
+      }
+
+      /* Special case for last column */
+      thiscolsum = COLSUM(col);
+      outptr[2*col] = (JSAMPLE) ((thiscolsum * 3 + COLSUM(col-1) + 8) >> 4);
+      outptr[2*col+1] = (JSAMPLE) ((thiscolsum * 4 + 7) >> 4);
+    }
+    inrow++;
+  }
+
+#undef COLSUM
+}
+
+
+/*
+ * YCbCr->RGB conversion.  jdcolor.c computes, with x = Cb or Cr - CENTERJSAMPLE,
+ *	R = Y + ((FIX(1.40200) * Cr_x + ONE_HALF) >> 16)
+ *	G = Y + ((- FIX(0.34414) * Cb_x - FIX(0.71414) * Cr_x + ONE_HALF) >> 16)
+ *	B = Y + ((FIX(1.77200) * Cb_x + ONE_HALF) >> 16)
+ * and clamps to 0..MAXJSAMPLE.  FIX(1.40200) and FIX(1.77200) exceed 16
+ * bits, as does FIX(0.71414) once paired with Cb; we take out ONE, 2*ONE
+ * and -ONE respectively and add Cr_x, 2*Cb_x and -Cr_x after shifting.
+ */
+
+#define K_R	(FIX(1.40200) - ONE)
+#define K_B	(FIX(1.77200) - 2*ONE)
+#define K_GB	(- FIX(0.34414))
+#define K_GR	(- FIX(0.71414) + ONE)
+
+/* One 16-bit vector of each output for eight pixels */
+
+TARGET_SSE2 static INLINE void
+ycc_rgb8 (__m128i y, __m128i cbx, __m128i crx,
+	  __m128i * r, __m128i * g, __m128i * b)
+{
+  /* ONE_HALF is formed as 2 * (ONE_HALF/2) in the multiply */
+  __m128i two = _mm_set1_epi16(2);
+  __m128i kr = PAIR(K_R, ONE_HALF/2);
+  __m128i kb = PAIR(K_B, ONE_HALF/2);
+  __m128i kg = PAIR(K_GB, K_GR);
+  __m128i half = _mm_set1_epi32(ONE_HALF);
+  __m128i lo, hi;
+
+  lo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(crx, two), kr), SCALEBITS);
+  hi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(crx, two), kr), SCALEBITS);
+  *r = _mm_add_epi16(_mm_add_epi16(y, crx), _mm_packs_epi32(lo, hi));
+
+  lo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(cbx, crx),
+						   kg), half), SCALEBITS);
+  hi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(cbx, crx),
+						   kg), half), SCALEBITS);
+  *g = _mm_add_epi16(_mm_sub_epi16(y, crx), _mm_packs_epi32(lo, hi));
+
+  lo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(cbx, two), kb), SCALEBITS);
+  hi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(cbx, two), kb), SCALEBITS);
+  *b = _mm_add_epi16(_mm_add_epi16(y, _mm_add_epi16(cbx, cbx)),
+		     _mm_packs_epi32(lo, hi));
+}
+
+/* Squeeze four R,G,B,0 pixels into the low 12 bytes */
+
+TARGET_SSE2 static INLINE __m128i
+pack_rgb4 (__m128i px)
+{
+  __m128i low_dword = _mm_set_epi32(0, -1, 0, -1);
+  __m128i low_qword = _mm_set_epi32(0, 0, -1, -1);
+
+  px = _mm_or_si128(_mm_and_si128(px, low_dword),
+		    _mm_srli_epi64(_mm_andnot_si128(low_dword, px), 8));
+  return _mm_or_si128(_mm_and_si128(px, low_qword),
+		      _mm_srli_si128(_mm_andnot_si128(low_qword, px), 2));
+}
+
+TARGET_SSE2 LOCAL(JDIMENSION)
+ycc_rgb_row (JSAMPROW inptr0, JSAMPROW inptr1, JSAMPROW inptr2,
+	     JSAMPROW outptr, JDIMENSION num_cols)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i center = _mm_set1_epi16(CENTERJSAMPLE);
+  JDIMENSION col;
+
+  for (col = 0; col + 16 <= num_cols; col += 16) {
+    __m128i y = LOADU(inptr0 + col);
+    __m128i cb = LOADU(inptr1 + col);
+    __m128i cr = LOADU(inptr2 + col);
+    __m128i rlo, glo, blo, rhi, ghi, bhi, rg, b0, px;
+    JSAMPROW out = outptr + col * RGB_PIXELSIZE;
+    int tail;
+
+    ycc_rgb8(_mm_unpacklo_epi8(y, zero),
+	     _mm_sub_epi16(_mm_unpacklo_epi8(cb, zero), center),
+	     _mm_sub_epi16(_mm_unpacklo_epi8(cr, zero), center),
+	     &rlo, &glo, &blo);
+    ycc_rgb8(_mm_unpackhi_epi8(y, zero),
+	     _mm_sub_epi16(_mm_unpackhi_epi8(cb, zero), center),
+	     _mm_sub_epi16(_mm_unpackhi_epi8(cr, zero), center),
+	     &rhi, &ghi, &bhi);
+    /* Saturating to bytes does the range limiting */
+    rlo = _mm_packus_epi16(rlo, rhi);
+    glo = _mm_packus_epi16(glo, ghi);
+    blo = _mm_packus_epi16(blo, bhi);
+
+    /* Pixels 0-3 and 4-7, then 8-11 and 12-15.  Each store leaves four
+     * bytes of junk for the next to overwrite; the last one is split so
+     * as not to run past the row.
+     */
+    rg = _mm_unpacklo_epi8(rlo, glo);
+    b0 = _mm_unpacklo_epi8(blo, zero);
+    STOREU(out, pack_rgb4(_mm_unpacklo_epi16(rg, b0)));
+    STOREU(out + 12, pack_rgb4(_mm_unpackhi_epi16(rg, b0)));
+    rg = _mm_unpackhi_epi8(rlo, glo);
+    b0 = _mm_unpackhi_epi8(blo, zero);
+    STOREU(out + 24, pack_rgb4(_mm_unpacklo_epi16(rg, b0)));
+    px = pack_rgb4(_mm_unpackhi_epi16(rg, b0));
+    _mm_storel_epi64((__m128i *) (out + 36), px);
+    tail = _mm_cvtsi128_si32(_mm_srli_si128(px, 8));
+    MEMCOPY(out + 44, &tail, 4);
+  }
+  return col;
+}
+
+
+GLOBAL(void)
+jsimd_ycc_rgb_convert (j_decompress_ptr cinfo,
+		       JSAMPIMAGE input_buf, JDIMENSION input_row,
+		       JSAMPARRAY output_buf, int num_rows)
+{
+  register int y, cbx, crx;
+  register JSAMPROW outptr;
+  register JSAMPROW inptr0, inptr1, inptr2;
+  register JDIMENSION col;
+  JDIMENSION num_cols = cinfo->output_width;
+  register JSAMPLE * range_limit = cinfo->sample_range_limit;
+
+  while (--num_rows >= 0) {
+    inptr0 = input_buf[0][input_row];
+    inptr1 = input_buf[1][input_row];
+    inptr2 = input_buf[2][input_row];
+    input_row++;
+    outptr = *output_buf++;
+    for (col = ycc_rgb_row(inptr0, inptr1, inptr2, outptr, num_cols);
+	 col < num_cols; col++) {
+      y  = GETJSAMPLE(inptr0[col]);
+      cbx = GETJSAMPLE(inptr1[col]) - CENTERJSAMPLE;
+      crx = GETJSAMPLE(inptr2[col]) - CENTERJSAMPLE;
+      outptr[col*RGB_PIXELSIZE + RGB_RED] = range_limit[y +
+	  (int) ((FIX(1.40200) * crx + ONE_HALF) >> SCALEBITS)];
+      outptr[col*RGB_PIXELSIZE + RGB_GREEN] = range_limit[y +
+	  (int) ((- FIX(0.34414) * cbx - FIX(0.71414) * crx + ONE_HALF)
+		 >> SCALEBITS)];
+      outptr[col*RGB_PIXELSIZE + RGB_BLUE] = range_limit[y +
+	  (int) ((FIX(1.77200) * cbx + ONE_HALF) >> SCALEBITS)];
+    }
+  }
+}
+
+
+/*
+ * RGB->YCbCr conversion.  jccolor.c computes
+ *	Y  = (FIX(0.29900)*R + FIX(0.58700)*G + FIX(0.11400)*B + ONE_HALF) >> 16
+ *	Cb = (-FIX(0.16874)*R - FIX(0.33126)*G + FIX(0.5)*B + CBCR_OFFSET
+ *	      + ONE_HALF-1) >> 16
+ *	Cr = (FIX(0.5)*R - FIX(0.41869)*G - FIX(0.08131)*B + CBCR_OFFSET
+ *	      + ONE_HALF-1) >> 16
+ * FIX(0.58700) and FIX(0.5) exceed 16 bits, so each is applied half at a
+ * time, to a pair holding its input twice.
+ */
+
+/* Spread four packed R,G,B pixels (low 12 bytes) to R,G,B,0 */
+
+TARGET_SSE2 static INLINE __m128i
+unpack_rgb4 (__m128i v)
+{
+  __m128i low3 = _mm_set_epi32(0, 0x00FFFFFF, 0, 0x00FFFFFF);
+  __m128i high3 = _mm_set_epi32(0x00FFFFFF, 0, 0x00FFFFFF, 0);
+
+  v = _mm_unpacklo_epi64(v, _mm_srli_si128(v, 6));
+  return _mm_or_si128(_mm_and_si128(v, low3),
+		      _mm_and_si128(_mm_slli_epi64(v, 8), high3));
+}
+
+/* Y, Cb, Cr for four R,G,B,0 pixels, as 32-bit values */
+
+TARGET_SSE2 static INLINE void
+rgb_ycc4 (__m128i px, __m128i * y, __m128i * cb, __m128i * cr)
+{
+  __m128i low_bytes = _mm_set1_epi32(0x00FF00FF);
+  __m128i rb = _mm_and_si128(px, low_bytes);	/* (R,B) */
+  __m128i g = _mm_srli_epi32(_mm_slli_epi32(px, 16), 24);
+  __m128i gg = _mm_or_si128(g, _mm_slli_epi32(g, 16));	/* (G,G) */
+  __m128i gb = _mm_or_si128(g, _mm_andnot_si128(_mm_set1_epi32(0xFFFF), rb));
+  __m128i rg = _mm_or_si128(_mm_and_si128(rb, _mm_set1_epi32(0xFFFF)),
+			    _mm_slli_epi32(g, 16));
+  __m128i chroma_offset = _mm_set1_epi32(CBCR_OFFSET + ONE_HALF-1);
+
+  *y = _mm_add_epi32(_mm_add_epi32(
+	 _mm_madd_epi16(rb, PAIR(FIX(0.29900), FIX(0.11400))),
+	 _mm_madd_epi16(gg, PAIR(FIX(0.58700)/2, FIX(0.58700)-FIX(0.58700)/2))),
+	 _mm_set1_epi32(ONE_HALF));
+  *cb = _mm_add_epi32(_mm_add_epi32(
+	  _mm_madd_epi16(rb, PAIR(- FIX(0.16874), FIX(0.50000)/2)),
+	  _mm_madd_epi16(gb, PAIR(- FIX(0.33126), FIX(0.50000)/2))),
+	  chroma_offset);
+  *cr = _mm_add_epi32(_mm_add_epi32(
+	  _mm_madd_epi16(rb, PAIR(FIX(0.50000)/2, - FIX(0.08131))),
+	  _mm_madd_epi16(rg, PAIR(FIX(0.50000)/2, - FIX(0.41869)))),
+	  chroma_offset);
+  *y = _mm_srli_epi32(*y, SCALEBITS);
+  *cb = _mm_srli_epi32(*cb, SCALEBITS);
+  *cr = _mm_srli_epi32(*cr, SCALEBITS);
+}
+
+TARGET_SSE2 LOCAL(JDIMENSION)
+rgb_ycc_row (JSAMPROW inptr, JSAMPROW outptr0, JSAMPROW outptr1,
+	     JSAMPROW outptr2, JDIMENSION num_cols)
+{
+  JDIMENSION col;
+
+  for (col = 0; col + 16 <= num_cols; col += 16) {
+    JSAMPROW in = inptr + col * RGB_PIXELSIZE;
+    __m128i y[4], cb[4], cr[4];
+    int k;
+
+    /* The last load ends at the last pixel and is shifted down */
+    rgb_ycc4(unpack_rgb4(LOADU(in)), &y[0], &cb[0], &cr[0]);
+    rgb_ycc4(unpack_rgb4(LOADU(in + 12)), &y[1], &cb[1], &cr[1]);
+    rgb_ycc4(unpack_rgb4(LOADU(in + 24)), &y[2], &cb[2], &cr[2]);
+    rgb_ycc4(unpack_rgb4(_mm_srli_si128(LOADU(in + 32), 4)),
+	     &y[3], &cb[3], &cr[3]);
+
+    for (k = 0; k < 4; k += 2) {
+      y[k] = _mm_packs_epi32(y[k], y[k+1]);
+      cb[k] = _mm_packs_epi32(cb[k], cb[k+1]);
+      cr[k] = _mm_packs_epi32(cr[k], cr[k+1]);
+    }
+    STOREU(outptr0 + col, _mm_packus_epi16(y[0], y[2]));
+    STOREU(outptr1 + col, _mm_packus_epi16(cb[0], cb[2]));
+    STOREU(outptr2 + col, _mm_packus_epi16(cr[0], cr[2]));
+  }
+  return col;
+}
+
+
+GLOBAL(void)
+jsimd_rgb_ycc_convert (j_compress_ptr cinfo,
+		       JSAMPARRAY input_buf, JSAMPIMAGE output_buf,
+		       JDIMENSION output_row, int num_rows)
+{
+  register INT32 r, g, b;
+  register JSAMPROW inptr;
+  register JSAMPROW outptr0, outptr1, outptr2;
+  register JDIMENSION col;
+  JDIMENSION num_cols = cinfo->image_width;
+
+  while (--num_rows >= 0) {
+    inptr = *input_buf++;
+    outptr0 = output_buf[0][output_row];
+    outptr1 = output_buf[1][output_row];
+    outptr2 = output_buf[2][output_row];
+    output_row++;
+    for (col = rgb_ycc_row(inptr, outptr0, outptr1, outptr2, num_cols);
+	 col < num_cols; col++) {
+      r = GETJSAMPLE(inptr[col*RGB_PIXELSIZE + RGB_RED]);
+      g = GETJSAMPLE(inptr[col*RGB_PIXELSIZE + RGB_GREEN]);
+      b = GETJSAMPLE(inptr[col*RGB_PIXELSIZE + RGB_BLUE]);
+      outptr0[col] = (JSAMPLE)
+	((FIX(0.29900) * r + FIX(0.58700) * g + FIX(0.11400) * b + ONE_HALF)
+	 >> SCALEBITS);
+      outptr1[col] = (JSAMPLE)
+	((- FIX(0.16874) * r - FIX(0.33126) * g + FIX(0.50000) * b
+	  + CBCR_OFFSET + ONE_HALF-1) >> SCALEBITS);
+      outptr2[col] = (JSAMPLE)
+	((FIX(0.50000) * r - FIX(0.41869) * g - FIX(0.08131) * b
+	  + CBCR_OFFSET + ONE_HALF-1) >> SCALEBITS);
+    }
+  }
+}
+
+#endif /* SIMD_SUPPORTED */
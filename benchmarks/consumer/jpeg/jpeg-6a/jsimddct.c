@@ -0,0 +1,704 @@
+/*
+ * jsimddct.c
+ *
+ * This file is part of the Independent JPEG Group's software.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains SIMD versions of three of the integer DCT routines:
+ *
+ *   jsimd_idct_islow	SSE2 version of jpeg_idct_islow (jidctint.c)
+ *   jsimd_fdct_islow	SSE2 version of jpeg_fdct_islow (jfdctint.c)
+ *   jsimd_idct_ifast	AVX2 version of jpeg_idct_ifast (jidctfst.c)
+ *
+ * Each gives exactly the same results as the C routine.  See jsimd.c for
+ * how they are selected.
+ *
+ * The islow routines keep one row (or column) of the block per register,
+ * as eight 16-bit lanes, and do all multiplications with PMADDWD, which
+ * multiplies two pairs of 16-bit values and adds the 32-bit products.
+ * The C code does not descale until the end of each pass, so every pass
+ * output is an exact linear combination of the pass inputs with constant
+ * integer weights.  We regroup the C code's products into pairs, which
+ * gives the same sums.  This is valid provided each pass's inputs fit in
+ * 16 bits; the weights are small enough that no 32-bit sum can then
+ * overflow.  Blocks that fail the check (possible only with corrupt data
+ * or unusual quantization tables) are handed to the C routine.
+ *
+ * The ifast IDCT needs no such care: AVX2 holds a full row of 32-bit
+ * DCTELEMs per register and can form the same 64-bit products as the C
+ * code's MULTIPLY, so that routine is a line-for-line translation.
+ */
+
+#define JPEG_INTERNALS
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jdct.h"		/* Private declarations for DCT subsystem */
+#include "jsimd.h"
+
+#ifdef SIMD_SUPPORTED
+
+#include <immintrin.h>
+
+#define TARGET_SSE2  __attribute__((target("sse2")))
+#define TARGET_AVX2  __attribute__((target("avx2")))
+
+
+/*
+ * Emulate the post-IDCT range_limit[x & RANGE_MASK] lookup on 32-bit lanes.
+ * The table (see prepare_range_limit_table in jdmaster.c) maps x modulo
+ * 1024, taken as a signed 10-bit value, to that value plus CENTERJSAMPLE
+ * clamped to 0..MAXJSAMPLE.  We do the modulo and the offset here; the
+ * clamp comes free with the saturating pack to bytes.
+ */
+
+#define RANGE_BITS  10		/* bits in RANGE_MASK */
+
+
+#ifdef DCT_ISLOW_SUPPORTED
+
+/* Scaling and constants as in jidctint.c and jfdctint.c */
+
+#define CONST_BITS  13
+#define PASS1_BITS  2
+
+#define FIX_0_298631336  2446
+#define FIX_0_390180644  3196
+#define FIX_0_541196100  4433
+#define FIX_0_765366865  6270
+#define FIX_0_899976223  7373
+#define FIX_1_175875602  9633
+#define FIX_1_501321110  12299
+#define FIX_1_847759065  15137
+#define FIX_1_961570560  16069
+#define FIX_2_053119869  16819
+#define FIX_2_562915447  20995
+#define FIX_3_072711026  25172
+
+/* PMADDWD multiplier for interleaved (a,b) pairs: yields a*ka + b*kb */
+
+#define PAIR(ka,kb)  _mm_set_epi16((short) (kb), (short) (ka), \
+				   (short) (kb), (short) (ka), \
+				   (short) (kb), (short) (ka), \
+				   (short) (kb), (short) (ka))
+
+typedef struct {		/* eight 16-bit pairs, interleaved */
+  __m128i lo, hi;
+} pairs8;
+
+typedef struct {		/* eight 32-bit values */
+  __m128i lo, hi;
+} dwords8;
+
+
+TARGET_SSE2 static INLINE pairs8
+interleave (__m128i a, __m128i b)
+{
+  pairs8 p;
+
+  p.lo = _mm_unpacklo_epi16(a, b);
+  p.hi = _mm_unpackhi_epi16(a, b);
+  return p;
+}
+
+TARGET_SSE2 static INLINE dwords8
+madd (pairs8 p, __m128i k)
+{
+  dwords8 r;
+
+  r.lo = _mm_madd_epi16(p.lo, k);
+  r.hi = _mm_madd_epi16(p.hi, k);
+  return r;
+}
+
+TARGET_SSE2 static INLINE dwords8
+add8 (dwords8 a, dwords8 b)
+{
+  a.lo = _mm_add_epi32(a.lo, b.lo);
+  a.hi = _mm_add_epi32(a.hi, b.hi);
+  return a;
+}
+
+TARGET_SSE2 static INLINE dwords8
+sub8 (dwords8 a, dwords8 b)
+{
+  a.lo = _mm_sub_epi32(a.lo, b.lo);
+  a.hi = _mm_sub_epi32(a.hi, b.hi);
+  return a;
+}
+
+/* DESCALE(x,n) on each lane */
+
+TARGET_SSE2 static INLINE dwords8
+descale8 (dwords8 x, int n)
+{
+  __m128i round = _mm_set1_epi32(1 << (n-1));
+
+  x.lo = _mm_srai_epi32(_mm_add_epi32(x.lo, round), n);
+  x.hi = _mm_srai_epi32(_mm_add_epi32(x.hi, round), n);
+  return x;
+}
+
+/* Nonzero lanes unless every value fits in 16 bits */
+
+TARGET_SSE2 static INLINE __m128i
+out_of_range16 (dwords8 x)
+{
+  __m128i bias = _mm_set1_epi32(0x8000);
+
+  return _mm_or_si128(_mm_srli_epi32(_mm_add_epi32(x.lo, bias), 16),
+		      _mm_srli_epi32(_mm_add_epi32(x.hi, bias), 16));
+}
+
+
+/*
+ * Transpose an 8x8 block of 16-bit values held one row per register.
+ */
+
+TARGET_SSE2 LOCAL(void)
+transpose_8x8 (__m128i r[8])
+{
+  __m128i a0, a1, a2, a3, a4, a5, a6, a7;
+  __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+  a0 = _mm_unpacklo_epi16(r[0], r[1]);
+  a1 = _mm_unpackhi_epi16(r[0], r[1]);
+  a2 = _mm_unpacklo_epi16(r[2], r[3]);
+  a3 = _mm_unpackhi_epi16(r[2], r[3]);
+  a4 = _mm_unpacklo_epi16(r[4], r[5]);
+  a5 = _mm_unpackhi_epi16(r[4], r[5]);
+  a6 = _mm_unpacklo_epi16(r[6], r[7]);
+  a7 = _mm_unpackhi_epi16(r[6], r[7]);
+
+  b0 = _mm_unpacklo_epi32(a0, a2);	/* columns 0,1 of rows 0-3 */
+  b1 = _mm_unpackhi_epi32(a0, a2);	/* columns 2,3 */
+  b2 = _mm_unpacklo_epi32(a1, a3);	/* columns 4,5 */
+  b3 = _mm_unpackhi_epi32(a1, a3);	/* columns 6,7 */
+  b4 = _mm_unpacklo_epi32(a4, a6);	/* same for rows 4-7 */
+  b5 = _mm_unpackhi_epi32(a4, a6);
+  b6 = _mm_unpacklo_epi32(a5, a7);
+  b7 = _mm_unpackhi_epi32(a5, a7);
+
+  r[0] = _mm_unpacklo_epi64(b0, b4);
+  r[1] = _mm_unpackhi_epi64(b0, b4);
+  r[2] = _mm_unpacklo_epi64(b1, b5);
+  r[3] = _mm_unpackhi_epi64(b1, b5);
+  r[4] = _mm_unpacklo_epi64(b2, b6);
+  r[5] = _mm_unpackhi_epi64(b2, b6);
+  r[6] = _mm_unpacklo_epi64(b3, b7);
+  r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+
+/*
+ * Odd part shared by the forward and inverse transforms.  With d,c,b,a
+ * the inputs that the C code multiplies by FIX_0_298631336,
+ * FIX_2_053119869, FIX_3_072711026 and FIX_1_501321110 respectively,
+ * and z1..z5 expanded, each result is a fixed sum of the four inputs.
+ * da and cb hold the inputs paired as (d,a) and (c,b).
+ */
+
+TARGET_SSE2 static INLINE void
+odd_part (pairs8 da, pairs8 cb,
+	  dwords8 * od, dwords8 * oc, dwords8 * ob, dwords8 * oa)
+{
+  *od = add8(madd(da, PAIR(FIX_0_298631336 - FIX_0_899976223
+			   - FIX_1_961570560 + FIX_1_175875602,
+			   FIX_1_175875602 - FIX_0_899976223)),
+	     madd(cb, PAIR(FIX_1_175875602,
+			   FIX_1_175875602 - FIX_1_961570560)));
+  *oc = add8(madd(da, PAIR(FIX_1_175875602,
+			   FIX_1_175875602 - FIX_0_390180644)),
+	     madd(cb, PAIR(FIX_2_053119869 - FIX_2_562915447
+			   - FIX_0_390180644 + FIX_1_175875602,
+			   FIX_1_175875602 - FIX_2_562915447)));
+  *ob = add8(madd(da, PAIR(FIX_1_175875602 - FIX_1_961570560,
+			   FIX_1_175875602)),
+	     madd(cb, PAIR(FIX_1_175875602 - FIX_2_562915447,
+			   FIX_3_072711026 - FIX_2_562915447
+			   - FIX_1_961570560 + FIX_1_175875602)));
+  *oa = add8(madd(da, PAIR(FIX_1_175875602 - FIX_0_899976223,
+			   FIX_1_501321110 - FIX_0_899976223
+			   - FIX_0_390180644 + FIX_1_175875602)),
+	     madd(cb, PAIR(FIX_1_175875602 - FIX_0_390180644,
+			   FIX_1_175875602)));
+}
+
+
+/*
+ * One pass of the islow IDCT on eight columns at once (in[k] holds input
+ * row k).  The results are not descaled.
+ */
+
+TARGET_SSE2 static INLINE void
+idct_islow_pass (const __m128i in[8], dwords8 out[8])
+{
+  dwords8 tmp0, tmp1, tmp2, tmp3, tmp10, tmp11, tmp12, tmp13;
+  dwords8 od, oc, ob, oa;
+  pairs8 p04 = interleave(in[0], in[4]);
+  pairs8 p26 = interleave(in[2], in[6]);
+
+  /* Even part */
+
+  tmp0 = madd(p04, PAIR(1 << CONST_BITS, 1 << CONST_BITS));
+  tmp1 = madd(p04, PAIR(1 << CONST_BITS, - (1 << CONST_BITS)));
+  tmp2 = madd(p26, PAIR(FIX_0_541196100, FIX_0_541196100 - FIX_1_847759065));
+  tmp3 = madd(p26, PAIR(FIX_0_541196100 + FIX_0_765366865, FIX_0_541196100));
+
+  tmp10 = add8(tmp0, tmp3);
+  tmp13 = sub8(tmp0, tmp3);
+  tmp11 = add8(tmp1, tmp2);
+  tmp12 = sub8(tmp1, tmp2);
+
+  /* Odd part */
+
+  odd_part(interleave(in[7], in[1]), interleave(in[5], in[3]),
+	   &od, &oc, &ob, &oa);
+
+  out[0] = add8(tmp10, oa);
+  out[7] = sub8(tmp10, oa);
+  out[1] = add8(tmp11, ob);
+  out[6] = sub8(tmp11, ob);
+  out[2] = add8(tmp12, oc);
+  out[5] = sub8(tmp12, oc);
+  out[3] = add8(tmp13, od);
+  out[4] = sub8(tmp13, od);
+}
+
+
+/* Load eight islow multipliers as 16-bit values (saturating) */
+
+TARGET_SSE2 static INLINE __m128i
+load_islow_mult (const ISLOW_MULT_TYPE * q)
+{
+  if (SIZEOF(ISLOW_MULT_TYPE) == 2)
+    return _mm_loadu_si128((const __m128i *) q);
+  return _mm_packs_epi32(_mm_loadu_si128((const __m128i *) q),
+			 _mm_loadu_si128((const __m128i *) (q + 4)));
+}
+
+
+/*
+ * Dequantize and inverse-DCT one block.  Returns FALSE, having stored
+ * nothing, if the block is out of range for 16-bit arithmetic.
+ */
+
+TARGET_SSE2 LOCAL(boolean)
+idct_islow_sse2 (jpeg_component_info * compptr, JCOEFPTR coef_block,
+		 JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  ISLOW_MULT_TYPE * quantptr = (ISLOW_MULT_TYPE *) compptr->dct_table;
+  __m128i row[DCTSIZE];
+  dwords8 out[DCTSIZE];
+  __m128i bad = _mm_setzero_si128();
+  __m128i mult_max = _mm_set1_epi16(0x7FFF);
+  int i;
+
+  /* Dequantize.  Both the multipliers and the products must fit in 16
+   * bits; a multiplier too big for 16 bits packs to 0x7FFF.
+   */
+  for (i = 0; i < DCTSIZE; i++) {
+    __m128i coef = _mm_loadu_si128((const __m128i *) (coef_block + i*DCTSIZE));
+    __m128i mult = load_islow_mult(quantptr + i*DCTSIZE);
+    __m128i lo = _mm_mullo_epi16(coef, mult);
+    __m128i hi = _mm_mulhi_epi16(coef, mult);
+
+    bad = _mm_or_si128(bad, _mm_cmpeq_epi16(mult, mult_max));
+    bad = _mm_or_si128(bad, _mm_xor_si128(hi, _mm_srai_epi16(lo, 15)));
+    row[i] = lo;
+  }
+
+  /* Pass 1: process columns.  The results must fit in 16 bits too. */
+
+  idct_islow_pass(row, out);
+  for (i = 0; i < DCTSIZE; i++) {
+    out[i] = descale8(out[i], CONST_BITS-PASS1_BITS);
+    bad = _mm_or_si128(bad, out_of_range16(out[i]));
+    row[i] = _mm_packs_epi32(out[i].lo, out[i].hi);
+  }
+  if (_mm_movemask_epi8(_mm_cmpeq_epi8(bad, _mm_setzero_si128())) != 0xFFFF)
+    return FALSE;
+
+  /* Pass 2: process rows, now held one per register after transposing.
+   * out[k] then holds output column k, which we range-limit and transpose
+   * back.
+   */
+
+  transpose_8x8(row);
+  idct_islow_pass(row, out);
+  for (i = 0; i < DCTSIZE; i++) {
+    dwords8 x = descale8(out[i], CONST_BITS+PASS1_BITS+3);
+
+    x.lo = _mm_srai_epi32(_mm_slli_epi32(x.lo, 32-RANGE_BITS), 32-RANGE_BITS);
+    x.hi = _mm_srai_epi32(_mm_slli_epi32(x.hi, 32-RANGE_BITS), 32-RANGE_BITS);
+    row[i] = _mm_add_epi16(_mm_packs_epi32(x.lo, x.hi),
+			   _mm_set1_epi16(CENTERJSAMPLE));
+  }
+  transpose_8x8(row);
+
+  for (i = 0; i < DCTSIZE; i += 2) {
+    __m128i samples = _mm_packus_epi16(row[i], row[i+1]);
+
+    _mm_storel_epi64((__m128i *) (output_buf[i] + output_col), samples);
+    _mm_storel_epi64((__m128i *) (output_buf[i+1] + output_col),
+		     _mm_srli_si128(samples, 8));
+  }
+  return TRUE;
+}
+
+
+GLOBAL(void)
+jsimd_idct_islow (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+		  JCOEFPTR coef_block,
+		  JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  if (! idct_islow_sse2(compptr, coef_block, output_buf, output_col))
+    jpeg_idct_islow(cinfo, compptr, coef_block, output_buf, output_col);
+}
+
+
+/*
+ * Forward DCT of one block.  forward_DCT (jcdctmgr.c) only ever passes
+ * level-shifted samples, in -CENTERJSAMPLE..CENTERJSAMPLE-1; with those,
+ * all values up to the final 32-bit sums of pass 2 fit in 16 bits.
+ * Returns FALSE, having changed nothing, for any other input.
+ */
+
+TARGET_SSE2 LOCAL(boolean)
+fdct_islow_sse2 (DCTELEM * data)
+{
+  __m128i row[DCTSIZE], vmax, vmin;
+  __m128i tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+  __m128i tmp10, tmp11, tmp12, tmp13;
+  dwords8 od, oc, ob, oa, x;
+  pairs8 p;
+  int i;
+
+  for (i = 0; i < DCTSIZE; i++)
+    row[i] = _mm_packs_epi32(_mm_loadu_si128((const __m128i *)
+					     (data + i*DCTSIZE)),
+			     _mm_loadu_si128((const __m128i *)
+					     (data + i*DCTSIZE + 4)));
+  vmax = vmin = row[0];
+  for (i = 1; i < DCTSIZE; i++) {
+    vmax = _mm_max_epi16(vmax, row[i]);
+    vmin = _mm_min_epi16(vmin, row[i]);
+  }
+  if (_mm_movemask_epi8(_mm_or_si128(
+	  _mm_cmpgt_epi16(vmax, _mm_set1_epi16(CENTERJSAMPLE)),
+	  _mm_cmplt_epi16(vmin, _mm_set1_epi16(-CENTERJSAMPLE)))) != 0)
+    return FALSE;
+
+  /* Pass 1: process rows, held one per register after transposing.
+   * row[k] then receives coefficient k of every row.
+   */
+
+  transpose_8x8(row);
+
+  tmp0 = _mm_add_epi16(row[0], row[7]);
+  tmp7 = _mm_sub_epi16(row[0], row[7]);
+  tmp1 = _mm_add_epi16(row[1], row[6]);
+  tmp6 = _mm_sub_epi16(row[1], row[6]);
+  tmp2 = _mm_add_epi16(row[2], row[5]);
+  tmp5 = _mm_sub_epi16(row[2], row[5]);
+  tmp3 = _mm_add_epi16(row[3], row[4]);
+  tmp4 = _mm_sub_epi16(row[3], row[4]);
+
+  tmp10 = _mm_add_epi16(tmp0, tmp3);
+  tmp13 = _mm_sub_epi16(tmp0, tmp3);
+  tmp11 = _mm_add_epi16(tmp1, tmp2);
+  tmp12 = _mm_sub_epi16(tmp1, tmp2);
+
+  row[0] = _mm_slli_epi16(_mm_add_epi16(tmp10, tmp11), PASS1_BITS);
+  row[4] = _mm_slli_epi16(_mm_sub_epi16(tmp10, tmp11), PASS1_BITS);
+
+  p = interleave(tmp12, tmp13);
+  x = descale8(madd(p, PAIR(FIX_0_541196100,
+			    FIX_0_541196100 + FIX_0_765366865)),
+	       CONST_BITS-PASS1_BITS);
+  row[2] = _mm_packs_epi32(x.lo, x.hi);
+  x = descale8(madd(p, PAIR(FIX_0_541196100 - FIX_1_847759065,
+			    FIX_0_541196100)),
+	       CONST_BITS-PASS1_BITS);
+  row[6] = _mm_packs_epi32(x.lo, x.hi);
+
+  odd_part(interleave(tmp4, tmp7), interleave(tmp5, tmp6),
+	   &od, &oc, &ob, &oa);
+  x = descale8(od, CONST_BITS-PASS1_BITS);
+  row[7] = _mm_packs_epi32(x.lo, x.hi);
+  x = descale8(oc, CONST_BITS-PASS1_BITS);
+  row[5] = _mm_packs_epi32(x.lo, x.hi);
+  x = descale8(ob, CONST_BITS-PASS1_BITS);
+  row[3] = _mm_packs_epi32(x.lo, x.hi);
+  x = descale8(oa, CONST_BITS-PASS1_BITS);
+  row[1] = _mm_packs_epi32(x.lo, x.hi);
+
+  /* Pass 2: process columns.  Transposing back puts row k of the
+   * intermediate result in row[k], so each output is a row of data[].
+   */
+
+  transpose_8x8(row);
+
+  tmp0 = _mm_add_epi16(row[0], row[7]);
+  tmp7 = _mm_sub_epi16(row[0], row[7]);
+  tmp1 = _mm_add_epi16(row[1], row[6]);
+  tmp6 = _mm_sub_epi16(row[1], row[6]);
+  tmp2 = _mm_add_epi16(row[2], row[5]);
+  tmp5 = _mm_sub_epi16(row[2], row[5]);
+  tmp3 = _mm_add_epi16(row[3], row[4]);
+  tmp4 = _mm_sub_epi16(row[3], row[4]);
+
+  tmp10 = _mm_add_epi16(tmp0, tmp3);
+  tmp13 = _mm_sub_epi16(tmp0, tmp3);
+  tmp11 = _mm_add_epi16(tmp1, tmp2);
+  tmp12 = _mm_sub_epi16(tmp1, tmp2);
+
+#define STORE_ROW(k,v)  \
+  (_mm_storeu_si128((__m128i *) (data + (k)*DCTSIZE), (v).lo), \
+   _mm_storeu_si128((__m128i *) (data + (k)*DCTSIZE + 4), (v).hi))
+
+  /* tmp10 + tmp11 may need 17 bits, so add them as 32-bit products */
+  p = interleave(tmp10, tmp11);
+  STORE_ROW(0, descale8(madd(p, PAIR(1, 1)), PASS1_BITS));
+  STORE_ROW(4, descale8(madd(p, PAIR(1, -1)), PASS1_BITS));
+
+  p = interleave(tmp12, tmp13);
+  STORE_ROW(2, descale8(madd(p, PAIR(FIX_0_541196100,
+				     FIX_0_541196100 + FIX_0_765366865)),
+			CONST_BITS+PASS1_BITS));
+  STORE_ROW(6, descale8(madd(p, PAIR(FIX_0_541196100 - FIX_1_847759065,
+				     FIX_0_541196100)),
+			CONST_BITS+PASS1_BITS));
+
+  odd_part(interleave(tmp4, tmp7), interleave(tmp5, tmp6),
+	   &od, &oc, &ob, &oa);
+  STORE_ROW(7, descale8(od, CONST_BITS+PASS1_BITS));
+  STORE_ROW(5, descale8(oc, CONST_BITS+PASS1_BITS));
+  STORE_ROW(3, descale8(ob, CONST_BITS+PASS1_BITS));
+  STORE_ROW(1, descale8(oa, CONST_BITS+PASS1_BITS));
+
+#undef STORE_ROW
+
+  return TRUE;
+}
+
+
+GLOBAL(void)
+jsimd_fdct_islow (DCTELEM * data)
+{
+  if (! fdct_islow_sse2(data))
+    jpeg_fdct_islow(data);
+}
+
+#undef CONST_BITS
+#undef PASS1_BITS
+
+#endif /* DCT_ISLOW_SUPPORTED */
+
+
+#ifdef DCT_IFAST_SUPPORTED
+
+/* Scaling and constants as in jidctfst.c */
+
+#define CONST_BITS  8
+#define PASS1_BITS  2
+
+#define FAST_1_082392200  277
+#define FAST_1_414213562  362
+#define FAST_1_847759065  473
+#define FAST_2_613125930  669
+
+
+/*
+ * MULTIPLY(var,const) of jidctfst.c: the product is formed in INT32 (at
+ * least as wide as a DCTELEM), descaled, and cut back to a DCTELEM.  We
+ * form 64-bit products of the even and odd lanes separately; after the
+ * shift, the low 32 bits of each are what the C code keeps.
+ */
+
+TARGET_AVX2 static INLINE __m256i
+multiply_fast (__m256i x, int k)
+{
+  __m256i kk = _mm256_set1_epi32(k);
+  __m256i even = _mm256_mul_epi32(x, kk);
+  __m256i odd = _mm256_mul_epi32(_mm256_srli_epi64(x, 32), kk);
+
+#ifdef USE_ACCURATE_ROUNDING
+  even = _mm256_add_epi64(even, _mm256_set1_epi64x(1 << (CONST_BITS-1)));
+  odd = _mm256_add_epi64(odd, _mm256_set1_epi64x(1 << (CONST_BITS-1)));
+#endif
+  even = _mm256_srli_epi64(even, CONST_BITS);
+  odd = _mm256_slli_epi64(odd, 32 - CONST_BITS);
+  return _mm256_blend_epi32(even, odd, 0xAA);
+}
+
+
+/*
+ * One pass of the ifast IDCT on eight columns at once, in place.
+ */
+
+TARGET_AVX2 static INLINE void
+idct_ifast_pass (__m256i d[8])
+{
+  __m256i tmp0, tmp1, tmp2, tmp3, tmp4, tmp5, tmp6, tmp7;
+  __m256i tmp10, tmp11, tmp12, tmp13;
+  __m256i z5, z10, z11, z12, z13;
+
+  /* Even part */
+
+  tmp10 = _mm256_add_epi32(d[0], d[4]);	/* phase 3 */
+  tmp11 = _mm256_sub_epi32(d[0], d[4]);
+
+  tmp13 = _mm256_add_epi32(d[2], d[6]);	/* phases 5-3 */
+  tmp12 = _mm256_sub_epi32(multiply_fast(_mm256_sub_epi32(d[2], d[6]),
+					 FAST_1_414213562), tmp13);
+
+  tmp0 = _mm256_add_epi32(tmp10, tmp13);	/* phase 2 */
+  tmp3 = _mm256_sub_epi32(tmp10, tmp13);
+  tmp1 = _mm256_add_epi32(tmp11, tmp12);
+  tmp2 = _mm256_sub_epi32(tmp11, tmp12);
+
+  /* Odd part */
+
+  z13 = _mm256_add_epi32(d[5], d[3]);	/* phase 6 */
+  z10 = _mm256_sub_epi32(d[5], d[3]);
+  z11 = _mm256_add_epi32(d[1], d[7]);
+  z12 = _mm256_sub_epi32(d[1], d[7]);
+
+  tmp7 = _mm256_add_epi32(z11, z13);	/* phase 5 */
+  tmp11 = multiply_fast(_mm256_sub_epi32(z11, z13), FAST_1_414213562);
+
+  z5 = multiply_fast(_mm256_add_epi32(z10, z12), FAST_1_847759065);
+  tmp10 = _mm256_sub_epi32(multiply_fast(z12, FAST_1_082392200), z5);
+  tmp12 = _mm256_add_epi32(multiply_fast(z10, - FAST_2_613125930), z5);
+
+  tmp6 = _mm256_sub_epi32(tmp12, tmp7);	/* phase 2 */
+  tmp5 = _mm256_sub_epi32(tmp11, tmp6);
+  tmp4 = _mm256_add_epi32(tmp10, tmp5);
+
+  d[0] = _mm256_add_epi32(tmp0, tmp7);
+  d[7] = _mm256_sub_epi32(tmp0, tmp7);
+  d[1] = _mm256_add_epi32(tmp1, tmp6);
+  d[6] = _mm256_sub_epi32(tmp1, tmp6);
+  d[2] = _mm256_add_epi32(tmp2, tmp5);
+  d[5] = _mm256_sub_epi32(tmp2, tmp5);
+  d[4] = _mm256_add_epi32(tmp3, tmp4);
+  d[3] = _mm256_sub_epi32(tmp3, tmp4);
+}
+
+
+/*
+ * Transpose an 8x8 block of 32-bit values held one row per register.
+ */
+
+TARGET_AVX2 LOCAL(void)
+transpose_8x8_epi32 (__m256i r[8])
+{
+  __m256i t0, t1, t2, t3, t4, t5, t6, t7;
+  __m256i u0, u1, u2, u3, u4, u5, u6, u7;
+
+  t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+  t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+  t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+  t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+  t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+  t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+  t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+  t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+  u0 = _mm256_unpacklo_epi64(t0, t2);	/* columns 0 and 4 of rows 0-3 */
+  u1 = _mm256_unpackhi_epi64(t0, t2);	/* columns 1 and 5 */
+  u2 = _mm256_unpacklo_epi64(t1, t3);	/* columns 2 and 6 */
+  u3 = _mm256_unpackhi_epi64(t1, t3);	/* columns 3 and 7 */
+  u4 = _mm256_unpacklo_epi64(t4, t6);	/* same for rows 4-7 */
+  u5 = _mm256_unpackhi_epi64(t4, t6);
+  u6 = _mm256_unpacklo_epi64(t5, t7);
+  u7 = _mm256_unpackhi_epi64(t5, t7);
+
+  r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+  r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+  r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+  r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+  r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+  r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+  r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+  r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+
+TARGET_AVX2 LOCAL(void)
+idct_ifast_avx2 (jpeg_component_info * compptr, JCOEFPTR coef_block,
+		 JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  IFAST_MULT_TYPE * quantptr = (IFAST_MULT_TYPE *) compptr->dct_table;
+  __m256i d[DCTSIZE];
+  int i;
+
+  /* Dequantize; d[k] holds row k */
+  for (i = 0; i < DCTSIZE; i++) {
+    __m256i coef = _mm256_cvtepi16_epi32(
+      _mm_loadu_si128((const __m128i *) (coef_block + i*DCTSIZE)));
+    __m256i mult;
+
+    if (SIZEOF(IFAST_MULT_TYPE) == 2)
+      mult = _mm256_cvtepi16_epi32(
+	_mm_loadu_si128((const __m128i *) (quantptr + i*DCTSIZE)));
+    else
+      mult = _mm256_loadu_si256((const __m256i *) (quantptr + i*DCTSIZE));
+    d[i] = _mm256_mullo_epi32(coef, mult);
+  }
+
+  /* Pass 1: process columns.  Pass 2: process rows. */
+
+  idct_ifast_pass(d);
+  transpose_8x8_epi32(d);
+  idct_ifast_pass(d);
+
+  /* d[k] holds output column k: descale as IDESCALE does, range-limit,
+   * and transpose back to rows.
+   */
+  for (i = 0; i < DCTSIZE; i++) {
+    __m256i x = d[i];
+
+#ifdef USE_ACCURATE_ROUNDING
+    x = _mm256_add_epi32(x, _mm256_set1_epi32(1 << (PASS1_BITS+3-1)));
+#endif
+    x = _mm256_srai_epi32(x, PASS1_BITS+3);
+    x = _mm256_srai_epi32(_mm256_slli_epi32(x, 32-RANGE_BITS), 32-RANGE_BITS);
+    d[i] = _mm256_add_epi32(x, _mm256_set1_epi32(CENTERJSAMPLE));
+  }
+  transpose_8x8_epi32(d);
+
+  for (i = 0; i < DCTSIZE; i += 4) {
+    /* Packing works within 128-bit lanes, leaving the left and right
+     * halves of rows i..i+3 in alternate dwords; put them back together.
+     */
+    __m256i samples = _mm256_packus_epi16(_mm256_packs_epi32(d[i], d[i+1]),
+					  _mm256_packs_epi32(d[i+2], d[i+3]));
+    __m128i r01, r23;
+
+    samples = _mm256_permutevar8x32_epi32(samples,
+					  _mm256_setr_epi32(0, 4, 1, 5,
+							    2, 6, 3, 7));
+    r01 = _mm256_castsi256_si128(samples);
+    r23 = _mm256_extracti128_si256(samples, 1);
+    _mm_storel_epi64((__m128i *) (output_buf[i] + output_col), r01);
+    _mm_storel_epi64((__m128i *) (output_buf[i+1] + output_col),
+		     _mm_srli_si128(r01, 8));
+    _mm_storel_epi64((__m128i *) (output_buf[i+2] + output_col), r23);
+    _mm_storel_epi64((__m128i *) (output_buf[i+3] + output_col),
+		     _mm_srli_si128(r23, 8));
+  }
+}
+
+
+GLOBAL(void)
+jsimd_idct_ifast (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+		  JCOEFPTR coef_block,
+		  JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  idct_ifast_avx2(compptr, coef_block, output_buf, output_col);
+}
+
+#endif /* DCT_IFAST_SUPPORTED */
+
+#endif /* SIMD_SUPPORTED */
@@ -177,3 +177,91 @@ jzero_far (void FAR * target, size_t bytestozero)
   }
 #endif
 }
+
+
+/*
+ * Support for reuse mode (see reuse_image_pools in jpeglib.h).
+ * A module that builds a table from a Huffman or quantization table calls
+ * one of these in reuse mode instead of allocating the table itself.
+ * *pderived is pointed at a table of derivedsize bytes in the permanent
+ * pool, which is kept across images.  The return value is TRUE if that
+ * table was last built from a table with the same contents, in which case
+ * the caller need not build it again.  Otherwise the source table is
+ * remembered and the caller must (re)build the derived table.
+ */
+
+LOCAL(struct jpeg_table_cache *)
+get_table_cache (j_common_ptr cinfo)
+/* Find the object's table cache, creating it on first use */
+{
+  struct jpeg_table_cache ** pcache;
+
+  if (cinfo->is_decompressor)
+    pcache = & ((j_decompress_ptr) cinfo)->tblcache;
+  else
+    pcache = & ((j_compress_ptr) cinfo)->tblcache;
+  if (*pcache == NULL) {
+    *pcache = (struct jpeg_table_cache *)
+      (*cinfo->mem->alloc_small) (cinfo, JPOOL_PERMANENT,
+				  SIZEOF(struct jpeg_table_cache));
+    MEMZERO(*pcache, SIZEOF(struct jpeg_table_cache));
+  }
+  return *pcache;
+}
+
+
+GLOBAL(boolean)
+jreuse_huff_table (j_common_ptr cinfo, boolean isDC, int tblno,
+		   JHUFF_TBL * htbl, size_t derivedsize, void ** pderived)
+/* Find the kept table derived from DC or AC Huffman table tblno */
+{
+  struct jpeg_table_cache * cache = get_table_cache(cinfo);
+  jpeg_reused_huff_tbl * entry;
+  int l, numsymbols;
+
+  entry = isDC ? & cache->dc_huff[tblno] : & cache->ac_huff[tblno];
+  /* Only the symbols actually defined matter; the rest may be garbage */
+  numsymbols = 0;
+  for (l = 1; l <= 16; l++)
+    numsymbols += htbl->bits[l];
+  if (numsymbols > 256)		/* don't overrun huffval[] */
+    numsymbols = 256;
+
+  if (entry->derived == NULL) {
+    entry->derived = (*cinfo->mem->alloc_small) (cinfo, JPOOL_PERMANENT,
+						 derivedsize);
+  } else if (MEMCMP(entry->source.bits, htbl->bits,
+		    SIZEOF(htbl->bits)) == 0 &&
+	     MEMCMP(entry->source.huffval, htbl->huffval,
+		    (size_t) numsymbols) == 0) {
+    *pderived = entry->derived;
+    return TRUE;
+  }
+  MEMCOPY(entry->source.bits, htbl->bits, SIZEOF(htbl->bits));
+  MEMCOPY(entry->source.huffval, htbl->huffval, (size_t) numsymbols);
+  *pderived = entry->derived;
+  return FALSE;
+}
+
+
+GLOBAL(boolean)
+jreuse_quant_table (j_common_ptr cinfo, int which, int method,
+		    JQUANT_TBL * qtbl, size_t derivedsize, void ** pderived)
+/* Find the kept table for DCT method method derived from a quant table; */
+/* which is the table number when compressing, component index otherwise */
+{
+  struct jpeg_table_cache * cache = get_table_cache(cinfo);
+  jpeg_reused_quant_tbl * entry = & cache->quant[which][method];
+
+  if (entry->derived == NULL) {
+    entry->derived = (*cinfo->mem->alloc_small) (cinfo, JPOOL_PERMANENT,
+						 derivedsize);
+  } else if (MEMCMP(entry->source.quantval, qtbl->quantval,
+		    SIZEOF(qtbl->quantval)) == 0) {
+    *pderived = entry->derived;
+    return TRUE;
+  }
+  MEMCOPY(entry->source.quantval, qtbl->quantval, SIZEOF(qtbl->quantval));
+  *pderived = entry->derived;
+  return FALSE;
+}
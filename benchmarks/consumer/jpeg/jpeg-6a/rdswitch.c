@@ -330,3 +330,25 @@ set_sample_factors (j_compress_ptr cinfo, char *arg)
   }
   return TRUE;
 }
+
+
+GLOBAL(void)
+set_restart_segments (j_compress_ptr cinfo, int nsegments)
+/* Choose a restart interval, in whole MCU rows, that divides the image into
+ * about nsegments restart intervals.  A decoder that decodes intervals in
+ * parallel (djpeg -threads) can then keep that many threads busy.
+ * Must be called after the sampling factors are final.
+ */
+{
+  int ci, max_v_samp = 1;
+  long MCU_rows;
+
+  for (ci = 0; ci < cinfo->num_components; ci++) {
+    if (cinfo->comp_info[ci].v_samp_factor > max_v_samp)
+      max_v_samp = cinfo->comp_info[ci].v_samp_factor;
+  }
+  MCU_rows = ((long) cinfo->image_height + DCTSIZE * max_v_samp - 1) /
+	     (DCTSIZE * max_v_samp);
+  cinfo->restart_interval = 0;
+  cinfo->restart_in_rows = (int) ((MCU_rows + nsegments - 1) / nsegments);
+}
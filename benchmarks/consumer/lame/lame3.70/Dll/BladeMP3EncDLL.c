@@ -60,6 +60,10 @@ lame_global_flags gf;
 static void InitParams()
 {
     bFirstFrame=TRUE;
+    /* beWriteVBRHeader() may still need the previous stream's state
+       after beCloseStream(), so release it only here */
+    if (gf.internal_flags)
+        lame_close(&gf);
     lame_init(&gf);
 
 }
@@ -352,7 +356,7 @@ __declspec(dllexport) BE_ERR beWriteVBRHeader(LPCSTR lpszFileName)
 		int nQuality=gf.VBR_q*100/9;
 
 		// Write Xing header again
-		return PutVbrTag((LPSTR)lpszFileName,nQuality,1-gf.version);
+		return PutVbrTag(&gf,(LPSTR)lpszFileName,nQuality,1-gf.version);
 	}
 	return BE_ERR_INVALID_FORMAT_PARAMETERS;
 }
@@ -35,16 +35,13 @@ int SizeOfEmptyFrame[2][2]=
 	{17,9},
 };
 
-static u_char pbtStreamBuffer[216];   
-static long g_Position[NUMTOCENTRIES];
-static int nZeroStreamSize=0;
-static int TotalFrameSize=0;
 static char	VBRTag[]={"Xing"};
 
+/* nZeroStreamSize, TotalFrameSize and the frame position list
+   (pVbrFrames) are kept per stream in gfp->internal_flags */
 
-int* pVbrFrames=NULL;
-int nVbrNumFrames=0;
-int nVbrFrameBufferSize=0;
+/* largest Xing frame, 64kbs at 32kHz (see InitVbrTag) */
+#define MAXVBRFRAMESIZE 288
 
 /****************************************************************************
  * AddVbrFrame: Add VBR entry, used to fill the VBR the TOC entries
@@ -53,30 +50,32 @@ int nVbrFrameBufferSize=0;
  *				(in Bytes NOT Bits)
  ****************************************************************************
 */
-void AddVbrFrame(int nStreamPos)
+void AddVbrFrame(lame_global_flags *gfp,int nStreamPos)
 {
+	lame_internal_flags *gfc=gfp->internal_flags;
+
         /* Simple exponential growing buffer */
-	if (pVbrFrames==NULL || nVbrFrameBufferSize==0)
+	if (gfc->pVbrFrames==NULL || gfc->nVbrFrameBufferSize==0)
 	{
                 /* Start with 100 frames */
-		nVbrFrameBufferSize=100;
+		gfc->nVbrFrameBufferSize=100;
 
 		/* Allocate them */
-		pVbrFrames=(int*)malloc((size_t)(nVbrFrameBufferSize*sizeof(int)));
+		gfc->pVbrFrames=(int*)malloc((size_t)(gfc->nVbrFrameBufferSize*sizeof(int)));
 	}
 
 	/* Is buffer big enough to store this new frame */
-	if (nVbrNumFrames==nVbrFrameBufferSize)
+	if (gfc->nVbrNumFrames==gfc->nVbrFrameBufferSize)
 	{
                 /* Guess not, double th e buffer size */
-		nVbrFrameBufferSize*=2;
+		gfc->nVbrFrameBufferSize*=2;
 
 		/* Allocate new buffer */
-		pVbrFrames=(int*)realloc(pVbrFrames,(size_t)(nVbrFrameBufferSize*sizeof(int)));
+		gfc->pVbrFrames=(int*)realloc(gfc->pVbrFrames,(size_t)(gfc->nVbrFrameBufferSize*sizeof(int)));
 	}
 
 	/* Store values */
-	pVbrFrames[nVbrNumFrames++]=nStreamPos;
+	gfc->pVbrFrames[gfc->nVbrNumFrames++]=nStreamPos;
 }
 
 
@@ -240,37 +239,26 @@ int GetVbrTag(VBRTAGDATA *pTagData,  unsigned char *buf)
  *				nMode	: Channel Mode: 0=STEREO 1=JS 2=DS 3=MONO
  ****************************************************************************
 */
-int InitVbrTag(Bit_stream_struc* pBs,int nVersion, int nMode, int SampIndex)
+int InitVbrTag(lame_global_flags *gfp,Bit_stream_struc* pBs,int nVersion, int nMode, int SampIndex)
 {
+	lame_internal_flags *gfc=gfp->internal_flags;
 	int i;
 
 	/* Clear Frame position array variables */
-	pVbrFrames=NULL;
-	nVbrNumFrames=0;
-	nVbrFrameBufferSize=0;
-
-	/* Clear struct */
-	memset(g_Position,0x00,sizeof(g_Position));
-
-	/* Clear stream buffer */
-	memset(pbtStreamBuffer,0x00,sizeof(pbtStreamBuffer));
-
-	/* Set TOC values to 255 */
-	for (i=0;i<NUMTOCENTRIES;i++)
-	{
-		g_Position[i]=-1;
-	}
-
+	free(gfc->pVbrFrames);
+	gfc->pVbrFrames=NULL;
+	gfc->nVbrNumFrames=0;
+	gfc->nVbrFrameBufferSize=0;
 
 
 	/* Reserve the proper amount of bytes */
 	if (nMode==3)
 	{
-		nZeroStreamSize=SizeOfEmptyFrame[nVersion][1]+4;
+		gfc->nZeroStreamSize=SizeOfEmptyFrame[nVersion][1]+4;
 	}
 	else
 	{
-		nZeroStreamSize=SizeOfEmptyFrame[nVersion][0]+4;
+		gfc->nZeroStreamSize=SizeOfEmptyFrame[nVersion][0]+4;
 	}
 
 	/*
@@ -296,11 +284,11 @@ int InitVbrTag(Bit_stream_struc* pBs,int nVersion, int nMode, int SampIndex)
 	  fprintf(stderr,"illegal sampling frequency index\n");
 	  exit(-1);
 	}
-	TotalFrameSize= framesize[SampIndex];
-	tot = (nZeroStreamSize+VBRHEADERSIZE);
+	gfc->TotalFrameSize= framesize[SampIndex];
+	tot = (gfc->nZeroStreamSize+VBRHEADERSIZE);
 	tot += 20;  /* extra 20 bytes for LAME & version string */
 	
-	if (TotalFrameSize < tot ) {
+	if (gfc->TotalFrameSize < tot ) {
 	  fprintf(stderr,"Xing VBR header problem...use -t\n");
 	  exit(-1);
 	}
@@ -308,7 +296,7 @@ int InitVbrTag(Bit_stream_struc* pBs,int nVersion, int nMode, int SampIndex)
 
 
 	/* Put empty bytes into the bitstream */
-	for (i=0;i<TotalFrameSize;i++)
+	for (i=0;i<gfc->TotalFrameSize;i++)
 	{
                 /* Write a byte to the bitstream */
 		putbits(pBs,0,8);
@@ -328,8 +316,10 @@ int InitVbrTag(Bit_stream_struc* pBs,int nVersion, int nMode, int SampIndex)
  *				nVbrScale	: encoder quality indicator (0..100)
  ****************************************************************************
 */
-int PutVbrTag(char* lpszFileName,int nVbrScale,int nVersion)
+int PutVbrTag(lame_global_flags *gfp,char* lpszFileName,int nVbrScale,int nVersion)
 {
+	lame_internal_flags *gfc=gfp->internal_flags;
+	u_char		pbtStreamBuffer[MAXVBRFRAMESIZE];
 	int			i;
 	long lFileSize;
 	int nStreamIndex;
@@ -339,7 +329,7 @@ int PutVbrTag(char* lpszFileName,int nVbrScale,int nVersion)
 	char str1[80];
 
 
-	if (nVbrNumFrames==0 || pVbrFrames==NULL)
+	if (gfc->nVbrNumFrames==0 || gfc->pVbrFrames==NULL)
 		return -1;
 
 	/* Open the bitstream again */
@@ -363,7 +353,7 @@ int PutVbrTag(char* lpszFileName,int nVbrScale,int nVersion)
 		return -1;
 
 	/* Seek to first real frame */
-	fseek(fpStream,(long)TotalFrameSize,SEEK_SET);
+	fseek(fpStream,(long)gfc->TotalFrameSize,SEEK_SET);
 
 	/* Read the header (first valid frame) */
 	fread(pbtStreamBuffer,4,1,fpStream);
@@ -392,10 +382,10 @@ int PutVbrTag(char* lpszFileName,int nVbrScale,int nVersion)
         for (i=1;i<NUMTOCENTRIES;i++) /* Don't touch zero point... */
         {
                 /* Calculate frame from given percentage */
-                int frameNum=(int)(floor(0.01*i*nVbrNumFrames));
+                int frameNum=(int)(floor(0.01*i*gfc->nVbrNumFrames));
 
                 /*  Calculate relative file postion, normalized to 0..256!(?) */
-                float fRelStreamPos=(float)256.0*(float)pVbrFrames[frameNum]/(float)lFileSize;
+                float fRelStreamPos=(float)256.0*(float)gfc->pVbrFrames[frameNum]/(float)lFileSize;
 
                 /* Just to be safe */
                 if (fRelStreamPos>255) fRelStreamPos=255;
@@ -407,7 +397,7 @@ int PutVbrTag(char* lpszFileName,int nVbrScale,int nVersion)
 
 
 	/* Start writing the tag after the zero frame */
-	nStreamIndex=nZeroStreamSize;
+	nStreamIndex=gfc->nZeroStreamSize;
 
 	/* Put Vbr tag */
 	pbtStreamBuffer[nStreamIndex++]=VBRTag[0];
@@ -420,7 +410,7 @@ int PutVbrTag(char* lpszFileName,int nVbrScale,int nVersion)
 	nStreamIndex+=4;
 
 	/* Put Total Number of frames */
-	CreateI4(&pbtStreamBuffer[nStreamIndex],nVbrNumFrames);
+	CreateI4(&pbtStreamBuffer[nStreamIndex],gfc->nVbrNumFrames);
 	nStreamIndex+=4;
 
 	/* Put Total file size */
@@ -449,15 +439,15 @@ int PutVbrTag(char* lpszFileName,int nVbrScale,int nVersion)
 #endif
 
         /* Put it all to disk again */
-	if (fwrite(pbtStreamBuffer,TotalFrameSize,1,fpStream)!=1)
+	if (fwrite(pbtStreamBuffer,gfc->TotalFrameSize,1,fpStream)!=1)
 	{
 		return -1;
 	}
 	fclose(fpStream);
 
 	/* Save to delete the frame buffer */
-	free(pVbrFrames);
-	pVbrFrames=NULL;
+	free(gfc->pVbrFrames);
+	gfc->pVbrFrames=NULL;
 
 	return 0;       /* success */
 }
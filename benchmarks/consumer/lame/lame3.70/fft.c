@@ -35,16 +35,33 @@
 #include "util.h"
 #include "psymodel.h"
 #include "lame.h"
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
 
 #define TRI_SIZE (5-1) /* 1024 =  4**5 */
 static FLOAT costab[TRI_SIZE*2];
 static FLOAT window[BLKSIZE / 2], window_s[BLKSIZE_s / 2];
 
+#if defined(__SSE2__)
+/* twiddle factors of the i=1..kx-1 butterflies of every fht() pass
+ * (kx = 2,8,32,128), made with the same recurrence the scalar fht()
+ * runs, so the vector version gives bit-identical results */
+#define TW_SIZE (1+7+31+127)
+static FLOAT tw_c1[TW_SIZE], tw_s1[TW_SIZE], tw_c2[TW_SIZE], tw_s2[TW_SIZE];
+
+/* lanes 3,2,1,0: gi[] runs backwards while fi[] runs forwards */
+#define REV(v) _mm_shuffle_ps(v, v, _MM_SHUFFLE(0,1,2,3))
+#endif
+
 static INLINE void fht(FLOAT *fz, short n)
 {
     short k4;
     FLOAT *fi, *fn, *gi;
     FLOAT *tri;
+#if defined(__SSE2__)
+    int tw = 0;
+#endif
 
     fn = fz + n;
     tri = &costab[0];
@@ -80,6 +97,57 @@ static INLINE void fht(FLOAT *fz, short n)
 	    gi     += k4;
 	    fi     += k4;
 	} while (fi<fn);
+#if defined(__SSE2__)
+	/* four neighbouring i at a time */
+	for (i = 1; i + 3 < kx; i += 4) {
+	    __m128 c1 = _mm_loadu_ps(&tw_c1[tw + i - 1]);
+	    __m128 s1 = _mm_loadu_ps(&tw_s1[tw + i - 1]);
+	    __m128 c2 = _mm_loadu_ps(&tw_c2[tw + i - 1]);
+	    __m128 s2 = _mm_loadu_ps(&tw_s2[tw + i - 1]);
+	    fi = fz + i;
+	    gi = fz + k1 - i - 3;
+	    do {
+		__m128 a,b,g0,f0,f1,g1,f2,g2,f3,g3;
+		__m128 fi0 = _mm_loadu_ps(fi),      gi0 = REV(_mm_loadu_ps(gi));
+		__m128 fi1 = _mm_loadu_ps(fi + k1), gi1 = REV(_mm_loadu_ps(gi + k1));
+		__m128 fi2 = _mm_loadu_ps(fi + k2), gi2 = REV(_mm_loadu_ps(gi + k2));
+		__m128 fi3 = _mm_loadu_ps(fi + k3), gi3 = REV(_mm_loadu_ps(gi + k3));
+		b  = _mm_sub_ps(_mm_mul_ps(s2, fi1), _mm_mul_ps(c2, gi1));
+		a  = _mm_add_ps(_mm_mul_ps(c2, fi1), _mm_mul_ps(s2, gi1));
+		f1 = _mm_sub_ps(fi0, a);
+		f0 = _mm_add_ps(fi0, a);
+		g1 = _mm_sub_ps(gi0, b);
+		g0 = _mm_add_ps(gi0, b);
+		b  = _mm_sub_ps(_mm_mul_ps(s2, fi3), _mm_mul_ps(c2, gi3));
+		a  = _mm_add_ps(_mm_mul_ps(c2, fi3), _mm_mul_ps(s2, gi3));
+		f3 = _mm_sub_ps(fi2, a);
+		f2 = _mm_add_ps(fi2, a);
+		g3 = _mm_sub_ps(gi2, b);
+		g2 = _mm_add_ps(gi2, b);
+		b  = _mm_sub_ps(_mm_mul_ps(s1, f2), _mm_mul_ps(c1, g3));
+		a  = _mm_add_ps(_mm_mul_ps(c1, f2), _mm_mul_ps(s1, g3));
+		_mm_storeu_ps(fi + k2, _mm_sub_ps(f0, a));
+		_mm_storeu_ps(fi,      _mm_add_ps(f0, a));
+		_mm_storeu_ps(gi + k3, REV(_mm_sub_ps(g1, b)));
+		_mm_storeu_ps(gi + k1, REV(_mm_add_ps(g1, b)));
+		b  = _mm_sub_ps(_mm_mul_ps(c1, g2), _mm_mul_ps(s1, f3));
+		a  = _mm_add_ps(_mm_mul_ps(s1, g2), _mm_mul_ps(c1, f3));
+		_mm_storeu_ps(gi + k2, REV(_mm_sub_ps(g0, a)));
+		_mm_storeu_ps(gi,      REV(_mm_add_ps(g0, a)));
+		_mm_storeu_ps(fi + k3, _mm_sub_ps(f1, b));
+		_mm_storeu_ps(fi + k1, _mm_add_ps(f1, b));
+		gi     += k4;
+		fi     += k4;
+	    } while (fi<fn);
+	}
+	for (; i < kx; i++) {
+	    FLOAT c2,s2;
+	    c1 = tw_c1[tw + i - 1];
+	    s1 = tw_s1[tw + i - 1];
+	    c2 = tw_c2[tw + i - 1];
+	    s2 = tw_s2[tw + i - 1];
+	    fi = fz + i;
+#else
 	c1 = tri[0];
 	s1 = tri[1];
 	for (i = 1; i < kx; i++) {
@@ -87,6 +155,7 @@ static INLINE void fht(FLOAT *fz, short n)
 	    c2 = 1 - (2*s1)*s1;
 	    s2 = (2*s1)*c1;
 	    fi = fz + i;
+#endif
 	    gi = fz + k1 - i;
 	    do {
 		FLOAT a,b,g0,f0,f1,g1,f2,g2,f3,g3;
@@ -117,11 +186,16 @@ static INLINE void fht(FLOAT *fz, short n)
 		gi     += k4;
 		fi     += k4;
 	    } while (fi<fn);
+#if !defined(__SSE2__)
 	    c2 = c1;
 	    c1 = c2 * tri[0] - s1 * tri[1];
 	    s1 = c2 * tri[1] + s1 * tri[0];
+#endif
         }
 	tri += 2;
+#if defined(__SSE2__)
+	tw += kx - 1;
+#endif
     } while (k4<n);
 }
 
@@ -346,6 +420,26 @@ void init_fft(void)
 	r *= 0.25;
     }
 
+#if defined(__SSE2__)
+    {
+	int kx, tw = 0;
+	for (i = 0, kx = 2; i < TRI_SIZE; i++, kx *= 4) {
+	    FLOAT *tri = &costab[i*2];
+	    FLOAT c1 = tri[0], s1 = tri[1], c2;
+	    int j;
+	    for (j = 1; j < kx; j++, tw++) {
+		tw_c1[tw] = c1;
+		tw_s1[tw] = s1;
+		tw_c2[tw] = 1 - (2*s1)*s1;
+		tw_s2[tw] = (2*s1)*c1;
+		c2 = c1;
+		c1 = c2 * tri[0] - s1 * tri[1];
+		s1 = c2 * tri[1] + s1 * tri[0];
+	    }
+	}
+    }
+#endif
+
     /*
      * calculate HANN window coefficients 
      */
@@ -12,29 +12,29 @@
   1995/09/20  mc@fivebats.com           bugfix: store_side_info
 */
 
+#include "util.h"
 #include "formatBitstream.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
 
-/* globals */
-static int BitCount       = 0;
-static int ThisFrameSize  = 0;
-static int BitsRemaining  = 0;
+/* BitCount, ThisFrameSize, BitsRemaining and the side info queues
+   are kept per stream in gfp->internal_flags */
 
-void InitFormatBitStream(void)
+void InitFormatBitStream(lame_global_flags *gfp)
 {
-	BitCount		= 0;
-	ThisFrameSize	= 0;
-	BitsRemaining	= 0;
+	lame_internal_flags *gfc=gfp->internal_flags;
+	gfc->BitCount		= 0;
+	gfc->ThisFrameSize	= 0;
+	gfc->BitsRemaining	= 0;
 }
 
 /* forward declarations */
-static int store_side_info( BF_FrameData *frameInfo );
-static int main_data( BF_FrameData *frameInfo, BF_FrameResults *results );
-static int side_queue_elements( int *forwardFrameLength, int *forwardSILength );
-static void free_side_queues(void);
-static void WriteMainDataBits( u_int val,u_int nbits,BF_FrameResults *results );
+static int store_side_info( lame_global_flags *gfp,BF_FrameData *frameInfo );
+static int main_data( lame_global_flags *gfp,BF_FrameData *frameInfo, BF_FrameResults *results );
+static int side_queue_elements( lame_global_flags *gfp,int *forwardFrameLength, int *forwardSILength );
+static void free_side_queues(lame_global_flags *gfp);
+static void WriteMainDataBits( lame_global_flags *gfp,u_int val,u_int nbits,BF_FrameResults *results );
 
 /*
   BitStreamFrame is the public interface to the bitstream
@@ -50,20 +50,19 @@ static void WriteMainDataBits( u_int val,u_int nbits,BF_FrameResults *results );
   See formatBitstream.h for more information about the data
   structures and the bitstream syntax.
 */
-static int elements, forwardFrameLength, forwardSILength; 
 void
-BF_BitstreamFrame( BF_FrameData *frameInfo, BF_FrameResults *results )
+BF_BitstreamFrame( lame_global_flags *gfp,BF_FrameData *frameInfo, BF_FrameResults *results )
 {
-  /*    int elements, forwardFrameLength, forwardSILength; */
+    lame_internal_flags *gfc=gfp->internal_flags;
 
     assert( frameInfo->nGranules <= MAX_GRANULES );
     assert( frameInfo->nChannels <= MAX_CHANNELS );
 
     /* save SI and compute its length */
-    results->SILength = store_side_info( frameInfo );
+    results->SILength = store_side_info( gfp,frameInfo );
 
     /* write the main data, inserting SI to maintain framing */
-    results->mainDataLength = main_data( frameInfo, results );
+    results->mainDataLength = main_data( gfp,frameInfo, results );
 
     /*
       Caller must ensure that back SI and main data are
@@ -71,11 +70,11 @@ BF_BitstreamFrame( BF_FrameData *frameInfo, BF_FrameResults *results )
       can only point to a byte boundary and this code
       does not add stuffing bits
     */
-    assert( (BitsRemaining % 8) == 0 );
+    assert( (gfc->BitsRemaining % 8) == 0 );
 
     /* calculate nextBackPointer */
-    elements = side_queue_elements( &forwardFrameLength, &forwardSILength );
-    results->nextBackPtr = (BitsRemaining / 8) + (forwardFrameLength / 8) - (forwardSILength / 8);
+    gfc->elements = side_queue_elements( gfp,&gfc->forwardFrameLength, &gfc->forwardSILength );
+    results->nextBackPtr = (gfc->BitsRemaining / 8) + (gfc->forwardFrameLength / 8) - (gfc->forwardSILength / 8);
 }
 
 /*
@@ -84,35 +83,45 @@ BF_BitstreamFrame( BF_FrameData *frameInfo, BF_FrameResults *results )
   queue data buffers are also freed.
 */
 void
-BF_FlushBitstream( BF_FrameData *frameInfo, BF_FrameResults *results )
+BF_FlushBitstream( lame_global_flags *gfp,BF_FrameData *frameInfo, BF_FrameResults *results )
 {
-  /*    int elements, forwardFrameLength, forwardSILength; */
+    lame_internal_flags *gfc=gfp->internal_flags;
 
-    if ( elements )
+    if ( gfc->elements )
     {
-      int bitsRemaining = forwardFrameLength - forwardSILength;
+      int bitsRemaining = gfc->forwardFrameLength - gfc->forwardSILength;
       int wordsRemaining = bitsRemaining / 32;
       while ( wordsRemaining-- ) {
-	WriteMainDataBits( 0, 32, results );
+	WriteMainDataBits( gfp, 0, 32, results );
       }
-      WriteMainDataBits( 0, (bitsRemaining % 32), results );	
+      WriteMainDataBits( gfp, 0, (bitsRemaining % 32), results );	
     }
     
 
-    results->mainDataLength = forwardFrameLength - forwardSILength;
-    results->SILength       = forwardSILength;
+    results->mainDataLength = gfc->forwardFrameLength - gfc->forwardSILength;
+    results->SILength       = gfc->forwardSILength;
     results->nextBackPtr    = 0;
 
     /* reclaim queue space */
-    free_side_queues();
+    free_side_queues(gfp);
 
     /* reinitialize globals */
-    BitCount       = 0;
-    ThisFrameSize  = 0;
-    BitsRemaining  = 0;    
+    gfc->BitCount       = 0;
+    gfc->ThisFrameSize  = 0;
+    gfc->BitsRemaining  = 0;    
     return;
 }
 
+/*
+  Release the side info queues of a stream that was
+  not flushed (lame_close() after an aborted encode).
+*/
+void
+BF_FreeFormatBitStream( lame_global_flags *gfp )
+{
+    free_side_queues(gfp);
+}
+
 int
 BF_PartLength( BF_BitstreamPart *part )
 {
@@ -142,13 +151,13 @@ typedef struct
     BF_PartHolder *spectrumSIPH[MAX_GRANULES][MAX_CHANNELS];
 } MYSideInfo;
 
-static MYSideInfo *get_side_info(void);
-static int write_side_info(void);
-typedef int (*PartWriteFcnPtr)( BF_BitstreamPart *part, BF_FrameResults *results );
+static MYSideInfo *get_side_info(lame_global_flags *gfp);
+static int write_side_info(lame_global_flags *gfp);
+typedef int (*PartWriteFcnPtr)( lame_global_flags *gfp,BF_BitstreamPart *part, BF_FrameResults *results );
 
 
 static int
-writePartMainData( BF_BitstreamPart *part, BF_FrameResults *results )
+writePartMainData( lame_global_flags *gfp,BF_BitstreamPart *part, BF_FrameResults *results )
 {
     BF_BitstreamElement *ep;
     u_int	i;
@@ -160,14 +169,14 @@ writePartMainData( BF_BitstreamPart *part, BF_FrameResults *results )
     ep = part->element;
     for ( i = 0; i < part->nrEntries; i++, ep++ )
     {
-		WriteMainDataBits( ep->value, ep->length, results );
+		WriteMainDataBits( gfp, ep->value, ep->length, results );
 		bits += ep->length;
     }
     return bits;
 }
 
 static int
-writePartSideInfo( BF_BitstreamPart *part, BF_FrameResults *results )
+writePartSideInfo( lame_global_flags *gfp,BF_BitstreamPart *part, BF_FrameResults *results )
 {
     BF_BitstreamElement *ep;
     u_int	i;
@@ -178,14 +187,14 @@ writePartSideInfo( BF_BitstreamPart *part, BF_FrameResults *results )
     ep = part->element;
     for ( i = 0; i < part->nrEntries; i++, ep++ )
     {
-		putMyBits( ep->value, ep->length );
+		putMyBits( gfp, ep->value, ep->length );
 		bits += ep->length;
     }
     return bits;
 }
 
 static int
-main_data( BF_FrameData *fi, BF_FrameResults *results )
+main_data( lame_global_flags *gfp,BF_FrameData *fi, BF_FrameResults *results )
 {
     int gr, ch, bits;
     PartWriteFcnPtr wp = writePartMainData;
@@ -195,11 +204,11 @@ main_data( BF_FrameData *fi, BF_FrameResults *results )
     for ( gr = 0; gr < fi->nGranules; gr++ )
 	for ( ch = 0; ch < fi->nChannels; ch++ )
 	{
-	    bits += (*wp)( fi->scaleFactors[gr][ch], results );
-	    bits += (*wp)( fi->codedData[gr][ch],    results );
-	    bits += (*wp)( fi->userSpectrum[gr][ch], results );
+	    bits += (*wp)( gfp,fi->scaleFactors[gr][ch], results );
+	    bits += (*wp)( gfp,fi->codedData[gr][ch],    results );
+	    bits += (*wp)( gfp,fi->userSpectrum[gr][ch], results );
 	}
-    bits += (*wp)( fi->userFrameData, results );
+    bits += (*wp)( gfp,fi->userFrameData, results );
     return bits;
 }
 
@@ -210,56 +219,59 @@ main_data( BF_FrameData *fi, BF_FrameResults *results )
 */
 
 static void
-WriteMainDataBits( u_int val,
+WriteMainDataBits( lame_global_flags *gfp,
+		   u_int val,
 		   u_int nbits,
 		   BF_FrameResults *results )
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
     assert( nbits <= 32 );
     if ( nbits == 0 )
 	return;
-    if ( BitCount == ThisFrameSize )
+    if ( gfc->BitCount == gfc->ThisFrameSize )
     {
-	BitCount = write_side_info();
-	BitsRemaining = ThisFrameSize - BitCount;
+	gfc->BitCount = write_side_info(gfp);
+	gfc->BitsRemaining = gfc->ThisFrameSize - gfc->BitCount;
     }
-    if ( nbits > (u_int)BitsRemaining )
+    if ( nbits > (u_int)gfc->BitsRemaining )
     {
-	unsigned extra = val >> (nbits - BitsRemaining);
-	nbits -= BitsRemaining;
-	putMyBits( extra, BitsRemaining );
-	BitCount = write_side_info();
-	BitsRemaining = ThisFrameSize - BitCount;
-	putMyBits( val, nbits );
+	unsigned extra = val >> (nbits - gfc->BitsRemaining);
+	nbits -= gfc->BitsRemaining;
+	putMyBits( gfp, extra, gfc->BitsRemaining );
+	gfc->BitCount = write_side_info(gfp);
+	gfc->BitsRemaining = gfc->ThisFrameSize - gfc->BitCount;
+	putMyBits( gfp, val, nbits );
     }
     else
-	putMyBits( val, nbits );
-    BitCount += nbits;
-    BitsRemaining -= nbits;
-    assert( BitCount <= ThisFrameSize );
-    assert( BitsRemaining >= 0 );
-    assert( (BitCount + BitsRemaining) == ThisFrameSize );
+	putMyBits( gfp, val, nbits );
+    gfc->BitCount += nbits;
+    gfc->BitsRemaining -= nbits;
+    assert( gfc->BitCount <= gfc->ThisFrameSize );
+    assert( gfc->BitsRemaining >= 0 );
+    assert( (gfc->BitCount + gfc->BitsRemaining) == gfc->ThisFrameSize );
 }
 
 
 static int
-write_side_info(void)
+write_side_info(lame_global_flags *gfp)
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
     MYSideInfo *si;
     int bits, ch, gr;
     PartWriteFcnPtr wp = writePartSideInfo;
 
     bits = 0;
-    si = get_side_info();
-    ThisFrameSize = si->frameLength;
-    bits += (*wp)( si->headerPH->part,  NULL );
-    bits += (*wp)( si->frameSIPH->part, NULL );
+    si = get_side_info(gfp);
+    gfc->ThisFrameSize = si->frameLength;
+    bits += (*wp)( gfp,si->headerPH->part,  NULL );
+    bits += (*wp)( gfp,si->frameSIPH->part, NULL );
 
     for ( ch = 0; ch < si->nChannels; ch++ )
-	bits += (*wp)( si->channelSIPH[ch]->part, NULL );
+	bits += (*wp)( gfp,si->channelSIPH[ch]->part, NULL );
 
     for ( gr = 0; gr < si->nGranules; gr++ )
 	for ( ch = 0; ch < si->nChannels; ch++ )
-	    bits += (*wp)( si->spectrumSIPH[gr][ch]->part, NULL );
+	    bits += (*wp)( gfp,si->spectrumSIPH[gr][ch]->part, NULL );
     return bits;
 }
 
@@ -269,21 +281,19 @@ typedef struct side_info_link
     MYSideInfo           side_info;
 } side_info_link;
 
-static struct side_info_link *side_queue_head   = NULL;
-static struct side_info_link *side_queue_free   = NULL;
-
 static void free_side_info_link( side_info_link *l );
 
 static int
-side_queue_elements( int *frameLength, int *SILength )
+side_queue_elements( lame_global_flags *gfp,int *frameLength, int *SILength )
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
     int elements = 0;
     side_info_link *l;
 
     *frameLength = 0;
     *SILength    = 0;
 
-    for ( l = side_queue_head; l; l = l->next )
+    for ( l = gfc->side_queue_head; l; l = l->next )
     {
 	elements++;
 	*frameLength += l->side_info.frameLength;
@@ -293,12 +303,13 @@ side_queue_elements( int *frameLength, int *SILength )
 }
 
 static int
-store_side_info( BF_FrameData *info )
+store_side_info( lame_global_flags *gfp,BF_FrameData *info )
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
     int ch, gr;
     side_info_link *l;
     /* obtain a side_info_link to store info */
-    side_info_link *f = side_queue_free;
+    side_info_link *f = gfc->side_queue_free;
     int bits = 0;
 
     if ( f == NULL )
@@ -326,7 +337,7 @@ store_side_info( BF_FrameData *info )
     }
     else
     { /* remove from the free list */
-	side_queue_free = f->next;
+	gfc->side_queue_free = f->next;
 	f->next = NULL;
 	l = f;
     }
@@ -356,10 +367,10 @@ store_side_info( BF_FrameData *info )
 	}
     l->side_info.SILength = bits;
     /* place at end of queue */
-    f = side_queue_head;
+    f = gfc->side_queue_head;
     if ( f == NULL )
     {  /* empty queue */
-	side_queue_head = l;
+	gfc->side_queue_head = l;
     }
     else
     { /* find last element */
@@ -371,10 +382,11 @@ store_side_info( BF_FrameData *info )
 }
 
 static MYSideInfo*
-get_side_info(void)
+get_side_info(lame_global_flags *gfp)
 {
-    side_info_link *f = side_queue_free;
-    side_info_link *l = side_queue_head;
+    lame_internal_flags *gfc=gfp->internal_flags;
+    side_info_link *f = gfc->side_queue_free;
+    side_info_link *l = gfc->side_queue_head;
     
     /*
       If we stop here it means you didn't provide enough
@@ -384,7 +396,7 @@ get_side_info(void)
     assert( l );
     
     /* update queue head */
-    side_queue_head = l->next;
+    gfc->side_queue_head = l->next;
 
     /*
       Append l to the free list. You can continue
@@ -392,29 +404,30 @@ get_side_info(void)
       again, which will not happen again for this
       frame.
     */
-    side_queue_free = l;
+    gfc->side_queue_free = l;
     l->next = f;
     return &l->side_info;
 }
 
 static void
-free_side_queues(void)
+free_side_queues(lame_global_flags *gfp)
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
     side_info_link *l, *next;
     
-    for ( l = side_queue_head; l; l = next )
+    for ( l = gfc->side_queue_head; l; l = next )
     {
 	next = l->next;
 	free_side_info_link( l );
     }
-    side_queue_head = NULL;
+    gfc->side_queue_head = NULL;
 
-    for ( l = side_queue_free; l; l = next )
+    for ( l = gfc->side_queue_free; l; l = next )
     {
 	next = l->next;
 	free_side_info_link( l );
     }
-    side_queue_free = NULL;
+    gfc->side_queue_free = NULL;
 }
 
 static void
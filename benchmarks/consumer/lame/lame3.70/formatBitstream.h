@@ -15,6 +15,7 @@
 */
 
 #include "machine.h"
+#include "lame.h"
 
 #ifndef MAX_CHANNELS
 #define MAX_CHANNELS 2
@@ -30,7 +31,7 @@
   'length' bits from 'value,' msb first. Bits in value are
   assumed to be right-justified.
 */
-void putMyBits( u_int value, u_int length );
+void putMyBits( lame_global_flags *gfp, u_int value, u_int length );
 
 /*
   A BitstreamElement contains encoded data
@@ -102,16 +103,19 @@ typedef struct BF_FrameResults
 
 
 /* Initialize the bitstream */
-void InitFormatBitStream(void);
+void InitFormatBitStream(lame_global_flags *gfp);
 
 /* count the bits in a BitstreamPart */
 int  BF_PartLength( BF_BitstreamPart *part );
 
 /* encode a frame of audio and write it to your bitstream */
-void BF_BitstreamFrame( BF_FrameData *frameInfo, BF_FrameResults *results );
+void BF_BitstreamFrame( lame_global_flags *gfp, BF_FrameData *frameInfo, BF_FrameResults *results );
 
 /* write any remaining frames to the bitstream, padding with zeros */
-void BF_FlushBitstream( BF_FrameData *frameInfo, BF_FrameResults *results );
+void BF_FlushBitstream( lame_global_flags *gfp, BF_FrameData *frameInfo, BF_FrameResults *results );
+
+/* free the queued side info of a stream that was not flushed */
+void BF_FreeFormatBitStream( lame_global_flags *gfp );
 
 
 
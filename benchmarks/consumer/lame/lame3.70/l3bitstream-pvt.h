@@ -34,9 +34,9 @@ static void encodeMainData( lame_global_flags *gfp,
 			    III_side_info_t  *si,
 			    III_scalefac_t   scalefac[2][2] );
 
-static void drain_into_ancillary_data( int lengthInBits );
+static void drain_into_ancillary_data( lame_global_flags *gfp, int lengthInBits );
 
-static void Huffmancodebits( BF_PartHolder **pph, int *ix, gr_info *gi );
+static void Huffmancodebits( lame_global_flags *gfp, BF_PartHolder **pph, int *ix, gr_info *gi );
 
 
 #endif
@@ -23,26 +23,12 @@
 #include <assert.h>
 #include "l3bitstream-pvt.h"
 
-static Bit_stream_struc *bs = NULL;
+/* frameData, frameResults and the part holders live in gfp->internal_flags */
 
-BF_FrameData    *frameData    = NULL;
-BF_FrameResults *frameResults = NULL;
-
-int PartHoldersInitialized = 0;
-
-BF_PartHolder *headerPH;
-BF_PartHolder *frameSIPH;
-BF_PartHolder *channelSIPH[ MAX_CHANNELS ];
-BF_PartHolder *spectrumSIPH[ MAX_GRANULES ][ MAX_CHANNELS ];
-BF_PartHolder *scaleFactorsPH[ MAX_GRANULES ][ MAX_CHANNELS ];
-BF_PartHolder *codedDataPH[ MAX_GRANULES ][ MAX_CHANNELS ];
-BF_PartHolder *userSpectrumPH[ MAX_GRANULES ][ MAX_CHANNELS ];
-BF_PartHolder *userFrameDataPH;
-
-
-void putMyBits( u_int val, u_int len )
+void putMyBits( lame_global_flags *gfp, u_int val, u_int len )
 {
-    putbits( bs, val, len );
+    lame_internal_flags *gfc=gfp->internal_flags;
+    putbits( &gfc->bs, val, len );
 }
 
 /*
@@ -61,41 +47,40 @@ III_format_bitstream( lame_global_flags *gfp,
                       int              bitsPerFrame,
 		      int              l3_enc[2][2][576],
 		      III_side_info_t  *l3_side,
-		      III_scalefac_t   scalefac[2][2],
-		      Bit_stream_struc *in_bs)
+		      III_scalefac_t   scalefac[2][2])
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
     int gr, ch;
-    bs = in_bs;
 
-    if ( frameData == NULL )
+    if ( gfc->frameData == NULL )
     {
-	frameData = calloc( 1,sizeof *frameData);
-	assert( frameData );
+	gfc->frameData = calloc( 1,sizeof *gfc->frameData);
+	assert( gfc->frameData );
     }
-    if ( frameResults == NULL )
+    if ( gfc->frameResults == NULL )
     {
-	frameResults = calloc( 1,sizeof *frameResults);
-	assert( frameResults );
+	gfc->frameResults = calloc( 1,sizeof *gfc->frameResults);
+	assert( gfc->frameResults );
     }
 
-    if ( !PartHoldersInitialized )
+    if ( !gfc->PartHoldersInitialized )
     {
-	headerPH = BF_newPartHolder( 14 ); 
-	frameSIPH = BF_newPartHolder( 12 );
+	gfc->headerPH = BF_newPartHolder( 14 ); 
+	gfc->frameSIPH = BF_newPartHolder( 12 );
 
 	for ( ch = 0; ch < MAX_CHANNELS; ch++ )
-	    channelSIPH[ch] = BF_newPartHolder( 8 );
+	    gfc->channelSIPH[ch] = BF_newPartHolder( 8 );
 
 	for ( gr = 0; gr < MAX_GRANULES; gr++ )	
 	    for ( ch = 0; ch < MAX_CHANNELS; ch++ )
 	    {
-		spectrumSIPH[gr][ch]   = BF_newPartHolder( 32 );
-		scaleFactorsPH[gr][ch] = BF_newPartHolder( 64 );
-		codedDataPH[gr][ch]    = BF_newPartHolder( 576 );
-		userSpectrumPH[gr][ch] = BF_newPartHolder( 4 );
+		gfc->spectrumSIPH[gr][ch]   = BF_newPartHolder( 32 );
+		gfc->scaleFactorsPH[gr][ch] = BF_newPartHolder( 64 );
+		gfc->codedDataPH[gr][ch]    = BF_newPartHolder( 576 );
+		gfc->userSpectrumPH[gr][ch] = BF_newPartHolder( 4 );
 	    }
-	userFrameDataPH = BF_newPartHolder( 8 );
-	PartHoldersInitialized = 1;
+	gfc->userFrameDataPH = BF_newPartHolder( 8 );
+	gfc->PartHoldersInitialized = 1;
     }
 
     encodeSideInfo( gfp,l3_side );
@@ -103,42 +88,73 @@ III_format_bitstream( lame_global_flags *gfp,
 
 
 
-    drain_into_ancillary_data( l3_side->resvDrain );
+    drain_into_ancillary_data( gfp,l3_side->resvDrain );
     /*
       Put frameData together for the call
       to BitstreamFrame()
     */
-    frameData->frameLength = bitsPerFrame;
-    frameData->nGranules   = gfp->mode_gr;
-    frameData->nChannels   = gfp->stereo;
-    frameData->header      = headerPH->part;
-    frameData->frameSI     = frameSIPH->part;
+    gfc->frameData->frameLength = bitsPerFrame;
+    gfc->frameData->nGranules   = gfp->mode_gr;
+    gfc->frameData->nChannels   = gfp->stereo;
+    gfc->frameData->header      = gfc->headerPH->part;
+    gfc->frameData->frameSI     = gfc->frameSIPH->part;
 
     for ( ch = 0; ch < gfp->stereo; ch++ )
-	frameData->channelSI[ch] = channelSIPH[ch]->part;
+	gfc->frameData->channelSI[ch] = gfc->channelSIPH[ch]->part;
 
     for ( gr = 0; gr < gfp->mode_gr; gr++ )
 	for ( ch = 0; ch < gfp->stereo; ch++ )
 	{
-	    frameData->spectrumSI[gr][ch]   = spectrumSIPH[gr][ch]->part;
-	    frameData->scaleFactors[gr][ch] = scaleFactorsPH[gr][ch]->part;
-	    frameData->codedData[gr][ch]    = codedDataPH[gr][ch]->part;
-	    frameData->userSpectrum[gr][ch] = userSpectrumPH[gr][ch]->part;
+	    gfc->frameData->spectrumSI[gr][ch]   = gfc->spectrumSIPH[gr][ch]->part;
+	    gfc->frameData->scaleFactors[gr][ch] = gfc->scaleFactorsPH[gr][ch]->part;
+	    gfc->frameData->codedData[gr][ch]    = gfc->codedDataPH[gr][ch]->part;
+	    gfc->frameData->userSpectrum[gr][ch] = gfc->userSpectrumPH[gr][ch]->part;
 	}
-    frameData->userFrameData = userFrameDataPH->part;
+    gfc->frameData->userFrameData = gfc->userFrameDataPH->part;
 
-    BF_BitstreamFrame( frameData, frameResults );
+    BF_BitstreamFrame( gfp,gfc->frameData, gfc->frameResults );
 
     /* we set this here -- it will be tested in the next loops iteration */
-    l3_side->main_data_begin = frameResults->nextBackPtr;
+    l3_side->main_data_begin = gfc->frameResults->nextBackPtr;
 
 }
 
 void
-III_FlushBitstream(void)
+III_FlushBitstream(lame_global_flags *gfp)
 {
-    if (PartHoldersInitialized!=0)
-		BF_FlushBitstream( frameData, frameResults );
+    lame_internal_flags *gfc=gfp->internal_flags;
+    if (gfc->PartHoldersInitialized!=0)
+		BF_FlushBitstream( gfp,gfc->frameData, gfc->frameResults );
+}
+
+void
+III_FreeBitstream(lame_global_flags *gfp)
+{
+    lame_internal_flags *gfc=gfp->internal_flags;
+    int gr, ch;
+
+    if (gfc->PartHoldersInitialized)
+    {
+	BF_freePartHolder( gfc->headerPH );
+	BF_freePartHolder( gfc->frameSIPH );
+	for ( ch = 0; ch < MAX_CHANNELS; ch++ )
+	    BF_freePartHolder( gfc->channelSIPH[ch] );
+	for ( gr = 0; gr < MAX_GRANULES; gr++ )
+	    for ( ch = 0; ch < MAX_CHANNELS; ch++ )
+	    {
+		BF_freePartHolder( gfc->spectrumSIPH[gr][ch] );
+		BF_freePartHolder( gfc->scaleFactorsPH[gr][ch] );
+		BF_freePartHolder( gfc->codedDataPH[gr][ch] );
+		BF_freePartHolder( gfc->userSpectrumPH[gr][ch] );
+	    }
+	BF_freePartHolder( gfc->userFrameDataPH );
+	gfc->PartHoldersInitialized = 0;
+    }
+    free( gfc->frameData );
+    gfc->frameData = NULL;
+    free( gfc->frameResults );
+    gfc->frameResults = NULL;
+    BF_FreeFormatBitStream( gfp );
 }
 
 static unsigned slen1_tab[16] = { 0, 0, 0, 0, 3, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4 };
@@ -150,16 +166,17 @@ encodeMainData( lame_global_flags *gfp,
 		III_side_info_t  *si,
 		III_scalefac_t   scalefac[2][2] )
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
     int i, gr, ch, sfb, window;
 
 
     for ( gr = 0; gr < gfp->mode_gr; gr++ )
 	for ( ch = 0; ch < gfp->stereo; ch++ )
-	    scaleFactorsPH[gr][ch]->part->nrEntries = 0;
+	    gfc->scaleFactorsPH[gr][ch]->part->nrEntries = 0;
 
     for ( gr = 0; gr < gfp->mode_gr; gr++ )
 	for ( ch = 0; ch < gfp->stereo; ch++ )
-	    codedDataPH[gr][ch]->part->nrEntries = 0;
+	    gfc->codedDataPH[gr][ch]->part->nrEntries = 0;
 
     if ( gfp->version == 1 )
     {  /* MPEG 1 */
@@ -167,7 +184,7 @@ encodeMainData( lame_global_flags *gfp,
 	{
 	    for ( ch = 0; ch < gfp->stereo; ch++ )
 	    {
-		BF_PartHolder **pph = &scaleFactorsPH[gr][ch];		
+		BF_PartHolder **pph = &gfc->scaleFactorsPH[gr][ch];		
 		gr_info *gi = &(si->gr[gr].ch[ch].tt);
 		unsigned slen1 = slen1_tab[ gi->scalefac_compress ];
 		unsigned slen2 = slen2_tab[ gi->scalefac_compress ];
@@ -220,7 +237,7 @@ encodeMainData( lame_global_flags *gfp,
 			for ( sfb = 16; sfb < 21; sfb++ )
 			    *pph = BF_addEntry( *pph,  scalefac[gr][ch].l[sfb], slen2 );
 		}
-		Huffmancodebits( &codedDataPH[gr][ch], ix, gi );
+		Huffmancodebits( gfp,&gfc->codedDataPH[gr][ch], ix, gi );
 	    } /* for ch */
 	} /* for gr */
     }
@@ -229,7 +246,7 @@ encodeMainData( lame_global_flags *gfp,
 	gr = 0;
 	for ( ch = 0; ch < gfp->stereo; ch++ )
 	{
-	    BF_PartHolder **pph = &scaleFactorsPH[gr][ch];		
+	    BF_PartHolder **pph = &gfc->scaleFactorsPH[gr][ch];		
 	    gr_info *gi = &(si->gr[gr].ch[ch].tt);
 	    int *ix = &l3_enc[gr][ch][0];
 	    int sfb_partition;
@@ -279,24 +296,22 @@ encodeMainData( lame_global_flags *gfp,
 
 
 
-	    Huffmancodebits( &codedDataPH[gr][ch], ix, gi );
+	    Huffmancodebits( gfp,&gfc->codedDataPH[gr][ch], ix, gi );
 	} /* for ch */
     }
 } /* main_data */
 
-static unsigned int crc = 0; /* (jo) current crc */
-
 /* (jo) this wrapper function for BF_addEntry() updates also the crc */
-static BF_PartHolder *CRC_BF_addEntry( BF_PartHolder *thePH, u_int value, u_int length )
+static BF_PartHolder *CRC_BF_addEntry( unsigned int *crc, BF_PartHolder *thePH, u_int value, u_int length )
 {
    u_int bit = 1 << length;
    
    while((bit >>= 1)){
-      crc <<= 1;
-      if (!(crc & 0x10000) ^ !(value & bit))
-	crc ^= CRC16_POLYNOMIAL;
+      *crc <<= 1;
+      if (!(*crc & 0x10000) ^ !(value & bit))
+	*crc ^= CRC16_POLYNOMIAL;
    }
-   crc &= 0xffff;   
+   *crc &= 0xffff;   
    return BF_addEntry(thePH, value, length);
 }
 
@@ -305,89 +320,91 @@ static BF_PartHolder *CRC_BF_addEntry( BF_PartHolder *thePH, u_int value, u_int
 
 static int encodeSideInfo( lame_global_flags *gfp,III_side_info_t  *si )
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
+    unsigned int crc; /* (jo) current crc */
     int gr, ch, scfsi_band, region, window, bits_sent;
     
     crc = 0xffff; /* (jo) init crc16 for error_protection */
 
-    headerPH->part->nrEntries = 0;
-    headerPH = BF_addEntry( headerPH, 0xfff,                    12 );
-    headerPH = BF_addEntry( headerPH, gfp->version,            1 );
-    headerPH = BF_addEntry( headerPH, 1,                        2 );
-    headerPH = BF_addEntry( headerPH, !gfp->error_protection,     1 );
+    gfc->headerPH->part->nrEntries = 0;
+    gfc->headerPH = BF_addEntry( gfc->headerPH, 0xfff,                    12 );
+    gfc->headerPH = BF_addEntry( gfc->headerPH, gfp->version,            1 );
+    gfc->headerPH = BF_addEntry( gfc->headerPH, 1,                        2 );
+    gfc->headerPH = BF_addEntry( gfc->headerPH, !gfp->error_protection,     1 );
     /* (jo) from now on call the CRC_BF_addEntry() wrapper to update crc */
-    headerPH = CRC_BF_addEntry( headerPH, gfp->bitrate_index,      4 );
-    headerPH = CRC_BF_addEntry( headerPH, gfp->samplerate_index,   2 );
-    headerPH = CRC_BF_addEntry( headerPH, gfp->padding,            1 );
-    headerPH = CRC_BF_addEntry( headerPH, gfp->extension,          1 );
-    headerPH = CRC_BF_addEntry( headerPH, gfp->mode,               2 );
-    headerPH = CRC_BF_addEntry( headerPH, gfp->mode_ext,           2 );
-    headerPH = CRC_BF_addEntry( headerPH, gfp->copyright,          1 );
-    headerPH = CRC_BF_addEntry( headerPH, gfp->original,           1 );
-    headerPH = CRC_BF_addEntry( headerPH, gfp->emphasis,           2 );
+    gfc->headerPH = CRC_BF_addEntry( &crc, gfc->headerPH, gfp->bitrate_index,      4 );
+    gfc->headerPH = CRC_BF_addEntry( &crc, gfc->headerPH, gfp->samplerate_index,   2 );
+    gfc->headerPH = CRC_BF_addEntry( &crc, gfc->headerPH, gfp->padding,            1 );
+    gfc->headerPH = CRC_BF_addEntry( &crc, gfc->headerPH, gfp->extension,          1 );
+    gfc->headerPH = CRC_BF_addEntry( &crc, gfc->headerPH, gfp->mode,               2 );
+    gfc->headerPH = CRC_BF_addEntry( &crc, gfc->headerPH, gfp->mode_ext,           2 );
+    gfc->headerPH = CRC_BF_addEntry( &crc, gfc->headerPH, gfp->copyright,          1 );
+    gfc->headerPH = CRC_BF_addEntry( &crc, gfc->headerPH, gfp->original,           1 );
+    gfc->headerPH = CRC_BF_addEntry( &crc, gfc->headerPH, gfp->emphasis,           2 );
     
     bits_sent = 32;
    
     /* (jo) see below for BF_addEntry( headerPH, crc, 16 ); */
 
-    frameSIPH->part->nrEntries = 0;
+    gfc->frameSIPH->part->nrEntries = 0;
 
     for (ch = 0; ch < gfp->stereo; ch++ )
-	channelSIPH[ch]->part->nrEntries = 0;
+	gfc->channelSIPH[ch]->part->nrEntries = 0;
 
     for ( gr = 0; gr < gfp->mode_gr; gr++ )
 	for ( ch = 0; ch < gfp->stereo; ch++ )
-	    spectrumSIPH[gr][ch]->part->nrEntries = 0;
+	    gfc->spectrumSIPH[gr][ch]->part->nrEntries = 0;
 
     if ( gfp->version == 1 )
     {  /* MPEG1 */
-	frameSIPH = CRC_BF_addEntry( frameSIPH, si->main_data_begin, 9 );
+	gfc->frameSIPH = CRC_BF_addEntry( &crc, gfc->frameSIPH, si->main_data_begin, 9 );
 
 	if ( gfp->stereo == 2 )
-	    frameSIPH = CRC_BF_addEntry( frameSIPH, si->private_bits, 3 );
+	    gfc->frameSIPH = CRC_BF_addEntry( &crc, gfc->frameSIPH, si->private_bits, 3 );
 	else
-	    frameSIPH = CRC_BF_addEntry( frameSIPH, si->private_bits, 5 );
+	    gfc->frameSIPH = CRC_BF_addEntry( &crc, gfc->frameSIPH, si->private_bits, 5 );
 	
 	for ( ch = 0; ch < gfp->stereo; ch++ )
 	    for ( scfsi_band = 0; scfsi_band < 4; scfsi_band++ )
 	    {
-		BF_PartHolder **pph = &channelSIPH[ch];
-		*pph = CRC_BF_addEntry( *pph, si->scfsi[ch][scfsi_band], 1 );
+		BF_PartHolder **pph = &gfc->channelSIPH[ch];
+		*pph = CRC_BF_addEntry( &crc, *pph, si->scfsi[ch][scfsi_band], 1 );
 	    }
 
 	for ( gr = 0; gr < 2; gr++ )
 	    for ( ch = 0; ch < gfp->stereo; ch++ )
 	    {
-		BF_PartHolder **pph = &spectrumSIPH[gr][ch];
+		BF_PartHolder **pph = &gfc->spectrumSIPH[gr][ch];
 		gr_info *gi = &(si->gr[gr].ch[ch].tt);
-		*pph = CRC_BF_addEntry( *pph, gi->part2_3_length,        12 );
-		*pph = CRC_BF_addEntry( *pph, gi->big_values,            9 );
-		*pph = CRC_BF_addEntry( *pph, gi->global_gain,           8 );
-		*pph = CRC_BF_addEntry( *pph, gi->scalefac_compress,     4 );
-		*pph = CRC_BF_addEntry( *pph, gi->window_switching_flag, 1 );
+		*pph = CRC_BF_addEntry( &crc, *pph, gi->part2_3_length,        12 );
+		*pph = CRC_BF_addEntry( &crc, *pph, gi->big_values,            9 );
+		*pph = CRC_BF_addEntry( &crc, *pph, gi->global_gain,           8 );
+		*pph = CRC_BF_addEntry( &crc, *pph, gi->scalefac_compress,     4 );
+		*pph = CRC_BF_addEntry( &crc, *pph, gi->window_switching_flag, 1 );
 
 		if ( gi->window_switching_flag )
 		{   
-		    *pph = CRC_BF_addEntry( *pph, gi->block_type,       2 );
-		    *pph = CRC_BF_addEntry( *pph, gi->mixed_block_flag, 1 );
+		    *pph = CRC_BF_addEntry( &crc, *pph, gi->block_type,       2 );
+		    *pph = CRC_BF_addEntry( &crc, *pph, gi->mixed_block_flag, 1 );
 
 		    for ( region = 0; region < 2; region++ )
-			*pph = CRC_BF_addEntry( *pph, gi->table_select[region],  5 );
+			*pph = CRC_BF_addEntry( &crc, *pph, gi->table_select[region],  5 );
 		    for ( window = 0; window < 3; window++ )
-			*pph = CRC_BF_addEntry( *pph, gi->subblock_gain[window], 3 );
+			*pph = CRC_BF_addEntry( &crc, *pph, gi->subblock_gain[window], 3 );
 		}
 		else
 		{
 		    assert( gi->block_type == NORM_TYPE );
 		    for ( region = 0; region < 3; region++ )
-			*pph = CRC_BF_addEntry( *pph, gi->table_select[region], 5 );
+			*pph = CRC_BF_addEntry( &crc, *pph, gi->table_select[region], 5 );
 
-		    *pph = CRC_BF_addEntry( *pph, gi->region0_count, 4 );
-		    *pph = CRC_BF_addEntry( *pph, gi->region1_count, 3 );
+		    *pph = CRC_BF_addEntry( &crc, *pph, gi->region0_count, 4 );
+		    *pph = CRC_BF_addEntry( &crc, *pph, gi->region1_count, 3 );
 		}
 
-		*pph = CRC_BF_addEntry( *pph, gi->preflag,            1 );
-		*pph = CRC_BF_addEntry( *pph, gi->scalefac_scale,     1 );
-		*pph = CRC_BF_addEntry( *pph, gi->count1table_select, 1 );
+		*pph = CRC_BF_addEntry( &crc, *pph, gi->preflag,            1 );
+		*pph = CRC_BF_addEntry( &crc, *pph, gi->scalefac_scale,     1 );
+		*pph = CRC_BF_addEntry( &crc, *pph, gi->count1table_select, 1 );
 	    }
 
 	if ( gfp->stereo == 2 )
@@ -397,45 +414,45 @@ static int encodeSideInfo( lame_global_flags *gfp,III_side_info_t  *si )
     }
     else
     {  /* MPEG2 */
-	frameSIPH = CRC_BF_addEntry( frameSIPH, si->main_data_begin, 8 );
+	gfc->frameSIPH = CRC_BF_addEntry( &crc, gfc->frameSIPH, si->main_data_begin, 8 );
 
 	if ( gfp->stereo == 2 )
-	    frameSIPH = CRC_BF_addEntry( frameSIPH, si->private_bits, 2 );
+	    gfc->frameSIPH = CRC_BF_addEntry( &crc, gfc->frameSIPH, si->private_bits, 2 );
 	else
-	    frameSIPH = CRC_BF_addEntry( frameSIPH, si->private_bits, 1 );
+	    gfc->frameSIPH = CRC_BF_addEntry( &crc, gfc->frameSIPH, si->private_bits, 1 );
 	
 	gr = 0;
 	for ( ch = 0; ch < gfp->stereo; ch++ )
 	{
-	    BF_PartHolder **pph = &spectrumSIPH[gr][ch];
+	    BF_PartHolder **pph = &gfc->spectrumSIPH[gr][ch];
 	    gr_info *gi = &(si->gr[gr].ch[ch].tt);
-	    *pph = CRC_BF_addEntry( *pph, gi->part2_3_length,        12 );
-	    *pph = CRC_BF_addEntry( *pph, gi->big_values,            9 );
-	    *pph = CRC_BF_addEntry( *pph, gi->global_gain,           8 );
-	    *pph = CRC_BF_addEntry( *pph, gi->scalefac_compress,     9 );
-	    *pph = CRC_BF_addEntry( *pph, gi->window_switching_flag, 1 );
+	    *pph = CRC_BF_addEntry( &crc, *pph, gi->part2_3_length,        12 );
+	    *pph = CRC_BF_addEntry( &crc, *pph, gi->big_values,            9 );
+	    *pph = CRC_BF_addEntry( &crc, *pph, gi->global_gain,           8 );
+	    *pph = CRC_BF_addEntry( &crc, *pph, gi->scalefac_compress,     9 );
+	    *pph = CRC_BF_addEntry( &crc, *pph, gi->window_switching_flag, 1 );
 
 	    if ( gi->window_switching_flag )
 	    {   
-		*pph = CRC_BF_addEntry( *pph, gi->block_type,       2 );
-		*pph = CRC_BF_addEntry( *pph, gi->mixed_block_flag, 1 );
+		*pph = CRC_BF_addEntry( &crc, *pph, gi->block_type,       2 );
+		*pph = CRC_BF_addEntry( &crc, *pph, gi->mixed_block_flag, 1 );
 
 		for ( region = 0; region < 2; region++ )
-		    *pph = CRC_BF_addEntry( *pph, gi->table_select[region],  5 );
+		    *pph = CRC_BF_addEntry( &crc, *pph, gi->table_select[region],  5 );
 		for ( window = 0; window < 3; window++ )
-		    *pph = CRC_BF_addEntry( *pph, gi->subblock_gain[window], 3 );
+		    *pph = CRC_BF_addEntry( &crc, *pph, gi->subblock_gain[window], 3 );
 	    }
 	    else
 	    {
 		for ( region = 0; region < 3; region++ )
-		    *pph = CRC_BF_addEntry( *pph, gi->table_select[region], 5 );
+		    *pph = CRC_BF_addEntry( &crc, *pph, gi->table_select[region], 5 );
 
-		*pph = CRC_BF_addEntry( *pph, gi->region0_count, 4 );
-		*pph = CRC_BF_addEntry( *pph, gi->region1_count, 3 );
+		*pph = CRC_BF_addEntry( &crc, *pph, gi->region0_count, 4 );
+		*pph = CRC_BF_addEntry( &crc, *pph, gi->region1_count, 3 );
 	    }
 
-	    *pph = CRC_BF_addEntry( *pph, gi->scalefac_scale,     1 );
-	    *pph = CRC_BF_addEntry( *pph, gi->count1table_select, 1 );
+	    *pph = CRC_BF_addEntry( &crc, *pph, gi->scalefac_scale,     1 );
+	    *pph = CRC_BF_addEntry( &crc, *pph, gi->count1table_select, 1 );
 	}
 	if ( gfp->stereo == 2 )
 	    bits_sent += 136;
@@ -445,7 +462,7 @@ static int encodeSideInfo( lame_global_flags *gfp,III_side_info_t  *si )
 
     if ( gfp->error_protection )
     {   /* (jo) error_protection: add crc16 information to header */
-	headerPH = BF_addEntry( headerPH, crc, 16 );
+	gfc->headerPH = BF_addEntry( gfc->headerPH, crc, 16 );
 	bits_sent += 16;
     }
 
@@ -459,8 +476,9 @@ static int encodeSideInfo( lame_global_flags *gfp,III_side_info_t  *si )
   the ancillary data...
 */
 static void
-drain_into_ancillary_data( int lengthInBits )
+drain_into_ancillary_data( lame_global_flags *gfp, int lengthInBits )
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
     /*
      */
     int wordsToSend   = lengthInBits / 32;
@@ -471,11 +489,11 @@ drain_into_ancillary_data( int lengthInBits )
       userFrameDataPH->part->nrEntries set by call to write_ancillary_data()
     */
     
-    userFrameDataPH->part->nrEntries = 0;
+    gfc->userFrameDataPH->part->nrEntries = 0;
     for ( i = 0; i < wordsToSend; i++ )
-	userFrameDataPH = BF_addEntry( userFrameDataPH, 0, 32 );
+	gfc->userFrameDataPH = BF_addEntry( gfc->userFrameDataPH, 0, 32 );
     if ( remainingBits )
-	userFrameDataPH = BF_addEntry( userFrameDataPH, 0, remainingBits );
+	gfc->userFrameDataPH = BF_addEntry( gfc->userFrameDataPH, 0, remainingBits );
 }
 
 /*
@@ -484,8 +502,9 @@ drain_into_ancillary_data( int lengthInBits )
   information on pages 26 and 27.
   */
 static void
-Huffmancodebits( BF_PartHolder **pph, int *ix, gr_info *gi )
+Huffmancodebits( lame_global_flags *gfp, BF_PartHolder **pph, int *ix, gr_info *gi )
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
     int L3_huffman_coder_count1( BF_PartHolder **pph, struct huffcodetab *h, int v, int w, int x, int y );
 
     int region1Start;
@@ -522,8 +541,8 @@ Huffmancodebits( BF_PartHolder **pph, int *ix, gr_info *gi )
 	    for ( sfb = 0; sfb < 13; sfb++ )
 	    {
 		unsigned tableindex = 100;
-		start = scalefac_band.s[ sfb ];
-		end   = scalefac_band.s[ sfb+1 ];
+		start = gfc->scalefac_band.s[ sfb ];
+		end   = gfc->scalefac_band.s[ sfb+1 ];
 
 		if ( start < region1Start )
 		    tableindex = gi->table_select[ 0 ];
@@ -573,8 +592,8 @@ Huffmancodebits( BF_PartHolder **pph, int *ix, gr_info *gi )
 
 		for ( sfb = 3; sfb < 13; sfb++ )
 		{
-		    start = scalefac_band.s[ sfb ];
-		    end   = scalefac_band.s[ sfb+1 ];           
+		    start = gfc->scalefac_band.s[ sfb ];
+		    end   = gfc->scalefac_band.s[ sfb+1 ];           
 		    
 		    for ( window = 0; window < 3; window++ )
 			for ( line = start; line < end; line += 2 )
@@ -603,10 +622,10 @@ Huffmancodebits( BF_PartHolder **pph, int *ix, gr_info *gi )
 		{
 		    scalefac_index = gi->region0_count + 1;
 		    assert( scalefac_index < 23 );
-		    region1Start = scalefac_band.l[ scalefac_index ];
+		    region1Start = gfc->scalefac_band.l[ scalefac_index ];
 		    scalefac_index += gi->region1_count + 1;
 		    assert( scalefac_index < 23 );    
-		    region2Start = scalefac_band.l[ scalefac_index ];
+		    region2Start = gfc->scalefac_band.l[ scalefac_index ];
 		}
 
 		for ( i = 0; i < bigvalues; i += 2 )
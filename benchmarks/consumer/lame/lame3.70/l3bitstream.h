@@ -36,11 +36,11 @@ void III_format_bitstream( lame_global_flags *gfp,
 			   int              bitsPerFrame,
 			   int              l3_enc[2][2][576],
                            III_side_info_t  *l3_side,
-			   III_scalefac_t   scalefac[2][2],
-			   Bit_stream_struc *in_bs);
+			   III_scalefac_t   scalefac[2][2]);
 
 int HuffmanCode( int table_select, int x, int y, unsigned *code, unsigned int *extword, int *codebits, int *extbits );
-void III_FlushBitstream(void);
+void III_FlushBitstream(lame_global_flags *gfp);
+void III_FreeBitstream(lame_global_flags *gfp);
 
 int abs_and_sign( int *x ); /* returns signx and changes *x to abs(*x) */
 
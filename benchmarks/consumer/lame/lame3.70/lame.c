@@ -30,6 +30,7 @@
 #include "util.h"
 #include "timestatus.h"
 #include "psymodel.h"
+#include "fft.h"
 #include "newmdct.h"
 #include "quantize.h"
 #include "quantize-pvt.h"
@@ -46,14 +47,75 @@
 #include "asmstuff.h"
 #endif
 
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+
+/********************************************************************
+ *   tables shared by all encoder instances.  They depend only on
+ *   constants, so they are computed once per process, the first time
+ *   any instance calls lame_init_params().
+ ********************************************************************/
+#ifdef HAVE_PTHREAD
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+#else
+static int tables_done = 0;
+#endif
+
+static void lame_init_tables(void)
+{
+  init_fft();
+  L3psycho_init_tables();
+  mdct_init48();
+  iteration_init_tables();
+}
+
+#ifdef HAVE_PTHREAD
+static void lame_pipeline_start(lame_global_flags *gfp);
+static void lame_pipeline_stop(lame_global_flags *gfp);
+#endif
+
+
+/* per-stream encoder state with its defaults, NULL if out of memory */
+static lame_internal_flags *lame_new_internal_flags(void)
+{
+  lame_internal_flags *gfc;
+
+  gfc=calloc(1,sizeof(lame_internal_flags));
+  if (gfc==NULL) return NULL;
+  gfc->masking_lower=1;
+  gfc->OldValue[0]=180;
+  gfc->OldValue[1]=180;
+  gfc->CurrentStep=4;
+  gfc->ms_ener_ratio_old=.25;
+  gfc->id3tag.used=0;
+  gfc->ResvEndFrame=-1;
+  return gfc;
+}
 
-/* Global variable definitions for lame.c */
-static Bit_stream_struc   bs;
-static III_side_info_t l3_side;
-#define MFSIZE (1152+1152+ENCDELAY-MDCTDELAY)
-static short int mfbuf[2][MFSIZE];
-static int mf_size;
-static int mf_samples_to_encode;
+
+/* the parts of the stream state which depend on the (already
+ * checked) output format: bitstream buffers and scalefactor bands */
+static void lame_init_stream(lame_global_flags *gfp)
+{
+  lame_internal_flags *gfc=gfp->internal_flags;
+  int i;
+
+  memset(&gfc->bs, 0, sizeof(Bit_stream_struc));
+  memset(&gfc->l3_side,0x00,sizeof(III_side_info_t));
+  InitFormatBitStream(gfp);
+  init_bit_stream_w(&gfc->bs);
+
+  for (i = 0; i < SBMAX_l + 1; i++) {
+    gfc->scalefac_band.l[i] =
+      sfBandIndex[gfp->samplerate_index + (gfp->version * 3)].l[i];
+  }
+  for (i = 0; i < SBMAX_s + 1; i++) {
+    gfc->scalefac_band.s[i] =
+      sfBandIndex[gfp->samplerate_index + (gfp->version * 3)].s[i];
+  }
+}
 
 
 
@@ -64,16 +126,24 @@ static int mf_samples_to_encode;
  ********************************************************************/
 void lame_init_params(lame_global_flags *gfp)
 {
-  int i;
   FLOAT compression_ratio;
+  lame_internal_flags *gfc=gfp->internal_flags;
 
+#ifdef HAVE_PTHREAD
+  if (gfc->pipe) lame_pipeline_stop(gfp);
+#endif
 
-  memset(&bs, 0, sizeof(Bit_stream_struc));
-  memset(&l3_side,0x00,sizeof(III_side_info_t));
-
+#ifdef HAVE_PTHREAD
+  pthread_once(&tables_once,lame_init_tables);
+#else
+  /* without pthreads, the first call must not race with another one */
+  if (!tables_done) {
+    lame_init_tables();
+    tables_done=1;
+  }
+#endif
 
   gfp->frameNum=0;
-  InitFormatBitStream();
   if (gfp->num_channels==1) {
     gfp->mode = MPG_MD_MONO;
   }
@@ -383,7 +453,7 @@ void lame_init_params(lame_global_flags *gfp)
   }
 
   if (gfp->outPath==NULL || gfp->outPath[0]=='-' ) {
-    id3tag.used=0;         /* turn of id3 tagging */
+    gfc->id3tag.used=0;         /* turn of id3 tagging */
   }
 
 
@@ -392,10 +462,6 @@ void lame_init_params(lame_global_flags *gfp)
     gfp->bWriteVbrTag=0;  /* disable Xing VBR tag */
   }
 
-  init_bit_stream_w(&bs);
-
-
-
   /* set internal feature flags.  USER should not access these since
    * some combinations will produce strange results */
 
@@ -414,7 +480,7 @@ void lame_init_params(lame_global_flags *gfp)
   /* use psymodel (for short block and m/s switching), but no noise shapping */
   if (gfp->quality==7) {
     gfp->filter_type=0;
-    gfp->psymodel=1;
+    gfp->psymodel=2;
     gfp->quantization=0;
     gfp->noise_shaping=0;
     gfp->noise_shaping_stop=0;
@@ -466,21 +532,13 @@ void lame_init_params(lame_global_flags *gfp)
   }
 
 
-  for (i = 0; i < SBMAX_l + 1; i++) {
-    scalefac_band.l[i] =
-      sfBandIndex[gfp->samplerate_index + (gfp->version * 3)].l[i];
-  }
-  for (i = 0; i < SBMAX_s + 1; i++) {
-    scalefac_band.s[i] =
-      sfBandIndex[gfp->samplerate_index + (gfp->version * 3)].s[i];
-  }
-
+  lame_init_stream(gfp);
 
 
   if (gfp->bWriteVbrTag)
     {
       /* Write initial VBR Header to bitstream */
-      InitVbrTag(&bs,1-gfp->version,gfp->mode,gfp->samplerate_index);
+      InitVbrTag(gfp,&gfc->bs,1-gfp->version,gfp->mode,gfp->samplerate_index);
     }
 
 #ifdef HAVEGTK
@@ -494,6 +552,20 @@ void lame_init_params(lame_global_flags *gfp)
   } else
     disp_brhist = 0;
 #endif
+
+#ifdef HAVE_PTHREAD
+  /* segments are cut on the input frame grid, which is the output
+   * frame grid only without resampling.  The frame analyzer encodes
+   * frame by frame. */
+  if (gfp->resample_ratio!=1 || gfp->gtkflag)
+    gfp->threads=1;
+
+  /* the frame analyzer wants psy and quantizer data of the same frame */
+  if (gfp->pipeline && !gfp->gtkflag && gfp->threads<=1)
+    lame_pipeline_start(gfp);
+#else
+  gfp->threads=1;
+#endif
   return;
 }
 
@@ -600,61 +672,48 @@ FFT's                    <---------1024---------->
     FFT starts at 576-224-MDCTDELAY (304)  = 576-FFTOFFSET
 
 */
-int lame_encode_frame(lame_global_flags *gfp,
-short int inbuf_l[],short int inbuf_r[],
-int mf_size,char *mp3buf, int mp3buf_size)
-{
-  static unsigned long frameBits;
-  static unsigned long bitsPerSlot;
-  static FLOAT8 frac_SpF;
-  static FLOAT8 slot_lag;
-  static unsigned long sentBits = 0;
+/* everything the quantization half of lame_encode_frame() needs from
+ * the analysis half, for one frame */
+typedef struct {
+  long frameNum;
+  int mode_ext;
+  III_side_info_t side;        /* only the block type fields are set */
   FLOAT8 xr[2][2][576];
-  int l3_enc[2][2][576];
-  int mp3count;
   III_psy_ratio masking_ratio[2][2];    /*LR ratios */
   III_psy_ratio masking_MS_ratio[2][2]; /*MS ratios */
-  III_psy_ratio (*masking)[2][2];  /*LR ratios and MS ratios*/
-  III_scalefac_t scalefac[2][2];
-  short int *inbuf[2];
+  FLOAT8 pe[2][2], pe_MS[2][2];
+  FLOAT8 ms_ratio[2];
+  FLOAT8 ms_ener_ratio[2];
+} lame_frame_job;
 
-  typedef FLOAT8 pedata[2][2];
-  pedata pe,pe_MS;
-  pedata *pe_use;
 
-  int ch,gr,mean_bits;
-  int bitsPerFrame;
+/* psycho acoustics, mdct and the ms_stereo decision.
+ * Uses only the psymodel, mdct and ms_ratio state from gfc */
+static void
+lame_encode_frame_analysis(lame_global_flags *gfp,
+short int inbuf_l[],short int inbuf_r[],
+int mf_size,lame_frame_job *job)
+{
+  lame_internal_flags *gfc=gfp->internal_flags;
+  III_side_info_t *l3_side = &job->side;
+  FLOAT8 *ms_ratio = gfc->ms_ratio;
+  FLOAT8 *ms_ener_ratio = gfc->ms_ener_ratio;
+  short int *inbuf[2];
+  int ch,gr;
 
   int check_ms_stereo;
-  static FLOAT8 ms_ratio[2]={0,0};
   FLOAT8 ms_ratio_next=0;
   FLOAT8 ms_ratio_prev=0;
-  static FLOAT8 ms_ener_ratio[2]={0,0};
 
-  memset((char *) masking_ratio, 0, sizeof(masking_ratio));
-  memset((char *) masking_MS_ratio, 0, sizeof(masking_MS_ratio));
-  memset((char *) scalefac, 0, sizeof(scalefac));
+  memset((char *) job->masking_ratio, 0, sizeof(job->masking_ratio));
+  memset((char *) job->masking_MS_ratio, 0, sizeof(job->masking_MS_ratio));
   inbuf[0]=inbuf_l;
   inbuf[1]=inbuf_r;
 
-  gfp->mode_ext = MPG_MD_LR_LR;
+  job->frameNum = gfp->frameNum;
+  job->mode_ext = MPG_MD_LR_LR;
 
   if (gfp->frameNum==0 )  {
-    /* Figure average number of 'slots' per frame. */
-    FLOAT8 avg_slots_per_frame;
-    FLOAT8 sampfreq =   gfp->out_samplerate/1000.0;
-    int bit_rate = gfp->brate;
-    sentBits = 0;
-    bitsPerSlot = 8;
-    avg_slots_per_frame = (bit_rate*gfp->framesize) /
-           (sampfreq* bitsPerSlot);
-    /* -f fast-math option causes some strange rounding here, be carefull: */
-    frac_SpF  = avg_slots_per_frame - floor(avg_slots_per_frame + 1e-9);
-    if (fabs(frac_SpF) < 1e-9) frac_SpF = 0;
-
-    slot_lag  = -frac_SpF;
-    gfp->padding = 1;
-    if (frac_SpF==0) gfp->padding = 0;
     /* check FFT will not use a negative starting offset */
     assert(576>=FFTOFFSET);
     /* check if we have enough data for FFT */
@@ -662,55 +721,6 @@ int mf_size,char *mp3buf, int mp3buf_size)
   }
 
 
-  /********************** padding *****************************/
-  switch (gfp->padding_type) {
-  case 0:
-    gfp->padding=0;
-    break;
-  case 1:
-    gfp->padding=1;
-    break;
-  case 2:
-  default:
-    if (gfp->VBR) {
-      gfp->padding=0;
-    } else {
-      if (gfp->disable_reservoir) {
-	gfp->padding = 0;
-	/* if the user specified --nores, dont very gfp->padding either */
-	/* tiny changes in frac_SpF rounding will cause file differences */
-      }else{
-	if (frac_SpF != 0) {
-	  if (slot_lag > (frac_SpF-1.0) ) {
-	    slot_lag -= frac_SpF;
-	    gfp->padding = 0;
-	  }
-	  else {
-	    gfp->padding = 1;
-	    slot_lag += (1-frac_SpF);
-	  }
-	}
-      }
-    }
-  }
-
-
-  /********************** status display  *****************************/
-  if (!gfp->gtkflag && !gfp->silent) {
-    int mod = gfp->version == 0 ? 200 : 50;
-    if (gfp->frameNum%mod==0) {
-      timestatus(gfp->out_samplerate,gfp->frameNum,gfp->totalframes,gfp->framesize);
-#ifdef BRHIST
-      if (disp_brhist)
-	{
-	  brhist_add_count();
-	  brhist_disp();
-	}
-#endif
-    }
-  }
-
-
   if (gfp->psymodel) {
     /* psychoacoustic model
      * psy model has a 1 granule (576) delay that we must compensate for
@@ -727,18 +737,18 @@ int mf_size,char *mp3buf, int mp3buf_size)
 
       L3psycho_anal( gfp,bufp, gr, 
 		     &ms_ratio[gr],&ms_ratio_next,&ms_ener_ratio[gr],
-		     masking_ratio, masking_MS_ratio,
-		     pe[gr],pe_MS[gr],blocktype);
+		     job->masking_ratio, job->masking_MS_ratio,
+		     job->pe[gr],job->pe_MS[gr],blocktype);
 
       for ( ch = 0; ch < gfp->stereo; ch++ )
-	l3_side.gr[gr].ch[ch].tt.block_type=blocktype[ch];
+	l3_side->gr[gr].ch[ch].tt.block_type=blocktype[ch];
 
     }
   }else{
     for (gr=0; gr < gfp->mode_gr ; gr++)
       for ( ch = 0; ch < gfp->stereo; ch++ ) {
-	l3_side.gr[gr].ch[ch].tt.block_type=NORM_TYPE;
-	pe[gr][ch]=700;
+	l3_side->gr[gr].ch[ch].tt.block_type=NORM_TYPE;
+	job->pe[gr][ch]=700;
       }
   }
 
@@ -746,7 +756,7 @@ int mf_size,char *mp3buf, int mp3buf_size)
   /* block type flags */
   for( gr = 0; gr < gfp->mode_gr; gr++ ) {
     for ( ch = 0; ch < gfp->stereo; ch++ ) {
-      gr_info *cod_info = &l3_side.gr[gr].ch[ch].tt;
+      gr_info *cod_info = &l3_side->gr[gr].ch[ch].tt;
       cod_info->mixed_block_flag = 0;     /* never used by this model */
       if (cod_info->block_type == NORM_TYPE )
 	cod_info->window_switching_flag = 0;
@@ -756,15 +766,15 @@ int mf_size,char *mp3buf, int mp3buf_size)
   }
 
   /* polyphase filtering / mdct */
-  mdct_sub48(gfp,inbuf[0], inbuf[1], xr, &l3_side);
+  mdct_sub48(gfp,inbuf[0], inbuf[1], job->xr, l3_side);
 
   /* use m/s gfp->stereo? */
   check_ms_stereo =  (gfp->mode == MPG_MD_JOINT_STEREO);
   if (check_ms_stereo) {
     /* make sure block type is the same in each channel */
     check_ms_stereo =
-      (l3_side.gr[0].ch[0].tt.block_type==l3_side.gr[0].ch[1].tt.block_type) &&
-      (l3_side.gr[1].ch[0].tt.block_type==l3_side.gr[1].ch[1].tt.block_type);
+      (l3_side->gr[0].ch[0].tt.block_type==l3_side->gr[0].ch[1].tt.block_type) &&
+      (l3_side->gr[1].ch[0].tt.block_type==l3_side->gr[1].ch[1].tt.block_type);
   }
   if (check_ms_stereo) {
     /* ms_ratio = is like the ratio of side_energy/total_energy */
@@ -773,9 +783,13 @@ int mf_size,char *mp3buf, int mp3buf_size)
     ms_ratio_ave = .25*(ms_ratio[0] + ms_ratio[1]+
 			 ms_ratio_prev + ms_ratio_next);
     ms_ener_ratio_ave = .5*(ms_ener_ratio[0]+ms_ener_ratio[1]);
-    if ( ms_ratio_ave <.35 /*&& ms_ener_ratio_ave<.75*/ ) gfp->mode_ext = MPG_MD_MS_LR;
+    if ( ms_ratio_ave <.35 /*&& ms_ener_ratio_ave<.75*/ ) job->mode_ext = MPG_MD_MS_LR;
   }
-  if (gfp->force_ms) gfp->mode_ext = MPG_MD_MS_LR;
+  if (gfp->force_ms) job->mode_ext = MPG_MD_MS_LR;
+
+  /* gfc->ms_ratio is overwritten by the next frame's analysis */
+  memcpy(job->ms_ratio, ms_ratio, sizeof(job->ms_ratio));
+  memcpy(job->ms_ener_ratio, ms_ener_ratio, sizeof(job->ms_ener_ratio));
 
 
 #ifdef HAVEGTK
@@ -786,10 +800,10 @@ int mf_size,char *mp3buf, int mp3buf_size)
 	pinfo->ms_ratio[gr]=ms_ratio[gr];
 	pinfo->ms_ener_ratio[gr]=ms_ener_ratio[gr];
 	pinfo->blocktype[gr][ch]=
-	  l3_side.gr[gr].ch[ch].tt.block_type;
-	for ( j = 0; j < 576; j++ ) pinfo->xr[gr][ch][j]=xr[gr][ch][j];
+	  l3_side->gr[gr].ch[ch].tt.block_type;
+	for ( j = 0; j < 576; j++ ) pinfo->xr[gr][ch][j]=job->xr[gr][ch][j];
 	/* if MS stereo, switch to MS psy data */
-	if (gfp->mode_ext==MPG_MD_MS_LR) {
+	if (job->mode_ext==MPG_MD_MS_LR) {
 	  pinfo->pe[gr][ch]=pinfo->pe[gr][ch+2];
 	  pinfo->ers[gr][ch]=pinfo->ers[gr][ch+2];
 	  memcpy(pinfo->energy[gr][ch],pinfo->energy[gr][ch+2],
@@ -797,33 +811,142 @@ int mf_size,char *mp3buf, int mp3buf_size)
 	}
       }
     }
+    for ( ch = 0; ch < gfp->stereo; ch++ ) {
+      for ( j = 0; j < FFTOFFSET; j++ )
+	pinfo->pcmdata[ch][j] = pinfo->pcmdata[ch][j+gfp->framesize];
+      for ( j = FFTOFFSET; j < 1600; j++ ) {
+	pinfo->pcmdata[ch][j] = inbuf[ch][j-FFTOFFSET];
+      }
+    }
   }
 #endif
+}
+
+
+
+/* padding, bit allocation, and formatting of the frame analysed in job.
+ * Uses everything in gfc except what lame_encode_frame_analysis() uses */
+static int
+lame_encode_frame_quantize(lame_global_flags *gfp,lame_frame_job *job,
+char *mp3buf, int mp3buf_size)
+{
+  lame_internal_flags *gfc=gfp->internal_flags;
+  III_side_info_t *l3_side = &gfc->l3_side;
+  int l3_enc[2][2][576];
+  int mp3count;
+  III_psy_ratio (*masking)[2][2];  /*LR ratios and MS ratios*/
+  III_scalefac_t scalefac[2][2];
+
+  typedef FLOAT8 pedata[2][2];
+  pedata *pe_use;
+
+  int ch,gr,mean_bits;
+  int bitsPerFrame;
+
+  memset((char *) scalefac, 0, sizeof(scalefac));
+
+  gfp->mode_ext = job->mode_ext;
 
+  if (gfp->frameNum==0 )  {
+    /* Figure average number of 'slots' per frame. */
+    FLOAT8 avg_slots_per_frame;
+    FLOAT8 sampfreq =   gfp->out_samplerate/1000.0;
+    int bit_rate = gfp->brate;
+    gfc->sentBits = 0;
+    gfc->bitsPerSlot = 8;
+    avg_slots_per_frame = (bit_rate*gfp->framesize) /
+           (sampfreq* gfc->bitsPerSlot);
+    /* -f fast-math option causes some strange rounding here, be carefull: */
+    gfc->frac_SpF  = avg_slots_per_frame - floor(avg_slots_per_frame + 1e-9);
+    if (fabs(gfc->frac_SpF) < 1e-9) gfc->frac_SpF = 0;
 
+    gfc->slot_lag  = -gfc->frac_SpF;
+    gfp->padding = 1;
+    if (gfc->frac_SpF==0) gfp->padding = 0;
+  }
+
+
+  /********************** padding *****************************/
+  switch (gfp->padding_type) {
+  case 0:
+    gfp->padding=0;
+    break;
+  case 1:
+    gfp->padding=1;
+    break;
+  case 2:
+  default:
+    if (gfp->VBR) {
+      gfp->padding=0;
+    } else {
+      if (gfp->disable_reservoir) {
+	gfp->padding = 0;
+	/* if the user specified --nores, dont very gfp->padding either */
+	/* tiny changes in frac_SpF rounding will cause file differences */
+      }else{
+	if (gfc->frac_SpF != 0) {
+	  if (gfc->slot_lag > (gfc->frac_SpF-1.0) ) {
+	    gfc->slot_lag -= gfc->frac_SpF;
+	    gfp->padding = 0;
+	  }
+	  else {
+	    gfp->padding = 1;
+	    gfc->slot_lag += (1-gfc->frac_SpF);
+	  }
+	}
+      }
+    }
+  }
+
+
+  /********************** status display  *****************************/
+  if (!gfp->gtkflag && !gfp->silent) {
+    int mod = gfp->version == 0 ? 200 : 50;
+    if (gfp->frameNum%mod==0) {
+      timestatus(gfp->out_samplerate,gfp->frameNum,gfp->totalframes,gfp->framesize);
+#ifdef BRHIST
+      if (disp_brhist)
+	{
+	  brhist_add_count();
+	  brhist_disp();
+	}
+#endif
+    }
+  }
+
+
+  for( gr = 0; gr < gfp->mode_gr; gr++ ) {
+    for ( ch = 0; ch < gfp->stereo; ch++ ) {
+      gr_info *cod_info = &l3_side->gr[gr].ch[ch].tt;
+      gr_info *psy_info = &job->side.gr[gr].ch[ch].tt;
+      cod_info->block_type = psy_info->block_type;
+      cod_info->mixed_block_flag = psy_info->mixed_block_flag;
+      cod_info->window_switching_flag = psy_info->window_switching_flag;
+    }
+  }
 
 
   /* bit and noise allocation */
   if (MPG_MD_MS_LR == gfp->mode_ext) {
-    masking = &masking_MS_ratio;    /* use MS masking */
-    pe_use=&pe_MS;
+    masking = &job->masking_MS_ratio;    /* use MS masking */
+    pe_use=&job->pe_MS;
   } else {
-    masking = &masking_ratio;    /* use LR masking */
-    pe_use=&pe;
+    masking = &job->masking_ratio;    /* use LR masking */
+    pe_use=&job->pe;
   }
 
 
   /*
-  VBR_iteration_loop_new( gfp,*pe_use, ms_ratio, xr, masking, &l3_side, l3_enc,
+  VBR_iteration_loop_new( gfp,*pe_use, ms_ratio, xr, masking, l3_side, l3_enc,
   	  &scalefac);
   */
 
 
   if (gfp->VBR) {
-    VBR_iteration_loop( gfp,*pe_use, ms_ratio, xr, *masking, &l3_side, l3_enc,
+    VBR_iteration_loop( gfp,*pe_use, job->ms_ratio, job->xr, *masking, l3_side, l3_enc,
 			scalefac);
   }else{
-    iteration_loop( gfp,*pe_use, ms_ratio, xr, *masking, &l3_side, l3_enc,
+    iteration_loop( gfp,*pe_use, job->ms_ratio, job->xr, *masking, l3_side, l3_enc,
 		    scalefac);
   }
 
@@ -831,42 +954,221 @@ int mf_size,char *mp3buf, int mp3buf_size)
 
 
 #ifdef BRHIST
-  brhist_temp[gfp->bitrate_index]++;
+  /* the histogram is process wide, only touch it if it is displayed.
+   * lame_encode_segments() runs its encoders silent and counts the
+   * frames it writes itself. */
+  if (disp_brhist && !gfp->silent)
+    brhist_temp[gfp->bitrate_index]++;
 #endif
 
 
   /*  write the frame to the bitstream  */
   getframebits(gfp,&bitsPerFrame,&mean_bits);
-  III_format_bitstream( gfp,bitsPerFrame, l3_enc, &l3_side,
-			scalefac, &bs);
+  III_format_bitstream( gfp,bitsPerFrame, l3_enc, l3_side,
+			scalefac);
 
 
-  frameBits = bs.totbit - sentBits;
+  gfc->frameBits = gfc->bs.totbit - gfc->sentBits;
 
 
-  if ( frameBits % bitsPerSlot )   /* a program failure */
+  if ( gfc->frameBits % gfc->bitsPerSlot )   /* a program failure */
     fprintf( stderr, "Sent %ld bits = %ld slots plus %ld\n",
-	     frameBits, frameBits/bitsPerSlot,
-	     frameBits%bitsPerSlot );
-  sentBits += frameBits;
+	     gfc->frameBits, gfc->frameBits/gfc->bitsPerSlot,
+	     gfc->frameBits%gfc->bitsPerSlot );
+  gfc->sentBits += gfc->frameBits;
 
   /* copy mp3 bit buffer into array */
-  mp3count = copy_buffer(mp3buf,mp3buf_size,&bs);
+  mp3count = copy_buffer(mp3buf,mp3buf_size,&gfc->bs);
 
-  if (gfp->bWriteVbrTag) AddVbrFrame((int)(sentBits/8));
+  if (gfp->bWriteVbrTag) AddVbrFrame(gfp,(int)(gfc->sentBits/8));
 
-#ifdef HAVEGTK
-  if (gfp->gtkflag) {
-    int j;
-    for ( ch = 0; ch < gfp->stereo; ch++ ) {
-      for ( j = 0; j < FFTOFFSET; j++ )
-	pinfo->pcmdata[ch][j] = pinfo->pcmdata[ch][j+gfp->framesize];
-      for ( j = FFTOFFSET; j < 1600; j++ ) {
-	pinfo->pcmdata[ch][j] = inbuf[ch][j-FFTOFFSET];
-      }
+  return mp3count;
+}
+
+
+
+#ifdef HAVE_PTHREAD
+/********************************************************************
+ *   pipelined encoding (gfp->pipeline)
+ *
+ *   The calling thread runs lame_encode_frame_analysis() for frame n
+ *   while a second thread runs lame_encode_frame_quantize() for frame
+ *   n-1.  The two halves touch disjoint parts of gfc, the quantizer
+ *   works on its own copy of *gfp (it writes padding, mode_ext,
+ *   bitrate_index), and up to LAME_PIPE_DEPTH analysed frames are
+ *   queued between them.  The output is identical to the serial
+ *   encoder, but lame_encode_frame() returns each frame's mp3 data
+ *   one or more calls later; lame_encode_finish() flushes the rest.
+ ********************************************************************/
+#define LAME_PIPE_DEPTH 3
+
+typedef struct {
+  lame_frame_job job;
+  int mp3count;                 /* set by the quantizer */
+  char mp3buf[LAME_MAXMP3BUFFER];
+} lame_pipe_slot;
+
+struct lame_pipeline {
+  lame_global_flags gf;         /* the quantizer's copy of *gfp */
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t work;          /* a frame was analysed, or quit was set */
+  pthread_cond_t done;          /* a frame was quantized */
+  long submitted, quantized, collected;   /* frames, in order */
+  int quit;
+  lame_pipe_slot slot[LAME_PIPE_DEPTH];
+};
+
+
+static void *lame_pipeline_worker(void *arg)
+{
+  struct lame_pipeline *p = arg;
+  lame_pipe_slot *s;
+
+  pthread_mutex_lock(&p->lock);
+  for (;;) {
+    while (p->quantized==p->submitted && !p->quit)
+      pthread_cond_wait(&p->work,&p->lock);
+    if (p->quantized==p->submitted) break;
+    s = &p->slot[p->quantized % LAME_PIPE_DEPTH];
+    pthread_mutex_unlock(&p->lock);
+
+    p->gf.frameNum = s->job.frameNum;
+    /* slots are LAME_MAXMP3BUFFER bytes, the most one frame can produce */
+    s->mp3count = lame_encode_frame_quantize(&p->gf,&s->job,s->mp3buf,0);
+
+    pthread_mutex_lock(&p->lock);
+    p->quantized++;
+    pthread_cond_signal(&p->done);
+  }
+  pthread_mutex_unlock(&p->lock);
+  return NULL;
+}
+
+
+static void lame_pipeline_start(lame_global_flags *gfp)
+{
+  lame_internal_flags *gfc=gfp->internal_flags;
+  struct lame_pipeline *p;
+
+  p = (struct lame_pipeline *) malloc(sizeof(struct lame_pipeline));
+  if (p == NULL) return;        /* encode serially */
+  p->gf = *gfp;
+  p->submitted = p->quantized = p->collected = 0;
+  p->quit = 0;
+  pthread_mutex_init(&p->lock,NULL);
+  pthread_cond_init(&p->work,NULL);
+  pthread_cond_init(&p->done,NULL);
+  if (pthread_create(&p->thread,NULL,lame_pipeline_worker,p)) {
+    pthread_cond_destroy(&p->done);
+    pthread_cond_destroy(&p->work);
+    pthread_mutex_destroy(&p->lock);
+    free(p);
+    return;
+  }
+  gfc->pipe = p;
+}
+
+
+/* stop the quantizer thread, dropping frames that were never quantized,
+ * and hand the quantizer's frame flags back to gfp */
+static void lame_pipeline_stop(lame_global_flags *gfp)
+{
+  lame_internal_flags *gfc=gfp->internal_flags;
+  struct lame_pipeline *p = gfc->pipe;
+
+  pthread_mutex_lock(&p->lock);
+  p->quit = 1;
+  p->submitted = p->quantized;
+  pthread_cond_signal(&p->work);
+  pthread_mutex_unlock(&p->lock);
+  pthread_join(p->thread,NULL);
+
+  gfp->padding = p->gf.padding;
+  gfp->mode_ext = p->gf.mode_ext;
+  gfp->bitrate_index = p->gf.bitrate_index;
+
+  pthread_cond_destroy(&p->done);
+  pthread_cond_destroy(&p->work);
+  pthread_mutex_destroy(&p->lock);
+  free(p);
+  gfc->pipe = NULL;
+}
+
+
+/* copy quantized frames, oldest first, into mp3buf.  Waits until no
+ * more than max_inflight frames are still in the pipe.
+ * return code = number of bytes output in mp3buf, or -1 if mp3buf was
+ * too small (mp3buf_size=0 means unchecked, as in copy_buffer()) */
+static int lame_pipeline_collect(lame_global_flags *gfp,
+char *mp3buf, int mp3buf_size, int max_inflight)
+{
+  lame_internal_flags *gfc=gfp->internal_flags;
+  struct lame_pipeline *p = gfc->pipe;
+  lame_pipe_slot *s;
+  int mp3count=0;
+
+  pthread_mutex_lock(&p->lock);
+  for (;;) {
+    while (p->collected==p->quantized &&
+	   p->submitted-p->collected > max_inflight)
+      pthread_cond_wait(&p->done,&p->lock);
+    if (p->collected==p->quantized) break;
+    s = &p->slot[p->collected % LAME_PIPE_DEPTH];
+    if (mp3buf_size != 0 && mp3count+s->mp3count > mp3buf_size) {
+      pthread_mutex_unlock(&p->lock);
+      return -1;
     }
+    memcpy(mp3buf+mp3count,s->mp3buf,s->mp3count);
+    mp3count += s->mp3count;
+    p->collected++;
   }
+  pthread_mutex_unlock(&p->lock);
+  return mp3count;
+}
+
+
+static int lame_pipeline_frame(lame_global_flags *gfp,
+short int inbuf_l[],short int inbuf_r[],
+int mf_size,char *mp3buf, int mp3buf_size)
+{
+  lame_internal_flags *gfc=gfp->internal_flags;
+  struct lame_pipeline *p = gfc->pipe;
+  int mp3count;
+
+  /* output what is ready, and make room for this frame */
+  mp3count = lame_pipeline_collect(gfp,mp3buf,mp3buf_size,LAME_PIPE_DEPTH-1);
+  if (mp3count == -1) return -1;
+
+  lame_encode_frame_analysis(gfp,inbuf_l,inbuf_r,mf_size,
+			     &p->slot[p->submitted % LAME_PIPE_DEPTH].job);
+
+  pthread_mutex_lock(&p->lock);
+  p->submitted++;
+  pthread_cond_signal(&p->work);
+  pthread_mutex_unlock(&p->lock);
+
+  gfp->frameNum++;
+  return mp3count;
+}
 #endif
+
+
+
+int lame_encode_frame(lame_global_flags *gfp,
+short int inbuf_l[],short int inbuf_r[],
+int mf_size,char *mp3buf, int mp3buf_size)
+{
+  lame_frame_job job;
+  int mp3count;
+
+#ifdef HAVE_PTHREAD
+  if (gfp->internal_flags->pipe)
+    return lame_pipeline_frame(gfp,inbuf_l,inbuf_r,mf_size,mp3buf,mp3buf_size);
+#endif
+
+  lame_encode_frame_analysis(gfp,inbuf_l,inbuf_r,mf_size,&job);
+  mp3count = lame_encode_frame_quantize(gfp,&job,mp3buf,mp3buf_size);
   gfp->frameNum++;
 
   return mp3count;
@@ -877,18 +1179,17 @@ int mf_size,char *mp3buf, int mp3buf_size)
 int fill_buffer_resample(lame_global_flags *gfp,short int *outbuf,int desired_len,
         short int *inbuf,int len,int *num_used,int ch) {
 
-  static FLOAT8 itime[2];
-#define OLDBUFSIZE 5
-  static short int inbuf_old[2][OLDBUFSIZE];
-  static int init[2]={0,0};
+  lame_internal_flags *gfc=gfp->internal_flags;
+  FLOAT8 *itime = gfc->itime;
+  short int (*inbuf_old)[OLDBUFSIZE] = gfc->inbuf_old;
   int i,j=0,k,linear,value;
 
-  if (gfp->frameNum==0 && !init[ch]) {
-    init[ch]=1;
+  if (gfp->frameNum==0 && !gfc->resample_init[ch]) {
+    gfc->resample_init[ch]=1;
     itime[ch]=0;
     memset((char *) inbuf_old[ch], 0, sizeof(short int)*OLDBUFSIZE);
   }
-  if (gfp->frameNum!=0) init[ch]=0; /* reset, for next time framenum=0 */
+  if (gfp->frameNum!=0) gfc->resample_init[ch]=0; /* reset, for next time framenum=0 */
 
 
   /* if downsampling by an integer multiple, use linear resampling,
@@ -976,7 +1277,8 @@ int lame_encode_buffer(lame_global_flags *gfp,
    short int buffer_l[], short int buffer_r[],int nsamples,
    char *mp3buf, int mp3buf_size)
 {
-  static int frame_buffered=0;
+  lame_internal_flags *gfc=gfp->internal_flags;
+  short int (*mfbuf)[MFSIZE] = gfc->mfbuf;
   int mp3size=0,ret,i,ch,mf_needed;
 
   short int *in_buffer[2];
@@ -999,15 +1301,15 @@ int lame_encode_buffer(lame_global_flags *gfp,
    * granule).  So we need to pad with 288 samples to make sure we can
    * encode the 576 samples we are interested in.
    */
-  if (gfp->frameNum==0 && !frame_buffered) {
-    memset((char *) mfbuf, 0, sizeof(mfbuf));
-    frame_buffered=1;
-    mf_samples_to_encode = ENCDELAY+288;
-    mf_size=ENCDELAY-MDCTDELAY;  /* we pad input with this many 0's */
+  if (gfp->frameNum==0 && !gfc->frame_buffered) {
+    memset((char *) gfc->mfbuf, 0, sizeof(gfc->mfbuf));
+    gfc->frame_buffered=1;
+    gfc->mf_samples_to_encode = ENCDELAY+288;
+    gfc->mf_size=ENCDELAY-MDCTDELAY;  /* we pad input with this many 0's */
   }
   if (gfp->frameNum==1) {
     /* reset, for the next time frameNum==0 */
-    frame_buffered=0;
+    gfc->frame_buffered=0;
   }
 
   if (gfp->num_channels==2  && gfp->stereo==1) {
@@ -1025,10 +1327,10 @@ int lame_encode_buffer(lame_global_flags *gfp,
     /* copy in new samples */
     for (ch=0; ch<gfp->stereo; ch++) {
       if (gfp->resample_ratio!=1)  {
-	n_out=fill_buffer_resample(gfp,&mfbuf[ch][mf_size],gfp->framesize,
+	n_out=fill_buffer_resample(gfp,&mfbuf[ch][gfc->mf_size],gfp->framesize,
 					  in_buffer[ch],nsamples,&n_in,ch);
       } else {
-	n_out=fill_buffer(gfp,&mfbuf[ch][mf_size],gfp->framesize,in_buffer[ch],nsamples);
+	n_out=fill_buffer(gfp,&mfbuf[ch][gfc->mf_size],gfp->framesize,in_buffer[ch],nsamples);
 	n_in = n_out;
       }
       in_buffer[ch] += n_in;
@@ -1036,13 +1338,13 @@ int lame_encode_buffer(lame_global_flags *gfp,
 
 
     nsamples -= n_in;
-    mf_size += n_out;
-    assert(mf_size<=MFSIZE);
-    mf_samples_to_encode += n_out;
+    gfc->mf_size += n_out;
+    assert(gfc->mf_size<=MFSIZE);
+    gfc->mf_samples_to_encode += n_out;
 
-    if (mf_size >= mf_needed) {
+    if (gfc->mf_size >= mf_needed) {
       /* encode the frame */
-      ret = lame_encode_frame(gfp,mfbuf[0],mfbuf[1],mf_size,mp3buf,mp3buf_size);
+      ret = lame_encode_frame(gfp,mfbuf[0],mfbuf[1],gfc->mf_size,mp3buf,mp3buf_size);
       if (ret == -1) {
 	/* fatel error: mp3buffer was too small */
 	return -1;
@@ -1051,10 +1353,10 @@ int lame_encode_buffer(lame_global_flags *gfp,
       mp3size += ret;
 
       /* shift out old samples */
-      mf_size -= gfp->framesize;
-      mf_samples_to_encode -= gfp->framesize;
+      gfc->mf_size -= gfp->framesize;
+      gfc->mf_samples_to_encode -= gfp->framesize;
       for (ch=0; ch<gfp->stereo; ch++)
-	for (i=0; i<mf_size; i++)
+	for (i=0; i<gfc->mf_size; i++)
 	  mfbuf[ch][i]=mfbuf[ch][i+gfp->framesize];
     }
   }
@@ -1068,7 +1370,8 @@ int lame_encode_buffer(lame_global_flags *gfp,
 int lame_encode_buffer_interleaved(lame_global_flags *gfp,
    short int buffer[], int nsamples, char *mp3buf, int mp3buf_size)
 {
-  static int frame_buffered=0;
+  lame_internal_flags *gfc=gfp->internal_flags;
+  short int (*mfbuf)[MFSIZE] = gfc->mfbuf;
   int mp3size=0,ret,i,ch,mf_needed;
 
   /* some sanity checks */
@@ -1100,15 +1403,15 @@ int lame_encode_buffer_interleaved(lame_global_flags *gfp,
   }
 
 
-  if (gfp->frameNum==0 && !frame_buffered) {
-    memset((char *) mfbuf, 0, sizeof(mfbuf));
-    frame_buffered=1;
-    mf_samples_to_encode = ENCDELAY+288;
-    mf_size=ENCDELAY-MDCTDELAY;  /* we pad input with this many 0's */
+  if (gfp->frameNum==0 && !gfc->frame_buffered) {
+    memset((char *) gfc->mfbuf, 0, sizeof(gfc->mfbuf));
+    gfc->frame_buffered=1;
+    gfc->mf_samples_to_encode = ENCDELAY+288;
+    gfc->mf_size=ENCDELAY-MDCTDELAY;  /* we pad input with this many 0's */
   }
   if (gfp->frameNum==1) {
     /* reset, for the next time frameNum==0 */
-    frame_buffered=0;
+    gfc->frame_buffered=0;
   }
 
   if (gfp->num_channels==2  && gfp->stereo==1) {
@@ -1125,19 +1428,19 @@ int lame_encode_buffer_interleaved(lame_global_flags *gfp,
     /* copy in new samples */
     n_out = Min(gfp->framesize,nsamples);
     for (i=0; i<n_out; ++i) {
-      mfbuf[0][mf_size+i]=buffer[2*i];
-      mfbuf[1][mf_size+i]=buffer[2*i+1];
+      mfbuf[0][gfc->mf_size+i]=buffer[2*i];
+      mfbuf[1][gfc->mf_size+i]=buffer[2*i+1];
     }
     buffer += 2*n_out;
 
     nsamples -= n_out;
-    mf_size += n_out;
-    assert(mf_size<=MFSIZE);
-    mf_samples_to_encode += n_out;
+    gfc->mf_size += n_out;
+    assert(gfc->mf_size<=MFSIZE);
+    gfc->mf_samples_to_encode += n_out;
 
-    if (mf_size >= mf_needed) {
+    if (gfc->mf_size >= mf_needed) {
       /* encode the frame */
-      ret = lame_encode_frame(gfp,mfbuf[0],mfbuf[1],mf_size,mp3buf,mp3buf_size);
+      ret = lame_encode_frame(gfp,mfbuf[0],mfbuf[1],gfc->mf_size,mp3buf,mp3buf_size);
       if (ret == -1) {
 	/* fatel error: mp3buffer was too small */
 	return -1;
@@ -1146,10 +1449,10 @@ int lame_encode_buffer_interleaved(lame_global_flags *gfp,
       mp3size += ret;
 
       /* shift out old samples */
-      mf_size -= gfp->framesize;
-      mf_samples_to_encode -= gfp->framesize;
+      gfc->mf_size -= gfp->framesize;
+      gfc->mf_samples_to_encode -= gfp->framesize;
       for (ch=0; ch<gfp->stereo; ch++)
-	for (i=0; i<mf_size; i++)
+	for (i=0; i<gfc->mf_size; i++)
 	  mfbuf[ch][i]=mfbuf[ch][i+gfp->framesize];
     }
   }
@@ -1178,11 +1481,12 @@ int lame_encode_buffer_interleaved(lame_global_flags *gfp,
  * lame_encode_finish()
  */
 int lame_encode(lame_global_flags *gfp, short int in_buffer[2][1152],char *mp3buf,int size){
+  lame_internal_flags *gfc=gfp->internal_flags;
   int imp3,save;
-  save = mf_samples_to_encode;
+  save = gfc->mf_samples_to_encode;
   imp3= lame_encode_buffer(gfp,in_buffer[0],in_buffer[1],576*gfp->mode_gr,
         mp3buf,size);
-  mf_samples_to_encode = save;
+  gfc->mf_samples_to_encode = save;
   return imp3;
 }
 
@@ -1192,6 +1496,7 @@ int lame_encode(lame_global_flags *gfp, short int in_buffer[2][1152],char *mp3bu
 /* initialize mp3 encoder */
 void lame_init(lame_global_flags *gfp)
 {
+  lame_internal_flags *gfc;
 
   /*
    *  Disable floating point exepctions
@@ -1305,6 +1610,8 @@ void lame_init(lame_global_flags *gfp)
   gfp->padding=0;
   gfp->swapbytes=0;
   gfp->silent=0;
+  gfp->pipeline=0;
+  gfp->threads=1;
   gfp->totalframes=0;
   gfp->VBR=0;
   gfp->VBR_q=4;
@@ -1331,7 +1638,13 @@ void lame_init(lame_global_flags *gfp)
 
   gfp->inPath=NULL;
   gfp->outPath=NULL;
-  id3tag.used=0;
+
+  /* per-stream encoder state */
+  gfc=gfp->internal_flags=lame_new_internal_flags();
+  if (gfc==NULL) {
+    fprintf(stderr,"lame_init: cannot allocate encoder state\n");
+    exit(1);
+  }
 
 }
 
@@ -1342,12 +1655,13 @@ void lame_init(lame_global_flags *gfp)
 /*****************************************************************/
 int lame_encode_finish(lame_global_flags *gfp,char *mp3buffer, int mp3buffer_size)
 {
+  lame_internal_flags *gfc=gfp->internal_flags;
   int imp3,mp3count,mp3buffer_size_remaining;
   short int buffer[2][1152];
   memset((char *)buffer,0,sizeof(buffer));
   mp3count = 0;
 
-  while (mf_samples_to_encode > 0) {
+  while (gfc->mf_samples_to_encode > 0) {
 
     mp3buffer_size_remaining = mp3buffer_size - mp3count;
     /* if user specifed buffer size = 0, dont check size */
@@ -1356,14 +1670,33 @@ int lame_encode_finish(lame_global_flags *gfp,char *mp3buffer, int mp3buffer_siz
 
     if (imp3 == -1) {
       /* fatel error: mp3buffer too small */
-      desalloc_buffer(&bs);    /* Deallocate all buffers */
+#ifdef HAVE_PTHREAD
+      if (gfc->pipe) lame_pipeline_stop(gfp);
+#endif
+      desalloc_buffer(&gfc->bs);    /* Deallocate all buffers */
       return -1;
     }
     mp3buffer += imp3;
     mp3count += imp3;
-    mf_samples_to_encode -= gfp->framesize;
+    gfc->mf_samples_to_encode -= gfp->framesize;
   }
 
+#ifdef HAVE_PTHREAD
+  if (gfc->pipe) {
+    /* collect the frames still in the pipe */
+    mp3buffer_size_remaining = mp3buffer_size - mp3count;
+    if (mp3buffer_size == 0) mp3buffer_size_remaining=0;  
+    imp3=lame_pipeline_collect(gfp,mp3buffer,mp3buffer_size_remaining,0);
+    lame_pipeline_stop(gfp);
+    if (imp3 == -1) {
+      desalloc_buffer(&gfc->bs);    /* Deallocate all buffers */
+      return -1;
+    }
+    mp3buffer += imp3;
+    mp3count += imp3;
+  }
+#endif
+
 
   gfp->frameNum--;
   if (!gfp->gtkflag && !gfp->silent) {
@@ -1381,47 +1714,465 @@ int lame_encode_finish(lame_global_flags *gfp,char *mp3buffer, int mp3buffer_siz
   }
 
 
-  III_FlushBitstream();
+  III_FlushBitstream(gfp);
   mp3buffer_size_remaining = mp3buffer_size - mp3count;
   /* if user specifed buffer size = 0, dont check size */
   if (mp3buffer_size == 0) mp3buffer_size_remaining=0;  
 
-  imp3= copy_buffer(mp3buffer,mp3buffer_size_remaining,&bs);
+  imp3= copy_buffer(mp3buffer,mp3buffer_size_remaining,&gfc->bs);
   if (imp3 == -1) {
     /* fatel error: mp3buffer too small */
-    desalloc_buffer(&bs);    /* Deallocate all buffers */
+    desalloc_buffer(&gfc->bs);    /* Deallocate all buffers */
     return -1;
   }
 
   mp3count += imp3;
-  desalloc_buffer(&bs);    /* Deallocate all buffers */
+  desalloc_buffer(&gfc->bs);    /* Deallocate all buffers */
   return mp3count;
 }
 
 
+#ifdef HAVE_PTHREAD
+/********************************************************************
+ *   segment-parallel encoding (gfp->threads > 1)
+ *
+ *   The input is cut at frame boundaries into segments of
+ *   LAME_SEGMENT_FRAMES frames.  Each segment gets an encoder instance
+ *   of its own and is encoded on one of gfp->threads worker threads.
+ *
+ *   - A segment's encoder starts LAME_SEGMENT_PRIME frames early, so
+ *     that the polyphase filterbank, the MDCT overlap and the psy model
+ *     history have seen the real signal.  It is also fed one frame past
+ *     the end of the segment, for the psy model lookahead.
+ *   - The priming frames are encoded without bit reservoir, and the last
+ *     frame of a segment leaves it empty (ResvFrameBegin).  So no frame
+ *     refers to main data of another encoder.
+ *   - The priming frames are cut off, and the segments are written in
+ *     order.  Every encoder works on the same frame grid as the serial
+ *     encoder, so the result is one gapless stream with the same
+ *     number of frames.  It is not bit identical to the serial
+ *     encoding: the reservoir is emptied at every segment boundary.
+ ********************************************************************/
+#define LAME_SEGMENT_FRAMES 400
+#define LAME_SEGMENT_PRIME 2
+
+typedef struct lame_segment {
+  struct lame_segment *next;    /* work queue */
+  int prime;                    /* frames encoded only to prime the encoder */
+  int frames;                   /* frames to keep, 0 = to the end of the input */
+  int nsamples;                 /* per channel, priming and lookahead included */
+  short int *pcm[2];
+  char *mp3buf;                 /* the kept frames, set by the worker */
+  int mp3size;
+  int nframes;
+  int *framepos;                /* bytes of mp3buf written after each kept frame */
+  int error;
+  int done;
+} lame_segment;
+
+struct lame_segment_pool {
+  lame_global_flags settings;   /* copy of *gfp taken before the workers
+                                   start, read only.  The main thread keeps
+                                   updating *gfp (frameNum, totalframes) */
+  pthread_mutex_t lock;
+  pthread_cond_t work;          /* a segment was queued, or quit was set */
+  pthread_cond_t done;          /* a segment was encoded */
+  lame_segment *head, *tail;    /* segments not yet started */
+  int quit;
+};
+
+
+static lame_segment *lame_segment_new(int framesize)
+{
+  lame_segment *s;
+  int len = (LAME_SEGMENT_PRIME+LAME_SEGMENT_FRAMES+1)*framesize;
+
+  s = (lame_segment *) calloc(1,sizeof(lame_segment));
+  if (s == NULL) return NULL;
+  s->pcm[0] = (short int *) malloc(2*len*sizeof(short int));
+  if (s->pcm[0] == NULL) {
+    free(s);
+    return NULL;
+  }
+  s->pcm[1] = s->pcm[0] + len;
+  return s;
+}
+
+static void lame_segment_free(lame_segment *s)
+{
+  free(s->pcm[0]);
+  free(s->mp3buf);
+  free(s->framepos);
+  free(s);
+}
+
+
+/* encode one segment on a fresh encoder with the settings in *settings,
+ * and keep the frames after the priming frames */
+static void lame_segment_encode(const lame_global_flags *settings,lame_segment *s)
+{
+  lame_global_flags gf;
+  lame_internal_flags *gfc;
+  int i,n,ret=0,mp3max,mp3size=0,start,last;
+
+  gf = *settings;
+  gfc = gf.internal_flags = lame_new_internal_flags();
+  if (gfc==NULL) {
+    s->error = 1;
+    return;
+  }
+  lame_init_stream(&gf);
+  gf.frameNum = 0;
+  gf.silent = 1;
+  gf.pipeline = 0;
+  /* there is no Xing frame, but AddVbrFrame() records where each
+   * frame ends, which is what we need to cut the stream */
+  gf.bWriteVbrTag = 1;
+  gfc->ResvPrimeFrames = s->prime;
+  if (s->frames) gfc->ResvEndFrame = s->prime+s->frames-1;
+
+  mp3max = 5*s->nsamples/4 + 7200;   /* see lame_encode_buffer() */
+  s->mp3buf = (char *) malloc(mp3max);
+  if (s->mp3buf == NULL) ret = -1;
+
+  /* lame_encode_buffer() sets up the encoder delay padding on its
+   * first call, which an empty input would otherwise never make */
+  if (s->nsamples == 0 && ret != -1)
+    ret = lame_encode_buffer(&gf,s->pcm[0],s->pcm[1],0,s->mp3buf,mp3max);
+
+  for (i=0; i<s->nsamples && ret != -1; i+=n) {
+    if (s->frames && gf.frameNum == s->prime+s->frames) break;
+    n = Min(gf.framesize,s->nsamples-i);
+    ret = lame_encode_buffer(&gf,s->pcm[0]+i,s->pcm[1]+i,n,
+			     s->mp3buf+mp3size,mp3max-mp3size);
+    if (ret != -1) mp3size += ret;
+  }
+  if (s->frames == 0 && ret != -1) {
+    ret = lame_encode_finish(&gf,s->mp3buf+mp3size,mp3max-mp3size);
+    if (ret != -1) mp3size += ret;
+  } else {
+    /* the reservoir is empty, so the last frame is complete */
+    desalloc_buffer(&gfc->bs);
+    if (gf.frameNum != s->prime+s->frames) ret = -1;
+  }
+  if (ret == -1) {
+    s->error = 1;
+    lame_close(&gf);
+    return;
+  }
+
+  /* pVbrFrames[j] = bytes written once frame j was encoded.  The priming
+   * frames had no reservoir, so pVbrFrames[prime-1] is a frame boundary.
+   * Later entries lag the frame boundaries by what is still queued in the
+   * reservoir; they are only used for the Xing TOC, as in the serial case.
+   * lame_encode_finish() pads out the queued frames, so the last segment
+   * may end after pVbrFrames[last]. */
+  last = gfc->nVbrNumFrames-1;
+  start = s->prime ? gfc->pVbrFrames[s->prime-1] : 0;
+  s->nframes = gfc->nVbrNumFrames-s->prime;
+  s->framepos = (int *) malloc((s->nframes+1)*sizeof(int));
+  if (s->framepos == NULL || s->nframes <= 0 ||
+      gfc->pVbrFrames[last] > mp3size ||
+      (s->frames && gfc->pVbrFrames[last] != mp3size)) {
+    s->error = 1;
+    lame_close(&gf);
+    return;
+  }
+  for (i=0; i<s->nframes; i++)
+    s->framepos[i] = gfc->pVbrFrames[s->prime+i]-start;
+  memmove(s->mp3buf,s->mp3buf+start,mp3size-start);
+  s->mp3size = mp3size-start;
+  lame_close(&gf);
+}
+
+
+static void *lame_segment_worker(void *arg)
+{
+  struct lame_segment_pool *p = arg;
+  lame_segment *s;
+
+  pthread_mutex_lock(&p->lock);
+  for (;;) {
+    while (p->head==NULL && !p->quit)
+      pthread_cond_wait(&p->work,&p->lock);
+    if (p->head==NULL) break;
+    s = p->head;
+    p->head = s->next;
+    pthread_mutex_unlock(&p->lock);
+
+    lame_segment_encode(&p->settings,s);
+
+    pthread_mutex_lock(&p->lock);
+    s->done = 1;
+    pthread_cond_broadcast(&p->done);
+  }
+  pthread_mutex_unlock(&p->lock);
+  return NULL;
+}
+
+
+static void lame_segment_submit(struct lame_segment_pool *p,lame_segment *s)
+{
+  pthread_mutex_lock(&p->lock);
+  s->next = NULL;
+  if (p->head==NULL) p->head = s;
+  else p->tail->next = s;
+  p->tail = s;
+  pthread_cond_signal(&p->work);
+  pthread_mutex_unlock(&p->lock);
+}
+
+
+static void lame_segment_wait(struct lame_segment_pool *p,lame_segment *s)
+{
+  pthread_mutex_lock(&p->lock);
+  while (!s->done)
+    pthread_cond_wait(&p->done,&p->lock);
+  pthread_mutex_unlock(&p->lock);
+}
+
+
+/* append the frames of an encoded segment to outf and to the stream
+ * state of *gfp (Xing frame list, bitrate histogram, status).
+ * return code = -1 if it could not be encoded or written */
+static int lame_segment_write(lame_global_flags *gfp,lame_segment *s,FILE *outf)
+{
+  lame_internal_flags *gfc=gfp->internal_flags;
+  int i,pos;
+
+  if (s->error) return -1;
+  if (fwrite(s->mp3buf,1,s->mp3size,outf) != (size_t) s->mp3size) return -1;
+
+  for (i=0,pos=0; i<s->nframes; pos=s->framepos[i++]) {
+    gfc->sentBits += 8*(s->framepos[i]-pos);
+    if (gfp->bWriteVbrTag) AddVbrFrame(gfp,(int)(gfc->sentBits/8));
+  }
+  gfp->frameNum += s->nframes;
+
+#ifdef BRHIST
+  if (disp_brhist) {
+    /* the frames are contiguous, walk their headers for the bitrates */
+    unsigned char *h;
+    int idx;
+    for (pos=0; pos+2 < s->mp3size; ) {
+      h = (unsigned char *) s->mp3buf+pos;
+      idx = (h[2] >> 4) & 15;
+      if (idx == 0 || idx == 15) break;
+      brhist_temp[idx]++;
+      pos += 72*gfp->mode_gr*bitrate_table[gfp->version][idx]*1000
+	/ gfp->out_samplerate + ((h[2] >> 1) & 1);
+    }
+  }
+#endif
+
+  if (!gfp->silent) {
+    timestatus(gfp->out_samplerate,gfp->frameNum,gfp->totalframes,gfp->framesize);
+#ifdef BRHIST
+    if (disp_brhist)
+      {
+	brhist_add_count();
+	brhist_disp();
+      }
+#endif
+  }
+  return 0;
+}
+#endif
+
+
+
+/*****************************************************************/
+/* read the whole input file (lame_readframe) and encode it on   */
+/* gfp->threads threads.  Takes the place of lame_encode_buffer()*/
+/* and lame_encode_finish() calls, see lame.h                    */
+/*****************************************************************/
+int lame_encode_segments(lame_global_flags *gfp,FILE *outf)
+{
+#ifdef HAVE_PTHREAD
+  lame_internal_flags *gfc=gfp->internal_flags;
+  struct lame_segment_pool pool;
+  pthread_t *thread;
+  lame_segment **inflight, *cur=NULL;
+  short int Buffer[2][1152];
+  short int hist[2][LAME_SEGMENT_PRIME*1152];   /* the last frames read */
+  char mp3buffer[LAME_MAXMP3BUFFER];
+  int nthreads,maxinflight,first=0,ninflight=0;
+  int iread,ch,n,framesize=gfp->framesize,error=0;
+  long nread=0;
+
+  if (gfc->pipe) lame_pipeline_stop(gfp);
+
+  /* the empty Xing frame from lame_init_params() */
+  n = copy_buffer(mp3buffer,(int)sizeof(mp3buffer),&gfc->bs);
+  desalloc_buffer(&gfc->bs);
+  if (n == -1 || fwrite(mp3buffer,1,n,outf) != (size_t) n) return -1;
+  gfc->sentBits += 8*n;   /* the serial encoder counts it in frame 0 */
+
+  nthreads = gfp->threads;
+  maxinflight = 2*nthreads;
+  thread = (pthread_t *) malloc(nthreads*sizeof(pthread_t));
+  inflight = (lame_segment **) malloc(maxinflight*sizeof(lame_segment *));
+  if (thread==NULL || inflight==NULL) {
+    free(thread);
+    free(inflight);
+    return -1;
+  }
+  pool.settings = *gfp;
+  pool.head = pool.tail = NULL;
+  pool.quit = 0;
+  pthread_mutex_init(&pool.lock,NULL);
+  pthread_cond_init(&pool.work,NULL);
+  pthread_cond_init(&pool.done,NULL);
+  for (n=0; n<nthreads; n++)
+    if (pthread_create(&thread[n],NULL,lame_segment_worker,&pool)) break;
+  nthreads = n;
+  if (nthreads == 0) error = 1;
+
+  gfp->frameNum = 0;
+  do {
+    /* get_audio() and the status display go by frameNum, keep it
+     * where the serial encoder would have it */
+    gfp->frameNum = Max(0,nread-1);
+    iread = error ? 0 : lame_readframe(gfp,Buffer);
+
+    if (iread && cur &&
+	cur->nsamples == (cur->prime+LAME_SEGMENT_FRAMES)*framesize) {
+      /* the first frame of the next segment is the lookahead of this one */
+      for (ch=0; ch<2; ch++)
+	memcpy(cur->pcm[ch]+cur->nsamples,Buffer[ch],iread*sizeof(short int));
+      cur->nsamples += iread;
+      cur->frames = LAME_SEGMENT_FRAMES;
+      lame_segment_submit(&pool,cur);
+      inflight[(first+ninflight++) % maxinflight] = cur;
+      cur = NULL;
+    }
+
+    if (cur == NULL && !error) {
+      /* write the oldest segment if there is no room for one more */
+      if (ninflight == maxinflight) {
+	lame_segment_wait(&pool,inflight[first]);
+	if (lame_segment_write(gfp,inflight[first],outf)) error = 1;
+	lame_segment_free(inflight[first]);
+	first = (first+1) % maxinflight;
+	ninflight--;
+      }
+      cur = lame_segment_new(framesize);
+      if (cur == NULL) {
+	error = 1;
+      } else if (nread) {
+	/* prime with the last frames of the previous segment */
+	cur->prime = LAME_SEGMENT_PRIME;
+	cur->nsamples = LAME_SEGMENT_PRIME*framesize;
+	for (ch=0; ch<2; ch++)
+	  memcpy(cur->pcm[ch],hist[ch],cur->nsamples*sizeof(short int));
+      }
+    }
+
+    if (iread && cur) {
+      for (ch=0; ch<2; ch++) {
+	memcpy(cur->pcm[ch]+cur->nsamples,Buffer[ch],iread*sizeof(short int));
+	memmove(hist[ch],hist[ch]+framesize,
+		(LAME_SEGMENT_PRIME-1)*framesize*sizeof(short int));
+	memcpy(hist[ch]+(LAME_SEGMENT_PRIME-1)*framesize,Buffer[ch],
+	       framesize*sizeof(short int));
+      }
+      cur->nsamples += iread;
+    }
+    nread++;
+  } while (iread);
+
+  if (cur && !error) {
+    /* the last segment also encodes the padding after the input */
+    cur->frames = 0;
+    lame_segment_submit(&pool,cur);
+    inflight[(first+ninflight++) % maxinflight] = cur;
+  } else if (cur) {
+    lame_segment_free(cur);
+  }
+  while (ninflight) {
+    lame_segment_wait(&pool,inflight[first]);
+    if (!error && lame_segment_write(gfp,inflight[first],outf)) error = 1;
+    lame_segment_free(inflight[first]);
+    first = (first+1) % maxinflight;
+    ninflight--;
+  }
+
+  pthread_mutex_lock(&pool.lock);
+  pool.quit = 1;
+  pthread_cond_broadcast(&pool.work);
+  pthread_mutex_unlock(&pool.lock);
+  for (n=0; n<nthreads; n++)
+    pthread_join(thread[n],NULL);
+  pthread_cond_destroy(&pool.done);
+  pthread_cond_destroy(&pool.work);
+  pthread_mutex_destroy(&pool.lock);
+  free(thread);
+  free(inflight);
+
+  gfp->frameNum--;
+  if (!gfp->gtkflag && !gfp->silent) {
+      timestatus(gfp->out_samplerate,gfp->frameNum,gfp->totalframes,gfp->framesize);
+#ifdef BRHIST
+      if (disp_brhist)
+	{
+	  brhist_add_count();
+	  brhist_disp();
+	  brhist_disp_total(gfp);
+	}
+#endif
+      fprintf(stderr,"\n");
+      fflush(stderr);
+  }
+  return error ? -1 : 0;
+#else
+  return -1;
+#endif
+}
+
+
+
 /*****************************************************************/
 /* write VBR Xing header, and ID3 tag, if asked for               */
 /*****************************************************************/
 void lame_mp3_tags(lame_global_flags *gfp)
 {
+  lame_internal_flags *gfc=gfp->internal_flags;
   if (gfp->bWriteVbrTag)
     {
       /* Calculate relative quality of VBR stream
        * 0=best, 100=worst */
       int nQuality=gfp->VBR_q*100/9;
       /* Write Xing header again */
-      PutVbrTag(gfp->outPath,nQuality,1-gfp->version);
+      PutVbrTag(gfp,gfp->outPath,nQuality,1-gfp->version);
     }
 
 
   /* write an ID3 tag  */
-  if(id3tag.used) {
-    id3_buildtag(&id3tag);
-    id3_writetag(gfp->outPath, &id3tag);
+  if(gfc->id3tag.used) {
+    id3_buildtag(&gfc->id3tag);
+    id3_writetag(gfp->outPath, &gfc->id3tag);
   }
 }
 
 
+/*****************************************************************/
+/* free the per-stream encoder state allocated by lame_init()    */
+/*****************************************************************/
+void lame_close(lame_global_flags *gfp)
+{
+  lame_internal_flags *gfc=gfp->internal_flags;
+  if (gfc==NULL) return;
+
+#ifdef HAVE_PTHREAD
+  if (gfc->pipe) lame_pipeline_stop(gfp);
+#endif
+  III_FreeBitstream(gfp);
+  free(gfc->pVbrFrames);
+  free(gfc);
+  gfp->internal_flags=NULL;
+}
+
+
 void lame_version(lame_global_flags *gfp,char *ostring) {
   strncpy(ostring,get_lame_version(),20);
 }
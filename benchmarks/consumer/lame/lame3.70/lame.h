@@ -57,6 +57,8 @@ typedef struct  {
   int bWriteVbrTag;           /* add Xing VBR tag?         */
   int quality;                /* quality setting 0=best,  9=worst  */
   int silent;                 /* disable some status output */
+  int pipeline;               /* quantize on a second thread? (HAVE_PTHREAD) */
+  int threads;                /* >1: lame_encode_segments() on this many threads */
   int mode;                       /* 0,1,2,3 stereo,jstereo,dual channel,mono */
   int mode_fixed;                 /* use specified the mode, do not use lame's opinion of the best mode */
   int force_ms;                   /* force M/S mode.  requires mode=1 */
@@ -152,9 +154,12 @@ typedef struct  {
                                2 = stop when all scalefacs amplified 
 			    */
 
-  int psymodel;             /* 0 = none   1=gpsycho */
+  int psymodel;             /* 0 = none   1=gpsycho  2=gpsycho, fast log/exp */
   int use_best_huffman;     /* 0 = no.  1=outside loop  2=inside loop(slow) */
 
+  /* per-stream encoder state (psy model, bit reservoir, bitstream...).
+   * allocated by lame_init(), freed by lame_close() */
+  struct lame_internal_flags *internal_flags;
 
 } lame_global_flags;
 
@@ -172,6 +177,12 @@ The LAME API
 
 /* REQUIRED: initialize the encoder.  sets default for all encoder paramters,
  * returns pointer to encoder parameters listed above 
+ *
+ * all encoder state is kept in the lame_global_flags struct, so any number
+ * of encodes can run in the same process, each from its own thread, as long
+ * as every thread uses its own lame_global_flags.  Only the frontend
+ * helpers (lame_parse_args, lame_readframe, the status display and the
+ * mpglib decoder) are not reentrant: set gf.silent for concurrent encodes.
  */
 void lame_init(lame_global_flags *);
 
@@ -273,12 +284,30 @@ int lame_encode(lame_global_flags *,short int Buffer[2][1152],char *mp3buffer,in
 
 /* REQUIRED:  lame_encode_finish will flush the buffers and may return a 
  * final few mp3 frames.  mp3buffer should be at least 7200 bytes.
+ * With gf.pipeline set, each frame's mp3 data is returned a call or two
+ * after its pcm was passed in, and lame_encode_finish returns the
+ * frames still in the pipeline as well.
  *
  * return code = number of bytes output to mp3buffer.  can be 0
  */
 int lame_encode_finish(lame_global_flags *,char *mp3buffer, int size);
 
 
+/* OPTIONAL: encode the whole input file opened by lame_init_infile()
+ * and write it to outf, in place of the lame_readframe(),
+ * lame_encode_buffer() and lame_encode_finish() calls.  The input is
+ * cut into segments of a few hundred frames, which are encoded on
+ * gf.threads threads and joined into one gapless mp3 stream.  The bit
+ * reservoir is emptied at each segment boundary, so the output is not
+ * bit identical to the serial encoding.
+ * lame_init_params() sets gf.threads=1 if the encoding cannot be
+ * segmented (no HAVE_PTHREAD, resampling, frame analyzer).
+ *
+ * return code = 0, or -1 if the mp3 data could not be encoded or written
+ */
+int lame_encode_segments(lame_global_flags *,FILE *outf);
+
+
 /* OPTIONAL:  lame_mp3_tags will append id3 and Xing VBR tags to
 the mp3 file with name given by gf->outPath.  These calls open the file,
 write tags, and close the file, so make sure the the encoding is finished
@@ -289,6 +318,12 @@ by LAME because the output is not a regular file, this call does nothing
 void lame_mp3_tags(lame_global_flags *);
 
 
+/* REQUIRED:  free the encoder state allocated by lame_init().  Call it
+ * after lame_mp3_tags() (or lame_encode_finish() if no tags are written).
+ */
+void lame_close(lame_global_flags *);
+
+
 
 
 /*********************************************************************
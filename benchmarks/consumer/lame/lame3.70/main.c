@@ -105,6 +105,14 @@ int main(int argc, char **argv)
   if (gf.gtkflag) gtkcontrol(&gf);
   else
 #endif
+  if (gf.threads > 1) {
+      /* read and encode the whole file on several threads */
+      if (lame_encode_segments(&gf,outf) == -1) {
+	fprintf(stderr,"Error encoding or writing mp3 output\n");
+	exit(1);
+      }
+    }
+  else
     {
 
       /* encode until we hit eof */
@@ -130,11 +138,14 @@ int main(int argc, char **argv)
       } while (iread);
     }
 
-  imp3=lame_encode_finish(&gf,mp3buffer,(int)sizeof(mp3buffer));   /* may return one more mp3 frame */
-  fwrite(mp3buffer,1,imp3,outf);
+  if (gf.threads <= 1) {
+    imp3=lame_encode_finish(&gf,mp3buffer,(int)sizeof(mp3buffer));   /* may return one more mp3 frame */
+    fwrite(mp3buffer,1,imp3,outf);
+  }
   fclose(outf);
   lame_close_infile(&gf);            /* close the input file */
   lame_mp3_tags(&gf);                /* add id3 or VBR tags to mp3 file */
+  lame_close(&gf);                   /* free the encoder state */
   return 0;
 }
 
@@ -166,6 +166,7 @@ int main(int argc, char **argv)
   fclose(outf);
   lame_close_infile(&gf);             /* close the sound input file */
   lame_mp3_tags(&gf);                /* add id3 or VBR tags to mp3 file */
+  lame_close(&gf);                   /* free the encoder state */
   return 0;
 }
 
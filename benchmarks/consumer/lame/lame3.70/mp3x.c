@@ -34,6 +34,7 @@ int main(int argc, char **argv)
 
   lame_encode_finish(&gf,mp3buffer,sizeof(mp3buffer));
   lame_close_infile(&gf);
+  lame_close(&gf);
   return 0;
 }
 
@@ -115,7 +115,6 @@ static FLOAT8 enwindow[] =
    4.756451e-03,   2.1458e-05,  -6.9618e-05,    2.384e-06
 };
 
-static FLOAT8 sb_sample[2][2][18][SBLIMIT];
 static FLOAT8 mm[16][SBLIMIT - 1];
 
 #define NS 12
@@ -127,8 +126,6 @@ static FLOAT8 cos_s[NS / 2][NS / 2];
 static FLOAT8 cos_l[(NL / 2) * 12 + (NL / 6) * 4 + (NL / 18) * 2];
 static FLOAT8 win[4][36];
 
-#define work (&win[2][4])
-
 /************************************************************************
 *
 * window_subband()
@@ -329,15 +326,11 @@ void mdct_sub48(lame_global_flags *gfp,
     FLOAT8 mdct_freq[2][2][576],
     III_side_info_t *l3_side)
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
+    FLOAT8 (*sb_sample)[2][18][SBLIMIT] = gfc->sb_sample;
+    FLOAT8 work[31];  /* window_subband() output, then mdct input */
     int gr, k, ch;
     short *wk;
-    static int init = 0;
-
-    if ( init == 0 ) {
-        void mdct_init48(void);
-	mdct_init48();
-	init++;
-    }
 
     wk = w0;
     /* thinking cache performance, ch->gr loop is better than gr->ch loop */
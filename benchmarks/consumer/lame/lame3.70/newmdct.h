@@ -3,4 +3,5 @@
 void mdct_sub48(lame_global_flags *gfp,short *w0, short *w1,
 	      FLOAT8 mdct_freq[2][2][576],
 	      III_side_info_t *l3_side);
+void mdct_init48(void);
 #endif
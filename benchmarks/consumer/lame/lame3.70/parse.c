@@ -71,6 +71,8 @@ void lame_help(lame_global_flags *gfp,char *name)  /* print syntax & exit */
   fprintf(stdout,"    -a              downmix from stereo to mono file for mono encoding\n");
   fprintf(stdout,"    -d              allow channels to have different blocktypes\n");
   fprintf(stdout,"    -S              don't print progress report, VBR histograms\n");
+  fprintf(stdout,"    --pipeline      quantize on a second thread (2 CPUs)\n");
+  fprintf(stdout,"    --threads n     encode segments of the input on n threads\n");
   fprintf(stdout,"    --athonly       only use the ATH for masking\n");
   fprintf(stdout,"    --noath         disable the ATH for masking\n");
   fprintf(stdout,"    --noshort       do not use short blocks\n");
@@ -229,6 +231,7 @@ void lame_presets_info(lame_global_flags *gfp,char *name)  /* print syntax & exi
 ************************************************************************/
 void lame_parse_args(lame_global_flags *gfp,int argc, char **argv)
 {
+  lame_internal_flags *gfc=gfp->internal_flags;
   FLOAT srate;
   int   err = 0, i = 0;
   int autoconvert=0;
@@ -242,8 +245,8 @@ void lame_parse_args(lame_global_flags *gfp,int argc, char **argv)
   gfp->inPath=inPath;
   gfp->outPath=outPath;
 
-  id3_inittag(&id3tag);
-  id3tag.used = 0;
+  id3_inittag(&gfc->id3tag);
+  gfc->id3tag.used = 0;
 
   /* process args */
   while(++i<argc && err == 0) {
@@ -292,6 +295,17 @@ void lame_parse_args(lame_global_flags *gfp,int argc, char **argv)
 	  gfp->disable_reservoir=1;
 	  gfp->padding=0;
 	}
+	else if (strcmp(token, "pipeline")==0) {
+	  gfp->pipeline=1;
+	}
+	else if (strcmp(token, "threads")==0) {
+	  argUsed=1;
+	  gfp->threads = atoi(nextArg);
+	  if (gfp->threads < 1) {
+	    fprintf(stderr,"Must specify a number of threads with --threads\n");
+	    exit(1);
+	  }
+	}
 	else if (strcmp(token, "athonly")==0) {
 	  gfp->ATHonly=1;
 	}
@@ -302,31 +316,31 @@ void lame_parse_args(lame_global_flags *gfp,int argc, char **argv)
 	}
 	/* options for ID3 tag */
  	else if (strcmp(token, "tt")==0) {
- 		id3tag.used=1;      argUsed = 1;
-  		strncpy(id3tag.title, nextArg, 30);
+ 		gfc->id3tag.used=1;      argUsed = 1;
+  		strncpy(gfc->id3tag.title, nextArg, 30);
  		}
  	else if (strcmp(token, "ta")==0) {
- 		id3tag.used=1; argUsed = 1;
-  		strncpy(id3tag.artist, nextArg, 30);
+ 		gfc->id3tag.used=1; argUsed = 1;
+  		strncpy(gfc->id3tag.artist, nextArg, 30);
  		}
  	else if (strcmp(token, "tl")==0) {
- 		id3tag.used=1; argUsed = 1;
-  		strncpy(id3tag.album, nextArg, 30);
+ 		gfc->id3tag.used=1; argUsed = 1;
+  		strncpy(gfc->id3tag.album, nextArg, 30);
  		}
  	else if (strcmp(token, "ty")==0) {
- 		id3tag.used=1; argUsed = 1;
-  		strncpy(id3tag.year, nextArg, 4);
+ 		gfc->id3tag.used=1; argUsed = 1;
+  		strncpy(gfc->id3tag.year, nextArg, 4);
  		}
  	else if (strcmp(token, "tc")==0) {
- 		id3tag.used=1; argUsed = 1;
-  		strncpy(id3tag.comment, nextArg, 30);
+ 		gfc->id3tag.used=1; argUsed = 1;
+  		strncpy(gfc->id3tag.comment, nextArg, 30);
  		}
  	else if (strcmp(token, "tn")==0) {
- 		id3tag.used=1; argUsed = 1;
+ 		gfc->id3tag.used=1; argUsed = 1;
   		track = atoi(nextArg);
   		if (track < 1) { track = 1; }
   		if (track > 99) { track = 99; }
-  		id3tag.track = track;
+  		gfc->id3tag.track = track;
  		}
  	else if (strcmp(token, "tg")==0) {
 		argUsed = strtol (nextArg, &token, 10);
@@ -342,8 +356,8 @@ void lame_parse_args(lame_global_flags *gfp,int argc, char **argv)
 		}
 	        argUsed &= 255; c=(char)(argUsed);
 
- 		id3tag.used=1; argUsed = 1;
-  		strncpy(id3tag.genre, &c, 1);
+ 		gfc->id3tag.used=1; argUsed = 1;
+  		strncpy(gfc->id3tag.genre, &c, 1);
 	       }
 	else if (strcmp(token, "lowpass")==0) {
 	  argUsed=1;
@@ -691,8 +705,8 @@ void lame_parse_args(lame_global_flags *gfp,int argc, char **argv)
   /* some file options not allowed with stdout */
   if (outPath[0]=='-') {
     gfp->bWriteVbrTag=0; /* turn off VBR tag */
-    if (id3tag.used) {
-      id3tag.used=0;         /* turn of id3 tagging */
+    if (gfc->id3tag.used) {
+      gfc->id3tag.used=0;         /* turn of id3 tagging */
       fprintf(stderr,"id3tag ignored: id3 tagging not supported for stdout.\n");
     }
   }
@@ -19,6 +19,9 @@
 #endif
 #include "tables.h"
 #include "fft.h"
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
 
 #ifdef M_LN10
 #define		LN_TO_LOG10		(M_LN10/10)
@@ -27,6 +30,52 @@
 #endif
 
 
+/* log2() and exp2() with a bounded error, used instead of log(), exp()
+ * and log10() when gfp->psymodel==2.
+ *   fast_log2: exponent bits plus linear interpolation in a table of
+ *              log2(mantissa), absolute error < 1e-6
+ *   fast_exp2: 2^n from the exponent bits times a 5th order polynomial
+ *              for 2^f, |f|<=.5, relative error < 4e-6
+ * Arguments are rounded to single precision, and must be positive
+ * normal numbers (fast_log2) or between -126 and 127 (fast_exp2). */
+#define LOG2_SIZE_BITS 9
+#define LOG2_SIZE (1<<LOG2_SIZE_BITS)
+static FLOAT log2_table[LOG2_SIZE+1];
+
+void L3psycho_init_tables(void)
+{
+  int j;
+  for (j = 0; j <= LOG2_SIZE; j++)
+    log2_table[j] = log(1.0 + (FLOAT8) j / LOG2_SIZE) / LOG2;
+}
+
+static INLINE FLOAT8 fast_log2(FLOAT8 x)
+{
+  union { float f; int i; } fi;
+  int e, j, m;
+
+  fi.f = x;
+  e = ((fi.i >> 23) & 0xff) - 127;
+  m = fi.i & 0x7fffff;
+  j = m >> (23 - LOG2_SIZE_BITS);
+  m &= (1 << (23 - LOG2_SIZE_BITS)) - 1;
+  return (FLOAT8) e + log2_table[j] + (log2_table[j+1] - log2_table[j])
+    * (FLOAT8) m * (1.0 / (1 << (23 - LOG2_SIZE_BITS)));
+}
+
+static INLINE FLOAT8 fast_exp2(FLOAT8 x)
+{
+  union { float f; int i; } fi;
+  int n;
+  FLOAT8 f;
+
+  n = (int) (x + 128.5) - 128;       /* round to nearest */
+  f = (x - n) * LOG2;
+  fi.i = (n + 127) << 23;
+  return fi.f * (1 + f*(1 + f*(1.0/2 + f*(1.0/6 + f*(1.0/24 + f*(1.0/120))))));
+}
+
+
 void L3para_read( FLOAT8 sfreq, int numlines[CBANDS],int numlines_s[CBANDS], int partition_l[HBLKSIZE],
 		  FLOAT8 minval[CBANDS], FLOAT8 qthr_l[CBANDS], 
 		  FLOAT8 s3_l[CBANDS + 1][CBANDS + 1],
@@ -62,79 +111,81 @@ void L3psycho_anal( lame_global_flags *gfp,
  * the sequence, in which the variables are used
  */
   
-/* The static variables "r", "phi_sav", "new", "old" and "oldest" have    */
+/* The variables "r", "phi_sav", "new", "old" and "oldest" have          */
 /* to be remembered for the unpredictability measure.  For "r" and        */
 /* "phi_sav", the first index from the left is the channel select and     */
 /* the second index is the "age" of the data.                             */
-  static FLOAT8	minval[CBANDS],qthr_l[CBANDS];
-  static FLOAT8	qthr_s[CBANDS];
-  static FLOAT8	nb_1[4][CBANDS], nb_2[4][CBANDS];
-  static FLOAT8 s3_s[CBANDS + 1][CBANDS + 1];
-  static FLOAT8 s3_l[CBANDS + 1][CBANDS + 1];
-
-  static III_psy_xmin thm[4];
-  static III_psy_xmin en[4];
+/* Everything which must survive from one granule to the next lives in    */
+/* gfp->internal_flags, the pointers below just give it the old names.    */
+  lame_internal_flags *gfc=gfp->internal_flags;
+  FLOAT8 *minval = gfc->minval, *qthr_l = gfc->qthr_l;
+  FLOAT8 *qthr_s = gfc->qthr_s;
+  FLOAT8 (*nb_1)[CBANDS] = gfc->nb_1, (*nb_2)[CBANDS] = gfc->nb_2;
+  FLOAT8 (*s3_s)[CBANDS + 1] = gfc->s3_s;
+  FLOAT8 (*s3_l)[CBANDS + 1] = gfc->s3_l;
+
+  III_psy_xmin *thm = gfc->thm;
+  III_psy_xmin *en = gfc->en;
   
   /* unpredictability calculation
    */
-  static int cw_upper_index;
-  static int cw_lower_index;
-  static FLOAT ax_sav[4][2][HBLKSIZE];
-  static FLOAT bx_sav[4][2][HBLKSIZE];
-  static FLOAT rx_sav[4][2][HBLKSIZE];
-  static FLOAT cw[HBLKSIZE];
+  FLOAT (*ax_sav)[2][HBLKSIZE] = gfc->ax_sav;
+  FLOAT (*bx_sav)[2][HBLKSIZE] = gfc->bx_sav;
+  FLOAT (*rx_sav)[2][HBLKSIZE] = gfc->rx_sav;
+  FLOAT *cw = gfc->cw;
 
   /* fft and energy calculation
    */
   FLOAT (*wsamp_l)[BLKSIZE];
   FLOAT (*wsamp_s)[3][BLKSIZE_s];
   FLOAT tot_ener[4];
-  static FLOAT wsamp_L[2][BLKSIZE];
-  static FLOAT energy[HBLKSIZE];
-  static FLOAT wsamp_S[2][3][BLKSIZE_s];
-  static FLOAT energy_s[3][HBLKSIZE_s];
+  FLOAT wsamp_L[2][BLKSIZE];
+  FLOAT energy[HBLKSIZE];
+  FLOAT wsamp_S[2][3][BLKSIZE_s];
+  FLOAT energy_s[3][HBLKSIZE_s];
 
   /* convolution
    */
-  static FLOAT8 eb[CBANDS];
-  static FLOAT8 cb[CBANDS];
-  static FLOAT8 thr[CBANDS];
+  FLOAT8 eb[CBANDS];
+  FLOAT8 cb[CBANDS];
+  FLOAT8 thr[CBANDS];
+#if defined(__SSE2__)
+  FLOAT8 ebcb[CBANDS][2];           /* eb and cb, side by side */
+#endif
+  FLOAT8 eb_s[CBANDS][4];           /* [partition][sblock], 4th is 0 */
+  FLOAT8 thr_s[CBANDS][4];
   
   /* Scale Factor Bands
    */
-  static FLOAT8	w1_l[SBPSY_l], w2_l[SBPSY_l];
-  static FLOAT8	w1_s[SBPSY_s], w2_s[SBPSY_s];
-  static FLOAT8 mld_l[SBPSY_l],mld_s[SBPSY_s];
-  static int	bu_l[SBPSY_l],bo_l[SBPSY_l] ;
-  static int	bu_s[SBPSY_s],bo_s[SBPSY_s] ;
-  static int	npart_l,npart_s;
-  static int	npart_l_orig,npart_s_orig;
+  FLOAT8 *w1_l = gfc->w1_l, *w2_l = gfc->w2_l;
+  FLOAT8 *w1_s = gfc->w1_s, *w2_s = gfc->w2_s;
+  FLOAT8 *mld_l = gfc->mld_l, *mld_s = gfc->mld_s;
+  int *bu_l = gfc->bu_l, *bo_l = gfc->bo_l;
+  int *bu_s = gfc->bu_s, *bo_s = gfc->bo_s;
   
-  static int	s3ind[CBANDS][2];
-  static int	s3ind_s[CBANDS][2];
+  int (*s3ind)[2] = gfc->s3ind;
+  int (*s3ind_s)[2] = gfc->s3ind_s;
 
-  static int	numlines_s[CBANDS] ;
-  static int	numlines_l[CBANDS];
-  static int	partition_l[HBLKSIZE];
+  int *numlines_s = gfc->numlines_s;
+  int *numlines_l = gfc->numlines_l;
+  int *partition_l = gfc->partition_l;
   
   /* frame analyzer 
    */
 #ifdef HAVEGTK
-  static FLOAT energy_save[4][HBLKSIZE];
-  static FLOAT8 pe_save[4];
-  static FLOAT8 ers_save[4];
+  FLOAT (*energy_save)[HBLKSIZE] = gfc->energy_save;
+  FLOAT8 *pe_save = gfc->pe_save;
+  FLOAT8 *ers_save = gfc->ers_save;
 #endif
 
   /* ratios 
    */
-  static FLOAT8 pe[4]={0,0,0,0};
-  static FLOAT8 ms_ratio_s_old=0,ms_ratio_l_old=0;
-  static FLOAT8 ms_ener_ratio_old=.25;
+  FLOAT8 *pe = gfc->pe;
   FLOAT8 ms_ratio_l=0,ms_ratio_s=0;
 
   /* block type 
    */
-  static int	blocktype_old[2];
+  int *blocktype_old = gfc->blocktype_old;
   int blocktype[2],uselongblock[2];
   
   /* usual variables like loop indices, etc..
@@ -145,7 +196,7 @@ void L3psycho_anal( lame_global_flags *gfp,
   FLOAT cwlimit;
 
 
-  /* initialization of static variables
+  /* initialization of the per-stream state
    */
   if((gfp->frameNum==0) && (gr_out==0)){
     FLOAT8	SNR_s[CBANDS];
@@ -165,22 +216,22 @@ void L3psycho_anal( lame_global_flags *gfp,
     }
     
     /* reset states used in unpredictability measure */
-    memset (rx_sav,0, sizeof(rx_sav));
-    memset (ax_sav,0, sizeof(ax_sav));
-    memset (bx_sav,0, sizeof(bx_sav));
-    memset (en,0, sizeof(en));
-    memset (thm,0, sizeof(thm));
+    memset (gfc->rx_sav,0, sizeof(gfc->rx_sav));
+    memset (gfc->ax_sav,0, sizeof(gfc->ax_sav));
+    memset (gfc->bx_sav,0, sizeof(gfc->bx_sav));
+    memset (gfc->en,0, sizeof(gfc->en));
+    memset (gfc->thm,0, sizeof(gfc->thm));
     
 
     /*  gfp->cwlimit = sfreq*j/1024.0;  */
-    cw_lower_index=6;
+    gfc->cw_lower_index=6;
     if (gfp->cwlimit>0) 
       cwlimit=gfp->cwlimit;
     else
       cwlimit=8.8717;
-    cw_upper_index = cwlimit*1000.0*1024.0/((FLOAT8) gfp->out_samplerate);
-    cw_upper_index=Min(HBLKSIZE-4,cw_upper_index);      /* j+3 < HBLKSIZE-1 */
-    cw_upper_index=Max(6,cw_upper_index);
+    gfc->cw_upper_index = cwlimit*1000.0*1024.0/((FLOAT8) gfp->out_samplerate);
+    gfc->cw_upper_index=Min(HBLKSIZE-4,gfc->cw_upper_index);      /* j+3 < HBLKSIZE-1 */
+    gfc->cw_upper_index=Max(6,gfc->cw_upper_index);
 
     for ( j = 0; j < HBLKSIZE; j++ )
       cw[j] = 0.4;
@@ -205,44 +256,44 @@ void L3psycho_anal( lame_global_flags *gfp,
     
     /* npart_l_orig   = number of partition bands before convolution */
     /* npart_l  = number of partition bands after convolution */
-    npart_l_orig=0; npart_s_orig=0;
+    gfc->npart_l_orig=0; gfc->npart_s_orig=0;
     for (i=0;i<HBLKSIZE;i++) 
-      if (partition_l[i]>npart_l_orig) npart_l_orig=partition_l[i];
-    npart_l_orig++;
+      if (partition_l[i]>gfc->npart_l_orig) gfc->npart_l_orig=partition_l[i];
+    gfc->npart_l_orig++;
 
     for (i=0;numlines_s[i]>=0;i++)
       ;
-    npart_s_orig = i;
+    gfc->npart_s_orig = i;
     
-    npart_l=bo_l[SBPSY_l-1]+1;
-    npart_s=bo_s[SBPSY_s-1]+1;
+    gfc->npart_l=bo_l[SBPSY_l-1]+1;
+    gfc->npart_s=bo_s[SBPSY_s-1]+1;
 
     /* MPEG2 tables are screwed up 
      * the mapping from paritition bands to scalefactor bands will use
      * more paritition bands than we have.  
      * So we will not compute these fictitious partition bands by reducing
-     * npart_l below.  */
-    if (npart_l > npart_l_orig) {
-      npart_l=npart_l_orig;
-      bo_l[SBPSY_l-1]=npart_l-1;
+     * gfc->npart_l below.  */
+    if (gfc->npart_l > gfc->npart_l_orig) {
+      gfc->npart_l=gfc->npart_l_orig;
+      bo_l[SBPSY_l-1]=gfc->npart_l-1;
       w2_l[SBPSY_l-1]=1.0;
     }
-    if (npart_s > npart_s_orig) {
-      npart_s=npart_s_orig;
-      bo_s[SBPSY_s-1]=npart_s-1;
+    if (gfc->npart_s > gfc->npart_s_orig) {
+      gfc->npart_s=gfc->npart_s_orig;
+      bo_s[SBPSY_s-1]=gfc->npart_s-1;
       w2_s[SBPSY_s-1]=1.0;
     }
     
     
     
-    for (i=0; i<npart_l; i++) {
-      for (j = 0; j < npart_l_orig; j++) {
+    for (i=0; i<gfc->npart_l; i++) {
+      for (j = 0; j < gfc->npart_l_orig; j++) {
 	if (s3_l[i][j] != 0.0)
 	  break;
       }
       s3ind[i][0] = j;
       
-      for (j = npart_l_orig - 1; j > 0; j--) {
+      for (j = gfc->npart_l_orig - 1; j > 0; j--) {
 	if (s3_l[i][j] != 0.0)
 	  break;
       }
@@ -250,14 +301,14 @@ void L3psycho_anal( lame_global_flags *gfp,
     }
 
 
-    for (i=0; i<npart_s; i++) {
-      for (j = 0; j < npart_s_orig; j++) {
+    for (i=0; i<gfc->npart_s; i++) {
+      for (j = 0; j < gfc->npart_s_orig; j++) {
 	if (s3_s[i][j] != 0.0)
 	  break;
       }
       s3ind_s[i][0] = j;
       
-      for (j = npart_s_orig - 1; j > 0; j--) {
+      for (j = gfc->npart_s_orig - 1; j > 0; j--) {
 	if (s3_s[i][j] != 0.0)
 	  break;
       }
@@ -287,7 +338,7 @@ void L3psycho_anal( lame_global_flags *gfp,
 #define rpelev2 16
 
     /* compute norm_l, norm_s instead of relying on table data */
-    for ( b = 0;b < npart_l; b++ ) {
+    for ( b = 0;b < gfc->npart_l; b++ ) {
       FLOAT8 norm=0;
       for ( k = s3ind[b][0]; k <= s3ind[b][1]; k++ ) {
 	norm += s3_l[b][k];
@@ -300,12 +351,12 @@ void L3psycho_anal( lame_global_flags *gfp,
 
     /* MPEG1 SNR_s data is given in db, convert to energy */
     if (gfp->version == 1) {
-      for ( b = 0;b < npart_s; b++ ) {
+      for ( b = 0;b < gfc->npart_s; b++ ) {
 	SNR_s[b]=exp( (FLOAT8) SNR_s[b] * LN_TO_LOG10 );
       }
     }
 
-    for ( b = 0;b < npart_s; b++ ) {
+    for ( b = 0;b < gfc->npart_s; b++ ) {
       FLOAT8 norm=0;
       for ( k = s3ind_s[b][0]; k <= s3ind_s[b][1]; k++ ) {
 	norm += s3_s[b][k];
@@ -315,8 +366,6 @@ void L3psycho_anal( lame_global_flags *gfp,
       }
       /*printf("%i  norm=%f  norm_s=%f \n",b,1/norm,norm_l[b]);*/
     }
-    
-    init_fft();
   }
   /************************* End of Initialization *****************************/
   
@@ -416,7 +465,7 @@ void L3psycho_anal( lame_global_flags *gfp,
     /**********************************************************************
      *    compute unpredicatability of first six spectral lines            * 
      **********************************************************************/
-    for ( j = 0; j < cw_lower_index; j++ )
+    for ( j = 0; j < gfc->cw_lower_index; j++ )
       {	 /* calculate unpredictability measure cw */
 	FLOAT an, a1, a2;
 	FLOAT bn, b1, b2;
@@ -476,7 +525,7 @@ void L3psycho_anal( lame_global_flags *gfp,
     /**********************************************************************
      *     compute unpredicatibility of next 200 spectral lines            *
      **********************************************************************/ 
-    for ( j = cw_lower_index; j < cw_upper_index; j += 4 )
+    for ( j = gfc->cw_lower_index; j < gfc->cw_upper_index; j += 4 )
       {/* calculate unpredictability measure cw */
 	FLOAT rn, r1, r2;
 	FLOAT numre, numim, den;
@@ -581,11 +630,11 @@ void L3psycho_anal( lame_global_flags *gfp,
 	    eb[tp] += energy[j];
 	    cb[tp] += cw[j] * energy[j];
 	  }
-	assert(tp<npart_l_orig);
+	assert(tp<gfc->npart_l_orig);
       }
 #else
     b = 0;
-    for (j = 0; j < cw_upper_index;)
+    for (j = 0; j < gfc->cw_upper_index;)
       {
 	FLOAT8 ebb, cbb;
 	int i;
@@ -602,10 +651,14 @@ void L3psycho_anal( lame_global_flags *gfp,
 	  }
 	eb[b] = ebb;
 	cb[b] = cbb;
+#if defined(__SSE2__)
+	ebcb[b][0] = ebb;
+	ebcb[b][1] = cbb;
+#endif
 	b++;
       }
 
-    for (; b < npart_l_orig; b++ )
+    for (; b < gfc->npart_l_orig; b++ )
       {
 	int i;
 	FLOAT8 ebb = energy[j++];
@@ -616,6 +669,10 @@ void L3psycho_anal( lame_global_flags *gfp,
 	  }
 	eb[b] = ebb;
 	cb[b] = ebb * 0.4;
+#if defined(__SSE2__)
+	ebcb[b][0] = eb[b];
+	ebcb[b][1] = cb[b];
+#endif
       }
 #endif
 
@@ -624,11 +681,22 @@ void L3psycho_anal( lame_global_flags *gfp,
      *      with the spreading function, s3_l[b][k]                        *
      ******************************************************************** */
     pe[chn] = 0;		/*  calculate percetual entropy */
-    for ( b = 0;b < npart_l; b++ )
+    for ( b = 0;b < gfc->npart_l; b++ )
       {
 	FLOAT8 tbb,ecb,ctb;
 	FLOAT8 temp_1; /* BUG of IS */
 
+#if defined(__SSE2__)
+	{
+	  /* ecb and ctb in the two lanes */
+	  __m128d acc = _mm_setzero_pd();
+	  for ( k = s3ind[b][0]; k <= s3ind[b][1]; k++ )
+	    acc = _mm_add_pd(acc, _mm_mul_pd(_mm_set1_pd(s3_l[b][k]),
+					     _mm_loadu_pd(ebcb[k])));
+	  _mm_store_sd(&ecb, acc);
+	  _mm_storeh_pd(&ctb, acc);
+	}
+#else
 	ecb = 0;
 	ctb = 0;
 	for ( k = s3ind[b][0]; k <= s3ind[b][1]; k++ )
@@ -636,6 +704,7 @@ void L3psycho_anal( lame_global_flags *gfp,
 	    ecb += s3_l[b][k] * eb[k];	/* sprdngf for Layer III */
 	    ctb += s3_l[b][k] * cb[k];
 	  }
+#endif
 
 	/* calculate the tonality of each threshold calculation partition */
 	/* calculate the SNR in each threshhold calculation partition */
@@ -652,6 +721,11 @@ void L3psycho_anal( lame_global_flags *gfp,
 	      {
 		tbb = 1;
 	      }
+	    else if (gfp->psymodel == 2)
+	      {
+		tbb = fast_exp2(((TMN - NMT)*(LN_TO_LOG10*0.299/LOG2))
+			+ ((TMN - NMT)*(LN_TO_LOG10*0.43 ))*fast_log2(tbb));
+	      }
 	    else
 	      {
 		tbb = log(tbb);
@@ -678,7 +752,10 @@ void L3psycho_anal( lame_global_flags *gfp,
 	  {
 	    /* there's no non sound portition, because thr[b] is
 	     maximum of qthr_l and temp_1 */
-	    pe[chn] -= numlines_l[b] * log(thr[b] / eb[b]);
+	    if (gfp->psymodel == 2)
+	      pe[chn] -= numlines_l[b] * LOG2 * fast_log2(thr[b] / eb[b]);
+	    else
+	      pe[chn] -= numlines_l[b] * log(thr[b] / eb[b]);
 	  }
       }
 
@@ -765,38 +842,61 @@ void L3psycho_anal( lame_global_flags *gfp,
     
     
     /* threshold calculation for short blocks */
-    for ( sblock = 0; sblock < 3; sblock++ )
+    j = 0;
+    for ( b = 0; b < gfc->npart_s_orig; b++ )
       {
-	j = 0;
-	for ( b = 0; b < npart_s_orig; b++ )
+	for ( sblock = 0; sblock < 3; sblock++ )
 	  {
 	    int i;
-	    FLOAT ecb = energy_s[sblock][j++];
-	    for (i = numlines_s[b]; i > 0; i--)
+	    FLOAT ecb = energy_s[sblock][j];
+	    for (i = 1; i <= numlines_s[b]; i++)
 	      {
-		ecb += energy_s[sblock][j++];
+		ecb += energy_s[sblock][j+i];
 	      }
-	    eb[b] = ecb;
+	    eb_s[b][sblock] = ecb;
 	  }
+	eb_s[b][3] = 0;
+	j += numlines_s[b] + 1;
+      }
 
-	for ( b = 0; b < npart_s; b++ )
+    /* the three short blocks are convolved together */
+    for ( b = 0; b < gfc->npart_s; b++ )
+      {
+#if defined(__SSE2__)
+	__m128d ecb01 = _mm_setzero_pd(), ecb23 = _mm_setzero_pd();
+	for ( k = s3ind_s[b][0]; k <= s3ind_s[b][1]; k++ )
+	  {
+	    __m128d s3 = _mm_set1_pd(s3_s[b][k]);
+	    ecb01 = _mm_add_pd(ecb01, _mm_mul_pd(s3, _mm_loadu_pd(&eb_s[k][0])));
+	    ecb23 = _mm_add_pd(ecb23, _mm_mul_pd(s3, _mm_loadu_pd(&eb_s[k][2])));
+	  }
+	_mm_storeu_pd(&thr_s[b][0], ecb01);
+	_mm_storeu_pd(&thr_s[b][2], ecb23);
+#else
+	for ( sblock = 0; sblock < 3; sblock++ )
 	  {
 	    FLOAT8 ecb = 0;
 	    for ( k = s3ind_s[b][0]; k <= s3ind_s[b][1]; k++ )
 	      {
-		ecb += s3_s[b][k] * eb[k];
+		ecb += s3_s[b][k] * eb_s[k][sblock];
 	      }
-	    thr[b] = Max (qthr_s[b], ecb);
+	    thr_s[b][sblock] = ecb;
 	  }
+#endif
+	for ( sblock = 0; sblock < 3; sblock++ )
+	  thr_s[b][sblock] = Max (qthr_s[b], thr_s[b][sblock]);
+      }
 
+    for ( sblock = 0; sblock < 3; sblock++ )
+      {
 	for ( sb = 0; sb < SBPSY_s; sb++ )
 	  {
-	    FLOAT8 enn  = w1_s[sb] * eb[bu_s[sb]] + w2_s[sb] * eb[bo_s[sb]];
-	    FLOAT8 thmm = w1_s[sb] *thr[bu_s[sb]] + w2_s[sb] * thr[bo_s[sb]];
+	    FLOAT8 enn  = w1_s[sb] * eb_s[bu_s[sb]][sblock] + w2_s[sb] * eb_s[bo_s[sb]][sblock];
+	    FLOAT8 thmm = w1_s[sb] *thr_s[bu_s[sb]][sblock] + w2_s[sb] * thr_s[bo_s[sb]][sblock];
 	    for ( b = bu_s[sb]+1; b < bo_s[sb]; b++ )
 	      {
-		enn  += eb[b];
-		thmm += thr[b];
+		enn  += eb_s[b][sblock];
+		thmm += thr_s[b][sblock];
 	      }
 	    en[chn].s[sb][sblock] = enn;
 	    thm[chn].s[sb][sblock] = thmm;
@@ -859,6 +959,7 @@ void L3psycho_anal( lame_global_flags *gfp,
       x2 = Max(thm[0].l[sb],thm[1].l[sb]);
       /* thresholds difference in db */
       if (x2 >= 1000*x1)  db=3;
+      else if (gfp->psymodel == 2) db = fast_log2(x2/x1)*(LOG2/LOG10);
       else db = log10(x2/x1);  
       /*  printf("db = %f %e %e  \n",db,thm[0].l[sb],thm[1].l[sb]);*/
       sidetot += db;
@@ -874,6 +975,7 @@ void L3psycho_anal( lame_global_flags *gfp,
 	x2 = Max(thm[0].s[sb][sblock],thm[1].s[sb][sblock]);
 	/* thresholds difference in db */
 	if (x2 >= 1000*x1)  db=3;
+	else if (gfp->psymodel == 2) db = fast_log2(x2/x1)*(LOG2/LOG10);
 	else db = log10(x2/x1);  
 	sidetot += db;
 	tot++;
@@ -941,12 +1043,12 @@ void L3psycho_anal( lame_global_flags *gfp,
   }
   
   if (blocktype_d[0]==2) 
-    *ms_ratio = ms_ratio_s_old;
+    *ms_ratio = gfc->ms_ratio_s_old;
   else
-    *ms_ratio = ms_ratio_l_old;
+    *ms_ratio = gfc->ms_ratio_l_old;
 
-  ms_ratio_s_old = ms_ratio_s;
-  ms_ratio_l_old = ms_ratio_l;
+  gfc->ms_ratio_s_old = ms_ratio_s;
+  gfc->ms_ratio_l_old = ms_ratio_l;
 
   /* we dont know the block type of this frame yet - assume long */
   *ms_ratio_next = ms_ratio_l;
@@ -960,9 +1062,9 @@ void L3psycho_anal( lame_global_flags *gfp,
   /*********************************************************************/
   if (numchn==4)  {
     FLOAT tmp = tot_ener[3]+tot_ener[2];
-    *ms_ener_ratio = ms_ener_ratio_old;
-    ms_ener_ratio_old=0;
-    if (tmp>0) ms_ener_ratio_old=tot_ener[3]/tmp;
+    *ms_ener_ratio = gfc->ms_ener_ratio_old;
+    gfc->ms_ener_ratio_old=0;
+    if (tmp>0) gfc->ms_ener_ratio_old=tot_ener[3]/tmp;
   } else
     /* we didn't compute ms_ener_ratios */
     *ms_ener_ratio = 0;
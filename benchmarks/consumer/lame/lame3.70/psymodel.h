@@ -12,4 +12,5 @@ void L3psycho_anal( lame_global_flags *gfp,
 		    III_psy_ratio MS_ratio[2][2],
 		    FLOAT8 pe[2], FLOAT8 pe_MS[2], 
                     int blocktype_d[2]); 
+void L3psycho_init_tables(void);
 #endif
@@ -3,11 +3,13 @@
 #include "tables.h"
 #include "reservoir.h"
 #include "quantize-pvt.h"
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
 
-FLOAT masking_lower=1;
-int convert_mdct, reduce_sidechannel;
 /*
-mt 5/99.  These global flags denote 4 possibilities:
+mt 5/99.  These flags (gfp->internal_flags->convert_mdct and
+reduce_sidechannel, set per frame in iteration_init) denote 4 possibilities:
                                                                 mode    l3_xmin
 1   MDCT input L/R, quantize L/R,   psy-model thresholds: L/R   -m s     either
 2   MDCT input L/R, quantize M/S,   psy-model thresholds: L/R   -m j     orig
@@ -121,19 +123,39 @@ struct scalefac_struct sfBandIndex[6] =
   }
 };
 
-struct scalefac_struct scalefac_band;
-
-
 FLOAT8 pow20[Q_MAX];
 FLOAT8 ipow20[Q_MAX];
 FLOAT8 pow43[PRECALC_SIZE];
 static FLOAT8 adj43[PRECALC_SIZE];
 static FLOAT8 adj43asm[PRECALC_SIZE];
-static FLOAT8 ATH_l[SBPSY_l];
-static FLOAT8 ATH_s[SBPSY_l];
 
-FLOAT8 ATH_mdct_long[576];
-FLOAT8 ATH_mdct_short[192];
+
+/************************************************************************/
+/*  quantizer tables, shared by all encoder instances.                  */
+/*  called once per process, see lame_init_tables()                     */
+/************************************************************************/
+void
+iteration_init_tables(void)
+{
+  int i;
+
+  for(i=0;i<PRECALC_SIZE;i++)
+      pow43[i] = pow((FLOAT8)i, 4.0/3.0);
+
+  for (i = 0; i < PRECALC_SIZE-1; i++)
+      adj43[i] = (i + 1) - pow(0.5 * (pow43[i] + pow43[i + 1]), 0.75);
+  adj43[i] = 0.5;
+
+
+  adj43asm[0] = 0.0;
+  for (i = 1; i < PRECALC_SIZE; i++)
+    adj43asm[i] = i - 0.5 - pow(0.5 * (pow43[i - 1] + pow43[i]),0.75);
+
+  for (i = 0; i < Q_MAX; i++) {
+      ipow20[i] = pow(2.0, (double)(i - 210) * -0.1875);
+      pow20[i] = pow(2.0, (double)(i - 210) * 0.25);
+  }
+}
 
 
 /************************************************************************/
@@ -142,6 +164,7 @@ FLOAT8 ATH_mdct_short[192];
 void
 iteration_init( lame_global_flags *gfp,III_side_info_t *l3_side, int l3_enc[2][2][576])
 {
+  lame_internal_flags *gfc=gfp->internal_flags;
   gr_info *cod_info;
   int ch, gr, i;
 
@@ -149,41 +172,24 @@ iteration_init( lame_global_flags *gfp,III_side_info_t *l3_side, int l3_enc[2][2
 
   if ( gfp->frameNum==0 ) {
     for (i = 0; i < SBMAX_l + 1; i++) {
-      scalefac_band.l[i] =
+      gfc->scalefac_band.l[i] =
 	sfBandIndex[gfp->samplerate_index + (gfp->version * 3)].l[i];
     }
     for (i = 0; i < SBMAX_s + 1; i++) {
-      scalefac_band.s[i] =
+      gfc->scalefac_band.s[i] =
 	sfBandIndex[gfp->samplerate_index + (gfp->version * 3)].s[i];
     }
 
     l3_side->main_data_begin = 0;
-    compute_ath(gfp,ATH_l,ATH_s);
-
-    for(i=0;i<PRECALC_SIZE;i++)
-        pow43[i] = pow((FLOAT8)i, 4.0/3.0);
-
-    for (i = 0; i < PRECALC_SIZE-1; i++)
-	adj43[i] = (i + 1) - pow(0.5 * (pow43[i] + pow43[i + 1]), 0.75);
-    adj43[i] = 0.5;
-
-
-    adj43asm[0] = 0.0;
-    for (i = 1; i < PRECALC_SIZE; i++)
-      adj43asm[i] = i - 0.5 - pow(0.5 * (pow43[i - 1] + pow43[i]),0.75);
-
-    for (i = 0; i < Q_MAX; i++) {
-	ipow20[i] = pow(2.0, (double)(i - 210) * -0.1875);
-	pow20[i] = pow(2.0, (double)(i - 210) * 0.25);
-    }
+    compute_ath(gfp,gfc->ATH_l,gfc->ATH_s);
   }
 
 
-  convert_mdct=0;
-  reduce_sidechannel=0;
+  gfc->convert_mdct=0;
+  gfc->reduce_sidechannel=0;
   if (gfp->mode_ext==MPG_MD_MS_LR) {
-    convert_mdct = 1;
-    reduce_sidechannel=1;
+    gfc->convert_mdct = 1;
+    gfc->reduce_sidechannel=1;
   }
   
   /* some intializations. */
@@ -277,6 +283,7 @@ FLOAT8 ATHformula(lame_global_flags *gfp,FLOAT8 f)
 
 void compute_ath(lame_global_flags *gfp,FLOAT8 ATH_l[SBPSY_l],FLOAT8 ATH_s[SBPSY_l])
 {
+  lame_internal_flags *gfc=gfp->internal_flags;
   int sfb,i,start,end;
   FLOAT8 ATH_f;
   FLOAT8 samp_freq = gfp->out_samplerate/1000.0;
@@ -289,14 +296,14 @@ void compute_ath(lame_global_flags *gfp,FLOAT8 ATH_l[SBPSY_l],FLOAT8 ATH_s[SBPSY
 
   /* last sfb is not used */
   for ( sfb = 0; sfb < SBPSY_l; sfb++ ) {
-    start = scalefac_band.l[ sfb ];
-    end   = scalefac_band.l[ sfb+1 ];
+    start = gfc->scalefac_band.l[ sfb ];
+    end   = gfc->scalefac_band.l[ sfb+1 ];
     ATH_l[sfb]=1e99;
     for (i=start ; i < end; i++) {
       ATH_f = ATHformula(gfp,samp_freq*i/(2*576)); /* freq in kHz */
       ATH_l[sfb]=Min(ATH_l[sfb],ATH_f);
 #ifdef RH_ATH
-      ATH_mdct_long[i] = ATH_f*adjust_mdct_scaling;
+      gfc->ATH_mdct_long[i] = ATH_f*adjust_mdct_scaling;
 #endif
     }
     /*
@@ -308,14 +315,14 @@ void compute_ath(lame_global_flags *gfp,FLOAT8 ATH_l[SBPSY_l],FLOAT8 ATH_s[SBPSY
   }
 
   for ( sfb = 0; sfb < SBPSY_s; sfb++ ){
-    start = scalefac_band.s[ sfb ];
-    end   = scalefac_band.s[ sfb+1 ];
+    start = gfc->scalefac_band.s[ sfb ];
+    end   = gfc->scalefac_band.s[ sfb+1 ];
     ATH_s[sfb]=1e99;
     for (i=start ; i < end; i++) {
       ATH_f = ATHformula(gfp,samp_freq*i/(2*192));     /* freq in kHz */
       ATH_s[sfb]=Min(ATH_s[sfb],ATH_f);
 #ifdef RH_ATH
-      ATH_mdct_short[i] = ATH_f*adjust_mdct_scaling;
+      gfc->ATH_mdct_short[i] = ATH_f*adjust_mdct_scaling;
 #endif
     }
   }
@@ -352,7 +359,7 @@ int targ_bits[2],int mean_bits, int gr)
   int ch;
 
   /* allocate targ_bits for granule */
-  ResvMaxBits( mean_bits, &tbits, &extra_bits, gr);
+  ResvMaxBits(gfp, mean_bits, &tbits, &extra_bits, gr);
     
 
   for (ch=0 ; ch < gfp->stereo ; ch ++) {
@@ -423,7 +430,7 @@ int numchn=2;
  * The code selects the best global gain for a particular set of scalefacs */
  
 int
-inner_loop( lame_global_flags *gfp,FLOAT8 xrpow[576],
+inner_loop( lame_global_flags *gfp,FLOAT8 xrpow[576], FLOAT8 xrpow_max[SBLIMIT],
 	    int l3_enc[576], int max_bits,
 	    gr_info *cod_info)
 {
@@ -433,7 +440,7 @@ inner_loop( lame_global_flags *gfp,FLOAT8 xrpow[576],
     do
     {
       cod_info->global_gain++;
-      bits = count_bits(gfp,l3_enc, xrpow, cod_info);
+      bits = count_bits(gfp,l3_enc, xrpow, xrpow_max, cod_info);
     }
     while ( bits > max_bits );
     return bits;
@@ -688,6 +695,7 @@ int scale_bitcount_lsf(III_scalefac_t *scalefac, gr_info *cod_info)
 int calc_xmin( lame_global_flags *gfp,FLOAT8 xr[576], III_psy_ratio *ratio,
 	       gr_info *cod_info, III_psy_xmin *l3_xmin)
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
     int start, end, bw,l, b, ath_over=0;
 	u_int	sfb;
     FLOAT8 en0, xmin, ener;
@@ -695,15 +703,15 @@ int calc_xmin( lame_global_flags *gfp,FLOAT8 xr[576], III_psy_ratio *ratio,
     if (gfp->ATHonly) {    
       for ( sfb = cod_info->sfb_smax; sfb < SBPSY_s; sfb++ )
 	  for ( b = 0; b < 3; b++ )
-	      l3_xmin->s[sfb][b]=ATH_s[sfb];
+	      l3_xmin->s[sfb][b]=gfc->ATH_s[sfb];
       for ( sfb = 0; sfb < cod_info->sfb_lmax; sfb++ )
-	  l3_xmin->l[sfb]=ATH_l[sfb];
+	  l3_xmin->l[sfb]=gfc->ATH_l[sfb];
 
     }else{
 
       for ( sfb = cod_info->sfb_smax; sfb < SBPSY_s; sfb++ ) {
-	start = scalefac_band.s[ sfb ];
-        end   = scalefac_band.s[ sfb + 1 ];
+	start = gfc->scalefac_band.s[ sfb ];
+        end   = gfc->scalefac_band.s[ sfb + 1 ];
 	bw = end - start;
         for ( b = 0; b < 3; b++ ) {
 	  for (en0 = 0.0, l = start; l < end; l++) {
@@ -715,22 +723,22 @@ int calc_xmin( lame_global_flags *gfp,FLOAT8 xr[576], III_psy_ratio *ratio,
 
 	  xmin = ratio->en.s[sfb][b];
 	  if (xmin > 0.0)
-	    xmin = en0 * ratio->thm.s[sfb][b] * masking_lower / xmin;
+	    xmin = en0 * ratio->thm.s[sfb][b] * gfc->masking_lower / xmin;
 
 #ifdef RH_ATH
           /* do not mix up ATH masking with GPSYCHO thresholds
 	   */
 	  l3_xmin->s[sfb][b] = Max(1e-20, xmin);
 #else
-	  l3_xmin->s[sfb][b] = Max(ATH_s[sfb], xmin);
+	  l3_xmin->s[sfb][b] = Max(gfc->ATH_s[sfb], xmin);
 #endif
-	  if (en0 > ATH_s[sfb]) ath_over++;
+	  if (en0 > gfc->ATH_s[sfb]) ath_over++;
 	}
       }
 
       for ( sfb = 0; sfb < cod_info->sfb_lmax; sfb++ ){
-	start = scalefac_band.l[ sfb ];
-	end   = scalefac_band.l[ sfb+1 ];
+	start = gfc->scalefac_band.l[ sfb ];
+	end   = gfc->scalefac_band.l[ sfb+1 ];
 	bw = end - start;
 
         for (en0 = 0.0, l = start; l < end; l++ ) {
@@ -741,7 +749,7 @@ int calc_xmin( lame_global_flags *gfp,FLOAT8 xr[576], III_psy_ratio *ratio,
 
 	xmin = ratio->en.l[sfb];
 	if (xmin > 0.0)
-	  xmin = en0 * ratio->thm.l[sfb] * masking_lower / xmin;
+	  xmin = en0 * ratio->thm.l[sfb] * gfc->masking_lower / xmin;
 
 
 #ifdef RH_ATH
@@ -749,9 +757,9 @@ int calc_xmin( lame_global_flags *gfp,FLOAT8 xr[576], III_psy_ratio *ratio,
 	 */
 	l3_xmin->l[sfb]=Max(1e-20, xmin);
 #else
-	l3_xmin->l[sfb]=Max(ATH_l[sfb], xmin);
+	l3_xmin->l[sfb]=Max(gfc->ATH_l[sfb], xmin);
 #endif
-	if (en0 > ATH_l[sfb]) ath_over++;
+	if (en0 > gfc->ATH_l[sfb]) ath_over++;
       }
     }
     return ath_over;
@@ -822,10 +830,11 @@ typedef enum {
 /*-------------------------------------------------------------------------*/
 int 
 bin_search_StepSize2 (lame_global_flags *gfp,int desired_rate, int start, int *ix, 
-                      FLOAT8 xrspow[576], gr_info *cod_info)
+                      FLOAT8 xrspow[576], FLOAT8 xrspow_max[SBLIMIT],
+                      gr_info *cod_info)
 /*-------------------------------------------------------------------------*/
 {
-    static int CurrentStep = 4;
+    lame_internal_flags *gfc=gfp->internal_flags;
     int nBits;
     int flag_GoneOver = 0;
     int StepSize = start;
@@ -834,25 +843,25 @@ bin_search_StepSize2 (lame_global_flags *gfp,int desired_rate, int start, int *i
     do
     {
 	cod_info->global_gain = StepSize;
-	nBits = count_bits(gfp,ix, xrspow, cod_info);  
+	nBits = count_bits(gfp,ix, xrspow, xrspow_max, cod_info);  
 
-	if (CurrentStep == 1 )
+	if (gfc->CurrentStep == 1 )
         {
 	    break; /* nothing to adjust anymore */
 	}
 	if (flag_GoneOver)
 	{
-	    CurrentStep /= 2;
+	    gfc->CurrentStep /= 2;
 	}
 	if (nBits > desired_rate)  /* increase Quantize_StepSize */
 	{
 	    if (Direction == BINSEARCH_DOWN && !flag_GoneOver)
 	    {
 		flag_GoneOver = 1;
-		CurrentStep /= 2; /* late adjust */
+		gfc->CurrentStep /= 2; /* late adjust */
 	    }
 	    Direction = BINSEARCH_UP;
-	    StepSize += CurrentStep;
+	    StepSize += gfc->CurrentStep;
 	    if (StepSize > 255) break;
 	}
 	else if (nBits < desired_rate)
@@ -860,21 +869,21 @@ bin_search_StepSize2 (lame_global_flags *gfp,int desired_rate, int start, int *i
 	    if (Direction == BINSEARCH_UP && !flag_GoneOver)
 	    {
 		flag_GoneOver = 1;
-		CurrentStep /= 2; /* late adjust */
+		gfc->CurrentStep /= 2; /* late adjust */
 	    }
 	    Direction = BINSEARCH_DOWN;
-	    StepSize -= CurrentStep;
+	    StepSize -= gfc->CurrentStep;
 	    if (StepSize < 0) break;
 	}
 	else break; /* nBits == desired_rate;; most unlikely to happen.*/
     } while (1); /* For-ever, break is adjusted. */
 
-    CurrentStep = abs(start - StepSize);
+    gfc->CurrentStep = abs(start - StepSize);
     
-    if (CurrentStep >= 4) {
-	CurrentStep = 4;
+    if (gfc->CurrentStep >= 4) {
+	gfc->CurrentStep = 4;
     } else {
-	CurrentStep = 2;
+	gfc->CurrentStep = 2;
     }
 
     return nBits;
@@ -955,6 +964,23 @@ bin_search_StepSize2 (lame_global_flags *gfp,int desired_rate, int start, int *i
 # endif
 #endif
 
+/*********************************************************************
+ * largest xr^(3/4) in each block of 18 lines (one polyphase subband).
+ * count_bits() and the quantizers below use it to check for overflow
+ * and to skip subbands which quantize to 0 at the current step size.
+ * Must be recomputed whenever xrpow changes.
+ *********************************************************************/
+void calc_xrpow_max(FLOAT8 xrpow[576], FLOAT8 xrpow_max[SBLIMIT])
+{
+  int sb, j;
+  for (sb = 0; sb < SBLIMIT; sb++, xrpow += 18) {
+    FLOAT8 m = xrpow[0];
+    for (j = 1; j < 18; j++)
+      if (xrpow[j] > m) m = xrpow[j];
+    xrpow_max[sb] = m;
+  }
+}
+
 /*********************************************************************
  * nonlinear quantization of xr 
  * More accurate formula than the ISO formula.  Takes into account
@@ -968,7 +994,7 @@ bin_search_StepSize2 (lame_global_flags *gfp,int desired_rate, int start, int *i
  *    Takehiro Tominaga <tominaga@isoternet.org> 11/1999
  *********************************************************************/
 
-void quantize_xrpow(FLOAT8 xr[576], int ix[576], gr_info *cod_info) {
+void quantize_xrpow(FLOAT8 xr[576], FLOAT8 xrpow_max[SBLIMIT], int ix[576], gr_info *cod_info) {
   /* quantize on xr^(3/4) instead of xr */
   const FLOAT8 istep = IPOW20(cod_info->global_gain);
 
@@ -1122,48 +1148,42 @@ void quantize_xrpow(FLOAT8 xr[576], int ix[576], gr_info *cod_info) {
       }
   }
 #endif
-  {/* from Wilfried.Behne@t-online.de.  Reported to be 2x faster than 
-      the above code (when not using ASM) on PowerPC */
-     	int j;
-     	
-     	for ( j = 576/8; j > 0; --j)
-     	{
-			FLOAT8	x1, x2, x3, x4, x5, x6, x7, x8;
-			int		rx1, rx2, rx3, rx4, rx5, rx6, rx7, rx8;
-			x1 = *xr++ * istep;
-			x2 = *xr++ * istep;
-			XRPOW_FTOI(x1, rx1);
-			x3 = *xr++ * istep;
-			XRPOW_FTOI(x2, rx2);
-			x4 = *xr++ * istep;
-			XRPOW_FTOI(x3, rx3);
-			x5 = *xr++ * istep;
-			XRPOW_FTOI(x4, rx4);
-			x6 = *xr++ * istep;
-			XRPOW_FTOI(x5, rx5);
-			x7 = *xr++ * istep;
-			XRPOW_FTOI(x6, rx6);
-			x8 = *xr++ * istep;
-			XRPOW_FTOI(x7, rx7);
-			x1 += QUANTFAC(rx1);
-			XRPOW_FTOI(x8, rx8);
-			x2 += QUANTFAC(rx2);
-			XRPOW_FTOI(x1,*ix++);
-			x3 += QUANTFAC(rx3);
-			XRPOW_FTOI(x2,*ix++);
-			x4 += QUANTFAC(rx4);		
-			XRPOW_FTOI(x3,*ix++);
-			x5 += QUANTFAC(rx5);
-			XRPOW_FTOI(x4,*ix++);
-			x6 += QUANTFAC(rx6);
-			XRPOW_FTOI(x5,*ix++);
-			x7 += QUANTFAC(rx7);
-			XRPOW_FTOI(x6,*ix++);
-			x8 += QUANTFAC(rx8);		
-			XRPOW_FTOI(x7,*ix++);
-			XRPOW_FTOI(x8,*ix++);
-     	}
-	}
+  {
+      /* count_bits() has already checked xr*istep against IXMAX_VAL, so
+       * the largest line of a subband quantizes exactly like the scalar
+       * code would.  If it goes to 0, so does every other line there. */
+      int sb, j;
+      for (sb = 0; sb < SBLIMIT; sb++, xr += 18, ix += 18) {
+          FLOAT8 xmax = xrpow_max[sb] * istep;
+          int rmax;
+          XRPOW_FTOI(xmax, rmax);
+          XRPOW_FTOI(xmax + QUANTFAC(rmax), rmax);
+          if (rmax == 0) {
+              for (j = 0; j < 18; j++)
+                  ix[j] = 0;
+              continue;
+          }
+#if defined(__SSE2__)
+          {
+              const __m128d vstep = _mm_set1_pd(istep);
+              for (j = 0; j < 18; j += 2) {
+                  __m128d x = _mm_mul_pd(_mm_loadu_pd(xr + j), vstep);
+                  __m128i r = _mm_cvttpd_epi32(x);
+                  x = _mm_add_pd(x, _mm_set_pd(QUANTFAC(_mm_cvtsi128_si32(_mm_srli_si128(r, 4))),
+                                                QUANTFAC(_mm_cvtsi128_si32(r))));
+                  _mm_storel_epi64((__m128i *) (ix + j), _mm_cvttpd_epi32(x));
+              }
+          }
+#else
+          for (j = 0; j < 18; j++) {
+              FLOAT8 x = xr[j] * istep;
+              int rx;
+              XRPOW_FTOI(x, rx);
+              XRPOW_FTOI(x + QUANTFAC(rx), ix[j]);
+          }
+#endif
+      }
+  }
 #endif
 }
 
@@ -1172,7 +1192,7 @@ void quantize_xrpow(FLOAT8 xr[576], int ix[576], gr_info *cod_info) {
 
 
 
-void quantize_xrpow_ISO( FLOAT8 xr[576], int ix[576], gr_info *cod_info )
+void quantize_xrpow_ISO( FLOAT8 xr[576], FLOAT8 xrpow_max[SBLIMIT], int ix[576], gr_info *cod_info )
 {
   /* quantize on xr^(3/4) instead of xr */
   const FLOAT8 istep = IPOW20(cod_info->global_gain);
@@ -1290,7 +1310,7 @@ void quantize_xrpow_ISO( FLOAT8 xr[576], int ix[576], gr_info *cod_info )
       }
 #endif
   {
-      register int j;
+      int sb, j;
       const FLOAT8 compareval0 = (1.0 - 0.4054)/istep;
       /* depending on architecture, it may be worth calculating a few more compareval's.
          eg.  compareval1 = (2.0 - 0.4054/istep); 
@@ -1303,16 +1323,38 @@ void quantize_xrpow_ISO( FLOAT8 xr[576], int ix[576], gr_info *cod_info )
          73% of all xr*istep values give ix=0
          16% will give 1
          4%  will give 2
+         Most of those zeros come in whole subbands, which xrpow_max lets
+         us skip with one compare.
       */
-      for (j=576;j>0;j--) 
-        {
-          if (compareval0 > *xr) {
-            *(ix++) = 0;
-            xr++;
-          } else
-	    /*    *(ix++) = (int)( istep*(*(xr++))  + 0.4054); */
-            XRPOW_FTOI(  istep*(*(xr++))  + ROUNDFAC , *(ix++) );
-        }
+      for (sb = 0; sb < SBLIMIT; sb++, xr += 18, ix += 18) {
+          if (compareval0 > xrpow_max[sb]) {
+              for (j = 0; j < 18; j++)
+                  ix[j] = 0;
+              continue;
+          }
+#if defined(__SSE2__)
+          {
+              const __m128d vstep = _mm_set1_pd(istep);
+              const __m128d vround = _mm_set1_pd(ROUNDFAC);
+              const __m128d vcmp = _mm_set1_pd(compareval0);
+              for (j = 0; j < 18; j += 2) {
+                  __m128d x = _mm_loadu_pd(xr + j);
+                  __m128i zero = _mm_castpd_si128(_mm_cmpgt_pd(vcmp, x));
+                  __m128i q = _mm_cvttpd_epi32(_mm_add_pd(_mm_mul_pd(x, vstep), vround));
+                  zero = _mm_shuffle_epi32(zero, _MM_SHUFFLE(3, 3, 2, 0));
+                  _mm_storel_epi64((__m128i *) (ix + j), _mm_andnot_si128(zero, q));
+              }
+          }
+#else
+          for (j = 0; j < 18; j++) {
+              if (compareval0 > xr[j])
+                  ix[j] = 0;
+              else
+                  /*    ix[j] = (int)( istep*xr[j]  + 0.4054); */
+                  XRPOW_FTOI(istep*xr[j] + ROUNDFAC, ix[j]);
+          }
+#endif
+      }
   }
 #endif
 }
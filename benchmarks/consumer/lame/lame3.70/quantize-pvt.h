@@ -4,18 +4,9 @@
 #define IXMAX_VAL 8206 /* ix always <= 8191+15.    see count_bits() */
 #define PRECALC_SIZE (IXMAX_VAL+2)
 
-extern FLOAT masking_lower;
-extern int convert_mdct, convert_psy, reduce_sidechannel;
 extern unsigned nr_of_sfb_block[6][3][4];
 extern int pretab[21];
 
-struct scalefac_struct
-{
-   int l[1+SBMAX_l];
-   int s[1+SBMAX_s];
-};
-
-extern struct scalefac_struct scalefac_band;
 extern struct scalefac_struct sfBandIndex[6];
 
 extern FLOAT8 pow43[PRECALC_SIZE];
@@ -25,10 +16,6 @@ extern FLOAT8 pow43[PRECALC_SIZE];
 extern FLOAT8 pow20[Q_MAX];
 extern FLOAT8 ipow20[Q_MAX];
 
-#ifdef RH_ATH
-extern FLOAT8 ATH_mdct_long[576], ATH_mdct_short[192];
-#endif
-
 FLOAT8 ATHformula(lame_global_flags *gfp,FLOAT8 f);
 void compute_ath(lame_global_flags *gfp,FLOAT8 ATH_l[SBPSY_l],FLOAT8 ATH_s[SBPSY_l]);
 void ms_convert(FLOAT8 xr[2][576],FLOAT8 xr_org[2][576]);
@@ -50,9 +37,11 @@ void outer_loop( lame_global_flags *gfp,
 
 
 
+void iteration_init_tables(void);
 void iteration_init( lame_global_flags *gfp,III_side_info_t *l3_side, int l3_enc[2][2][576]);
 
 int inner_loop( lame_global_flags *gfp,FLOAT8 xrpow[576],
+                FLOAT8 xrpow_max[SBLIMIT],
                 int l3_enc[576],
                 int max_bits,
                 gr_info *cod_info);
@@ -65,7 +54,7 @@ int calc_xmin( lame_global_flags *gfp,FLOAT8 xr[576],
 
 int scale_bitcount( III_scalefac_t *scalefac, gr_info *cod_info);
 int scale_bitcount_lsf( III_scalefac_t *scalefac, gr_info *cod_info);
-int calc_noise1( FLOAT8 xr[576],
+int calc_noise1( lame_global_flags *gfp,FLOAT8 xr[576],
                  int ix[576],
                  gr_info *cod_info,
                  FLOAT8 xfsf[4][SBPSY_l], 
@@ -76,15 +65,18 @@ int calc_noise1( FLOAT8 xr[576],
 
 int loop_break( III_scalefac_t *scalefac, gr_info *cod_info);
 
-void amp_scalefac_bands(FLOAT8 xrpow[576],
+void amp_scalefac_bands(lame_global_flags *gfp,FLOAT8 xrpow[576],
 			gr_info *cod_info,
 			III_scalefac_t *scalefac,
 			FLOAT8 distort[4][SBPSY_l]);
 
+void calc_xrpow_max( FLOAT8 xrpow[576], FLOAT8 xrpow_max[SBLIMIT] );
 void quantize_xrpow( FLOAT8 xr[576],
+               FLOAT8 xrpow_max[SBLIMIT],
                int  ix[576],
                gr_info *cod_info );
 void quantize_xrpow_ISO( FLOAT8 xr[576],
+               FLOAT8 xrpow_max[SBLIMIT],
                int  ix[576],
                gr_info *cod_info );
 
@@ -94,8 +86,10 @@ new_choose_table( int ix[576],
 		  unsigned int end, int * s );
 
 int bin_search_StepSize2(lame_global_flags *gfp,int desired_rate, int start, int ix[576],
-                         FLOAT8 xrspow[576], gr_info * cod_info);
-int count_bits(lame_global_flags *gfp,int  *ix, FLOAT8 xr[576], gr_info *cod_info);
+                         FLOAT8 xrspow[576], FLOAT8 xrspow_max[SBLIMIT],
+                         gr_info * cod_info);
+int count_bits(lame_global_flags *gfp,int  *ix, FLOAT8 xr[576],
+               FLOAT8 xr_max[SBLIMIT], gr_info *cod_info);
 
 
 int quant_compare(int type,
@@ -106,7 +100,7 @@ int VBR_compare(
 int best_over,FLOAT8 best_tot_noise,FLOAT8 best_over_noise,FLOAT8 best_max_over,
 int over,FLOAT8 tot_noise, FLOAT8 over_noise,FLOAT8 max_noise);
 
-void best_huffman_divide(int gr, int ch, gr_info *cod_info, int *ix);
+void best_huffman_divide(lame_global_flags *gfp,int gr, int ch, gr_info *cod_info, int *ix);
 
 void best_scalefac_store(lame_global_flags *gfp,int gr, int ch,
 			 int l3_enc[2][2][576],
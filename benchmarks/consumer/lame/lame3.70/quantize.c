@@ -41,6 +41,7 @@
 /************************************************************************/
 void 
 set_pinfo (
+    lame_global_flags *gfp,
     gr_info *cod_info,
     III_psy_ratio *ratio, 
     III_scalefac_t *scalefac,
@@ -51,6 +52,7 @@ set_pinfo (
     int ch
 )
 {
+  lame_internal_flags *gfc=gfp->internal_flags;
   int sfb;
   FLOAT ifqstep;
   int i,l,start,end,bw;
@@ -61,8 +63,8 @@ set_pinfo (
   if (cod_info->block_type == SHORT_TYPE) {
     for ( i = 0; i < 3; i++ ) {
       for ( sfb = 0; sfb < SBPSY_s; sfb++ )  {
-	start = scalefac_band.s[ sfb ];
-	end   = scalefac_band.s[ sfb + 1 ];
+	start = gfc->scalefac_band.s[ sfb ];
+	end   = gfc->scalefac_band.s[ sfb + 1 ];
 	bw = end - start;
 	for ( en0 = 0.0, l = start; l < end; l++ ) 
 	  en0 += (*xr_s)[l][i] * (*xr_s)[l][i];
@@ -81,8 +83,8 @@ set_pinfo (
     }
   }else{
     for ( sfb = 0; sfb < SBPSY_l; sfb++ )   {
-      start = scalefac_band.l[ sfb ];
-      end   = scalefac_band.l[ sfb+1 ];
+      start = gfc->scalefac_band.l[ sfb ];
+      end   = gfc->scalefac_band.l[ sfb+1 ];
       bw = end - start;
       for ( en0 = 0.0, l = start; l < end; l++ ) 
 	en0 += xr[l] * xr[l];
@@ -127,6 +129,7 @@ iteration_loop( lame_global_flags *gfp,
 		III_side_info_t *l3_side, int l3_enc[2][2][576],
 		III_scalefac_t scalefac[2][2])
 {
+  lame_internal_flags *gfc=gfp->internal_flags;
   FLOAT8 xfsf[4][SBPSY_l];
   FLOAT8 noise[4]; /* over,max_noise,over_noise,tot_noise; */
   III_psy_xmin l3_xmin[2];
@@ -150,13 +153,13 @@ iteration_loop( lame_global_flags *gfp,
   for ( gr = 0; gr < gfp->mode_gr; gr++ ) {
     int targ_bits[2];
 
-    if (convert_mdct) 
+    if (gfc->convert_mdct) 
       ms_convert(xr[gr], xr[gr]);
     
     on_pe(gfp,pe,l3_side,targ_bits,mean_bits, gr);
 #ifdef RH_SIDE_CBR
 #else
-    if (reduce_sidechannel) 
+    if (gfc->reduce_sidechannel) 
       reduce_side(targ_bits,ms_ener_ratio[gr],mean_bits);
 #endif      
     
@@ -180,11 +183,11 @@ iteration_loop( lame_global_flags *gfp,
         }
       best_scalefac_store(gfp,gr, ch, l3_enc, l3_side, scalefac);
       if (gfp->use_best_huffman==1 && cod_info->block_type == NORM_TYPE) {
-	best_huffman_divide(gr, ch, cod_info, l3_enc[gr][ch]);
+	best_huffman_divide(gfp, gr, ch, cod_info, l3_enc[gr][ch]);
       }
 #ifdef HAVEGTK
       if (gfp->gtkflag)
-	set_pinfo (cod_info, &ratio[gr][ch], &scalefac[gr][ch], xr[gr][ch], xfsf, noise, gr, ch);
+	set_pinfo (gfp, cod_info, &ratio[gr][ch], &scalefac[gr][ch], xr[gr][ch], xfsf, noise, gr, ch);
 #endif
 
 /*#define NORES_TEST */
@@ -218,8 +221,9 @@ iteration_loop( lame_global_flags *gfp,
 
 
 void 
-set_masking_lower (int VBR_q,int nbits)
+set_masking_lower (lame_global_flags *gfp,int VBR_q,int nbits)
 {
+	lame_internal_flags *gfc=gfp->internal_flags;
 	FLOAT masking_lower_db, adjust;
 	
 	/* quality setting */
@@ -249,7 +253,7 @@ set_masking_lower (int VBR_q,int nbits)
 	adjust = 4*(adjust-1);
 #endif
 	masking_lower_db += adjust;
-	masking_lower = pow(10.0,masking_lower_db/10);
+	gfc->masking_lower = pow(10.0,masking_lower_db/10);
 }
 
 /************************************************************************
@@ -268,6 +272,7 @@ VBR_iteration_loop (lame_global_flags *gfp,
                 III_side_info_t * l3_side, int l3_enc[2][2][576],
                 III_scalefac_t scalefac[2][2])
 {
+  lame_internal_flags *gfc=gfp->internal_flags;
 #ifdef HAVEGTK
   plotting_data bst_pinfo;
 #endif
@@ -295,7 +300,7 @@ VBR_iteration_loop (lame_global_flags *gfp,
 
 #ifdef RH_QUALITY_CONTROL
   /* with RH_QUALITY_CONTROL we have to set masking_lower only once */
-  set_masking_lower(gfp->VBR_q, 0 );
+  set_masking_lower(gfp, gfp->VBR_q, 0 );
 #endif      
 
   /*******************************************************************
@@ -330,11 +335,11 @@ VBR_iteration_loop (lame_global_flags *gfp,
      */
 #else
     /* determine quality based on mid channel only */
-    if (reduce_sidechannel) num_chan=1;  
+    if (gfc->reduce_sidechannel) num_chan=1;  
 #endif
 
     /* copy data to be quantized into xr */
-    if (convert_mdct)
+    if (gfc->convert_mdct)
 	ms_convert(xr[gr],xr[gr]);
 
     for (ch = 0; ch < num_chan; ch++) { 
@@ -356,7 +361,7 @@ VBR_iteration_loop (lame_global_flags *gfp,
         save_bits[gr][ch] = 0;
 #ifdef HAVEGTK
 	if (gfp->gtkflag)
-	  set_pinfo(cod_info, &ratio[gr][ch], &scalefac[gr][ch], xr[gr][ch], xfsf, noise, gr, ch);
+	  set_pinfo(gfp, cod_info, &ratio[gr][ch], &scalefac[gr][ch], xr[gr][ch], xfsf, noise, gr, ch);
 #endif
 	analog_silence=1;
 	continue; /* with next channel */
@@ -372,7 +377,7 @@ VBR_iteration_loop (lame_global_flags *gfp,
       /*
        * has to be set before calculating l3_xmin
        */
-      set_masking_lower( gfp->VBR_q,2500 );
+      set_masking_lower(gfp, gfp->VBR_q,2500 );
 #endif      
       /* check for analolg silence */
       /* if energy < ATH, set min_bits = 125 */
@@ -435,7 +440,7 @@ VBR_iteration_loop (lame_global_flags *gfp,
 	   */
 #else
 	  /* quality setting */
-	  set_masking_lower( gfp->VBR_q,this_bits );
+	  set_masking_lower(gfp, gfp->VBR_q,this_bits );
           /* 
 	   * compute max allowed distortion, masking lower has changed
 	   */
@@ -452,7 +457,7 @@ VBR_iteration_loop (lame_global_flags *gfp,
 			     noise[1]);
 #ifdef HAVEGTK
 	  if (gfp->gtkflag)
-	    set_pinfo(cod_info, &ratio[gr][ch], &scalefac[gr][ch], xr[gr][ch], xfsf, noise, gr, ch);
+	    set_pinfo(gfp, cod_info, &ratio[gr][ch], &scalefac[gr][ch], xr[gr][ch], xfsf, noise, gr, ch);
 #endif
 	  if (better) {
 	      /* 
@@ -508,7 +513,7 @@ VBR_iteration_loop (lame_global_flags *gfp,
    * (Robert.Hegemann@gmx.de 2000-02-18)
    */
 #else	
-  if (reduce_sidechannel) {
+  if (gfc->reduce_sidechannel) {
     /* number of bits needed was found for MID channel above.  Use formula
      * (fixed bitrate code) to set the side channel bits */
     for (gr = 0; gr < gfp->mode_gr; gr++) {
@@ -556,7 +561,7 @@ VBR_iteration_loop (lame_global_flags *gfp,
 #ifdef RH_SIDE_VBR
       if (reparted)
 #else
-      if (reparted || (reduce_sidechannel && ch == 1))
+      if (reparted || (gfc->reduce_sidechannel && ch == 1))
 #endif
       {
         cod_info = &l3_side->gr[gr].ch[ch].tt;
@@ -578,7 +583,7 @@ VBR_iteration_loop (lame_global_flags *gfp,
            */
 #else
           /* quality setting */
-          set_masking_lower( gfp->VBR_q,save_bits[gr][ch] );
+          set_masking_lower(gfp, gfp->VBR_q,save_bits[gr][ch] );
 #endif
           calc_xmin(gfp,xr[gr][ch], &ratio[gr][ch], cod_info, &l3_xmin);
 	
@@ -588,7 +593,7 @@ VBR_iteration_loop (lame_global_flags *gfp,
 	}
 #ifdef HAVEGTK
 	if (gfp->gtkflag)
-	  set_pinfo(cod_info, &ratio[gr][ch], &scalefac[gr][ch], xr[gr][ch], xfsf, noise, gr, ch);
+	  set_pinfo(gfp, cod_info, &ratio[gr][ch], &scalefac[gr][ch], xr[gr][ch], xfsf, noise, gr, ch);
 #endif
       }
     }
@@ -602,7 +607,7 @@ VBR_iteration_loop (lame_global_flags *gfp,
       cod_info = &l3_side->gr[gr].ch[ch].tt;
       best_scalefac_store(gfp,gr, ch, l3_enc, l3_side, scalefac);
       if (cod_info->block_type == NORM_TYPE) {
-	best_huffman_divide(gr, ch, cod_info, l3_enc[gr][ch]);
+	best_huffman_divide(gfp, gr, ch, cod_info, l3_enc[gr][ch]);
       }
 #ifdef HAVEGTK
       if (gfp->gtkflag)
@@ -751,6 +756,7 @@ void outer_loop(
     FLOAT8 xfsf[4][SBPSY_l],
     int ch)
 {
+  lame_internal_flags *gfc=gfp->internal_flags;
   III_scalefac_t scalefac_w;
   gr_info save_cod_info;
   int l3_enc_w[576]; 
@@ -758,6 +764,7 @@ void outer_loop(
   int status,bits_found=0;
   int huff_bits;
   FLOAT8 xrpow[576],temp;
+  FLOAT8 xrpow_max[SBLIMIT];
   int better;
   int over=0;
   FLOAT8 max_noise;
@@ -776,7 +783,6 @@ void outer_loop(
   /* BEGIN MAIN LOOP */
   iteration = 0;
   while ( notdone  ) {
-    static int OldValue[2] = {180, 180};
     int try_scale=0;
     iteration ++;
 
@@ -789,9 +795,10 @@ void outer_loop(
 	temp=fabs(xr[i]);
 	xrpow[i]=sqrt(sqrt(temp)*temp);
       }
-      bits_found=bin_search_StepSize2(gfp,targ_bits,OldValue[ch],
-				      l3_enc_w,xrpow,cod_info);
-      OldValue[ch] = cod_info->global_gain;
+      calc_xrpow_max(xrpow, xrpow_max);
+      bits_found=bin_search_StepSize2(gfp,targ_bits,gfc->OldValue[ch],
+				      l3_enc_w,xrpow,xrpow_max,cod_info);
+      gfc->OldValue[ch] = cod_info->global_gain;
     }
 
 
@@ -812,11 +819,11 @@ void outer_loop(
       if (iteration==1) {
 	if(bits_found>huff_bits) {
 	  cod_info->global_gain++;
-	  real_bits = inner_loop(gfp,xrpow, l3_enc_w, huff_bits, cod_info);
+	  real_bits = inner_loop(gfp,xrpow, xrpow_max, l3_enc_w, huff_bits, cod_info);
 	} else real_bits=bits_found;
       }
       else 
-	real_bits=inner_loop(gfp,xrpow, l3_enc_w, huff_bits, cod_info);
+	real_bits=inner_loop(gfp,xrpow, xrpow_max, l3_enc_w, huff_bits, cod_info);
       cod_info->part2_3_length = real_bits;
 
       /* compute the distortion in this quantization */
@@ -824,7 +831,7 @@ void outer_loop(
       	over=0;
       }else{
 	/* coefficients and thresholds both l/r (or both mid/side) */
-	over=calc_noise1( xr, l3_enc_w, cod_info, 
+	over=calc_noise1(gfp, xr, l3_enc_w, cod_info, 
 			  xfsf_w,distort, l3_xmin, &scalefac_w, &over_noise, 
 			  &tot_noise, &max_noise);
 
@@ -861,7 +868,8 @@ void outer_loop(
       if (over==0) notdone=0;
 
     if (notdone) {
-	amp_scalefac_bands( xrpow, cod_info, &scalefac_w, distort);
+	amp_scalefac_bands(gfp, xrpow, cod_info, &scalefac_w, distort);
+	calc_xrpow_max(xrpow, xrpow_max);
 	/* check to make sure we have not amplified too much */
 	/* loop_break returns 0 if there is an unamplified scalefac */
 	/* scale_bitcount returns 0 if no scalefactors are too large */
@@ -915,12 +923,13 @@ void outer_loop(
 /*            calc_noise                                                 */
 /*************************************************************************/
 /*  mt 5/99:  Function: Improved calc_noise for a single channel   */
-int calc_noise1( FLOAT8 xr[576], int ix[576], gr_info *cod_info,
+int calc_noise1( lame_global_flags *gfp,FLOAT8 xr[576], int ix[576], gr_info *cod_info,
 		 FLOAT8 xfsf[4][SBPSY_l], FLOAT8 distort[4][SBPSY_l],
 		 III_psy_xmin *l3_xmin, III_scalefac_t *scalefac,
 		 FLOAT8 *over_noise,
 		 FLOAT8 *tot_noise, FLOAT8 *max_noise)
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
     int start, end, l, i, over=0;
 	u_int sfb;
     FLOAT8 sum,step,bw;
@@ -946,8 +955,8 @@ int calc_noise1( FLOAT8 xr[576], int ix[576], gr_info *cod_info,
 	assert(s>=0);
 	step = POW20(s);
 
-	start = scalefac_band.l[ sfb ];
-        end   = scalefac_band.l[ sfb+1 ];
+	start = gfc->scalefac_band.l[ sfb ];
+        end   = gfc->scalefac_band.l[ sfb+1 ];
         bw = end - start;
 
 #ifdef RH_ATH
@@ -963,7 +972,7 @@ int calc_noise1( FLOAT8 xr[576], int ix[576], gr_info *cod_info,
 #elif RH_ATH
 	    temp = temp*temp;
             sum += temp;
-	    ath_max = Max( ath_max, temp/ATH_mdct_long[l] );
+	    ath_max = Max( ath_max, temp/gfc->ATH_mdct_long[l] );
 #else
             sum += temp * temp;
 #endif
@@ -1000,8 +1009,8 @@ int calc_noise1( FLOAT8 xr[576], int ix[576], gr_info *cod_info,
 	    assert(s<Q_MAX);
 	    assert(s>=0);
 	    step = POW20(s);
-	    start = scalefac_band.s[ sfb ];
-	    end   = scalefac_band.s[ sfb+1 ];
+	    start = gfc->scalefac_band.s[ sfb ];
+	    end   = gfc->scalefac_band.s[ sfb+1 ];
             bw = end - start;
 #ifdef RH_ATH
 	    ath_max = 0;
@@ -1015,7 +1024,7 @@ int calc_noise1( FLOAT8 xr[576], int ix[576], gr_info *cod_info,
 #elif RH_ATH
 		temp = temp*temp;
 		sum += temp;
-		ath_max = Max( ath_max, temp/ATH_mdct_short[l] );
+		ath_max = Max( ath_max, temp/gfc->ATH_mdct_short[l] );
 #else
 		sum += temp * temp;
 #endif
@@ -1058,11 +1067,12 @@ int calc_noise1( FLOAT8 xr[576], int ix[576], gr_info *cod_info,
   Amplify the scalefactor bands that violate the masking threshold.
   See ISO 11172-3 Section C.1.5.4.3.5
 */
-void amp_scalefac_bands(FLOAT8 xrpow[576], 
+void amp_scalefac_bands(lame_global_flags *gfp,FLOAT8 xrpow[576], 
 			gr_info *cod_info,
 			III_scalefac_t *scalefac,
 			FLOAT8 distort[4][SBPSY_l])
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
     int start, end, l,i;
 	u_int	sfb;
     FLOAT8 ifqstep34;
@@ -1093,8 +1103,8 @@ void amp_scalefac_bands(FLOAT8 xrpow[576],
     for ( sfb = 0; sfb < cod_info->sfb_lmax; sfb++ ) {
 	if ( distort[0][sfb]>distort_thresh  ) {
 	    scalefac->l[sfb]++;
-	    start = scalefac_band.l[sfb];
-	    end   = scalefac_band.l[sfb+1];
+	    start = gfc->scalefac_band.l[sfb];
+	    end   = gfc->scalefac_band.l[sfb+1];
 	    for ( l = start; l < end; l++ )
 		xrpow[l] *= ifqstep34;
 	}
@@ -1105,8 +1115,8 @@ void amp_scalefac_bands(FLOAT8 xrpow[576],
 	for ( sfb = cod_info->sfb_smax; sfb < 12; sfb++ ) {
             if ( distort[i+1][sfb]>distort_thresh) {
                 scalefac->s[sfb][i]++;
-                start = scalefac_band.s[sfb];
-                end   = scalefac_band.s[sfb+1];
+                start = gfc->scalefac_band.s[sfb];
+                end   = gfc->scalefac_band.s[sfb+1];
 		for (l = start; l < end; l++)
 		    xrpow[l * 3 + i] *= ifqstep34;
             }
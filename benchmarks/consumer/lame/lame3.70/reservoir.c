@@ -26,8 +26,7 @@
   Described in C.1.5.4.2.2 of the IS
 */
 
-static int ResvSize = 0; /* in bits */
-static int ResvMax  = 0; /* in bits */
+/* ResvSize and ResvMax (in bits) are kept in gfp->internal_flags */
 
 /*
   ResvFrameBegin:
@@ -38,11 +37,12 @@ static int ResvMax  = 0; /* in bits */
 int
 ResvFrameBegin(lame_global_flags *gfp,III_side_info_t *l3_side, int mean_bits, int frameLength )
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
     int fullFrameBits;
     int resvLimit;
 
     if (gfp->frameNum==0) {
-      ResvSize=0;
+      gfc->ResvSize=0;
     }
 
 
@@ -62,21 +62,27 @@ ResvFrameBegin(lame_global_flags *gfp,III_side_info_t *l3_side, int mean_bits, i
     */
 
 #ifdef DEBUG
-    fprintf( stderr, ">>> ResvSize = %d\n", ResvSize );
+    fprintf( stderr, ">>> ResvSize = %d\n", gfc->ResvSize );
 #endif
     /* check expected resvsize */
-    assert( (l3_side->main_data_begin * 8) == ResvSize );
-    fullFrameBits = mean_bits * gfp->mode_gr + ResvSize;
+    assert( (l3_side->main_data_begin * 8) == gfc->ResvSize );
+    fullFrameBits = mean_bits * gfp->mode_gr + gfc->ResvSize;
 
     /*
       determine maximum size of reservoir:
       ResvMax + frameLength <= 7680;
     */
     if ( frameLength > 7680 )
-	ResvMax = 0;
+	gfc->ResvMax = 0;
     else
-	ResvMax = 7680 - frameLength;
-    if (gfp->disable_reservoir) ResvMax=0;
+	gfc->ResvMax = 7680 - frameLength;
+    if (gfp->disable_reservoir) gfc->ResvMax=0;
+
+    /* lame_encode_segments(): a segment's first kept frame must not
+       refer to main data of the priming frames, and its last frame
+       must not leave main data for the next segment's encoder */
+    if (gfp->frameNum < gfc->ResvPrimeFrames || gfp->frameNum == gfc->ResvEndFrame)
+	gfc->ResvMax = 0;
 
 
     /*
@@ -84,13 +90,13 @@ ResvFrameBegin(lame_global_flags *gfp,III_side_info_t *l3_side, int mean_bits, i
       main_data_begin cannot indicate a
       larger value
       */
-    if ( ResvMax > resvLimit )
-	ResvMax = resvLimit;
+    if ( gfc->ResvMax > resvLimit )
+	gfc->ResvMax = resvLimit;
 
 #ifdef HAVEGTK
   if (gfp->gtkflag){
     pinfo->mean_bits=mean_bits/2;  /* expected bits per channel per granule */
-    pinfo->resvsize=ResvSize;
+    pinfo->resvsize=gfc->ResvSize;
   }
 #endif
 
@@ -103,13 +109,14 @@ ResvFrameBegin(lame_global_flags *gfp,III_side_info_t *l3_side, int mean_bits, i
   As above, but now it *really* is bits per granule (both channels).  
   Mark Taylor 4/99
 */
-void ResvMaxBits(int mean_bits, int *targ_bits, int *extra_bits, int gr)
+void ResvMaxBits(lame_global_flags *gfp,int mean_bits, int *targ_bits, int *extra_bits, int gr)
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
   int add_bits;
   *targ_bits = mean_bits ;
   /* extra bits if the reservoir is almost full */
-  if (ResvSize > ((ResvMax * 9) / 10)) {
-    add_bits= ResvSize-((ResvMax * 9) / 10);
+  if (gfc->ResvSize > ((gfc->ResvMax * 9) / 10)) {
+    add_bits= gfc->ResvSize-((gfc->ResvMax * 9) / 10);
     *targ_bits += add_bits;
   }else {
     add_bits =0 ;
@@ -122,7 +129,7 @@ void ResvMaxBits(int mean_bits, int *targ_bits, int *extra_bits, int gr)
   
   /* amount from the reservoir we are allowed to use. ISO says 6/10 */
   *extra_bits =    
-    (ResvSize  < (ResvMax*6)/10  ? ResvSize : (ResvMax*6)/10);
+    (gfc->ResvSize  < (gfc->ResvMax*6)/10  ? gfc->ResvSize : (gfc->ResvMax*6)/10);
   *extra_bits -= add_bits;
   
   if (*extra_bits < 0) *extra_bits=0;
@@ -138,7 +145,8 @@ void ResvMaxBits(int mean_bits, int *targ_bits, int *extra_bits, int gr)
 void
 ResvAdjust(lame_global_flags *gfp,gr_info *gi, III_side_info_t *l3_side, int mean_bits )
 {
-    ResvSize += (mean_bits / gfp->stereo) - gi->part2_3_length;
+    lame_internal_flags *gfc=gfp->internal_flags;
+    gfc->ResvSize += (mean_bits / gfp->stereo) - gi->part2_3_length;
 }
 
 
@@ -153,25 +161,26 @@ ResvAdjust(lame_global_flags *gfp,gr_info *gi, III_side_info_t *l3_side, int mea
 void
 ResvFrameEnd(lame_global_flags *gfp,III_side_info_t *l3_side, int mean_bits)
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
     int stuffingBits;
     int over_bits;
 
     /* just in case mean_bits is odd, this is necessary... */
     if ( gfp->stereo == 2 && mean_bits & 1)
-	ResvSize += 1;
+	gfc->ResvSize += 1;
 
-    over_bits = ResvSize - ResvMax;
+    over_bits = gfc->ResvSize - gfc->ResvMax;
     if ( over_bits < 0 )
 	over_bits = 0;
     
-    ResvSize -= over_bits;
+    gfc->ResvSize -= over_bits;
     stuffingBits = over_bits;
 
     /* we must be byte aligned */
-    if ( (over_bits = ResvSize % 8) )
+    if ( (over_bits = gfc->ResvSize % 8) )
     {
 	stuffingBits += over_bits;
-	ResvSize -= over_bits;
+	gfc->ResvSize -= over_bits;
     }
 
 
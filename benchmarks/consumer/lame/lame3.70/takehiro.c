@@ -89,9 +89,15 @@ struct
  Function: Count the number of bits necessary to code the subregion. 
 */
 
-static int cb_esc_buf[288];
-static int cb_esc_sign;
-static int *cb_esc_end;
+/* pairs packed by count_bit_(short_)noESC, so that the alternative
+ * tables can be tried by count_bit_noESC2 without rescanning ix.
+ * Lives on the stack of choose_table(), one per call. */
+typedef struct {
+    int buf[288];
+    int sign;
+    int *end;
+} cb_esc_t;
+
 static const int huf_tbl_noESC[15] = {
     1, 2, 5, 7, 7,10,10,13,13,13,13,13,13,13,13
 };
@@ -144,12 +150,12 @@ count_bit_ESC(int *ix, int *end, int t1, int t2, int *s)
 }
 
  static int
-count_bit_noESC(int *ix, int *end, unsigned int table) 
+count_bit_noESC(cb_esc_t *cb, int *ix, int *end, unsigned int table) 
 {
     /* No ESC-words */
     int	sum = 0, sign = 0;
     unsigned char *hlen = ht[table].hlen;
-    int *p = cb_esc_buf;
+    int *p = cb->buf;
 
     do {
 	int x = *ix++;
@@ -168,23 +174,23 @@ count_bit_noESC(int *ix, int *end, unsigned int table)
 	sum += hlen[x];
     } while (ix < end);
 
-    cb_esc_sign = sign;
-    cb_esc_end = p;
+    cb->sign = sign;
+    cb->end = p;
     return sum + sign;
 }
 
 
 
  static int
-count_bit_noESC2(unsigned int table) 
+count_bit_noESC2(cb_esc_t *cb, unsigned int table) 
 {
     /* No ESC-words */
-    int	sum = cb_esc_sign;
-    int *p = cb_esc_buf;
+    int	sum = cb->sign;
+    int *p = cb->buf;
 
     do {
 	sum += ht[table].hlen[*p++];
-    } while (p < cb_esc_end);
+    } while (p < cb->end);
 
     return sum;
 }
@@ -245,12 +251,12 @@ count_bit_short_ESC(int *ix, int *end, int t1, int t2, int *s)
 
 
  static int
-count_bit_short_noESC(int *ix, int *end, unsigned int table) 
+count_bit_short_noESC(cb_esc_t *cb, int *ix, int *end, unsigned int table) 
 {
     /* No ESC-words */
     int	sum = 0, sign = 0;
     unsigned char *hlen = ht[table].hlen;
-    int *p = cb_esc_buf;
+    int *p = cb->buf;
 
     do {
 	int i;
@@ -273,8 +279,8 @@ count_bit_short_noESC(int *ix, int *end, unsigned int table)
 	ix += 3;
     } while (ix < end);
 
-    cb_esc_sign = sign;
-    cb_esc_end = p;
+    cb->sign = sign;
+    cb->end = p;
     return sum + sign;
 }
 
@@ -298,6 +304,7 @@ static int choose_table(int *ix, int *end, int *s)
     int max;
     int choice0, sum0;
     int choice1, sum1;
+    cb_esc_t cb;
 
     max = ix_max(ix, end);
 
@@ -312,14 +319,14 @@ static int choose_table(int *ix, int *end, int *s)
 	}
 	/* try tables with no linbits */
 	choice0 = huf_tbl_noESC[max - 1];
-	sum0 = count_bit_noESC(ix, end, choice0);
+	sum0 = count_bit_noESC(&cb, ix, end, choice0);
 	choice1 = choice0;
 
 	switch (choice0) {
 	case 7:
 	case 10:
 	    choice1++;
-	    sum1 = count_bit_noESC2(choice1);
+	    sum1 = count_bit_noESC2(&cb, choice1);
 	    if (sum0 > sum1) {
 		sum0 = sum1;
 		choice0 = choice1;
@@ -328,7 +335,7 @@ static int choose_table(int *ix, int *end, int *s)
 	case 2:
 	case 5:
 	    choice1++;
-	    sum1 = count_bit_noESC2(choice1);
+	    sum1 = count_bit_noESC2(&cb, choice1);
 	    if (sum0 > sum1) {
 		sum0 = sum1;
 		choice0 = choice1;
@@ -337,7 +344,7 @@ static int choose_table(int *ix, int *end, int *s)
 
 	case 13:
 	    choice1 += 2;
-	    sum1 = count_bit_noESC2(choice1);
+	    sum1 = count_bit_noESC2(&cb, choice1);
 	    if (sum0 > sum1) {
 		sum0 = sum1;
 		choice0 = choice1;
@@ -375,6 +382,7 @@ static int choose_table_short(int *ix, int *end, int * s)
     int max;
     int choice0, sum0;
     int choice1, sum1;
+    cb_esc_t cb;
 
     max = ix_max(ix, end);
 
@@ -389,14 +397,14 @@ static int choose_table_short(int *ix, int *end, int * s)
 	}
 	/* try tables with no linbits */
 	choice0 = huf_tbl_noESC[max - 1];
-	sum0 = count_bit_short_noESC(ix, end, choice0);
+	sum0 = count_bit_short_noESC(&cb, ix, end, choice0);
 	choice1 = choice0;
 
 	switch (choice0) {
 	case 7:
 	case 10:
 	    choice1++;
-	    sum1 = count_bit_noESC2(choice1);
+	    sum1 = count_bit_noESC2(&cb, choice1);
 	    if (sum0 > sum1) {
 		sum0 = sum1;
 		choice0 = choice1;
@@ -405,7 +413,7 @@ static int choose_table_short(int *ix, int *end, int * s)
 	case 2:
 	case 5:
 	    choice1++;
-	    sum1 = count_bit_noESC2(choice1);
+	    sum1 = count_bit_noESC2(&cb, choice1);
 	    if (sum0 > sum1) {
 		sum0 = sum1;
 		choice0 = choice1;
@@ -414,7 +422,7 @@ static int choose_table_short(int *ix, int *end, int * s)
 
 	case 13:
 	    choice1 += 2;
-	    sum1 = count_bit_noESC2(choice1);
+	    sum1 = count_bit_noESC2(&cb, choice1);
 	    if (sum0 > sum1) {
 		sum0 = sum1;
 		choice0 = choice1;
@@ -447,8 +455,9 @@ static int choose_table_short(int *ix, int *end, int * s)
 
 
 
-static int count_bits_long(int ix[576], gr_info *gi)
+static int count_bits_long(lame_global_flags *gfp,int ix[576], gr_info *gi)
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
     int i, a1, a2;
     int bits = 0;
 
@@ -507,27 +516,27 @@ static int count_bits_long(int ix[576], gr_info *gi)
 	int index;
 	int scfb_anz = 0;
 
-	while (scalefac_band.l[++scfb_anz] < i) 
+	while (gfc->scalefac_band.l[++scfb_anz] < i) 
 	    ;
 	index = subdv_table[scfb_anz].region0_count;
-	while (scalefac_band.l[index + 1] > i)
+	while (gfc->scalefac_band.l[index + 1] > i)
 	    index--;
 	gi->region0_count = index;
 
 	index = subdv_table[scfb_anz].region1_count;
-	while (scalefac_band.l[index + gi->region0_count + 2] > i)
+	while (gfc->scalefac_band.l[index + gi->region0_count + 2] > i)
 	    index--;
 	gi->region1_count = index;
 
-	a1 = scalefac_band.l[gi->region0_count + 1];
-	a2 = scalefac_band.l[index + gi->region0_count + 2];
+	a1 = gfc->scalefac_band.l[gi->region0_count + 1];
+	a2 = gfc->scalefac_band.l[index + gi->region0_count + 2];
 	gi->table_select[2] = choose_table(ix + a2, ix + i, &bits);
 
     } else {
 	gi->region0_count = 7;
 	/*gi->region1_count = SBPSY_l - 7 - 1;*/
 	gi->region1_count = SBMAX_l -1 - 7 - 1;
-	a1 = scalefac_band.l[7 + 1];
+	a1 = gfc->scalefac_band.l[7 + 1];
 	a2 = i;
 	if (a1 > a2) {
 	    a1 = a2;
@@ -543,19 +552,19 @@ static int count_bits_long(int ix[576], gr_info *gi)
 
 
 
-int count_bits(lame_global_flags *gfp,int *ix, FLOAT8 *xr, gr_info *cod_info)  
+int count_bits(lame_global_flags *gfp,int *ix, FLOAT8 *xr, FLOAT8 xr_max[SBLIMIT], gr_info *cod_info)  
 {
   int bits=0,i;
   /* since quantize_xrpow uses table lookup, we need to check this first: */
   FLOAT8 w = (IXMAX_VAL) / IPOW20(cod_info->global_gain);
-  for ( i = 0; i < 576; i++ )  {
-    if (xr[i] > w)
+  for ( i = 0; i < SBLIMIT; i++ )  {
+    if (xr_max[i] > w)
       return 100000;
   }
   if (gfp->quantization) 
-    quantize_xrpow(xr, ix, cod_info);
+    quantize_xrpow(xr, xr_max, ix, cod_info);
   else
-    quantize_xrpow_ISO(xr, ix, cod_info);
+    quantize_xrpow_ISO(xr, xr_max, ix, cod_info);
 
 
 
@@ -564,7 +573,7 @@ int count_bits(lame_global_flags *gfp,int *ix, FLOAT8 *xr, gr_info *cod_info)
     cod_info->table_select[1] = choose_table_short(ix + 36, ix + 576, &bits);
     cod_info->big_values = 288;
   }else{
-    bits=count_bits_long(ix, cod_info);
+    bits=count_bits_long(gfp, ix, cod_info);
     cod_info->count1 = (cod_info->count1 - cod_info->big_values) / 4;
     cod_info->big_values /= 2;
   }
@@ -572,37 +581,208 @@ int count_bits(lame_global_flags *gfp,int *ix, FLOAT8 *xr, gr_info *cod_info)
 
 }
 
-void best_huffman_divide(int gr, int ch, gr_info *gi, int *ix)
+/*************************************************************************/
+/*	      per-band Huffman costs for best_huffman_divide		 */
+/*************************************************************************/
+
+/*
+  best_huffman_divide() tries every region0/region1 split, and each try
+  used to rescan ix for every table.  All region boundaries it tries are
+  scalefactor band boundaries (or bigv), so the per-band sums are
+  counted once and a region's cost is the difference of two prefix sums.
+  choose_table_band() then makes exactly the choice choose_table() would.
+*/
+
+/* the non-ESC tables choose_table() may try, and the largest ix each
+   can code, in order of increasing capacity */
+static const int hb_tbl[13]  = { 1, 2, 3, 5, 6, 7, 8, 9,10,11,12,13,15 };
+static const int hb_cap[13]  = { 1, 2, 2, 3, 3, 5, 5, 5, 7, 7, 7,15,15 };
+
+typedef struct {
+    int nband;
+    int max[SBMAX_l + 1];          /* largest ix of band k */
+    /* prefix sums over bands 0..k-1 */
+    int sign[SBMAX_l + 2];         /* nonzero ix */
+    int nesc[SBMAX_l + 2];         /* ix > 14 */
+    int hlen[SBMAX_l + 2][32];     /* ht[t].hlen, ESC tables with x,y clipped to 15 */
+} huff_band_t;
+
+static void
+huff_band_count(lame_internal_flags *gfc, int *ix, int bigv, huff_band_t *hb)
 {
+    int k, i, t, esc = 0;
+
+    for (k = 0; k < SBMAX_l && gfc->scalefac_band.l[k] < bigv; k++) {
+	int end = Min(gfc->scalefac_band.l[k + 1], bigv);
+	int max = 0;
+	for (i = gfc->scalefac_band.l[k]; i < end; i++)
+	    if (max < ix[i])
+		max = ix[i];
+	hb->max[k] = max;
+	if (max > 15)
+	    esc = 1;
+    }
+    hb->nband = k;
+
+    hb->sign[0] = hb->nesc[0] = 0;
+    memset(hb->hlen[0], 0, sizeof(hb->hlen[0]));
+    for (k = 0; k < hb->nband; k++) {
+	int end = Min(gfc->scalefac_band.l[k + 1], bigv);
+	int sign = 0, nesc = 0, h16 = 0, h24 = 0;
+	int first;
+
+	memcpy(hb->hlen[k + 1], hb->hlen[k], sizeof(hb->hlen[0]));
+	/* tables which cannot code this band are never read for it */
+	for (first = 0; first < 13 && hb_cap[first] < hb->max[k]; first++)
+	    ;
+	for (i = gfc->scalefac_band.l[k]; i < end; i += 2) {
+	    int x = ix[i], y = ix[i + 1];
+	    if (x != 0) sign++;
+	    if (y != 0) sign++;
+	    if (esc) {
+		int xe = x, ye = y;
+		if (xe > 14) { xe = 15; nesc++; }
+		if (ye > 14) { ye = 15; nesc++; }
+		h16 += ht[16].hlen[xe * 16 + ye];
+		h24 += ht[24].hlen[xe * 16 + ye];
+	    }
+	    for (t = first; t < 13; t++)
+		hb->hlen[k + 1][hb_tbl[t]] += ht[hb_tbl[t]].hlen[x * 16 + y];
+	}
+	hb->sign[k + 1] = hb->sign[k] + sign;
+	hb->nesc[k + 1] = hb->nesc[k] + nesc;
+	hb->hlen[k + 1][16] += h16;
+	hb->hlen[k + 1][24] += h24;
+    }
+}
+
+#define HB_SUM(hb, t, kb, ke) ((hb)->hlen[ke][t] - (hb)->hlen[kb][t])
+
+/* choose_table() for ix[l[kb]..l[ke]], from the band sums */
+static int choose_table_band(huff_band_t *hb, int kb, int ke, int *s)
+{
+    int k, max = 0;
+    int choice0, sum0;
+    int choice1, sum1;
+    int sign;
+
+    for (k = kb; k < ke; k++)
+	if (max < hb->max[k])
+	    max = hb->max[k];
+
+    if (max > IXMAX_VAL) {
+        *s = 100000;
+        return -1;
+    }
+
+    sign = hb->sign[ke] - hb->sign[kb];
+    if (max <= 15)  {
+	if (max == 0) {
+	    return 0;
+	}
+	choice0 = huf_tbl_noESC[max - 1];
+	sum0 = HB_SUM(hb, choice0, kb, ke) + sign;
+	choice1 = choice0;
+
+	switch (choice0) {
+	case 7:
+	case 10:
+	    choice1++;
+	    sum1 = HB_SUM(hb, choice1, kb, ke) + sign;
+	    if (sum0 > sum1) {
+		sum0 = sum1;
+		choice0 = choice1;
+	    }
+	    /*fall*/
+	case 2:
+	case 5:
+	    choice1++;
+	    sum1 = HB_SUM(hb, choice1, kb, ke) + sign;
+	    if (sum0 > sum1) {
+		sum0 = sum1;
+		choice0 = choice1;
+	    }
+	    break;
+
+	case 13:
+	    choice1 += 2;
+	    sum1 = HB_SUM(hb, choice1, kb, ke) + sign;
+	    if (sum0 > sum1) {
+		sum0 = sum1;
+		choice0 = choice1;
+	    }
+	    break;
+
+	default:
+	    break;
+	}
+	*s += sum0;
+    } else {
+	int nesc = hb->nesc[ke] - hb->nesc[kb];
+	max -= 15;
+
+	for (choice1 = 24; choice1 < 32; choice1++) {
+	    if ((int)ht[choice1].linmax >= max) {
+		break;
+	    }
+	}
+
+	for (choice0 = choice1 - 8; choice0 < 24; choice0++) {
+	    if ((int)ht[choice0].linmax >= max) {
+		break;
+	    }
+	}
+
+	/* same as count_bit_ESC() */
+	sum0 = HB_SUM(hb, 16, kb, ke) + nesc * (int)ht[choice0].xlen;
+	sum1 = HB_SUM(hb, 24, kb, ke) + nesc * (int)ht[choice1].xlen;
+	if (sum0 > sum1) {
+	    sum0 = sum1;
+	    choice0 = choice1;
+	}
+	*s += sign + sum0;
+    }
+
+    return choice0;
+}
+
+
+
+void best_huffman_divide(lame_global_flags *gfp,int gr, int ch, gr_info *gi, int *ix)
+{
+    lame_internal_flags *gfc=gfp->internal_flags;
     int *bits, r0, r1, a1, a2, bigv;
     int r1_bits;
     int r3_bits[7 + 15 + 2 + 1];
     int r3_tbl[7 + 15 + 2 + 1];
     gr_info cod_info;
+    huff_band_t hb;
 
     memcpy(&cod_info, gi, sizeof(gr_info));
     bigv = cod_info.big_values * 2;
     bits = (int *) &cod_info.part2_3_length;
 
+    huff_band_count(gfc, ix, bigv, &hb);
+
     for (r0 = 2; r0 < SBMAX_l + 1; r0++) {
-	a2 = scalefac_band.l[r0];
+	a2 = gfc->scalefac_band.l[r0];
 	if (a2 > bigv)
 	    break;
 
 	r3_bits[r0] = cod_info.count1bits + cod_info.part2_length;
-	r3_tbl[r0] = choose_table(ix + a2, ix + bigv, &r3_bits[r0]);
+	r3_tbl[r0] = choose_table_band(&hb, r0, hb.nband, &r3_bits[r0]);
     }
     for (; r0 <= 7 + 15 + 2; r0++) {
 	r3_bits[r0] = 100000;
     }
 
     for (r0 = 0; r0 < 16; r0++) {
-	a1 = scalefac_band.l[r0 + 1];
+	a1 = gfc->scalefac_band.l[r0 + 1];
 	if (a1 > bigv)
 	    break;
 	cod_info.region0_count = r0;
 	r1_bits = 0;
-	cod_info.table_select[0] = choose_table(ix, ix + a1, &r1_bits);
+	cod_info.table_select[0] = choose_table_band(&hb, 0, r0 + 1, &r1_bits);
 	if ((int)gi->part2_3_length < r1_bits)
 	    break;
 
@@ -611,9 +791,7 @@ void best_huffman_divide(int gr, int ch, gr_info *gi, int *ix)
 	    if ((int)gi->part2_3_length < *bits)
 		continue;
 
-	    a2 = scalefac_band.l[r0 + r1 + 2];
-
-	    cod_info.table_select[1] = choose_table(ix + a1, ix + a2, bits);
+	    cod_info.table_select[1] = choose_table_band(&hb, r0 + 1, r0 + r1 + 2, bits);
 	    if ((int)gi->part2_3_length < *bits)
 		continue;
 
@@ -690,6 +868,7 @@ void best_scalefac_store(lame_global_flags *gfp,int gr, int ch,
 			 III_side_info_t *l3_side,
 			 III_scalefac_t scalefac[2][2])
 {
+    lame_internal_flags *gfc=gfp->internal_flags;
     /* use scalefac_scale if we can */
     gr_info *gi = &l3_side->gr[gr].ch[ch].tt;
 
@@ -699,8 +878,8 @@ void best_scalefac_store(lame_global_flags *gfp,int gr, int ch,
     /* check if l3_enc=0 */
     for ( sfb = 0; sfb < gi->sfb_lmax; sfb++ ) {
       if (scalefac[gr][ch].l[sfb]>0) { 
-	start = scalefac_band.l[ sfb ];
-	end   = scalefac_band.l[ sfb+1 ];
+	start = gfc->scalefac_band.l[ sfb ];
+	end   = gfc->scalefac_band.l[ sfb+1 ];
 	for ( l = start; l < end; l++ ) if (l3_enc[gr][ch][l]!=0) break;
 	if (l==end) scalefac[gr][ch].l[sfb]=0;
       }
@@ -708,8 +887,8 @@ void best_scalefac_store(lame_global_flags *gfp,int gr, int ch,
     for ( i = 0; i < 3; i++ ) {
       for ( sfb = gi->sfb_smax; sfb < SBPSY_s; sfb++ ) {
 	if (scalefac[gr][ch].s[sfb][i]>0) {
-	  start = scalefac_band.s[ sfb ];
-	  end   = scalefac_band.s[ sfb+1 ];
+	  start = gfc->scalefac_band.s[ sfb ];
+	  end   = gfc->scalefac_band.s[ sfb+1 ];
 	  for ( l = start; l < end; l++ ) 
 	    if (l3_enc[gr][ch][3*l+i]!=0) break;
 	  if (l==end) scalefac[gr][ch].s[sfb][i]=0;
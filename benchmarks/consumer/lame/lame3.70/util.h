@@ -124,6 +124,146 @@ typedef struct  bit_stream_struc {
 } Bit_stream_struc;
 
 #include "l3side.h"
+#include "formatBitstream.h"
+#include "id3tag.h"
+
+
+struct scalefac_struct
+{
+   int l[1+SBMAX_l];
+   int s[1+SBMAX_s];
+};
+
+
+#define MFSIZE (1152+1152+ENCDELAY-MDCTDELAY)
+#define OLDBUFSIZE 5
+
+
+/***********************************************************************
+*
+*  Per-stream encoder state.
+*
+*  Everything an encode needs to remember from one frame to the next
+*  lives here, so that several lame_global_flags can encode in the
+*  same process (one thread each).  Allocated by lame_init(),
+*  released by lame_close().  Tables which depend only on constants
+*  (pow43, fft window, polyphase window, ...) are not in here: they are
+*  computed once per process and shared read-only.
+*
+***********************************************************************/
+typedef struct lame_internal_flags {
+
+  /* lame.c: bitstream, side info and input buffering */
+  Bit_stream_struc bs;
+  III_side_info_t l3_side;
+  short int mfbuf[2][MFSIZE];
+  int mf_size;
+  int mf_samples_to_encode;
+  int frame_buffered;
+
+  /* lame.c: frame padding and bit accounting */
+  unsigned long frameBits;
+  unsigned long bitsPerSlot;
+  FLOAT8 frac_SpF;
+  FLOAT8 slot_lag;
+  unsigned long sentBits;
+  FLOAT8 ms_ratio[2];
+  FLOAT8 ms_ener_ratio[2];
+
+  /* lame.c: fill_buffer_resample() */
+  FLOAT8 itime[2];
+  short int inbuf_old[2][OLDBUFSIZE];
+  int resample_init[2];
+
+  /* psymodel.c */
+  FLOAT8 minval[CBANDS],qthr_l[CBANDS];
+  FLOAT8 qthr_s[CBANDS];
+  FLOAT8 nb_1[4][CBANDS], nb_2[4][CBANDS];
+  FLOAT8 s3_s[CBANDS + 1][CBANDS + 1];
+  FLOAT8 s3_l[CBANDS + 1][CBANDS + 1];
+  III_psy_xmin thm[4];
+  III_psy_xmin en[4];
+  int cw_upper_index;
+  int cw_lower_index;
+  FLOAT ax_sav[4][2][HBLKSIZE];
+  FLOAT bx_sav[4][2][HBLKSIZE];
+  FLOAT rx_sav[4][2][HBLKSIZE];
+  FLOAT cw[HBLKSIZE];
+  FLOAT8 w1_l[SBPSY_l], w2_l[SBPSY_l];
+  FLOAT8 w1_s[SBPSY_s], w2_s[SBPSY_s];
+  FLOAT8 mld_l[SBPSY_l],mld_s[SBPSY_s];
+  int bu_l[SBPSY_l],bo_l[SBPSY_l] ;
+  int bu_s[SBPSY_s],bo_s[SBPSY_s] ;
+  int npart_l,npart_s;
+  int npart_l_orig,npart_s_orig;
+  int s3ind[CBANDS][2];
+  int s3ind_s[CBANDS][2];
+  int numlines_s[CBANDS] ;
+  int numlines_l[CBANDS];
+  int partition_l[HBLKSIZE];
+  FLOAT energy_save[4][HBLKSIZE];   /* frame analyzer only */
+  FLOAT8 pe_save[4];
+  FLOAT8 ers_save[4];
+  FLOAT8 pe[4];
+  FLOAT8 ms_ratio_s_old,ms_ratio_l_old;
+  FLOAT8 ms_ener_ratio_old;
+  int blocktype_old[2];
+
+  /* newmdct.c */
+  FLOAT8 sb_sample[2][2][18][SBLIMIT];
+
+  /* quantize.c, quantize-pvt.c */
+  struct scalefac_struct scalefac_band;
+  FLOAT masking_lower;
+  int convert_mdct, reduce_sidechannel;
+  FLOAT8 ATH_l[SBPSY_l];
+  FLOAT8 ATH_s[SBPSY_l];
+  FLOAT8 ATH_mdct_long[576];        /* RH_ATH only */
+  FLOAT8 ATH_mdct_short[192];
+  int OldValue[2];
+  int CurrentStep;
+
+  /* reservoir.c */
+  int ResvSize; /* in bits */
+  int ResvMax;  /* in bits */
+  int ResvPrimeFrames;  /* no reservoir in frames 0..ResvPrimeFrames-1 */
+  long ResvEndFrame;    /* and none left after this one (-1: none) */
+
+  /* l3bitstream.c */
+  BF_FrameData    *frameData;
+  BF_FrameResults *frameResults;
+  int PartHoldersInitialized;
+  BF_PartHolder *headerPH;
+  BF_PartHolder *frameSIPH;
+  BF_PartHolder *channelSIPH[ MAX_CHANNELS ];
+  BF_PartHolder *spectrumSIPH[ MAX_GRANULES ][ MAX_CHANNELS ];
+  BF_PartHolder *scaleFactorsPH[ MAX_GRANULES ][ MAX_CHANNELS ];
+  BF_PartHolder *codedDataPH[ MAX_GRANULES ][ MAX_CHANNELS ];
+  BF_PartHolder *userSpectrumPH[ MAX_GRANULES ][ MAX_CHANNELS ];
+  BF_PartHolder *userFrameDataPH;
+
+  /* formatBitstream.c */
+  int BitCount;
+  int ThisFrameSize;
+  int BitsRemaining;
+  int elements, forwardFrameLength, forwardSILength;
+  struct side_info_link *side_queue_head;
+  struct side_info_link *side_queue_free;
+
+  /* VbrTag.c */
+  int nZeroStreamSize;
+  int TotalFrameSize;
+  int *pVbrFrames;
+  int nVbrNumFrames;
+  int nVbrFrameBufferSize;
+
+  /* id3 tag, written by lame_mp3_tags() */
+  ID3TAGDATA id3tag;
+
+  /* lame.c: quantizer thread, only if gfp->pipeline */
+  struct lame_pipeline *pipe;
+
+} lame_internal_flags;
 
 /***********************************************************************
 *
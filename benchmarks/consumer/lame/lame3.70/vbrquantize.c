@@ -243,6 +243,7 @@ VBR_iteration_loop_new (lame_global_flags *gfp,
                 III_side_info_t * l3_side, int l3_enc[2][2][576],
                 III_scalefac_t scalefac[2][2])
 {
+  lame_internal_flags *gfc=gfp->internal_flags;
   III_psy_xmin l3_xmin[2][2];
   FLOAT8    masking_lower_db;
   FLOAT8    ifqstep;
@@ -257,12 +258,12 @@ VBR_iteration_loop_new (lame_global_flags *gfp,
   /* db_lower varies from -10 to +8 db */
   masking_lower_db = -10 + 2*gfp->VBR_q;
   /* adjust by -6(min)..0(max) depending on bitrate */
-  masking_lower = pow(10.0,masking_lower_db/10);
-  masking_lower = 1;
+  gfc->masking_lower = pow(10.0,masking_lower_db/10);
+  gfc->masking_lower = 1;
 
 
   for (gr = 0; gr < gfp->mode_gr; gr++) {
-    if (convert_mdct)
+    if (gfc->convert_mdct)
       ms_convert(xr[gr],xr[gr]);
     for (ch = 0; ch < gfp->stereo; ch++) { 
       FLOAT8 xr34[576];
@@ -282,21 +283,21 @@ VBR_iteration_loop_new (lame_global_flags *gfp,
       if (shortblock) {
 	for ( sfb = 0; sfb < SBPSY_s; sfb++ )  {
 	  for ( i = 0; i < 3; i++ ) {
-	    start = scalefac_band.s[ sfb ];
-	    end   = scalefac_band.s[ sfb+1 ];
+	    start = gfc->scalefac_band.s[ sfb ];
+	    end   = gfc->scalefac_band.s[ sfb+1 ];
 	    bw = end - start;
 	    vbrsf.s[sfb][i] = find_scalefac(&xr[gr][ch][3*start+i],&xr34[3*start+i],3,sfb,
-		   masking_lower*l3_xmin[gr][ch].s[sfb][i],bw);
+		   gfc->masking_lower*l3_xmin[gr][ch].s[sfb][i],bw);
 	    if (vbrsf.s[sfb][i]>vbrmax) vbrmax=vbrsf.s[sfb][i];
 	  }
 	}
       }else{
 	for ( sfb = 0; sfb < SBPSY_l; sfb++ )   {
-	  start = scalefac_band.l[ sfb ];
-	  end   = scalefac_band.l[ sfb+1 ];
+	  start = gfc->scalefac_band.l[ sfb ];
+	  end   = gfc->scalefac_band.l[ sfb+1 ];
 	  bw = end - start;
 	  vbrsf.l[sfb] = find_scalefac(&xr[gr][ch][start],&xr34[start],1,sfb,
-	  		 masking_lower*l3_xmin[gr][ch].l[sfb],bw);
+	  		 gfc->masking_lower*l3_xmin[gr][ch].l[sfb],bw);
 	  if (vbrsf.l[sfb]>vbrmax) vbrmax = vbrsf.l[sfb];
 	}
 
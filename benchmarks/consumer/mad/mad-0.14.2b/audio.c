@@ -27,6 +27,10 @@
 
 # include <string.h>
 
+# if defined(__SSE2__)
+#  include <emmintrin.h>
+# endif
+
 # include "audio.h"
 # include "mad.h"
 
@@ -232,16 +236,15 @@ unsigned long prng(unsigned long state)
 }
 
 /*
- * NAME:	audio_linear_dither()
- * DESCRIPTION:	generic linear sample quantize and dither routine
+ * NAME:	shape()
+ * DESCRIPTION:	noise shape, clip and quantize a sample with the given dither
  */
-inline
-signed long audio_linear_dither(unsigned int bits, mad_fixed_t sample,
-				struct audio_dither *dither,
-				struct audio_stats *stats)
+static inline
+signed long shape(unsigned int bits, mad_fixed_t sample, mad_fixed_t noise,
+		  struct audio_dither *dither, struct audio_stats *stats)
 {
   unsigned int scalebits;
-  mad_fixed_t output, mask, random;
+  mad_fixed_t output, mask;
 
   enum {
     MIN = -MAD_F_ONE,
@@ -254,17 +257,11 @@ signed long audio_linear_dither(unsigned int bits, mad_fixed_t sample,
   dither->error[2] = dither->error[1];
   dither->error[1] = dither->error[0] / 2;
 
-  /* bias */
-  output = sample + (1L << (MAD_F_FRACBITS + 1 - bits - 1));
-
   scalebits = MAD_F_FRACBITS + 1 - bits;
   mask = (1L << scalebits) - 1;
 
-  /* dither */
-  random  = prng(dither->random);
-  output += (random & mask) - (dither->random & mask);
-
-  dither->random = random;
+  /* bias and dither */
+  output = sample + noise;
 
   /* clip */
   if (output >= stats->peak_sample) {
@@ -305,374 +302,540 @@ signed long audio_linear_dither(unsigned int bits, mad_fixed_t sample,
 }
 
 /*
- * NAME:	audio_pcm_u8()
- * DESCRIPTION:	write a block of unsigned 8-bit PCM samples
+ * NAME:	audio_linear_dither()
+ * DESCRIPTION:	generic linear sample quantize and dither routine
  */
-unsigned int audio_pcm_u8(unsigned char *data, unsigned int nsamples,
-			  mad_fixed_t const *left, mad_fixed_t const *right,
-			  enum audio_mode mode, struct audio_stats *stats)
+inline
+signed long audio_linear_dither(unsigned int bits, mad_fixed_t sample,
+				struct audio_dither *dither,
+				struct audio_stats *stats)
 {
-  unsigned int len;
-
-  len = nsamples;
-
-  if (right) {  /* stereo */
-    switch (mode) {
-    case AUDIO_MODE_ROUND:
-      while (len--) {
-	data[0] = audio_linear_round(8, *left++,  stats) ^ 0x80;
-	data[1] = audio_linear_round(8, *right++, stats) ^ 0x80;
+  unsigned int scalebits;
+  mad_fixed_t noise, mask, random;
 
-	data += 2;
-      }
-      break;
+  scalebits = MAD_F_FRACBITS + 1 - bits;
+  mask = (1L << scalebits) - 1;
 
-    case AUDIO_MODE_DITHER:
-      while (len--) {
-	data[0] = audio_linear_dither(8, *left++,
-				      &left_dither,  stats) ^ 0x80;
-	data[1] = audio_linear_dither(8, *right++,
-				      &right_dither, stats) ^ 0x80;
+  /* bias */
+  noise = 1L << (scalebits - 1);
 
-	data += 2;
-      }
-      break;
+  /* dither */
+  random = prng(dither->random);
+  noise += (random & mask) - (dither->random & mask);
 
-    default:
-      return 0;
-    }
+  dither->random = random;
 
-    return nsamples * 2;
-  }
-  else {  /* mono */
-    switch (mode) {
-    case AUDIO_MODE_ROUND:
-      while (len--)
-	*data++ = audio_linear_round(8, *left++, stats) ^ 0x80;
-      break;
+  return shape(bits, sample, noise, dither, stats);
+}
 
-    case AUDIO_MODE_DITHER:
-      while (len--)
-	*data++ = audio_linear_dither(8, *left++, &left_dither, stats) ^ 0x80;
-      break;
+# if defined(__SSE2__)
+/*
+ * NAME:	mul32()
+ * DESCRIPTION:	multiply four 32-bit lanes modulo 2^32
+ */
+static inline
+__m128i mul32(__m128i x, __m128i y)
+{
+  __m128i even, odd;
 
-    default:
-      return 0;
-    }
+  even = _mm_mul_epu32(x, y);
+  odd  = _mm_mul_epu32(_mm_srli_epi64(x, 32), _mm_srli_epi64(y, 32));
 
-    return nsamples;
-  }
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+			    _mm_shuffle_epi32(odd,  _MM_SHUFFLE(0, 0, 2, 0)));
 }
+# endif
 
 /*
- * NAME:	audio_pcm_s8()
- * DESCRIPTION:	write a block of signed 8-bit PCM samples
+ * NAME:	dither_noise()
+ * DESCRIPTION:	generate the bias and dither for a block of samples
  */
-unsigned int audio_pcm_s8(unsigned char *data, unsigned int nsamples,
-			  mad_fixed_t const *left, mad_fixed_t const *right,
-			  enum audio_mode mode, struct audio_stats *stats)
+static
+void dither_noise(unsigned int bits, unsigned int nsamples,
+		  struct audio_dither *dither, mad_fixed_t *noise)
 {
-  unsigned int len;
+  unsigned int scalebits, i = 0;
+  mad_fixed_t bias, mask;
+  unsigned long state, random;
 
-  len = nsamples;
+  scalebits = MAD_F_FRACBITS + 1 - bits;
+  mask = (1L << scalebits) - 1;
+  bias = 1L << (scalebits - 1);
 
-  if (right) {  /* stereo */
-    switch (mode) {
-    case AUDIO_MODE_ROUND:
-      while (len--) {
-	data[0] = audio_linear_round(8, *left++,  stats);
-	data[1] = audio_linear_round(8, *right++, stats);
+  state = (unsigned long) dither->random & 0xffffffffL;
 
-	data += 2;
-      }
-      break;
+# if defined(__SSE2__)
+  if (nsamples >= 4) {
+    __m128i vbias, vmask, step, offset, current, previous;
+    unsigned long r[4];
 
-    case AUDIO_MODE_DITHER:
-      while (len--) {
-	data[0] = audio_linear_dither(8, *left++,
-				      &left_dither,  stats);
-	data[1] = audio_linear_dither(8, *right++,
-				      &right_dither, stats);
+    /*
+     * Four generators run in lockstep, each advancing four places at a
+     * time: x' = a^4 x + c (a^3 + a^2 + a + 1), all modulo 2^32.
+     */
 
-	data += 2;
-      }
-      break;
+    vbias  = _mm_set1_epi32(bias);
+    vmask  = _mm_set1_epi32(mask);
+    step   = _mm_set1_epi32(0x0979e791L);  /* a^4 */
+    offset = _mm_set1_epi32(0xaaf95334L);  /* c (a^3 + a^2 + a + 1) */
 
-    default:
-      return 0;
-    }
+    r[0] = prng(state);
+    r[1] = prng(r[0]);
+    r[2] = prng(r[1]);
+    r[3] = prng(r[2]);
 
-    return nsamples * 2;
-  }
-  else {  /* mono */
-    switch (mode) {
-    case AUDIO_MODE_ROUND:
-      while (len--)
-	*data++ = audio_linear_round(8, *left++, stats);
-      break;
+    current  = _mm_setr_epi32(r[0], r[1], r[2], r[3]);
+    previous = _mm_setr_epi32(state, r[0], r[1], r[2]);
 
-    case AUDIO_MODE_DITHER:
-      while (len--)
-	*data++ = audio_linear_dither(8, *left++, &left_dither, stats);
-      break;
+    for (; i + 4 <= nsamples; i += 4) {
+      __m128i random, next;
 
-    default:
-      return 0;
+      random = _mm_sub_epi32(_mm_and_si128(current,  vmask),
+			     _mm_and_si128(previous, vmask));
+
+      _mm_storeu_si128((__m128i *) &noise[i], _mm_add_epi32(vbias, random));
+
+      next     = _mm_add_epi32(mul32(current, step), offset);
+      previous = _mm_or_si128(_mm_srli_si128(current, 12),
+			      _mm_slli_si128(next, 4));
+      current  = next;
     }
 
-    return nsamples;
+    state = (unsigned long) _mm_cvtsi128_si32(previous) & 0xffffffffL;
   }
+# endif
+
+  for (; i < nsamples; ++i) {
+    random   = prng(state);
+    noise[i] = bias + (mad_fixed_t) ((random & mask) - (state & mask));
+    state    = random;
+  }
+
+  dither->random = state;
 }
 
 /*
- * NAME:	audio_pcm_s16le()
- * DESCRIPTION:	write a block of signed 16-bit little-endian PCM samples
+ * NAME:	stats_merge()
+ * DESCRIPTION:	fold the statistics of a quantized block into a running total
  */
-unsigned int audio_pcm_s16le(unsigned char *data, unsigned int nsamples,
-			     mad_fixed_t const *left, mad_fixed_t const *right,
-			     enum audio_mode mode, struct audio_stats *stats)
+static
+void stats_merge(struct audio_stats *stats, struct audio_stats const *block)
 {
-  unsigned int len;
-  register signed int sample0, sample1;
+  /*
+   * Peaks only ever grow, and clipped samples always exceed the peak, so
+   * taking the maxima gives the same result as per-sample bookkeeping.
+   */
 
-  len = nsamples;
+  stats->clipped_samples += block->clipped_samples;
 
-  if (right) {  /* stereo */
-    switch (mode) {
-    case AUDIO_MODE_ROUND:
-      while (len--) {
-	sample0 = audio_linear_round(16, *left++,  stats);
-	sample1 = audio_linear_round(16, *right++, stats);
+  if (block->peak_clipping > stats->peak_clipping)
+    stats->peak_clipping = block->peak_clipping;
+  if (block->peak_sample > stats->peak_sample)
+    stats->peak_sample = block->peak_sample;
+}
 
-	data[0] = sample0 >> 0;
-	data[1] = sample0 >> 8;
-	data[2] = sample1 >> 0;
-	data[3] = sample1 >> 8;
+# if defined(__SSE2__)
+/*
+ * NAME:	blend()
+ * DESCRIPTION:	choose between two vectors lane by lane
+ */
+static inline
+__m128i blend(__m128i mask, __m128i x, __m128i y)
+{
+  return _mm_or_si128(_mm_and_si128(mask, x), _mm_andnot_si128(mask, y));
+}
 
-	data += 4;
-      }
-      break;
+/*
+ * NAME:	round_s16()
+ * DESCRIPTION:	quantize with rounding and write interleaved 16-bit samples
+ */
+static
+unsigned int round_s16(unsigned char *data, unsigned int nsamples,
+		       mad_fixed_t const *left, mad_fixed_t const *right,
+		       int bigendian, struct audio_stats *stats)
+{
+  struct audio_stats block = { 0, 0, 0 };
+  __m128i bias, high, low;
+  mad_fixed_t lanes[8], peak[2];
+  unsigned int count, i;
+  signed int sample;
 
-    case AUDIO_MODE_DITHER:
-      while (len--) {
-	sample0 = audio_linear_dither(16, *left++,  &left_dither,  stats);
-	sample1 = audio_linear_dither(16, *right++, &right_dither, stats);
+  enum {
+    MIN = -MAD_F_ONE,
+    MAX =  MAD_F_ONE - 1
+  };
 
-	data[0] = sample0 >> 0;
-	data[1] = sample0 >> 8;
-	data[2] = sample1 >> 0;
-	data[3] = sample1 >> 8;
+  /*
+   * Clipping before the shift is the same as saturating after it, so the
+   * conversion is a signed pack. Clipped samples are rare enough that they
+   * are only counted when the block extremes show there are any.
+   */
 
-	data += 4;
-      }
-      break;
+  bias = _mm_set1_epi32(1L << (MAD_F_FRACBITS - 16));
+  high = low = _mm_setzero_si128();
 
-    default:
-      return 0;
+# define ROUND(x, sample)  \
+    x = _mm_add_epi32(_mm_loadu_si128((__m128i const *) (sample)), bias);  \
+    high = blend(_mm_cmpgt_epi32(x, high), x, high);  \
+    low  = blend(_mm_cmplt_epi32(x, low),  x, low)
+
+# define PACK(x0, x1)  \
+    _mm_packs_epi32(_mm_srai_epi32(x0, MAD_F_FRACBITS - 15),  \
+		    _mm_srai_epi32(x1, MAD_F_FRACBITS - 15))
+
+# define STORE(data, x)  \
+    _mm_storeu_si128((__m128i *) (data), !bigendian ? (x) :  \
+		     _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8)))
+
+  count = nsamples & ~7;
+
+  for (i = 0; i < count; i += 8) {
+    __m128i x0, x1, y0, y1, l, r;
+
+    ROUND(x0, &left[i]);
+    ROUND(x1, &left[i + 4]);
+
+    l = PACK(x0, x1);
+
+    if (right) {
+      ROUND(y0, &right[i]);
+      ROUND(y1, &right[i + 4]);
+
+      r = PACK(y0, y1);
+
+      STORE(data,      _mm_unpacklo_epi16(l, r));
+      STORE(data + 16, _mm_unpackhi_epi16(l, r));
+
+      data += 32;
     }
+    else {
+      STORE(data, l);
 
-    return nsamples * 2 * 2;
+      data += 16;
+    }
   }
-  else {  /* mono */
-    switch (mode) {
-    case AUDIO_MODE_ROUND:
-      while (len--) {
-	sample0 = audio_linear_round(16, *left++, stats);
 
-	data[0] = sample0 >> 0;
-	data[1] = sample0 >> 8;
+# undef ROUND
+# undef PACK
+# undef STORE
 
-	data += 2;
-      }
-      break;
+  _mm_storeu_si128((__m128i *) &lanes[0], high);
+  _mm_storeu_si128((__m128i *) &lanes[4], low);
 
-    case AUDIO_MODE_DITHER:
-      while (len--) {
-	sample0 = audio_linear_dither(16, *left++, &left_dither, stats);
+  peak[0] = peak[1] = 0;
+  for (i = 0; i < 4; ++i) {
+    if (lanes[i] > peak[0])
+      peak[0] = lanes[i];
+    if (lanes[4 + i] < peak[1])
+      peak[1] = lanes[4 + i];
+  }
 
-	data[0] = sample0 >> 0;
-	data[1] = sample0 >> 8;
+  if (peak[0] > MAX || peak[1] < MIN) {
+    for (i = 0; i < count; ++i) {
+      mad_fixed_t x = left[i] + (1L << (MAD_F_FRACBITS - 16));
 
-	data += 2;
+      block.clipped_samples += (x > MAX || x < MIN);
+
+      if (right) {
+	x = right[i] + (1L << (MAD_F_FRACBITS - 16));
+	block.clipped_samples += (x > MAX || x < MIN);
       }
-      break;
+    }
 
-    default:
-      return 0;
+    if (peak[0] > MAX) {
+      block.peak_clipping = peak[0] - MAX;
+      peak[0] = MAX;
+    }
+    if (peak[1] < MIN) {
+      if (MIN - peak[1] > block.peak_clipping)
+	block.peak_clipping = MIN - peak[1];
+      peak[1] = MIN;
     }
+  }
 
-    return nsamples * 2;
+  block.peak_sample = peak[0] > -peak[1] ? peak[0] : -peak[1];
+
+  /* remaining samples */
+
+  for (i = count; i < nsamples; ++i) {
+    sample = audio_linear_round(16, left[i], &block);
+
+    data[ bigendian] = sample >> 0;
+    data[!bigendian] = sample >> 8;
+
+    data += 2;
+
+    if (right) {
+      sample = audio_linear_round(16, right[i], &block);
+
+      data[ bigendian] = sample >> 0;
+      data[!bigendian] = sample >> 8;
+
+      data += 2;
+    }
   }
+
+  stats_merge(stats, &block);
+
+  return nsamples * 2 * (right ? 2 : 1);
 }
+# endif
 
 /*
- * NAME:	audio_pcm_s16be()
- * DESCRIPTION:	write a block of signed 16-bit big-endian PCM samples
+ * NAME:	quantize()
+ * DESCRIPTION:	quantize a block of samples for each channel
  */
-unsigned int audio_pcm_s16be(unsigned char *data, unsigned int nsamples,
-			     mad_fixed_t const *left, mad_fixed_t const *right,
-			     enum audio_mode mode, struct audio_stats *stats)
+static inline
+unsigned int quantize(unsigned int bits, unsigned int nsamples,
+		      mad_fixed_t const *left, mad_fixed_t const *right,
+		      enum audio_mode mode, struct audio_stats *stats,
+		      signed int output[2][MAX_NSAMPLES])
 {
-  unsigned int len;
-  register signed int sample0, sample1;
+  struct audio_dither dither[2];
+  struct audio_stats block = { 0, 0, 0 };
+  mad_fixed_t noise[2][MAX_NSAMPLES];
+  unsigned int i;
+
+  /*
+   * All state lives in locals for the duration of the block, so it stays
+   * in registers rather than being reloaded around every store to the
+   * output buffer. Dithering is inherently serial through its error
+   * feedback; stereo channels are interleaved so the two chains overlap.
+   */
+
+  switch (mode) {
+  case AUDIO_MODE_ROUND:
+    for (i = 0; i < nsamples; ++i)
+      output[0][i] = audio_linear_round(bits, left[i], &block);
+
+    if (right) {
+      for (i = 0; i < nsamples; ++i)
+	output[1][i] = audio_linear_round(bits, right[i], &block);
+    }
+    break;
 
-  len = nsamples;
+  case AUDIO_MODE_DITHER:
+    dither[0] = left_dither;
+    dither[1] = right_dither;
 
-  if (right) {  /* stereo */
-    switch (mode) {
-    case AUDIO_MODE_ROUND:
-      while (len--) {
-	sample0 = audio_linear_round(16, *left++,  stats);
-	sample1 = audio_linear_round(16, *right++, stats);
+    dither_noise(bits, nsamples, &dither[0], noise[0]);
 
-	data[0] = sample0 >> 8;
-	data[1] = sample0 >> 0;
-	data[2] = sample1 >> 8;
-	data[3] = sample1 >> 0;
+    if (right) {
+      dither_noise(bits, nsamples, &dither[1], noise[1]);
 
-	data += 4;
+      for (i = 0; i < nsamples; ++i) {
+	output[0][i] = shape(bits, left[i],  noise[0][i], &dither[0], &block);
+	output[1][i] = shape(bits, right[i], noise[1][i], &dither[1], &block);
       }
-      break;
+    }
+    else {
+      for (i = 0; i < nsamples; ++i)
+	output[0][i] = shape(bits, left[i], noise[0][i], &dither[0], &block);
+    }
 
-    case AUDIO_MODE_DITHER:
-      while (len--) {
-	sample0 = audio_linear_dither(16, *left++,  &left_dither,  stats);
-	sample1 = audio_linear_dither(16, *right++, &right_dither, stats);
+    left_dither  = dither[0];
+    right_dither = dither[1];
+    break;
 
-	data[0] = sample0 >> 8;
-	data[1] = sample0 >> 0;
-	data[2] = sample1 >> 8;
-	data[3] = sample1 >> 0;
+  default:
+    return 0;
+  }
 
-	data += 4;
-      }
-      break;
+  stats_merge(stats, &block);
 
-    default:
-      return 0;
+  return right ? 2 : 1;
+}
+
+/*
+ * NAME:	audio_pcm_u8()
+ * DESCRIPTION:	write a block of unsigned 8-bit PCM samples
+ */
+unsigned int audio_pcm_u8(unsigned char *data, unsigned int nsamples,
+			  mad_fixed_t const *left, mad_fixed_t const *right,
+			  enum audio_mode mode, struct audio_stats *stats)
+{
+  signed int output[2][MAX_NSAMPLES];
+  unsigned int i;
+
+  switch (quantize(8, nsamples, left, right, mode, stats, output)) {
+  case 2:  /* stereo */
+    for (i = 0; i < nsamples; ++i) {
+      data[0] = output[0][i] ^ 0x80;
+      data[1] = output[1][i] ^ 0x80;
+
+      data += 2;
     }
 
-    return nsamples * 2 * 2;
-  }
-  else {  /* mono */
-    switch (mode) {
-    case AUDIO_MODE_ROUND:
-      while (len--) {
-	sample0 = audio_linear_round(16, *left++, stats);
+    return nsamples * 2;
 
-	data[0] = sample0 >> 8;
-	data[1] = sample0 >> 0;
+  case 1:  /* mono */
+    for (i = 0; i < nsamples; ++i)
+      *data++ = output[0][i] ^ 0x80;
 
-	data += 2;
-      }
-      break;
+    return nsamples;
+  }
 
-    case AUDIO_MODE_DITHER:
-      while (len--) {
-	sample0 = audio_linear_dither(16, *left++, &left_dither, stats);
+  return 0;
+}
 
-	data[0] = sample0 >> 8;
-	data[1] = sample0 >> 0;
+/*
+ * NAME:	audio_pcm_s8()
+ * DESCRIPTION:	write a block of signed 8-bit PCM samples
+ */
+unsigned int audio_pcm_s8(unsigned char *data, unsigned int nsamples,
+			  mad_fixed_t const *left, mad_fixed_t const *right,
+			  enum audio_mode mode, struct audio_stats *stats)
+{
+  signed int output[2][MAX_NSAMPLES];
+  unsigned int i;
 
-	data += 2;
-      }
-      break;
+  switch (quantize(8, nsamples, left, right, mode, stats, output)) {
+  case 2:  /* stereo */
+    for (i = 0; i < nsamples; ++i) {
+      data[0] = output[0][i];
+      data[1] = output[1][i];
 
-    default:
-      return 0;
+      data += 2;
     }
 
     return nsamples * 2;
+
+  case 1:  /* mono */
+    for (i = 0; i < nsamples; ++i)
+      *data++ = output[0][i];
+
+    return nsamples;
   }
+
+  return 0;
 }
 
 /*
- * NAME:	audio_pcm_s24le()
- * DESCRIPTION:	write a block of signed 24-bit little-endian PCM samples
+ * NAME:	audio_pcm_s16le()
+ * DESCRIPTION:	write a block of signed 16-bit little-endian PCM samples
  */
-unsigned int audio_pcm_s24le(unsigned char *data, unsigned int nsamples,
+unsigned int audio_pcm_s16le(unsigned char *data, unsigned int nsamples,
 			     mad_fixed_t const *left, mad_fixed_t const *right,
 			     enum audio_mode mode, struct audio_stats *stats)
 {
-  unsigned int len;
-  register signed long sample0, sample1;
+  signed int output[2][MAX_NSAMPLES];
+  unsigned int i;
 
-  len = nsamples;
+# if defined(__SSE2__)
+  if (mode == AUDIO_MODE_ROUND)
+    return round_s16(data, nsamples, left, right, 0, stats);
+# endif
 
-  if (right) {  /* stereo */
-    switch (mode) {
-    case AUDIO_MODE_ROUND:
-      while (len--) {
-	sample0 = audio_linear_round(24, *left++,  stats);
-	sample1 = audio_linear_round(24, *right++, stats);
+  switch (quantize(16, nsamples, left, right, mode, stats, output)) {
+  case 2:  /* stereo */
+    for (i = 0; i < nsamples; ++i) {
+      data[0] = output[0][i] >> 0;
+      data[1] = output[0][i] >> 8;
+      data[2] = output[1][i] >> 0;
+      data[3] = output[1][i] >> 8;
 
-	data[0] = sample0 >>  0;
-	data[1] = sample0 >>  8;
-	data[2] = sample0 >> 16;
+      data += 4;
+    }
 
-	data[3] = sample1 >>  0;
-	data[4] = sample1 >>  8;
-	data[5] = sample1 >> 16;
+    return nsamples * 2 * 2;
 
-	data += 6;
-      }
-      break;
+  case 1:  /* mono */
+    for (i = 0; i < nsamples; ++i) {
+      data[0] = output[0][i] >> 0;
+      data[1] = output[0][i] >> 8;
 
-    case AUDIO_MODE_DITHER:
-      while (len--) {
-	sample0 = audio_linear_dither(24, *left++,  &left_dither,  stats);
-	sample1 = audio_linear_dither(24, *right++, &right_dither, stats);
+      data += 2;
+    }
 
-	data[0] = sample0 >>  0;
-	data[1] = sample0 >>  8;
-	data[2] = sample0 >> 16;
+    return nsamples * 2;
+  }
 
-	data[3] = sample1 >>  0;
-	data[4] = sample1 >>  8;
-	data[5] = sample1 >> 16;
+  return 0;
+}
 
-	data += 6;
-      }
-      break;
+/*
+ * NAME:	audio_pcm_s16be()
+ * DESCRIPTION:	write a block of signed 16-bit big-endian PCM samples
+ */
+unsigned int audio_pcm_s16be(unsigned char *data, unsigned int nsamples,
+			     mad_fixed_t const *left, mad_fixed_t const *right,
+			     enum audio_mode mode, struct audio_stats *stats)
+{
+  signed int output[2][MAX_NSAMPLES];
+  unsigned int i;
 
-    default:
-      return 0;
+# if defined(__SSE2__)
+  if (mode == AUDIO_MODE_ROUND)
+    return round_s16(data, nsamples, left, right, 1, stats);
+# endif
+
+  switch (quantize(16, nsamples, left, right, mode, stats, output)) {
+  case 2:  /* stereo */
+    for (i = 0; i < nsamples; ++i) {
+      data[0] = output[0][i] >> 8;
+      data[1] = output[0][i] >> 0;
+      data[2] = output[1][i] >> 8;
+      data[3] = output[1][i] >> 0;
+
+      data += 4;
     }
 
-    return nsamples * 3 * 2;
+    return nsamples * 2 * 2;
+
+  case 1:  /* mono */
+    for (i = 0; i < nsamples; ++i) {
+      data[0] = output[0][i] >> 8;
+      data[1] = output[0][i] >> 0;
+
+      data += 2;
+    }
+
+    return nsamples * 2;
   }
-  else {  /* mono */
-    switch (mode) {
-    case AUDIO_MODE_ROUND:
-      while (len--) {
-	sample0 = audio_linear_round(24, *left++, stats);
 
-	data[0] = sample0 >>  0;
-	data[1] = sample0 >>  8;
-	data[2] = sample0 >> 16;
+  return 0;
+}
 
-	data += 3;
-      }
-      break;
+/*
+ * NAME:	audio_pcm_s24le()
+ * DESCRIPTION:	write a block of signed 24-bit little-endian PCM samples
+ */
+unsigned int audio_pcm_s24le(unsigned char *data, unsigned int nsamples,
+			     mad_fixed_t const *left, mad_fixed_t const *right,
+			     enum audio_mode mode, struct audio_stats *stats)
+{
+  signed int output[2][MAX_NSAMPLES];
+  unsigned int i;
 
-    case AUDIO_MODE_DITHER:
-      while (len--) {
-	sample0 = audio_linear_dither(24, *left++, &left_dither, stats);
+  switch (quantize(24, nsamples, left, right, mode, stats, output)) {
+  case 2:  /* stereo */
+    for (i = 0; i < nsamples; ++i) {
+      data[0] = output[0][i] >>  0;
+      data[1] = output[0][i] >>  8;
+      data[2] = output[0][i] >> 16;
 
-	data[0] = sample0 >>  0;
-	data[1] = sample0 >>  8;
-	data[2] = sample0 >> 16;
+      data[3] = output[1][i] >>  0;
+      data[4] = output[1][i] >>  8;
+      data[5] = output[1][i] >> 16;
 
-	data += 3;
-      }
-      break;
+      data += 6;
+    }
 
-    default:
-      return 0;
+    return nsamples * 3 * 2;
+
+  case 1:  /* mono */
+    for (i = 0; i < nsamples; ++i) {
+      data[0] = output[0][i] >>  0;
+      data[1] = output[0][i] >>  8;
+      data[2] = output[0][i] >> 16;
+
+      data += 3;
     }
 
     return nsamples * 3;
   }
+
+  return 0;
 }
 
 /*
@@ -683,85 +846,38 @@ unsigned int audio_pcm_s24be(unsigned char *data, unsigned int nsamples,
 			     mad_fixed_t const *left, mad_fixed_t const *right,
 			     enum audio_mode mode, struct audio_stats *stats)
 {
-  unsigned int len;
-  register signed long sample0, sample1;
-
-  len = nsamples;
-
-  if (right) {  /* stereo */
-    switch (mode) {
-    case AUDIO_MODE_ROUND:
-      while (len--) {
-	sample0 = audio_linear_round(24, *left++,  stats);
-	sample1 = audio_linear_round(24, *right++, stats);
+  signed int output[2][MAX_NSAMPLES];
+  unsigned int i;
 
-	data[0] = sample0 >> 16;
-	data[1] = sample0 >>  8;
-	data[2] = sample0 >>  0;
+  switch (quantize(24, nsamples, left, right, mode, stats, output)) {
+  case 2:  /* stereo */
+    for (i = 0; i < nsamples; ++i) {
+      data[0] = output[0][i] >> 16;
+      data[1] = output[0][i] >>  8;
+      data[2] = output[0][i] >>  0;
 
-	data[3] = sample1 >> 16;
-	data[4] = sample1 >>  8;
-	data[5] = sample1 >>  0;
-
-	data += 6;
-      }
-      break;
+      data[3] = output[1][i] >> 16;
+      data[4] = output[1][i] >>  8;
+      data[5] = output[1][i] >>  0;
 
-    case AUDIO_MODE_DITHER:
-      while (len--) {
-	sample0 = audio_linear_dither(24, *left++,  &left_dither,  stats);
-	sample1 = audio_linear_dither(24, *right++, &right_dither, stats);
-
-	data[0] = sample0 >> 16;
-	data[1] = sample0 >>  8;
-	data[2] = sample0 >>  0;
-
-	data[3] = sample1 >> 16;
-	data[4] = sample1 >>  8;
-	data[5] = sample1 >>  0;
-
-	data += 6;
-      }
-      break;
-
-    default:
-      return 0;
+      data += 6;
     }
 
     return nsamples * 3 * 2;
-  }
-  else {  /* mono */
-    switch (mode) {
-    case AUDIO_MODE_ROUND:
-      while (len--) {
-	sample0 = audio_linear_round(24, *left++, stats);
 
-	data[0] = sample0 >> 16;
-	data[1] = sample0 >>  8;
-	data[2] = sample0 >>  0;
+  case 1:  /* mono */
+    for (i = 0; i < nsamples; ++i) {
+      data[0] = output[0][i] >> 16;
+      data[1] = output[0][i] >>  8;
+      data[2] = output[0][i] >>  0;
 
-	data += 3;
-      }
-      break;
-
-    case AUDIO_MODE_DITHER:
-      while (len--) {
-	sample1 = audio_linear_dither(24, *left++, &left_dither, stats);
-
-	data[0] = sample1 >> 16;
-	data[1] = sample1 >>  8;
-	data[2] = sample1 >>  0;
-
-	data += 3;
-      }
-      break;
-
-    default:
-      return 0;
+      data += 3;
     }
 
     return nsamples * 3;
   }
+
+  return 0;
 }
 
 /*
@@ -772,91 +888,41 @@ unsigned int audio_pcm_s32le(unsigned char *data, unsigned int nsamples,
 			     mad_fixed_t const *left, mad_fixed_t const *right,
 			     enum audio_mode mode, struct audio_stats *stats)
 {
-  unsigned int len;
-  register signed long sample0, sample1;
-
-  len = nsamples;
-
-  if (right) {  /* stereo */
-    switch (mode) {
-    case AUDIO_MODE_ROUND:
-      while (len--) {
-	sample0 = audio_linear_round(24, *left++,  stats);
-	sample1 = audio_linear_round(24, *right++, stats);
-
-	data[0] = 0;
-	data[1] = sample0 >>  0;
-	data[2] = sample0 >>  8;
-	data[3] = sample0 >> 16;
-
-	data[4] = 0;
-	data[5] = sample1 >>  0;
-	data[6] = sample1 >>  8;
-	data[7] = sample1 >> 16;
-
-	data += 8;
-      }
-      break;
-
-    case AUDIO_MODE_DITHER:
-      while (len--) {
-	sample0 = audio_linear_dither(24, *left++,  &left_dither,  stats);
-	sample1 = audio_linear_dither(24, *right++, &right_dither, stats);
-
-	data[0] = 0;
-	data[1] = sample0 >>  0;
-	data[2] = sample0 >>  8;
-	data[3] = sample0 >> 16;
-
-	data[4] = 0;
-	data[5] = sample1 >>  0;
-	data[6] = sample1 >>  8;
-	data[7] = sample1 >> 16;
-
-	data += 8;
-      }
-      break;
-
-    default:
-      return 0;
+  signed int output[2][MAX_NSAMPLES];
+  unsigned int i;
+
+  switch (quantize(24, nsamples, left, right, mode, stats, output)) {
+  case 2:  /* stereo */
+    for (i = 0; i < nsamples; ++i) {
+      data[0] = 0;
+      data[1] = output[0][i] >>  0;
+      data[2] = output[0][i] >>  8;
+      data[3] = output[0][i] >> 16;
+
+      data[4] = 0;
+      data[5] = output[1][i] >>  0;
+      data[6] = output[1][i] >>  8;
+      data[7] = output[1][i] >> 16;
+
+      data += 8;
     }
 
     return nsamples * 4 * 2;
-  }
-  else {  /* mono */
-    switch (mode) {
-    case AUDIO_MODE_ROUND:
-      while (len--) {
-	sample0 = audio_linear_round(24, *left++, stats);
 
-	data[0] = 0;
-	data[1] = sample0 >>  0;
-	data[2] = sample0 >>  8;
-	data[3] = sample0 >> 16;
+  case 1:  /* mono */
+    for (i = 0; i < nsamples; ++i) {
+      data[0] = 0;
+      data[1] = output[0][i] >>  0;
+      data[2] = output[0][i] >>  8;
+      data[3] = output[0][i] >> 16;
 
-	data += 4;
-      }
-      break;
-
-    case AUDIO_MODE_DITHER:
-      while (len--) {
-	sample0 = audio_linear_dither(24, *left++, &left_dither, stats);
-
-	data[0] = 0;
-	data[1] = sample0 >>  0;
-	data[2] = sample0 >>  8;
-	data[3] = sample0 >> 16;
-
-	data += 4;
-      }
-      break;
-
-    default:
-      return 0;
+      data += 4;
     }
 
     return nsamples * 4;
   }
+
+  return 0;
 }
 
 /*
@@ -867,91 +933,41 @@ unsigned int audio_pcm_s32be(unsigned char *data, unsigned int nsamples,
 			     mad_fixed_t const *left, mad_fixed_t const *right,
 			     enum audio_mode mode, struct audio_stats *stats)
 {
-  unsigned int len;
-  register signed long sample0, sample1;
-
-  len = nsamples;
-
-  if (right) {  /* stereo */
-    switch (mode) {
-    case AUDIO_MODE_ROUND:
-      while (len--) {
-	sample0 = audio_linear_round(24, *left++,  stats);
-	sample1 = audio_linear_round(24, *right++, stats);
-
-	data[0] = sample0 >> 16;
-	data[1] = sample0 >>  8;
-	data[2] = sample0 >>  0;
-	data[3] = 0;
-
-	data[4] = sample1 >> 16;
-	data[5] = sample1 >>  8;
-	data[6] = sample1 >>  0;
-	data[7] = 0;
-
-	data += 8;
-      }
-      break;
-
-    case AUDIO_MODE_DITHER:
-      while (len--) {
-	sample0 = audio_linear_dither(24, *left++,  &left_dither,  stats);
-	sample1 = audio_linear_dither(24, *right++, &right_dither, stats);
-
-	data[0] = sample0 >> 16;
-	data[1] = sample0 >>  8;
-	data[2] = sample0 >>  0;
-	data[3] = 0;
-
-	data[4] = sample1 >> 16;
-	data[5] = sample1 >>  8;
-	data[6] = sample1 >>  0;
-	data[7] = 0;
-
-	data += 8;
-      }
-      break;
-
-    default:
-      return 0;
+  signed int output[2][MAX_NSAMPLES];
+  unsigned int i;
+
+  switch (quantize(24, nsamples, left, right, mode, stats, output)) {
+  case 2:  /* stereo */
+    for (i = 0; i < nsamples; ++i) {
+      data[0] = output[0][i] >> 16;
+      data[1] = output[0][i] >>  8;
+      data[2] = output[0][i] >>  0;
+      data[3] = 0;
+
+      data[4] = output[1][i] >> 16;
+      data[5] = output[1][i] >>  8;
+      data[6] = output[1][i] >>  0;
+      data[7] = 0;
+
+      data += 8;
     }
 
     return nsamples * 4 * 2;
-  }
-  else {  /* mono */
-    switch (mode) {
-    case AUDIO_MODE_ROUND:
-      while (len--) {
-	sample0 = audio_linear_round(24, *left++, stats);
 
-	data[0] = sample0 >> 16;
-	data[1] = sample0 >>  8;
-	data[2] = sample0 >>  0;
-	data[3] = 0;
+  case 1:  /* mono */
+    for (i = 0; i < nsamples; ++i) {
+      data[0] = output[0][i] >> 16;
+      data[1] = output[0][i] >>  8;
+      data[2] = output[0][i] >>  0;
+      data[3] = 0;
 
-	data += 4;
-      }
-      break;
-
-    case AUDIO_MODE_DITHER:
-      while (len--) {
-	sample0 = audio_linear_dither(24, *left++, &left_dither, stats);
-
-	data[0] = sample0 >> 16;
-	data[1] = sample0 >>  8;
-	data[2] = sample0 >>  0;
-	data[3] = 0;
-
-	data += 4;
-      }
-      break;
-
-    default:
-      return 0;
+      data += 4;
     }
 
     return nsamples * 4;
   }
+
+  return 0;
 }
 
 static
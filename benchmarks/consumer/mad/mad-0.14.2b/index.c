@@ -0,0 +1,506 @@
+/*
+ * mad - MPEG audio decoder
+ * Copyright (C) 2000-2001 Robert Leslie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+# ifdef HAVE_CONFIG_H
+#  include "config.h"
+# endif
+
+# include "global.h"
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+
+# ifdef HAVE_SYS_TYPES_H
+#  include <sys/types.h>
+# endif
+
+# include <sys/stat.h>
+
+# ifdef HAVE_UNISTD_H
+#  include <unistd.h>
+# endif
+
+# ifdef HAVE_ERRNO_H
+#  include <errno.h>
+# endif
+
+# include "index.h"
+# include "xing.h"
+# include "mad.h"
+# include "id3tag.h"
+
+# define INDEX_BUFSZ	65536	/* header scan input buffer */
+
+# define INDEX_MAGIC	"MADI"
+# define INDEX_VERSION	1
+
+# define INDEX_HEADSZ	48	/* bytes in sidecar file header */
+# define INDEX_FRAMESZ	20	/* bytes per sidecar frame entry */
+
+# define INDEX_PRIME	2	/* frames needed before a seek target */
+
+/*
+ * NAME:	index->init()
+ * DESCRIPTION:	initialize index structure
+ */
+void index_init(struct index *index)
+{
+  index->size       = 0;
+  index->mtime      = 0;
+
+  index->first      = 0;
+  index->nframes    = 0;
+  index->nalloc     = 0;
+  index->frames     = 0;
+
+  index->duration   = mad_timer_zero;
+  index->samplerate = 0;
+  index->nsamples   = 0;
+}
+
+/*
+ * NAME:	index->finish()
+ * DESCRIPTION:	release index structure
+ */
+void index_finish(struct index *index)
+{
+  if (index->frames)
+    free(index->frames);
+
+  index_init(index);
+}
+
+/*
+ * NAME:	index->append()
+ * DESCRIPTION:	add the frame just found in the stream
+ */
+static
+int index_append(struct index *index, struct mad_stream const *stream,
+		 struct mad_header const *header, unsigned long offset)
+{
+  struct index_frame *entry;
+
+  if (index->nframes == index->nalloc) {
+    unsigned long nalloc;
+    struct index_frame *frames;
+
+    nalloc = index->nalloc ? index->nalloc * 2 : 1024;
+
+    frames = realloc(index->frames, nalloc * sizeof(*frames));
+    if (frames == 0)
+      return -1;
+
+    index->frames = frames;
+    index->nalloc = nalloc;
+  }
+
+  entry = &index->frames[index->nframes++];
+
+  entry->offset   = offset;
+  entry->time     = index->duration;
+  entry->md_begin = 0;
+  entry->md_space = 0;
+
+  if (header->layer == MAD_LAYER_III) {
+    struct mad_bitptr ptr;
+    unsigned int nch, si_len;
+    long space;
+
+    nch = MAD_NCHANNELS(header);
+    si_len = (header->flags & MAD_FLAG_LSF_EXT) ?
+      (nch == 1 ? 9 : 17) : (nch == 1 ? 17 : 32);
+
+    ptr = stream->ptr;
+    entry->md_begin =
+      mad_bit_read(&ptr, (header->flags & MAD_FLAG_LSF_EXT) ? 8 : 9);
+
+    space = stream->next_frame - mad_bit_nextbyte(&stream->ptr) - si_len;
+    if (space > 0)
+      entry->md_space = space;
+  }
+
+  return 0;
+}
+
+/*
+ * NAME:	index->build()
+ * DESCRIPTION:	scan all frame headers of a file to create its index
+ */
+int index_build(struct index *index, int fd)
+{
+  struct stat stat;
+  struct mad_stream stream;
+  struct mad_frame frame;
+  struct xing xing;
+  unsigned char *buffer;
+  unsigned long base = 0, length = 0;
+  int eof = 0, constant = 1, result = -1;
+
+  index_finish(index);
+
+  if (fstat(fd, &stat) == -1 || lseek(fd, 0, SEEK_SET) == -1)
+    return -1;
+
+  buffer = malloc(INDEX_BUFSZ);
+  if (buffer == 0)
+    return -1;
+
+  index->size  = stat.st_size;
+  index->mtime = stat.st_mtime;
+
+  mad_stream_init(&stream);
+  mad_frame_init(&frame);
+
+  do {
+    int len;
+
+    if (eof) {
+      result = 0;
+      break;
+    }
+
+    if (stream.next_frame) {
+      base += stream.next_frame - buffer;
+      memmove(buffer, stream.next_frame,
+	      length = &buffer[length] - stream.next_frame);
+    }
+
+    do
+      len = read(fd, buffer + length, INDEX_BUFSZ - length);
+    while (len == -1 && errno == EINTR);
+
+    if (len == -1)
+      break;
+    else if (len == 0) {
+      eof = 1;
+
+      while (len < MAD_BUFFER_GUARD)
+	buffer[length + len++] = 0;
+    }
+
+    mad_stream_buffer(&stream, buffer, length += len);
+
+    while (1) {
+      if (mad_header_scan(&frame.header, &stream) == -1) {
+	signed long tagsize;
+
+	if (!MAD_RECOVERABLE(stream.error))
+	  break;
+
+	if (stream.error == MAD_ERROR_LOSTSYNC) {
+	  tagsize = id3_tag_query(stream.this_frame,
+				  stream.bufend - stream.this_frame);
+	  if (tagsize > 0)
+	    mad_stream_skip(&stream, tagsize);
+	}
+
+	continue;
+      }
+
+      if (index_append(index, &stream, &frame.header,
+		       base + (stream.this_frame - buffer)) == -1)
+	goto fail;
+
+      /* a Xing header occupies a silent first frame */
+
+      if (index->nframes == 1 &&
+	  mad_frame_decode(&frame, &stream) == 0 &&
+	  xing_parse(&xing, stream.anc_ptr, stream.anc_bitlen) == 0) {
+	index->first = 1;
+	continue;
+      }
+
+      if (index->samplerate == 0 && constant) {
+	index->samplerate = frame.header.samplerate;
+	index->nsamples   = 32 * MAD_NSBSAMPLES(&frame.header);
+      }
+      else if (index->samplerate != frame.header.samplerate ||
+	       index->nsamples != 32 * MAD_NSBSAMPLES(&frame.header)) {
+	index->samplerate = 0;
+	index->nsamples   = 0;
+	constant = 0;
+      }
+
+      mad_timer_add(&index->duration, frame.header.duration);
+    }
+  }
+  while (stream.error == MAD_ERROR_BUFLEN);
+
+ fail:
+  mad_frame_finish(&frame);
+  mad_stream_finish(&stream);
+
+  free(buffer);
+
+  if (result == -1)
+    index_finish(index);
+
+  return result;
+}
+
+/*
+ * NAME:	put()
+ * DESCRIPTION:	store a big-endian integer
+ */
+static
+unsigned char *put(unsigned char *ptr, unsigned long value,
+		   unsigned int bytes)
+{
+  unsigned int i;
+
+  for (i = bytes; i-- > 0; value >>= 8)
+    ptr[i] = value & 0xff;
+
+  return ptr + bytes;
+}
+
+/*
+ * NAME:	get()
+ * DESCRIPTION:	fetch a big-endian integer
+ */
+static
+unsigned long get(unsigned char const **ptr, unsigned int bytes)
+{
+  unsigned long value = 0;
+
+  while (bytes--)
+    value = (value << 8) | *(*ptr)++;
+
+  return value;
+}
+
+/*
+ * NAME:	index->load()
+ * DESCRIPTION:	read an index file, provided it still describes a file
+ */
+int index_load(struct index *index, char const *path, int fd)
+{
+  struct stat stat;
+  FILE *file;
+  unsigned char head[INDEX_HEADSZ], *data = 0;
+  unsigned char const *ptr;
+  unsigned long nframes, i;
+
+  index_finish(index);
+
+  if (fstat(fd, &stat) == -1)
+    return -1;
+
+  file = fopen(path, "rb");
+  if (file == 0)
+    return -1;
+
+  if (fread(head, INDEX_HEADSZ, 1, file) != 1 ||
+      memcmp(head, INDEX_MAGIC, 4) != 0)
+    goto fail;
+
+  ptr = head + 4;
+
+  if (get(&ptr, 4) != INDEX_VERSION ||
+      get(&ptr, 8) != (unsigned long) stat.st_size ||
+      get(&ptr, 8) != (unsigned long) stat.st_mtime)
+    goto fail;
+
+  index->first      = get(&ptr, 4);
+  nframes           = get(&ptr, 4);
+  index->samplerate = get(&ptr, 4);
+  index->nsamples   = get(&ptr, 4);
+
+  index->duration.seconds  = get(&ptr, 4);
+  index->duration.fraction = get(&ptr, 4);
+
+  if (index->first > nframes || nframes > (unsigned long) stat.st_size ||
+      (index->samplerate != 0) != (index->nsamples != 0))
+    goto fail;
+
+  if (nframes) {
+    data = malloc(nframes * INDEX_FRAMESZ);
+    index->frames = malloc(nframes * sizeof(*index->frames));
+    if (data == 0 || index->frames == 0 ||
+	fread(data, INDEX_FRAMESZ, nframes, file) != nframes)
+      goto fail;
+  }
+
+  for (ptr = data, i = 0; i < nframes; ++i) {
+    struct index_frame *entry = &index->frames[i];
+
+    entry->offset        = get(&ptr, 8);
+    entry->time.seconds  = get(&ptr, 4);
+    entry->time.fraction = get(&ptr, 4);
+    entry->md_begin      = get(&ptr, 2);
+    entry->md_space      = get(&ptr, 2);
+
+    /* the header only vouches for the MPEG file; reject a damaged body
+       so the caller falls back to index_build() */
+
+    if (entry->offset >= (unsigned long) stat.st_size ||
+	entry->time.fraction >= MAD_TIMER_RESOLUTION ||
+	(i > 0 && (entry->offset <= entry[-1].offset ||
+		   mad_timer_compare(entry->time, entry[-1].time) < 0)))
+      goto fail;
+  }
+
+  if (nframes &&
+      mad_timer_compare(index->duration, index->frames[nframes - 1].time) < 0)
+    goto fail;
+
+  index->size    = stat.st_size;
+  index->mtime   = stat.st_mtime;
+  index->nframes = index->nalloc = nframes;
+
+  if (data)
+    free(data);
+
+  fclose(file);
+
+  return 0;
+
+ fail:
+  if (data)
+    free(data);
+
+  fclose(file);
+
+  index_finish(index);
+
+  return -1;
+}
+
+/*
+ * NAME:	index->save()
+ * DESCRIPTION:	write an index file
+ */
+int index_save(struct index const *index, char const *path)
+{
+  FILE *file;
+  unsigned char *data, *ptr;
+  unsigned long size, i;
+  int result = 0;
+
+  size = INDEX_HEADSZ + index->nframes * INDEX_FRAMESZ;
+
+  data = malloc(size);
+  if (data == 0)
+    return -1;
+
+  memcpy(data, INDEX_MAGIC, 4);
+
+  ptr = put(data + 4, INDEX_VERSION, 4);
+  ptr = put(ptr, index->size, 8);
+  ptr = put(ptr, index->mtime, 8);
+  ptr = put(ptr, index->first, 4);
+  ptr = put(ptr, index->nframes, 4);
+  ptr = put(ptr, index->samplerate, 4);
+  ptr = put(ptr, index->nsamples, 4);
+  ptr = put(ptr, index->duration.seconds, 4);
+  ptr = put(ptr, index->duration.fraction, 4);
+
+  for (i = 0; i < index->nframes; ++i) {
+    struct index_frame const *entry = &index->frames[i];
+
+    ptr = put(ptr, entry->offset, 8);
+    ptr = put(ptr, entry->time.seconds, 4);
+    ptr = put(ptr, entry->time.fraction, 4);
+    ptr = put(ptr, entry->md_begin, 2);
+    ptr = put(ptr, entry->md_space, 2);
+  }
+
+  file = fopen(path, "wb");
+  if (file == 0)
+    result = -1;
+  else {
+    if (fwrite(data, size, 1, file) != 1)
+      result = -1;
+
+    if (fclose(file) == EOF)
+      result = -1;
+
+    if (result == -1)
+      remove(path);
+  }
+
+  free(data);
+
+  return result;
+}
+
+/*
+ * NAME:	index->find()
+ * DESCRIPTION:	return the audio frame playing at a given time
+ */
+unsigned long index_find(struct index const *index, mad_timer_t time)
+{
+  unsigned long lo, hi, mid;
+
+  if (mad_timer_sign(time) <= 0)
+    return index->first;
+
+  /* constant frame durations give the frame directly */
+
+  if (index->samplerate) {
+    lo = index->first +
+      mad_timer_count(time, (enum mad_units) index->samplerate) /
+      index->nsamples;
+
+    return lo < index->nframes ? lo : index->nframes - 1;
+  }
+
+  lo = index->first;
+  hi = index->nframes;
+
+  while (hi - lo > 1) {
+    mid = lo + (hi - lo) / 2;
+
+    if (mad_timer_compare(index->frames[mid].time, time) <= 0)
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  return lo;
+}
+
+/*
+ * NAME:	index->prime()
+ * DESCRIPTION:	return the first frame to decode to prepare for a frame
+ */
+unsigned long index_prime(struct index const *index, unsigned long i)
+{
+  unsigned long start;
+  unsigned int space = 0, needed;
+
+  /*
+   * Two preceding frames leave the IMDCT overlap and the synthesis
+   * filterbank as a continuous decode would, even for single-granule
+   * (LSF) and Layer I frames, provided the main_data of the earlier one is
+   * complete; reach back far enough to refill its bit reservoir.
+   */
+
+  if (i < index->first + INDEX_PRIME)
+    return index->first;
+
+  start  = i - INDEX_PRIME;
+  needed = index->frames[start].md_begin;
+
+  while (start > index->first && space < needed)
+    space += index->frames[--start].md_space;
+
+  return start;
+}
@@ -0,0 +1,58 @@
+/*
+ * mad - MPEG audio decoder
+ * Copyright (C) 2000-2001 Robert Leslie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+# ifndef INDEX_H
+# define INDEX_H
+
+# include "mad.h"
+
+struct index_frame {
+  unsigned long offset;		/* file position of frame */
+  mad_timer_t time;		/* playing time before frame */
+  unsigned short md_begin;	/* Layer III main_data_begin */
+  unsigned short md_space;	/* Layer III main_data bytes in frame */
+};
+
+struct index {
+  unsigned long size;		/* file size when indexed */
+  unsigned long mtime;		/* file modification time when indexed */
+
+  unsigned long first;		/* first audio frame (after Xing frame) */
+  unsigned long nframes;	/* number of frames */
+  unsigned long nalloc;
+  struct index_frame *frames;
+
+  mad_timer_t duration;		/* total playing time */
+  unsigned int samplerate;	/* constant sampling frequency, or 0 */
+  unsigned int nsamples;	/* constant samples per frame, or 0 */
+};
+
+# define INDEX_SUFFIX	".idx"
+
+void index_init(struct index *);
+void index_finish(struct index *);
+
+int index_build(struct index *, int);
+int index_load(struct index *, char const *, int);
+int index_save(struct index const *, char const *);
+
+unsigned long index_find(struct index const *, mad_timer_t);
+unsigned long index_prime(struct index const *, unsigned long);
+
+# endif
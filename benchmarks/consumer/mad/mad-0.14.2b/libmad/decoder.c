@@ -42,11 +42,22 @@
 # endif
 
 # include <stdlib.h>
+# include <string.h>
 
 # ifdef HAVE_ERRNO_H
 #  include <errno.h>
 # endif
 
+# ifdef HAVE_LIMITS_H
+#  include <limits.h>
+# else
+#  define CHAR_BIT  8
+# endif
+
+# if defined(USE_THREADS)
+#  include <pthread.h>
+# endif
+
 # include "stream.h"
 # include "frame.h"
 # include "synth.h"
@@ -72,6 +83,7 @@ void mad_decoder_init(struct mad_decoder *decoder, void *data,
   decoder->mode         = -1;
 
   decoder->options      = 0;
+  decoder->threads      = 0;
 
   decoder->async.pid    = 0;
   decoder->async.in     = -1;
@@ -522,6 +534,882 @@ int run_async(struct mad_decoder *decoder)
 }
 # endif
 
+# if defined(USE_THREADS)
+/*
+ * Parallel decoding: the input is first scanned for frame headers, copied
+ * and its frames indexed. Consecutive runs of frames (chunks) are
+ * then decoded and synthesized by a pool of threads, while the calling
+ * thread hands the results to the callbacks in stream order.
+ *
+ * Before its first frame, a chunk is primed by decoding enough preceding
+ * frames to refill the Layer III bit reservoir, the IMDCT overlap and the
+ * polyphase filterbank. This reproduces the sequential state exactly when
+ * the last PARALLEL_PRIME frames were decoded and synthesized without
+ * interference. (The filterbank phase is not reproduced; the fixed-point
+ * synthesis does not depend on it.) Whenever a callback ignores or alters
+ * a frame, or a frame fails to decode, the calling thread continues on its
+ * own, and returns to the pooled results at the next chunk boundary.
+ *
+ * Header errors (such as loss of synchronization) are passed to the error
+ * callback during the scan, ahead of any frames. The copy holds the input
+ * bytes in the order the sequential decoder sees them, so a corrupt frame
+ * that reads past its end finds the same bytes either way. Layer III frames
+ * whose side
+ * information overstates their main data read stale bytes, and may decode
+ * differently than they would sequentially.
+ */
+
+# define PARALLEL_CHUNK		64	/* frames per chunk */
+# define PARALLEL_PRIME		3	/* clean frames needed to resume */
+# define PARALLEL_SYNTH		2	/* frames needed to fill filterbank */
+
+struct parallel_index {
+  unsigned long offset;			/* frame position in copied data */
+  unsigned int length;			/* frame length */
+  unsigned int md_space;		/* Layer III main_data bytes in frame */
+  struct mad_header header;		/* header as decoded from stream */
+};
+
+struct parallel_frame {
+  struct mad_frame frame;		/* decoded frame */
+  mad_fixed_t overlap[2][32][18];	/* Layer III overlap after frame */
+  struct mad_bitptr anc_ptr;		/* ancillary bits pointer */
+  unsigned int anc_bitlen;		/* number of ancillary bits */
+  unsigned char anc[MAD_BUFFER_MDLEN];	/* ancillary bits */
+  struct mad_pcm pcm;			/* synthesized PCM */
+};
+
+struct parallel_slot {
+  long chunk;				/* chunk held by this slot */
+  int dirty;				/* chunk did not decode cleanly */
+  struct parallel_frame *frames;
+};
+
+struct parallel {
+  struct mad_decoder *decoder;
+
+  enum mad_flow (*error_func)(void *, struct mad_stream *,
+			      struct mad_frame *);
+  void *error_data;
+  int bad_last_frame;
+
+  unsigned char *data;			/* copied input */
+  unsigned long length;
+  unsigned long size;
+  unsigned char const *copied;		/* end of stream buffer copied */
+
+  struct parallel_index *index;
+  unsigned long nframes;
+  unsigned long nalloc;
+
+  unsigned long nchunks;
+  int nslots;
+  struct parallel_slot *slots;
+
+  pthread_mutex_t lock;
+  pthread_cond_t ready;			/* a chunk has been decoded */
+  pthread_cond_t space;			/* a slot has been released */
+  unsigned long next;			/* next chunk to decode */
+  unsigned long current;		/* chunk being delivered */
+  int stop;				/* workers should exit */
+
+  int serial;				/* delivering from sequential state */
+  int clean;				/* consecutive undisturbed frames */
+  unsigned long resume;			/* first frame after a skipped frame */
+
+  struct mad_frame filtered;		/* frame as passed to filter */
+  mad_fixed_t overlap[2][32][18];
+};
+
+/*
+ * NAME:	parallel->copy()
+ * DESCRIPTION:	append the stream buffer up to a point to the copied input
+ */
+static
+int parallel_copy(struct parallel *par, unsigned char const *end)
+{
+  unsigned long length;
+
+  length = end - par->copied;
+
+  if (par->length + length > par->size) {
+    unsigned long size;
+    unsigned char *data;
+
+    size = par->size ? par->size : 65536;
+    while (size < par->length + length)
+      size *= 2;
+
+    data = realloc(par->data, size);
+    if (data == 0)
+      return -1;
+
+    par->data = data;
+    par->size = size;
+  }
+
+  if (length) {
+    memcpy(par->data + par->length, par->copied, length);
+    par->length += length;
+  }
+  par->copied = end;
+
+  return 0;
+}
+
+/*
+ * NAME:	parallel->append()
+ * DESCRIPTION:	copy and index the frame just found in the stream
+ */
+static
+int parallel_append(struct parallel *par, struct mad_stream const *stream,
+		    struct mad_header const *header)
+{
+  struct parallel_index *entry;
+  unsigned long offset;
+
+  /* copy any bytes skipped to find the frame, then the frame itself */
+
+  offset = par->length + (stream->this_frame - par->copied);
+
+  if (parallel_copy(par, stream->next_frame) == -1)
+    return -1;
+
+  if (par->nframes == par->nalloc) {
+    unsigned long nalloc;
+    struct parallel_index *index;
+
+    nalloc = par->nalloc ? par->nalloc * 2 : 1024;
+
+    index = realloc(par->index, nalloc * sizeof(*index));
+    if (index == 0)
+      return -1;
+
+    par->index  = index;
+    par->nalloc = nalloc;
+  }
+
+  entry = &par->index[par->nframes++];
+
+  entry->offset   = offset;
+  entry->length   = stream->next_frame - stream->this_frame;
+  entry->md_space = 0;
+  entry->header   = *header;
+
+  if (header->layer == MAD_LAYER_III) {
+    unsigned int nch, si_len;
+    long space;
+
+    nch = MAD_NCHANNELS(header);
+    si_len = (header->flags & MAD_FLAG_LSF_EXT) ?
+      (nch == 1 ? 9 : 17) : (nch == 1 ? 17 : 32);
+
+    space = stream->next_frame - mad_bit_nextbyte(&stream->ptr) - si_len;
+    if (space > 0)
+      entry->md_space = space;
+  }
+
+  return 0;
+}
+
+/*
+ * NAME:	parallel->scan()
+ * DESCRIPTION:	read all input, indexing every frame header
+ */
+static
+int parallel_scan(struct parallel *par)
+{
+  struct mad_decoder *decoder = par->decoder;
+  struct mad_stream *stream = &decoder->sync->stream;
+  struct mad_frame *frame = &decoder->sync->frame;
+  enum mad_flow flow;
+  unsigned long length = 0;
+  int result = -1;
+
+  do {
+    /*
+     * The input callback offers the buffer again from next_frame on. That
+     * rest is copied anyway in case no more input follows, as the last
+     * frame is decoded with (and may read into) what follows it.
+     */
+
+    if (stream->buffer) {
+      if (parallel_copy(par, stream->next_frame) == -1)
+	goto nomem;
+      length = par->length;
+      if (parallel_copy(par, stream->bufend) == -1)
+	goto nomem;
+    }
+
+    flow = decoder->input_func(decoder->cb_data, stream);
+    if (flow == MAD_FLOW_STOP)
+      return 0;
+    if (flow == MAD_FLOW_BREAK)
+      return -1;
+
+    par->length = length;
+    par->copied = stream->next_frame;
+
+    if (flow == MAD_FLOW_IGNORE)
+      continue;
+
+    while (1) {
+      if (mad_header_scan(&frame->header, stream) == -1) {
+	if (!MAD_RECOVERABLE(stream->error))
+	  break;
+
+	switch (par->error_func(par->error_data, stream, frame)) {
+	case MAD_FLOW_STOP:
+	  result = 0;
+	  goto done;
+	case MAD_FLOW_BREAK:
+	  goto done;
+	case MAD_FLOW_IGNORE:
+	case MAD_FLOW_CONTINUE:
+	default:
+	  continue;
+	}
+      }
+
+      if (parallel_append(par, stream, &frame->header) == -1)
+	goto nomem;
+    }
+  }
+  while (stream->error == MAD_ERROR_BUFLEN);
+
+ done:
+  if (parallel_copy(par, stream->bufend) == 0)
+    return result;
+
+ nomem:
+  stream->error = MAD_ERROR_NOMEM;
+  return -1;
+}
+
+/*
+ * NAME:	parallel->seek()
+ * DESCRIPTION:	point a stream at an indexed frame
+ */
+static
+void parallel_seek(struct parallel const *par, struct mad_stream *stream,
+		   unsigned long i)
+{
+  struct parallel_index const *entry = &par->index[i];
+
+  mad_stream_buffer(stream, par->data + entry->offset,
+		    par->length - entry->offset);
+
+  if (entry->header.flags & MAD_FLAG_FREEFORMAT)
+    stream->freerate = entry->header.bitrate;
+}
+
+/*
+ * NAME:	parallel->prime()
+ * DESCRIPTION:	return the first frame to decode to prepare for a frame
+ */
+static
+unsigned long parallel_prime(struct parallel const *par, unsigned long i)
+{
+  unsigned long start;
+  unsigned int space = 0;
+
+  if (i <= PARALLEL_PRIME)
+    return 0;
+
+  start = i - PARALLEL_PRIME;
+
+  /* reach back far enough to refill the largest bit reservoir */
+
+  while (start > 0 && space < 511 &&
+	 par->index[start - 1].header.layer == MAD_LAYER_III)
+    space += par->index[--start].md_space;
+
+  return start > 0 ? start - 1 : 0;
+}
+
+/*
+ * NAME:	parallel->decode()
+ * DESCRIPTION:	decode and synthesize a chunk of frames into a slot
+ */
+static
+void parallel_decode(struct parallel *par, unsigned long chunk,
+		     struct parallel_slot *slot)
+{
+  struct mad_stream stream;
+  struct mad_frame frame;
+  struct mad_synth synth;
+  unsigned long first, last, i;
+
+  first = chunk * PARALLEL_CHUNK;
+  last  = first + PARALLEL_CHUNK;
+  if (last > par->nframes)
+    last = par->nframes;
+
+  mad_stream_init(&stream);
+  mad_frame_init(&frame);
+  mad_synth_init(&synth);
+
+  mad_stream_options(&stream, par->decoder->options);
+
+  slot->dirty = 0;
+
+  for (i = parallel_prime(par, first); i < last; ++i) {
+    struct parallel_frame *result;
+
+    parallel_seek(par, &stream, i);
+
+    if (mad_frame_decode(&frame, &stream) == -1) {
+      if (i + PARALLEL_PRIME >= first) {
+	slot->dirty = 1;
+	break;
+      }
+
+      continue;
+    }
+
+    if (i + PARALLEL_SYNTH < first)
+      continue;
+
+    mad_synth_frame(&synth, &frame);
+
+    if (i < first)
+      continue;
+
+    result = &slot->frames[i - first];
+
+    result->frame = frame;
+    if (frame.overlap) {
+      memcpy(result->overlap, frame.overlap, sizeof(result->overlap));
+      result->frame.overlap = &result->overlap;
+    }
+
+    /* Layer III ancillary bits may lie in the reservoir */
+
+    result->anc_ptr    = stream.anc_ptr;
+    result->anc_bitlen = stream.anc_bitlen;
+
+    if (stream.anc_bitlen) {
+      unsigned int len;
+
+      len = (CHAR_BIT - stream.anc_ptr.left + stream.anc_bitlen +
+	     CHAR_BIT - 1) / CHAR_BIT;
+      if (len > sizeof(result->anc))
+	len = sizeof(result->anc);
+
+      memcpy(result->anc, stream.anc_ptr.byte, len);
+      result->anc_ptr.byte = result->anc;
+    }
+
+    result->pcm = synth.pcm;
+  }
+
+  mad_synth_finish(&synth);
+  mad_frame_finish(&frame);
+  mad_stream_finish(&stream);
+}
+
+/*
+ * NAME:	parallel->worker()
+ * DESCRIPTION:	decode chunks until none are left
+ */
+static
+void *parallel_worker(void *data)
+{
+  struct parallel *par = data;
+  struct parallel_slot *slot;
+  unsigned long chunk;
+
+  pthread_mutex_lock(&par->lock);
+
+  while (1) {
+    while (!par->stop && par->next < par->nchunks &&
+	   par->next >= par->current + par->nslots)
+      pthread_cond_wait(&par->space, &par->lock);
+
+    if (par->stop || par->next >= par->nchunks)
+      break;
+
+    chunk = par->next++;
+    slot  = &par->slots[chunk % par->nslots];
+
+    pthread_mutex_unlock(&par->lock);
+    parallel_decode(par, chunk, slot);
+    pthread_mutex_lock(&par->lock);
+
+    slot->chunk = chunk;
+    pthread_cond_broadcast(&par->ready);
+  }
+
+  pthread_mutex_unlock(&par->lock);
+
+  return 0;
+}
+
+/*
+ * NAME:	parallel->wait()
+ * DESCRIPTION:	advance delivery to a chunk and optionally wait for it
+ */
+static
+struct parallel_slot *parallel_wait(struct parallel *par,
+				    unsigned long chunk, int need)
+{
+  struct parallel_slot *slot = &par->slots[chunk % par->nslots];
+
+  pthread_mutex_lock(&par->lock);
+
+  par->current = chunk;
+  pthread_cond_broadcast(&par->space);
+
+  if (par->next == chunk) {
+    /* not yet claimed by a worker */
+
+    ++par->next;
+
+    if (need) {
+      pthread_mutex_unlock(&par->lock);
+      parallel_decode(par, chunk, slot);
+      pthread_mutex_lock(&par->lock);
+
+      slot->chunk = chunk;
+    }
+  }
+
+  while (need && slot->chunk != (long) chunk)
+    pthread_cond_wait(&par->ready, &par->lock);
+
+  pthread_mutex_unlock(&par->lock);
+
+  return slot;
+}
+
+/*
+ * NAME:	parallel->restore()
+ * DESCRIPTION:	rebuild the sequential decoder state preceding a frame
+ */
+static
+void parallel_restore(struct parallel *par, unsigned long i)
+{
+  struct mad_stream *stream = &par->decoder->sync->stream;
+  struct mad_frame *frame = &par->decoder->sync->frame;
+  struct mad_synth *synth = &par->decoder->sync->synth;
+  unsigned long start, j;
+
+  start = parallel_prime(par, i);
+
+ again:
+  mad_stream_finish(stream);
+  mad_frame_finish(frame);
+
+  mad_stream_init(stream);
+  mad_frame_init(frame);
+  mad_synth_init(synth);
+
+  mad_stream_options(stream, par->decoder->options);
+
+  for (j = start; j < i; ++j) {
+    parallel_seek(par, stream, j);
+
+    if (mad_frame_decode(frame, stream) == -1) {
+      if (start > par->resume && j + PARALLEL_PRIME >= i) {
+	start = par->resume;
+	goto again;
+      }
+
+      continue;
+    }
+
+    if (j + PARALLEL_SYNTH >= i)
+      mad_synth_frame(synth, frame);
+  }
+
+  par->serial = 1;
+}
+
+/*
+ * NAME:	parallel->serial()
+ * DESCRIPTION:	decode and deliver one frame from the sequential state
+ */
+static
+enum mad_flow parallel_serial(struct parallel *par, unsigned long i)
+{
+  struct mad_decoder *decoder = par->decoder;
+  struct mad_stream *stream = &decoder->sync->stream;
+  struct mad_frame *frame = &decoder->sync->frame;
+  struct mad_synth *synth = &decoder->sync->synth;
+  enum mad_flow flow;
+  int disturbed = 0;
+
+  parallel_seek(par, stream, i);
+
+  if (decoder->header_func) {
+    if (mad_header_decode(&frame->header, stream) == -1) {
+      par->clean = 0;
+
+      if (!MAD_RECOVERABLE(stream->error))
+	return MAD_FLOW_BREAK;
+
+      flow = par->error_func(par->error_data, stream, frame);
+      return (flow == MAD_FLOW_IGNORE) ? MAD_FLOW_CONTINUE : flow;
+    }
+
+    flow = decoder->header_func(decoder->cb_data, &frame->header);
+    if (flow == MAD_FLOW_IGNORE) {
+      par->clean  = 0;
+      par->resume = i + 1;
+    }
+    if (flow != MAD_FLOW_CONTINUE)
+      return (flow == MAD_FLOW_IGNORE) ? MAD_FLOW_CONTINUE : flow;
+  }
+
+  if (mad_frame_decode(frame, stream) == -1) {
+    par->clean = 0;
+
+    if (!MAD_RECOVERABLE(stream->error))
+      return MAD_FLOW_BREAK;
+
+    flow = par->error_func(par->error_data, stream, frame);
+    if (flow != MAD_FLOW_IGNORE)
+      return flow;
+
+    disturbed = 1;
+  }
+  else
+    par->bad_last_frame = 0;
+
+  if (decoder->filter_func) {
+    memcpy(par->filtered.sbsample, frame->sbsample,
+	   sizeof(frame->sbsample));
+    if (frame->overlap)
+      memcpy(par->overlap, frame->overlap, sizeof(par->overlap));
+
+    flow = decoder->filter_func(decoder->cb_data, stream, frame);
+    if (flow == MAD_FLOW_IGNORE)
+      par->clean = 0;
+    if (flow != MAD_FLOW_CONTINUE)
+      return (flow == MAD_FLOW_IGNORE) ? MAD_FLOW_CONTINUE : flow;
+
+    if (memcmp(par->filtered.sbsample, frame->sbsample,
+	       sizeof(frame->sbsample)) ||
+	(frame->overlap &&
+	 memcmp(par->overlap, frame->overlap, sizeof(par->overlap))))
+      disturbed = 1;
+  }
+
+  mad_synth_frame(synth, frame);
+
+  if (decoder->output_func) {
+    flow = decoder->output_func(decoder->cb_data, &frame->header, &synth->pcm);
+    if (flow == MAD_FLOW_STOP || flow == MAD_FLOW_BREAK)
+      return flow;
+  }
+
+  par->clean = disturbed ? 0 : par->clean + 1;
+
+  return MAD_FLOW_CONTINUE;
+}
+
+/*
+ * NAME:	parallel->output()
+ * DESCRIPTION:	deliver one frame decoded by the pool
+ */
+static
+enum mad_flow parallel_output(struct parallel *par, unsigned long i,
+			      struct parallel_frame *result)
+{
+  struct mad_decoder *decoder = par->decoder;
+  struct mad_frame *filtered = &par->filtered;
+  struct mad_pcm *pcm = &result->pcm;
+  enum mad_flow flow;
+
+  if (decoder->header_func) {
+    flow = decoder->header_func(decoder->cb_data, &par->index[i].header);
+    if (flow == MAD_FLOW_IGNORE) {
+      /* a sequential decoder skips the frame */
+      parallel_restore(par, i);
+      par->clean  = 0;
+      par->resume = i + 1;
+      return MAD_FLOW_CONTINUE;
+    }
+    if (flow != MAD_FLOW_CONTINUE)
+      return flow;
+  }
+
+  *filtered = result->frame;
+  if (filtered->overlap) {
+    memcpy(par->overlap, result->overlap, sizeof(par->overlap));
+    filtered->overlap = &par->overlap;
+  }
+
+  if (decoder->filter_func) {
+    struct mad_stream stream;
+    struct parallel_index const *entry = &par->index[i];
+
+    mad_stream_init(&stream);
+    mad_stream_options(&stream, decoder->options);
+
+    stream.buffer     = par->data + entry->offset;
+    stream.bufend     = par->data + par->length;
+    stream.sync       = 1;
+    stream.this_frame = stream.buffer;
+    stream.next_frame = stream.buffer + entry->length;
+    stream.anc_ptr    = result->anc_ptr;
+    stream.anc_bitlen = result->anc_bitlen;
+
+    if (entry->header.flags & MAD_FLAG_FREEFORMAT)
+      stream.freerate = entry->header.bitrate;
+
+    mad_bit_init(&stream.ptr, stream.next_frame);
+
+    flow = decoder->filter_func(decoder->cb_data, &stream, filtered);
+    if (flow == MAD_FLOW_STOP || flow == MAD_FLOW_BREAK)
+      return flow;
+
+    if (flow == MAD_FLOW_IGNORE ||
+	memcmp(filtered->sbsample, result->frame.sbsample,
+	       sizeof(filtered->sbsample)) ||
+	(filtered->overlap &&
+	 memcmp(par->overlap, result->overlap, sizeof(par->overlap)))) {
+      struct mad_frame *frame = &decoder->sync->frame;
+      struct mad_synth *synth = &decoder->sync->synth;
+
+      /* carry the altered frame over into the sequential state */
+
+      parallel_restore(par, i);
+      parallel_seek(par, &decoder->sync->stream, i);
+      mad_frame_decode(frame, &decoder->sync->stream);
+
+      frame->header = filtered->header;
+      memcpy(frame->sbsample, filtered->sbsample, sizeof(frame->sbsample));
+      if (frame->overlap && filtered->overlap)
+	memcpy(frame->overlap, par->overlap, sizeof(par->overlap));
+
+      par->clean = 0;
+
+      if (flow == MAD_FLOW_IGNORE)
+	return MAD_FLOW_CONTINUE;
+
+      mad_synth_frame(synth, frame);
+      pcm = &synth->pcm;
+    }
+  }
+
+  if (decoder->output_func) {
+    flow = decoder->output_func(decoder->cb_data, &filtered->header, pcm);
+    if (flow == MAD_FLOW_STOP || flow == MAD_FLOW_BREAK)
+      return flow;
+  }
+
+  par->bad_last_frame = 0;
+
+  if (!par->serial)
+    ++par->clean;
+
+  return MAD_FLOW_CONTINUE;
+}
+
+/*
+ * NAME:	parallel->deliver()
+ * DESCRIPTION:	hand all indexed frames to the callbacks in order; return
+ *		1 if a callback stopped decoding, -1 if one failed
+ */
+static
+int parallel_deliver(struct parallel *par)
+{
+  struct parallel_slot *slot = 0;
+  unsigned long i;
+  enum mad_flow flow;
+
+  for (i = 0; i < par->nframes; ++i) {
+    if (i % PARALLEL_CHUNK == 0) {
+      int need;
+
+      /*
+       * Pooled results are usable once the sequential state matches what
+       * a worker primes, and no skipped frame lies in the reservoir.
+       */
+
+      need = (par->clean >= PARALLEL_PRIME &&
+	      parallel_prime(par, i) >= par->resume);
+      slot = parallel_wait(par, i / PARALLEL_CHUNK, need);
+
+      if (need) {
+	if (!slot->dirty)
+	  par->serial = 0;
+	else if (!par->serial)
+	  parallel_restore(par, i);
+      }
+    }
+
+    if (par->serial)
+      flow = parallel_serial(par, i);
+    else
+      flow = parallel_output(par, i, &slot->frames[i % PARALLEL_CHUNK]);
+
+    switch (flow) {
+    case MAD_FLOW_STOP:
+      return 1;
+    case MAD_FLOW_BREAK:
+      return -1;
+    case MAD_FLOW_IGNORE:
+    case MAD_FLOW_CONTINUE:
+      break;
+    }
+  }
+
+  return 0;
+}
+
+static
+int run_parallel(struct mad_decoder *decoder)
+{
+  struct parallel par;
+  pthread_t *workers = 0;
+  int nthreads, nworkers = 0, result, end, i;
+
+  if (decoder->input_func == 0)
+    return 0;
+
+  par.decoder = decoder;
+
+  if (decoder->error_func) {
+    par.error_func = decoder->error_func;
+    par.error_data = decoder->cb_data;
+  }
+  else {
+    par.error_func = error_default;
+    par.error_data = &par.bad_last_frame;
+  }
+
+  par.bad_last_frame = 0;
+
+  par.data    = 0;
+  par.length  = 0;
+  par.size    = 0;
+  par.copied  = 0;
+  par.index   = 0;
+  par.nframes = 0;
+  par.nalloc  = 0;
+  par.slots   = 0;
+  par.nslots  = 0;
+
+  par.next    = 0;
+  par.current = 0;
+  par.stop    = 0;
+  par.serial  = 0;
+  par.clean   = PARALLEL_PRIME;
+  par.resume  = 0;
+
+  mad_stream_init(&decoder->sync->stream);
+  mad_frame_init(&decoder->sync->frame);
+  mad_synth_init(&decoder->sync->synth);
+
+  mad_stream_options(&decoder->sync->stream, decoder->options);
+
+  end = parallel_scan(&par);
+
+  /* the sequential state is rebuilt from the copied input as needed */
+
+  mad_stream_finish(&decoder->sync->stream);
+  mad_stream_init(&decoder->sync->stream);
+  mad_stream_options(&decoder->sync->stream, decoder->options);
+
+  result = end;
+
+  if (par.nframes == 0)
+    goto done;
+
+  nthreads = decoder->threads;
+# if defined(_SC_NPROCESSORS_ONLN)
+  if (nthreads <= 0)
+    nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+# endif
+  if (nthreads <= 0)
+    nthreads = 1;
+
+  par.nchunks = (par.nframes + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK;
+  if ((unsigned long) nthreads > par.nchunks)
+    nthreads = par.nchunks;
+
+  par.nslots = 2 * nthreads;
+  if ((unsigned long) par.nslots > par.nchunks)
+    par.nslots = par.nchunks;
+
+  par.slots = calloc(par.nslots, sizeof(*par.slots));
+  if (par.slots == 0)
+    goto fail;
+
+  for (i = 0; i < par.nslots; ++i) {
+    par.slots[i].chunk = -1;
+    par.slots[i].frames = malloc(PARALLEL_CHUNK * sizeof(struct parallel_frame));
+    if (par.slots[i].frames == 0)
+      goto fail;
+  }
+
+  pthread_mutex_init(&par.lock, 0);
+  pthread_cond_init(&par.ready, 0);
+  pthread_cond_init(&par.space, 0);
+
+  /* the calling thread decodes too */
+
+  if (nthreads > 1) {
+    workers = malloc((nthreads - 1) * sizeof(*workers));
+    if (workers) {
+      while (nworkers < nthreads - 1 &&
+	     pthread_create(&workers[nworkers], 0,
+			    parallel_worker, &par) == 0)
+	++nworkers;
+    }
+  }
+
+  result = parallel_deliver(&par);
+  if (result == 0)
+    result = end;
+  else if (result == 1)
+    result = 0;
+
+  pthread_mutex_lock(&par.lock);
+  par.stop = 1;
+  pthread_cond_broadcast(&par.space);
+  pthread_mutex_unlock(&par.lock);
+
+  while (nworkers--)
+    pthread_join(workers[nworkers], 0);
+
+  pthread_cond_destroy(&par.space);
+  pthread_cond_destroy(&par.ready);
+  pthread_mutex_destroy(&par.lock);
+
+  goto done;
+
+ fail:
+  result = -1;
+
+ done:
+  if (workers)
+    free(workers);
+
+  if (par.slots) {
+    for (i = 0; i < par.nslots; ++i) {
+      if (par.slots[i].frames)
+	free(par.slots[i].frames);
+    }
+
+    free(par.slots);
+  }
+
+  if (par.index)
+    free(par.index);
+  if (par.data)
+    free(par.data);
+
+  mad_synth_finish(&decoder->sync->synth);
+  mad_frame_finish(&decoder->sync->frame);
+  mad_stream_finish(&decoder->sync->stream);
+
+  return result;
+}
+# endif
+
 int mad_decoder_run(struct mad_decoder *decoder, enum mad_decoder_mode mode)
 {
   int result;
@@ -535,6 +1423,14 @@ int mad_decoder_run(struct mad_decoder *decoder, enum mad_decoder_mode mode)
   case MAD_DECODER_MODE_ASYNC:
 # if defined(USE_ASYNC)
     run = run_async;
+# endif
+    break;
+
+  case MAD_DECODER_MODE_PARALLEL:
+# if defined(USE_THREADS)
+    run = run_parallel;
+# else
+    run = run_sync;
 # endif
     break;
   }
@@ -28,7 +28,8 @@
 
 enum mad_decoder_mode {
   MAD_DECODER_MODE_SYNC  = 0,
-  MAD_DECODER_MODE_ASYNC
+  MAD_DECODER_MODE_ASYNC,
+  MAD_DECODER_MODE_PARALLEL
 };
 
 enum mad_flow {
@@ -42,6 +43,7 @@ struct mad_decoder {
   enum mad_decoder_mode mode;
 
   int options;
+  int threads;
 
   struct {
     long pid;
@@ -84,6 +86,8 @@ int mad_decoder_finish(struct mad_decoder *);
 
 # define mad_decoder_options(decoder, opts)  \
     ((void) ((decoder)->options = (opts)))
+# define mad_decoder_threads(decoder, count)  \
+    ((void) ((decoder)->threads = (count)))
 
 int mad_decoder_run(struct mad_decoder *, enum mad_decoder_mode);
 int mad_decoder_message(struct mad_decoder *, void *, unsigned int *);
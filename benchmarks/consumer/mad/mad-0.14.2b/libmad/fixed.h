@@ -107,15 +107,16 @@ typedef mad_fixed_t mad_sample_t;
 # define mad_f_sub(x, y)	((x) - (y))
 
 # if defined(FPM_FLOAT)
-#  error "FPM_FLOAT not yet supported"
 
-#  undef MAD_F
-#  define MAD_F(x)		mad_f_todouble(x)
-
-#  define mad_f_mul(x, y)	((x) * (y))
-#  define mad_f_scale64
+/*
+ * Samples keep their fixed-point representation, but products are formed
+ * in floating point. This is the format used by the SSE2/AVX2 routines;
+ * the C routines yield nearly the same results as FPM_64BIT.
+ */
+#  define mad_f_mul(x, y)  \
+    ((mad_fixed_t) ((double) (x) * (y) * (1.0 / (1L << MAD_F_SCALEBITS))))
 
-#  undef ASO_ZEROCHECK
+#  define MAD_F_SCALEBITS  MAD_F_FRACBITS
 
 # elif defined(FPM_64BIT)
 
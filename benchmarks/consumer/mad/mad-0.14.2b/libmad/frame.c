@@ -119,6 +119,8 @@ void mad_frame_finish(struct mad_frame *frame)
 static
 int decode_header(struct mad_header *header, struct mad_stream *stream)
 {
+  struct mad_bitptr crc_ptr;
+  unsigned long word;
   unsigned int index;
 
   header->flags        = 0;
@@ -126,15 +128,18 @@ int decode_header(struct mad_header *header, struct mad_stream *stream)
 
   /* header() */
 
-  /* syncword */
-  mad_bit_skip(&stream->ptr, 11);
+  /* all fields are taken from one read of the 32-bit header */
+  crc_ptr = stream->ptr;
+  word    = mad_bit_read(&stream->ptr, 32);
+
+  /* syncword (11 bits, verified by caller) */
 
   /* MPEG 2.5 indicator (really part of syncword) */
-  if (mad_bit_read(&stream->ptr, 1) == 0)
+  if (!(word & 0x00100000L))
     header->flags |= MAD_FLAG_MPEG_2_5_EXT;
 
   /* ID */
-  if (mad_bit_read(&stream->ptr, 1) == 0)
+  if (!(word & 0x00080000L))
     header->flags |= MAD_FLAG_LSF_EXT;
   else if (header->flags & MAD_FLAG_MPEG_2_5_EXT) {
     stream->error = MAD_ERROR_LOSTSYNC;
@@ -142,7 +147,7 @@ int decode_header(struct mad_header *header, struct mad_stream *stream)
   }
 
   /* layer */
-  header->layer = 4 - mad_bit_read(&stream->ptr, 2);
+  header->layer = 4 - ((word >> 17) & 0x3);
 
   if (header->layer == 4) {
     stream->error = MAD_ERROR_BADLAYER;
@@ -150,13 +155,15 @@ int decode_header(struct mad_header *header, struct mad_stream *stream)
   }
 
   /* protection_bit */
-  if (mad_bit_read(&stream->ptr, 1) == 0) {
+  if (!(word & 0x00010000L)) {
     header->flags    |= MAD_FLAG_PROTECTION;
-    header->crc_check = mad_bit_crc(stream->ptr, 16, 0xffff);
+
+    mad_bit_skip(&crc_ptr, 16);
+    header->crc_check = mad_bit_crc(crc_ptr, 16, 0xffff);
   }
 
   /* bitrate_index */
-  index = mad_bit_read(&stream->ptr, 4);
+  index = (word >> 12) & 0xf;
 
   if (index == 15) {
     stream->error = MAD_ERROR_BADBITRATE;
@@ -169,7 +176,7 @@ int decode_header(struct mad_header *header, struct mad_stream *stream)
     header->bitrate = bitrate_table[header->layer - 1][index];
 
   /* sampling_frequency */
-  index = mad_bit_read(&stream->ptr, 2);
+  index = (word >> 10) & 0x3;
 
   if (index == 3) {
     stream->error = MAD_ERROR_BADSAMPLERATE;
@@ -186,29 +193,29 @@ int decode_header(struct mad_header *header, struct mad_stream *stream)
   }
 
   /* padding_bit */
-  if (mad_bit_read(&stream->ptr, 1))
+  if (word & 0x0200)
     header->flags |= MAD_FLAG_PADDING;
 
   /* private_bit */
-  if (mad_bit_read(&stream->ptr, 1))
+  if (word & 0x0100)
     header->private_bits |= MAD_PRIVATE_HEADER;
 
   /* mode */
-  header->mode = 3 - mad_bit_read(&stream->ptr, 2);
+  header->mode = 3 - ((word >> 6) & 0x3);
 
   /* mode_extension */
-  header->mode_extension = mad_bit_read(&stream->ptr, 2);
+  header->mode_extension = (word >> 4) & 0x3;
 
   /* copyright */
-  if (mad_bit_read(&stream->ptr, 1))
+  if (word & 0x0008)
     header->flags |= MAD_FLAG_COPYRIGHT;
 
   /* original/copy */
-  if (mad_bit_read(&stream->ptr, 1))
+  if (word & 0x0004)
     header->flags |= MAD_FLAG_ORIGINAL;
 
   /* emphasis */
-  header->emphasis = mad_bit_read(&stream->ptr, 2);
+  header->emphasis = word & 0x3;
 
   if (header->emphasis == 2) {
     stream->error = MAD_ERROR_BADEMPHASIS;
@@ -291,10 +298,11 @@ int free_bitrate(struct mad_stream *stream, struct mad_header const *header)
 }
 
 /*
- * NAME:	header->decode()
- * DESCRIPTION:	read the next frame header from the stream
+ * NAME:	measure_header()
+ * DESCRIPTION:	locate and decode the next frame header and find its length
  */
-int mad_header_decode(struct mad_header *header, struct mad_stream *stream)
+static
+int measure_header(struct mad_header *header, struct mad_stream *stream)
 {
   register unsigned char const *ptr, *end;
   unsigned int pad_slot, N;
@@ -367,10 +375,6 @@ int mad_header_decode(struct mad_header *header, struct mad_stream *stream)
   if (decode_header(header, stream) == -1)
     goto fail;
 
-  /* calculate frame duration */
-  mad_timer_set(&header->duration, 0,
-		32 * MAD_NSBSAMPLES(header), header->samplerate);
-
   /* calculate free bit rate */
   if (header->bitrate == 0) {
     if ((stream->freerate == 0 || !stream->sync) &&
@@ -427,6 +431,49 @@ int mad_header_decode(struct mad_header *header, struct mad_stream *stream)
   return -1;
 }
 
+/*
+ * NAME:	header->decode()
+ * DESCRIPTION:	read the next frame header from the stream
+ */
+int mad_header_decode(struct mad_header *header, struct mad_stream *stream)
+{
+  if (measure_header(header, stream) == -1)
+    return -1;
+
+  /* calculate frame duration */
+  mad_timer_set(&header->duration, 0,
+		32 * MAD_NSBSAMPLES(header), header->samplerate);
+
+  return 0;
+}
+
+/*
+ * NAME:	header->scan()
+ * DESCRIPTION:	read the next frame header, reusing the previous duration
+ */
+int mad_header_scan(struct mad_header *header, struct mad_stream *stream)
+{
+  unsigned int samplerate, nsbsamples;
+
+  samplerate = header->samplerate;
+  nsbsamples = MAD_NSBSAMPLES(header);
+
+  if (measure_header(header, stream) == -1) {
+    /* the header may be partially overwritten; don't trust it again */
+    header->samplerate = 0;
+    return -1;
+  }
+
+  /* calculate frame duration only when it changes */
+  if (header->samplerate != samplerate ||
+      MAD_NSBSAMPLES(header) != nsbsamples) {
+    mad_timer_set(&header->duration, 0,
+		  32 * MAD_NSBSAMPLES(header), header->samplerate);
+  }
+
+  return 0;
+}
+
 /*
  * NAME:	frame->decode()
  * DESCRIPTION:	decode a single frame from a bitstream
@@ -47,6 +47,10 @@
 #  define USE_ASYNC
 # endif
 
+# if defined(HAVE_PTHREAD_H) && defined(HAVE_LIBPTHREAD)
+#  define USE_THREADS
+# endif
+
 # if !defined(HAVE_ASSERT_H)
 #  if defined(NDEBUG)
 #   define assert(x)	/* nothing */
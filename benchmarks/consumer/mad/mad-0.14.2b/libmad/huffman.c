@@ -3058,41 +3058,65 @@ union huffpair const hufftab24[] = {
 # undef V
 # undef PTR
 
+# define Q(values, signs, hlen)	{ hlen, values, signs }
+
+static
+struct huffquadfast const hq_table[2][1 << MAD_HUFF_QUADFAST_BITS] = {
+# include "hq_table.dat"
+};
+
+# undef Q
+
+# define P(x, y, signs, hlen)	{ 1, hlen, x, y, signs }
+# define X			{ 0 }
+
+static
+struct huffpairfast const hp_table[16][1 << MAD_HUFF_PAIRFAST_BITS] = {
+# include "hp_table.dat"
+};
+
+# undef X
+# undef P
+
 /* external tables */
 
 union huffquad const *const mad_huff_quad_table[2] = { hufftabA, hufftabB };
 
+struct huffquadfast const *const mad_huff_quad_fast[2] = {
+  hq_table[0], hq_table[1]
+};
+
 struct hufftable const mad_huff_pair_table[32] = {
-  /*  0 */ { hufftab0,   0, 0 },
-  /*  1 */ { hufftab1,   0, 3 },
-  /*  2 */ { hufftab2,   0, 3 },
-  /*  3 */ { hufftab3,   0, 3 },
+  /*  0 */ { hufftab0,   hp_table[0],   0, 0 },
+  /*  1 */ { hufftab1,   hp_table[1],   0, 3 },
+  /*  2 */ { hufftab2,   hp_table[2],   0, 3 },
+  /*  3 */ { hufftab3,   hp_table[3],   0, 3 },
   /*  4 */ { 0 /* not used */ },
-  /*  5 */ { hufftab5,   0, 3 },
-  /*  6 */ { hufftab6,   0, 4 },
-  /*  7 */ { hufftab7,   0, 4 },
-  /*  8 */ { hufftab8,   0, 4 },
-  /*  9 */ { hufftab9,   0, 4 },
-  /* 10 */ { hufftab10,  0, 4 },
-  /* 11 */ { hufftab11,  0, 4 },
-  /* 12 */ { hufftab12,  0, 4 },
-  /* 13 */ { hufftab13,  0, 4 },
+  /*  5 */ { hufftab5,   hp_table[4],   0, 3 },
+  /*  6 */ { hufftab6,   hp_table[5],   0, 4 },
+  /*  7 */ { hufftab7,   hp_table[6],   0, 4 },
+  /*  8 */ { hufftab8,   hp_table[7],   0, 4 },
+  /*  9 */ { hufftab9,   hp_table[8],   0, 4 },
+  /* 10 */ { hufftab10,  hp_table[9],   0, 4 },
+  /* 11 */ { hufftab11,  hp_table[10],  0, 4 },
+  /* 12 */ { hufftab12,  hp_table[11],  0, 4 },
+  /* 13 */ { hufftab13,  hp_table[12],  0, 4 },
   /* 14 */ { 0 /* not used */ },
-  /* 15 */ { hufftab15,  0, 4 },
-  /* 16 */ { hufftab16,  1, 4 },
-  /* 17 */ { hufftab16,  2, 4 },
-  /* 18 */ { hufftab16,  3, 4 },
-  /* 19 */ { hufftab16,  4, 4 },
-  /* 20 */ { hufftab16,  6, 4 },
-  /* 21 */ { hufftab16,  8, 4 },
-  /* 22 */ { hufftab16, 10, 4 },
-  /* 23 */ { hufftab16, 13, 4 },
-  /* 24 */ { hufftab24,  4, 4 },
-  /* 25 */ { hufftab24,  5, 4 },
-  /* 26 */ { hufftab24,  6, 4 },
-  /* 27 */ { hufftab24,  7, 4 },
-  /* 28 */ { hufftab24,  8, 4 },
-  /* 29 */ { hufftab24,  9, 4 },
-  /* 30 */ { hufftab24, 11, 4 },
-  /* 31 */ { hufftab24, 13, 4 }
+  /* 15 */ { hufftab15,  hp_table[13],  0, 4 },
+  /* 16 */ { hufftab16,  hp_table[14],  1, 4 },
+  /* 17 */ { hufftab16,  hp_table[14],  2, 4 },
+  /* 18 */ { hufftab16,  hp_table[14],  3, 4 },
+  /* 19 */ { hufftab16,  hp_table[14],  4, 4 },
+  /* 20 */ { hufftab16,  hp_table[14],  6, 4 },
+  /* 21 */ { hufftab16,  hp_table[14],  8, 4 },
+  /* 22 */ { hufftab16,  hp_table[14], 10, 4 },
+  /* 23 */ { hufftab16,  hp_table[14], 13, 4 },
+  /* 24 */ { hufftab24,  hp_table[15],  4, 4 },
+  /* 25 */ { hufftab24,  hp_table[15],  5, 4 },
+  /* 26 */ { hufftab24,  hp_table[15],  6, 4 },
+  /* 27 */ { hufftab24,  hp_table[15],  7, 4 },
+  /* 28 */ { hufftab24,  hp_table[15],  8, 4 },
+  /* 29 */ { hufftab24,  hp_table[15],  9, 4 },
+  /* 30 */ { hufftab24,  hp_table[15], 11, 4 },
+  /* 31 */ { hufftab24,  hp_table[15], 13, 4 }
 };
@@ -54,13 +54,32 @@ union huffpair {
   unsigned short final    :  1;
 };
 
+struct huffquadfast {
+  unsigned short hlen     :  4;		/* code word and sign bits */
+  unsigned short values   :  4;		/* nonzero v, w, x, y (bits 3..0) */
+  unsigned short signs    :  4;		/* negative v, w, x, y (bits 3..0) */
+};
+
+struct huffpairfast {
+  unsigned short final    :  1;		/* entry is a complete decode */
+  unsigned short hlen     :  4;		/* code word and sign bits */
+  unsigned short x        :  4;
+  unsigned short y        :  4;
+  unsigned short signs    :  2;		/* negative x, y (bits 1..0) */
+};
+
+# define MAD_HUFF_QUADFAST_BITS	10
+# define MAD_HUFF_PAIRFAST_BITS	8
+
 struct hufftable {
   union huffpair const *table;
+  struct huffpairfast const *fast;
   unsigned short linbits;
   unsigned short startbits;
 };
 
 extern union huffquad const *const mad_huff_quad_table[2];
+extern struct huffquadfast const *const mad_huff_quad_fast[2];
 extern struct hufftable const mad_huff_pair_table[32];
 
 # endif
@@ -0,0 +1,441 @@
+/*
+ * libmad - MPEG audio decoder library
+ * Copyright (C) 2000-2001 Robert Leslie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+# ifdef HAVE_CONFIG_H
+#  include "config.h"
+# endif
+
+# include "global.h"
+
+# include "fixed.h"
+# include "sse.h"
+
+int III_imdct_l4(mad_fixed_t const [72], mad_fixed_t [4][36], unsigned int);
+
+# if defined(SSE_FIXED) || defined(SSE_FLOAT)
+
+# define W(x)  SSE_COEF(MAD_F(x))
+
+/* windowing coefficients for long and short blocks; see layer3.c */
+
+static
+sse_coef const window_l[36] = {
+  W(0x00b2aa3e) /* 0.043619387 */, W(0x0216a2a2) /* 0.130526192 */,
+  W(0x03768962) /* 0.216439614 */, W(0x04cfb0e2) /* 0.300705800 */,
+  W(0x061f78aa) /* 0.382683432 */, W(0x07635284) /* 0.461748613 */,
+  W(0x0898c779) /* 0.537299608 */, W(0x09bd7ca0) /* 0.608761429 */,
+  W(0x0acf37ad) /* 0.675590208 */, W(0x0bcbe352) /* 0.737277337 */,
+  W(0x0cb19346) /* 0.793353340 */, W(0x0d7e8807) /* 0.843391446 */,
+
+  W(0x0e313245) /* 0.887010833 */, W(0x0ec835e8) /* 0.923879533 */,
+  W(0x0f426cb5) /* 0.953716951 */, W(0x0f9ee890) /* 0.976296007 */,
+  W(0x0fdcf549) /* 0.991444861 */, W(0x0ffc19fd) /* 0.999048222 */,
+  W(0x0ffc19fd) /* 0.999048222 */, W(0x0fdcf549) /* 0.991444861 */,
+  W(0x0f9ee890) /* 0.976296007 */, W(0x0f426cb5) /* 0.953716951 */,
+  W(0x0ec835e8) /* 0.923879533 */, W(0x0e313245) /* 0.887010833 */,
+
+  W(0x0d7e8807) /* 0.843391446 */, W(0x0cb19346) /* 0.793353340 */,
+  W(0x0bcbe352) /* 0.737277337 */, W(0x0acf37ad) /* 0.675590208 */,
+  W(0x09bd7ca0) /* 0.608761429 */, W(0x0898c779) /* 0.537299608 */,
+  W(0x07635284) /* 0.461748613 */, W(0x061f78aa) /* 0.382683432 */,
+  W(0x04cfb0e2) /* 0.300705800 */, W(0x03768962) /* 0.216439614 */,
+  W(0x0216a2a2) /* 0.130526192 */, W(0x00b2aa3e) /* 0.043619387 */,
+};
+
+static
+sse_coef const window_s[12] = {
+  W(0x0216a2a2) /* 0.130526192 */, W(0x061f78aa) /* 0.382683432 */,
+  W(0x09bd7ca0) /* 0.608761429 */, W(0x0cb19346) /* 0.793353340 */,
+  W(0x0ec835e8) /* 0.923879533 */, W(0x0fdcf549) /* 0.991444861 */,
+  W(0x0fdcf549) /* 0.991444861 */, W(0x0ec835e8) /* 0.923879533 */,
+  W(0x0cb19346) /* 0.793353340 */, W(0x09bd7ca0) /* 0.608761429 */,
+  W(0x061f78aa) /* 0.382683432 */, W(0x0216a2a2) /* 0.130526192 */,
+};
+
+# undef W
+
+# define ML0(lo, x, y)	((lo)  = SSE_MUL((x), (y)))
+# define MLA(lo, x, y)	((lo) += SSE_MUL((x), (y)))
+
+/*
+ * NAME:	imdct36
+ * DESCRIPTION:	perform X[18]->x[36] IMDCT on each vector lane
+ */
+static inline SSE_TARGET
+void imdct36(sse_vec const X[18], sse_vec x[36])
+{
+  sse_vec t0, t1, t2,  t3,  t4,  t5,  t6,  t7;
+  sse_vec t8, t9, t10, t11, t12, t13, t14, t15;
+  sse_vec lo;
+
+  ML0(lo, X[4],  MAD_F(0x0ec835e8));
+  MLA(lo, X[13], MAD_F(0x061f78aa));
+
+  t6 = lo;
+
+  MLA(lo, (t14 = X[1] - X[10]), -MAD_F(0x061f78aa));
+  MLA(lo, (t15 = X[7] + X[16]), -MAD_F(0x0ec835e8));
+
+  t0 = lo;
+
+  MLA(lo, (t8  = X[0] - X[11] - X[12]),  MAD_F(0x0216a2a2));
+  MLA(lo, (t9  = X[2] - X[9]  - X[14]),  MAD_F(0x09bd7ca0));
+  MLA(lo, (t10 = X[3] - X[8]  - X[15]), -MAD_F(0x0cb19346));
+  MLA(lo, (t11 = X[5] - X[6]  - X[17]), -MAD_F(0x0fdcf549));
+
+  x[7]  = lo;
+  x[10] = -x[7];
+
+  ML0(lo, t8,  -MAD_F(0x0cb19346));
+  MLA(lo, t9,   MAD_F(0x0fdcf549));
+  MLA(lo, t10,  MAD_F(0x0216a2a2));
+  MLA(lo, t11, -MAD_F(0x09bd7ca0));
+
+  x[19] = x[34] = lo - t0;
+
+  t12 = X[0] - X[3] + X[8] - X[11] - X[12] + X[15];
+  t13 = X[2] + X[5] - X[6] - X[9]  - X[14] - X[17];
+
+  ML0(lo, t12, -MAD_F(0x0ec835e8));
+  MLA(lo, t13,  MAD_F(0x061f78aa));
+
+  x[22] = x[31] = lo + t0;
+
+  ML0(lo, X[1],  -MAD_F(0x09bd7ca0));
+  MLA(lo, X[7],   MAD_F(0x0216a2a2));
+  MLA(lo, X[10], -MAD_F(0x0fdcf549));
+  MLA(lo, X[16],  MAD_F(0x0cb19346));
+
+  t1 = lo + t6;
+
+  ML0(lo, X[0],   MAD_F(0x03768962));
+  MLA(lo, X[2],   MAD_F(0x0e313245));
+  MLA(lo, X[3],  -MAD_F(0x0ffc19fd));
+  MLA(lo, X[5],  -MAD_F(0x0acf37ad));
+  MLA(lo, X[6],   MAD_F(0x04cfb0e2));
+  MLA(lo, X[8],  -MAD_F(0x0898c779));
+  MLA(lo, X[9],   MAD_F(0x0d7e8807));
+  MLA(lo, X[11],  MAD_F(0x0f426cb5));
+  MLA(lo, X[12], -MAD_F(0x0bcbe352));
+  MLA(lo, X[14],  MAD_F(0x00b2aa3e));
+  MLA(lo, X[15], -MAD_F(0x07635284));
+  MLA(lo, X[17], -MAD_F(0x0f9ee890));
+
+  x[6]  = lo + t1;
+  x[11] = -x[6];
+
+  ML0(lo, X[0],  -MAD_F(0x0f426cb5));
+  MLA(lo, X[2],  -MAD_F(0x00b2aa3e));
+  MLA(lo, X[3],   MAD_F(0x0898c779));
+  MLA(lo, X[5],   MAD_F(0x0f9ee890));
+  MLA(lo, X[6],   MAD_F(0x0acf37ad));
+  MLA(lo, X[8],  -MAD_F(0x07635284));
+  MLA(lo, X[9],  -MAD_F(0x0e313245));
+  MLA(lo, X[11], -MAD_F(0x0bcbe352));
+  MLA(lo, X[12], -MAD_F(0x03768962));
+  MLA(lo, X[14],  MAD_F(0x0d7e8807));
+  MLA(lo, X[15],  MAD_F(0x0ffc19fd));
+  MLA(lo, X[17],  MAD_F(0x04cfb0e2));
+
+  x[23] = x[30] = lo + t1;
+
+  ML0(lo, X[0],  -MAD_F(0x0bcbe352));
+  MLA(lo, X[2],   MAD_F(0x0d7e8807));
+  MLA(lo, X[3],  -MAD_F(0x07635284));
+  MLA(lo, X[5],   MAD_F(0x04cfb0e2));
+  MLA(lo, X[6],   MAD_F(0x0f9ee890));
+  MLA(lo, X[8],  -MAD_F(0x0ffc19fd));
+  MLA(lo, X[9],  -MAD_F(0x00b2aa3e));
+  MLA(lo, X[11],  MAD_F(0x03768962));
+  MLA(lo, X[12], -MAD_F(0x0f426cb5));
+  MLA(lo, X[14],  MAD_F(0x0e313245));
+  MLA(lo, X[15],  MAD_F(0x0898c779));
+  MLA(lo, X[17], -MAD_F(0x0acf37ad));
+
+  x[18] = x[35] = lo - t1;
+
+  ML0(lo, X[4],   MAD_F(0x061f78aa));
+  MLA(lo, X[13], -MAD_F(0x0ec835e8));
+
+  t7 = lo;
+
+  MLA(lo, X[1],  -MAD_F(0x0cb19346));
+  MLA(lo, X[7],   MAD_F(0x0fdcf549));
+  MLA(lo, X[10],  MAD_F(0x0216a2a2));
+  MLA(lo, X[16], -MAD_F(0x09bd7ca0));
+
+  t2 = lo;
+
+  MLA(lo, X[0],   MAD_F(0x04cfb0e2));
+  MLA(lo, X[2],   MAD_F(0x0ffc19fd));
+  MLA(lo, X[3],  -MAD_F(0x0d7e8807));
+  MLA(lo, X[5],   MAD_F(0x03768962));
+  MLA(lo, X[6],  -MAD_F(0x0bcbe352));
+  MLA(lo, X[8],  -MAD_F(0x0e313245));
+  MLA(lo, X[9],   MAD_F(0x07635284));
+  MLA(lo, X[11], -MAD_F(0x0acf37ad));
+  MLA(lo, X[12],  MAD_F(0x0f9ee890));
+  MLA(lo, X[14],  MAD_F(0x0898c779));
+  MLA(lo, X[15],  MAD_F(0x00b2aa3e));
+  MLA(lo, X[17],  MAD_F(0x0f426cb5));
+
+  x[5]  = lo;
+  x[12] = -x[5];
+
+  ML0(lo, X[0],   MAD_F(0x0acf37ad));
+  MLA(lo, X[2],  -MAD_F(0x0898c779));
+  MLA(lo, X[3],   MAD_F(0x0e313245));
+  MLA(lo, X[5],  -MAD_F(0x0f426cb5));
+  MLA(lo, X[6],  -MAD_F(0x03768962));
+  MLA(lo, X[8],   MAD_F(0x00b2aa3e));
+  MLA(lo, X[9],  -MAD_F(0x0ffc19fd));
+  MLA(lo, X[11],  MAD_F(0x0f9ee890));
+  MLA(lo, X[12], -MAD_F(0x04cfb0e2));
+  MLA(lo, X[14],  MAD_F(0x07635284));
+  MLA(lo, X[15],  MAD_F(0x0d7e8807));
+  MLA(lo, X[17], -MAD_F(0x0bcbe352));
+
+  x[0]  = lo + t2;
+  x[17] = -x[0];
+
+  ML0(lo, X[0],  -MAD_F(0x0f9ee890));
+  MLA(lo, X[2],  -MAD_F(0x07635284));
+  MLA(lo, X[3],  -MAD_F(0x00b2aa3e));
+  MLA(lo, X[5],   MAD_F(0x0bcbe352));
+  MLA(lo, X[6],   MAD_F(0x0f426cb5));
+  MLA(lo, X[8],   MAD_F(0x0d7e8807));
+  MLA(lo, X[9],   MAD_F(0x0898c779));
+  MLA(lo, X[11], -MAD_F(0x04cfb0e2));
+  MLA(lo, X[12], -MAD_F(0x0acf37ad));
+  MLA(lo, X[14], -MAD_F(0x0ffc19fd));
+  MLA(lo, X[15], -MAD_F(0x0e313245));
+  MLA(lo, X[17], -MAD_F(0x03768962));
+
+  x[24] = x[29] = lo + t2;
+
+  ML0(lo, X[1],  -MAD_F(0x0216a2a2));
+  MLA(lo, X[7],  -MAD_F(0x09bd7ca0));
+  MLA(lo, X[10],  MAD_F(0x0cb19346));
+  MLA(lo, X[16],  MAD_F(0x0fdcf549));
+
+  t3 = lo + t7;
+
+  ML0(lo, X[0],   MAD_F(0x00b2aa3e));
+  MLA(lo, X[2],   MAD_F(0x03768962));
+  MLA(lo, X[3],  -MAD_F(0x04cfb0e2));
+  MLA(lo, X[5],  -MAD_F(0x07635284));
+  MLA(lo, X[6],   MAD_F(0x0898c779));
+  MLA(lo, X[8],   MAD_F(0x0acf37ad));
+  MLA(lo, X[9],  -MAD_F(0x0bcbe352));
+  MLA(lo, X[11], -MAD_F(0x0d7e8807));
+  MLA(lo, X[12],  MAD_F(0x0e313245));
+  MLA(lo, X[14],  MAD_F(0x0f426cb5));
+  MLA(lo, X[15], -MAD_F(0x0f9ee890));
+  MLA(lo, X[17], -MAD_F(0x0ffc19fd));
+
+  x[8] = lo + t3;
+  x[9] = -x[8];
+
+  ML0(lo, X[0],  -MAD_F(0x0e313245));
+  MLA(lo, X[2],   MAD_F(0x0bcbe352));
+  MLA(lo, X[3],   MAD_F(0x0f9ee890));
+  MLA(lo, X[5],  -MAD_F(0x0898c779));
+  MLA(lo, X[6],  -MAD_F(0x0ffc19fd));
+  MLA(lo, X[8],   MAD_F(0x04cfb0e2));
+  MLA(lo, X[9],   MAD_F(0x0f426cb5));
+  MLA(lo, X[11], -MAD_F(0x00b2aa3e));
+  MLA(lo, X[12], -MAD_F(0x0d7e8807));
+  MLA(lo, X[14], -MAD_F(0x03768962));
+  MLA(lo, X[15],  MAD_F(0x0acf37ad));
+  MLA(lo, X[17],  MAD_F(0x07635284));
+
+  x[21] = x[32] = lo + t3;
+
+  ML0(lo, X[0],  -MAD_F(0x0d7e8807));
+  MLA(lo, X[2],   MAD_F(0x0f426cb5));
+  MLA(lo, X[3],   MAD_F(0x0acf37ad));
+  MLA(lo, X[5],  -MAD_F(0x0ffc19fd));
+  MLA(lo, X[6],  -MAD_F(0x07635284));
+  MLA(lo, X[8],   MAD_F(0x0f9ee890));
+  MLA(lo, X[9],   MAD_F(0x03768962));
+  MLA(lo, X[11], -MAD_F(0x0e313245));
+  MLA(lo, X[12],  MAD_F(0x00b2aa3e));
+  MLA(lo, X[14],  MAD_F(0x0bcbe352));
+  MLA(lo, X[15], -MAD_F(0x04cfb0e2));
+  MLA(lo, X[17], -MAD_F(0x0898c779));
+
+  x[20] = x[33] = lo - t3;
+
+  ML0(lo, t14, -MAD_F(0x0ec835e8));
+  MLA(lo, t15,  MAD_F(0x061f78aa));
+
+  t4 = lo - t7;
+
+  ML0(lo, t12, MAD_F(0x061f78aa));
+  MLA(lo, t13, MAD_F(0x0ec835e8));
+
+  x[4]  = lo + t4;
+  x[13] = -x[4];
+
+  ML0(lo, t8,   MAD_F(0x09bd7ca0));
+  MLA(lo, t9,  -MAD_F(0x0216a2a2));
+  MLA(lo, t10,  MAD_F(0x0fdcf549));
+  MLA(lo, t11, -MAD_F(0x0cb19346));
+
+  x[1]  = lo + t4;
+  x[16] = -x[1];
+
+  ML0(lo, t8,  -MAD_F(0x0fdcf549));
+  MLA(lo, t9,  -MAD_F(0x0cb19346));
+  MLA(lo, t10, -MAD_F(0x09bd7ca0));
+  MLA(lo, t11, -MAD_F(0x0216a2a2));
+
+  x[25] = x[28] = lo + t4;
+
+  ML0(lo, X[1],  -MAD_F(0x0fdcf549));
+  MLA(lo, X[7],  -MAD_F(0x0cb19346));
+  MLA(lo, X[10], -MAD_F(0x09bd7ca0));
+  MLA(lo, X[16], -MAD_F(0x0216a2a2));
+
+  t5 = lo - t6;
+
+  ML0(lo, X[0],   MAD_F(0x0898c779));
+  MLA(lo, X[2],   MAD_F(0x04cfb0e2));
+  MLA(lo, X[3],   MAD_F(0x0bcbe352));
+  MLA(lo, X[5],   MAD_F(0x00b2aa3e));
+  MLA(lo, X[6],   MAD_F(0x0e313245));
+  MLA(lo, X[8],  -MAD_F(0x03768962));
+  MLA(lo, X[9],   MAD_F(0x0f9ee890));
+  MLA(lo, X[11], -MAD_F(0x07635284));
+  MLA(lo, X[12],  MAD_F(0x0ffc19fd));
+  MLA(lo, X[14], -MAD_F(0x0acf37ad));
+  MLA(lo, X[15],  MAD_F(0x0f426cb5));
+  MLA(lo, X[17], -MAD_F(0x0d7e8807));
+
+  x[2]  = lo + t5;
+  x[15] = -x[2];
+
+  ML0(lo, X[0],   MAD_F(0x07635284));
+  MLA(lo, X[2],   MAD_F(0x0acf37ad));
+  MLA(lo, X[3],   MAD_F(0x03768962));
+  MLA(lo, X[5],   MAD_F(0x0d7e8807));
+  MLA(lo, X[6],  -MAD_F(0x00b2aa3e));
+  MLA(lo, X[8],   MAD_F(0x0f426cb5));
+  MLA(lo, X[9],  -MAD_F(0x04cfb0e2));
+  MLA(lo, X[11],  MAD_F(0x0ffc19fd));
+  MLA(lo, X[12], -MAD_F(0x0898c779));
+  MLA(lo, X[14],  MAD_F(0x0f9ee890));
+  MLA(lo, X[15], -MAD_F(0x0bcbe352));
+  MLA(lo, X[17],  MAD_F(0x0e313245));
+
+  x[3]  = lo + t5;
+  x[14] = -x[3];
+
+  ML0(lo, X[0],  -MAD_F(0x0ffc19fd));
+  MLA(lo, X[2],  -MAD_F(0x0f9ee890));
+  MLA(lo, X[3],  -MAD_F(0x0f426cb5));
+  MLA(lo, X[5],  -MAD_F(0x0e313245));
+  MLA(lo, X[6],  -MAD_F(0x0d7e8807));
+  MLA(lo, X[8],  -MAD_F(0x0bcbe352));
+  MLA(lo, X[9],  -MAD_F(0x0acf37ad));
+  MLA(lo, X[11], -MAD_F(0x0898c779));
+  MLA(lo, X[12], -MAD_F(0x07635284));
+  MLA(lo, X[14], -MAD_F(0x04cfb0e2));
+  MLA(lo, X[15], -MAD_F(0x03768962));
+  MLA(lo, X[17], -MAD_F(0x00b2aa3e));
+
+  x[26] = x[27] = lo + t5;
+}
+
+# undef ML0
+# undef MLA
+
+# define WIN(x, w)	sse_mul((x), (w), MAD_F_FRACBITS)
+
+/*
+ * NAME:	imdct_l4()
+ * DESCRIPTION:	perform IMDCT and windowing for four long blocks
+ */
+static SSE_TARGET
+void imdct_l4(mad_fixed_t const X[72], mad_fixed_t z[4][36],
+	      unsigned int block_type)
+{
+  sse_vec x[36], y[18];
+  unsigned int i, j;
+
+  for (i = 0; i < 18; ++i)
+    y[i] = sse_load(X[i], X[18 + i], X[36 + i], X[54 + i]);
+
+  /* IMDCT */
+
+  imdct36(y, x);
+
+  /* windowing */
+
+  switch (block_type) {
+  case 0:  /* normal window */
+    for (i =  0; i < 36; ++i) x[i] = WIN(x[i], window_l[i]);
+    break;
+
+  case 1:  /* start block */
+    for (i =  0; i < 18; ++i) x[i] = WIN(x[i], window_l[i]);
+    /*  (i = 18; i < 24; ++i) x[i] unchanged */
+    for (i = 24; i < 30; ++i) x[i] = WIN(x[i], window_s[i - 18]);
+    for (i = 30; i < 36; ++i) x[i] = (sse_vec) { 0 };
+    break;
+
+  case 3:  /* stop block */
+    for (i =  0; i <  6; ++i) x[i] = (sse_vec) { 0 };
+    for (i =  6; i < 12; ++i) x[i] = WIN(x[i], window_s[i - 6]);
+    /*  (i = 12; i < 18; ++i) x[i] unchanged */
+    for (i = 18; i < 36; ++i) x[i] = WIN(x[i], window_l[i]);
+    break;
+  }
+
+  for (j = 0; j < 4; ++j) {
+    for (i = 0; i < 36; ++i)
+      z[j][i] = sse_lane(x[i], j);
+  }
+}
+
+# undef WIN
+# endif
+
+/*
+ * NAME:	III_imdct_l4()
+ * DESCRIPTION:	perform IMDCT and windowing for four consecutive long blocks
+ *		with SSE2/AVX2; return -1 if the processor or configuration
+ *		is not supported
+ */
+int III_imdct_l4(mad_fixed_t const X[72], mad_fixed_t z[4][36],
+		 unsigned int block_type)
+{
+# if defined(SSE_FIXED)
+  if (!__builtin_cpu_supports("avx2"))
+    return -1;
+# endif
+
+# if defined(SSE_FIXED) || defined(SSE_FLOAT)
+  imdct_l4(X, z, block_type);
+
+  return 0;
+# else
+  return -1;
+# endif
+}
@@ -923,7 +923,68 @@ mad_fixed_t III_requantize(unsigned int value, signed int exp)
 # define MASK(cache, sz, bits)	\
     (((cache) >> ((sz) - (bits))) & ((1 << (bits)) - 1))
 # define MASK1BIT(cache, sz)  \
-    ((cache) & (1 << ((sz) - 1)))
+    ((cache) & (1UL << ((sz) - 1)))
+
+/*
+ * The Huffman decoder keeps the upcoming part3 bits in a cache of
+ * CACHE_BYTES bytes. The cache is topped up with whole bytes once per code
+ * word using a single big-endian load while enough of the part3 region
+ * remains; past the end of the region it is padded with zero bits, which
+ * can only feed code words that are rejected as overruns.
+ */
+# if SIZEOF_LONG >= 8
+#  define CACHE_BYTES	8
+# else
+#  define CACHE_BYTES	4
+# endif
+
+/*
+ * NAME:	III_refill()
+ * DESCRIPTION:	top up the Huffman bit cache with as many bytes as will fit
+ */
+static inline
+unsigned long III_refill(unsigned long bitcache, signed int *cachesz,
+			 signed int *bits_left, unsigned char const **byte,
+			 unsigned char const *end)
+{
+  unsigned char const *ptr = *byte;
+  unsigned int bits;
+
+  bits = ((CACHE_BYTES * CHAR_BIT - 1) - *cachesz) & ~(CHAR_BIT - 1);
+
+  if (end - ptr >= CACHE_BYTES) {
+    unsigned long word;
+
+# if CACHE_BYTES == 8
+    word = ((unsigned long) ptr[0] << 56) | ((unsigned long) ptr[1] << 48) |
+	   ((unsigned long) ptr[2] << 40) | ((unsigned long) ptr[3] << 32) |
+	   ((unsigned long) ptr[4] << 24) | ((unsigned long) ptr[5] << 16) |
+	   ((unsigned long) ptr[6] <<  8) | ((unsigned long) ptr[7] <<  0);
+# else
+    word = ((unsigned long) ptr[0] << 24) | ((unsigned long) ptr[1] << 16) |
+	   ((unsigned long) ptr[2] <<  8) | ((unsigned long) ptr[3] <<  0);
+# endif
+
+    /* split shift lest bits == 0 */
+    bitcache = (bitcache << bits) |
+      ((word >> 1) >> (CACHE_BYTES * CHAR_BIT - 1 - bits));
+  }
+  else {
+    unsigned int count;
+
+    for (count = 0; count < bits; count += CHAR_BIT) {
+      bitcache <<= CHAR_BIT;
+      if (ptr + count / CHAR_BIT < end)
+	bitcache |= ptr[count / CHAR_BIT];
+    }
+  }
+
+  *byte       = ptr + bits / CHAR_BIT;
+  *cachesz   += bits;
+  *bits_left -= bits;
+
+  return bitcache;
+}
 
 /*
  * NAME:	III_huffdecode()
@@ -938,6 +999,7 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xr[576],
   signed int exponents[39], exp;
   signed int const *expptr;
   struct mad_bitptr peek;
+  unsigned char const *byte, *end;
   signed int bits_left, cachesz;
   register mad_fixed_t *xrptr;
   mad_fixed_t const *sfbound;
@@ -952,6 +1014,8 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xr[576],
   peek = *ptr;
   mad_bit_skip(ptr, bits_left);
 
+  end = mad_bit_nextbyte(ptr);
+
   /* align bit reads to byte boundaries */
   cachesz  = mad_bit_bitsleft(&peek);
   cachesz += ((32 - 1 - 24) + (24 - cachesz)) & ~7;
@@ -959,6 +1023,8 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xr[576],
   bitcache   = mad_bit_read(&peek, cachesz);
   bits_left -= cachesz;
 
+  byte = peek.byte;
+
   xrptr = &xr[0];
 
   /* big_values */
@@ -966,6 +1032,7 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xr[576],
     unsigned int region, rcount;
     struct hufftable const *entry;
     union huffpair const *table;
+    struct huffpairfast const *fast;
     unsigned int linbits, startbits, big_values, reqhits;
     mad_fixed_t reqcache[16];
 
@@ -974,6 +1041,7 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xr[576],
 
     entry     = &mad_huff_pair_table[channel->table_select[region = 0]];
     table     = entry->table;
+    fast      = entry->fast;
     linbits   = entry->linbits;
     startbits = entry->startbits;
 
@@ -982,12 +1050,16 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xr[576],
 
     expptr  = &exponents[0];
     exp     = *expptr++;
-    reqhits = 0;
+
+    /* a zero value is always cached */
+    reqcache[0] = 0;
+    reqhits     = 1;
 
     big_values = channel->big_values;
 
     while (big_values-- && cachesz + bits_left > 0) {
       union huffpair const *pair;
+      struct huffpairfast const *quick;
       unsigned int clumpsz, value;
       register mad_fixed_t requantized;
 
@@ -1004,6 +1076,7 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xr[576],
 
 	  entry     = &mad_huff_pair_table[channel->table_select[++region]];
 	  table     = entry->table;
+	  fast      = entry->fast;
 	  linbits   = entry->linbits;
 	  startbits = entry->startbits;
 
@@ -1013,19 +1086,41 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xr[576],
 
 	if (exp != *expptr) {
 	  exp = *expptr;
-	  reqhits = 0;
+	  reqhits = 1;
 	}
 
 	++expptr;
       }
 
-      if (cachesz < 21) {
-	unsigned int bits;
+      bitcache = III_refill(bitcache, &cachesz, &bits_left, &byte, end);
+
+      /* short hcod with sign bits */
 
-	bits       = ((32 - 1 - 21) + (21 - cachesz)) & ~7;
-	bitcache   = (bitcache << bits) | mad_bit_read(&peek, bits);
-	cachesz   += bits;
-	bits_left -= bits;
+      quick = &fast[MASK(bitcache, cachesz, MAD_HUFF_PAIRFAST_BITS)];
+
+      if (quick->final) {
+	cachesz -= quick->hlen;
+
+	value = quick->x;
+
+	if (!(reqhits & (1 << value))) {
+	  reqhits |= (1 << value);
+	  reqcache[value] = III_requantize(value, exp);
+	}
+
+	xrptr[0] = (quick->signs & 2) ? -reqcache[value] : reqcache[value];
+
+	value = quick->y;
+
+	if (!(reqhits & (1 << value))) {
+	  reqhits |= (1 << value);
+	  reqcache[value] = III_requantize(value, exp);
+	}
+
+	xrptr[1] = (quick->signs & 1) ? -reqcache[value] : reqcache[value];
+
+	xrptr += 2;
+	continue;
       }
 
       /* hcod (0..19) */
@@ -1053,11 +1148,8 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xr[576],
 	  break;
 
 	case 15:
-	  if (cachesz < linbits + 2) {
-	    bitcache   = (bitcache << 16) | mad_bit_read(&peek, 16);
-	    cachesz   += 16;
-	    bits_left -= 16;
-	  }
+	  if (cachesz < linbits + 2)
+	    bitcache = III_refill(bitcache, &cachesz, &bits_left, &byte, end);
 
 	  value += MASK(bitcache, cachesz, linbits);
 	  cachesz -= linbits;
@@ -1088,11 +1180,8 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xr[576],
 	  break;
 
 	case 15:
-	  if (cachesz < linbits + 1) {
-	    bitcache   = (bitcache << 16) | mad_bit_read(&peek, 16);
-	    cachesz   += 16;
-	    bits_left -= 16;
-	  }
+	  if (cachesz < linbits + 1)
+	    bitcache = III_refill(bitcache, &cachesz, &bits_left, &byte, end);
 
 	  value += MASK(bitcache, cachesz, linbits);
 	  cachesz -= linbits;
@@ -1160,35 +1249,23 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xr[576],
 
   /* count1 */
   {
-    union huffquad const *table;
+    struct huffquadfast const *table;
     register mad_fixed_t requantized;
 
-    table = mad_huff_quad_table[channel->flags & count1table_select];
+    table = mad_huff_quad_fast[channel->flags & count1table_select];
 
     requantized = III_requantize(1, exp);
 
     while (cachesz + bits_left > 0 && xrptr <= &xr[572]) {
-      union huffquad const *quad;
+      struct huffquadfast const *quad;
 
-      /* hcod (1..6) */
+      bitcache = III_refill(bitcache, &cachesz, &bits_left, &byte, end);
 
-      if (cachesz < 10) {
-	bitcache   = (bitcache << 16) | mad_bit_read(&peek, 16);
-	cachesz   += 16;
-	bits_left -= 16;
-      }
+      /* hcod (1..6) with sign bits */
 
-      quad = &table[MASK(bitcache, cachesz, 4)];
+      quad = &table[MASK(bitcache, cachesz, MAD_HUFF_QUADFAST_BITS)];
 
-      /* quad tables guaranteed to have at most one extra lookup */
-      if (!quad->final) {
-	cachesz -= 4;
-
-	quad = &table[quad->ptr.offset +
-		      MASK(bitcache, cachesz, quad->ptr.bits)];
-      }
-
-      cachesz -= quad->value.hlen;
+      cachesz -= quad->hlen;
 
       if (xrptr == sfbound) {
 	sfbound += *sfbwidth++;
@@ -1203,13 +1280,13 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xr[576],
 
       /* v (0..1) */
 
-      xrptr[0] = quad->value.v ?
-	(MASK1BIT(bitcache, cachesz--) ? -requantized : requantized) : 0;
+      xrptr[0] = (quad->values & 8) ?
+	((quad->signs & 8) ? -requantized : requantized) : 0;
 
       /* w (0..1) */
 
-      xrptr[1] = quad->value.w ?
-	(MASK1BIT(bitcache, cachesz--) ? -requantized : requantized) : 0;
+      xrptr[1] = (quad->values & 4) ?
+	((quad->signs & 4) ? -requantized : requantized) : 0;
 
       xrptr += 2;
 
@@ -1226,13 +1303,13 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xr[576],
 
       /* x (0..1) */
 
-      xrptr[0] = quad->value.x ?
-	(MASK1BIT(bitcache, cachesz--) ? -requantized : requantized) : 0;
+      xrptr[0] = (quad->values & 2) ?
+	((quad->signs & 2) ? -requantized : requantized) : 0;
 
       /* y (0..1) */
 
-      xrptr[1] = quad->value.y ?
-	(MASK1BIT(bitcache, cachesz--) ? -requantized : requantized) : 0;
+      xrptr[1] = (quad->values & 1) ?
+	((quad->signs & 1) ? -requantized : requantized) : 0;
 
       xrptr += 2;
     }
@@ -1270,6 +1347,7 @@ enum mad_error III_huffdecode(struct mad_bitptr *ptr, mad_fixed_t xr[576],
   return MAD_ERROR_NONE;
 }
 
+# undef CACHE_BYTES
 # undef MASK
 # undef MASK1BIT
 
@@ -1945,6 +2023,10 @@ void III_imdct_l(mad_fixed_t const X[18], mad_fixed_t z[36],
 }
 # endif  /* ASO_IMDCT */
 
+# if defined(ASO_SSE)
+int III_imdct_l4(mad_fixed_t const [72], mad_fixed_t [4][36], unsigned int);
+# endif
+
 /*
  * NAME:	III_imdct_s()
  * DESCRIPTION:	perform IMDCT and windowing for short blocks
@@ -2224,6 +2306,9 @@ enum mad_error III_decode(struct mad_bitptr *ptr, struct mad_frame *frame,
       mad_fixed_t (*sample)[32] = &frame->sbsample[ch][18 * gr];
       unsigned int sb, l, i, sblimit;
       mad_fixed_t output[36];
+# if defined(ASO_SSE)
+      mad_fixed_t output4[4][36];
+# endif
 
       if (channel->block_type == 2) {
 	III_reorder(xr[ch], channel, sfbwidth[ch]);
@@ -2280,7 +2365,22 @@ enum mad_error III_decode(struct mad_bitptr *ptr, struct mad_frame *frame,
 
       if (channel->block_type != 2) {
 	/* long blocks */
-	for (sb = 2; sb < sblimit; ++sb, l += 18) {
+	sb = 2;
+# if defined(ASO_SSE)
+	for (; sb + 4 <= sblimit; sb += 4, l += 72) {
+	  if (III_imdct_l4(&xr[ch][l], output4, channel->block_type) == -1)
+	    break;
+
+	  for (i = 0; i < 4; ++i) {
+	    III_overlap(output4[i], (*frame->overlap)[ch][sb + i],
+			sample, sb + i);
+
+	    if ((sb + i) & 1)
+	      III_freqinver(sample, sb + i);
+	  }
+	}
+# endif
+	for (; sb < sblimit; ++sb, l += 18) {
 	  III_imdct_l(&xr[ch][l], output, channel->block_type);
 	  III_overlap(output, (*frame->overlap)[ch][sb], sample, sb);
 
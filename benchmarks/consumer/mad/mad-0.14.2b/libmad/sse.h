@@ -0,0 +1,93 @@
+/*
+ * libmad - MPEG audio decoder library
+ * Copyright (C) 2000-2001 Robert Leslie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+# ifndef LIBMAD_SSE_H
+# define LIBMAD_SSE_H
+
+# include "fixed.h"
+
+/*
+ * The SSE2/AVX2 kernels evaluate the same flow graphs as the C routines,
+ * with each vector lane carrying an independent transform (one subband
+ * sample or one subband). Only FPM_64BIT and FPM_FLOAT are supported.
+ *
+ * With FPM_64BIT, lanes are 64 bits wide and only their low 32 bits are
+ * significant. VPMULDQ forms the full product of the low halves, so each
+ * lane reproduces mad_f_mul() bit for bit; sums wrap exactly as in C.
+ * This needs AVX2, which is checked at run time.
+ *
+ * With FPM_FLOAT, lanes are single-precision values in fixed-point units,
+ * and the coefficients are converted to floating point at compile time.
+ * SSE2 is always present on x86-64.
+ */
+
+# if defined(__GNUC__) && defined(__x86_64__) && !defined(OPT_SSO)
+#  if defined(FPM_64BIT)
+#   define SSE_FIXED
+#  elif defined(FPM_FLOAT)
+#   define SSE_FLOAT
+#  endif
+# endif
+
+# if defined(SSE_FIXED) || defined(SSE_FLOAT)
+#  include <immintrin.h>
+
+#  define SSE_AVX2		__attribute__ ((target ("avx2")))
+
+#  if defined(SSE_FIXED)
+typedef long long sse_vec __attribute__ ((vector_size (32)));
+typedef mad_fixed_t sse_coef;
+
+#   define SSE_TARGET		SSE_AVX2
+#   define SSE_COEF(x)		((sse_coef) (x))
+
+#   if defined(OPT_ACCURACY)
+#    define sse_mul(x, y, bits)  \
+    ((sse_vec) _mm256_srli_epi64(  \
+       _mm256_add_epi64(_mm256_mul_epi32((__m256i) (x),  \
+					 _mm256_set1_epi64x(y)),  \
+			_mm256_set1_epi64x(1L << ((bits) - 1))), (bits)))
+#   else
+#    define sse_mul(x, y, bits)  \
+    ((sse_vec) _mm256_srli_epi64(  \
+       _mm256_mul_epi32((__m256i) (x), _mm256_set1_epi64x(y)), (bits)))
+#   endif
+
+#   define sse_load(x0, x1, x2, x3)	((sse_vec) { (x0), (x1), (x2), (x3) })
+#   define sse_lane(v, i)		((mad_fixed_t) (v)[i])
+#  else
+typedef float sse_vec __attribute__ ((vector_size (16)));
+typedef float sse_coef;
+
+#   define SSE_TARGET		/* SSE2 */
+#   define SSE_COEF(x)		((sse_coef) mad_f_todouble(x))
+
+#   define sse_mul(x, y, bits)	((x) * (y))
+
+#   define sse_load(x0, x1, x2, x3)  \
+    ((sse_vec) _mm_cvtepi32_ps(_mm_setr_epi32((x0), (x1), (x2), (x3))))
+#   define sse_lane(v, i)		((mad_fixed_t) __builtin_lrintf((v)[i]))
+#  endif
+
+#  define SSE_LANES		4
+
+#  define SSE_MUL(x, y)		sse_mul((x), SSE_COEF(y), MAD_F_FRACBITS)
+# endif
+
+# endif
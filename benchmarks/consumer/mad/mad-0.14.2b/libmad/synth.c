@@ -825,6 +825,11 @@ void synth_half(struct mad_synth *synth, struct mad_frame const *frame,
   }
 }
 
+# if defined(ASO_SSE)
+int synth_full_sse(struct mad_synth *, struct mad_frame const *,
+		   unsigned int, unsigned int);
+# endif
+
 /*
  * NAME:	synth->frame()
  * DESCRIPTION:	perform PCM synthesis of frame subband samples
@@ -851,7 +856,11 @@ void mad_synth_frame(struct mad_synth *synth, struct mad_frame const *frame)
     synth_frame = synth_half;
   }
 
-  synth_frame(synth, frame, nch, ns);
+# if defined(ASO_SSE)
+  if (synth_frame != synth_full ||
+      synth_full_sse(synth, frame, nch, ns) == -1)
+# endif
+    synth_frame(synth, frame, nch, ns);
 
   synth->phase = (synth->phase + ns) % 16;
 }
@@ -0,0 +1,775 @@
+/*
+ * libmad - MPEG audio decoder library
+ * Copyright (C) 2000-2001 Robert Leslie
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+# ifdef HAVE_CONFIG_H
+#  include "config.h"
+# endif
+
+# include "global.h"
+
+# include "fixed.h"
+# include "frame.h"
+# include "synth.h"
+# include "sse.h"
+
+int synth_full_sse(struct mad_synth *, struct mad_frame const *,
+		   unsigned int, unsigned int);
+
+# if defined(SSE_FIXED) || defined(SSE_FLOAT)
+
+# define MUL(x, y)  SSE_MUL((x), (y))
+
+/* costab[i] = cos(PI / (2 * 32) * i) */
+
+# define costab1	MAD_F(0x0ffb10f2)  /* 0.998795456 */
+# define costab2	MAD_F(0x0fec46d2)  /* 0.995184727 */
+# define costab3	MAD_F(0x0fd3aac0)  /* 0.989176510 */
+# define costab4	MAD_F(0x0fb14be8)  /* 0.980785280 */
+# define costab5	MAD_F(0x0f853f7e)  /* 0.970031253 */
+# define costab6	MAD_F(0x0f4fa0ab)  /* 0.956940336 */
+# define costab7	MAD_F(0x0f109082)  /* 0.941544065 */
+# define costab8	MAD_F(0x0ec835e8)  /* 0.923879533 */
+# define costab9	MAD_F(0x0e76bd7a)  /* 0.903989293 */
+# define costab10	MAD_F(0x0e1c5979)  /* 0.881921264 */
+# define costab11	MAD_F(0x0db941a3)  /* 0.857728610 */
+# define costab12	MAD_F(0x0d4db315)  /* 0.831469612 */
+# define costab13	MAD_F(0x0cd9f024)  /* 0.803207531 */
+# define costab14	MAD_F(0x0c5e4036)  /* 0.773010453 */
+# define costab15	MAD_F(0x0bdaef91)  /* 0.740951125 */
+# define costab16	MAD_F(0x0b504f33)  /* 0.707106781 */
+# define costab17	MAD_F(0x0abeb49a)  /* 0.671558955 */
+# define costab18	MAD_F(0x0a267993)  /* 0.634393284 */
+# define costab19	MAD_F(0x0987fbfe)  /* 0.595699304 */
+# define costab20	MAD_F(0x08e39d9d)  /* 0.555570233 */
+# define costab21	MAD_F(0x0839c3cd)  /* 0.514102744 */
+# define costab22	MAD_F(0x078ad74e)  /* 0.471396737 */
+# define costab23	MAD_F(0x06d74402)  /* 0.427555093 */
+# define costab24	MAD_F(0x061f78aa)  /* 0.382683432 */
+# define costab25	MAD_F(0x0563e69d)  /* 0.336889853 */
+# define costab26	MAD_F(0x04a5018c)  /* 0.290284677 */
+# define costab27	MAD_F(0x03e33f2f)  /* 0.242980180 */
+# define costab28	MAD_F(0x031f1708)  /* 0.195090322 */
+# define costab29	MAD_F(0x0259020e)  /* 0.146730474 */
+# define costab30	MAD_F(0x01917a6c)  /* 0.098017140 */
+# define costab31	MAD_F(0x00c8fb30)  /* 0.049067674 */
+
+/*
+ * NAME:	dct32()
+ * DESCRIPTION:	perform fast in[32]->out[32] DCT on each vector lane
+ */
+static SSE_TARGET
+void dct32(sse_vec const in[32], sse_vec out[32])
+{
+  sse_vec t0,   t1,   t2,   t3,   t4,   t5,   t6,   t7;
+  sse_vec t8,   t9,   t10,  t11,  t12,  t13,  t14,  t15;
+  sse_vec t16,  t17,  t18,  t19,  t20,  t21,  t22,  t23;
+  sse_vec t24,  t25,  t26,  t27,  t28,  t29,  t30,  t31;
+  sse_vec t32,  t33,  t34,  t35,  t36,  t37,  t38,  t39;
+  sse_vec t40,  t41,  t42,  t43,  t44,  t45,  t46,  t47;
+  sse_vec t48,  t49,  t50,  t51,  t52,  t53,  t54,  t55;
+  sse_vec t56,  t57,  t58,  t59,  t60,  t61,  t62,  t63;
+  sse_vec t64,  t65,  t66,  t67,  t68,  t69,  t70,  t71;
+  sse_vec t72,  t73,  t74,  t75,  t76,  t77,  t78,  t79;
+  sse_vec t80,  t81,  t82,  t83,  t84,  t85,  t86,  t87;
+  sse_vec t88,  t89,  t90,  t91,  t92,  t93,  t94,  t95;
+  sse_vec t96,  t97,  t98,  t99,  t100, t101, t102, t103;
+  sse_vec t104, t105, t106, t107, t108, t109, t110, t111;
+  sse_vec t112, t113, t114, t115, t116, t117, t118, t119;
+  sse_vec t120, t121, t122, t123, t124, t125, t126, t127;
+  sse_vec t128, t129, t130, t131, t132, t133, t134, t135;
+  sse_vec t136, t137, t138, t139, t140, t141, t142, t143;
+  sse_vec t144, t145, t146, t147, t148, t149, t150, t151;
+  sse_vec t152, t153, t154, t155, t156, t157, t158, t159;
+  sse_vec t160, t161, t162, t163, t164, t165, t166, t167;
+  sse_vec t168, t169, t170, t171, t172, t173, t174, t175;
+  sse_vec t176;
+
+  t0   = in[0]  + in[31];  t16  = MUL(in[0]  - in[31], costab1);
+  t1   = in[15] + in[16];  t17  = MUL(in[15] - in[16], costab31);
+
+  t41  = t16 + t17;
+  t59  = MUL(t16 - t17, costab2);
+  t33  = t0  + t1;
+  t50  = MUL(t0  - t1,  costab2);
+
+  t2   = in[7]  + in[24];  t18  = MUL(in[7]  - in[24], costab15);
+  t3   = in[8]  + in[23];  t19  = MUL(in[8]  - in[23], costab17);
+
+  t42  = t18 + t19;
+  t60  = MUL(t18 - t19, costab30);
+  t34  = t2  + t3;
+  t51  = MUL(t2  - t3,  costab30);
+
+  t4   = in[3]  + in[28];  t20  = MUL(in[3]  - in[28], costab7);
+  t5   = in[12] + in[19];  t21  = MUL(in[12] - in[19], costab25);
+
+  t43  = t20 + t21;
+  t61  = MUL(t20 - t21, costab14);
+  t35  = t4  + t5;
+  t52  = MUL(t4  - t5,  costab14);
+
+  t6   = in[4]  + in[27];  t22  = MUL(in[4]  - in[27], costab9);
+  t7   = in[11] + in[20];  t23  = MUL(in[11] - in[20], costab23);
+
+  t44  = t22 + t23;
+  t62  = MUL(t22 - t23, costab18);
+  t36  = t6  + t7;
+  t53  = MUL(t6  - t7,  costab18);
+
+  t8   = in[1]  + in[30];  t24  = MUL(in[1]  - in[30], costab3);
+  t9   = in[14] + in[17];  t25  = MUL(in[14] - in[17], costab29);
+
+  t45  = t24 + t25;
+  t63  = MUL(t24 - t25, costab6);
+  t37  = t8  + t9;
+  t54  = MUL(t8  - t9,  costab6);
+
+  t10  = in[6]  + in[25];  t26  = MUL(in[6]  - in[25], costab13);
+  t11  = in[9]  + in[22];  t27  = MUL(in[9]  - in[22], costab19);
+
+  t46  = t26 + t27;
+  t64  = MUL(t26 - t27, costab26);
+  t38  = t10 + t11;
+  t55  = MUL(t10 - t11, costab26);
+
+  t12  = in[2]  + in[29];  t28  = MUL(in[2]  - in[29], costab5);
+  t13  = in[13] + in[18];  t29  = MUL(in[13] - in[18], costab27);
+
+  t47  = t28 + t29;
+  t65  = MUL(t28 - t29, costab10);
+  t39  = t12 + t13;
+  t56  = MUL(t12 - t13, costab10);
+
+  t14  = in[5]  + in[26];  t30  = MUL(in[5]  - in[26], costab11);
+  t15  = in[10] + in[21];  t31  = MUL(in[10] - in[21], costab21);
+
+  t48  = t30 + t31;
+  t66  = MUL(t30 - t31, costab22);
+  t40  = t14 + t15;
+  t57  = MUL(t14 - t15, costab22);
+
+  t69  = t33 + t34;  t89  = MUL(t33 - t34, costab4);
+  t70  = t35 + t36;  t90  = MUL(t35 - t36, costab28);
+  t71  = t37 + t38;  t91  = MUL(t37 - t38, costab12);
+  t72  = t39 + t40;  t92  = MUL(t39 - t40, costab20);
+  t73  = t41 + t42;  t94  = MUL(t41 - t42, costab4);
+  t74  = t43 + t44;  t95  = MUL(t43 - t44, costab28);
+  t75  = t45 + t46;  t96  = MUL(t45 - t46, costab12);
+  t76  = t47 + t48;  t97  = MUL(t47 - t48, costab20);
+
+  t78  = t50 + t51;  t100 = MUL(t50 - t51, costab4);
+  t79  = t52 + t53;  t101 = MUL(t52 - t53, costab28);
+  t80  = t54 + t55;  t102 = MUL(t54 - t55, costab12);
+  t81  = t56 + t57;  t103 = MUL(t56 - t57, costab20);
+
+  t83  = t59 + t60;  t106 = MUL(t59 - t60, costab4);
+  t84  = t61 + t62;  t107 = MUL(t61 - t62, costab28);
+  t85  = t63 + t64;  t108 = MUL(t63 - t64, costab12);
+  t86  = t65 + t66;  t109 = MUL(t65 - t66, costab20);
+
+  t113 = t69  + t70;
+  t114 = t71  + t72;
+
+  out[ 0] = t113 + t114;
+  out[16] = MUL(t113 - t114, costab16);
+
+  t115 = t73  + t74;
+  t116 = t75  + t76;
+
+  t32  = t115 + t116;
+
+  out[ 1] = t32;
+
+  t118 = t78  + t79;
+  t119 = t80  + t81;
+
+  t58  = t118 + t119;
+
+  out[ 2] = t58;
+
+  t121 = t83  + t84;
+  t122 = t85  + t86;
+
+  t67  = t121 + t122;
+
+  t49  = (t67 * 2) - t32;
+
+  out[ 3] = t49;
+
+  t125 = t89  + t90;
+  t126 = t91  + t92;
+
+  t93  = t125 + t126;
+
+  out[ 4] = t93;
+
+  t128 = t94  + t95;
+  t129 = t96  + t97;
+
+  t98  = t128 + t129;
+
+  t68  = (t98 * 2) - t49;
+
+  out[ 5] = t68;
+
+  t132 = t100 + t101;
+  t133 = t102 + t103;
+
+  t104 = t132 + t133;
+
+  t82  = (t104 * 2) - t58;
+
+  out[ 6] = t82;
+
+  t136 = t106 + t107;
+  t137 = t108 + t109;
+
+  t110 = t136 + t137;
+
+  t87  = (t110 * 2) - t67;
+
+  t77  = (t87 * 2) - t68;
+
+  out[ 7] = t77;
+
+  t141 = MUL(t69 - t70, costab8);
+  t142 = MUL(t71 - t72, costab24);
+  t143 = t141 + t142;
+
+  out[ 8] = t143;
+  out[24] = (MUL(t141 - t142, costab16) * 2) - t143;
+
+  t144 = MUL(t73 - t74, costab8);
+  t145 = MUL(t75 - t76, costab24);
+  t146 = t144 + t145;
+
+  t88  = (t146 * 2) - t77;
+
+  out[ 9] = t88;
+
+  t148 = MUL(t78 - t79, costab8);
+  t149 = MUL(t80 - t81, costab24);
+  t150 = t148 + t149;
+
+  t105 = (t150 * 2) - t82;
+
+  out[10] = t105;
+
+  t152 = MUL(t83 - t84, costab8);
+  t153 = MUL(t85 - t86, costab24);
+  t154 = t152 + t153;
+
+  t111 = (t154 * 2) - t87;
+
+  t99  = (t111 * 2) - t88;
+
+  out[11] = t99;
+
+  t157 = MUL(t89 - t90, costab8);
+  t158 = MUL(t91 - t92, costab24);
+  t159 = t157 + t158;
+
+  t127 = (t159 * 2) - t93;
+
+  out[12] = t127;
+
+  t160 = (MUL(t125 - t126, costab16) * 2) - t127;
+
+  out[20] = t160;
+  out[28] = (((MUL(t157 - t158, costab16) * 2) - t159) * 2) - t160;
+
+  t161 = MUL(t94 - t95, costab8);
+  t162 = MUL(t96 - t97, costab24);
+  t163 = t161 + t162;
+
+  t130 = (t163 * 2) - t98;
+
+  t112 = (t130 * 2) - t99;
+
+  out[13] = t112;
+
+  t164 = (MUL(t128 - t129, costab16) * 2) - t130;
+
+  t166 = MUL(t100 - t101, costab8);
+  t167 = MUL(t102 - t103, costab24);
+  t168 = t166 + t167;
+
+  t134 = (t168 * 2) - t104;
+
+  t120 = (t134 * 2) - t105;
+
+  out[14] = t120;
+
+  t135 = (MUL(t118 - t119, costab16) * 2) - t120;
+
+  out[18] = t135;
+
+  t169 = (MUL(t132 - t133, costab16) * 2) - t134;
+
+  t151 = (t169 * 2) - t135;
+
+  out[22] = t151;
+
+  t170 = (((MUL(t148 - t149, costab16) * 2) - t150) * 2) - t151;
+
+  out[26] = t170;
+  out[30] = (((((MUL(t166 - t167, costab16) * 2) -
+		t168) * 2) - t169) * 2) - t170;
+
+  t171 = MUL(t106 - t107, costab8);
+  t172 = MUL(t108 - t109, costab24);
+  t173 = t171 + t172;
+
+  t138 = (t173 * 2) - t110;
+
+  t123 = (t138 * 2) - t111;
+
+  t139 = (MUL(t121 - t122, costab16) * 2) - t123;
+
+  t117 = (t123 * 2) - t112;
+
+  out[15] = t117;
+
+  t124 = (MUL(t115 - t116, costab16) * 2) - t117;
+
+  out[17] = t124;
+
+  t131 = (t139 * 2) - t124;
+
+  out[19] = t131;
+
+  t140 = (t164 * 2) - t131;
+
+  out[21] = t140;
+
+  t174 = (MUL(t136 - t137, costab16) * 2) - t138;
+
+  t155 = (t174 * 2) - t139;
+
+  t147 = (t155 * 2) - t140;
+
+  out[23] = t147;
+
+  t156 = (((MUL(t144 - t145, costab16) * 2) - t146) * 2) - t147;
+
+  out[25] = t156;
+
+  t175 = (((MUL(t152 - t153, costab16) * 2) - t154) * 2) - t155;
+
+  t165 = (t175 * 2) - t156;
+
+  out[27] = t165;
+
+  t176 = (((((MUL(t161 - t162, costab16) * 2) -
+	     t163) * 2) - t164) * 2) - t165;
+
+  out[29] = t176;
+  out[31] = (((((((MUL(t171 - t172, costab16) * 2) -
+		  t173) * 2) - t174) * 2) - t175) * 2) - t176;
+}
+
+# undef MUL
+
+/*
+ * The window coefficients are those of synth.c; the vector routines below
+ * read the eight taps for a given phase from every other coefficient.
+ */
+
+# if defined(SSE_FIXED)
+#  define SCALEBITS		(MAD_F_FRACBITS - 12)
+#  define PRESHIFT(x)		(MAD_F(x) >> 12)
+# else
+#  define PRESHIFT(x)		SSE_COEF(MAD_F(x))
+# endif
+
+static
+sse_coef const D[17][32] = {
+# include "D.dat"
+};
+
+# if defined(SSE_FIXED)
+/*
+ * NAME:	dot_fwd()
+ * DESCRIPTION:	return f[0] * d[0] + f[1] * d[14] + ... + f[7] * d[2]
+ */
+static inline SSE_AVX2
+__m256i dot_fwd(__m256i f, mad_fixed_t const *d)
+{
+  __m256i x0, x1;
+
+  x0 = _mm256_permutevar8x32_epi32(f, _mm256_setr_epi32(0, 0, 7, 7,
+							6, 6, 5, 5));
+  x1 = _mm256_permutevar8x32_epi32(f, _mm256_setr_epi32(4, 4, 3, 3,
+							2, 2, 1, 1));
+
+  x0 = _mm256_mul_epi32(x0, _mm256_loadu_si256((__m256i const *) d));
+  x1 = _mm256_mul_epi32(x1, _mm256_loadu_si256((__m256i const *) (d + 8)));
+
+# if defined(OPT_ACCURACY)
+  x0 = _mm256_add_epi64(x0, _mm256_set1_epi64x(1L << (SCALEBITS - 1)));
+  x1 = _mm256_add_epi64(x1, _mm256_set1_epi64x(1L << (SCALEBITS - 1)));
+# endif
+
+  return _mm256_add_epi64(_mm256_srli_epi64(x0, SCALEBITS),
+			  _mm256_srli_epi64(x1, SCALEBITS));
+}
+
+/*
+ * NAME:	dot_rev()
+ * DESCRIPTION:	return f[0] * d[0] + f[1] * d[2] + ... + f[7] * d[14]
+ */
+static inline SSE_AVX2
+__m256i dot_rev(__m256i f, mad_fixed_t const *d)
+{
+  __m256i x0, x1;
+
+  x0 = _mm256_permutevar8x32_epi32(f, _mm256_setr_epi32(0, 0, 1, 1,
+							2, 2, 3, 3));
+  x1 = _mm256_permutevar8x32_epi32(f, _mm256_setr_epi32(4, 4, 5, 5,
+							6, 6, 7, 7));
+
+  x0 = _mm256_mul_epi32(x0, _mm256_loadu_si256((__m256i const *) d));
+  x1 = _mm256_mul_epi32(x1, _mm256_loadu_si256((__m256i const *) (d + 8)));
+
+# if defined(OPT_ACCURACY)
+  x0 = _mm256_add_epi64(x0, _mm256_set1_epi64x(1L << (SCALEBITS - 1)));
+  x1 = _mm256_add_epi64(x1, _mm256_set1_epi64x(1L << (SCALEBITS - 1)));
+# endif
+
+  return _mm256_add_epi64(_mm256_srli_epi64(x0, SCALEBITS),
+			  _mm256_srli_epi64(x1, SCALEBITS));
+}
+
+/*
+ * NAME:	sum()
+ * DESCRIPTION:	add the (low 32 bits of the) four lanes
+ */
+static inline SSE_AVX2
+mad_fixed_t sum(__m256i x)
+{
+  __m128i y;
+
+  y = _mm_add_epi64(_mm256_castsi256_si128(x),
+		    _mm256_extracti128_si256(x, 1));
+  y = _mm_add_epi64(y, _mm_unpackhi_epi64(y, y));
+
+  return _mm_cvtsi128_si32(y);
+}
+
+# define LOAD(f)  _mm256_loadu_si256((__m256i const *) (f))
+
+/*
+ * NAME:	window_avx2()
+ * DESCRIPTION:	calculate 32 PCM samples from the polyphase filterbank
+ */
+static SSE_AVX2
+void window_avx2(mad_fixed_t (*filter)[2][2][16][8], unsigned int phase,
+		 mad_fixed_t pcm[32])
+{
+  mad_fixed_t (*fe)[8], (*fx)[8], (*fo)[8];
+  unsigned int sb, pe, po;
+  __m256i e, o;
+
+  pe = phase & ~1;
+  po = ((phase - 1) & 0xf) | 1;
+
+  fe = &(*filter)[0][ phase & 1][0];
+  fx = &(*filter)[0][~phase & 1][0];
+  fo = &(*filter)[1][~phase & 1][0];
+
+  pcm[0] = sum(_mm256_sub_epi64(dot_fwd(LOAD(fe[0]), &D[0][pe]),
+				dot_fwd(LOAD(fx[0]), &D[0][po])));
+
+  for (sb = 1; sb < 16; ++sb) {
+    e = LOAD(fe[sb]);
+    o = LOAD(fo[sb - 1]);
+
+    pcm[sb]      = sum(_mm256_sub_epi64(dot_fwd(e, &D[sb][pe]),
+					dot_fwd(o, &D[sb][po])));
+    pcm[32 - sb] = sum(_mm256_add_epi64(dot_rev(e, &D[sb][15 - pe]),
+					dot_rev(o, &D[sb][15 - po])));
+  }
+
+  pcm[16] = -sum(dot_fwd(LOAD(fo[15]), &D[16][po]));
+}
+
+# undef LOAD
+# endif
+
+# if defined(SSE_FLOAT)
+/*
+ * NAME:	evens()
+ * DESCRIPTION:	return d[0], d[2], d[4], d[6]
+ */
+static inline
+__m128 evens(float const *d)
+{
+  return _mm_shuffle_ps(_mm_loadu_ps(d), _mm_loadu_ps(d + 4),
+			_MM_SHUFFLE(2, 0, 2, 0));
+}
+
+/*
+ * NAME:	fwd4()
+ * DESCRIPTION:	return f[0] * d[0] + f[1] * d[14] + ... + f[7] * d[2]
+ *		(partial sums), where x0 = f[0..3] and x1 = f[4..7]
+ */
+static inline
+__m128 fwd4(__m128 x0, __m128 x1, float const *d)
+{
+  __m128 q0, q1;
+
+  /* f[0], f[7], f[6], f[5] and f[4], f[3], f[2], f[1] */
+
+  q0 = _mm_shuffle_ps(_mm_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 3, 0, 0)),
+		      x1, _MM_SHUFFLE(1, 2, 2, 0));
+  q1 = _mm_shuffle_ps(_mm_shuffle_ps(x1, x0, _MM_SHUFFLE(3, 3, 0, 0)),
+		      x0, _MM_SHUFFLE(1, 2, 2, 0));
+
+  return _mm_add_ps(_mm_mul_ps(q0, evens(d)), _mm_mul_ps(q1, evens(d + 8)));
+}
+
+/*
+ * NAME:	rev4()
+ * DESCRIPTION:	return f[0] * d[0] + f[1] * d[2] + ... + f[7] * d[14]
+ *		(partial sums), where x0 = f[0..3] and x1 = f[4..7]
+ */
+static inline
+__m128 rev4(__m128 x0, __m128 x1, float const *d)
+{
+  return _mm_add_ps(_mm_mul_ps(x0, evens(d)), _mm_mul_ps(x1, evens(d + 8)));
+}
+
+/*
+ * NAME:	sum()
+ * DESCRIPTION:	add the four lanes and round to fixed-point
+ */
+static inline
+mad_fixed_t sum(__m128 x)
+{
+  x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+  x = _mm_add_ss(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 1, 1, 1)));
+
+  return _mm_cvtss_si32(x);
+}
+
+# define LOAD(f)  _mm_cvtepi32_ps(_mm_loadu_si128((__m128i const *) (f)))
+
+/*
+ * NAME:	window_sse2()
+ * DESCRIPTION:	calculate 32 PCM samples from the polyphase filterbank
+ */
+static
+void window_sse2(mad_fixed_t (*filter)[2][2][16][8], unsigned int phase,
+		 mad_fixed_t pcm[32])
+{
+  mad_fixed_t (*fe)[8], (*fx)[8], (*fo)[8];
+  unsigned int sb, pe, po;
+  __m128 e0, e1, o0, o1;
+
+  pe = phase & ~1;
+  po = ((phase - 1) & 0xf) | 1;
+
+  fe = &(*filter)[0][ phase & 1][0];
+  fx = &(*filter)[0][~phase & 1][0];
+  fo = &(*filter)[1][~phase & 1][0];
+
+  e0 = LOAD(&fe[0][0]);
+  e1 = LOAD(&fe[0][4]);
+  o0 = LOAD(&fx[0][0]);
+  o1 = LOAD(&fx[0][4]);
+
+  pcm[0] = sum(_mm_sub_ps(fwd4(e0, e1, &D[0][pe]), fwd4(o0, o1, &D[0][po])));
+
+  for (sb = 1; sb < 16; ++sb) {
+    e0 = LOAD(&fe[sb][0]);
+    e1 = LOAD(&fe[sb][4]);
+    o0 = LOAD(&fo[sb - 1][0]);
+    o1 = LOAD(&fo[sb - 1][4]);
+
+    pcm[sb]      = sum(_mm_sub_ps(fwd4(e0, e1, &D[sb][pe]),
+				  fwd4(o0, o1, &D[sb][po])));
+    pcm[32 - sb] = sum(_mm_add_ps(rev4(e0, e1, &D[sb][15 - pe]),
+				  rev4(o0, o1, &D[sb][15 - po])));
+  }
+
+  o0 = LOAD(&fo[15][0]);
+  o1 = LOAD(&fo[15][4]);
+
+  pcm[16] = -sum(fwd4(o0, o1, &D[16][po]));
+}
+
+# undef LOAD
+
+/*
+ * NAME:	dot8()
+ * DESCRIPTION:	multiply the lanes of f by d[0], d[2], ..., d[14] in the
+ *		lane order given by index
+ */
+static inline SSE_AVX2
+__m256 dot8(__m256 f, __m256i index, float const *d)
+{
+  __m256 x;
+
+  /* d[0], d[2], d[8], d[10], d[4], d[6], d[12], d[14] */
+
+  x = _mm256_shuffle_ps(_mm256_loadu_ps(d), _mm256_loadu_ps(d + 8),
+			_MM_SHUFFLE(2, 0, 2, 0));
+
+  return _mm256_mul_ps(_mm256_permutevar8x32_ps(f, index), x);
+}
+
+/*
+ * NAME:	sum8()
+ * DESCRIPTION:	add the eight lanes and round to fixed-point
+ */
+static inline SSE_AVX2
+mad_fixed_t sum8(__m256 x)
+{
+  __m128 y;
+
+  y = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+  y = _mm_add_ps(y, _mm_movehl_ps(y, y));
+  y = _mm_add_ss(y, _mm_shuffle_ps(y, y, _MM_SHUFFLE(1, 1, 1, 1)));
+
+  return _mm_cvtss_si32(y);
+}
+
+# define LOAD(f)  \
+  _mm256_cvtepi32_ps(_mm256_loadu_si256((__m256i const *) (f)))
+
+/*
+ * NAME:	window_avx2()
+ * DESCRIPTION:	calculate 32 PCM samples from the polyphase filterbank
+ */
+static SSE_AVX2
+void window_avx2(mad_fixed_t (*filter)[2][2][16][8], unsigned int phase,
+		 mad_fixed_t pcm[32])
+{
+  mad_fixed_t (*fe)[8], (*fx)[8], (*fo)[8];
+  unsigned int sb, pe, po;
+  __m256i fwd, rev;
+  __m256 e, o;
+
+  pe = phase & ~1;
+  po = ((phase - 1) & 0xf) | 1;
+
+  fe = &(*filter)[0][ phase & 1][0];
+  fx = &(*filter)[0][~phase & 1][0];
+  fo = &(*filter)[1][~phase & 1][0];
+
+  fwd = _mm256_setr_epi32(0, 7, 4, 3, 6, 5, 2, 1);
+  rev = _mm256_setr_epi32(0, 1, 4, 5, 2, 3, 6, 7);
+
+  pcm[0] = sum8(_mm256_sub_ps(dot8(LOAD(fe[0]), fwd, &D[0][pe]),
+			      dot8(LOAD(fx[0]), fwd, &D[0][po])));
+
+  for (sb = 1; sb < 16; ++sb) {
+    e = LOAD(fe[sb]);
+    o = LOAD(fo[sb - 1]);
+
+    pcm[sb]      = sum8(_mm256_sub_ps(dot8(e, fwd, &D[sb][pe]),
+				      dot8(o, fwd, &D[sb][po])));
+    pcm[32 - sb] = sum8(_mm256_add_ps(dot8(e, rev, &D[sb][15 - pe]),
+				      dot8(o, rev, &D[sb][15 - po])));
+  }
+
+  pcm[16] = -sum8(dot8(LOAD(fo[15]), fwd, &D[16][po]));
+}
+
+# undef LOAD
+# endif
+
+/*
+ * NAME:	synth->full()
+ * DESCRIPTION:	perform full frequency PCM synthesis
+ */
+static SSE_TARGET
+void synth_full(struct mad_synth *synth, struct mad_frame const *frame,
+		unsigned int nch, unsigned int ns,
+		void (*window)(mad_fixed_t (*)[2][2][16][8], unsigned int,
+			       mad_fixed_t [32]))
+{
+  static mad_fixed_t const zero[32];
+  unsigned int phase, ch, s, i, j, n, slot;
+  mad_fixed_t *pcm, (*filter)[2][2][16][8], (*lo)[8], (*hi)[8];
+  mad_fixed_t const *row[SSE_LANES];
+  sse_vec in[32], out[32];
+
+  for (ch = 0; ch < nch; ++ch) {
+    filter = &synth->filter[ch];
+    phase  = synth->phase;
+    pcm    = synth->pcm.samples[ch];
+
+    for (s = 0; s < ns; s += n) {
+      n = ns - s < SSE_LANES ? ns - s : SSE_LANES;
+
+      /* the DCT of SSE_LANES consecutive subband samples at once */
+
+      for (j = 0; j < SSE_LANES; ++j)
+	row[j] = j < n ? frame->sbsample[ch][s + j] : zero;
+
+      for (i = 0; i < 32; ++i)
+	in[i] = sse_load(row[0][i], row[1][i], row[2][i], row[3][i]);
+
+      dct32(in, out);
+
+      for (j = 0; j < n; ++j) {
+	lo   = (*filter)[0][phase & 1];
+	hi   = (*filter)[1][phase & 1];
+	slot = phase >> 1;
+
+	for (i = 0; i < 16; ++i) {
+	  hi[15 - i][slot] = sse_lane(out[i], j);
+	  lo[i][slot]      = sse_lane(out[16 + i], j);
+	}
+
+	window(filter, phase, pcm);
+	pcm += 32;
+
+	phase = (phase + 1) % 16;
+      }
+    }
+  }
+}
+# endif
+
+/*
+ * NAME:	synth->full_sse()
+ * DESCRIPTION:	perform full frequency PCM synthesis with SSE2/AVX2; return
+ *		-1 if the processor or configuration is not supported
+ */
+int synth_full_sse(struct mad_synth *synth, struct mad_frame const *frame,
+		   unsigned int nch, unsigned int ns)
+{
+# if defined(SSE_FIXED)
+  if (!__builtin_cpu_supports("avx2"))
+    return -1;
+
+  synth_full(synth, frame, nch, ns, window_avx2);
+
+  return 0;
+# elif defined(SSE_FLOAT)
+  synth_full(synth, frame, nch, ns, __builtin_cpu_supports("avx2") ?
+	     window_avx2 : window_sse2);
+
+  return 0;
+# else
+  return -1;
+# endif
+}
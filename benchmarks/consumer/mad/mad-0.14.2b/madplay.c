@@ -67,6 +67,7 @@ struct option const options[] = {
   { "fade-in",		optional_argument, 0,		-'i' },
   { "help",		no_argument,	   0,		 'h' },
   { "ignore-crc",	no_argument,	   0,		 'i' },
+  { "index",		no_argument,	   0,		-'I' },
   { "left",		no_argument,	   0,		 '1' },
   { "license",		no_argument,	   0,		-'l' },
   { "mono",		no_argument,	   0,		 'm' },
@@ -78,6 +79,7 @@ struct option const options[] = {
   { "shuffle",		no_argument,	   0,		 'z' },
   { "start",		required_argument, 0,		 's' },
   { "stereo",		no_argument,	   0,		 'S' },
+  { "threads",		required_argument, 0,		-'T' },
   { "time",		required_argument, 0,		 't' },
   { "verbose",		no_argument,	   0,		 'v' },
   { "version",		no_argument,	   0,		 'V' },
@@ -128,6 +130,7 @@ void show_usage(int verbose)
   EPUTS(_("\nDecoding:\n"));
   EPUTS(_("      --downsample           reduce output sample rate 2:1\n"));
   EPUTS(_("  -i, --ignore-crc           ignore CRC errors\n"));
+  EPUTS(_("      --threads=COUNT        decode files with COUNT threads\n"));
 
   EPUTS(_("\nAudio output:\n"));
   EPUTS(_("  -o, --output=[TYPE:]PATH   send output to PATH with format TYPE"
@@ -168,6 +171,8 @@ void show_usage(int verbose)
 	                              " (HH:MM:SS.DDD)\n"));
   EPUTS(_("  -t, --time=DURATION        play only for DURATION"
 	                              " (HH:MM:SS.DDD)\n"));
+  EPUTS(_("      --index                keep a frame index for seeking"
+	                              " in FILE.idx\n"));
   EPUTS(_("  -z, --shuffle              randomize file list\n"));
   EPUTS(_("  -r, --repeat[=MAX]         play files MAX times,"
 	                              " or indefinitely\n"));
@@ -479,6 +484,10 @@ void get_options(int argc, char *argv[], struct player *player)
       player->options |= PLAYER_OPTION_IGNORECRC;
       break;
 
+    case -'I':
+      player->options |= PLAYER_OPTION_INDEX;
+      break;
+
     case -'i':
       player->fade_in = get_time(optarg ? optarg : FADE_DEFAULT, 1,
 				 _("fade-in time"));
@@ -542,6 +551,14 @@ void get_options(int argc, char *argv[], struct player *player)
       player->output.select = PLAYER_CHANNEL_STEREO;
       break;
 
+    case -'T':
+      opt = atoi(optarg);
+      if (opt <= 0)
+	die(_("invalid thread count \"%s\""), optarg);
+
+      player->threads = opt;
+      break;
+
     case 't':
       player->global_stop = get_time(optarg, 1, _("playing time"));
       player->options |= PLAYER_OPTION_TIMED;
@@ -72,7 +72,7 @@ signed int scan(unsigned char const *ptr, unsigned long len,
   bitrate = kbps = count = vbr = 0;
 
   while (1) {
-    if (mad_header_decode(&header, &stream) == -1) {
+    if (mad_header_scan(&header, &stream) == -1) {
       if (MAD_RECOVERABLE(stream.error))
 	continue;
       else
@@ -195,6 +195,14 @@ SOURCE=..\..\libmad\D.dat
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\libmad\hp_table.dat
+# End Source File
+# Begin Source File
+
+SOURCE=..\..\libmad\hq_table.dat
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\libmad\imdct_s.dat
 # End Source File
 # Begin Source File
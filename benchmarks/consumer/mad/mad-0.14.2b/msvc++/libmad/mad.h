@@ -149,15 +149,16 @@ typedef mad_fixed_t mad_sample_t;
 # define mad_f_sub(x, y)	((x) - (y))
 
 # if defined(FPM_FLOAT)
-#  error "FPM_FLOAT not yet supported"
 
-#  undef MAD_F
-#  define MAD_F(x)		mad_f_todouble(x)
-
-#  define mad_f_mul(x, y)	((x) * (y))
-#  define mad_f_scale64
+/*
+ * Samples keep their fixed-point representation, but products are formed
+ * in floating point. This is the format used by the SSE2/AVX2 routines;
+ * the C routines yield nearly the same results as FPM_64BIT.
+ */
+#  define mad_f_mul(x, y)  \
+    ((mad_fixed_t) ((double) (x) * (y) * (1.0 / (1L << MAD_F_SCALEBITS))))
 
-#  undef ASO_ZEROCHECK
+#  define MAD_F_SCALEBITS  MAD_F_FRACBITS
 
 # elif defined(FPM_64BIT)
 
@@ -800,6 +801,7 @@ void mad_header_init(struct mad_header *);
 # define mad_header_finish(header)  /* nothing */
 
 int mad_header_decode(struct mad_header *, struct mad_stream *);
+int mad_header_scan(struct mad_header *, struct mad_stream *);
 
 void mad_frame_init(struct mad_frame *);
 void mad_frame_finish(struct mad_frame *);
@@ -865,7 +867,8 @@ void mad_synth_frame(struct mad_synth *, struct mad_frame const *);
 
 enum mad_decoder_mode {
   MAD_DECODER_MODE_SYNC  = 0,
-  MAD_DECODER_MODE_ASYNC
+  MAD_DECODER_MODE_ASYNC,
+  MAD_DECODER_MODE_PARALLEL
 };
 
 enum mad_flow {
@@ -879,6 +882,7 @@ struct mad_decoder {
   enum mad_decoder_mode mode;
 
   int options;
+  int threads;
 
   struct {
     long pid;
@@ -921,6 +925,8 @@ int mad_decoder_finish(struct mad_decoder *);
 
 # define mad_decoder_options(decoder, opts)  \
     ((void) ((decoder)->options = (opts)))
+# define mad_decoder_threads(decoder, count)  \
+    ((void) ((decoder)->threads = (count)))
 
 int mad_decoder_run(struct mad_decoder *, enum mad_decoder_mode);
 int mad_decoder_message(struct mad_decoder *, void *, unsigned int *);
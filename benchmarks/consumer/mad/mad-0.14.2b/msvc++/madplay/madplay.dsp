@@ -139,6 +139,10 @@ SOURCE=..\..\getopt1.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\index.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\madplay.c
 # End Source File
 # Begin Source File
@@ -195,6 +199,10 @@ SOURCE=..\..\global.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\..\index.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\..\player.h
 # End Source File
 # Begin Source File
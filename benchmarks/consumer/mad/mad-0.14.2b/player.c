@@ -82,6 +82,7 @@
 # include "id3tag.h"
 # include "filter.h"
 # include "equalizer.h"
+# include "index.h"
 
 # define MPEG_BUFSZ	40000	/* 2.5 s at 128 kbps; 1 s at 320 kbps */
 # define FREQ_TOLERANCE	6	/* percent sampling frequency tolerance */
@@ -118,6 +119,7 @@ void player_init(struct player *player)
 
   player->options  = 0;
   player->repeat   = 1;
+  player->threads  = 1;
 
   player->control = PLAYER_CONTROL_DEFAULT;
 
@@ -140,6 +142,10 @@ void player_init(struct player *player)
   player->input.data        = 0;
   player->input.length      = 0;
   player->input.eof         = 0;
+  player->input.offset      = 0;
+  player->input.skip        = 0;
+  player->input.priming     = 0;
+  player->input.trim        = mad_timer_zero;
 
   xing_init(&player->input.xing);
 
@@ -375,7 +381,8 @@ enum mad_flow decode_input_mmap(void *data, struct mad_stream *stream)
 
   /* first call */
 
-  mad_stream_buffer(stream, input->fdm, input->length);
+  mad_stream_buffer(stream, input->fdm + input->offset,
+		    input->length - input->offset);
 
   return MAD_FLOW_CONTINUE;
 }
@@ -433,6 +440,8 @@ enum mad_flow decode_header(void *data, struct mad_header const *header)
 {
   struct player *player = data;
 
+  player->input.priming = 0;
+
   if ((player->options & PLAYER_OPTION_TIMED) &&
       mad_timer_compare(player->stats.global_timer, player->global_stop) > 0)
     return MAD_FLOW_STOP;
@@ -446,9 +455,13 @@ enum mad_flow decode_header(void *data, struct mad_header const *header)
     ++player->stats.global_framecount;
     mad_timer_add(&player->stats.global_timer, header->duration);
 
-    if ((player->options & PLAYER_OPTION_SKIP) &&
-	mad_timer_compare(player->stats.global_timer,
-			  player->global_start) < 0)
+    if (player->input.skip) {
+      --player->input.skip;
+      player->input.priming = 1;
+    }
+    else if ((player->options & PLAYER_OPTION_SKIP) &&
+	     mad_timer_compare(player->stats.global_timer,
+			       player->global_start) < 0)
       return MAD_FLOW_IGNORE;
   }
 
@@ -488,12 +501,21 @@ enum mad_flow decode_filter(void *data, struct mad_stream const *stream,
     ++player->stats.global_framecount;
     mad_timer_add(&player->stats.global_timer, frame->header.duration);
 
-    if ((player->options & PLAYER_OPTION_SKIP) &&
-	mad_timer_compare(player->stats.global_timer,
-			  player->global_start) < 0)
+    if (player->input.skip) {
+      --player->input.skip;
+      player->input.priming = 1;
+    }
+    else if ((player->options & PLAYER_OPTION_SKIP) &&
+	     mad_timer_compare(player->stats.global_timer,
+			       player->global_start) < 0)
       return MAD_FLOW_IGNORE;
   }
 
+  /* frames decoded only to prime the decoder are not filtered */
+
+  if (player->input.priming)
+    return MAD_FLOW_CONTINUE;
+
   return filter_run(player->output.filters, frame);
 }
 
@@ -772,11 +794,27 @@ enum mad_flow decode_output(void *data, struct mad_header const *header,
   struct player *player = data;
   struct output *output = &player->output;
   mad_fixed_t const *ch1, *ch2;
-  unsigned int nchannels;
+  unsigned int nchannels, nsamples, trim = 0;
   union audio_control control;
 
-  ch1 = pcm->samples[0];
-  ch2 = pcm->samples[1];
+  if (player->input.priming)
+    return MAD_FLOW_CONTINUE;
+
+  /* drop samples preceding the start time */
+
+  if (mad_timer_sign(player->input.trim)) {
+    trim = mad_timer_count(player->input.trim,
+			   (enum mad_units) pcm->samplerate);
+    if (trim > pcm->length)
+      trim = pcm->length;
+
+    player->input.trim = mad_timer_zero;
+  }
+
+  ch1 = pcm->samples[0] + trim;
+  ch2 = pcm->samples[1] + trim;
+
+  nsamples = pcm->length - trim;
 
   switch (nchannels = pcm->channels) {
   case 1:
@@ -899,6 +937,8 @@ enum mad_flow decode_output(void *data, struct mad_header const *header,
 	error("output", _("cannot resample %u Hz to %u Hz"),
 	      output->speed_in, output->speed_out);
 
+	resample_finish(&output->resample[0]);
+
 	free(output->resampled);
 	output->resampled = 0;
 
@@ -918,14 +958,14 @@ enum mad_flow decode_output(void *data, struct mad_header const *header,
 
   if (output->resampled) {
     control.play.nsamples = resample_block(&output->resample[0],
-					   pcm->length, ch1,
+					   nsamples, ch1,
 					   (*output->resampled)[0]);
     control.play.samples[0] = (*output->resampled)[0];
 
     if (ch2 == ch1)
       control.play.samples[1] = control.play.samples[0];
     else if (ch2) {
-      resample_block(&output->resample[1], pcm->length, ch2,
+      resample_block(&output->resample[1], nsamples, ch2,
 		     (*output->resampled)[1]);
       control.play.samples[1] = (*output->resampled)[1];
     }
@@ -933,7 +973,7 @@ enum mad_flow decode_output(void *data, struct mad_header const *header,
       control.play.samples[1] = 0;
   }
   else {
-    control.play.nsamples   = pcm->length;
+    control.play.nsamples   = nsamples;
     control.play.samples[0] = ch1;
     control.play.samples[1] = ch2;
   }
@@ -1057,7 +1097,7 @@ enum mad_flow decode_error(void *data, struct mad_stream *stream,
     /* fall through */
 
   default:
-    if (player->verbosity >= -1 &&
+    if (player->verbosity >= -1 && !player->input.priming &&
 	((stream->error == MAD_ERROR_LOSTSYNC && !player->input.eof)
 	 || stream->sync) &&
 	player->stats.global_framecount != player->stats.error_frame) {
@@ -1079,6 +1119,130 @@ enum mad_flow decode_error(void *data, struct mad_stream *stream,
   return MAD_FLOW_CONTINUE;
 }
 
+# if defined(USE_TTY)
+static
+enum mad_flow tty_filter(void *, struct mad_frame *);
+# endif
+
+/*
+ * NAME:	altering_filters()
+ * DESCRIPTION:	return true if any output filter may change frame samples
+ */
+static
+int altering_filters(struct filter const *filter)
+{
+  for (; filter; filter = filter->chain) {
+# if defined(USE_TTY)
+    if (filter->func == tty_filter)
+      continue;
+# endif
+
+    return 1;
+  }
+
+  return 0;
+}
+
+/*
+ * NAME:	seek_index()
+ * DESCRIPTION:	use a frame index to begin decoding just before the start
+ *		time; return 1 if the file ends before the start time
+ */
+static
+int seek_index(struct player *player)
+{
+  struct input *input = &player->input;
+  struct stats *stats = &player->stats;
+  struct index index;
+  mad_timer_t offset;
+  char *sidecar = 0;
+  unsigned long i, start;
+  int seeking, result = 0;
+
+  /* time from the beginning of this file to the start time */
+
+  offset = stats->global_timer;
+  mad_timer_negate(&offset);
+  mad_timer_add(&offset, player->global_start);
+
+  seeking = (player->options & PLAYER_OPTION_SKIP) &&
+    mad_timer_sign(offset) > 0;
+
+  if (!seeking && !(player->options & PLAYER_OPTION_INDEX))
+    return 0;
+
+  index_init(&index);
+
+  if (player->options & PLAYER_OPTION_INDEX) {
+    sidecar = malloc(strlen(input->path) + sizeof(INDEX_SUFFIX));
+    if (sidecar) {
+      strcpy(sidecar, input->path);
+      strcat(sidecar, INDEX_SUFFIX);
+    }
+  }
+
+  if (sidecar == 0 || index_load(&index, sidecar, input->fd) == -1) {
+    if (index_build(&index, input->fd) == -1) {
+      if (player->verbosity >= 0)
+	error("index", _("%s: cannot index file"), input->path);
+      goto done;
+    }
+
+    if (sidecar && index_save(&index, sidecar) == -1 &&
+	player->verbosity >= 0)
+      error("index", ":", sidecar);
+  }
+
+  if (!seeking || index.nframes == index.first)
+    goto done;
+
+  if (mad_timer_compare(offset, index.duration) >= 0) {
+    /* the whole file precedes the start time */
+
+    stats->global_framecount += index.nframes - index.first;
+    mad_timer_add(&stats->global_timer, index.duration);
+
+    result = 1;
+    goto done;
+  }
+
+  i     = index_find(&index, offset);
+  start = index_prime(&index, i);
+
+  if (start > index.first) {
+    struct index_frame const *entry = &index.frames[start];
+
+    input->offset = entry->offset;
+
+    stats->absolute_framecount = start - index.first;
+    stats->absolute_timer      = entry->time;
+
+    stats->global_framecount += start - index.first;
+    mad_timer_add(&stats->global_timer, entry->time);
+  }
+
+  input->skip = i - start;
+
+  input->trim = index.frames[i].time;
+  mad_timer_negate(&input->trim);
+  mad_timer_add(&input->trim, offset);
+
+  stats->total_time = index.duration;
+
+ done:
+  if (lseek(input->fd, input->offset, SEEK_SET) == -1) {
+    error("index", ":lseek");
+    result = -1;
+  }
+
+  index_finish(&index);
+
+  if (sidecar)
+    free(sidecar);
+
+  return result;
+}
+
 /*
  * NAME:	decode()
  * DESCRIPTION:	decode and output audio for an open file
@@ -1088,6 +1252,7 @@ int decode(struct player *player)
 {
   struct stat stat;
   struct mad_decoder decoder;
+  enum mad_decoder_mode mode;
   int options, result;
 
   if (fstat(player->input.fd, &stat) == -1) {
@@ -1100,6 +1265,11 @@ int decode(struct player *player)
 
   xing_init(&player->input.xing);
 
+  player->input.offset  = 0;
+  player->input.skip    = 0;
+  player->input.priming = 0;
+  player->input.trim    = mad_timer_zero;
+
   /* prepare input buffers */
 
 # if defined(HAVE_MMAP)
@@ -1140,6 +1310,18 @@ int decode(struct player *player)
   player->stats.audio.peak_clipping   = 0;
   player->stats.audio.peak_sample     = 0;
 
+  if (S_ISREG(stat.st_mode)) {
+    switch (seek_index(player)) {
+    case -1:
+      result = -1;
+      goto done;
+
+    case 1:
+      result = 0;
+      goto done;
+    }
+  }
+
   mad_decoder_init(&decoder, player,
 # if defined(HAVE_MMAP)
 		   player->input.fdm ? decode_input_mmap :
@@ -1157,10 +1339,24 @@ int decode(struct player *player)
 
   mad_decoder_options(&decoder, options);
 
-  result = mad_decoder_run(&decoder, MAD_DECODER_MODE_SYNC);
+  /*
+   * Parallel decoding reads the whole file before producing output, and
+   * pays off only while the filters leave the decoded samples alone.
+   */
+
+  mode = MAD_DECODER_MODE_SYNC;
+
+  if (player->threads > 1 && S_ISREG(stat.st_mode) &&
+      !altering_filters(player->output.filters)) {
+    mode = MAD_DECODER_MODE_PARALLEL;
+    mad_decoder_threads(&decoder, player->threads);
+  }
+
+  result = mad_decoder_run(&decoder, mode);
 
   mad_decoder_finish(&decoder);
 
+ done:
 # if defined(HAVE_MMAP)
   if (player->input.fdm) {
     if (unmap_file(player->input.fdm, player->input.length) == -1) {
@@ -36,6 +36,7 @@ enum {
   PLAYER_OPTION_SHUFFLE      = 0x0001,
   PLAYER_OPTION_DOWNSAMPLE   = 0x0002,
   PLAYER_OPTION_IGNORECRC    = 0x0004,
+  PLAYER_OPTION_INDEX        = 0x0008,
 
   PLAYER_OPTION_SKIP         = 0x0010,
   PLAYER_OPTION_TIMED        = 0x0020,
@@ -80,6 +81,7 @@ struct player {
 
   int options;
   int repeat;
+  int threads;
 
   enum player_control control;
 
@@ -109,6 +111,11 @@ struct player {
 
     int eof;
 
+    unsigned long offset;		/* file position to begin decoding */
+    unsigned long skip;		/* frames to decode before output */
+    int priming;		/* current frame is not for output */
+    mad_timer_t trim;		/* time to drop from first output */
+
     struct xing xing;
   } input;
 
@@ -25,103 +25,25 @@
 
 # include "global.h"
 
+# include <stdlib.h>
 # include <string.h>
+# include <math.h>
+
+# if defined(__SSE2__)
+#  include <emmintrin.h>
+# endif
 
 # include "resample.h"
 # include "mad.h"
 
-static
-mad_fixed_t const resample_table[9][9] = {
-  /* 48000 */ { MAD_F(0x10000000) /* 1.000000000 */,
-		MAD_F(0x116a3b36) /* 1.088435374 */,
-		MAD_F(0x18000000) /* 1.500000000 */,
-		MAD_F(0x20000000) /* 2.000000000 */,
-		MAD_F(0x22d4766c) /* 2.176870748 */,
-		MAD_F(0x30000000) /* 3.000000000 */,
-		MAD_F(0x40000000) /* 4.000000000 */,
-		MAD_F(0x45a8ecd8) /* 4.353741497 */,
-		MAD_F(0x60000000) /* 6.000000000 */ },
-
-  /* 44100 */ { MAD_F(0x0eb33333) /* 0.918750000 */,
-		MAD_F(0x10000000) /* 1.000000000 */,
-		MAD_F(0x160ccccd) /* 1.378125000 */,
-		MAD_F(0x1d666666) /* 1.837500000 */,
-		MAD_F(0x20000000) /* 2.000000000 */,
-		MAD_F(0x2c19999a) /* 2.756250000 */,
-		MAD_F(0x3acccccd) /* 3.675000000 */,
-		MAD_F(0x40000000) /* 4.000000000 */,
-		MAD_F(0x58333333) /* 5.512500000 */ },
-
-  /* 32000 */ { MAD_F(0x0aaaaaab) /* 0.666666667 */,
-		MAD_F(0x0b9c2779) /* 0.725623583 */,
-		MAD_F(0x10000000) /* 1.000000000 */,
-		MAD_F(0x15555555) /* 1.333333333 */,
-		MAD_F(0x17384ef3) /* 1.451247166 */,
-		MAD_F(0x20000000) /* 2.000000000 */,
-		MAD_F(0x2aaaaaab) /* 2.666666667 */,
-		MAD_F(0x2e709de5) /* 2.902494331 */,
-		MAD_F(0x40000000) /* 4.000000000 */ },
-
-  /* 24000 */ { MAD_F(0x08000000) /* 0.500000000 */,
-		MAD_F(0x08b51d9b) /* 0.544217687 */,
-		MAD_F(0x0c000000) /* 0.750000000 */,
-		MAD_F(0x10000000) /* 1.000000000 */,
-		MAD_F(0x116a3b36) /* 1.088435374 */,
-		MAD_F(0x18000000) /* 1.500000000 */,
-		MAD_F(0x20000000) /* 2.000000000 */,
-		MAD_F(0x22d4766c) /* 2.176870748 */,
-		MAD_F(0x30000000) /* 3.000000000 */ },
-
-  /* 22050 */ { MAD_F(0x0759999a) /* 0.459375000 */,
-		MAD_F(0x08000000) /* 0.500000000 */,
-		MAD_F(0x0b066666) /* 0.689062500 */,
-		MAD_F(0x0eb33333) /* 0.918750000 */,
-		MAD_F(0x10000000) /* 1.000000000 */,
-		MAD_F(0x160ccccd) /* 1.378125000 */,
-		MAD_F(0x1d666666) /* 1.837500000 */,
-		MAD_F(0x20000000) /* 2.000000000 */,
-		MAD_F(0x2c19999a) /* 2.756250000 */ },
-
-  /* 16000 */ { MAD_F(0x05555555) /* 0.333333333 */,
-		MAD_F(0x05ce13bd) /* 0.362811791 */,
-		MAD_F(0x08000000) /* 0.500000000 */,
-		MAD_F(0x0aaaaaab) /* 0.666666667 */,
-		MAD_F(0x0b9c2779) /* 0.725623583 */,
-		MAD_F(0x10000000) /* 1.000000000 */,
-		MAD_F(0x15555555) /* 1.333333333 */,
-		MAD_F(0x17384ef3) /* 1.451247166 */,
-		MAD_F(0x20000000) /* 2.000000000 */ },
-
-  /* 12000 */ { MAD_F(0x04000000) /* 0.250000000 */,
-		MAD_F(0x045a8ecd) /* 0.272108844 */,
-		MAD_F(0x06000000) /* 0.375000000 */,
-		MAD_F(0x08000000) /* 0.500000000 */,
-		MAD_F(0x08b51d9b) /* 0.544217687 */,
-		MAD_F(0x0c000000) /* 0.750000000 */,
-		MAD_F(0x10000000) /* 1.000000000 */,
-		MAD_F(0x116a3b36) /* 1.088435374 */,
-		MAD_F(0x18000000) /* 1.500000000 */ },
-
-  /* 11025 */ { MAD_F(0x03accccd) /* 0.229687500 */,
-		MAD_F(0x04000000) /* 0.250000000 */,
-		MAD_F(0x05833333) /* 0.344531250 */,
-		MAD_F(0x0759999a) /* 0.459375000 */,
-		MAD_F(0x08000000) /* 0.500000000 */,
-		MAD_F(0x0b066666) /* 0.689062500 */,
-		MAD_F(0x0eb33333) /* 0.918750000 */,
-		MAD_F(0x10000000) /* 1.000000000 */,
-		MAD_F(0x160ccccd) /* 1.378125000 */ },
-
-  /*  8000 */ { MAD_F(0x02aaaaab) /* 0.166666667 */, 
-		MAD_F(0x02e709de) /* 0.181405896 */, 
-		MAD_F(0x04000000) /* 0.250000000 */, 
-		MAD_F(0x05555555) /* 0.333333333 */, 
-		MAD_F(0x05ce13bd) /* 0.362811791 */, 
-		MAD_F(0x08000000) /* 0.500000000 */, 
-		MAD_F(0x0aaaaaab) /* 0.666666667 */, 
-		MAD_F(0x0b9c2779) /* 0.725623583 */, 
-		MAD_F(0x10000000) /* 1.000000000 */ }
-};
+# define RESAMPLE_ZEROS		8	/* sinc zero crossings each side */
+# define RESAMPLE_ROLLOFF	0.91	/* passband edge relative to Nyquist */
+# define RESAMPLE_MAXIN		1152	/* largest input block */
+# define RESAMPLE_MAXDOWN	6	/* largest rate ratio (48000:8000) */
+
+# if !defined(M_PI)
+#  define M_PI  3.14159265358979323846
+# endif
 
 static
 int rate_index(unsigned int rate)
@@ -141,6 +63,44 @@ int rate_index(unsigned int rate)
   return -1;
 }
 
+/*
+ * NAME:	gcd()
+ * DESCRIPTION:	greatest common divisor
+ */
+static
+unsigned int gcd(unsigned int a, unsigned int b)
+{
+  while (b) {
+    unsigned int t = a % b;
+
+    a = b;
+    b = t;
+  }
+
+  return a;
+}
+
+/*
+ * NAME:	kernel()
+ * DESCRIPTION:	Blackman-windowed sinc at distance t (input samples)
+ */
+static
+double kernel(double t, double cutoff, double halfwidth)
+{
+  double x, w;
+
+  if (fabs(t) >= halfwidth)
+    return 0;
+
+  x = M_PI * t / halfwidth;
+  w = 0.42 + 0.5 * cos(x) + 0.08 * cos(2 * x);
+
+  if (t == 0)
+    return 2 * cutoff * w;
+
+  return sin(2 * M_PI * cutoff * t) / (M_PI * t) * w;
+}
+
 /*
  * NAME:	resample_init()
  * DESCRIPTION:	initialize resampling state
@@ -148,22 +108,146 @@ int rate_index(unsigned int rate)
 int resample_init(struct resample_state *state,
 		  unsigned int oldrate, unsigned int newrate)
 {
-  int oldi, newi;
+  unsigned int factor, phase, tap;
+  double cutoff, halfwidth;
 
-  oldi = rate_index(oldrate);
-  newi = rate_index(newrate);
+  state->filter = 0;
+  state->buffer = 0;
 
-  if (oldi == -1 || newi == -1)
+  if (rate_index(oldrate) == -1 || rate_index(newrate) == -1)
     return -1;
 
-  state->ratio = resample_table[oldi][newi];
+  factor = gcd(oldrate, newrate);
+
+  state->up   = newrate / factor;
+  state->down = oldrate / factor;
+
+  /*
+   * Conceptually, the input is upsampled by `up', lowpass filtered below
+   * the lower of the two Nyquist frequencies, and decimated by `down'. Only
+   * the filter taps landing on input samples are ever evaluated, so the
+   * filter is stored as `up' phases of `ntaps' coefficients each; every
+   * output sample is one dot product over a window of the input.
+   */
+
+  /* widen the filter in proportion when decimating; keep it a multiple of 4 */
+
+  state->ntaps = 2 * RESAMPLE_ZEROS;
+  if (state->down > state->up) {
+    state->ntaps = (2 * RESAMPLE_ZEROS * state->down +
+		    4 * state->up - 1) / (4 * state->up) * 4;
+  }
+
+  cutoff = 0.5 * RESAMPLE_ROLLOFF;
+  if (state->down > state->up)
+    cutoff *= (double) state->up / state->down;
+
+  halfwidth = state->ntaps / 2;
 
-  state->step = 0;
-  state->last = 0;
+  state->filter = malloc(state->up * state->ntaps * sizeof(resample_coef_t));
+  state->buffer = malloc((state->ntaps - 1 + RESAMPLE_MAXIN) *
+			 sizeof(mad_fixed_t));
+
+  if (state->filter == 0 || state->buffer == 0) {
+    resample_finish(state);
+    return -1;
+  }
+
+  for (phase = 0; phase < state->up; ++phase) {
+    resample_coef_t *coef = &state->filter[phase * state->ntaps];
+    double h[2 * RESAMPLE_ZEROS * RESAMPLE_MAXDOWN], sum = 0;
+
+    /* tap 0 sits ntaps/2 - 1 input samples before the output instant */
+
+    for (tap = 0; tap < state->ntaps; ++tap) {
+      h[tap] = kernel((double) tap - (state->ntaps / 2 - 1) -
+		      (double) phase / state->up, cutoff, halfwidth);
+      sum += h[tap];
+    }
+
+    /* normalize each phase to unity gain at DC */
+
+    for (tap = 0; tap < state->ntaps; ++tap) {
+# if defined(__SSE2__)
+      coef[tap] = h[tap] / sum;
+# else
+      coef[tap] = mad_f_tofixed(h[tap] / sum);
+# endif
+    }
+  }
+
+  memset(state->buffer, 0, (state->ntaps - 1) * sizeof(mad_fixed_t));
+
+  state->phase = 0;
+  state->start = state->ntaps / 2;
 
   return 0;
 }
 
+/*
+ * NAME:	resample_finish()
+ * DESCRIPTION:	release resampling state
+ */
+void resample_finish(struct resample_state *state)
+{
+  free(state->filter);
+  free(state->buffer);
+
+  state->filter = 0;
+  state->buffer = 0;
+}
+
+/*
+ * NAME:	dot()
+ * DESCRIPTION:	apply one filter phase to a window of samples
+ */
+static inline
+mad_fixed_t dot(resample_coef_t const *coef, mad_fixed_t const *sample,
+		unsigned int ntaps)
+{
+# if defined(__SSE2__)
+  __m128 sum0, sum1;
+  unsigned int i;
+
+  /*
+   * Single precision keeps about 24 significant bits through the sum,
+   * which is ample for the output resolution, and evaluates four taps per
+   * instruction; ntaps is always a multiple of 4.
+   */
+
+  sum0 = sum1 = _mm_setzero_ps();
+
+# define TAPS(sum, i)  \
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&coef[i]),  \
+      _mm_cvtepi32_ps(_mm_loadu_si128((__m128i const *) &sample[i]))))
+
+  for (i = 0; i + 8 <= ntaps; i += 8) {
+    TAPS(sum0, i);
+    TAPS(sum1, i + 4);
+  }
+  if (i < ntaps)
+    TAPS(sum0, i);
+
+# undef TAPS
+
+  sum0 = _mm_add_ps(sum0, sum1);
+  sum0 = _mm_add_ps(sum0, _mm_movehl_ps(sum0, sum0));
+  sum0 = _mm_add_ss(sum0, _mm_shuffle_ps(sum0, sum0, 1));
+
+  return _mm_cvtss_si32(sum0);
+# else
+  mad_fixed64hi_t hi;
+  mad_fixed64lo_t lo;
+
+  MAD_F_ML0(hi, lo, *coef++, *sample++);
+
+  while (--ntaps)
+    MAD_F_MLA(hi, lo, *coef++, *sample++);
+
+  return MAD_F_MLZ(hi, lo);
+# endif
+}
+
 /*
  * NAME:	resample_block()
  * DESCRIPTION:	algorithmically change the sampling rate of a PCM sample block
@@ -172,57 +256,50 @@ unsigned int resample_block(struct resample_state *state,
 			    unsigned int nsamples, mad_fixed_t const *old,
 			    mad_fixed_t *new)
 {
-  mad_fixed_t const *end, *begin;
-
-  /*
-   * This resampling algorithm is based on a linear interpolation, which is
-   * not at all the best sounding but is relatively fast and efficient.
-   *
-   * A better algorithm would be one that implements a bandlimited
-   * interpolation.
-   */
+  resample_coef_t const *filter;
+  mad_fixed_t *begin, *buffer;
+  unsigned int ntaps, history, end, phase, start, step, rem;
 
-  if (state->ratio == MAD_F_ONE) {
+  if (state->up == state->down) {
     memcpy(new, old, nsamples * sizeof(mad_fixed_t));
     return nsamples;
   }
 
-  end   = old + nsamples;
-  begin = new;
-
-  if (state->step < 0) {
-    state->step = mad_f_fracpart(-state->step);
+  /*
+   * The buffer holds the last ntaps - 1 input samples of the previous
+   * block followed by this block, so every window is contiguous.
+   */
 
-    while (state->step < MAD_F_ONE) {
-      *new++ = state->step ?
-	state->last + mad_f_mul(*old - state->last, state->step) : state->last;
+  filter  = state->filter;
+  buffer  = state->buffer;
+  ntaps   = state->ntaps;
+  history = ntaps - 1;
 
-      state->step += state->ratio;
-      if (((state->step + 0x00000080L) & 0x0fffff00L) == 0)
-	state->step = (state->step + 0x00000080L) & ~0x0fffffffL;
-    }
+  memcpy(&buffer[history], old, nsamples * sizeof(mad_fixed_t));
 
-    state->step -= MAD_F_ONE;
-  }
+  begin = new;
+  end   = history + nsamples;
+  phase = state->phase;
+  start = state->start;
 
-  while (end - old > 1 + mad_f_intpart(state->step)) {
-    old        += mad_f_intpart(state->step);
-    state->step = mad_f_fracpart(state->step);
+  step = state->down / state->up;
+  rem  = state->down % state->up;
 
-    *new++ = state->step ?
-      *old + mad_f_mul(old[1] - old[0], state->step) : *old;
+  while (start + ntaps <= end) {
+    *new++ = dot(&filter[phase * ntaps], &buffer[start], ntaps);
 
-    state->step += state->ratio;
-    if (((state->step + 0x00000080L) & 0x0fffff00L) == 0)
-      state->step = (state->step + 0x00000080L) & ~0x0fffffffL;
+    start += step;
+    phase += rem;
+    if (phase >= state->up) {
+      phase -= state->up;
+      ++start;
+    }
   }
 
-  if (end - old == 1 + mad_f_intpart(state->step)) {
-    state->last = end[-1];
-    state->step = -state->step;
-  }
-  else
-    state->step -= mad_f_fromint(end - old);
+  memmove(buffer, &buffer[nsamples], history * sizeof(mad_fixed_t));
+
+  state->phase = phase;
+  state->start = start - nsamples;
 
   return new - begin;
 }
@@ -24,16 +24,26 @@
 
 # include "mad.h"
 
+# if defined(__SSE2__)
+typedef float resample_coef_t;
+# else
+typedef mad_fixed_t resample_coef_t;
+# endif
+
 struct resample_state {
-  mad_fixed_t ratio;
+  unsigned int up;		/* interpolation factor (number of phases) */
+  unsigned int down;		/* decimation factor */
+  unsigned int ntaps;		/* filter length per phase */
 
-  mad_fixed_t step;
-  mad_fixed_t last;
+  resample_coef_t *filter;	/* up * ntaps polyphase filter bank */
+  mad_fixed_t *buffer;		/* ntaps - 1 history + one input block */
+
+  unsigned int phase;		/* filter phase of next output */
+  unsigned int start;		/* buffer index of next output window */
 };
 
 int resample_init(struct resample_state *, unsigned int, unsigned int);
-
-# define resample_finish(state)  /* nothing */
+void resample_finish(struct resample_state *);
 
 unsigned int resample_block(struct resample_state *, unsigned int nsamples,
 			    mad_fixed_t const *, mad_fixed_t *);
@@ -0,0 +1,352 @@
+/* +++Date last modified: 18-Oct-2026 */
+
+/*
+**  Multi-pattern string search (Aho-Corasick)
+**
+**  The other searchers in this directory keep their tables in static
+**  globals, so only one pattern can be active at a time and looking
+**  for N patterns means N passes over the text. mp_compile() instead
+**  builds one automaton for a whole pattern list, returned as a
+**  handle owned by the caller, and mp_search() finds every occurrence
+**  of every pattern in a single left-to-right pass.
+**
+**  The automaton is a full DFA (failure links resolved at compile
+**  time) over a compressed alphabet: bytes that occur in no pattern
+**  share one class, so the transition table is states x classes
+**  rather than states x 256. Matching modes:
+**
+**    MP_EXACT    case-sensitive, as bmh_search() / strsearch()
+**    MP_NOCASE   toupper() folding, as bmhi_search()
+**    MP_ACCENTS  lowervec[] folding with accent stripping, as
+**                bmha_search()
+**
+**  While the automaton is in its start state only bytes that can
+**  begin a pattern matter. If there are at most MP_SIMD_STARTS such
+**  bytes they are located 16 at a time with SSE2 compares, otherwise
+**  a byte table is used to skip ahead.
+**
+**  Handles are read-only after mp_compile(), so one handle may be
+**  searched from several threads at once.
+*/
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "search.h"
+
+#ifdef __SSE2__
+ #include <emmintrin.h>
+#endif
+
+typedef unsigned char uchar;
+
+#define MP_SIMD_STARTS  4       /* max start bytes for SSE2 skipping */
+
+extern unsigned char lowervec[UCHAR_MAX+1];         /* Bmhasrch.C   */
+
+struct mp_set {
+      int    npat;              /* # of patterns                    */
+      size_t *patlen;           /* length of each pattern           */
+      int    *samepat;          /* next pattern with identical text */
+      int    nstates;
+      int    nclass;            /* alphabet classes, 0 = "other"    */
+      uchar  cls[UCHAR_MAX+1];  /* input byte -> class              */
+      int    *delta;            /* nstates x nclass transitions     */
+      int    *out;              /* first pattern ending here or -1  */
+      int    *dict;             /* next state on fail chain with
+                                ** an output, or -1                 */
+      uchar  start[UCHAR_MAX+1];/* byte can leave the start state   */
+      int    nstarts;
+      uchar  startbytes[MP_SIMD_STARTS];
+};
+
+static uchar fold(int mode, uchar c)
+{
+      switch (mode)
+      {
+      case MP_NOCASE:
+            return (uchar)toupper(c);
+      case MP_ACCENTS:
+            return lowervec[c];
+      default:
+            return c;
+      }
+}
+
+/*
+**  Grow the trie's state arrays to hold at least `want' states.
+*/
+
+static int grow(MP_SET *set, int *cap, int want)
+{
+      int newcap = *cap ? *cap : 64, *p;
+      size_t i;
+
+      if (want <= *cap)
+            return 0;
+      while (newcap < want)
+            newcap *= 2;
+      if (NULL == (p = realloc(set->delta,
+                               (size_t)newcap * set->nclass * sizeof(int))))
+            return -1;
+      set->delta = p;
+      for (i = (size_t)*cap * set->nclass;
+           i < (size_t)newcap * set->nclass; i++)
+            set->delta[i] = -1;
+      if (NULL == (p = realloc(set->out, newcap * sizeof(int))))
+            return -1;
+      set->out = p;
+      *cap = newcap;
+      return 0;
+}
+
+/*
+**  Build an automaton for `npat' patterns. Empty patterns never
+**  match. Returns NULL if no memory is available.
+*/
+
+MP_SET *mp_compile(const char * const *patterns, int npat, int mode)
+{
+      MP_SET *set;
+      int cap = 0, i, c, s, head, tail;
+      int *queue = NULL, *fail = NULL;
+
+      if (NULL == (set = calloc(1, sizeof(*set))))
+            return NULL;
+      set->npat = npat;
+      set->patlen  = malloc((npat ? npat : 1) * sizeof(size_t));
+      set->samepat = malloc((npat ? npat : 1) * sizeof(int));
+      if (!set->patlen || !set->samepat)
+            goto nomem;
+
+      /* Alphabet classes: every byte folding to the same pattern
+         byte shares a class; bytes in no pattern stay in class 0 */
+
+      {
+            int folded[UCHAR_MAX+1];
+
+            memset(folded, 0, sizeof(folded));
+            set->nclass = 1;
+            for (i = 0; i < npat; i++)
+            {
+                  const uchar *p = (const uchar *)patterns[i];
+
+                  for (; *p; p++)
+                  {
+                        uchar f = fold(mode, *p);
+
+                        if (0 == folded[f])
+                              folded[f] = set->nclass++;
+                  }
+            }
+            for (c = 0; c <= UCHAR_MAX; c++)
+                  set->cls[c] = (uchar)folded[fold(mode, (uchar)c)];
+      }
+
+      /* Trie */
+
+      set->nstates = 1;
+      if (grow(set, &cap, 1) < 0)
+            goto nomem;
+      set->out[0] = -1;
+      for (i = 0; i < npat; i++)
+      {
+            const uchar *p = (const uchar *)patterns[i];
+
+            set->patlen[i] = strlen(patterns[i]);
+            set->samepat[i] = -1;
+            if (0 == set->patlen[i])
+                  continue;
+            for (s = 0; *p; p++)
+            {
+                  int *t = &set->delta[s * set->nclass + set->cls[*p]];
+
+                  if (*t < 0)
+                  {
+                        if (grow(set, &cap, set->nstates + 1) < 0)
+                              goto nomem;
+                        t = &set->delta[s * set->nclass + set->cls[*p]];
+                        *t = set->nstates;
+                        set->out[set->nstates++] = -1;
+                  }
+                  s = *t;
+            }
+            if (set->out[s] < 0)
+                  set->out[s] = i;
+            else
+            {
+                  int k = set->out[s];
+
+                  while (set->samepat[k] >= 0)
+                        k = set->samepat[k];
+                  set->samepat[k] = i;
+            }
+      }
+
+      /* Failure links, breadth first, folded into the DFA */
+
+      queue = malloc(set->nstates * sizeof(int));
+      fail  = malloc(set->nstates * sizeof(int));
+      set->dict = malloc(set->nstates * sizeof(int));
+      if (!queue || !fail || !set->dict)
+            goto nomem;
+      head = tail = 0;
+      fail[0] = 0;
+      set->dict[0] = -1;
+      for (c = 0; c < set->nclass; c++)
+      {
+            int t = set->delta[c];
+
+            if (t < 0)
+                  set->delta[c] = 0;
+            else
+            {
+                  fail[t] = 0;
+                  set->dict[t] = -1;
+                  queue[tail++] = t;
+            }
+      }
+      while (head < tail)
+      {
+            int *row;
+
+            s = queue[head++];
+            row = &set->delta[s * set->nclass];
+            for (c = 0; c < set->nclass; c++)
+            {
+                  int t = row[c];
+                  int f = set->delta[fail[s] * set->nclass + c];
+
+                  if (t < 0)
+                        row[c] = f;
+                  else
+                  {
+                        fail[t] = f;
+                        set->dict[t] = set->out[f] >= 0 ? f : set->dict[f];
+                        queue[tail++] = t;
+                  }
+            }
+      }
+      free(queue);
+      free(fail);
+
+      /* Start-state prefilter */
+
+      for (c = 0; c <= UCHAR_MAX; c++)
+      {
+            set->start[c] = 0 != set->delta[set->cls[c]];
+            if (set->start[c])
+            {
+                  if (set->nstarts < MP_SIMD_STARTS)
+                        set->startbytes[set->nstarts] = (uchar)c;
+                  set->nstarts++;
+            }
+      }
+      return set;
+
+nomem:
+      free(queue);
+      free(fail);
+      mp_free(set);
+      return NULL;
+}
+
+void mp_free(MP_SET *set)
+{
+      if (set)
+      {
+            free(set->patlen);
+            free(set->samepat);
+            free(set->delta);
+            free(set->out);
+            free(set->dict);
+            free(set);
+      }
+}
+
+/*
+**  Find the next byte at or after `p' that can start a match.
+*/
+
+static const uchar *skip_to_start(const MP_SET *set,
+                                  const uchar *p, const uchar *end)
+{
+#ifdef __SSE2__
+      if (set->nstarts <= MP_SIMD_STARTS)
+      {
+            __m128i b0, b1, b2, b3;
+            const uchar *sb = set->startbytes;
+
+            if (0 == set->nstarts)
+                  return end;
+            b0 = _mm_set1_epi8((char)sb[0]);
+            b1 = _mm_set1_epi8((char)sb[set->nstarts > 1 ? 1 : 0]);
+            b2 = _mm_set1_epi8((char)sb[set->nstarts > 2 ? 2 : 0]);
+            b3 = _mm_set1_epi8((char)sb[set->nstarts > 3 ? 3 : 0]);
+            for (; end - p >= 16; p += 16)
+            {
+                  __m128i v = _mm_loadu_si128((const __m128i *)p);
+                  int m = _mm_movemask_epi8(_mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(v, b0),
+                                     _mm_cmpeq_epi8(v, b1)),
+                        _mm_or_si128(_mm_cmpeq_epi8(v, b2),
+                                     _mm_cmpeq_epi8(v, b3))));
+
+                  if (m)
+                        return p + __builtin_ctz(m);
+            }
+      }
+#endif
+      while (p < end && !set->start[*p])
+            p++;
+      return p;
+}
+
+/*
+**  Scan `len' bytes of `text' once, calling found() for every
+**  occurrence of every pattern, in order of where the occurrence
+**  ends. found() gets the pattern's index and a pointer to its first
+**  character in the text; a nonzero return stops the scan. Returns
+**  the number of matches reported.
+*/
+
+long mp_search(const MP_SET *set, const char *text, size_t len,
+               mp_found_fn found, void *arg)
+{
+      const uchar *p = (const uchar *)text, *end = p + len;
+      const int *delta = set->delta;
+      const uchar *cls = set->cls;
+      int nclass = set->nclass, s = 0;
+      long n = 0;
+
+      while (p < end)
+      {
+            if (0 == s && (p = skip_to_start(set, p, end)) == end)
+                  break;
+            s = delta[s * nclass + cls[*p++]];
+            if (set->out[s] >= 0 || set->dict[s] >= 0)
+            {
+                  int t = set->out[s] >= 0 ? s : set->dict[s];
+
+                  for (; t >= 0; t = set->dict[t])
+                  {
+                        int k;
+
+                        for (k = set->out[t]; k >= 0; k = set->samepat[k])
+                        {
+                              n++;
+                              if (found(k, (const char *)p - set->patlen[k],
+                                        arg))
+                                    return n;
+                        }
+                  }
+            }
+      }
+      return n;
+}
+
+int mp_patterns(const MP_SET *set)
+{
+      return set->npat;
+}
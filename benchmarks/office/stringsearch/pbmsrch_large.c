@@ -68,8 +68,84 @@ char *strsearch(const char *string)
 }
 
 #include <stdio.h>
+#include <stdlib.h>
+#include "search.h"
 
-main()
+/*
+**  Multi-pattern driver: compile every find string into one automaton
+**  and scan each search string once, remembering the first occurrence
+**  of each pattern. Reports every pattern found in each search string,
+**  not just the one it is paired with in the default loop.
+*/
+
+struct first_hit {
+      const char **where;
+      int *seen;
+      int gen;
+};
+
+static int note_first(int pattern, const char *where, void *arg)
+{
+      struct first_hit *hits = arg;
+
+      if (hits->seen[pattern] != hits->gen)
+      {
+            hits->seen[pattern] = hits->gen;
+            hits->where[pattern] = where;
+      }
+      return 0;
+}
+
+static int multi_search(char **find_strings, char **search_strings, int mode)
+{
+      struct first_hit hits;
+      MP_SET *set;
+      int i, j, n;
+
+      for (n = 0; find_strings[n]; n++)
+            ;
+      set = mp_compile((const char * const *)find_strings, n, mode);
+      hits.where = calloc(n + 1, sizeof(*hits.where));
+      hits.seen = calloc(n + 1, sizeof(*hits.seen));
+      if (!set || !hits.where || !hits.seen)
+      {
+            fputs("search: out of memory\n", stderr);
+            return 1;
+      }
+      for (i = 0; i < n; i++)
+      {
+            int found = 0;
+
+            hits.gen = i + 1;
+            mp_search(set, search_strings[i], strlen(search_strings[i]),
+                      note_first, &hits);
+            for (j = 0; j < n; j++)
+            {
+                  if (hits.seen[j] != hits.gen)
+                        continue;
+                  printf("\"%s\" is in \"%s\" [\"%s\"]\n", find_strings[j],
+                        search_strings[i], hits.where[j]);
+                  found = 1;
+            }
+            if (!found)
+                  printf("no pattern is in \"%s\"\n", search_strings[i]);
+      }
+      mp_free(set);
+      free(hits.where);
+      free(hits.seen);
+      return 0;
+}
+
+/*
+**  Usage: search_large [-m | -mi]
+**
+**  With no option each pattern is searched for with init_search() /
+**  strsearch() in its paired search string. -m instead looks for all
+**  patterns at once in every search string with the multi-pattern
+**  matcher, -mi is its case-insensitive mode.
+*/
+
+int main(int argc, char *argv[])
 {
       char *here;
       char *find_strings[] = { "Kur",
@@ -2740,6 +2816,11 @@ NULL};
 };
       int i;
 
+      if (argc > 1 && 0 == strcmp(argv[1], "-m"))
+            return multi_search(find_strings, search_strings, MP_EXACT);
+      if (argc > 1 && 0 == strcmp(argv[1], "-mi"))
+            return multi_search(find_strings, search_strings, MP_NOCASE);
+
       for (i = 0; find_strings[i]; i++)
       {
             init_search(find_strings[i]);
@@ -15,3 +15,23 @@ char *bmhi_search(const char *string,                 /* Bhmisrch.C     */
 void  bmha_init(const char *pattern);                 /* Bmhasrch.C     */
 char *bmha_search(const char *string,                 /* Bmhasrch.C     */
                   const int stringlen);
+
+/*
+**  Reentrant multi-pattern search (Aho-Corasick), see Mpsrch.C
+*/
+
+#include <stddef.h>
+
+#define MP_EXACT    0           /* case-sensitive                   */
+#define MP_NOCASE   1           /* toupper() folding, as bmhi       */
+#define MP_ACCENTS  2           /* lowervec[] folding, as bmha      */
+
+typedef struct mp_set MP_SET;
+typedef int (*mp_found_fn)(int pattern, const char *where, void *arg);
+
+MP_SET *mp_compile(const char * const *patterns,      /* Mpsrch.C       */
+                   int npat, int mode);
+long  mp_search(const MP_SET *set, const char *text,  /* Mpsrch.C       */
+                size_t len, mp_found_fn found, void *arg);
+int   mp_patterns(const MP_SET *set);                 /* Mpsrch.C       */
+void  mp_free(MP_SET *set);                           /* Mpsrch.C       */
@@ -1,21 +1,104 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "blowfish.h"
 
+#define USAGE "Usage: blowfish {e|d} <intput> <output> key [cfb|ctr|ecb] [threads]\n"
+
+/* Data is read and written BF_IOBUF bytes at a time.  In ctr and ecb
+ * modes each buffer is cut into per-thread pieces on block boundaries;
+ * pieces smaller than BF_MIN_PIECE are not worth a thread. */
+#define BF_IOBUF	(4L*1024*1024)
+#define BF_MIN_PIECE	(64L*1024)
+
+#define MODE_CFB	0
+#define MODE_CTR	1
+#define MODE_ECB	2
+
+typedef struct {
+	unsigned char *in, *out;
+	long length;
+	BF_KEY *key;
+	unsigned char ivec[8];
+	int mode, encrypt;
+} BF_PIECE;
+
+static void *do_piece(void *arg)
+{
+	BF_PIECE *pc = (BF_PIECE *)arg;
+	unsigned char ecount[8];
+	int num = 0;
+
+	if (pc->mode == MODE_CTR)
+		BF_ctr_encrypt(pc->in,pc->out,pc->length,pc->key,pc->ivec,ecount,&num);
+	else
+		BF_ecb_encrypt_blocks(pc->in,pc->out,pc->length,pc->key,pc->encrypt);
+	return NULL;
+}
+
+/* ctr/ecb over one buffer, split across up to nthreads threads.  For
+ * ctr, ivec is the counter for the start of the buffer and is moved
+ * past it. */
+static void run_pieces(unsigned char *in, unsigned char *out, long length,
+	BF_KEY *key, unsigned char *ivec, int mode, int encrypt, int nthreads)
+{
+	BF_PIECE pc[64];
+	pthread_t tid[64];
+	long blocks = (length + 7) / 8, per, off = 0;
+	int t, n;
+
+	n = nthreads;
+	if (n > 64) n = 64;
+	while (n > 1 && blocks * 8 / n < BF_MIN_PIECE)
+		n--;
+	per = (blocks + n - 1) / n;
+
+	for (t = 0; t < n && off < length; t++)
+	{
+		pc[t].in = in + off;
+		pc[t].out = out + off;
+		pc[t].length = per * 8;
+		if (off + pc[t].length > length)
+			pc[t].length = length - off;
+		pc[t].key = key;
+		pc[t].mode = mode;
+		pc[t].encrypt = encrypt;
+		memcpy(pc[t].ivec, ivec, 8);
+		BF_ctr_add(pc[t].ivec, (unsigned long)(off / 8));
+		off += pc[t].length;
+		if (t > 0)
+			pthread_create(&tid[t], NULL, do_piece, &pc[t]);
+	}
+	n = t;
+	do_piece(&pc[0]);
+	for (t = 1; t < n; t++)
+		pthread_join(tid[t], NULL);
+
+	if (mode == MODE_CTR)
+		BF_ctr_add(ivec, (unsigned long)blocks);
+}
+
 int
 main(int argc, char *argv[])
 {
 	BF_KEY key;
-	unsigned char ukey[8];
-	unsigned char indata[40],outdata[40],ivec[8];
-	int num;
+	unsigned char ukey[32];
+	unsigned char *indata,*outdata,ivec[8];
+	int num=0;
 	int by=0,i=0;
 	int encordec=-1;
+	int mode=MODE_CFB,nthreads;
+	long len,pad,outlen;
+	int c,last;
 	char *cp,ch;
 	FILE *fp,*fp2;
 
-if (argc<3)
+if (argc<5)
 {
-	printf("Usage: blowfish {e|d} <intput> <output> key\n");
+	printf(USAGE);
 	exit(-1);
 }
 
@@ -25,7 +108,7 @@ else if (*argv[1]=='d' || *argv[1]=='D')
 	encordec = 0;
 else
 {
-	printf("Usage: blowfish {e|d} <intput> <output> key\n");
+	printf(USAGE);
 	exit(-1);
 }
 					
@@ -59,39 +142,109 @@ if(*cp)
 }
 
 /* open the input and output files */
-if ((fp = fopen(argv[2],"r"))==0)
+if ((fp = fopen(argv[2],"rb"))==0)
 {
-	printf("Usage: blowfish {e|d} <intput> <output> key\n");
+	printf(USAGE);
 	exit(-1);
 };
-if ((fp2 = fopen(argv[3],"w"))==0)
+if ((fp2 = fopen(argv[3],"wb"))==0)
 {
-	printf("Usage: blowfish {e|d} <intput> <output> key\n");
+	printf(USAGE);
 	exit(-1);
 };
 
-i=0;
-while(!feof(fp))
+if (argc>5)
 {
-	int j;
-	while(!feof(fp) && i<40)
-		indata[i++]=getc(fp);
+	if (strcmp(argv[5],"cfb")==0)
+		mode = MODE_CFB;
+	else if (strcmp(argv[5],"ctr")==0)
+		mode = MODE_CTR;
+	else if (strcmp(argv[5],"ecb")==0)
+		mode = MODE_ECB;
+	else
+	{
+		printf(USAGE);
+		exit(-1);
+	}
+}
+nthreads = (argc>6) ? atoi(argv[6]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+if (nthreads < 1)
+	nthreads = 1;
+
+/* ecb pads the last block (PKCS#5), so leave room for it */
+indata = (unsigned char *)malloc(BF_IOBUF + 8);
+outdata = (unsigned char *)malloc(BF_IOBUF + 8);
+if (indata==NULL || outdata==NULL)
+{
+	printf("Out of memory\n");
+	exit(-1);
+}
+memset(ivec,0,sizeof(ivec));
 
-	BF_cfb64_encrypt(indata,outdata,i,&key,ivec,&num,encordec);
+/* do/while, so that an empty input still gets its ecb pad block */
+do
+{
+	len = (long)fread(indata,1,BF_IOBUF,fp);
 
-	for(j=0;j<i;j++)
+	/* look ahead so ecb knows which buffer holds the final block */
+	if ((c = getc(fp)) == EOF)
+		last = 1;
+	else
 	{
-		/*printf("%c",outdata[j]);*/
-		fputc(outdata[j],fp2);
+		ungetc(c,fp);
+		last = 0;
 	}
-	i=0;
-}
 
-close(fp);
-close(fp2);
+	if (len == 0 && mode != MODE_ECB)
+		break;
 
-exit(1);
-}
+	outlen = len;
+	switch (mode)
+	{
+	case MODE_CFB:
+		BF_cfb64_encrypt(indata,outdata,len,&key,ivec,&num,encordec);
+		break;
+	case MODE_CTR:
+		run_pieces(indata,outdata,len,&key,ivec,mode,encordec,nthreads);
+		break;
+	case MODE_ECB:
+		if (last && encordec)
+		{
+			pad = 8 - (len & 7);
+			memset(indata+len,(int)pad,pad);
+			len += pad;
+		}
+		else if ((len & 7) || len == 0)
+		{
+			printf("Input is not a whole number of blocks\n");
+			exit(-1);
+		}
+		run_pieces(indata,outdata,len,&key,ivec,mode,encordec,nthreads);
+		outlen = len;
+		if (last && !encordec)
+		{
+			pad = outdata[len-1];
+			if (pad < 1 || pad > 8 || pad > len)
+			{
+				printf("Bad padding in last block\n");
+				exit(-1);
+			}
+			outlen -= pad;
+		}
+		break;
+	}
 
+	if (fwrite(outdata,1,outlen,fp2) != (size_t)outlen)
+	{
+		printf("Write error\n");
+		exit(-1);
+	}
+} while (!last);
 
+fclose(fp);
+fclose(fp2);
+free(indata);
+free(outdata);
 
+exit(1);
+}
@@ -0,0 +1,156 @@
+/* crypto/bf/bf_ctr.c */
+/* Copyright (C) 1995-1997 Eric Young (eay@mincom.oz.au)
+ * All rights reserved.
+ *
+ * This package is an SSL implementation written
+ * by Eric Young (eay@mincom.oz.au).
+ * The implementation was written so as to conform with Netscapes SSL.
+ * 
+ * This library is free for commercial and non-commercial use as long as
+ * the following conditions are aheared to.  The following conditions
+ * apply to all code found in this distribution, be it the RC4, RSA,
+ * lhash, DES, etc., code; not just the SSL code.  The SSL documentation
+ * included with this distribution is covered by the same copyright terms
+ * except that the holder is Tim Hudson (tjh@mincom.oz.au).
+ * 
+ * Copyright remains Eric Young's, and as such any Copyright notices in
+ * the code are not to be removed.
+ * If this package is used in a product, Eric Young should be given attribution
+ * as the author of the parts of the library used.
+ * This can be in the form of a textual message at program startup or
+ * in documentation (online or textual) provided with the package.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. All advertising materials mentioning features or use of this software
+ *    must display the following acknowledgement:
+ *    "This product includes cryptographic software written by
+ *     Eric Young (eay@mincom.oz.au)"
+ *    The word 'cryptographic' can be left out if the rouines from the library
+ *    being used are not cryptographic related :-).
+ * 4. If you include any Windows specific code (or a derivative thereof) from 
+ *    the apps directory (application code) you must include an acknowledgement:
+ *    "This product includes software written by Tim Hudson (tjh@mincom.oz.au)"
+ * 
+ * THIS SOFTWARE IS PROVIDED BY ERIC YOUNG ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ * 
+ * The licence and distribution terms for any publically available version or
+ * derivative of this code cannot be changed.  i.e. this code cannot simply be
+ * copied and put under another distribution licence
+ * [including the GNU Public Licence.]
+ */
+
+#include <string.h>
+#include "blowfish.h"
+#include "bf_locl.h"
+
+/* Counter mode.  ivec is a 64 bit big endian counter which is
+ * encrypted to give each 8 byte block of key stream and then
+ * incremented.  As with cfb64, *num records how much of the current
+ * key stream block (kept in ecount) has been used, so the data can be
+ * fed in pieces of any size.  Encryption and decryption are the same
+ * operation.  Whole blocks are produced four at a time through
+ * BF_encrypt4(); since no block depends on another, a long message
+ * can also be cut at any block boundary and the pieces done in
+ * parallel after positioning each counter with BF_ctr_add().
+ */
+
+static void ctr_next(c, d)
+unsigned char *c;
+BF_LONG *d;
+	{
+	unsigned char *iv=c;
+	BF_LONG l;
+
+	n2l(iv,l); d[0]=l;
+	n2l(iv,l); d[1]=l;
+	BF_ctr_add(c,1L);
+	}
+
+void BF_ctr_add(ivec, blocks)
+unsigned char *ivec;
+unsigned long blocks;
+	{
+	int i;
+	unsigned long carry=blocks;
+
+	for (i=7; i>=0 && carry; i--)
+		{
+		carry+=ivec[i];
+		ivec[i]=(unsigned char)(carry&0xff);
+		carry>>=8;
+		}
+	}
+
+void BF_ctr_encrypt(in, out, length, schedule, ivec, ecount, num)
+unsigned char *in;
+unsigned char *out;
+long length;
+BF_KEY *schedule;
+unsigned char *ivec;
+unsigned char *ecount;
+int *num;
+	{
+	register int n= *num;
+	register long l=length;
+	BF_LONG d[8],t;
+	unsigned char ks[4*BF_BLOCK],*k;
+	int i;
+
+	/* finish a partly used key stream block */
+	while (n && l)
+		{
+		*(out++)= *(in++)^ecount[n];
+		n=(n+1)&0x07;
+		l--;
+		}
+
+	for (; l >= 4*BF_BLOCK; l-=4*BF_BLOCK)
+		{
+		ctr_next(ivec,&d[0]);
+		ctr_next(ivec,&d[2]);
+		ctr_next(ivec,&d[4]);
+		ctr_next(ivec,&d[6]);
+		BF_encrypt4(d,schedule,BF_ENCRYPT);
+		k=ks;
+		for (i=0; i<8; i++)
+			{ t=d[i]; l2n(t,k); }
+		for (i=0; i<4*BF_BLOCK; i++)
+			*(out++)= *(in++)^ks[i];
+		}
+
+	while (l--)
+		{
+		if (n == 0)
+			{
+			ctr_next(ivec,d);
+			BF_encrypt(d,schedule,BF_ENCRYPT);
+			k=ecount;
+			t=d[0]; l2n(t,k);
+			t=d[1]; l2n(t,k);
+			}
+		*(out++)= *(in++)^ecount[n];
+		n=(n+1)&0x07;
+		}
+
+	for (i=0; i<8; i++) d[i]=0;
+	memset(ks,0,sizeof(ks));
+	t=0;
+	*num=n;
+	}
@@ -93,3 +93,34 @@ int encrypt;
 	l=d[0]=d[1]=0;
 	}
 
+
+/* ECB over length bytes (only whole 8 byte blocks are processed),
+ * four blocks per BF_encrypt4() call. */
+void BF_ecb_encrypt_blocks(in, out, length, ks, encrypt)
+unsigned char *in;
+unsigned char *out;
+long length;
+BF_KEY *ks;
+int encrypt;
+	{
+	BF_LONG l,d[8];
+	int i;
+
+	for (; length >= 4*BF_BLOCK; length-=4*BF_BLOCK)
+		{
+		for (i=0; i<8; i++)
+			{ n2l(in,l); d[i]=l; }
+		BF_encrypt4(d,ks,encrypt);
+		for (i=0; i<8; i++)
+			{ l=d[i]; l2n(l,out); }
+		}
+	for (; length >= BF_BLOCK; length-=BF_BLOCK)
+		{
+		n2l(in,l); d[0]=l;
+		n2l(in,l); d[1]=l;
+		BF_encrypt(d,ks,encrypt);
+		l=d[0]; l2n(l,out);
+		l=d[1]; l2n(l,out);
+		}
+	l=d[0]=d[1]=0;
+	}
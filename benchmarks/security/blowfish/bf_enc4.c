@@ -0,0 +1,155 @@
+/* crypto/bf/bf_enc4.c */
+/* Copyright (C) 1995-1997 Eric Young (eay@mincom.oz.au)
+ * All rights reserved.
+ *
+ * This package is an SSL implementation written
+ * by Eric Young (eay@mincom.oz.au).
+ * The implementation was written so as to conform with Netscapes SSL.
+ * 
+ * This library is free for commercial and non-commercial use as long as
+ * the following conditions are aheared to.  The following conditions
+ * apply to all code found in this distribution, be it the RC4, RSA,
+ * lhash, DES, etc., code; not just the SSL code.  The SSL documentation
+ * included with this distribution is covered by the same copyright terms
+ * except that the holder is Tim Hudson (tjh@mincom.oz.au).
+ * 
+ * Copyright remains Eric Young's, and as such any Copyright notices in
+ * the code are not to be removed.
+ * If this package is used in a product, Eric Young should be given attribution
+ * as the author of the parts of the library used.
+ * This can be in the form of a textual message at program startup or
+ * in documentation (online or textual) provided with the package.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. All advertising materials mentioning features or use of this software
+ *    must display the following acknowledgement:
+ *    "This product includes cryptographic software written by
+ *     Eric Young (eay@mincom.oz.au)"
+ *    The word 'cryptographic' can be left out if the rouines from the library
+ *    being used are not cryptographic related :-).
+ * 4. If you include any Windows specific code (or a derivative thereof) from 
+ *    the apps directory (application code) you must include an acknowledgement:
+ *    "This product includes software written by Tim Hudson (tjh@mincom.oz.au)"
+ * 
+ * THIS SOFTWARE IS PROVIDED BY ERIC YOUNG ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ * 
+ * The licence and distribution terms for any publically available version or
+ * derivative of this code cannot be changed.  i.e. this code cannot simply be
+ * copied and put under another distribution licence
+ * [including the GNU Public Licence.]
+ */
+
+#include "blowfish.h"
+#include "bf_locl.h"
+
+/* Kept apart from bf_enc.c so it is still available when BF_encrypt()
+ * comes from one of the asm/ versions. */
+
+#if (BF_ROUNDS != 16) && (BF_ROUNDS != 20)
+If you set BF_ROUNDS to some value other than 16 or 20, you will have
+to modify the code.
+#endif
+
+/* Four independent blocks at once, data[0..7] holding them as
+ * (l,r) pairs.  The rounds of the four blocks are interleaved so the
+ * S-box loads of one block overlap with those of the others instead
+ * of each round waiting on the previous one. */
+
+#define BF_ENC4(L,R,s,P) \
+	BF_ENC(L##0,R##0,s,P); \
+	BF_ENC(L##1,R##1,s,P); \
+	BF_ENC(L##2,R##2,s,P); \
+	BF_ENC(L##3,R##3,s,P);
+
+void BF_encrypt4(data,key,encrypt)
+BF_LONG *data;
+BF_KEY *key;
+int encrypt;
+	{
+	register BF_LONG l0,r0,l1,r1,l2,r2,l3,r3,*p,*s;
+
+	p=key->P;
+	s= &(key->S[0]);
+	l0=data[0]; r0=data[1];
+	l1=data[2]; r1=data[3];
+	l2=data[4]; r2=data[5];
+	l3=data[6]; r3=data[7];
+
+	if (encrypt)
+		{
+		l0^=p[0]; l1^=p[0]; l2^=p[0]; l3^=p[0];
+		BF_ENC4(r,l,s,p[ 1]);
+		BF_ENC4(l,r,s,p[ 2]);
+		BF_ENC4(r,l,s,p[ 3]);
+		BF_ENC4(l,r,s,p[ 4]);
+		BF_ENC4(r,l,s,p[ 5]);
+		BF_ENC4(l,r,s,p[ 6]);
+		BF_ENC4(r,l,s,p[ 7]);
+		BF_ENC4(l,r,s,p[ 8]);
+		BF_ENC4(r,l,s,p[ 9]);
+		BF_ENC4(l,r,s,p[10]);
+		BF_ENC4(r,l,s,p[11]);
+		BF_ENC4(l,r,s,p[12]);
+		BF_ENC4(r,l,s,p[13]);
+		BF_ENC4(l,r,s,p[14]);
+		BF_ENC4(r,l,s,p[15]);
+		BF_ENC4(l,r,s,p[16]);
+#if BF_ROUNDS == 20
+		BF_ENC4(r,l,s,p[17]);
+		BF_ENC4(l,r,s,p[18]);
+		BF_ENC4(r,l,s,p[19]);
+		BF_ENC4(l,r,s,p[20]);
+#endif
+		r0^=p[BF_ROUNDS+1]; r1^=p[BF_ROUNDS+1];
+		r2^=p[BF_ROUNDS+1]; r3^=p[BF_ROUNDS+1];
+		}
+	else
+		{
+		l0^=p[BF_ROUNDS+1]; l1^=p[BF_ROUNDS+1];
+		l2^=p[BF_ROUNDS+1]; l3^=p[BF_ROUNDS+1];
+#if BF_ROUNDS == 20
+		BF_ENC4(r,l,s,p[20]);
+		BF_ENC4(l,r,s,p[19]);
+		BF_ENC4(r,l,s,p[18]);
+		BF_ENC4(l,r,s,p[17]);
+#endif
+		BF_ENC4(r,l,s,p[16]);
+		BF_ENC4(l,r,s,p[15]);
+		BF_ENC4(r,l,s,p[14]);
+		BF_ENC4(l,r,s,p[13]);
+		BF_ENC4(r,l,s,p[12]);
+		BF_ENC4(l,r,s,p[11]);
+		BF_ENC4(r,l,s,p[10]);
+		BF_ENC4(l,r,s,p[ 9]);
+		BF_ENC4(r,l,s,p[ 8]);
+		BF_ENC4(l,r,s,p[ 7]);
+		BF_ENC4(r,l,s,p[ 6]);
+		BF_ENC4(l,r,s,p[ 5]);
+		BF_ENC4(r,l,s,p[ 4]);
+		BF_ENC4(l,r,s,p[ 3]);
+		BF_ENC4(r,l,s,p[ 2]);
+		BF_ENC4(l,r,s,p[ 1]);
+		r0^=p[0]; r1^=p[0]; r2^=p[0]; r3^=p[0];
+		}
+	data[1]=l0&0xffffffff; data[0]=r0&0xffffffff;
+	data[3]=l1&0xffffffff; data[2]=r1&0xffffffff;
+	data[5]=l2&0xffffffff; data[4]=r2&0xffffffff;
+	data[7]=l3&0xffffffff; data[6]=r3&0xffffffff;
+	}
@@ -87,12 +87,18 @@ void BF_set_key(BF_KEY *key, int len, unsigned char *data);
 void BF_ecb_encrypt(unsigned char *in,unsigned char *out,BF_KEY *key,
 	int encrypt);
 void BF_encrypt(BF_LONG *data,BF_KEY *key,int encrypt);
+void BF_encrypt4(BF_LONG *data,BF_KEY *key,int encrypt);
+void BF_ecb_encrypt_blocks(unsigned char *in,unsigned char *out,long length,
+	BF_KEY *key,int encrypt);
 void BF_cbc_encrypt(unsigned char *in, unsigned char *out, long length,
 	BF_KEY *ks, unsigned char *iv, int encrypt);
 void BF_cfb64_encrypt(unsigned char *in, unsigned char *out, long length,
 	BF_KEY *schedule, unsigned char *ivec, int *num, int encrypt);
 void BF_ofb64_encrypt(unsigned char *in, unsigned char *out, long length,
 	BF_KEY *schedule, unsigned char *ivec, int *num);
+void BF_ctr_encrypt(unsigned char *in, unsigned char *out, long length,
+	BF_KEY *schedule, unsigned char *ivec, unsigned char *ecount, int *num);
+void BF_ctr_add(unsigned char *ivec, unsigned long blocks);
 char *BF_options(void);
 
 #else
@@ -100,9 +106,13 @@ char *BF_options(void);
 void BF_set_key();
 void BF_ecb_encrypt();
 void BF_encrypt();
+void BF_encrypt4();
+void BF_ecb_encrypt_blocks();
 void BF_cbc_encrypt();
 void BF_cfb64_encrypt();
 void BF_ofb64_encrypt();
+void BF_ctr_encrypt();
+void BF_ctr_add();
 char *BF_options();
 
 #endif
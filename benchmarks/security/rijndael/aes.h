@@ -51,6 +51,20 @@
    aes_ret encrypt(const byte input_blk[], byte output_blk[], const aes *cx)
    aes_ret decrypt(const byte input_blk[], byte output_blk[], const aes *cx)
 
+   aes_ret encrypt_ecb(const byte in[], byte out[], unsigned long n_blocks,
+                       const aes *cx)
+   aes_ret decrypt_ecb(const byte in[], byte out[], unsigned long n_blocks,
+                       const aes *cx)
+   aes_ret crypt_ctr(const byte in[], byte out[], unsigned long n_bytes,
+                     byte counter[16], const aes *cx)
+   void    ctr_add(byte counter[16], unsigned long n_blocks)
+   int     aes_ni_available(void)
+
+   The multiple block calls use AES-NI when the processor has it and the
+   tables otherwise (16 byte blocks only for CTR and for AES-NI).  CTR
+   treats the counter as a 128-bit big endian number, advances it past
+   the blocks used and handles a partial final block.
+
    IMPORTANT NOTE: If you are using this C interface and your compiler does 
    not set the memory used for objects to zero before use, you will need to 
    ensure that cx.mode is set to zero before using the C subroutine calls.
@@ -221,7 +235,7 @@
 /* End of configuration options, but see also aes.c */
 
 typedef unsigned char   byte;           /* must be an 8-bit storage unit */
-typedef unsigned long   word;           /* must be a 32-bit storage unit */
+typedef unsigned int    word;           /* must be a 32-bit storage unit */
 typedef short           aes_ret;        /* function return value         */
 
 #define aes_bad     0
@@ -309,6 +323,14 @@ cf_dec c_name(encrypt)(const byte in_blk[], byte out_blk[], const c_name(aes) *c
 cf_dec c_name(decrypt)(const byte in_blk[], byte out_blk[], const c_name(aes) *cx);
 cf_dec c_name(set_blk)(const word n_bytes, c_name(aes) *cx);
 
+/* multiple block modes (aesmode.c) and the AES-NI backend (aes_ni.c)   */
+
+cf_dec c_name(encrypt_ecb)(const byte in[], byte out[], unsigned long n_blk, const c_name(aes) *cx);
+cf_dec c_name(decrypt_ecb)(const byte in[], byte out[], unsigned long n_blk, const c_name(aes) *cx);
+cf_dec c_name(crypt_ctr)(const byte in[], byte out[], unsigned long n_bytes, byte ctr[16], const c_name(aes) *cx);
+void ctr_add(byte ctr[16], unsigned long n_blk);
+int aes_ni_available(void);
+
 #if defined(__cplusplus)
 }
 
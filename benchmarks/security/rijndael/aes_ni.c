@@ -0,0 +1,218 @@
+
+ /*
+   -----------------------------------------------------------------------
+   Copyright (c) 2001 Dr Brian Gladman <brg@gladman.uk.net>, Worcester, UK
+   
+   TERMS
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   This software is provided 'as is' with no guarantees of correctness or
+   fitness for purpose.
+   -----------------------------------------------------------------------
+
+   AES-NI backend for the multiple block modes in aesmode.c
+
+   With INTERNAL_BYTE_ORDER and EXTERNAL_BYTE_ORDER both little endian
+   and a 32-bit word, the e_key[] schedule built by set_key() is held in
+   memory as the standard FIPS-197 round key byte sequence, and d_key[]
+   (the inverse mix columns of the reversed encryption schedule) is the
+   'equivalent inverse cipher' schedule that AESDEC expects. Both can
+   therefore be loaded straight into XMM registers, so one key schedule
+   serves both backends.
+
+   Eight blocks are kept in flight so that the four to eight cycle
+   latency of each AESENC/AESDEC is covered by the other seven.
+
+   The backend is only compiled for x86 with a GNU C compatible compiler
+   and a 16 byte block; elsewhere aes_ni_available() returns 0.
+ */
+
+#include "aes.h"
+
+#if defined(BLOCK_SIZE) && BLOCK_SIZE == 16 && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__)) && \
+    INTERNAL_BYTE_ORDER == AES_LITTLE_ENDIAN && EXTERNAL_BYTE_ORDER == AES_LITTLE_ENDIAN
+
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+#define AES_NI_TARGET __attribute__((target("aes,sse2,ssse3")))
+
+int aes_ni_available(void)
+{   static int  ok = -1;
+
+    if(ok < 0)
+    {
+        __builtin_cpu_init();
+        ok = __builtin_cpu_supports("aes") && __builtin_cpu_supports("ssse3");
+    }
+    return ok;
+}
+
+#define ld(p)       _mm_loadu_si128((const __m128i*)(p))
+#define st(p,v)     _mm_storeu_si128((__m128i*)(p), (v))
+
+/* apply one round to all eight lanes */
+
+#define rnd8(op,k)  b0 = op(b0,k); b1 = op(b1,k); b2 = op(b2,k); b3 = op(b3,k); \
+                    b4 = op(b4,k); b5 = op(b5,k); b6 = op(b6,k); b7 = op(b7,k)
+
+#define xor8(k)     b0 = _mm_xor_si128(b0,k); b1 = _mm_xor_si128(b1,k);          \
+                    b2 = _mm_xor_si128(b2,k); b3 = _mm_xor_si128(b3,k);          \
+                    b4 = _mm_xor_si128(b4,k); b5 = _mm_xor_si128(b5,k);          \
+                    b6 = _mm_xor_si128(b6,k); b7 = _mm_xor_si128(b7,k)
+
+AES_NI_TARGET
+static void load_keys(__m128i k[15], const word *ks, const word n_rnd)
+{   word    i;
+
+    for(i = 0; i <= n_rnd; ++i)
+        k[i] = ld(ks + 4 * i);
+}
+
+AES_NI_TARGET
+static __m128i enc1(__m128i b, const __m128i *k, const word n_rnd)
+{   word    i;
+
+    b = _mm_xor_si128(b, k[0]);
+    for(i = 1; i < n_rnd; ++i)
+        b = _mm_aesenc_si128(b, k[i]);
+    return _mm_aesenclast_si128(b, k[n_rnd]);
+}
+
+AES_NI_TARGET
+static __m128i dec1(__m128i b, const __m128i *k, const word n_rnd)
+{   word    i;
+
+    b = _mm_xor_si128(b, k[0]);
+    for(i = 1; i < n_rnd; ++i)
+        b = _mm_aesdec_si128(b, k[i]);
+    return _mm_aesdeclast_si128(b, k[n_rnd]);
+}
+
+/* ECB over n_blk whole blocks; f is enc or dec */
+
+AES_NI_TARGET
+void aes_ni_ecb(const byte in[], byte out[], unsigned long n_blk, const c_name(aes) *cx, const enum aes_key f)
+{   __m128i k[15], b0, b1, b2, b3, b4, b5, b6, b7;
+    word    i, n_rnd = cx->Nrnd;
+
+    load_keys(k, f == enc ? cx->e_key : cx->d_key, n_rnd);
+
+    for(; n_blk >= 8; n_blk -= 8, in += 128, out += 128)
+    {
+        b0 = ld(in);       b1 = ld(in + 16);  b2 = ld(in + 32);  b3 = ld(in + 48);
+        b4 = ld(in + 64);  b5 = ld(in + 80);  b6 = ld(in + 96);  b7 = ld(in + 112);
+        xor8(k[0]);
+        if(f == enc)
+        {
+            for(i = 1; i < n_rnd; ++i)
+            {
+                rnd8(_mm_aesenc_si128, k[i]);
+            }
+            rnd8(_mm_aesenclast_si128, k[n_rnd]);
+        }
+        else
+        {
+            for(i = 1; i < n_rnd; ++i)
+            {
+                rnd8(_mm_aesdec_si128, k[i]);
+            }
+            rnd8(_mm_aesdeclast_si128, k[n_rnd]);
+        }
+        st(out, b0);       st(out + 16, b1);  st(out + 32, b2);  st(out + 48, b3);
+        st(out + 64, b4);  st(out + 80, b5);  st(out + 96, b6);  st(out + 112, b7);
+    }
+
+    for(; n_blk; --n_blk, in += 16, out += 16)
+        st(out, f == enc ? enc1(ld(in), k, n_rnd) : dec1(ld(in), k, n_rnd));
+}
+
+/* CTR over n_bytes from the 128-bit big endian counter ctr, which is
+   left pointing at the block after the last one used               */
+
+AES_NI_TARGET
+void aes_ni_ctr(const byte in[], byte out[], unsigned long n_bytes, byte ctr[16], const c_name(aes) *cx)
+{   __m128i k[15], b0, b1, b2, b3, b4, b5, b6, b7, c;
+    byte    ks[16];
+    word    i, n_rnd = cx->Nrnd;
+    unsigned long long  lo;
+    const __m128i   bswap = _mm_set_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+    const __m128i   one = _mm_set_epi32(0, 0, 0, 1);
+
+    load_keys(k, cx->e_key, n_rnd);
+
+    /* the counter is kept byte reversed so that it can be stepped with */
+    /* a 64-bit add; lo shadows its low half to detect the carry into   */
+    /* the high half, which is only needed once in 2^64 blocks          */
+
+    c = _mm_shuffle_epi8(ld(ctr), bswap);
+    for(i = 8, lo = 0; i < 16; ++i)
+        lo = (lo << 8) | ctr[i];
+
+#define nxt(v)  v = _mm_shuffle_epi8(c, bswap); c = _mm_add_epi64(c, one); \
+                if(!++lo) c = _mm_add_epi64(c, _mm_slli_si128(one, 8))
+
+    for(; n_bytes >= 128; n_bytes -= 128, in += 128, out += 128)
+    {
+        nxt(b0); nxt(b1); nxt(b2); nxt(b3); nxt(b4); nxt(b5); nxt(b6); nxt(b7);
+        xor8(k[0]);
+        for(i = 1; i < n_rnd; ++i)
+        {
+            rnd8(_mm_aesenc_si128, k[i]);
+        }
+        rnd8(_mm_aesenclast_si128, k[n_rnd]);
+        st(out,       _mm_xor_si128(b0, ld(in)));
+        st(out + 16,  _mm_xor_si128(b1, ld(in + 16)));
+        st(out + 32,  _mm_xor_si128(b2, ld(in + 32)));
+        st(out + 48,  _mm_xor_si128(b3, ld(in + 48)));
+        st(out + 64,  _mm_xor_si128(b4, ld(in + 64)));
+        st(out + 80,  _mm_xor_si128(b5, ld(in + 80)));
+        st(out + 96,  _mm_xor_si128(b6, ld(in + 96)));
+        st(out + 112, _mm_xor_si128(b7, ld(in + 112)));
+    }
+
+    for(; n_bytes >= 16; n_bytes -= 16, in += 16, out += 16)
+    {
+        nxt(b0);
+        st(out, _mm_xor_si128(enc1(b0, k, n_rnd), ld(in)));
+    }
+
+    if(n_bytes)
+    {
+        nxt(b0);
+        st(ks, enc1(b0, k, n_rnd));
+        for(i = 0; i < n_bytes; ++i)
+            out[i] = in[i] ^ ks[i];
+    }
+
+#undef nxt
+
+    st(ctr, _mm_shuffle_epi8(c, bswap));
+}
+
+#else
+
+int aes_ni_available(void)
+{
+    return 0;
+}
+
+void aes_ni_ecb(const byte in[], byte out[], unsigned long n_blk, const c_name(aes) *cx, const enum aes_key f)
+{
+}
+
+void aes_ni_ctr(const byte in[], byte out[], unsigned long n_bytes, byte ctr[16], const c_name(aes) *cx)
+{
+}
+
+#endif
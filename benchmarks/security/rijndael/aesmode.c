@@ -0,0 +1,132 @@
+
+ /*
+   -----------------------------------------------------------------------
+   Copyright (c) 2001 Dr Brian Gladman <brg@gladman.uk.net>, Worcester, UK
+   
+   TERMS
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+   1. Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+   2. Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+
+   This software is provided 'as is' with no guarantees of correctness or
+   fitness for purpose.
+   -----------------------------------------------------------------------
+
+   Multiple block ECB and CTR modes
+
+   These run many blocks per call, using the AES-NI backend in aes_ni.c
+   when the processor has it and the table driven encrypt() / decrypt()
+   in aes.c otherwise. The choice is made at run time, once.
+
+   CTR mode uses the whole 16 byte block as a big endian counter that is
+   incremented once per block.  Since no block depends on another, a long
+   message can be split at any block boundary and the pieces processed in
+   parallel, each starting from a counter advanced with ctr_add().
+ */
+
+#include <memory.h>
+#include <pthread.h>
+
+#include "aes.h"
+
+void aes_ni_ecb(const byte in[], byte out[], unsigned long n_blk, const c_name(aes) *cx, const enum aes_key f);
+void aes_ni_ctr(const byte in[], byte out[], unsigned long n_bytes, byte ctr[16], const c_name(aes) *cx);
+
+/* the number of counter blocks generated per pass by the table code */
+
+#define CTR_BATCH   4
+
+/* the calls below may run on several threads at once (see run_pieces()
+   in aesxam.c), so the backend is chosen under pthread_once()          */
+
+static int              ni;
+static pthread_once_t   ni_once = PTHREAD_ONCE_INIT;
+
+static void ni_init(void)
+{
+    ni = (BLOCK_SIZE == 16) && aes_ni_available();
+}
+
+static int use_ni(void)
+{
+    pthread_once(&ni_once, ni_init);
+    return ni;
+}
+
+void ctr_add(byte ctr[16], unsigned long n_blk)
+{   int     i;
+    unsigned long   carry = n_blk;
+
+    for(i = 15; i >= 0 && carry; --i)
+    {
+        carry += ctr[i];
+        ctr[i] = (byte)carry;
+        carry >>= 8;
+    }
+}
+
+cf_dec c_name(encrypt_ecb)(const byte in[], byte out[], unsigned long n_blk, const c_name(aes) *cx)
+{
+    if(!(cx->mode & 0x01)) return aes_bad;
+
+    if(use_ni())
+        aes_ni_ecb(in, out, n_blk, cx, enc);
+    else
+        for(; n_blk; --n_blk, in += BLOCK_SIZE, out += BLOCK_SIZE)
+            c_name(encrypt)(in, out, cx);
+
+    return aes_good;
+}
+
+cf_dec c_name(decrypt_ecb)(const byte in[], byte out[], unsigned long n_blk, const c_name(aes) *cx)
+{
+    if(!(cx->mode & 0x02)) return aes_bad;
+
+    if(use_ni())
+        aes_ni_ecb(in, out, n_blk, cx, dec);
+    else
+        for(; n_blk; --n_blk, in += BLOCK_SIZE, out += BLOCK_SIZE)
+            c_name(decrypt)(in, out, cx);
+
+    return aes_good;
+}
+
+cf_dec c_name(crypt_ctr)(const byte in[], byte out[], unsigned long n_bytes, byte ctr[16], const c_name(aes) *cx)
+{   byte    cb[CTR_BATCH * 16], ks[CTR_BATCH * 16];
+    unsigned long   i, n;
+
+    if(!(cx->mode & 0x01) || BLOCK_SIZE != 16) return aes_bad;
+
+    if(use_ni())
+    {
+        aes_ni_ctr(in, out, n_bytes, ctr, cx);
+        return aes_good;
+    }
+
+    while(n_bytes)
+    {
+        n = n_bytes < sizeof(ks) ? n_bytes : sizeof(ks);
+
+        for(i = 0; i < n; i += 16)          /* lay out the counters     */
+        {
+            memcpy(cb + i, ctr, 16);
+            ctr_add(ctr, 1);
+        }
+
+        for(i = 0; i < n; i += 16)          /* and encrypt them         */
+            c_name(encrypt)(cb + i, ks + i, cx);
+
+        for(i = 0; i < n; ++i)
+            out[i] = in[i] ^ ks[i];
+
+        in += n; out += n; n_bytes -= n;
+    }
+
+    return aes_good;
+}
@@ -35,14 +35,34 @@
 /* aesxam file.enc file2.c D 0123456789abcdeffedcba9876543210   */
 /*                                                              */
 /* which should return a file 'file2.c' identical to 'file.c'   */
+/*                                                              */
+/* An optional fifth argument selects the mode: CBC (the above  */
+/* format, the default), CTR (a 16 byte initial counter then    */
+/* the cipher text, the same length as the plain text) or ECB   */
+/* (PKCS#7 padded). An optional sixth argument sets the number  */
+/* of threads used for CTR and ECB, which otherwise defaults to */
+/* the number of processors.                                    */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <memory.h>
+#include <string.h>
 #include <ctype.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "aes.h"
 
+/* File I/O is done IO_BUF bytes at a time; in CTR and ECB modes each */
+/* buffer is shared among up to MAX_THREADS threads, but only when    */
+/* each thread gets at least MIN_PIECE bytes                          */
+
+#define IO_BUF      (4L * 1024 * 1024)
+#define MIN_PIECE   (64L * 1024)
+#define MAX_THREADS 64
+
+enum file_mode { cbc, ctr, ecb };
+
 /* A Pseudo Random Number Generator (PRNG) used for the     */
 /* Initialisation Vector. The PRNG is George Marsaglia's    */
 /* Multiply-With-Carry (MWC) PRNG that concatenates two     */
@@ -74,6 +94,7 @@
 void fillrand(char *buf, int len)
 {   static unsigned long a[2], mt = 1, count = 4;
     static char          r[4];
+    unsigned int         v;
     int                  i;
 
     if(mt) { 
@@ -87,7 +108,8 @@ void fillrand(char *buf, int len)
     {
         if(count == 4)
         {
-            *(unsigned long*)r = RAND(a[0], a[1]);
+            v = (unsigned int)RAND(a[0], a[1]);   /* 4 bytes, even on LP64 */
+            memcpy(r, &v, 4);
             count = 0;
         }
 
@@ -97,12 +119,12 @@ void fillrand(char *buf, int len)
 
 int encfile(FILE *fin, FILE *fout, aes *ctx, char* fn)
 {   char            inbuf[16], outbuf[16];
-    fpos_t          flen;
+    long            flen;
     unsigned long   i=0, l=0;
 
     fillrand(outbuf, 16);           /* set an IV for CBC mode           */
     fseek(fin, 0, SEEK_END);        /* get the length of the file       */
-    fgetpos(fin, &flen);            /* and then reset to start          */
+    flen = ftell(fin);              /* and then reset to start          */
     fseek(fin, 0, SEEK_SET);        
     fwrite(outbuf, 1, 16, fout);    /* write the IV to the output       */
     fillrand(inbuf, 1);             /* make top 4 bits of a byte random */
@@ -231,18 +253,188 @@ int decfile(FILE *fin, FILE *fout, aes *ctx, char* ifn, char* ofn)
     return 0;
 }
 
+/* one thread's share of a buffer in CTR or ECB mode */
+
+typedef struct
+{   const byte      *in;
+    byte            *out;
+    unsigned long   len;
+    byte            ctr[16];
+    enum file_mode  mode;
+    int             encr;
+    const aes       *ctx;
+} piece;
+
+static void *do_piece(void *arg)
+{   piece   *p = (piece*)arg;
+
+    if(p->mode == ctr)
+        crypt_ctr(p->in, p->out, p->len, p->ctr, p->ctx);
+    else if(p->encr)
+        encrypt_ecb(p->in, p->out, p->len / 16, p->ctx);
+    else
+        decrypt_ecb(p->in, p->out, p->len / 16, p->ctx);
+    return 0;
+}
+
+/* process len bytes of buf in place, split over up to n_thr threads; */
+/* in CTR mode cv is the counter for the start of the buffer and is   */
+/* advanced past it                                                   */
+
+static void run_pieces(byte *buf, unsigned long len, byte cv[16],
+                       enum file_mode mode, int encr, const aes *ctx, int n_thr)
+{   piece           p[MAX_THREADS];
+    pthread_t       tid[MAX_THREADS];
+    unsigned long   n_blk = (len + 15) / 16, per, off = 0;
+    int             t, n = n_thr > MAX_THREADS ? MAX_THREADS : n_thr;
+
+    while(n > 1 && len / n < MIN_PIECE)
+        --n;
+    per = 16 * ((n_blk + n - 1) / n);
+
+    for(t = 0; t < n && off < len; ++t)
+    {
+        p[t].in = p[t].out = buf + off;
+        p[t].len = off + per > len ? len - off : per;
+        p[t].mode = mode; p[t].encr = encr; p[t].ctx = ctx;
+        memcpy(p[t].ctr, cv, 16);
+        ctr_add(p[t].ctr, off / 16);
+        off += p[t].len;
+        if(t)
+            pthread_create(tid + t, 0, do_piece, p + t);
+    }
+
+    n = t;
+    if(n)
+        do_piece(p);
+    for(t = 1; t < n; ++t)
+        pthread_join(tid[t], 0);
+
+    if(mode == ctr)
+        ctr_add(cv, n_blk);
+}
+
+/* CTR or ECB encryption or decryption of a whole file */
+
+int blkfile(FILE *fin, FILE *fout, aes *ctx, enum file_mode mode, int encr,
+            int n_thr, char* ifn, char* ofn)
+{   byte            *buf, cv[16];
+    unsigned long   len, pad;
+    int             c, last, err = 0;
+
+    if(!(buf = (byte*)malloc(IO_BUF + 16)))
+    {
+        printf("Out of memory\n");
+        return -13;
+    }
+
+    if(mode == ctr)
+    {
+        if(encr)                        /* write the initial counter    */
+        {
+            fillrand((char*)cv, 16);
+            if(fwrite(cv, 1, 16, fout) != 16)
+            {
+                printf("Error writing to output file: %s\n", ofn);
+                err = -7; goto done;
+            }
+        }
+        else if(fread(cv, 1, 16, fin) != 16)
+        {
+            printf("Error reading from input file: %s\n", ifn);
+            err = 9; goto done;
+        }
+    }
+
+    /* for ECB at least one (padding) block is always output when      */
+    /* encrypting, so the loop runs once even for an empty file        */
+
+    do
+    {
+        len = fread(buf, 1, IO_BUF, fin);
+
+        if((c = getc(fin)) == EOF)      /* look ahead for the last      */
+            last = 1;                   /* buffer, which holds the pad  */
+        else
+        {
+            ungetc(c, fin);
+            last = 0;
+        }
+
+        if(mode == ecb)
+        {
+            if(encr && last)
+            {
+                pad = 16 - (len & 15);
+                memset(buf + len, (int)pad, pad);
+                len += pad;
+            }
+            else if((len & 15) || (last && !len))
+            {                           /* ciphertext is a non-zero     */
+                                        /* number of whole blocks       */
+                printf("\nThe input file is corrupt");
+                err = -10; goto done;
+            }
+        }
+
+        run_pieces(buf, len, cv, mode, encr, ctx, n_thr);
+
+        if(mode == ecb && !encr && last)
+        {
+            pad = buf[len - 1];
+            if(pad < 1 || pad > 16)
+            {
+                printf("\nThe input file is corrupt");
+                err = -10; goto done;
+            }
+            len -= pad;
+        }
+
+        if(fwrite(buf, 1, len, fout) != len)
+        {
+            printf("Error writing to output file: %s\n", ofn);
+            err = -11; goto done;
+        }
+    }
+    while(!last);
+
+done:
+    free(buf);
+    return err;
+}
+
 int main(int argc, char *argv[])
 {   FILE    *fin = 0, *fout = 0;
     char    *cp, ch, key[32];
-    int     i=0, by=0, key_len=0, err = 0;
+    int     i=0, by=0, key_len=0, err = 0, n_thr;
+    enum file_mode  mode = cbc;
     aes     ctx[1];
 
-    if(argc != 5 || (toupper(*argv[3]) != 'D' && toupper(*argv[3]) != 'E'))
+    ctx->mode = 0;
+
+    if(argc < 5 || argc > 7 || (toupper(*argv[3]) != 'D' && toupper(*argv[3]) != 'E'))
     {
-        printf("usage: rijndael in_filename out_filename [d/e] key_in_hex\n"); 
+        printf("usage: rijndael in_filename out_filename [d/e] key_in_hex [cbc/ctr/ecb] [threads]\n"); 
         err = -1; goto exit;
     }
 
+    if(argc > 5)
+    {
+        if(toupper(argv[5][0]) == 'C' && toupper(argv[5][1]) == 'T')
+            mode = ctr;
+        else if(toupper(argv[5][0]) == 'E')
+            mode = ecb;
+        else if(toupper(argv[5][0]) != 'C')
+        {
+            printf("the mode must be cbc, ctr or ecb\n");
+            err = -1; goto exit;
+        }
+    }
+
+    n_thr = argc > 6 ? atoi(argv[6]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(n_thr < 1)
+        n_thr = 1;
+
     cp = argv[4];   /* this is a pointer to the hexadecimal key digits  */
     i = 0;          /* this is a count for the input digits processed   */
     
@@ -289,17 +481,31 @@ int main(int argc, char *argv[])
         err = -6; goto exit;
     }
 
-    if(toupper(*argv[3]) == 'E')
-    {                           /* encryption in Cipher Block Chaining mode */
-        set_key(key, key_len, enc, ctx);
+    if(mode != cbc)
+    {                           /* counter mode only ever encrypts blocks   */
+        set_key(key, key_len, mode == ctr || toupper(*argv[3]) == 'E' ? enc : dec, ctx);
 
-        err = encfile(fin, fout, ctx, argv[1]);
+        err = blkfile(fin, fout, ctx, mode, toupper(*argv[3]) == 'E', n_thr, argv[1], argv[2]);
     }
     else
-    {                           /* decryption in Cipher Block Chaining mode */
-        set_key(key, key_len, dec, ctx);
+    {                           /* CBC moves 16 bytes per call, so give the */
+                                /* streams big buffers to avoid a system    */
+                                /* call for every block                     */
+        setvbuf(fin, 0, _IOFBF, IO_BUF);
+        setvbuf(fout, 0, _IOFBF, IO_BUF);
+
+        if(toupper(*argv[3]) == 'E')
+        {                       /* encryption in Cipher Block Chaining mode */
+            set_key(key, key_len, enc, ctx);
+
+            err = encfile(fin, fout, ctx, argv[1]);
+        }
+        else
+        {                       /* decryption in Cipher Block Chaining mode */
+            set_key(key, key_len, dec, ctx);
     
-        err = decfile(fin, fout, ctx, argv[1], argv[2]);
+            err = decfile(fin, fout, ctx, argv[1], argv[2]);
+        }
     }
 exit:   
     if(fout) 
@@ -250,3 +250,216 @@ adpcm_decoder(indata, outdata, len, state)
     state->valprev = valpred;
     state->index = index;
 }
+
+/*
+** Block-framed (IMA/DVI as in WAV format tag 0x11) coder and decoder.
+**
+** Every block starts, for each channel, with a 4 byte header holding
+** the first sample (16 bit little-endian) and the step index, so blocks
+** can be coded and decoded independently of each other. The header is
+** followed by 4 byte groups of 8 samples per channel, channels
+** interleaved group by group and the low nibble holding the earlier
+** sample. The per-sample steps are the same as in adpcm_coder and
+** adpcm_decoder above.
+*/
+
+static int
+block_encode_sample(val, valpredp, indexp)
+    int val;
+    int *valpredp;
+    int *indexp;
+{
+    int valpred = *valpredp;
+    int index = *indexp;
+    int step = stepsizeTable[index];
+    int diff, sign, delta, vpdiff;
+
+    diff = val - valpred;
+    sign = (diff < 0) ? 8 : 0;
+    if ( sign ) diff = (-diff);
+
+    delta = 0;
+    vpdiff = (step >> 3);
+    if ( diff >= step ) {
+	delta = 4;
+	diff -= step;
+	vpdiff += step;
+    }
+    step >>= 1;
+    if ( diff >= step ) {
+	delta |= 2;
+	diff -= step;
+	vpdiff += step;
+    }
+    step >>= 1;
+    if ( diff >= step ) {
+	delta |= 1;
+	vpdiff += step;
+    }
+
+    if ( sign )
+      valpred -= vpdiff;
+    else
+      valpred += vpdiff;
+    if ( valpred > 32767 )
+      valpred = 32767;
+    else if ( valpred < -32768 )
+      valpred = -32768;
+
+    delta |= sign;
+    index += indexTable[delta];
+    if ( index < 0 ) index = 0;
+    if ( index > 88 ) index = 88;
+
+    *valpredp = valpred;
+    *indexp = index;
+    return delta;
+}
+
+static int
+block_decode_sample(delta, valpredp, indexp)
+    int delta;
+    int *valpredp;
+    int *indexp;
+{
+    int step = stepsizeTable[*indexp];
+    int valpred = *valpredp;
+    int index = *indexp + indexTable[delta];
+    int vpdiff;
+
+    if ( index < 0 ) index = 0;
+    if ( index > 88 ) index = 88;
+
+    vpdiff = step >> 3;
+    if ( delta & 4 ) vpdiff += step;
+    if ( delta & 2 ) vpdiff += step>>1;
+    if ( delta & 1 ) vpdiff += step>>2;
+    if ( delta & 8 )
+      valpred -= vpdiff;
+    else
+      valpred += vpdiff;
+    if ( valpred > 32767 )
+      valpred = 32767;
+    else if ( valpred < -32768 )
+      valpred = -32768;
+
+    *valpredp = valpred;
+    *indexp = index;
+    return valpred;
+}
+
+/*
+** Samples per channel in a block of blockalign bytes, or 0 if
+** blockalign is not a whole number of 4 byte groups per channel.
+*/
+int
+adpcm_block_samples(blockalign, channels)
+    int blockalign;
+    int channels;
+{
+    if ( channels < 1 || blockalign % (4*channels) != 0 ||
+	 blockalign / channels < 8 )
+      return 0;
+    return (blockalign / channels - 4) * 2 + 1;
+}
+
+/*
+** A block cannot inherit the step index of the block before it, so the
+** coder starts from the index whose step best fits the first few
+** sample differences rather than from 0.
+*/
+static int
+block_start_index(indata, nsamples, channels)
+    short indata[];
+    int nsamples;
+    int channels;
+{
+    int i, n, sum = 0, index = 0;
+
+    n = nsamples < 9 ? nsamples : 9;
+    for ( i = 1; i < n; i++ ) {
+	int d = indata[i*channels] - indata[(i-1)*channels];
+	sum += d < 0 ? -d : d;
+    }
+    if ( n > 1 )
+      sum /= n - 1;
+    while ( index < 88 && stepsizeTable[index] < sum )
+      index++;
+    return index;
+}
+
+/*
+** Code nsamples (per channel, at most adpcm_block_samples) interleaved
+** samples into one block of blockalign bytes. A short final block is
+** padded by repeating its last sample.
+*/
+void
+adpcm_block_coder(indata, nsamples, channels, outdata, blockalign)
+    short indata[];
+    int nsamples;
+    int channels;
+    char outdata[];
+    int blockalign;
+{
+    int spb = adpcm_block_samples(blockalign, channels);
+    unsigned char *outp = (unsigned char *)outdata;
+    int ch, i;
+
+    for ( ch = 0; ch < channels; ch++ ) {
+	short *inp = indata + ch;
+	int valpred = inp[0];
+	int index = block_start_index(inp, nsamples, channels);
+
+	outp[4*ch] = valpred & 0xff;
+	outp[4*ch+1] = (valpred >> 8) & 0xff;
+	outp[4*ch+2] = index;
+	outp[4*ch+3] = 0;
+
+	for ( i = 1; i < spb; i++ ) {
+	    int k = i - 1;		/* nibble number */
+	    unsigned char *b = outp + 4*channels + (k/8)*4*channels
+		+ 4*ch + (k%8)/2;
+	    int val = inp[(i < nsamples ? i : nsamples - 1) * channels];
+	    int delta = block_encode_sample(val, &valpred, &index);
+
+	    if ( k & 1 )
+	      *b |= delta << 4;
+	    else
+	      *b = delta;
+	}
+    }
+}
+
+/*
+** Decode one block of blockalign bytes into nsamples (per channel, at
+** most adpcm_block_samples) interleaved samples.
+*/
+void
+adpcm_block_decoder(indata, blockalign, channels, outdata, nsamples)
+    char indata[];
+    int blockalign;
+    int channels;
+    short outdata[];
+    int nsamples;
+{
+    unsigned char *inp = (unsigned char *)indata;
+    int ch, i;
+
+    for ( ch = 0; ch < channels; ch++ ) {
+	short *outp = outdata + ch;
+	int valpred = (short)(inp[4*ch] | (inp[4*ch+1] << 8));
+	int index = inp[4*ch+2];
+
+	if ( index > 88 ) index = 88;
+	if ( nsamples > 0 )
+	  outp[0] = valpred;
+	for ( i = 1; i < nsamples; i++ ) {
+	    int k = i - 1;
+	    unsigned char b = inp[4*channels + (k/8)*4*channels
+				  + 4*ch + (k%8)/2];
+	    int delta = (k & 1) ? b >> 4 : b & 0x0f;
+
+	    outp[i*channels] = block_decode_sample(delta, &valpred, &index);
+	}
+    }
+}
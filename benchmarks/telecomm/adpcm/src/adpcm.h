@@ -17,3 +17,8 @@ struct adpcm_state {
 
 void adpcm_coder ARGS((short [], char [], int, struct adpcm_state *));
 void adpcm_decoder ARGS((char [], short [], int, struct adpcm_state *));
+
+/* Block-framed IMA/DVI ADPCM, as in WAV (format tag 0x11) */
+int adpcm_block_samples ARGS((int, int));
+void adpcm_block_coder ARGS((short [], int, int, char [], int));
+void adpcm_block_decoder ARGS((char [], int, int, short [], int));
@@ -0,0 +1,241 @@
+/*
+** adpcmio.c - whole-file I/O and threading for the block-framed
+** (WAV IMA-ADPCM) modes of rawcaudio and rawdaudio.
+**
+** The block modes read their whole input at once (mapped when it is a
+** regular file), have each thread code its own run of blocks straight
+** into one output buffer at the blocks' final offsets, and write that
+** buffer with as few write calls as the kernel allows.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "adpcmio.h"
+
+char *
+load_input(int fd, size_t *len, int *mapped)
+{
+    struct stat st;
+    char *buf;
+    size_t have = 0, size;
+    ssize_t n;
+
+    *mapped = 0;
+    if ( fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 ) {
+	buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if ( buf != MAP_FAILED ) {
+	    madvise(buf, st.st_size, MADV_SEQUENTIAL);
+	    *mapped = 1;
+	    *len = st.st_size;
+	    return buf;
+	}
+    }
+
+    /* Pipe or unmappable file: read it all */
+    size = 1 << 20;
+    if ( (buf = malloc(size)) == NULL )
+      return NULL;
+    while ( (n = read(fd, buf + have, size - have)) > 0 ) {
+	have += n;
+	if ( have == size ) {
+	    char *p = realloc(buf, size *= 2);
+	    if ( p == NULL ) {
+		free(buf);
+		return NULL;
+	    }
+	    buf = p;
+	}
+    }
+    if ( n < 0 ) {
+	free(buf);
+	return NULL;
+    }
+    *len = have;
+    return buf;
+}
+
+void
+release_input(char *buf, size_t len, int mapped)
+{
+    if ( mapped )
+      munmap(buf, len);
+    else
+      free(buf);
+}
+
+int
+write_all(int fd, const char *buf, size_t len)
+{
+    while ( len > 0 ) {
+	ssize_t n = write(fd, buf, len);
+	if ( n <= 0 )
+	  return -1;
+	buf += n;
+	len -= n;
+    }
+    return 0;
+}
+
+int
+default_threads(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+struct block_run {
+    block_fn	fn;
+    void	*arg;
+    long	first, last;
+};
+
+static void *
+block_thread(void *p)
+{
+    struct block_run *r = p;
+
+    r->fn(r->arg, r->first, r->last);
+    return NULL;
+}
+
+/*
+** Split blocks [0, nblocks) into one contiguous run per thread. The
+** calling thread takes the first run.
+*/
+void
+run_blocks(long nblocks, int threads, block_fn fn, void *arg)
+{
+    struct block_run *runs;
+    pthread_t *tids;
+    int t, started;
+
+    if ( threads > nblocks )
+      threads = nblocks > 0 ? nblocks : 1;
+    runs = malloc(threads * sizeof(*runs));
+    tids = malloc(threads * sizeof(*tids));
+    if ( threads <= 1 || runs == NULL || tids == NULL ) {
+	free(runs);
+	free(tids);
+	fn(arg, 0, nblocks);
+	return;
+    }
+    for ( t = 0; t < threads; t++ ) {
+	runs[t].fn = fn;
+	runs[t].arg = arg;
+	runs[t].first = nblocks * t / threads;
+	runs[t].last = nblocks * (t + 1) / threads;
+    }
+    for ( started = 1; started < threads; started++ )
+      if ( pthread_create(&tids[started], NULL, block_thread,
+			  &runs[started]) != 0 )
+	break;
+    /* Runs whose thread could not be started are done here */
+    for ( t = started; t < threads; t++ )
+      block_thread(&runs[t]);
+    block_thread(&runs[0]);
+    for ( t = 1; t < started; t++ )
+      pthread_join(tids[t], NULL);
+    free(runs);
+    free(tids);
+}
+
+static void
+put16(unsigned char *p, long v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+}
+
+static void
+put32(unsigned char *p, long v)
+{
+    put16(p, v);
+    put16(p + 2, v >> 16);
+}
+
+static long
+get16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static long
+get32(const unsigned char *p)
+{
+    return get16(p) | (get16(p + 2) << 16);
+}
+
+/*
+** Fill in the WAV_IMA_HEADER bytes preceding w->datalen bytes of blocks.
+*/
+void
+wav_ima_header(const struct wav_ima *w, unsigned char *hdr)
+{
+    memcpy(hdr, "RIFF", 4);
+    put32(hdr + 4, WAV_IMA_HEADER - 8 + w->datalen);
+    memcpy(hdr + 8, "WAVEfmt ", 8);
+    put32(hdr + 16, 20);
+    put16(hdr + 20, 0x11);			/* IMA ADPCM */
+    put16(hdr + 22, w->channels);
+    put32(hdr + 24, w->rate);
+    put32(hdr + 28, w->rate * w->blockalign / w->samplesperblock);
+    put16(hdr + 32, w->blockalign);
+    put16(hdr + 34, 4);
+    put16(hdr + 36, 2);
+    put16(hdr + 38, w->samplesperblock);
+    memcpy(hdr + 40, "fact", 4);
+    put32(hdr + 44, 4);
+    put32(hdr + 48, w->samples);
+    memcpy(hdr + 52, "data", 4);
+    put32(hdr + 56, w->datalen);
+}
+
+/*
+** Parse a WAV IMA-ADPCM file. Returns the offset of the block data, or
+** -1 if this is not one.
+*/
+long
+wav_ima_parse(const unsigned char *buf, size_t len, struct wav_ima *w)
+{
+    size_t pos = 12;
+    int havefmt = 0;
+
+    if ( len < 12 || memcmp(buf, "RIFF", 4) || memcmp(buf + 8, "WAVE", 4) )
+      return -1;
+    w->samples = -1;
+    while ( pos + 8 <= len ) {
+	size_t size = (unsigned long)get32(buf + pos + 4);
+	const unsigned char *body = buf + pos + 8;
+
+	if ( !memcmp(buf + pos, "fmt ", 4) && size >= 20 && pos + 28 <= len ) {
+	    if ( get16(body) != 0x11 || get16(body + 14) != 4 )
+	      return -1;
+	    w->channels = get16(body + 2);
+	    w->rate = get32(body + 4);
+	    w->blockalign = get16(body + 12);
+	    w->samplesperblock = get16(body + 18);
+	    if ( w->channels < 1 || w->blockalign < 1 )
+	      return -1;
+	    havefmt = 1;
+	} else if ( !memcmp(buf + pos, "fact", 4) && size >= 4 &&
+		    pos + 12 <= len ) {
+	    w->samples = get32(body);
+	} else if ( !memcmp(buf + pos, "data", 4) ) {
+	    if ( !havefmt )
+	      return -1;
+	    w->datalen = size < len - pos - 8 ? size : len - pos - 8;
+	    w->datalen -= w->datalen % w->blockalign;
+	    if ( w->samples < 0 )
+	      w->samples = w->datalen / w->blockalign * w->samplesperblock;
+	    return pos + 8;
+	}
+	pos += 8 + size + (size & 1);
+    }
+    return -1;
+}
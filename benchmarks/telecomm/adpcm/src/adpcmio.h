@@ -0,0 +1,27 @@
+/*
+** adpcmio.h - whole-file I/O and threading for the block-framed
+** (WAV IMA-ADPCM) modes of rawcaudio and rawdaudio.
+*/
+
+#include <stddef.h>
+
+#define WAV_IMA_HEADER	60	/* RIFF + fmt (20) + fact + data headers */
+
+struct wav_ima {
+    int		channels;
+    long	rate;
+    int		blockalign;
+    int		samplesperblock;
+    long	samples;	/* per channel, from the fact chunk */
+    long	datalen;	/* bytes of block data */
+};
+
+typedef void (*block_fn)(void *arg, long first, long last);
+
+char *load_input(int fd, size_t *len, int *mapped);
+void release_input(char *buf, size_t len, int mapped);
+int write_all(int fd, const char *buf, size_t len);
+void run_blocks(long nblocks, int threads, block_fn fn, void *arg);
+int default_threads(void);
+void wav_ima_header(const struct wav_ima *w, unsigned char *hdr);
+long wav_ima_parse(const unsigned char *buf, size_t len, struct wav_ima *w);
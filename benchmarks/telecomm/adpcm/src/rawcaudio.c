@@ -1,7 +1,11 @@
 /* testc - Test adpcm coder */
 
 #include "adpcm.h"
+#include "adpcmio.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 struct adpcm_state state;
 
@@ -10,8 +14,124 @@ struct adpcm_state state;
 char	abuf[NSAMPLES/2];
 short	sbuf[NSAMPLES];
 
-main() {
-    int n;
+/*
+** -w: write block-framed WAV IMA-ADPCM instead of a raw stream.
+** Blocks are independent, so they are coded by several threads.
+*/
+struct block_job {
+    short	*pcm;
+    long	nsamples;	/* per channel */
+    unsigned char *out;		/* first block */
+    int		channels;
+    int		blockalign;
+    int		spb;
+};
+
+static void
+code_blocks(void *arg, long first, long last)
+{
+    struct block_job *job = arg;
+    long b;
+
+    for ( b = first; b < last; b++ ) {
+	long start = b * job->spb;
+	long n = job->nsamples - start;
+
+	adpcm_block_coder(job->pcm + start * job->channels,
+			  n < job->spb ? (int)n : job->spb, job->channels,
+			  (char *)job->out + b * job->blockalign,
+			  job->blockalign);
+    }
+}
+
+static int
+block_main(int channels, long rate, int blockalign, int threads)
+{
+    struct block_job job;
+    struct wav_ima w;
+    unsigned char *out;
+    char *in;
+    size_t len;
+    long nblocks;
+    int mapped;
+
+    job.spb = adpcm_block_samples(blockalign, channels);
+    if ( job.spb == 0 || job.spb > 65535 ) {
+	fprintf(stderr, "block size %d must be a multiple of %d\n",
+		blockalign, 4*channels);
+	exit(1);
+    }
+    if ( (in = load_input(0, &len, &mapped)) == NULL ) {
+	perror("input file");
+	exit(1);
+    }
+    job.pcm = (short *)in;
+    job.nsamples = len / (2 * channels);
+    job.channels = channels;
+    job.blockalign = blockalign;
+    nblocks = (job.nsamples + job.spb - 1) / job.spb;
+
+    w.channels = channels;
+    w.rate = rate;
+    w.blockalign = blockalign;
+    w.samplesperblock = job.spb;
+    w.samples = job.nsamples;
+    w.datalen = nblocks * blockalign;
+    if ( (out = malloc(WAV_IMA_HEADER + w.datalen)) == NULL ) {
+	perror("output buffer");
+	exit(1);
+    }
+    wav_ima_header(&w, out);
+    job.out = out + WAV_IMA_HEADER;
+    run_blocks(nblocks, threads, code_blocks, &job);
+
+    if ( write_all(1, (char *)out, WAV_IMA_HEADER + w.datalen) < 0 ) {
+	perror("output file");
+	exit(1);
+    }
+    fprintf(stderr, "Coded %ld samples x %d channels in %ld blocks\n",
+	    job.nsamples, channels, nblocks);
+    release_input(in, len, mapped);
+    free(out);
+    return 0;
+}
+
+static void
+usage(void)
+{
+    fprintf(stderr, "usage: rawcaudio [-w [-b blockalign] [-c channels] "
+	    "[-r rate] [-t threads]]\n");
+    exit(1);
+}
+
+main(int argc, char *argv[]) {
+    int n, i;
+    int blocks = 0, channels = 1, blockalign = 0, threads = 0;
+    long rate = 8000;
+
+    for ( i = 1; i < argc; i++ ) {
+	if ( !strcmp(argv[i], "-w") )
+	  blocks = 1;
+	else if ( i + 1 >= argc )
+	  usage();
+	else if ( !strcmp(argv[i], "-b") )
+	  blockalign = atoi(argv[++i]);
+	else if ( !strcmp(argv[i], "-c") )
+	  channels = atoi(argv[++i]);
+	else if ( !strcmp(argv[i], "-r") )
+	  rate = atol(argv[++i]);
+	else if ( !strcmp(argv[i], "-t") )
+	  threads = atoi(argv[++i]);
+	else
+	  usage();
+    }
+    if ( blocks ) {
+	if ( channels < 1 || rate < 1 )
+	  usage();
+	return block_main(channels, rate,
+			  blockalign > 0 ? blockalign : 256 * channels,
+			  threads > 0 ? threads : default_threads());
+    }
 
     while(1) {
 	n = read(0, sbuf, NSAMPLES*2);
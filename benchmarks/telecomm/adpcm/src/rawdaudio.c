@@ -1,7 +1,11 @@
 /* testd - Test adpcm decoder */
 
 #include "adpcm.h"
+#include "adpcmio.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 struct adpcm_state state;
 
@@ -10,8 +14,105 @@ struct adpcm_state state;
 char	abuf[NSAMPLES/2];
 short	sbuf[NSAMPLES];
 
-main() {
-    int n;
+/*
+** -w: read block-framed WAV IMA-ADPCM (as written by rawcaudio -w)
+** and decode its blocks on several threads.
+*/
+struct block_job {
+    unsigned char *in;		/* first block */
+    short	*pcm;
+    long	nsamples;	/* per channel */
+    int		channels;
+    int		blockalign;
+    int		spb;
+};
+
+static void
+decode_blocks(void *arg, long first, long last)
+{
+    struct block_job *job = arg;
+    long b;
+
+    for ( b = first; b < last; b++ ) {
+	long start = b * job->spb;
+	long n = job->nsamples - start;
+
+	adpcm_block_decoder((char *)job->in + b * job->blockalign,
+			    job->blockalign, job->channels,
+			    job->pcm + start * job->channels,
+			    n < job->spb ? (int)n : job->spb);
+    }
+}
+
+static int
+block_main(int threads)
+{
+    struct block_job job;
+    struct wav_ima w;
+    char *in;
+    size_t len, outlen;
+    long off, nblocks;
+    int mapped;
+
+    if ( (in = load_input(0, &len, &mapped)) == NULL ) {
+	perror("input file");
+	exit(1);
+    }
+    off = wav_ima_parse((unsigned char *)in, len, &w);
+    if ( off < 0 || w.samplesperblock < 1 ||
+	 w.samplesperblock > adpcm_block_samples(w.blockalign, w.channels) ) {
+	fprintf(stderr, "input is not WAV IMA-ADPCM\n");
+	exit(1);
+    }
+    nblocks = w.datalen / w.blockalign;
+    if ( w.samples > nblocks * w.samplesperblock )
+      w.samples = nblocks * w.samplesperblock;
+
+    job.in = (unsigned char *)in + off;
+    job.nsamples = w.samples;
+    job.channels = w.channels;
+    job.blockalign = w.blockalign;
+    job.spb = w.samplesperblock;
+    nblocks = (w.samples + job.spb - 1) / job.spb;
+    outlen = (size_t)w.samples * w.channels * sizeof(short);
+    if ( (job.pcm = malloc(outlen ? outlen : 1)) == NULL ) {
+	perror("output buffer");
+	exit(1);
+    }
+    run_blocks(nblocks, threads, decode_blocks, &job);
+
+    if ( write_all(1, (char *)job.pcm, outlen) < 0 ) {
+	perror("output file");
+	exit(1);
+    }
+    fprintf(stderr, "Decoded %ld samples x %d channels from %ld blocks\n",
+	    w.samples, w.channels, nblocks);
+    release_input(in, len, mapped);
+    free(job.pcm);
+    return 0;
+}
+
+static void
+usage(void)
+{
+    fprintf(stderr, "usage: rawdaudio [-w [-t threads]]\n");
+    exit(1);
+}
+
+main(int argc, char *argv[]) {
+    int n, i;
+    int blocks = 0, threads = 0;
+
+    for ( i = 1; i < argc; i++ ) {
+	if ( !strcmp(argv[i], "-w") )
+	  blocks = 1;
+	else if ( !strcmp(argv[i], "-t") && i + 1 < argc )
+	  threads = atoi(argv[++i]);
+	else
+	  usage();
+    }
+    if ( blocks )
+      return block_main(threads > 0 ? threads : default_threads());
 
     while(1) {
 	n = read(0, abuf, NSAMPLES/2);
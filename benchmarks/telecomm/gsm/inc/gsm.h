@@ -63,6 +63,10 @@ extern int  gsm_decode  GSM_P((gsm, gsm_byte   *, gsm_signal *));
 extern int  gsm_explode GSM_P((gsm, gsm_byte   *, gsm_signal *));
 extern void gsm_implode GSM_P((gsm, gsm_signal *, gsm_byte   *));
 
+/* One frame for each of n independent channels (gsm_batch.c) */
+extern void gsm_encode_batch GSM_P((int, gsm *, gsm_signal **, gsm_byte   **));
+extern int  gsm_decode_batch GSM_P((int, gsm *, gsm_byte   **, gsm_signal **));
+
 #undef	GSM_P
 
 #endif	/* GSM_H */
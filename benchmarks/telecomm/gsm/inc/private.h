@@ -159,6 +159,10 @@ extern void Gsm_LPC_Analysis P((
 		word * s,	 /* 0..159 signals	IN/OUT	*/
 	        word * LARc));   /* 0..7   LARc's	OUT	*/
 
+extern void Gsm_LPC_Coding P((
+		longword * L_ACF, /* 0..8   autocorrelation IN	*/
+		word * LARc));	 /* 0..7   LARc's	OUT	*/
+
 extern void Gsm_Preprocess P((
 		struct gsm_state * S,
 		word * s, word * so));
@@ -176,6 +180,11 @@ extern void Gsm_Short_Term_Analysis_Filter P((
 		word	* LARc,	/* coded log area ratio [0..7]  IN	*/
 		word	* d	/* st res. signal [0..159]	IN/OUT	*/));
 
+extern void Gsm_Short_Term_Coefficients P((
+		struct gsm_state * S,
+		word	* LARc,	/* coded log area ratio [0..7]  IN	*/
+		word	* rp	/* coefficients [0..4*8-1]	OUT	*/));
+
 extern void Gsm_Decoder P((
 		struct gsm_state * S,
 		word	* LARcr,	/* [0..7]		IN	*/
@@ -214,6 +223,14 @@ void Gsm_RPE_Encoding P((
 		word    * Mc,           /*                              OUT */
 		word    * xMc));        /* [0..12]                      OUT */
 
+void Gsm_RPE_Weighted_Encoding P((
+		struct gsm_state * S,
+		word    * x,            /* [0..39] weighted signal      IN  */
+		word    * e,            /* [0..39]                      OUT */
+		word    * xmaxc,        /*                              OUT */
+		word    * Mc,           /*                              OUT */
+		word    * xMc));        /* [0..12]                      OUT */
+
 extern void Gsm_Short_Term_Synthesis_Filter P((
 		struct gsm_state * S,
 		word	* LARcr, 	/* log area ratios [0..7]  IN	*/
@@ -102,4 +102,47 @@ extern int	ulaw_input   P((gsm_signal*)), ulaw_output   P((gsm_signal *));
 extern int	alaw_input   P((gsm_signal*)), alaw_output   P((gsm_signal *));
 extern int	linear_input P((gsm_signal*)), linear_output P((gsm_signal *));
 
+extern void	ulaw_from_bytes   P((unsigned char *, gsm_signal *, int)),
+		ulaw_to_bytes     P((gsm_signal *, unsigned char *, int));
+extern void	alaw_from_bytes   P((unsigned char *, gsm_signal *, int)),
+		alaw_to_bytes     P((gsm_signal *, unsigned char *, int));
+extern void	linear_from_bytes P((unsigned char *, gsm_signal *, int)),
+		linear_to_bytes   P((gsm_signal *, unsigned char *, int));
+
+extern long	audio_header_length P((unsigned char *, unsigned long,
+				       unsigned long *));
+extern void	audio_header P((unsigned char *));
+
+#define	AUDIO_HEADER_SIZE	32	/* as written by audio_init_output */
+
+struct fmtdesc {
+
+	char * name, * longname, * suffix;
+
+	int  (* init_input )  P((void)),
+	     (* init_output)  P((void));
+
+	int  (* input ) P((gsm_signal * )),
+	     (* output) P((gsm_signal * ));
+
+	/*  Whole-buffer conversion of n samples of `width' bytes each,
+	 *  used by the parallel file mode (toast_pool.c).
+	 */
+	int	width;
+	void (* from_bytes) P((unsigned char *, gsm_signal *, int)),
+	     (* to_bytes  ) P((gsm_signal *, unsigned char *, int));
+};
+
+extern struct fmtdesc	f_audio, f_ulaw, f_alaw, f_linear, * f_format;
+
+extern char	* progname;
+extern int	f_decode, f_force, f_precious, f_fast, f_verbose;
+
+extern char	* plainname P((char *)), * codename P((char *));
+extern char	* suffix P((char *, char *));
+extern int	length_okay P((char *));
+extern struct fmtdesc * grok_format P((char *));
+
+extern int	process_pool P((char **, int, int));	/* toast_pool.c */
+
 #endif		/* TOAST_H */
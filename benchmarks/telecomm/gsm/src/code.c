@@ -16,6 +16,13 @@
 	extern char	* memcpy P((char *, char *, int));
 #endif
 
+#ifdef	HAS_STRING_H
+#include	<string.h>
+#else
+#	include "proto.h"
+	extern char	* memset P((char *, int, int));
+#endif
+
 #include	"private.h"
 #include	"gsm.h"
 #include	"proto.h"
@@ -59,10 +66,12 @@ void Gsm_Coder P8((S,s,LARc,Nc,bc,Mc,xmaxc,xMc),
 	word	* dp  = S->dp0 + 120;	/* [ -120...-1 ] */
 	word	* dpp = dp;		/* [ 0...39 ]	 */
 
-	static word	e [50] = {0};
+	word		e [50];	/* [-5..-1] and [40..44] stay zero */
 
 	word	so[160];
 
+	(void)memset( (char *)e, 0, sizeof(e) );
+
 	Gsm_Preprocess			(S, s, so);
 	Gsm_LPC_Analysis		(S, so, LARc);
 	Gsm_Short_Term_Analysis_Filter	(S, LARc, so);
@@ -0,0 +1,546 @@
+/*
+ * Copyright 1992 by Jutta Degener and Carsten Bormann, Technische
+ * Universitaet Berlin.  See the accompanying file "COPYRIGHT" for
+ * details.  THERE IS ABSOLUTELY NO WARRANTY FOR THIS SOFTWARE.
+ */
+
+/*
+ *  Batched coding of independent channels.
+ *
+ *  gsm_encode_batch() and gsm_decode_batch() code one frame for each
+ *  of n channels, each with its own gsm state, and produce exactly the
+ *  bits and samples gsm_encode() and gsm_decode() would.  Channels are
+ *  taken GSM_LANES at a time and run in lockstep: the signal is kept
+ *  transposed (sample-major, one 16 bit lane per channel) so that the
+ *  filters which do the same work for every channel -- autocorrelation,
+ *  the short term analysis and synthesis lattices, the weighting filter
+ *  and postprocessing -- run once for all lanes with SSE2 saturating
+ *  arithmetic.  The data-dependent parts (LPC quantization, the long
+ *  term predictor, RPE grid selection) stay scalar per channel.
+ *
+ *  Without SSE2 both calls simply loop over the single channel coder.
+ */
+
+#include	"config.h"
+
+#ifdef	HAS_STRING_H
+#include	<string.h>
+#endif
+
+#include	"private.h"
+#include	"gsm.h"
+#include	"proto.h"
+
+#define	GSM_LANES	8
+
+#ifdef	__SSE2__
+
+#include	<emmintrin.h>
+
+typedef	__m128i		lanes;		/* word [GSM_LANES] */
+
+#define	LOAD(p)		_mm_loadu_si128((__m128i const *)(p))
+#define	STORE(p, v)	_mm_storeu_si128((__m128i *)(p), (v))
+#define	LANE_ADD(a, b)	_mm_adds_epi16((a), (b))	/* GSM_ADD */
+#define	LANE_SUB(a, b)	_mm_subs_epi16((a), (b))	/* GSM_SUB */
+
+/*
+ *  GSM_MULT_R on every lane.  Packing with signed saturation turns the
+ *  one overflowing case, MIN_WORD * MIN_WORD, into MAX_WORD as
+ *  gsm_mult_r() does; none of the callers below can reach it otherwise.
+ */
+static lanes LANE_MULT_R P2((a, b), lanes a, lanes b)
+{
+	lanes	lo  = _mm_mullo_epi16(a, b);
+	lanes	hi  = _mm_mulhi_epi16(a, b);
+	lanes	rnd = _mm_set1_epi32(16384);
+
+	return _mm_packs_epi32(
+		_mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), rnd), 15),
+		_mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), rnd), 15));
+}
+
+/*
+ *  Gather word src[lane][k] (lanes [0..n-1], k in [0..len-1]) into the
+ *  lane-major x[k][lane], and back.  Unused lanes are zero.
+ */
+static void transpose_in P4((src, n, len, x),
+	word	** src,
+	int	n,
+	int	len,
+	word	* x)
+{
+	int	j, k;
+
+	if (n < GSM_LANES) memset(x, 0, len * GSM_LANES * sizeof(*x));
+	for (j = 0; j < n; j++)
+		for (k = 0; k < len; k++) x[k * GSM_LANES + j] = src[j][k];
+}
+
+static void transpose_out P4((x, n, len, dst),
+	word	* x,
+	int	n,
+	int	len,
+	word	** dst)
+{
+	int	j, k;
+
+	for (j = 0; j < n; j++)
+		for (k = 0; k < len; k++) dst[j][k] = x[k * GSM_LANES + j];
+}
+
+/* 4.2.4, see Autocorrelation() in lpc.c
+ *
+ * Each lane is scaled by its own power of two; s[] is left scaled down
+ * and up again, exactly as in the scalar version.
+ */
+static void Batch_Autocorrelation P3((s, n, L_ACF),
+	word		* s,		/* [0..159][lane]	IN/OUT	*/
+	int		n,
+	longword	L_ACF[GSM_LANES][9])	/*		OUT	*/
+{
+	word	smax[GSM_LANES], mul[GSM_LANES], up[GSM_LANES];
+	word	keep[GSM_LANES];
+	lanes	vmax, vmul, vup, vkeep, acc_lo[9], acc_hi[9];
+	int	i, j, k;
+	int	any = 0;
+
+	vmax = _mm_setzero_si128();
+	for (k = 0; k <= 159; k++) {
+		lanes	v = LOAD(s + k * GSM_LANES);
+		vmax = _mm_max_epi16(vmax,	/* GSM_ABS */
+			_mm_max_epi16(v, _mm_subs_epi16(_mm_setzero_si128(), v)));
+	}
+	STORE(smax, vmax);
+
+	for (j = 0; j < GSM_LANES; j++) {
+		word	scalauto = 0;
+
+		if (j < n && smax[j] != 0)
+			scalauto = 4 - gsm_norm( (longword)smax[j] << 16 );
+		if (scalauto > 0) {
+			mul[j]  = 16384 >> (scalauto - 1);
+			up[j]   = 1 << scalauto;
+			keep[j] = 0;
+			any	= 1;
+		} else {
+			mul[j]  = up[j] = 0;
+			keep[j] = -1;
+		}
+	}
+
+	if (any) {
+		vmul  = LOAD(mul);
+		vkeep = LOAD(keep);
+		for (k = 0; k <= 159; k++) {
+			lanes	v = LOAD(s + k * GSM_LANES);
+			lanes	t = LANE_MULT_R(v, vmul);
+			STORE(s + k * GSM_LANES, _mm_or_si128(
+				_mm_and_si128(vkeep, v),
+				_mm_andnot_si128(vkeep, t)));
+		}
+	}
+
+	/*  After scaling every |s| < 2^11, so the sums fit in 32 bits.
+	 */
+	for (k = 0; k <= 8; k++) acc_lo[k] = acc_hi[k] = _mm_setzero_si128();
+	for (i = 0; i <= 159; i++) {
+		lanes	si = LOAD(s + i * GSM_LANES);
+
+		for (k = 0; k <= 8 && k <= i; k++) {
+			lanes	sk = LOAD(s + (i - k) * GSM_LANES);
+			lanes	lo = _mm_mullo_epi16(si, sk);
+			lanes	hi = _mm_mulhi_epi16(si, sk);
+
+			acc_lo[k] = _mm_add_epi32(acc_lo[k],
+				_mm_unpacklo_epi16(lo, hi));
+			acc_hi[k] = _mm_add_epi32(acc_hi[k],
+				_mm_unpackhi_epi16(lo, hi));
+		}
+	}
+	for (k = 0; k <= 8; k++) {
+		int	sum[GSM_LANES];
+
+		STORE(sum,     _mm_slli_epi32(acc_lo[k], 1));
+		STORE(sum + 4, _mm_slli_epi32(acc_hi[k], 1));
+		for (j = 0; j < n; j++) L_ACF[j][k] = sum[j];
+	}
+
+	/*  Rescaling of the array s[0..159]
+	 */
+	if (any) {
+		vup = LOAD(up);
+		for (k = 0; k <= 159; k++) {
+			lanes	v = LOAD(s + k * GSM_LANES);
+			STORE(s + k * GSM_LANES, _mm_or_si128(
+				_mm_and_si128(vkeep, v),
+				_mm_andnot_si128(vkeep, _mm_mullo_epi16(v, vup))));
+		}
+	}
+}
+
+/*
+ *  Lane vectors of the coefficient set `set' (0..3) from rp[lane][4*8].
+ */
+static void lane_coefficients P3((rp, set, r),
+	word	rp[GSM_LANES][4 * 8],
+	int	set,
+	lanes	* r)
+{
+	word	t[8][GSM_LANES];
+	int	i, j;
+
+	for (i = 0; i < 8; i++)
+		for (j = 0; j < GSM_LANES; j++) t[i][j] = rp[j][set * 8 + i];
+	for (i = 0; i < 8; i++) r[i] = LOAD(t[i]);
+}
+
+/* 4.2.10, see Short_term_analysis_filtering() in short_term.c */
+static void Batch_Short_term_analysis P3((u, rp, s),
+	lanes		* u,		/* [0..7]		IN/OUT	*/
+	word		rp[GSM_LANES][4 * 8],
+	word		* s)		/* [0..159][lane]	IN/OUT	*/
+{
+	static int	start[5] = { 0, 13, 27, 40, 160 };
+	lanes		r[8];
+	int		set, k, i;
+
+	for (set = 0; set < 4; set++) {
+
+		lane_coefficients(rp, set, r);
+
+		for (k = start[set]; k < start[set + 1]; k++) {
+			lanes	di, sav, ui;
+
+			di = sav = LOAD(s + k * GSM_LANES);
+			for (i = 0; i < 8; i++) {
+				ui   = u[i];
+				u[i] = sav;
+				sav  = LANE_ADD(ui, LANE_MULT_R(r[i], di));
+				di   = LANE_ADD(di, LANE_MULT_R(r[i], ui));
+			}
+			STORE(s + k * GSM_LANES, di);
+		}
+	}
+}
+
+/* 4.2.13, see Weighting_filter() in rpe.c
+ *
+ * The nine non-zero taps are taken in pairs so that PMADDWD does two
+ * multiply-adds per 32 bit lane.
+ */
+static void Batch_Weighting_filter P2((e, x),
+	word	* e,		/* [0..49][lane], e[-5..44] of rpe.c	IN  */
+	word	* x)		/* [0..39][lane]			OUT */
+{
+#define	PAIR(a, b)	_mm_set1_epi32( ((b) << 16) | ((a) & 0xFFFF) )
+	lanes	h01  = PAIR(  -134,  -374 );
+	lanes	h34  = PAIR(  2054,  5741 );
+	lanes	h56  = PAIR(  8192,  5741 );
+	lanes	h79  = PAIR(  2054,  -374 );
+	lanes	h10  = PAIR(  -134,     0 );
+#undef	PAIR
+	lanes	rnd  = _mm_set1_epi32( 8192 >> 1 );
+	int	k;
+
+	for (k = 0; k <= 39; k++) {
+		word	* w = e + k * GSM_LANES;
+		lanes	lo = rnd, hi = rnd, a, b;
+
+#undef	STEP
+#define	STEP( i, j, H )	\
+		a  = LOAD(w + (i) * GSM_LANES);		\
+		b  = LOAD(w + (j) * GSM_LANES);		\
+		lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), H)); \
+		hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), H));
+
+		STEP(  0, 1, h01 );
+		STEP(  3, 4, h34 );
+		STEP(  5, 6, h56 );
+		STEP(  7, 9, h79 );
+		STEP( 10, 2, h10 );
+#undef	STEP
+
+		STORE(x + k * GSM_LANES, _mm_packs_epi32(
+			_mm_srai_epi32(lo, 13), _mm_srai_epi32(hi, 13)));
+	}
+}
+
+/* 4.3.4, see Short_term_synthesis_filtering() in short_term.c */
+static void Batch_Short_term_synthesis P4((v, rp, wt, sr),
+	lanes		* v,		/* [0..8]		IN/OUT	*/
+	word		rp[GSM_LANES][4 * 8],
+	word		* wt,		/* [0..159][lane]	IN	*/
+	word		* sr)		/* [0..159][lane]	OUT	*/
+{
+	static int	start[5] = { 0, 13, 27, 40, 160 };
+	lanes		r[8];
+	int		set, k, i;
+
+	for (set = 0; set < 4; set++) {
+
+		lane_coefficients(rp, set, r);
+
+		for (k = start[set]; k < start[set + 1]; k++) {
+			lanes	sri = LOAD(wt + k * GSM_LANES);
+
+			for (i = 8; i--;) {
+				sri    = LANE_SUB(sri, LANE_MULT_R(r[i], v[i]));
+				v[i+1] = LANE_ADD(v[i], LANE_MULT_R(r[i], sri));
+			}
+			STORE(sr + k * GSM_LANES, v[0] = sri);
+		}
+	}
+}
+
+/* 4.3.5, see Postprocessing() in decode.c */
+static void Batch_Postprocessing P2((msr, s),
+	lanes		* msr,
+	word		* s)		/* [0..159][lane]	IN/OUT	*/
+{
+	lanes	c    = _mm_set1_epi16(28180);
+	lanes	mask = _mm_set1_epi16((short)0xFFF8);
+	lanes	m    = *msr;
+	int	k;
+
+	for (k = 0; k <= 159; k++) {
+		m = LANE_ADD(LOAD(s + k * GSM_LANES), LANE_MULT_R(m, c));
+		STORE(s + k * GSM_LANES, _mm_and_si128(LANE_ADD(m, m), mask));
+	}
+	*msr = m;
+}
+
+/*
+ *  Load / store one word member of every lane's state as a lane vector.
+ */
+#define	STATE_LOAD(S, n, member, v)					\
+	{ word t_[GSM_LANES]; int j_;					\
+	  for (j_ = 0; j_ < GSM_LANES; j_++)				\
+		t_[j_] = j_ < (n) ? (S)[j_]->member : 0;		\
+	  (v) = LOAD(t_); }
+
+#define	STATE_STORE(S, n, member, v)					\
+	{ word t_[GSM_LANES]; int j_;					\
+	  STORE(t_, (v));						\
+	  for (j_ = 0; j_ < (n); j_++) (S)[j_]->member = t_[j_]; }
+
+/*
+ *  Gsm_Coder() for n <= GSM_LANES channels, writing each channel's
+ *  parameters in gsm_implode() order.
+ */
+static void Batch_Coder P4((S, n, src, par),
+	struct gsm_state	** S,
+	int			n,
+	word			** src,		/* [lane][0..159]  IN	*/
+	word			par[GSM_LANES][76])	/*	   OUT	*/
+{
+	word		so[GSM_LANES][160];
+	word		e[GSM_LANES][50];
+	word		xl[GSM_LANES][40];
+	word		lane_s[160 * GSM_LANES];
+	word		lane_e[50 * GSM_LANES];
+	word		lane_x[40 * GSM_LANES];
+	word		rp[GSM_LANES][4 * 8];
+	longword	L_ACF[GSM_LANES][9];
+	word		* rows[GSM_LANES];
+	lanes		u[8];
+	int		i, j, k;
+
+	for (j = 0; j < n; j++) {
+		Gsm_Preprocess(S[j], src[j], so[j]);
+		rows[j] = so[j];
+	}
+
+	/*  LPC analysis and short term analysis filtering, all lanes
+	 */
+	transpose_in(rows, n, 160, lane_s);
+	Batch_Autocorrelation(lane_s, n, L_ACF);
+	memset(rp, 0, sizeof(rp));
+	for (j = 0; j < n; j++) {
+		Gsm_LPC_Coding(L_ACF[j], par[j]);
+		Gsm_Short_Term_Coefficients(S[j], par[j], rp[j]);
+	}
+	for (i = 0; i < 8; i++) STATE_LOAD(S, n, u[i], u[i]);
+	Batch_Short_term_analysis(u, rp, lane_s);
+	for (i = 0; i < 8; i++) STATE_STORE(S, n, u[i], u[i]);
+	transpose_out(lane_s, n, 160, rows);
+
+	/*  RPE-LTP loop, four subframes
+	 */
+	memset(e, 0, sizeof(e));
+	memset(lane_e, 0, sizeof(lane_e));
+	for (k = 0; k <= 3; k++) {
+		word	dpp[GSM_LANES][40];
+		word	* p = NULL;
+
+		for (j = 0; j < n; j++) {
+			p = par[j] + 8 + k * 17;	/* Nc bc Mc xmaxc xMc */
+
+			Gsm_Long_Term_Predictor(S[j], so[j] + k * 40,
+				S[j]->dp0 + 120 + k * 40, e[j] + 5, dpp[j],
+				p, p + 1);
+			for (i = 0; i < 40; i++)
+				lane_e[(i + 5) * GSM_LANES + j] = e[j][5 + i];
+		}
+
+		Batch_Weighting_filter(lane_e, lane_x);
+		for (j = 0; j < n; j++) rows[j] = xl[j];
+		transpose_out(lane_x, n, 40, rows);
+
+		for (j = 0; j < n; j++) {
+			word		* dp = S[j]->dp0 + 120 + k * 40;
+			longword	ltmp;
+
+			p = par[j] + 8 + k * 17;
+			Gsm_RPE_Weighted_Encoding(S[j], xl[j], e[j] + 5,
+				p + 3, p + 2, p + 4);
+
+			for (i = 0; i <= 39; i++)
+				dp[ i ] = GSM_ADD( e[j][5 + i], dpp[j][i] );
+		}
+	}
+	for (j = 0; j < n; j++)
+		(void)memcpy( (char *)S[j]->dp0, (char *)(S[j]->dp0 + 160),
+			120 * sizeof(*S[j]->dp0) );
+}
+
+/*
+ *  Gsm_Decoder() for n <= GSM_LANES channels from gsm_explode() order
+ *  parameters.
+ */
+static void Batch_Decoder P4((S, n, par, dst),
+	struct gsm_state	** S,
+	int			n,
+	word			par[GSM_LANES][76],	/*	   IN	*/
+	word			** dst)		/* [lane][0..159]  OUT	*/
+{
+	word		wt[GSM_LANES][160];
+	word		lane_wt[160 * GSM_LANES];
+	word		lane_s[160 * GSM_LANES];
+	word		rp[GSM_LANES][4 * 8];
+	word		* rows[GSM_LANES];
+	lanes		v[9], msr;
+	int		i, j, k;
+
+	memset(rp, 0, sizeof(rp));
+	for (j = 0; j < n; j++) {
+		word	erp[40];
+		word	* drp = S[j]->dp0 + 120;
+
+		for (k = 0; k <= 3; k++) {
+			word	* p = par[j] + 8 + k * 17;
+
+			Gsm_RPE_Decoding(S[j], p[3], p[2], p + 4, erp);
+			Gsm_Long_Term_Synthesis_Filtering(S[j], p[0], p[1],
+				erp, drp);
+			for (i = 0; i <= 39; i++) wt[j][k * 40 + i] = drp[i];
+		}
+		Gsm_Short_Term_Coefficients(S[j], par[j], rp[j]);
+		rows[j] = wt[j];
+	}
+
+	transpose_in(rows, n, 160, lane_wt);
+	for (i = 0; i < 9; i++) STATE_LOAD(S, n, v[i], v[i]);
+	Batch_Short_term_synthesis(v, rp, lane_wt, lane_s);
+	for (i = 0; i < 9; i++) STATE_STORE(S, n, v[i], v[i]);
+
+	STATE_LOAD(S, n, msr, msr);
+	Batch_Postprocessing(&msr, lane_s);
+	STATE_STORE(S, n, msr, msr);
+
+	transpose_out(lane_s, n, 160, dst);
+}
+
+#endif	/* __SSE2__ */
+
+/*
+ *  States using the FAST approximations cannot share lanes with the
+ *  exact coder.
+ */
+static int batch_ok P2((g, n), gsm * g, int n)
+{
+#ifdef	__SSE2__
+#if	defined(FAST) && defined(USE_FLOAT_MUL)
+	int	j;
+
+	for (j = 0; j < n; j++) if (g[j]->fast) return 0;
+#endif
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+void gsm_encode_batch P4((n, g, source, c),
+	int		n,
+	gsm		* g,		/* [0..n-1]			*/
+	gsm_signal	** source,	/* [0..n-1][0..159]	IN	*/
+	gsm_byte	** c)		/* [0..n-1][0..32]	OUT	*/
+{
+	int	base, m, j;
+
+	for (base = 0; base < n; base += m) {
+		m = n - base < GSM_LANES ? n - base : GSM_LANES;
+
+		if (!batch_ok(g + base, m)) {
+			for (j = 0; j < m; j++)
+				gsm_encode(g[base + j], source[base + j],
+					c[base + j]);
+			continue;
+		}
+#ifdef	__SSE2__
+		{
+			word	par[GSM_LANES][76];
+
+			Batch_Coder(g + base, m, source + base, par);
+			for (j = 0; j < m; j++)
+				gsm_implode(g[base + j], par[j], c[base + j]);
+		}
+#endif
+	}
+}
+
+/*
+ *  Returns 0, or -1 if any frame lacks the GSM magic; those channels'
+ *  output and state are left untouched, the others are decoded.
+ */
+int gsm_decode_batch P4((n, g, c, target),
+	int		n,
+	gsm		* g,		/* [0..n-1]			*/
+	gsm_byte	** c,		/* [0..n-1][0..32]	IN	*/
+	gsm_signal	** target)	/* [0..n-1][0..159]	OUT	*/
+{
+	int	base, m, j, ret = 0;
+
+	for (base = 0; base < n; base += m) {
+		m = n - base < GSM_LANES ? n - base : GSM_LANES;
+
+		if (!batch_ok(g + base, m)) {
+			for (j = 0; j < m; j++)
+				if (gsm_decode(g[base + j], c[base + j],
+					       target[base + j]))
+					ret = -1;
+			continue;
+		}
+#ifdef	__SSE2__
+		{
+			word		par[GSM_LANES][76];
+			gsm		lg[GSM_LANES];
+			gsm_signal	* lt[GSM_LANES];
+			int		l = 0;
+
+			for (j = 0; j < m; j++) {
+				if (gsm_explode(g[base + j], c[base + j],
+						par[l])) {
+					ret = -1;
+					continue;
+				}
+				lg[l]   = g[base + j];
+				lt[l++] = target[base + j];
+			}
+			if (l) Batch_Decoder(lg, l, par, lt);
+		}
+#endif
+	}
+	return ret;
+}
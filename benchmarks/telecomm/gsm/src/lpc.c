@@ -335,6 +335,17 @@ void Gsm_LPC_Analysis P3((S, s,LARc),
 	else
 #endif
 	Autocorrelation			  (s,	  L_ACF	);
+	Gsm_LPC_Coding			  (L_ACF, LARc	);
+}
+
+/*
+ *  4.2.5 .. 4.2.7 for an already computed L_ACF[0..8]; used by
+ *  Gsm_LPC_Analysis and by the batched coder in gsm_batch.c.
+ */
+void Gsm_LPC_Coding P2((L_ACF, LARc),
+	longword	 * L_ACF,	/* 0..8   autocorrelation IN	*/
+	word		 * LARc)	/* 0..7   LARc's	OUT	*/
+{
 	Reflection_coefficients		  (L_ACF, LARc	);
 	Transformation_to_Log_Area_Ratios (LARc);
 	Quantization_and_coding		  (LARc);
@@ -456,10 +456,28 @@ void Gsm_RPE_Encoding P5((S,e,xmaxc,Mc,xMc),
 	word	* xMc)		/* [0..12]			OUT */
 {
 	word	x[40];
+
+	Weighting_filter(e, x);
+	Gsm_RPE_Weighted_Encoding( S, x, e, xmaxc, Mc, xMc );
+}
+
+/*
+ *  4.2.14 .. 4.2.18 for an already weighted x[0..39]; used by
+ *  Gsm_RPE_Encoding and by the batched coder in gsm_batch.c.
+ */
+void Gsm_RPE_Weighted_Encoding P6((S,x,e,xmaxc,Mc,xMc),
+
+	struct gsm_state * S,
+
+	word	* x,		/* [0..39] weighted signal	IN  */
+	word	* e,		/* [0..39]			OUT */
+	word	* xmaxc,	/* 				OUT */
+	word	* Mc,		/* 			  	OUT */
+	word	* xMc)		/* [0..12]			OUT */
+{
 	word	xM[13], xMp[13];
 	word	mant, exp;
 
-	Weighting_filter(e, x);
 	RPE_grid_selection(x, xM, Mc);
 
 	APCM_quantization(	xM, xMc, &mant, &exp, xmaxc);
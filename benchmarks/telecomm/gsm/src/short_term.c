@@ -343,6 +343,36 @@ static void Fast_Short_term_synthesis_filtering P5((S,rrp,k,wt,sr),
 
 #endif /* defined(FAST) && defined(USE_FLOAT_MUL) */
 
+/*
+ *  Derive the four sets of reflection coefficients used over one frame
+ *  (samples 0..12, 13..26, 27..39 and 40..159) from the coded LARs, and
+ *  advance the LARpp history.  Shared by the analysis and synthesis
+ *  filters and by the batched coder in gsm_batch.c.
+ */
+void Gsm_Short_Term_Coefficients P3((S,LARc,rp),
+	struct gsm_state * S,
+	word	* LARc,		/* coded log area ratio [0..7]  IN	*/
+	word	* rp		/* coefficients [0..4*8-1]	OUT	*/
+)
+{
+	word		* LARpp_j	= S->LARpp[ S->j      ];
+	word		* LARpp_j_1	= S->LARpp[ S->j ^= 1 ];
+
+	Decoding_of_the_coded_Log_Area_Ratios( LARc, LARpp_j );
+
+	Coefficients_0_12(  LARpp_j_1, LARpp_j, rp );
+	LARp_to_rp( rp );
+
+	Coefficients_13_26( LARpp_j_1, LARpp_j, rp + 8 );
+	LARp_to_rp( rp + 8 );
+
+	Coefficients_27_39( LARpp_j_1, LARpp_j, rp + 16 );
+	LARp_to_rp( rp + 16 );
+
+	Coefficients_40_159( LARpp_j, rp + 24 );
+	LARp_to_rp( rp + 24 );
+}
+
 void Gsm_Short_Term_Analysis_Filter P3((S,LARc,s),
 
 	struct gsm_state * S,
@@ -351,10 +381,7 @@ void Gsm_Short_Term_Analysis_Filter P3((S,LARc,s),
 	word	* s		/* signal [0..159]		IN/OUT	*/
 )
 {
-	word		* LARpp_j	= S->LARpp[ S->j      ];
-	word		* LARpp_j_1	= S->LARpp[ S->j ^= 1 ];
-
-	word		LARp[8];
+	word		rp[4 * 8];
 
 #undef	FILTER
 #if 	defined(FAST) && defined(USE_FLOAT_MUL)
@@ -366,23 +393,12 @@ void Gsm_Short_Term_Analysis_Filter P3((S,LARc,s),
 # 	define	FILTER	Short_term_analysis_filtering
 #endif
 
-	Decoding_of_the_coded_Log_Area_Ratios( LARc, LARpp_j );
-
-	Coefficients_0_12(  LARpp_j_1, LARpp_j, LARp );
-	LARp_to_rp( LARp );
-	FILTER( S, LARp, 13, s);
+	Gsm_Short_Term_Coefficients( S, LARc, rp );
 
-	Coefficients_13_26( LARpp_j_1, LARpp_j, LARp);
-	LARp_to_rp( LARp );
-	FILTER( S, LARp, 14, s + 13);
-
-	Coefficients_27_39( LARpp_j_1, LARpp_j, LARp);
-	LARp_to_rp( LARp );
-	FILTER( S, LARp, 13, s + 27);
-
-	Coefficients_40_159( LARpp_j, LARp);
-	LARp_to_rp( LARp );
-	FILTER( S, LARp, 120, s + 40);
+	FILTER( S, rp,      13, s);
+	FILTER( S, rp + 8,  14, s + 13);
+	FILTER( S, rp + 16, 13, s + 27);
+	FILTER( S, rp + 24, 120, s + 40);
 }
 
 void Gsm_Short_Term_Synthesis_Filter P4((S, LARcr, wt, s),
@@ -394,10 +410,7 @@ void Gsm_Short_Term_Synthesis_Filter P4((S, LARcr, wt, s),
 	word	* s		/* signal   s [0..159]		  OUT  */
 )
 {
-	word		* LARpp_j	= S->LARpp[ S->j     ];
-	word		* LARpp_j_1	= S->LARpp[ S->j ^=1 ];
-
-	word		LARp[8];
+	word		rp[4 * 8];
 
 #undef	FILTER
 #if 	defined(FAST) && defined(USE_FLOAT_MUL)
@@ -409,21 +422,10 @@ void Gsm_Short_Term_Synthesis_Filter P4((S, LARcr, wt, s),
 #	define	FILTER	Short_term_synthesis_filtering
 #endif
 
-	Decoding_of_the_coded_Log_Area_Ratios( LARcr, LARpp_j );
-
-	Coefficients_0_12( LARpp_j_1, LARpp_j, LARp );
-	LARp_to_rp( LARp );
-	FILTER( S, LARp, 13, wt, s );
-
-	Coefficients_13_26( LARpp_j_1, LARpp_j, LARp);
-	LARp_to_rp( LARp );
-	FILTER( S, LARp, 14, wt + 13, s + 13 );
-
-	Coefficients_27_39( LARpp_j_1, LARpp_j, LARp);
-	LARp_to_rp( LARp );
-	FILTER( S, LARp, 13, wt + 27, s + 27 );
+	Gsm_Short_Term_Coefficients( S, LARcr, rp );
 
-	Coefficients_40_159( LARpp_j, LARp );
-	LARp_to_rp( LARp );
-	FILTER(S, LARp, 120, wt + 40, s + 40);
+	FILTER( S, rp,      13, wt,      s );
+	FILTER( S, rp + 8,  14, wt + 13, s + 13 );
+	FILTER( S, rp + 16, 13, wt + 27, s + 27 );
+	FILTER( S, rp + 24, 120, wt + 40, s + 40 );
 }
@@ -19,6 +19,7 @@ int	f_force	   = 0;		/* force deletion 		 (-f) */
 int	f_precious = 0;		/* avoid deletion		 (-p) */
 int	f_fast	   = 0;		/* use faster fpt algorithm	 (-F) */
 int	f_verbose  = 0;		/* debugging			 (-V) */
+int	f_jobs	   = 0;		/* parallel file mode threads	 (-j) */
 
 struct stat instat;		/* stat (inname) 		 */
 
@@ -48,36 +49,29 @@ int	(*init_input)  P((void)),
 
 static int	generic_init P0() { return 0; }	/* NOP */
 
-struct fmtdesc {
-
-	char * name, * longname, * suffix;
-
-	int  (* init_input )  P((void)),
-	     (* init_output)  P((void));
-
-	int  (* input ) P((gsm_signal * )),
-	     (* output) P((gsm_signal * ));
-
-} f_audio = {
+struct fmtdesc f_audio = {
 		"audio",
 		"8 kHz, 8 bit u-law encoding with Sun audio header", ".au",
 		audio_init_input,
 		audio_init_output,
 		ulaw_input,
-		ulaw_output
+		ulaw_output,
+		1, ulaw_from_bytes, ulaw_to_bytes
 }, f_ulaw = {
 		"u-law", "plain 8 kHz, 8 bit u-law encoding", ".u",
 		generic_init,
 		generic_init,
 		ulaw_input,
-		ulaw_output 
+		ulaw_output,
+		1, ulaw_from_bytes, ulaw_to_bytes
 
 }, f_alaw = {
 		"A-law", "8 kHz, 8 bit A-law encoding", ".A",
 		generic_init,
 		generic_init,
 		alaw_input,
-		alaw_output
+		alaw_output,
+		1, alaw_from_bytes, alaw_to_bytes
 
 }, f_linear = {
 		"linear",
@@ -85,7 +79,8 @@ struct fmtdesc {
 		generic_init,
 		generic_init,
 		linear_input,
-		linear_output
+		linear_output,
+		2, linear_from_bytes, linear_to_bytes
 };
 
 struct fmtdesc * alldescs[] = {
@@ -138,7 +133,7 @@ static void parse_argv0 P1((av0), char * av0 )
  *  Check whether the name (possibly generated by appending
  *  .gsm to something else) is short enough for this system.
  */
-static int length_okay P1((name), char * name)
+int length_okay P1((name), char * name)
 {
 	long	max_filename_length = 0;
 	char	* end;
@@ -199,7 +194,7 @@ static int length_okay P1((name), char * name)
  *  Return a pointer the suffix of a string, if any.
  *  A suffix alone has no suffix, an empty suffix can not be had.
  */
-static char * suffix P2((name, suf), char *name, char * suf) 
+char * suffix P2((name, suf), char *name, char * suf) 
 {
 	size_t nlen = strlen(name);
 	size_t slen = strlen(suf);
@@ -278,7 +273,7 @@ static char* normalname P3((name, want, cut), char *name, char *want,char *cut)
 /*
  *  Generate a `plain' (non-encoded) name from a given name.
  */
-static char * plainname P1((name), char *name)
+char * plainname P1((name), char *name)
 {
 	return normalname(name, "", SUFFIX_TOASTED );
 }
@@ -286,7 +281,7 @@ static char * plainname P1((name), char *name)
 /*
  *  Generate a `code' name (foo.Z) from a given name.
  */
-static char * codename P1((name), char *name)
+char * codename P1((name), char *name)
 {
 	return normalname( name, SUFFIX_TOASTED, "" );
 }
@@ -427,7 +422,7 @@ static void prepare_io P1(( desc), struct fmtdesc * desc)
 	init_output = desc->init_output;
 }
 
-static struct fmtdesc * grok_format P1((name), char * name)
+struct fmtdesc * grok_format P1((name), char * name)
 {
 	char * c;
 	struct fmtdesc ** f;
@@ -704,13 +699,15 @@ static void version P0()
 
 static void help P0()
 {
-	printf("Usage: %s [-fcpdhvaulsF] [files...]\n", progname);
+	printf("Usage: %s [-fcpdhvaulsF] [-j n] [files...]\n", progname);
 	printf("\n");
 
 	printf(" -f  force     Replace existing files without asking\n");
 	printf(" -c  cat       Write to stdout, do not remove source files\n");
 	printf(" -d  decode    Decode data (default is encode)\n");
 	printf(" -p  precious  Do not delete the source\n");
+	printf(" -j  jobs      Convert files and directories on n threads\n");
+	printf("               (0: one per CPU), with summary statistics\n");
 	printf("\n");
 
 	printf(" -u  u-law     Force 8 kHz/8 bit u-law in/output format\n");
@@ -742,10 +739,11 @@ int main P2((ac, av), int ac, char **av)
 {
 	int  		opt;
 	extern int	optind;
+	extern char	* optarg;
 
 	parse_argv0( *av );
 
-	while ((opt = getopt(ac, av, "fcdpvhuaslVF")) != EOF)
+	while ((opt = getopt(ac, av, "fcdpvhuaslVFj:")) != EOF)
 	switch (opt) {
 
 	case 'd': f_decode   = 1; break;
@@ -753,6 +751,9 @@ int main P2((ac, av), int ac, char **av)
 	case 'c': f_cat      = 1; break;
 	case 'p': f_precious = 1; break;
 	case 'F': f_fast     = 1; break;
+	case 'j': f_jobs     = atoi(optarg);
+		  if (f_jobs <= 0) f_jobs = -1;	/* one per CPU */
+		  break;
 
 #ifndef	NDEBUG
 	case 'V': f_verbose  = 1; break;	/* undocumented */
@@ -768,7 +769,7 @@ int main P2((ac, av), int ac, char **av)
 
 	default: 
 		fprintf(stderr,
-			"Usage: %s [-fcpdhvuaslF] [files...] (-h for help)\n",
+			"Usage: %s [-fcpdhvuaslF] [-j n] [files...] (-h for help)\n",
 			progname);
 		exit(1);
 	}
@@ -780,6 +781,10 @@ int main P2((ac, av), int ac, char **av)
 
 	catch_signals(onintr);
 
+	/*  The parallel mode writes whole files; -c and stdin stay serial.
+	 */
+	if (f_jobs && ac > 0 && !f_cat) exit(process_pool(av, ac, f_jobs));
+
 	if (ac <= 0) process( (char *)0 );
 	else while (ac--) process( *av++ );
 
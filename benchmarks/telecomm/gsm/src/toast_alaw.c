@@ -331,3 +331,16 @@ int alaw_output P1((buf), gsm_signal * buf)
 	return 0;
 }
 
+
+/*
+ *  Whole-buffer conversions for the parallel file mode (toast_pool.c).
+ */
+void alaw_from_bytes P3((p, buf, n), unsigned char * p, gsm_signal * buf, int n)
+{
+	while (n-- > 0) *buf++ = A2S(*p++);
+}
+
+void alaw_to_bytes P3((buf, p, n), gsm_signal * buf, unsigned char * p, int n)
+{
+	while (n-- > 0) *p++ = S2A( *buf++ );
+}
@@ -101,3 +101,49 @@ int audio_init_output P0()
 	return 0;
 }
 
+
+/*
+ *  In-memory versions for the parallel file mode (toast_pool.c).
+ *
+ *  audio_header_length() checks the header at the start of a mapped
+ *  file and returns the offset of the samples (or -1), storing the
+ *  encoding in *enc; audio_header() builds the 32 byte header that
+ *  audio_init_output() writes.
+ */
+static unsigned long get_mem_u32 P1((p), unsigned char * p)
+{
+	return	  ((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16)
+		| ((unsigned long)p[2] <<  8) |  (unsigned long)p[3];
+}
+
+static void put_mem_u32 P2((p, u), unsigned char * p, unsigned long u)
+{
+	p[0] = (u >> 24) & 0x0FF;
+	p[1] = (u >> 16) & 0x0FF;
+	p[2] = (u >>  8) & 0x0FF;
+	p[3] =  u        & 0x0FF;
+}
+
+long audio_header_length P3((p, len, enc),
+	unsigned char * p, unsigned long len, unsigned long * enc)
+{
+	unsigned long	hlen;
+
+	if (len < 16 || memcmp((char *)p, ".snd", 4)) return -1;
+	hlen = get_mem_u32(p + 4);
+	*enc = get_mem_u32(p + 12);
+	if (hlen < 16 || hlen > len) return -1;
+	return (long)hlen;
+}
+
+void audio_header P1((p), unsigned char * p)
+{
+	memcpy((char *)p, ".snd", 4);
+	put_mem_u32(p +  4, 32);
+	put_mem_u32(p +  8, ~(unsigned long)0);
+	put_mem_u32(p + 12, 1);
+	put_mem_u32(p + 16, 8000);
+	put_mem_u32(p + 20, 1);
+	put_mem_u32(p + 24, 0);
+	put_mem_u32(p + 28, 0);
+}
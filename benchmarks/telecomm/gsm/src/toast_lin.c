@@ -22,3 +22,16 @@ int linear_output P1((buf), gsm_signal * buf)
 {
 	return -( fwrite( (char *)buf, sizeof(*buf), 160, out ) != 160 );
 }
+
+/*
+ *  Whole-buffer conversions for the parallel file mode (toast_pool.c).
+ */
+void linear_from_bytes P3((p, buf, n), unsigned char * p, gsm_signal * buf, int n)
+{
+	memcpy( (char *)buf, (char *)p, n * sizeof(*buf) );
+}
+
+void linear_to_bytes P3((buf, p, n), gsm_signal * buf, unsigned char * p, int n)
+{
+	memcpy( (char *)p, (char *)buf, n * sizeof(*buf) );
+}
@@ -0,0 +1,467 @@
+/*
+ * Copyright 1992 by Jutta Degener and Carsten Bormann, Technische
+ * Universitaet Berlin.  See the accompanying file "COPYRIGHT" for
+ * details.  THERE IS ABSOLUTELY NO WARRANTY FOR THIS SOFTWARE.
+ */
+
+#define	_XOPEN_SOURCE	600	/* pthreads, mmap, fchown under -ansi */
+
+#include	"toast.h"
+
+#include	<pthread.h>
+#include	<dirent.h>
+#include	<sys/mman.h>
+#include	<sys/time.h>
+
+/*  toast_pool -- convert many files at once (toast -j n).
+ *
+ *  The file arguments (directories stand for the regular files in
+ *  them) are handed out to a pool of worker threads.  Unlike the
+ *  serial path in toast.c, which streams through stdio one frame at a
+ *  time, each worker maps its input, codes every frame into an output
+ *  buffer sized up front and writes that buffer with one write().
+ *  Naming, format selection, overwrite and deletion rules follow the
+ *  serial path, except that an existing output is only replaced with
+ *  -f (workers cannot ask).  A summary goes to stderr at the end.
+ */
+
+struct job {
+	char		* name;		/* as given or found		*/
+	int		status;		/* 0 done, 1 skipped, -1 failed	*/
+	long		frames;
+	unsigned long	inbytes, outbytes;
+	double		seconds;
+};
+
+struct pool {
+	struct job	* jobs;
+	int		njobs;
+	int		next;		/* next job to hand out		*/
+	pthread_mutex_t	lock;
+};
+
+static double now P0()
+{
+	struct timeval	tv;
+
+	gettimeofday(&tv, (struct timezone *)0);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static int write_whole P3((fd, p, len), int fd, char * p, unsigned long len)
+{
+	while (len > 0) {
+		long n = write(fd, p, len);
+		if (n <= 0) return -1;
+		p   += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/*
+ *  Encode the mapped input into a freshly allocated buffer of frames.
+ */
+static char * encode_buffer P6((name, p, len, desc, outlen, frames),
+	char		* name,
+	unsigned char	* p,
+	unsigned long	len,
+	struct fmtdesc	* desc,
+	unsigned long	* outlen,
+	long		* frames)
+{
+	gsm		r;
+	gsm_signal	s[ 160 ];
+	char		* out;
+	long		f, nsamples;
+
+	if (desc == &f_audio) {
+		unsigned long	enc;
+		long		off = audio_header_length(p, len, &enc);
+
+		if (off < 0) {
+			fprintf(stderr,
+			"%s: bad (missing?) header in Sun audio file \"%s\"\n",
+				progname, name);
+			return (char *)0;
+		}
+		p   += off;
+		len -= off;
+		switch (enc) {
+		case 1:	desc = &f_ulaw;   break;
+		case 2: desc = &f_alaw;   break;
+		case 3: desc = &f_linear; break;
+		default:
+			fprintf(stderr,
+"%s: warning: file format #%lu for %s not implemented, defaulting to u-law.\n",
+				progname, enc, name);
+			desc = &f_ulaw;
+			break;
+		}
+	}
+
+	nsamples = len / desc->width;
+	*frames  = (nsamples + 159) / 160;
+	*outlen  = *frames * sizeof(gsm_frame);
+	if (!(out = malloc(*outlen ? *outlen : 1)) || !(r = gsm_create())) {
+		perror(progname);
+		free(out);
+		return (char *)0;
+	}
+	(void)gsm_option(r, GSM_OPT_FAST,    &f_fast);
+	(void)gsm_option(r, GSM_OPT_VERBOSE, &f_verbose);
+
+	for (f = 0; f < *frames; f++) {
+		long cc = nsamples - f * 160;
+
+		if (cc > 160) cc = 160;
+		(*desc->from_bytes)(p + f * 160 * desc->width, s, (int)cc);
+		if (cc < 160)
+			memset((char *)(s+cc), 0, sizeof(s)-(cc * sizeof(*s)));
+		gsm_encode(r, s, (gsm_byte *)out + f * sizeof(gsm_frame));
+	}
+	gsm_destroy(r);
+	return out;
+}
+
+/*
+ *  Decode the mapped frames into a freshly allocated buffer of samples.
+ */
+static char * decode_buffer P6((name, p, len, desc, outlen, frames),
+	char		* name,
+	unsigned char	* p,
+	unsigned long	len,
+	struct fmtdesc	* desc,
+	unsigned long	* outlen,
+	long		* frames)
+{
+	gsm		r;
+	gsm_signal	d[ 160 ];
+	char		* out;
+	unsigned char	* o;
+	long		f;
+	int		header = desc == &f_audio ? AUDIO_HEADER_SIZE : 0;
+
+	if (len % sizeof(gsm_frame)) {
+		fprintf(stderr,
+			"%s: incomplete frame (%d byte%s missing) from %s\n",
+			progname,
+			(int)(sizeof(gsm_frame) - len % sizeof(gsm_frame)),
+			"s" + (sizeof(gsm_frame) - len % sizeof(gsm_frame) == 1),
+			name);
+		return (char *)0;
+	}
+	*frames = len / sizeof(gsm_frame);
+	*outlen = header + *frames * 160 * desc->width;
+	if (!(out = malloc(*outlen)) || !(r = gsm_create())) {
+		perror(progname);
+		free(out);
+		return (char *)0;
+	}
+	(void)gsm_option(r, GSM_OPT_FAST,    &f_fast);
+	(void)gsm_option(r, GSM_OPT_VERBOSE, &f_verbose);
+
+	o = (unsigned char *)out;
+	if (header) {
+		audio_header(o);
+		o += header;
+	}
+	for (f = 0; f < *frames; f++, p += sizeof(gsm_frame)) {
+		if (gsm_decode(r, p, d)) {
+			fprintf(stderr, "%s: bad frame in %s\n",
+				progname, name);
+			gsm_destroy(r);
+			free(out);
+			return (char *)0;
+		}
+		(*desc->to_bytes)(d, o + f * 160 * desc->width, 160);
+	}
+	gsm_destroy(r);
+	return out;
+}
+
+/*
+ *  Give the output the input's mode, owner and times, as update_mode(),
+ *  update_own() and update_times() in toast.c do.
+ */
+static void copy_attributes P3((fd, outname, st),
+	int fd, char * outname, struct stat * st)
+{
+	if (fchmod(fd, st->st_mode & 07777)) {
+		perror(outname);
+		fprintf(stderr, "%s: could not change file mode of \"%s\"\n",
+			progname, outname);
+	}
+	(void)fchown(fd, st->st_uid, st->st_gid);
+#ifdef	HAS_UTIME
+	{
+		struct utimbuf ut;
+
+		ut.actime  = st->st_atime;
+		ut.modtime = st->st_mtime;
+		(void) utime(outname, &ut);
+	}
+#endif
+}
+
+static void convert P1((job), struct job * job)
+{
+	char		* inname, * outname = (char *)0;
+	char		* out = (char *)0;
+	unsigned char	* in = (unsigned char *)0;
+	struct fmtdesc	* desc;
+	struct stat	st;
+	unsigned long	outlen;
+	int		infd = -1, outfd = -1;
+	double		t0 = now();
+
+	job->status = -1;
+
+	if (f_decode) inname = codename(job->name);
+	else {
+		if (suffix(job->name, SUFFIX_TOASTED)) {
+			fprintf(stderr,
+			"%s: %s already has \"%s\" suffix -- unchanged.\n",
+				progname, job->name, SUFFIX_TOASTED );
+			job->status = 1;
+			return;
+		}
+		inname = job->name;
+	}
+
+	if ((infd = open(inname, O_RDONLY)) < 0 || fstat(infd, &st) < 0) {
+		perror(inname);
+		fprintf(stderr, "%s: cannot open \"%s\" for reading\n",
+			progname, inname);
+		goto done;
+	}
+	if (!S_ISREG(st.st_mode)) {
+		fprintf(stderr, "%s: \"%s\" is not a regular file -- unchanged.\n",
+			progname, inname);
+		job->status = 1;
+		goto done;
+	}
+	if (st.st_nlink > 1 && !f_precious) {
+		fprintf(stderr, "%s: \"%s\" has %d other link%s -- unchanged.\n",
+			progname, inname, (int)st.st_nlink - 1,
+			"s" + (st.st_nlink <= 2));
+		job->status = 1;
+		goto done;
+	}
+
+	desc = f_format ? f_format : grok_format(inname);
+	if (!desc) desc = &f_ulaw;		/* DEFAULT_FORMAT */
+
+	outname = (f_decode ? plainname : codename)(job->name);
+	if (!length_okay(outname)) goto done;
+
+	job->inbytes = st.st_size;
+	if (st.st_size > 0) {
+		in = (unsigned char *)mmap((void *)0, st.st_size, PROT_READ,
+			MAP_PRIVATE, infd, 0);
+		if (in == (unsigned char *)MAP_FAILED) {
+			in = (unsigned char *)0;
+			perror(inname);
+			goto done;
+		}
+	}
+
+	out = f_decode
+		? decode_buffer(inname, in, st.st_size, desc, &outlen,
+				&job->frames)
+		: encode_buffer(inname, in, st.st_size, desc, &outlen,
+				&job->frames);
+	if (!out) goto done;
+
+	if ((outfd = open(outname, O_WRITE_EXCL, 0666)) < 0) {
+		if (errno == EEXIST && f_force)
+			outfd = open(outname, O_WRONLY|O_TRUNC, 0666);
+		else if (errno == EEXIST) {
+			fprintf(stderr, "%s: %s already exists -- unchanged.\n",
+				progname, outname);
+			job->status = 1;
+			goto done;
+		}
+	}
+	if (outfd < 0) {
+		perror(outname);
+		fprintf(stderr, "%s: can't open \"%s\" for writing\n",
+			progname, outname);
+		goto done;
+	}
+	if (write_whole(outfd, out, outlen) < 0) {
+		perror(outname);
+		fprintf(stderr, "%s: error writing \"%s\"\n",
+			progname, outname);
+		(void)close(outfd), outfd = -1;
+		(void)unlink(outname);
+		goto done;
+	}
+	copy_attributes(outfd, outname, &st);
+	if (close(outfd) < 0) {
+		outfd = -1;
+		perror(outname);
+		(void)unlink(outname);
+		goto done;
+	}
+	outfd = -1;
+	job->outbytes = outlen;
+
+	if (!f_precious && unlink(inname) < 0) {
+		perror(inname);
+		fprintf(stderr, "%s: source \"%s\" not deleted.\n",
+			progname, inname);
+	}
+	job->status = 0;
+
+done:
+	if (in) (void)munmap((void *)in, st.st_size);
+	if (infd >= 0) (void)close(infd);
+	if (outfd >= 0) (void)close(outfd);
+	free(out);
+	if (inname != job->name) free(inname);
+	free(outname);
+	job->seconds = now() - t0;
+}
+
+static void * worker P1((arg), void * arg)
+{
+	struct pool	* pool = (struct pool *)arg;
+	int		i;
+
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (i >= pool->njobs) break;
+		convert(pool->jobs + i);
+	}
+	return (void *)0;
+}
+
+static int by_name P2((a, b), const void * a, const void * b)
+{
+	return strcmp(((struct job *)a)->name, ((struct job *)b)->name);
+}
+
+static int add_job P4((jobs, cap, n, name),
+	struct job ** jobs, int * cap, int * n, char * name)
+{
+	if (*n == *cap) {
+		int		ncap = *cap ? 2 * *cap : 64;
+		struct job	* p  = (struct job *)realloc(*jobs,
+						ncap * sizeof(**jobs));
+		if (!p) return -1;
+		*jobs = p;
+		*cap  = ncap;
+	}
+	memset((char *)(*jobs + *n), 0, sizeof(**jobs));
+	(*jobs)[(*n)++].name = name;
+	return 0;
+}
+
+/*
+ *  Expand directories into the regular files they hold that this run
+ *  could convert: .gsm files when decoding, others when encoding.
+ */
+static struct job * collect P3((av, ac, n), char ** av, int ac, int * n)
+{
+	struct job	* jobs = (struct job *)0;
+	int		cap = 0, i;
+
+	*n = 0;
+	for (i = 0; i < ac; i++) {
+		struct stat	st;
+		DIR		* dir;
+		struct dirent	* de;
+		char		* name;
+
+		if (stat(av[i], &st) < 0 || !S_ISDIR(st.st_mode)) {
+			name = malloc(strlen(av[i]) + 1);
+			if (!name || add_job(&jobs, &cap, n, strcpy(name, av[i])))
+				free(name);
+			continue;
+		}
+		if (!(dir = opendir(av[i]))) {
+			perror(av[i]);
+			continue;
+		}
+		while ((de = readdir(dir)) != (struct dirent *)0) {
+			name = malloc(strlen(av[i]) + strlen(de->d_name) + 2);
+			if (!name) break;
+			sprintf(name, "%s/%s", av[i], de->d_name);
+			if (  stat(name, &st) < 0 || !S_ISREG(st.st_mode)
+			   || !suffix(name, SUFFIX_TOASTED) != !f_decode
+			   || add_job(&jobs, &cap, n, name))
+				free(name);
+		}
+		(void)closedir(dir);
+	}
+	if (*n > 1) qsort(jobs, *n, sizeof(*jobs), by_name);
+	return jobs;
+}
+
+int process_pool P3((av, ac, threads), char ** av, int ac, int threads)
+{
+	struct pool	pool;
+	pthread_t	* tids;
+	int		i, started, failed = 0, skipped = 0;
+	long		frames = 0;
+	unsigned long	inbytes = 0, outbytes = 0;
+	double		t0, wall, busy = 0, audio;
+
+	if (threads < 0) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = n > 0 ? (int)n : 1;
+	}
+
+	pool.jobs = collect(av, ac, &pool.njobs);
+	pool.next = 0;
+	pthread_mutex_init(&pool.lock, (pthread_mutexattr_t *)0);
+	if (threads > pool.njobs) threads = pool.njobs > 0 ? pool.njobs : 1;
+
+	t0 = now();
+	tids = (pthread_t *)malloc(threads * sizeof(*tids));
+	for (started = 0; tids && started < threads; started++)
+		if (pthread_create(tids + started, (pthread_attr_t *)0,
+				   worker, (void *)&pool))
+			break;
+	if (!started) (void)worker((void *)&pool);
+	for (i = 0; i < started; i++) pthread_join(tids[i], (void **)0);
+	wall = now() - t0;
+
+	for (i = 0; i < pool.njobs; i++) {
+		struct job * j = pool.jobs + i;
+
+		if (j->status < 0) failed++;
+		else if (j->status > 0) skipped++;
+		else {
+			frames   += j->frames;
+			inbytes  += j->inbytes;
+			outbytes += j->outbytes;
+		}
+		busy += j->seconds;
+		free(j->name);
+	}
+
+	audio = frames * 160 / 8000.0;
+	fprintf(stderr,
+		"%s: %d file%s (%d failed, %d skipped) on %d thread%s\n",
+		progname, pool.njobs, "s" + (pool.njobs == 1),
+		failed, skipped, started ? started : 1,
+		"s" + (started <= 1));
+	fprintf(stderr,
+		"%s: %ld frames, %.1f s of audio, %.1f kB in, %.1f kB out\n",
+		progname, frames, audio, inbytes / 1024.0, outbytes / 1024.0);
+	fprintf(stderr,
+		"%s: %.3f s wall, %.3f s in workers, %.2f MB/s, %.0fx real time\n",
+		progname, wall, busy,
+		wall > 0 ? (inbytes + outbytes) / (1048576.0 * wall) : 0.0,
+		wall > 0 ? audio / wall : 0.0);
+
+	pthread_mutex_destroy(&pool.lock);
+	free(pool.jobs);
+	free(tids);
+	return failed ? 1 : 0;
+}
@@ -619,3 +619,16 @@ int ulaw_output P1((buf), gsm_signal * buf)
 			return -1;
 	return 0;
 }
+
+/*
+ *  Whole-buffer conversions for the parallel file mode (toast_pool.c).
+ */
+void ulaw_from_bytes P3((p, buf, n), unsigned char * p, gsm_signal * buf, int n)
+{
+	while (n-- > 0) *buf++ = U2S(*p++);
+}
+
+void ulaw_to_bytes P3((buf, p, n), gsm_signal * buf, unsigned char * p, int n)
+{
+	while (n-- > 0) *p++ = S2U( (unsigned short)*buf++ );
+}